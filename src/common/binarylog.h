@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include <QDataStream>
+
+#include <cstring>
+
+/**
+ * The compact binary log format written by Logger and rendered by the
+ * logcat tool.
+ *
+ * A file starts with the magic bytes and a version byte, followed by a
+ * sequence of tagged records serialized with QDataStream (version
+ * QDataStream::Qt_6_2):
+ *
+ *   StringTag:  quint32 id, QByteArray utf8
+ *       Interns a string. Category and function names repeat on almost
+ *       every line, writing each unique one once and referencing it by id
+ *       afterwards is where most of the size reduction comes from.
+ *
+ *   MessageTag: qint64 timestampMsecs, quint8 msgType (QtMsgType),
+ *               quint32 categoryId, quint32 functionId, QByteArray utf8
+ *       One log line. Id 0 references the empty string.
+ *
+ * The string table is per file: rotation starts a fresh file with a fresh
+ * table, so every file renders on its own.
+ */
+namespace OCC::BinaryLog {
+
+constexpr char magicC[] = "OCBL";
+constexpr quint8 versionC = 1;
+constexpr auto dataStreamVersionC = QDataStream::Qt_6_2;
+
+enum RecordTag : quint8 {
+    StringTag = 1,
+    MessageTag = 2,
+};
+
+inline void writeFileHeader(QDataStream &stream)
+{
+    stream.writeRawData(magicC, 4);
+    stream << versionC;
+}
+
+/** Consumes and checks the file header, returns false for other formats */
+inline bool readFileHeader(QDataStream &stream)
+{
+    char magic[4];
+    if (stream.readRawData(magic, 4) != 4 || memcmp(magic, magicC, 4) != 0) {
+        return false;
+    }
+    quint8 version;
+    stream >> version;
+    return version == versionC;
+}
+
+inline void writeString(QDataStream &stream, quint32 id, const QByteArray &utf8)
+{
+    stream << static_cast<quint8>(StringTag) << id << utf8;
+}
+
+inline void writeMessage(QDataStream &stream, qint64 timestampMsecs, quint8 msgType, quint32 categoryId, quint32 functionId, const QByteArray &utf8)
+{
+    stream << static_cast<quint8>(MessageTag) << timestampMsecs << msgType << categoryId << functionId << utf8;
+}
+
+}
@@ -18,7 +18,69 @@
 
 #include "checksumalgorithms.h"
 
+#include <QIODevice>
+
+#include <array>
+#include <future>
+
 using namespace OCC;
+
+bool CheckSums::readInChunks(QIODevice *device, const std::function<void(const char *data, qint64 size)> &consumer)
+{
+    // Large enough that the hash computation, not the read loop, dominates.
+    // QCryptographicHash::addData(QIODevice*) reads in 1 KiB pieces, which
+    // is measurable on fast disks.
+    constexpr qint64 chunkSize = 500 * 1024;
+    if (!device->isReadable()) {
+        return false;
+    }
+
+    // Files that fit in one chunk are not worth a pipeline.
+    if (device->size() - device->pos() <= chunkSize) {
+        QByteArray buf(chunkSize, Qt::Uninitialized);
+        while (!device->atEnd()) {
+            const qint64 size = device->read(buf.data(), chunkSize);
+            if (size < 0) {
+                return false;
+            }
+            if (size == 0) {
+                break;
+            }
+            consumer(buf.constData(), size);
+        }
+        return true;
+    }
+
+    // Two-slot pipeline: the consumer digests one chunk off-thread while
+    // the next one is read here. The device stays confined to this thread,
+    // and waiting for the previous digest before handing over the next one
+    // keeps the consumer calls sequential, so hash state is never touched
+    // concurrently.
+    std::array<QByteArray, 2> buffers = { QByteArray(chunkSize, Qt::Uninitialized), QByteArray(chunkSize, Qt::Uninitialized) };
+    std::future<void> pendingDigest;
+    size_t slot = 0;
+    bool ok = true;
+    while (!device->atEnd()) {
+        QByteArray &buf = buffers[slot];
+        const qint64 size = device->read(buf.data(), chunkSize);
+        if (pendingDigest.valid()) {
+            pendingDigest.wait();
+        }
+        if (size < 0) {
+            ok = false;
+            break;
+        }
+        if (size == 0) {
+            break;
+        }
+        pendingDigest = std::async(std::launch::async, [&consumer, &buf, size] { consumer(buf.constData(), size); });
+        slot ^= 1;
+    }
+    if (pendingDigest.valid()) {
+        pendingDigest.wait();
+    }
+    return ok;
+}
 CheckSums::Algorithm CheckSums::fromByteArray(const QByteArray &s)
 {
     // assert to ensure that all keys are uppercase
@@ -24,6 +24,10 @@
 #include <QCryptographicHash>
 #include <QString>
 
+#include <functional>
+
+class QIODevice;
+
 
 namespace OCC {
 namespace CheckSums {
@@ -111,6 +115,23 @@ namespace CheckSums {
     }
 
     OCSYNC_EXPORT Algorithm fromByteArray(const QByteArray &s);
+
+    /** Shared read loop of the checksum engines.
+     *
+     * Reads @p device to its end in large chunks and hands every chunk to
+     * @p consumer. The chunk size is picked so that syscall overhead is
+     * negligible and the vectorized code paths inside the hash backends
+     * (SHA-NI, NEON, zlib's adler32 slices) run at full width; it is also
+     * what makes interleaving several digests over one read pass cheap,
+     * see ComputeMultipleChecksums.
+     *
+     * For files larger than one chunk, reading and digesting overlap:
+     * @p consumer runs on a helper thread for one chunk while the next
+     * chunk is read here. The consumer calls never overlap each other.
+     *
+     * Returns false when a read failed; the consumer is not told.
+     */
+    OCSYNC_EXPORT bool readInChunks(QIODevice *device, const std::function<void(const char *data, qint64 size)> &consumer);
 } // namespace CheckSums
 
 template <>
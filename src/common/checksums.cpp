@@ -25,6 +25,7 @@
 #include <QCryptographicHash>
 #include <QLoggingCategory>
 #include <QScopeGuard>
+#include <QtConcurrentMap>
 #include <QtConcurrentRun>
 
 #include <zlib.h>
@@ -90,18 +91,15 @@ namespace {
 
 QByteArray calcAdler32(QIODevice *device)
 {
-    const qint64 BUFSIZE(500 * 1024); // 500 KiB
     if (device->size() == 0) {
         return QByteArray();
     }
-    QByteArray buf(BUFSIZE, Qt::Uninitialized);
 
     unsigned int adler = adler32(0L, Z_NULL, 0);
-    qint64 size;
-    while (!device->atEnd()) {
-        size = device->read(buf.data(), BUFSIZE);
-        if (size > 0)
-            adler = adler32(adler, (const Bytef *)buf.data(), size);
+    if (!OCC::CheckSums::readInChunks(device, [&adler](const char *data, qint64 size) {
+            adler = adler32(adler, (const Bytef *)data, size);
+        })) {
+        return QByteArray();
     }
 
     return QByteArray::number(adler, 16);
@@ -310,7 +308,11 @@ QByteArray ComputeChecksum::computeNow(QIODevice *device, CheckSums::Algorithm a
         [[fallthrough]];
     case CheckSums::Algorithm::MD5: {
         QCryptographicHash crypto(static_cast<QCryptographicHash::Algorithm>(algorithm));
-        if (crypto.addData(device)) {
+        // Feed large chunks ourselves instead of using addData(QIODevice *):
+        // its tiny internal reads leave the vectorized hash cores starved.
+        if (CheckSums::readInChunks(device, [&crypto](const char *data, qint64 size) {
+                crypto.addData(QByteArrayView(data, size));
+            })) {
             return crypto.result().toHex();
         }
         qCWarning(lcChecksums) << "Failed to compoute checksum" << Utility::enumToString(algorithm);
@@ -339,6 +341,164 @@ void ComputeChecksum::slotCalculationDone()
 }
 
 
+ComputeMultipleChecksums::ComputeMultipleChecksums(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void ComputeMultipleChecksums::setChecksumTypes(const QVector<CheckSums::Algorithm> &types)
+{
+    _checksumTypes = types;
+}
+
+void ComputeMultipleChecksums::start(const QString &filePath)
+{
+    qCInfo(lcChecksums) << "Computing" << _checksumTypes << "checksums of" << filePath << "in one pass in a thread";
+    connect(&_watcher, &QFutureWatcherBase::finished,
+        this, &ComputeMultipleChecksums::slotCalculationDone,
+        Qt::UniqueConnection);
+
+    auto sharedDevice = QSharedPointer<QIODevice>(new QFile(filePath));
+
+    // Bug: The thread will keep running even if ComputeMultipleChecksums is deleted.
+    auto types = _checksumTypes;
+    _watcher.setFuture(QtConcurrent::run([sharedDevice, types]() {
+        if (!sharedDevice->open(QIODevice::ReadOnly)) {
+            if (auto file = qobject_cast<QFile *>(sharedDevice.data())) {
+                qCWarning(lcChecksums) << "Could not open file" << file->fileName()
+                        << "for reading to compute checksums" << file->errorString();
+            }
+            return QVector<QByteArray>(types.size());
+        }
+        auto result = ComputeMultipleChecksums::computeNow(sharedDevice.data(), types);
+        sharedDevice->close();
+        return result;
+    }));
+}
+
+QVector<QByteArray> ComputeMultipleChecksums::computeNow(QIODevice *device, const QVector<CheckSums::Algorithm> &algorithms)
+{
+    const auto log = qScopeGuard([device, &algorithms, timer = Utility::ChronoElapsedTimer()] {
+        if (auto file = qobject_cast<QFile *>(device)) {
+            qCDebug(lcChecksums) << "Finished" << algorithms << "computation for" << file->fileName() << timer.duration();
+        } else {
+            qCDebug(lcChecksums) << "Finished" << algorithms << "computation for" << device << timer.duration();
+        }
+    });
+
+    std::vector<std::unique_ptr<QCryptographicHash>> cryptos(algorithms.size());
+    std::vector<unsigned int> adlers(algorithms.size(), adler32(0L, Z_NULL, 0));
+    for (int i = 0; i < algorithms.size(); ++i) {
+        switch (algorithms.at(i)) {
+        case CheckSums::Algorithm::SHA3_256:
+            [[fallthrough]];
+        case CheckSums::Algorithm::SHA256:
+            [[fallthrough]];
+        case CheckSums::Algorithm::SHA1:
+            [[fallthrough]];
+        case CheckSums::Algorithm::MD5:
+            cryptos[i] = std::make_unique<QCryptographicHash>(static_cast<QCryptographicHash::Algorithm>(algorithms.at(i)));
+            break;
+        default:
+            break;
+        }
+    }
+
+    qint64 totalRead = 0;
+    // One read pass, all digests interleaved per chunk.
+    const bool readOk = CheckSums::readInChunks(device, [&](const char *data, qint64 size) {
+        totalRead += size;
+        for (int i = 0; i < algorithms.size(); ++i) {
+            if (cryptos[i]) {
+                cryptos[i]->addData(QByteArrayView(data, size));
+            } else if (algorithms.at(i) == CheckSums::Algorithm::ADLER32) {
+                adlers[i] = adler32(adlers[i], (const Bytef *)data, size);
+            }
+        }
+    });
+    if (!readOk) {
+        qCWarning(lcChecksums) << "Failed to read from" << device << device->errorString();
+        return QVector<QByteArray>(algorithms.size());
+    }
+
+    QVector<QByteArray> results(algorithms.size());
+    for (int i = 0; i < algorithms.size(); ++i) {
+        switch (algorithms.at(i)) {
+        case CheckSums::Algorithm::ADLER32:
+            // Like calcAdler32(): an empty input yields an empty checksum.
+            if (totalRead > 0) {
+                results[i] = QByteArray::number(adlers[i], 16);
+            }
+            break;
+        case CheckSums::Algorithm::DUMMY_FOR_TESTS:
+            results[i] = QByteArrayLiteral("0x1");
+            break;
+        default:
+            if (cryptos[i]) {
+                results[i] = cryptos[i]->result().toHex();
+            }
+            break;
+        }
+    }
+    return results;
+}
+
+void ComputeMultipleChecksums::slotCalculationDone()
+{
+    Q_EMIT done(_watcher.future().result());
+}
+
+
+StreamingChecksum::StreamingChecksum(CheckSums::Algorithm type)
+    : _type(type)
+{
+    switch (type) {
+    case CheckSums::Algorithm::SHA3_256:
+        [[fallthrough]];
+    case CheckSums::Algorithm::SHA256:
+        [[fallthrough]];
+    case CheckSums::Algorithm::SHA1:
+        [[fallthrough]];
+    case CheckSums::Algorithm::MD5:
+        _crypto = std::make_unique<QCryptographicHash>(static_cast<QCryptographicHash::Algorithm>(type));
+        break;
+    case CheckSums::Algorithm::ADLER32:
+        _adler = adler32(0L, Z_NULL, 0);
+        break;
+    default:
+        break;
+    }
+}
+
+void StreamingChecksum::update(const char *data, qint64 len)
+{
+    if (len <= 0) {
+        return;
+    }
+    _size += len;
+    if (_crypto) {
+        _crypto->addData(QByteArrayView(data, len));
+    } else if (_type == CheckSums::Algorithm::ADLER32) {
+        _adler = adler32(_adler, (const Bytef *)data, len);
+    }
+}
+
+QByteArray StreamingChecksum::result() const
+{
+    if (_crypto) {
+        return _crypto->result().toHex();
+    }
+    switch (_type) {
+    case CheckSums::Algorithm::ADLER32:
+        // Like calcAdler32(): an empty input yields an empty checksum.
+        return _size == 0 ? QByteArray() : QByteArray::number(_adler, 16);
+    case CheckSums::Algorithm::DUMMY_FOR_TESTS:
+        return QByteArrayLiteral("0x1");
+    default:
+        return {};
+    }
+}
+
 ValidateChecksumHeader::ValidateChecksumHeader(QObject *parent)
     : QObject(parent)
 {
@@ -377,6 +537,26 @@ void ValidateChecksumHeader::start(std::unique_ptr<QIODevice> device, const QByt
         calculator->start(std::move(device));
 }
 
+bool ValidateChecksumHeader::validatePrecomputed(CheckSums::Algorithm checksumType, const QByteArray &checksum, const QByteArray &checksumHeader)
+{
+    // If the incoming header is empty no validation can happen. Just continue.
+    if (checksumHeader.isEmpty()) {
+        Q_EMIT validated(CheckSums::Algorithm::PARSE_ERROR, QByteArray());
+        return true;
+    }
+    _expectedChecksum = ChecksumHeader::parseChecksumHeader(checksumHeader);
+    if (!_expectedChecksum.isValid()) {
+        qCWarning(lcChecksums) << "Checksum header malformed:" << checksumHeader;
+        Q_EMIT validationFailed(_expectedChecksum.error());
+        return true;
+    }
+    if (_expectedChecksum.type() != checksumType) {
+        return false;
+    }
+    slotChecksumCalculated(checksumType, checksum);
+    return true;
+}
+
 void ValidateChecksumHeader::slotChecksumCalculated(CheckSums::Algorithm checksumType,
     const QByteArray &checksum)
 {
@@ -391,4 +571,52 @@ void ValidateChecksumHeader::slotChecksumCalculated(CheckSums::Algorithm checksu
     }
     Q_EMIT validated(checksumType, checksum);
 }
+
+ValidateChecksumBatch::ValidateChecksumBatch(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void ValidateChecksumBatch::start(const QVector<Entry> &entries)
+{
+    connect(&_watcher, &QFutureWatcherBase::finished,
+        this, &ValidateChecksumBatch::slotCalculationDone,
+        Qt::UniqueConnection);
+
+    // Like ComputeChecksum: the threads keep running if this object is deleted.
+    _watcher.setFuture(QtConcurrent::mapped(entries, [](const Entry &entry) {
+        Result result;
+        if (entry.checksumHeader.isEmpty()) {
+            return result;
+        }
+        const auto expected = ChecksumHeader::parseChecksumHeader(entry.checksumHeader);
+        if (!expected.isValid()) {
+            qCWarning(lcChecksums) << "Checksum header malformed:" << entry.checksumHeader;
+            result.mismatched = entry.filePath;
+            return result;
+        }
+        const QByteArray checksum = ComputeChecksum::computeNowOnFile(entry.filePath, expected.type());
+        if (checksum.isEmpty()) {
+            result.unreadable = entry.filePath;
+        } else if (checksum != expected.checksum()) {
+            result.mismatched = entry.filePath;
+        }
+        return result;
+    }));
+}
+
+void ValidateChecksumBatch::slotCalculationDone()
+{
+    QStringList mismatched;
+    QStringList unreadable;
+    const auto results = _watcher.future().results();
+    for (const auto &result : results) {
+        if (!result.mismatched.isEmpty()) {
+            mismatched.append(result.mismatched);
+        } else if (!result.unreadable.isEmpty()) {
+            unreadable.append(result.unreadable);
+        }
+    }
+    Q_EMIT done(mismatched, unreadable);
+}
 }
@@ -140,6 +140,79 @@ private:
     QFutureWatcher<QByteArray> _watcher;
 };
 
+/**
+ * Computes several checksums of a file in a single read pass.
+ *
+ * Feeding all digest contexts from one buffer costs the same I/O as one
+ * ComputeChecksum run, where running them back to back reads the file once
+ * per algorithm.
+ * \ingroup libsync
+ */
+class OCSYNC_EXPORT ComputeMultipleChecksums : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ComputeMultipleChecksums(QObject *parent = nullptr);
+
+    void setChecksumTypes(const QVector<CheckSums::Algorithm> &types);
+
+    /**
+     * Computes all requested checksums for the given file path.
+     *
+     * done() is emitted when the calculation finishes.
+     */
+    void start(const QString &filePath);
+
+    /**
+     * Single-pass equivalent of ComputeChecksum::computeNow() for several
+     * algorithms. Results are ordered like the algorithms; a failed or
+     * unusable algorithm yields an empty entry.
+     */
+    static QVector<QByteArray> computeNow(QIODevice *device, const QVector<CheckSums::Algorithm> &algorithms);
+
+Q_SIGNALS:
+    /// Checksums in the order of the requested types.
+    void done(const QVector<QByteArray> &checksums);
+
+private Q_SLOTS:
+    void slotCalculationDone();
+
+private:
+    QVector<CheckSums::Algorithm> _checksumTypes;
+
+    // watcher for the checksum calculation thread
+    QFutureWatcher<QVector<QByteArray>> _watcher;
+};
+
+/**
+ * Incrementally computes a checksum over data that arrives in pieces.
+ *
+ * Produces the same result as ComputeChecksum::computeNow() fed the
+ * identical bytes, but without needing the data on disk: a download can
+ * hash each block as it is written, so validating it afterwards does not
+ * have to read the finished file back.
+ * \ingroup libsync
+ */
+class OCSYNC_EXPORT StreamingChecksum
+{
+public:
+    explicit StreamingChecksum(CheckSums::Algorithm type);
+
+    CheckSums::Algorithm checksumType() const { return _type; }
+
+    /// Feeds the next block of data into the digest.
+    void update(const char *data, qint64 len);
+
+    /// The finished checksum, empty when the algorithm is unsupported.
+    QByteArray result() const;
+
+private:
+    CheckSums::Algorithm _type;
+    std::unique_ptr<QCryptographicHash> _crypto;
+    unsigned int _adler = 0;
+    qint64 _size = 0;
+};
+
 /**
  * Checks whether a file's checksum matches the expected value.
  * @ingroup libsync
@@ -169,6 +242,16 @@ public:
      */
     void start(std::unique_ptr<QIODevice> device, const QByteArray &checksumHeader);
 
+    /**
+     * Check an already-computed checksum against the provided checksumHeader
+     *
+     * For callers that hashed the data while receiving it. Emits the same
+     * signals as start(). Returns false without emitting anything when the
+     * precomputed value's algorithm does not match the header, so the
+     * caller can fall back to reading the file.
+     */
+    bool validatePrecomputed(CheckSums::Algorithm checksumType, const QByteArray &checksum, const QByteArray &checksumHeader);
+
 Q_SIGNALS:
     void validated(CheckSums::Algorithm checksumType, const QByteArray &checksum);
     void validationFailed(const QString &errMsg);
@@ -181,4 +264,58 @@ private:
 
     ChecksumHeader _expectedChecksum;
 };
+
+/**
+ * Verifies many files against their checksum headers in one go.
+ *
+ * ValidateChecksumHeader allocates a QObject, a worker task and a result
+ * signal per file; when thousands of small files are verified back to
+ * back that churn dominates the hashing itself. This batch variant maps
+ * the whole list over the worker pool and reports a single aggregated
+ * result.
+ * \ingroup libsync
+ */
+class OCSYNC_EXPORT ValidateChecksumBatch : public QObject
+{
+    Q_OBJECT
+public:
+    struct Entry
+    {
+        QString filePath;
+        QByteArray checksumHeader;
+    };
+
+    explicit ValidateChecksumBatch(QObject *parent = nullptr);
+
+    /**
+     * Verifies all entries on the worker pool; done() is emitted once.
+     *
+     * An entry with an empty checksum header passes, like in
+     * ValidateChecksumHeader::start(); a malformed header counts as a
+     * mismatch.
+     */
+    void start(const QVector<Entry> &entries);
+
+Q_SIGNALS:
+    /**
+     * mismatchedPaths hashed to a different value than their header;
+     * unreadablePaths could not be read at all and prove nothing about
+     * the content. Both empty means every entry passed.
+     */
+    void done(const QStringList &mismatchedPaths, const QStringList &unreadablePaths);
+
+private Q_SLOTS:
+    void slotCalculationDone();
+
+private:
+    /// Per-entry outcome; at most one member is set
+    struct Result
+    {
+        QString mismatched;
+        QString unreadable;
+    };
+
+    // watcher for the verification threads
+    QFutureWatcher<Result> _watcher;
+};
 }
@@ -21,21 +21,35 @@
 
 using namespace OCC::Utility;
 
+namespace {
+std::chrono::steady_clock::time_point (*s_clockOverride)() = nullptr;
+}
+
+std::chrono::steady_clock::time_point ChronoElapsedTimer::now()
+{
+    return s_clockOverride ? s_clockOverride() : std::chrono::steady_clock::now();
+}
+
+void ChronoElapsedTimer::setClockOverrideForTesting(std::chrono::steady_clock::time_point (*clock)())
+{
+    s_clockOverride = clock;
+}
+
 ChronoElapsedTimer::ChronoElapsedTimer()
-    : _start(std::chrono::steady_clock::now())
+    : _start(now())
 {
 }
 
 void ChronoElapsedTimer::reset()
 {
-    _start = std::chrono::steady_clock::now();
+    _start = now();
     _end = {};
 }
 
 void ChronoElapsedTimer::stop()
 {
     Q_ASSERT(_end == std::chrono::steady_clock::time_point {});
-    _end = std::chrono::steady_clock::now();
+    _end = now();
 }
 
 std::chrono::nanoseconds ChronoElapsedTimer::duration() const
@@ -43,5 +57,5 @@ std::chrono::nanoseconds ChronoElapsedTimer::duration() const
     if (_end != std::chrono::steady_clock::time_point {}) {
         return _end - _start;
     }
-    return std::chrono::steady_clock::now() - _start;
+    return now() - _start;
 }
@@ -44,7 +44,19 @@ public:
      */
     std::chrono::nanoseconds duration() const;
 
+    /**
+     * Replaces the time source of all timers, for tests.
+     *
+     * Simulation tests install a controllable clock here to fast-forward
+     * time-based policies through days of virtual time in milliseconds.
+     * Pass nullptr to return to the steady clock. Not thread-safe; set it
+     * before the timers under test are created.
+     */
+    static void setClockOverrideForTesting(std::chrono::steady_clock::time_point (*clock)());
+
 private:
+    static std::chrono::steady_clock::time_point now();
+
     std::chrono::steady_clock::time_point _start = {};
     std::chrono::steady_clock::time_point _end = {};
 };
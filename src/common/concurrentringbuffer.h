@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <vector>
+
+namespace OCC {
+
+/**
+ * A fixed sized lock-free ring buffer for handing items between threads.
+ *
+ * The thread-safe sibling of FixedSizeRingBuffer: any number of producers may
+ * tryPush() concurrently while a consumer tryPop()s, no mutex involved. Slots
+ * carry a sequence number that encodes whether they are free or occupied, a
+ * producer claims one with a single compare-exchange on the head counter.
+ *
+ * Unlike FixedSizeRingBuffer the capacity is rounded up to a power of two so
+ * the slot index is a cheap bitmask of the monotonically growing counters.
+ */
+template <typename TYPE>
+class ConcurrentRingBuffer
+{
+public:
+    explicit ConcurrentRingBuffer(size_t size)
+        : _cells(roundUpToPowerOfTwo(size))
+        , _mask(_cells.size() - 1)
+    {
+        for (size_t i = 0; i < _cells.size(); ++i) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ConcurrentRingBuffer(const ConcurrentRingBuffer &) = delete;
+    ConcurrentRingBuffer &operator=(const ConcurrentRingBuffer &) = delete;
+
+    constexpr size_t capacity() const
+    {
+        return _cells.size();
+    }
+
+    /** Append an item, returns false if the buffer is full. */
+    bool tryPush(TYPE &&data)
+    {
+        Cell *cell;
+        size_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (difference == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(data);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Remove the oldest item, returns false if the buffer is empty. */
+    bool tryPop(TYPE *data)
+    {
+        Cell *cell;
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (difference == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        *data = std::move(cell->data);
+        cell->sequence.store(pos + _cells.size(), std::memory_order_release);
+        return true;
+    }
+
+    /** Append an item, discarding the oldest entries while the buffer is full.
+     *
+     * Returns the number of discarded items. tryPop() supports concurrent
+     * consumers, so producers shedding old entries here do not interfere with
+     * the real consumer draining the buffer.
+     */
+    size_t pushDropOldest(TYPE &&data)
+    {
+        size_t dropped = 0;
+        while (!tryPush(std::move(data))) {
+            TYPE discarded;
+            if (tryPop(&discarded)) {
+                ++dropped;
+            }
+        }
+        return dropped;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        TYPE data;
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t size)
+    {
+        size_t result = 1;
+        while (result < size) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    std::vector<Cell> _cells;
+    const size_t _mask;
+
+    std::atomic<size_t> _head = 0;
+    std::atomic<size_t> _tail = 0;
+};
+
+}
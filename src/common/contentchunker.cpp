@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "common/contentchunker.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+
+#include <array>
+
+namespace {
+
+// Gear table for the rolling hash: one pseudo-random 64 bit value per byte
+// value, generated deterministically (splitmix64) so boundaries are stable
+// across runs and machines.
+std::array<quint64, 256> makeGearTable()
+{
+    std::array<quint64, 256> table;
+    quint64 state = 0x9ae16a3b2f90404fULL;
+    for (auto &entry : table) {
+        state += 0x9e3779b97f4a7c15ULL;
+        quint64 z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        entry = z ^ (z >> 31);
+    }
+    return table;
+}
+
+// A boundary is cut when the masked hash hits zero, so the mask width sets
+// the expected distance between cuts. Since no cut is tested before
+// minChunkSize the real average lands somewhat above averageChunkSize,
+// which is fine for our purpose.
+constexpr quint64 boundaryMask = quint64(OCC::ContentChunker::averageChunkSize) - 1;
+
+constexpr qint64 readBufferSize = 1024 * 1024;
+}
+
+namespace OCC {
+
+QVector<ContentChunk> ContentChunker::chunk(QIODevice *device)
+{
+    static const auto gearTable = makeGearTable();
+
+    QVector<ContentChunk> chunks;
+    QCryptographicHash chunkHash(QCryptographicHash::Sha1);
+    QByteArray buffer(readBufferSize, Qt::Uninitialized);
+
+    qint64 chunkStart = 0;
+    qint64 chunkSize = 0;
+    quint64 gear = 0;
+
+    while (true) {
+        const qint64 read = device->read(buffer.data(), buffer.size());
+        if (read < 0) {
+            // A truncated chunk list would corrupt any delta derived from it.
+            return {};
+        }
+        if (read == 0) {
+            break;
+        }
+        const char *data = buffer.constData();
+        qint64 consumed = 0;
+        for (qint64 i = 0; i < read; ++i) {
+            gear = (gear << 1) + gearTable[uchar(data[i])];
+            chunkSize++;
+            if ((chunkSize >= minChunkSize && (gear & boundaryMask) == 0) || chunkSize >= maxChunkSize) {
+                chunkHash.addData(data + consumed, i + 1 - consumed);
+                consumed = i + 1;
+                chunks.append({chunkStart, chunkSize, chunkHash.result()});
+                chunkHash.reset();
+                chunkStart += chunkSize;
+                chunkSize = 0;
+                gear = 0;
+            }
+        }
+        chunkHash.addData(data + consumed, read - consumed);
+    }
+
+    if (chunkSize > 0) {
+        chunks.append({chunkStart, chunkSize, chunkHash.result()});
+    }
+    return chunks;
+}
+
+QVector<ContentChunk> ContentChunker::chunkFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return chunk(&file);
+}
+
+bool operator==(const ContentChunk &lhs, const ContentChunk &rhs)
+{
+    return lhs.offset == rhs.offset
+        && lhs.size == rhs.size
+        && lhs.hash == rhs.hash;
+}
+}
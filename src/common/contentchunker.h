@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QByteArray>
+#include <QVector>
+
+class QIODevice;
+
+namespace OCC {
+
+/**
+ * One chunk of a file as cut by the ContentChunker.
+ */
+struct OCSYNC_EXPORT ContentChunk
+{
+    /// Offset of the chunk in the file
+    qint64 offset = 0;
+    /// Size of the chunk in bytes
+    qint64 size = 0;
+    /// SHA-1 of the chunk data
+    QByteArray hash;
+};
+
+/**
+ * Cuts a stream into content-defined chunks.
+ *
+ * Boundaries are derived from a rolling hash of the data itself, not from
+ * fixed offsets. An insertion or deletion therefore only moves the
+ * boundaries near the edit; the chunks before and after it keep their
+ * hashes, which is what makes per-chunk hashes usable for delta uploads.
+ *
+ * The cut decision and the gear table are deterministic, so the same data
+ * always yields the same chunks, across runs and across machines.
+ *
+ * @ingroup libsync
+ */
+class OCSYNC_EXPORT ContentChunker
+{
+public:
+    /// No boundary is cut before this many bytes.
+    static constexpr qint64 minChunkSize = 1 * 1024 * 1024;
+    /// The boundary mask targets chunks of roughly this size.
+    static constexpr qint64 averageChunkSize = 4 * 1024 * 1024;
+    /// A boundary is forced at this many bytes.
+    static constexpr qint64 maxChunkSize = 16 * 1024 * 1024;
+
+    /** Chunks the device from its current position to the end.
+     *
+     * Returns an empty vector when reading fails; a partial chunk list
+     * would silently corrupt a delta computation.
+     */
+    static QVector<ContentChunk> chunk(QIODevice *device);
+
+    /// Convenience wrapper opening filePath for reading.
+    static QVector<ContentChunk> chunkFile(const QString &filePath);
+};
+
+bool OCSYNC_EXPORT operator==(const ContentChunk &lhs, const ContentChunk &rhs);
+}
@@ -19,6 +19,7 @@
 #include "filesystembase.h"
 #include "utility.h"
 #include "common/asserts.h"
+#include "common/watchdog.h"
 
 #include <QCoreApplication>
 #include <QDateTime>
@@ -157,6 +158,7 @@ bool FileSystem::rename(const QString &originFileName,
     const QString &destinationFileName,
     QString *errorString)
 {
+    OC_WATCHDOG_OP("FileSystem::rename");
     bool success = false;
     QString error;
 #ifdef Q_OS_WIN
@@ -203,6 +205,7 @@ bool FileSystem::uncheckedRenameReplace(const QString &originFileName,
     const QString &destinationFileName,
     QString *errorString)
 {
+    OC_WATCHDOG_OP("FileSystem::uncheckedRenameReplace");
     Q_ASSERT(errorString);
 
 #ifndef Q_OS_WIN
@@ -398,6 +401,7 @@ bool FileSystem::longPathsEnabledOnWindows()
 
 bool FileSystem::remove(const QString &fileName, QString *errorString)
 {
+    OC_WATCHDOG_OP("FileSystem::remove");
 #ifdef Q_OS_WIN
     // You cannot delete a read-only file on windows, but we want to
     // allow that.
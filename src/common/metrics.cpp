@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#include "metrics.h"
+
+#include <QJsonObject>
+#include <QMutex>
+
+#include <vector>
+
+using namespace OCC;
+
+namespace {
+
+struct Registry
+{
+    QMutex mutex;
+    // name and value storage belong to the registering static instance,
+    // which is never destroyed before the snapshots stop
+    std::vector<std::pair<const char *, const Metrics::Metric *>> metrics;
+};
+
+Registry &registry()
+{
+    static Registry reg;
+    return reg;
+}
+
+} // anonymous namespace
+
+Metrics::Metric::Metric(const char *name)
+{
+    auto &reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    reg.metrics.emplace_back(name, this);
+}
+
+Metrics::PeakGauge::PeakGauge(const char *name)
+    : _peakName(QByteArray(name) + QByteArrayLiteral(".peak"))
+    , _value(name)
+    , _peak(_peakName.constData())
+{
+}
+
+QJsonObject Metrics::toJson()
+{
+    auto &reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    QJsonObject out;
+    for (const auto &[name, metric] : reg.metrics) {
+        out[QString::fromUtf8(name)] = metric->value();
+    }
+    return out;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <atomic>
+
+class QJsonObject;
+
+namespace OCC {
+
+/**
+ * Process-wide metrics registry.
+ *
+ * Counters and gauges register themselves by name on construction and are
+ * updated with relaxed atomics, so instrumented hot paths pay a single
+ * uncontended store. toJson() snapshots all registered metrics for the
+ * V2/GET_METRICS socket API command, which is how external monitoring
+ * queries a running client.
+ *
+ * Instances are meant to live for the process lifetime - typically a
+ * function-local static in the instrumented translation unit. There is no
+ * unregistration.
+ */
+namespace Metrics {
+
+    /// Common storage and registration, use Counter or Gauge
+    class OCSYNC_EXPORT Metric
+    {
+        Q_DISABLE_COPY(Metric)
+    public:
+        qint64 value() const
+        {
+            return _value.load(std::memory_order_relaxed);
+        }
+
+    protected:
+        explicit Metric(const char *name);
+        ~Metric() = default;
+
+        std::atomic<qint64> _value = 0;
+    };
+
+    /// A monotonically increasing counter, e.g. bytes downloaded
+    class OCSYNC_EXPORT Counter : public Metric
+    {
+    public:
+        explicit Counter(const char *name)
+            : Metric(name)
+        {
+        }
+
+        void add(qint64 delta = 1)
+        {
+            _value.fetch_add(delta, std::memory_order_relaxed);
+        }
+    };
+
+    /// A value that moves in both directions, e.g. a queue depth
+    class OCSYNC_EXPORT Gauge : public Metric
+    {
+    public:
+        explicit Gauge(const char *name)
+            : Metric(name)
+        {
+        }
+
+        void set(qint64 value)
+        {
+            _value.store(value, std::memory_order_relaxed);
+        }
+
+        void add(qint64 delta)
+        {
+            _value.fetch_add(delta, std::memory_order_relaxed);
+        }
+    };
+
+    /** A gauge that also tracks the highest value it reached.
+     *
+     * Registers twice: the current value under "<name>" and the high-water
+     * mark under "<name>.peak". Used for the per-subsystem memory accounting
+     * in the sync performance report, where the peak attributes a transient
+     * RSS spike long after the memory was released again.
+     */
+    class OCSYNC_EXPORT PeakGauge
+    {
+        Q_DISABLE_COPY(PeakGauge)
+    public:
+        explicit PeakGauge(const char *name);
+
+        void add(qint64 delta)
+        {
+            _peak.updateMax(_value.addAndFetch(delta));
+        }
+
+        void set(qint64 value)
+        {
+            _value.store(value);
+            _peak.updateMax(value);
+        }
+
+        qint64 value() const
+        {
+            return _value.value();
+        }
+
+        qint64 peak() const
+        {
+            return _peak.value();
+        }
+
+        /// Restarts peak tracking from the current value
+        void resetPeak()
+        {
+            _peak.store(_value.value());
+        }
+
+    private:
+        class ValueMetric : public Metric
+        {
+        public:
+            explicit ValueMetric(const char *name)
+                : Metric(name)
+            {
+            }
+
+            qint64 addAndFetch(qint64 delta)
+            {
+                return _value.fetch_add(delta, std::memory_order_relaxed) + delta;
+            }
+
+            void store(qint64 value)
+            {
+                _value.store(value, std::memory_order_relaxed);
+            }
+
+            void updateMax(qint64 candidate)
+            {
+                qint64 seen = _value.load(std::memory_order_relaxed);
+                while (candidate > seen && !_value.compare_exchange_weak(seen, candidate, std::memory_order_relaxed)) {
+                }
+            }
+        };
+
+        // owns the storage for the derived registry name, must outlive _peak
+        const QByteArray _peakName;
+        ValueMetric _value;
+        ValueMetric _peak;
+    };
+
+    /// Snapshot of all registered metrics, keyed by name
+    OCSYNC_EXPORT QJsonObject toJson();
+
+} // namespace Metrics
+
+} // namespace OCC
@@ -20,16 +20,21 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
 #include <QString>
 
 #include "common/asserts.h"
 #include "common/filesystembase.h"
+#include "common/tracer.h"
 #include "common/utility.h"
 
 #include "ownsql.h"
 
 #include <sqlite3.h>
 
+#include <atomic>
 #include <thread>
 
 using namespace std::chrono_literals;
@@ -37,6 +42,79 @@ using namespace std::chrono_literals;
 namespace {
 constexpr int SQLITE_REPEAT_COUNT = 20;
 
+std::atomic<quint64> execCounter = 0;
+
+// Opt-in SQL audit, see sqlAuditEnabled() in the header.
+struct SqlAuditEntry
+{
+    quint64 executions = 0;
+    qint64 totalUs = 0;
+    qint64 maxUs = 0;
+    QByteArray queryPlan;
+};
+
+struct SqlAudit
+{
+    QMutex mutex;
+    QHash<QByteArray, SqlAuditEntry> entries;
+};
+
+SqlAudit &sqlAudit()
+{
+    static SqlAudit audit;
+    return audit;
+}
+
+qint64 sqlAuditThresholdUs()
+{
+    static const qint64 thresholdUs = [] {
+        bool ok = false;
+        const qint64 ms = qEnvironmentVariableIntValue("OWNCLOUD_SQL_AUDIT_THRESHOLD_MS", &ok);
+        return (ok ? qMax<qint64>(0, ms) : 100) * 1000;
+    }();
+    return thresholdUs;
+}
+
+qint64 sqlAuditNowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+QByteArray captureQueryPlan(sqlite3 *db, const QByteArray &sql)
+{
+    sqlite3_stmt *stmt = nullptr;
+    const QByteArray explainSql = QByteArrayLiteral("EXPLAIN QUERY PLAN ") + sql;
+    if (sqlite3_prepare_v2(db, explainSql.constData(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return QByteArrayLiteral("<failed to prepare EXPLAIN QUERY PLAN>");
+    }
+    QByteArray plan;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (!plan.isEmpty()) {
+            plan += '\n';
+        }
+        plan += reinterpret_cast<const char *>(sqlite3_column_text(stmt, 3));
+    }
+    sqlite3_finalize(stmt);
+    return plan;
+}
+
+void recordSqlAudit(sqlite3 *db, const QByteArray &sql, qint64 elapsedUs, bool countExecution)
+{
+    auto &audit = sqlAudit();
+    QMutexLocker locker(&audit.mutex);
+    auto &entry = audit.entries[sql];
+    if (countExecution) {
+        ++entry.executions;
+    }
+    entry.totalUs += elapsedUs;
+    entry.maxUs = qMax(entry.maxUs, elapsedUs);
+    // Capture the plan once, on the first slow call: a degraded journal
+    // shows up as a scan where an index lookup is expected.
+    if (elapsedUs >= sqlAuditThresholdUs() && entry.queryPlan.isEmpty() && db) {
+        entry.queryPlan = captureQueryPlan(db, sql);
+    }
+}
 }
 
 #define SQLITE_DO(A)                                                                \
@@ -51,6 +129,35 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcSql, "sync.database.sql", QtInfoMsg)
 
+quint64 sqlQueryExecCount()
+{
+    return execCounter.load(std::memory_order_relaxed);
+}
+
+bool sqlAuditEnabled()
+{
+    static const bool enabled = qEnvironmentVariableIntValue("OWNCLOUD_SQL_AUDIT") == 1;
+    return enabled;
+}
+
+QJsonObject sqlAuditReport()
+{
+    auto &audit = sqlAudit();
+    QMutexLocker locker(&audit.mutex);
+    QJsonObject out;
+    for (auto it = audit.entries.cbegin(); it != audit.entries.cend(); ++it) {
+        QJsonObject entry;
+        entry[QStringLiteral("executions")] = qint64(it->executions);
+        entry[QStringLiteral("totalUs")] = it->totalUs;
+        entry[QStringLiteral("maxUs")] = it->maxUs;
+        if (!it->queryPlan.isEmpty()) {
+            entry[QStringLiteral("queryPlan")] = QString::fromUtf8(it->queryPlan);
+        }
+        out[QString::fromUtf8(it.key())] = entry;
+    }
+    return out;
+}
+
 SqlDatabase::SqlDatabase()
     : _db(nullptr)
     , _errId(0)
@@ -326,8 +433,13 @@ bool SqlQuery::exec()
         qCWarning(lcSql) << "Can't exec query, statement unprepared.";
         return false;
     }
+    execCounter.fetch_add(1, std::memory_order_relaxed);
+    OC_TRACE_SPAN("journal", "SqlQuery::exec");
     // Don't do anything for selects, that is how we use the lib :-|
+    // Their work happens in next(), which audits itself.
     if (!isSelect() && !isPragma()) {
+        const bool audit = sqlAuditEnabled();
+        const qint64 auditStart = audit ? sqlAuditNowUs() : 0;
         for (int n = 0; n < SQLITE_REPEAT_COUNT; ++n) {
             if (lcSql().isDebugEnabled()) {
                 if (!_boundValues.isEmpty()) {
@@ -366,6 +478,9 @@ bool SqlQuery::exec()
         } else {
             qCDebug(lcSql) << "Last exec affected" << numRowsAffected() << "rows.";
         }
+        if (audit) {
+            recordSqlAudit(_db, _sql, sqlAuditNowUs() - auditStart, true);
+        }
         return (_errId == SQLITE_DONE); // either SQLITE_ROW or SQLITE_DONE
     }
 
@@ -375,6 +490,8 @@ bool SqlQuery::exec()
 auto SqlQuery::next() -> NextResult
 {
     const bool firstStep = !sqlite3_stmt_busy(_stmt);
+    const bool audit = sqlAuditEnabled();
+    const qint64 auditStart = audit ? sqlAuditNowUs() : 0;
 
     for (int n = 0; n < SQLITE_REPEAT_COUNT; ++n) {
         _errId = sqlite3_step(_stmt);
@@ -386,6 +503,12 @@ auto SqlQuery::next() -> NextResult
         }
     }
 
+    if (audit) {
+        // Steps of one traversal accumulate on the statement; the first
+        // step counts as the execution.
+        recordSqlAudit(_db, _sql, sqlAuditNowUs() - auditStart, firstStep);
+    }
+
     NextResult result;
     result.ok = _errId == SQLITE_ROW || _errId == SQLITE_DONE;
     result.hasData = _errId == SQLITE_ROW;
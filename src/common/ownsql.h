@@ -29,11 +29,38 @@
 struct sqlite3;
 struct sqlite3_stmt;
 
+class QJsonObject;
+
 namespace OCC {
 OCSYNC_EXPORT Q_DECLARE_LOGGING_CATEGORY(lcSql)
 
 class SqlQuery;
 
+/** Number of SqlQuery::exec() calls since process start.
+ *
+ * Snapshot it around an operation to attribute journal query load, as the
+ * sync engine's performance report does.
+ */
+OCSYNC_EXPORT quint64 sqlQueryExecCount();
+
+/** Whether the opt-in SQL audit is active.
+ *
+ * Enabled with OWNCLOUD_SQL_AUDIT=1 in the environment. While active, every
+ * statement's executions and step latencies are collected, and the query
+ * plan of a statement is captured with EXPLAIN QUERY PLAN the first time a
+ * call exceeds OWNCLOUD_SQL_AUDIT_THRESHOLD_MS (default 100). Off by
+ * default: the audit adds two clock reads and a hash update per query.
+ */
+OCSYNC_EXPORT bool sqlAuditEnabled();
+
+/** The collected audit data, keyed by statement text.
+ *
+ * Each entry holds "executions", "totalUs", "maxUs" and - once a call went
+ * over the threshold - "queryPlan". Served through the V2/GET_METRICS socket
+ * API command, which is how a degraded journal is inspected in the field.
+ */
+OCSYNC_EXPORT QJsonObject sqlAuditReport();
+
 /**
  * @brief The SqlDatabase class
  * @ingroup libsync
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#pragma once
+
+#include <QtGlobal>
+
+#include <cstddef>
+#include <cstring>
+
+namespace OCC {
+
+/** 64-bit hash of a UTF-8 path, used for the journal's phash keys.
+ *
+ * MurmurHash64A: consumes eight bytes per multiply instead of c_jhash64's
+ * twelve bytes per mixing cascade, with far fewer operations per round.
+ * The journal never leaves the machine, so the word-at-a-time reads being
+ * endian-dependent is fine; what matters is that the value is stable for
+ * a given installation (see the hashversion table in SyncJournalDb).
+ *
+ * The hash only preselects: since 64 bits cannot rule out collisions,
+ * lookups must compare the stored path against the requested one.
+ */
+inline quint64 pathHash64(const char *data, size_t len)
+{
+    const quint64 m = Q_UINT64_C(0xc6a4a7935bd1e995);
+    const int r = 47;
+
+    quint64 h = len * m;
+
+    const char *p = data;
+    const char *end = data + (len & ~size_t(7));
+    for (; p != end; p += 8) {
+        quint64 k;
+        std::memcpy(&k, p, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    if (len & 7) {
+        quint64 tail = 0;
+        std::memcpy(&tail, p, len & 7);
+        h ^= tail;
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+} // namespace OCC
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#pragma once
+
+#include <QSet>
+#include <QString>
+
+namespace OCC {
+
+/** Hash-consing pool for path components.
+ *
+ * The same file name is decoded independently from the server listing, the
+ * local listing and the journal, and common names (".gitignore", "index.js",
+ * ...) additionally repeat across directories. Funneling them through one
+ * pool makes all equal strings share a single implicitly-shared payload;
+ * the duplicates are freed as soon as their producer lets go of them.
+ *
+ * Not thread-safe: meant to be owned by a single consumer, like the
+ * reconcile step of a discovery run. The pool grows with the number of
+ * distinct strings interned and is dropped with its owner.
+ */
+class PathInterner
+{
+public:
+    /// Returns the pooled instance equal to \a s, adding \a s if it is new.
+    QString intern(const QString &s)
+    {
+        const auto it = _pool.constFind(s);
+        if (it != _pool.cend())
+            return *it;
+        _pool.insert(s);
+        return s;
+    }
+
+    qsizetype size() const { return _pool.size(); }
+
+private:
+    QSet<QString> _pool;
+};
+
+} // namespace OCC
@@ -63,8 +63,10 @@ public:
         GetFileRecordQueryByInode,
         GetFileRecordQueryByFileId,
         GetFilesBelowPathQuery,
+        GetFileRecordsAfterPathQuery,
         GetAllFilesQuery,
         ListFilesInPathQuery,
+        CountFilesBelowPathQuery,
         SetFileRecordQuery,
         SetFileRecordChecksumQuery,
         GetDownloadInfoQuery,
@@ -82,12 +84,22 @@ public:
         GetChecksumTypeIdQuery,
         GetChecksumTypeQuery,
         InsertChecksumTypeQuery,
+        GetChecksumCacheQuery,
+        SetChecksumCacheQuery,
         GetDataFingerprintQuery,
         SetDataFingerprintQuery1,
         SetDataFingerprintQuery2,
+        GetKeyValueStoreQuery,
+        SetKeyValueStoreQuery,
+        DeleteKeyValueStoreQuery,
+        AddHistoryEntryQuery,
+        GetHistoryEntriesQuery,
+        PruneHistoryQuery,
         GetConflictRecordQuery,
         SetConflictRecordQuery,
         DeleteConflictRecordQuery,
+        SetVfsIntentQuery,
+        DeleteVfsIntentQuery,
         GetRawPinStateQuery,
         GetEffectivePinStateQuery,
         GetSubPinsQuery,
@@ -17,12 +17,22 @@
  */
 
 #include "remotepermissions.h"
-#include <cstring>
 
 namespace OCC {
 
-static const char letters[] = " WDNVCKRSMmz";
+// one character per permission, index 0 is the placeholder for "non-null but empty"
+static constexpr char letters[] = " WDNVCKRSMmz";
 
+namespace {
+    constexpr int letterIndex(char c)
+    {
+        for (int i = 1; letters[i]; ++i) {
+            if (letters[i] == c)
+                return i;
+        }
+        return -1;
+    }
+}
 
 template <typename Char>
 void RemotePermissions::fromArray(const Char *p)
@@ -30,10 +40,9 @@ void RemotePermissions::fromArray(const Char *p)
     _value = notNullMask;
     if (!p)
         return;
-    while (*p) {
-        if (auto res = std::strchr(letters, static_cast<char>(*p)))
-            _value |= (1 << (res - letters));
-        ++p;
+    for (; *p; ++p) {
+        if (const int i = letterIndex(static_cast<char>(*p)); i > 0)
+            _value |= (1 << i);
     }
 }
 
@@ -63,6 +72,17 @@ RemotePermissions RemotePermissions::fromDbValue(const QByteArray &value)
 {
     if (value.isEmpty())
         return RemotePermissions();
+
+    // Rows written with toDbNumericValue() come back as the decimal string
+    // representation of the bitfield.
+    bool isNumeric = false;
+    const int numericValue = value.toInt(&isNumeric);
+    if (isNumeric) {
+        RemotePermissions perm;
+        perm._value = static_cast<quint16>(numericValue);
+        return perm;
+    }
+
     RemotePermissions perm;
     perm.fromArray(value.constData());
     return perm;
@@ -61,39 +61,50 @@ public:
     };
 
     /// null permissions
-    RemotePermissions() = default;
+    constexpr RemotePermissions() = default;
 
     /// array with one character per permission, "" is null, " " is non-null but empty
     QByteArray toDbValue() const;
 
+    /** compact form of toDbValue() for storage as an sqlite integer
+     *
+     * Small integers take one or two bytes per row instead of up to
+     * PermissionsCount text bytes. 0 is null.
+     */
+    constexpr quint16 toDbNumericValue() const { return _value; }
+
     /// output for display purposes, no defined format (same as toDbValue in practice)
     QString toString() const;
 
-    /// read value that was written with toDbValue()
+    /** read a value that was written with toDbValue() or toDbNumericValue()
+     *
+     * Values consisting only of digits are interpreted as the numeric
+     * encoding; the letter encoding never contains digits.
+     */
     static RemotePermissions fromDbValue(const QByteArray &);
 
     /// read a permissions string received from the server, never null
     static RemotePermissions fromServerString(const QString &);
 
-    bool hasPermission(Permissions p) const
+    constexpr bool hasPermission(Permissions p) const
     {
         return _value & (1 << static_cast<int>(p));
     }
-    void setPermission(Permissions p)
+    constexpr void setPermission(Permissions p)
     {
         _value |= (1 << static_cast<int>(p)) | notNullMask;
     }
-    void unsetPermission(Permissions p)
+    constexpr void unsetPermission(Permissions p)
     {
         _value &= ~(1 << static_cast<int>(p));
     }
 
-    bool isNull() const { return !(_value & notNullMask); }
-    friend bool operator==(RemotePermissions a, RemotePermissions b)
+    constexpr bool isNull() const { return !(_value & notNullMask); }
+    friend constexpr bool operator==(RemotePermissions a, RemotePermissions b)
     {
         return a._value == b._value;
     }
-    friend bool operator!=(RemotePermissions a, RemotePermissions b)
+    friend constexpr bool operator!=(RemotePermissions a, RemotePermissions b)
     {
         return !(a == b);
     }
@@ -19,14 +19,17 @@
 #include "common/syncjournaldb.h"
 
 #include "common/asserts.h"
-#include "common/c_jhash.h"
 #include "common/checksums.h"
 #include "common/filesystembase.h"
+#include "common/metrics.h"
+#include "common/pathhash.h"
 #include "common/preparedsqlquerymanager.h"
 #include "common/version.h"
+#include "common/watchdog.h"
 
 #include <QDir>
 #include <QElapsedTimer>
+#include <QtConcurrentRun>
 #include <QFile>
 #include <QLoggingCategory>
 #include <QStringList>
@@ -34,6 +37,8 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 Q_LOGGING_CATEGORY(lcDb, "sync.database", QtInfoMsg)
@@ -46,6 +51,9 @@ Q_LOGGING_CATEGORY(lcDb, "sync.database", QtInfoMsg)
     "(" path " == " prefix " OR " IS_PREFIX_PATH_OF(prefix, path) ")"
 
 namespace {
+// A journal read into the page cache this recently is still warm, skip the prefetch.
+constexpr auto journalPrefetchIntervalC = std::chrono::minutes(10);
+
 // base query used to select file record objects, used in combination with WHERE statements.
 const auto getFileRecordQueryC = QByteArrayLiteral("SELECT path, inode, modtime, type, md5, fileid, remotePerm, filesize,"
                                                    " ignoredChildrenRemote, contentchecksumtype.name || ':' || contentChecksum,"
@@ -99,6 +107,10 @@ SyncJournalDb::SyncJournalDb(const QString &dbFilePath, QObject *parent)
     , _transaction(0)
     , _metadataTableIsEmpty(false)
 {
+    // Allow tuning the record cache for debugging, size is in number of records
+    static int envCacheSize = qEnvironmentVariableIntValue("OWNCLOUD_SQLITE_RECORD_CACHE_SIZE");
+    _fileRecordCache.setMaxCost(envCacheSize > 0 ? envCacheSize : 50000);
+
     // Allow forcing the journal mode for debugging
     static QByteArray envJournalMode = qgetenv("OWNCLOUD_SQLITE_JOURNAL_MODE");
     _journalMode = envJournalMode;
@@ -166,17 +178,76 @@ QString SyncJournalDb::databaseFilePath() const
 // Note that this does not change the size of the -wal file, but it is supposed to make
 // the normal .db faster since the changes from the wal will be incorporated into it.
 // Then the next sync (and the SocketAPI) will have a faster access.
-void SyncJournalDb::walCheckpoint()
+void SyncJournalDb::walCheckpoint(CheckpointMode mode)
 {
+    QMutexLocker locker(&_mutex);
+    if (!_db.isOpen()) {
+        return;
+    }
+    QByteArray modeName;
+    switch (mode) {
+    case CheckpointMode::Passive:
+        modeName = "PASSIVE";
+        break;
+    case CheckpointMode::Full:
+        modeName = "FULL";
+        break;
+    case CheckpointMode::Truncate:
+        modeName = "TRUNCATE";
+        break;
+    }
     QElapsedTimer t;
     t.start();
     SqlQuery pragma1(_db);
-    pragma1.prepare("PRAGMA wal_checkpoint(FULL);");
+    pragma1.prepare("PRAGMA wal_checkpoint(" + modeName + ");");
     if (pragma1.exec()) {
-        qCDebug(lcDb) << "took" << t.elapsed() << "msec";
+        qCDebug(lcDb) << "wal_checkpoint(" << modeName << ") took" << t.elapsed() << "msec";
     }
 }
 
+Optional<SyncJournalDb::MaintenanceProgress> SyncJournalDb::maintenanceSlice(int pageBudget)
+{
+    QMutexLocker locker(&_mutex);
+    if (!_db.isOpen()) {
+        return {};
+    }
+
+    QElapsedTimer t;
+    t.start();
+
+    SqlQuery vacuum(_db);
+    vacuum.prepare("PRAGMA incremental_vacuum(" + QByteArray::number(pageBudget) + ");");
+    if (!vacuum.exec()) {
+        return {};
+    }
+    while (vacuum.next().hasData) {
+    }
+
+    SqlQuery freelist(_db);
+    freelist.prepare("PRAGMA freelist_count;");
+    if (!freelist.exec()) {
+        return {};
+    }
+
+    MaintenanceProgress progress;
+    if (freelist.next().hasData) {
+        progress.freePagesRemaining = freelist.intValue(0);
+    }
+    progress.done = progress.freePagesRemaining == 0;
+
+    if (progress.done) {
+        // Cheap, incremental re-analysis of whatever sqlite considers stale
+        SqlQuery optimize(_db);
+        optimize.prepare("PRAGMA optimize;");
+        optimize.exec();
+        while (optimize.next().hasData) {
+        }
+    }
+
+    qCDebug(lcDb) << "Maintenance slice took" << t.elapsed() << "msec," << progress.freePagesRemaining << "free pages remaining";
+    return progress;
+}
+
 void SyncJournalDb::startTransaction()
 {
     if (_transaction == 0) {
@@ -255,10 +326,18 @@ bool SyncJournalDb::checkConnect()
         qCInfo(lcDb) << "sqlite3 version" << pragma1.stringValue(0);
     }
 
-    // Set locking mode to avoid issues with WAL on Windows
+    // Set locking mode to avoid issues with WAL on Windows. On other
+    // platforms NORMAL locking is used so a second read-only connection can
+    // serve lookups concurrently, see getFileRecordFromReadConnection().
     static QByteArray locking_mode_env = qgetenv("OWNCLOUD_SQLITE_LOCKING_MODE");
-    if (locking_mode_env.isEmpty())
+    if (locking_mode_env.isEmpty()) {
+#ifdef Q_OS_WIN
         locking_mode_env = "EXCLUSIVE";
+#else
+        locking_mode_env = "NORMAL";
+#endif
+    }
+    _lockingMode = locking_mode_env;
     pragma1.prepare("PRAGMA locking_mode=" + locking_mode_env + ";");
     if (!pragma1.exec()) {
         return sqlFail(QStringLiteral("Set PRAGMA locking_mode"), pragma1);
@@ -302,6 +381,13 @@ bool SyncJournalDb::checkConnect()
         return sqlFail(QStringLiteral("Set PRAGMA case_sensitivity"), pragma1);
     }
 
+    // Keep freed pages on a freelist that maintenanceSlice() can release
+    // incrementally. Only takes effect when the database file is created.
+    pragma1.prepare("PRAGMA auto_vacuum = INCREMENTAL;");
+    if (!pragma1.exec()) {
+        return sqlFail(QStringLiteral("Set PRAGMA auto_vacuum"), pragma1);
+    }
+
     {
         // Future version of the client (2.6) will have an index 'metadata_parent' which
         // depends on a custom sqlite function which does not exist yet in 2.5.
@@ -320,8 +406,15 @@ bool SyncJournalDb::checkConnect()
                                     auto text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
                                     const char *end = std::strrchr(text, '/');
                                     if (!end) end = text;
-                                    sqlite3_result_int64(ctx, c_jhash64(reinterpret_cast<const uint8_t*>(text),
-                                                                        end - text, 0));
+                                    sqlite3_result_int64(ctx, pathHash64(text, end - text));
+                                }, nullptr, nullptr);
+
+    // Used to rehash the phash column when an old journal is opened, see
+    // the hashversion handling below.
+    sqlite3_create_function(_db.sqliteDb(), "path_hash", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                                [] (sqlite3_context *ctx,int, sqlite3_value **argv) {
+                                    auto text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+                                    sqlite3_result_int64(ctx, pathHash64(text, sqlite3_value_bytes(argv[0])));
                                 }, nullptr, nullptr);
 
     /* Because insert is so slow, we do everything in a transaction, and only need one call to commit */
@@ -377,6 +470,7 @@ bool SyncJournalDb::checkConnect()
                         "tmpfile VARCHAR(4096),"
                         "etag VARCHAR(32),"
                         "errorcount INTEGER,"
+                        "segments BLOB,"
                         "PRIMARY KEY(path)"
                         ");");
 
@@ -389,6 +483,32 @@ bool SyncJournalDb::checkConnect()
         return false;
     }
 
+    // per-chunk content hashes for delta uploads
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS contentchunks("
+                        "path VARCHAR(4096),"
+                        "offset INTEGER(8),"
+                        "size INTEGER(8),"
+                        "hash BLOB,"
+                        "PRIMARY KEY(path, offset)"
+                        ");");
+
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table contentchunks"), createQuery);
+    }
+
+    // content checksums of unchanged local files, reusable across paths
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS checksumcache("
+                        "inode INTEGER(8),"
+                        "size INTEGER(8),"
+                        "modtime INTEGER(8),"
+                        "checksum TEXT,"
+                        "PRIMARY KEY(inode)"
+                        ");");
+
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table checksumcache"), createQuery);
+    }
+
     // create the blacklist table.
     createQuery.prepare("CREATE TABLE IF NOT EXISTS blacklist ("
                         "path VARCHAR(4096),"
@@ -430,6 +550,29 @@ bool SyncJournalDb::checkConnect()
         return sqlFail(QStringLiteral("Create table datafingerprint"), createQuery);
     }
 
+    // create the keyvalue table.
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS keyvalue("
+                        "key TEXT PRIMARY KEY,"
+                        "value INTEGER"
+                        ");");
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table keyvalue"), createQuery);
+    }
+
+    // create the history table: completed-item summaries for the activity
+    // views. The implicit rowid is the paging cursor.
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS history("
+                        "timestamp INTEGER,"
+                        "path TEXT,"
+                        "size INTEGER,"
+                        "status INTEGER,"
+                        "direction INTEGER,"
+                        "message TEXT"
+                        ");");
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table history"), createQuery);
+    }
+
     // create the flags table.
     createQuery.prepare("CREATE TABLE IF NOT EXISTS flags ("
                         "path TEXT PRIMARY KEY,"
@@ -450,6 +593,16 @@ bool SyncJournalDb::checkConnect()
         return sqlFail(QStringLiteral("Create table conflicts"), createQuery);
     }
 
+    // create the vfsintents table: write-ahead log of placeholder state
+    // transitions, see setVfsIntent().
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS vfsintents("
+                        "path TEXT PRIMARY KEY,"
+                        "operation INTEGER"
+                        ");");
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table vfsintents"), createQuery);
+    }
+
     createQuery.prepare("CREATE TABLE IF NOT EXISTS version("
                         "major INTEGER(8),"
                         "minor INTEGER(8),"
@@ -461,20 +614,14 @@ bool SyncJournalDb::checkConnect()
     }
 
     bool forceRemoteDiscovery = false;
+    bool schemaIsCurrent = false;
 
     SqlQuery versionQuery("SELECT major, minor, patch FROM version;", _db);
     if (!versionQuery.next().hasData) {
+        // A fresh database. The version row is only written once the
+        // migrations below have completed, so an interrupted first run
+        // migrates again on the next connect.
         forceRemoteDiscovery = true;
-
-        createQuery.prepare("INSERT INTO version VALUES (?1, ?2, ?3, ?4);");
-        const auto segments = OCC::Version::versionWithBuildNumber().segments();
-        for (int i = 0; i < segments.size(); ++i) {
-            createQuery.bindValue(i + 1, segments[i]);
-        }
-        if (!createQuery.exec()) {
-            return sqlFail(QStringLiteral("Update version"), createQuery);
-        }
-
     } else {
         int major = versionQuery.intValue(0);
         int minor = versionQuery.intValue(1);
@@ -495,29 +642,85 @@ bool SyncJournalDb::checkConnect()
         }
 
         // Not comparing the BUILD id here, correct?
-        if (QVersionNumber(major, minor, patch) != OCC::Version::version()) {
-            createQuery.prepare("UPDATE version SET major=?1, minor=?2, patch =?3, custom=?4 "
-                                "WHERE major=?5 AND minor=?6 AND patch=?7;");
+        schemaIsCurrent = QVersionNumber(major, minor, patch) == OCC::Version::version();
+    }
+
+    // The phash primary key was computed with c_jhash64 until hash version
+    // 2 switched to pathHash64(). The path column is authoritative and
+    // phash derived from it, so an old journal is rehashed in place. OR
+    // REPLACE covers the astronomically unlikely case of a new hash
+    // colliding with a not-yet-rehashed row; the losing record is
+    // recovered by discovery.
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS hashversion(version INTEGER);");
+    if (!createQuery.exec()) {
+        return sqlFail(QStringLiteral("Create table hashversion"), createQuery);
+    }
+    SqlQuery hashVersionQuery("SELECT version FROM hashversion;", _db);
+    if (!hashVersionQuery.next().hasData || hashVersionQuery.intValue(0) < 2) {
+        qCInfo(lcDb) << "Rehashing the journal's phash column";
+        SqlQuery maxRowIdQuery("SELECT coalesce(max(rowid), 0) FROM metadata;", _db);
+        if (!maxRowIdQuery.next().hasData) {
+            return sqlFail(QStringLiteral("Read max metadata rowid"), maxRowIdQuery);
+        }
+        const qint64 maxRowId = static_cast<qint64>(maxRowIdQuery.int64Value(0));
+
+        // Rewrite the table in chunks, each committed on its own, instead of
+        // one transaction spanning the whole journal. A huge journal then
+        // never accumulates a giant transaction, the file lock is released
+        // between chunks, and observers see progress instead of a hang.
+        constexpr qint64 rehashChunkRows = 50000;
+        SqlQuery rehashQuery(_db);
+        rehashQuery.prepare("UPDATE OR REPLACE metadata SET phash = path_hash(path) WHERE rowid > ?1 AND rowid <= ?2;");
+        for (qint64 begin = 0; begin < maxRowId; begin += rehashChunkRows) {
+            rehashQuery.reset_and_clear_bindings();
+            rehashQuery.bindValue(1, begin);
+            rehashQuery.bindValue(2, begin + rehashChunkRows);
+            if (!rehashQuery.exec()) {
+                return sqlFail(QStringLiteral("Rehash metadata phash"), rehashQuery);
+            }
+            commitInternal(QStringLiteral("phash rehash chunk"));
+            Q_EMIT migrationProgress(QStringLiteral("rehash"), std::min(begin + rehashChunkRows, maxRowId), maxRowId);
+        }
+        rehashQuery.prepare("DELETE FROM hashversion;");
+        if (!rehashQuery.exec()) {
+            return sqlFail(QStringLiteral("Clear hashversion"), rehashQuery);
+        }
+        rehashQuery.prepare("INSERT INTO hashversion VALUES (2);");
+        if (!rehashQuery.exec()) {
+            return sqlFail(QStringLiteral("Update hashversion"), rehashQuery);
+        }
+    }
+
+    commitInternal(QStringLiteral("checkConnect"));
+
+    bool rc = true;
+    if (schemaIsCurrent) {
+        // Fast path: the version row is only advanced once this client
+        // version has completed its migrations, so a matching version means
+        // the column and index scans below have nothing left to do.
+        qCDebug(lcDb) << "Database schema is current, skipping migration scans";
+    } else {
+        rc = updateDatabaseStructure();
+        if (!rc) {
+            qCWarning(lcDb) << "Failed to update the database structure!";
+        } else {
+            // Record which client version completed the migrations; the fast
+            // path above checks against this on the next connect.
+            createQuery.prepare("DELETE FROM version;");
+            if (!createQuery.exec()) {
+                return sqlFail(QStringLiteral("Clear version"), createQuery);
+            }
+            createQuery.prepare("INSERT INTO version VALUES (?1, ?2, ?3, ?4);");
             const auto segments = OCC::Version::versionWithBuildNumber().segments();
             for (int i = 0; i < segments.size(); ++i) {
                 createQuery.bindValue(i + 1, segments[i]);
             }
-            createQuery.bindValue(5, major);
-            createQuery.bindValue(6, minor);
-            createQuery.bindValue(7, patch);
             if (!createQuery.exec()) {
                 return sqlFail(QStringLiteral("Update version"), createQuery);
             }
         }
     }
 
-    commitInternal(QStringLiteral("checkConnect"));
-
-    bool rc = updateDatabaseStructure();
-    if (!rc) {
-        qCWarning(lcDb) << "Failed to update the database structure!";
-    }
-
     /*
      * If we are upgrading from a client version older than 1.5,
      * we cannot read from the database because we need to fetch the files id and etags.
@@ -570,11 +773,21 @@ bool SyncJournalDb::checkConnect()
 
 void SyncJournalDb::close()
 {
+    // Let a pending asynchronous commit finish first, it takes the same mutex.
+    _asyncCommitFuture.waitForFinished();
+
     QMutexLocker locker(&_mutex);
     qCInfo(lcDb) << "Closing DB" << _dbFile;
 
+    flushFileRecordQueueLocked();
     commitTransaction();
     _db.close();
+    {
+        QMutexLocker readLocker(&_readMutex);
+        _readDb.close();
+        _readConnectionFailed = false;
+    }
+    _fileRecordCache.clear();
     clearEtagStorageFilter();
     _metadataTableIsEmpty = false;
     _closed = true;
@@ -590,11 +803,33 @@ bool SyncJournalDb::updateDatabaseStructure()
 {
     if (!updateMetadataTableStructure())
         return false;
+    if (!updateDownloadInfoTableStructure())
+        return false;
     if (!updateErrorBlacklistTableStructure())
         return false;
     return true;
 }
 
+bool SyncJournalDb::updateDownloadInfoTableStructure()
+{
+    const auto columns = tableColumns("downloadinfo");
+    if (columns.isEmpty()) {
+        return false;
+    }
+
+    bool re = true;
+    if (columns.indexOf("segments") == -1) {
+        SqlQuery query(_db);
+        query.prepare("ALTER TABLE downloadinfo ADD COLUMN segments BLOB;");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateDownloadInfoTableStructure: add column segments"), query);
+            re = false;
+        }
+        commitInternal(QStringLiteral("update database structure: add segments col"));
+    }
+    return re;
+}
+
 bool SyncJournalDb::updateMetadataTableStructure()
 {
     auto columns = tableColumns("metadata");
@@ -659,6 +894,39 @@ bool SyncJournalDb::updateMetadataTableStructure()
         commitInternal(QStringLiteral("update database structure: add path index"));
     }
 
+    {
+        // Covers subtree count and size aggregations entirely from the index,
+        // see countFilesBelowPath().
+        SqlQuery query(_db);
+        query.prepare("CREATE INDEX IF NOT EXISTS metadata_path_covering ON metadata(path, type, filesize);");
+        if (!query.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: create covering path index"), query);
+            re = false;
+        }
+        commitInternal(QStringLiteral("update database structure: add covering path index"));
+    }
+
+    {
+        // Partial indexes probed by hasHydratedOrDehydratedFiles(): whether a
+        // subtree contains hydrated (type 0/6) or dehydrated (type 4/5)
+        // entries becomes a first-row index lookup instead of a subtree scan.
+        // SQLite keeps them current on every write, so they act as the
+        // per-directory availability rollup.
+        SqlQuery hydratedIndex(_db);
+        hydratedIndex.prepare("CREATE INDEX IF NOT EXISTS metadata_path_hydrated ON metadata(path) WHERE type IN (0, 6);");
+        if (!hydratedIndex.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: create hydrated path index"), hydratedIndex);
+            re = false;
+        }
+        SqlQuery dehydratedIndex(_db);
+        dehydratedIndex.prepare("CREATE INDEX IF NOT EXISTS metadata_path_dehydrated ON metadata(path) WHERE type IN (4, 5);");
+        if (!dehydratedIndex.exec()) {
+            sqlFail(QStringLiteral("updateMetadataTableStructure: create dehydrated path index"), dehydratedIndex);
+            re = false;
+        }
+        commitInternal(QStringLiteral("update database structure: add availability rollup indexes"));
+    }
+
     {
         SqlQuery query(_db);
         query.prepare("CREATE INDEX IF NOT EXISTS metadata_parent ON metadata(parent_hash(path));");
@@ -824,18 +1092,13 @@ QVector<QByteArray> SyncJournalDb::tableColumns(const QByteArray &table)
 
 qint64 SyncJournalDb::getPHash(const QByteArray &file)
 {
-    qint64 h;
-    int len = file.length();
-
-    h = c_jhash64((uint8_t *)file.data(), len, 0);
-    return h;
+    // Must match the path_hash sqlite function and the hashversion
+    // migration in checkConnect().
+    return static_cast<qint64>(pathHash64(file.constData(), static_cast<size_t>(file.length())));
 }
 
-Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &_record)
+void SyncJournalDb::applyEtagStorageFilter(SyncJournalFileRecord &record)
 {
-    SyncJournalFileRecord record = _record;
-    QMutexLocker locker(&_mutex);
-
     if (!_etagStorageFilter.isEmpty()) {
         // If we are a directory that should not be read from db next time, don't write the etag
         QByteArray prefix = record._path + "/";
@@ -847,12 +1110,31 @@ Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &
             }
         }
     }
+}
+
+Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &_record)
+{
+    SyncJournalFileRecord record = _record;
+    QMutexLocker locker(&_mutex);
+
+    applyEtagStorageFilter(record);
     OC_ASSERT(!record._remotePerm.isNull());
     qCInfo(lcDb) << "Updating file record for path:" << record._path << "inode:" << record._inode
                  << "modtime:" << record._modtime << "type:" << record._type
                  << "etag:" << record._etag << "fileId:" << record._fileId << "remotePerm:" << record._remotePerm.toString()
                  << "fileSize:" << record._fileSize << "checksum:" << record._checksumHeader << "hasDirtyPlaceholder:" << record._hasDirtyPlaceholder;
 
+    if (_writeBatchingEnabled) {
+        _fileRecordQueue.append(record);
+        _fileRecordCache.insert(getPHash(record._path), new SyncJournalFileRecord(record));
+        // The queued record will be written out, the table can't stay empty.
+        _metadataTableIsEmpty = false;
+        if (_fileRecordQueue.size() >= 500) {
+            return flushFileRecordQueueLocked();
+        }
+        return {};
+    }
+
     const qint64 phash = getPHash(record._path);
     if (checkConnect()) {
         int plen = record._path.length();
@@ -863,7 +1145,7 @@ Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &
         QByteArray fileId(record._fileId);
         if (fileId.isEmpty())
             fileId = "";
-        QByteArray remotePerm = record._remotePerm.toDbValue();
+        const int remotePerm = record._remotePerm.toDbNumericValue();
 
         const auto checksumHeader = ChecksumHeader::parseChecksumHeader(record._checksumHeader);
         int contentChecksumTypeId = mapChecksumType(checksumHeader.type());
@@ -897,6 +1179,8 @@ Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &
             return query->error();
         }
 
+        _fileRecordCache.insert(phash, new SyncJournalFileRecord(record));
+
         // Can't be true anymore.
         _metadataTableIsEmpty = false;
 
@@ -907,12 +1191,146 @@ Result<void, QString> SyncJournalDb::setFileRecord(const SyncJournalFileRecord &
     }
 }
 
+namespace {
+    // 17 bind variables per metadata row; sqlite's default SQLITE_MAX_VARIABLE_NUMBER is 999.
+    const int maxRecordsPerStatement = 50;
+
+    QByteArray composeSetFileRecordsSql(int rowCount)
+    {
+        QByteArray sql = QByteArrayLiteral("INSERT OR REPLACE INTO metadata "
+                                           "(phash, pathlen, path, inode, uid, gid, mode, modtime, type, md5, fileid, remotePerm, filesize, ignoredChildrenRemote, contentChecksum, contentChecksumTypeId, hasDirtyPlaceholder) "
+                                           "VALUES ");
+        for (int row = 0; row < rowCount; ++row) {
+            if (row > 0) {
+                sql += ',';
+            }
+            sql += '(';
+            for (int col = 0; col < 17; ++col) {
+                if (col > 0) {
+                    sql += ',';
+                }
+                sql += '?';
+                sql += QByteArray::number(row * 17 + col + 1);
+            }
+            sql += ')';
+        }
+        sql += ';';
+        return sql;
+    }
+}
+
+Result<void, QString> SyncJournalDb::setFileRecords(const QVector<SyncJournalFileRecord> &records)
+{
+    QMutexLocker locker(&_mutex);
+
+    QVector<SyncJournalFileRecord> filtered = records;
+    for (auto &record : filtered) {
+        applyEtagStorageFilter(record);
+    }
+    return setFileRecordsInternal(filtered);
+}
+
+Result<void, QString> SyncJournalDb::setFileRecordsInternal(const QVector<SyncJournalFileRecord> &records)
+{
+    if (records.isEmpty()) {
+        return {};
+    }
+
+    if (!checkConnect()) {
+        qCWarning(lcDb) << "Failed to connect database.";
+        return tr("Failed to connect database."); // checkConnect failed.
+    }
+
+    qCInfo(lcDb) << "Writing" << records.size() << "file records in batches of" << maxRecordsPerStatement;
+
+    for (int start = 0; start < records.size(); start += maxRecordsPerStatement) {
+        const int rowCount = qMin(maxRecordsPerStatement, records.size() - start);
+        SqlQuery query(_db);
+        if (query.prepare(composeSetFileRecordsSql(rowCount)) != SQLITE_OK) {
+            return query.error();
+        }
+        for (int row = 0; row < rowCount; ++row) {
+            const SyncJournalFileRecord &record = records.at(start + row);
+            OC_ASSERT(!record._remotePerm.isNull());
+
+            QByteArray etag(record._etag);
+            if (etag.isEmpty())
+                etag = "";
+            QByteArray fileId(record._fileId);
+            if (fileId.isEmpty())
+                fileId = "";
+            const auto checksumHeader = ChecksumHeader::parseChecksumHeader(record._checksumHeader);
+
+            const int base = row * 17;
+            query.bindValue(base + 1, getPHash(record._path));
+            query.bindValue(base + 2, record._path.length());
+            query.bindValue(base + 3, record._path);
+            query.bindValue(base + 4, record._inode);
+            query.bindValue(base + 5, 0); // uid Not used
+            query.bindValue(base + 6, 0); // gid Not used
+            query.bindValue(base + 7, 0); // mode Not used
+            query.bindValue(base + 8, record._modtime);
+            query.bindValue(base + 9, record._type);
+            query.bindValue(base + 10, etag);
+            query.bindValue(base + 11, fileId);
+            query.bindValue(base + 12, static_cast<int>(record._remotePerm.toDbNumericValue()));
+            query.bindValue(base + 13, record._fileSize);
+            query.bindValue(base + 14, record._serverHasIgnoredFiles ? 1 : 0);
+            query.bindValue(base + 15, checksumHeader.checksum());
+            query.bindValue(base + 16, mapChecksumType(checksumHeader.type()));
+            query.bindValue(base + 17, record._hasDirtyPlaceholder);
+        }
+        if (!query.exec()) {
+            return query.error();
+        }
+
+        for (int row = 0; row < rowCount; ++row) {
+            const SyncJournalFileRecord &record = records.at(start + row);
+            _fileRecordCache.insert(getPHash(record._path), new SyncJournalFileRecord(record));
+        }
+    }
+
+    // Can't be true anymore.
+    _metadataTableIsEmpty = false;
+
+    return {};
+}
+
+Result<void, QString> SyncJournalDb::setWriteBatchingEnabled(bool enabled)
+{
+    QMutexLocker locker(&_mutex);
+    _writeBatchingEnabled = enabled;
+    if (!enabled) {
+        return flushFileRecordQueueLocked();
+    }
+    return {};
+}
+
+Result<void, QString> SyncJournalDb::flushFileRecordQueue()
+{
+    QMutexLocker locker(&_mutex);
+    return flushFileRecordQueueLocked();
+}
+
+Result<void, QString> SyncJournalDb::flushFileRecordQueueLocked()
+{
+    if (_fileRecordQueue.isEmpty()) {
+        return {};
+    }
+
+    // The etag storage filter was already applied when the records were queued.
+    const auto result = setFileRecordsInternal(_fileRecordQueue);
+    _fileRecordQueue.clear();
+    return result;
+}
+
 // TODO: filename -> QBytearray?
 bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
 {
     QMutexLocker locker(&_mutex);
 
     if (checkConnect()) {
+        flushFileRecordQueueLocked();
         // if (!recursively) {
         // always delete the actual file.
 
@@ -928,6 +1346,7 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
             if (!query->exec()) {
                 return false;
             }
+            _fileRecordCache.remove(phash);
         }
 
         if (recursively) {
@@ -938,6 +1357,8 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
             if (!query->exec()) {
                 return false;
             }
+            // We don't know which cached paths are below the deleted directory.
+            _fileRecordCache.clear();
         }
         return true;
     } else {
@@ -949,26 +1370,50 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
 
 bool SyncJournalDb::getFileRecord(const QByteArray &filename, SyncJournalFileRecord *rec)
 {
-    QMutexLocker locker(&_mutex);
-
     // Reset the output var in case the caller is reusing it.
     Q_ASSERT(rec);
     rec->_path.clear();
     Q_ASSERT(!rec->isValid());
 
+    if (!_mutex.tryLock()) {
+        // Another thread (usually the propagator committing writes) holds the
+        // main connection. Try to answer the lookup from the read-only
+        // connection instead of blocking.
+        if (const auto result = getFileRecordFromReadConnection(filename, rec)) {
+            return *result;
+        }
+    } else {
+        _mutex.unlock();
+    }
+    QMutexLocker locker(&_mutex);
+
     if (_metadataTableIsEmpty)
         return true; // no error, yet nothing found (rec->isValid() == false)
 
     if (!checkConnect())
         return false;
 
+    flushFileRecordQueueLocked();
+
     if (!filename.isEmpty()) {
+        // The hit rate is hits / (hits + misses), see common/metrics.h
+        static Metrics::Counter cacheHits("journal.fileRecordCacheHits");
+        static Metrics::Counter cacheMisses("journal.fileRecordCacheMisses");
+
+        const qint64 phash = getPHash(filename);
+        if (const SyncJournalFileRecord *cached = _fileRecordCache.object(phash)) {
+            cacheHits.add();
+            *rec = *cached;
+            return true;
+        }
+        cacheMisses.add();
+
         const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordQuery, getFileRecordQueryC + QByteArrayLiteral("WHERE phash=?1"), _db);
         if (!query) {
             return false;
         }
 
-        query->bindValue(1, getPHash(filename));
+        query->bindValue(1, phash);
 
         if (!query->exec()) {
             close();
@@ -984,6 +1429,59 @@ bool SyncJournalDb::getFileRecord(const QByteArray &filename, SyncJournalFileRec
         }
         if (next.hasData) {
             fillFileRecordFromGetQuery(*rec, *query);
+            if (rec->_path != filename) {
+                // The phash only preselects, see pathHash64(). A different
+                // stored path is a collision: report "not found".
+                qCWarning(lcDb) << "phash collision between" << filename << "and" << rec->_path;
+                *rec = SyncJournalFileRecord();
+                return true;
+            }
+            _fileRecordCache.insert(phash, new SyncJournalFileRecord(*rec));
+        }
+    }
+    return true;
+}
+
+Optional<bool> SyncJournalDb::getFileRecordFromReadConnection(const QByteArray &filename, SyncJournalFileRecord *rec)
+{
+    // Records queued for batch writing are invisible to a second connection.
+    if (_writeBatchingEnabled) {
+        return {};
+    }
+
+    QMutexLocker locker(&_readMutex);
+    if (!_readDb.isOpen()) {
+        // In EXCLUSIVE locking mode, or without WAL, a second connection
+        // cannot read while the main connection holds its locks.
+        if (_readConnectionFailed || _journalMode != "WAL" || _lockingMode == "EXCLUSIVE") {
+            return {};
+        }
+        if (!_readDb.openReadOnly(_dbFile)) {
+            qCInfo(lcDb) << "Could not open read-only connection, falling back to the main connection" << _readDb.error();
+            _readConnectionFailed = true;
+            return {};
+        }
+    }
+
+    const auto query = _readQueryManager.get(PreparedSqlQueryManager::GetFileRecordQuery, getFileRecordQueryC + QByteArrayLiteral("WHERE phash=?1"), _readDb);
+    if (!query) {
+        return {};
+    }
+    query->bindValue(1, getPHash(filename));
+    if (!query->exec()) {
+        // Likely SQLITE_BUSY, let the caller take the main connection.
+        return {};
+    }
+    auto next = query->next();
+    if (!next.ok) {
+        return {};
+    }
+    if (next.hasData) {
+        fillFileRecordFromGetQuery(*rec, *query);
+        if (rec->_path != filename) {
+            // See the collision check in getFileRecord().
+            qCWarning(lcDb) << "phash collision between" << filename << "and" << rec->_path;
+            *rec = SyncJournalFileRecord();
         }
     }
     return true;
@@ -1003,6 +1501,9 @@ bool SyncJournalDb::getFileRecordByInode(quint64 inode, SyncJournalFileRecord *r
 
     if (!checkConnect())
         return false;
+
+    flushFileRecordQueueLocked();
+
     const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordQueryByInode, getFileRecordQueryC + QByteArrayLiteral("WHERE inode=?1"), _db);
     if (!query)
         return false;
@@ -1031,6 +1532,8 @@ bool SyncJournalDb::getFileRecordsByFileId(const QByteArray &fileId, const std::
     if (!checkConnect())
         return false;
 
+    flushFileRecordQueueLocked();
+
     const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordQueryByFileId, getFileRecordQueryC + QByteArrayLiteral("WHERE fileid=?1"), _db);
     if (!query) {
         return false;
@@ -1057,64 +1560,130 @@ bool SyncJournalDb::getFileRecordsByFileId(const QByteArray &fileId, const std::
 }
 
 bool SyncJournalDb::getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback)
+{
+    FileRecordCursor cursor = filesBelowPathCursor(path);
+    while (cursor.next()) {
+        rowCallback(cursor.record());
+    }
+    return cursor.ok();
+}
+
+SyncJournalDb::FileRecordCursor SyncJournalDb::filesBelowPathCursor(const QByteArray &path)
+{
+    return FileRecordCursor(this, path);
+}
+
+Optional<qint64> SyncJournalDb::countFilesBelowPath(const QByteArray &path)
 {
     QMutexLocker locker(&_mutex);
 
     if (_metadataTableIsEmpty)
-        return true; // no error, yet nothing found
+        return 0;
 
     if (!checkConnect())
-        return false;
+        return {};
 
-    auto _exec = [&rowCallback](SqlQuery &query) {
-        if (!query.exec()) {
-            return false;
-        }
+    flushFileRecordQueueLocked();
 
-        while (true) {
-            auto next = query.next();
-            if (!next.ok)
-                return false;
-            if (!next.hasData)
-                break;
+    const auto query = _queryManager.get(PreparedSqlQueryManager::CountFilesBelowPathQuery,
+        QByteArrayLiteral("SELECT COUNT(*) FROM metadata WHERE " IS_PREFIX_PATH_OF("?1", "path") " OR ?1 == ''"), _db);
+    if (!query) {
+        return {};
+    }
+    query->bindValue(1, path);
+    if (!query->exec()) {
+        return {};
+    }
+    if (!query->next().hasData) {
+        return {};
+    }
+    return static_cast<qint64>(query->int64Value(0));
+}
 
-            SyncJournalFileRecord rec;
-            fillFileRecordFromGetQuery(rec, query);
-            rowCallback(rec);
-        }
-        return true;
-    };
+SyncJournalDb::FileRecordCursor::FileRecordCursor(SyncJournalDb *db, const QByteArray &path)
+    : _db(db)
+{
+    _db->_mutex.lock();
 
-    if(path.isEmpty()) {
-        // Since the path column doesn't store the starting /, the getFilesBelowPathQuery
-        // can't be used for the root path "". It would scan for (path > '/' and path < '0')
-        // and find nothing. So, unfortunately, we have to use a different query for
-        // retrieving the whole tree.
+    if (_db->_metadataTableIsEmpty) {
+        // An empty scan, not an error: next() will return false right away.
+        _ok = true;
+        return;
+    }
 
-        const auto query = _queryManager.get(PreparedSqlQueryManager::GetAllFilesQuery, getFileRecordQueryC + QByteArrayLiteral("ORDER BY path||'/' ASC"), _db);
-        if (!query) {
-            return false;
-        }
-        return _exec(*query);
+    if (!_db->checkConnect()) {
+        return;
+    }
+
+    _db->flushFileRecordQueueLocked();
+
+    _query.reset(new SqlQuery(_db->_db));
+    if (path.isEmpty()) {
+        // Since the path column doesn't store the starting /, the prefix query
+        // can't be used for the root path "". It would scan for (path > '/' and
+        // path < '0') and find nothing. So, unfortunately, we have to use a
+        // different query for retrieving the whole tree.
+        _query->prepare(getFileRecordQueryC + QByteArrayLiteral("ORDER BY path||'/' ASC"));
     } else {
         // This query is used to skip discovery and fill the tree from the
-        // database instead
-        const auto query = _queryManager.get(PreparedSqlQueryManager::GetFilesBelowPathQuery, getFileRecordQueryC + QByteArrayLiteral("WHERE " IS_PREFIX_PATH_OF("?1", "path")
-                                                                                                  // We want to ensure that the contents of a directory are sorted
-                                                                                                  // directly behind the directory itself. Without this ORDER BY
-                                                                                                  // an ordering like foo, foo-2, foo/file would be returned.
-                                                                                                  // With the trailing /, we get foo-2, foo, foo/file. This property
-                                                                                                  // is used in fill_tree_from_db().
-                                                                                                  " ORDER BY path||'/' ASC"),
-            _db);
-        if (!query) {
-            return false;
-        }
-        query->bindValue(1, path);
-        return _exec(*query);
+        // database instead.
+        // We want to ensure that the contents of a directory are sorted
+        // directly behind the directory itself. Without this ORDER BY
+        // an ordering like foo, foo-2, foo/file would be returned.
+        // With the trailing /, we get foo-2, foo, foo/file. This property
+        // is used in fill_tree_from_db().
+        _query->prepare(getFileRecordQueryC + QByteArrayLiteral("WHERE " IS_PREFIX_PATH_OF("?1", "path") " ORDER BY path||'/' ASC"));
+        _query->bindValue(1, path);
+    }
+
+    if (!_query->exec()) {
+        _query.reset();
+        return;
+    }
+    _ok = true;
+}
+
+SyncJournalDb::FileRecordCursor::FileRecordCursor(FileRecordCursor &&other) noexcept
+    : _db(other._db)
+    , _query(std::move(other._query))
+    , _record(std::move(other._record))
+    , _ok(other._ok)
+{
+    other._db = nullptr;
+}
+
+SyncJournalDb::FileRecordCursor::~FileRecordCursor()
+{
+    if (_db) {
+        _db->_mutex.unlock();
     }
 }
 
+bool SyncJournalDb::FileRecordCursor::next()
+{
+    if (!_ok || !_query) {
+        return false;
+    }
+    const auto result = _query->next();
+    if (!result.ok) {
+        _ok = false;
+        return false;
+    }
+    if (!result.hasData) {
+        return false;
+    }
+    fillFileRecordFromGetQuery(_record, *_query);
+    return true;
+}
+
+qint64 SyncJournalDb::fileRecordCacheEstimatedBytes() const
+{
+    // Insertions use the default cost of 1, so totalCost() is the record
+    // count. ~128 bytes covers the typical path, etag and checksum payload.
+    QMutexLocker locker(&_mutex);
+    return qint64(_fileRecordCache.totalCost()) * qint64(sizeof(SyncJournalFileRecord) + 128);
+}
+
 bool SyncJournalDb::listFilesInPath(const QByteArray& path,
                                     const std::function<void (const SyncJournalFileRecord &)>& rowCallback)
 {
@@ -1126,6 +1695,8 @@ bool SyncJournalDb::listFilesInPath(const QByteArray& path,
     if (!checkConnect())
         return false;
 
+    flushFileRecordQueueLocked();
+
     const auto query = _queryManager.get(PreparedSqlQueryManager::ListFilesInPathQuery, getFileRecordQueryC + QByteArrayLiteral("WHERE parent_hash(path) = ?1 ORDER BY path||'/' ASC"), _db);
     if (!query) {
         return false;
@@ -1154,6 +1725,45 @@ bool SyncJournalDb::listFilesInPath(const QByteArray& path,
     return true;
 }
 
+bool SyncJournalDb::getFileRecordsAfterPath(const QByteArray &afterPath, int limit,
+    const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_metadataTableIsEmpty)
+        return true;
+
+    if (!checkConnect())
+        return false;
+
+    flushFileRecordQueueLocked();
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetFileRecordsAfterPathQuery,
+        getFileRecordQueryC + QByteArrayLiteral("WHERE path > ?1 ORDER BY path ASC LIMIT ?2"), _db);
+    if (!query) {
+        return false;
+    }
+    query->bindValue(1, afterPath);
+    query->bindValue(2, limit);
+
+    if (!query->exec())
+        return false;
+
+    while (true) {
+        auto next = query->next();
+        if (!next.ok)
+            return false;
+        if (!next.hasData)
+            break;
+
+        SyncJournalFileRecord rec;
+        fillFileRecordFromGetQuery(rec, *query);
+        rowCallback(rec);
+    }
+
+    return true;
+}
+
 int SyncJournalDb::getFileRecordCount()
 {
     QMutexLocker locker(&_mutex);
@@ -1187,6 +1797,8 @@ bool SyncJournalDb::updateFileRecordChecksum(const QString &filename,
         return false;
     }
 
+    flushFileRecordQueueLocked();
+
     int checksumTypeId = mapChecksumType(contentChecksumType);
 
     const auto query = _queryManager.get(PreparedSqlQueryManager::SetFileRecordChecksumQuery, QByteArrayLiteral("UPDATE metadata"
@@ -1199,6 +1811,7 @@ bool SyncJournalDb::updateFileRecordChecksum(const QString &filename,
     query->bindValue(1, phash);
     query->bindValue(2, contentChecksum);
     query->bindValue(3, checksumTypeId);
+    _fileRecordCache.remove(phash);
     return query->exec();
 }
 
@@ -1208,8 +1821,16 @@ Optional<SyncJournalDb::HasHydratedDehydrated> SyncJournalDb::hasHydratedOrDehyd
     if (!checkConnect())
         return {};
 
-    const auto query = _queryManager.get(PreparedSqlQueryManager::CountDehydratedFilesQuery, QByteArrayLiteral("SELECT DISTINCT type FROM metadata"
-                                                                                                               " WHERE (" IS_PREFIX_PATH_OR_EQUAL("?1", "path") " OR ?1 == '');"),
+    flushFileRecordQueueLocked();
+
+    // Both EXISTS probes are first-row lookups on the metadata_path_hydrated
+    // and metadata_path_dehydrated partial indexes, so the answer comes from
+    // one row per probe instead of a scan over the whole subtree. Hydrated
+    // entries are ItemTypeFile and ItemTypeVirtualFileDehydration, dehydrated
+    // ones ItemTypeVirtualFile and ItemTypeVirtualFileDownload.
+    const auto query = _queryManager.get(PreparedSqlQueryManager::CountDehydratedFilesQuery,
+        QByteArrayLiteral("SELECT EXISTS(SELECT 1 FROM metadata WHERE (" IS_PREFIX_PATH_OR_EQUAL("?1", "path") " OR ?1 == '') AND type IN (0, 6)),"
+                          " EXISTS(SELECT 1 FROM metadata WHERE (" IS_PREFIX_PATH_OR_EQUAL("?1", "path") " OR ?1 == '') AND type IN (4, 5));"),
         _db);
     if (!query) {
         return {};
@@ -1219,20 +1840,13 @@ Optional<SyncJournalDb::HasHydratedDehydrated> SyncJournalDb::hasHydratedOrDehyd
     if (!query->exec())
         return {};
 
-    HasHydratedDehydrated result;
-    while (true) {
-        auto next = query->next();
-        if (!next.ok)
-            return {};
-        if (!next.hasData)
-            break;
-        auto type = static_cast<ItemType>(query->intValue(0));
-        if (type == ItemTypeFile || type == ItemTypeVirtualFileDehydration)
-            result.hasHydrated = true;
-        if (type == ItemTypeVirtualFile || type == ItemTypeVirtualFileDownload)
-            result.hasDehydrated = true;
-    }
+    auto next = query->next();
+    if (!next.ok || !next.hasData)
+        return {};
 
+    HasHydratedDehydrated result;
+    result.hasHydrated = query->intValue(0) != 0;
+    result.hasDehydrated = query->intValue(1) != 0;
     return result;
 }
 
@@ -1242,6 +1856,7 @@ static void toDownloadInfo(SqlQuery &query, SyncJournalDb::DownloadInfo *res)
     res->_tmpfile = query.stringValue(0);
     res->_etag = query.baValue(1);
     res->_errorCount = query.intValue(2);
+    res->_segments = query.baValue(3);
     res->_valid = ok;
 }
 
@@ -1270,7 +1885,7 @@ SyncJournalDb::DownloadInfo SyncJournalDb::getDownloadInfo(const QString &file)
     DownloadInfo res;
 
     if (checkConnect()) {
-        const auto query = _queryManager.get(PreparedSqlQueryManager::GetDownloadInfoQuery, QByteArrayLiteral("SELECT tmpfile, etag, errorcount FROM downloadinfo WHERE path=?1"), _db);
+        const auto query = _queryManager.get(PreparedSqlQueryManager::GetDownloadInfoQuery, QByteArrayLiteral("SELECT tmpfile, etag, errorcount, segments FROM downloadinfo WHERE path=?1"), _db);
         if (!query) {
             return res;
         }
@@ -1299,8 +1914,8 @@ void SyncJournalDb::setDownloadInfo(const QString &file, const SyncJournalDb::Do
 
     if (i._valid) {
         const auto query = _queryManager.get(PreparedSqlQueryManager::SetDownloadInfoQuery, QByteArrayLiteral("INSERT OR REPLACE INTO downloadinfo "
-                                                                                                              "(path, tmpfile, etag, errorcount) "
-                                                                                                              "VALUES ( ?1 , ?2, ?3, ?4 )"),
+                                                                                                              "(path, tmpfile, etag, errorcount, segments) "
+                                                                                                              "VALUES ( ?1 , ?2, ?3, ?4, ?5 )"),
             _db);
         if (!query) {
             return;
@@ -1309,6 +1924,7 @@ void SyncJournalDb::setDownloadInfo(const QString &file, const SyncJournalDb::Do
         query->bindValue(2, i._tmpfile);
         query->bindValue(3, i._etag);
         query->bindValue(4, i._errorCount);
+        query->bindValue(5, i._segments);
         query->exec();
     } else {
         const auto query = _queryManager.get(PreparedSqlQueryManager::DeleteDownloadInfoQuery);
@@ -1331,14 +1947,14 @@ QVector<SyncJournalDb::DownloadInfo> SyncJournalDb::getAndDeleteStaleDownloadInf
     {
         SqlQuery query(_db);
         // The selected values *must* match the ones expected by toDownloadInfo().
-        query.prepare("SELECT tmpfile, etag, errorcount, path FROM downloadinfo");
+        query.prepare("SELECT tmpfile, etag, errorcount, segments, path FROM downloadinfo");
 
         if (!query.exec()) {
             return empty_result;
         }
 
         while (query.next().hasData) {
-            const QString file = query.stringValue(3); // path
+            const QString file = query.stringValue(4); // path
             if (!keep.contains(file)) {
                 superfluousPaths.append(file);
                 DownloadInfo info;
@@ -1482,6 +2098,105 @@ void SyncJournalDb::setUploadInfo(const QString &file, const SyncJournalDb::Uplo
     }
 }
 
+QVector<ContentChunk> SyncJournalDb::getContentChunks(const QString &file)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!checkConnect()) {
+        return {};
+    }
+
+    SqlQuery query(_db);
+    query.prepare("SELECT offset, size, hash FROM contentchunks WHERE path=?1 ORDER BY offset");
+    query.bindValue(1, file);
+
+    if (!query.exec()) {
+        return {};
+    }
+
+    QVector<ContentChunk> res;
+    while (query.next().hasData) {
+        ContentChunk chunk;
+        chunk.offset = query.int64Value(0);
+        chunk.size = query.int64Value(1);
+        chunk.hash = query.baValue(2);
+        res.append(chunk);
+    }
+    return res;
+}
+
+void SyncJournalDb::setContentChunks(const QString &file, const QVector<ContentChunk> &chunks)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!checkConnect()) {
+        return;
+    }
+
+    // The chunk list of a new revision replaces the old one wholesale.
+    SqlQuery deleteQuery(_db);
+    deleteQuery.prepare("DELETE FROM contentchunks WHERE path=?1");
+    deleteQuery.bindValue(1, file);
+    if (!deleteQuery.exec()) {
+        return;
+    }
+
+    SqlQuery insertQuery(_db);
+    insertQuery.prepare("INSERT INTO contentchunks (path, offset, size, hash) VALUES (?1, ?2, ?3, ?4)");
+    for (const auto &chunk : chunks) {
+        insertQuery.reset_and_clear_bindings();
+        insertQuery.bindValue(1, file);
+        insertQuery.bindValue(2, chunk.offset);
+        insertQuery.bindValue(3, chunk.size);
+        insertQuery.bindValue(4, chunk.hash);
+        if (!insertQuery.exec()) {
+            return;
+        }
+    }
+}
+
+QByteArray SyncJournalDb::checksumCacheEntry(quint64 inode, qint64 size, qint64 modtime)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (inode == 0 || !checkConnect()) {
+        return QByteArray();
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetChecksumCacheQuery,
+        QByteArrayLiteral("SELECT checksum FROM checksumcache WHERE inode=?1 AND size=?2 AND modtime=?3"), _db);
+    if (!query) {
+        return QByteArray();
+    }
+    query->bindValue(1, inode);
+    query->bindValue(2, size);
+    query->bindValue(3, modtime);
+    if (!query->exec() || !query->next().hasData) {
+        return QByteArray();
+    }
+    return query->baValue(0);
+}
+
+void SyncJournalDb::setChecksumCacheEntry(quint64 inode, qint64 size, qint64 modtime, const QByteArray &checksumHeader)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (inode == 0 || checksumHeader.isEmpty() || !checkConnect()) {
+        return;
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::SetChecksumCacheQuery,
+        QByteArrayLiteral("INSERT OR REPLACE INTO checksumcache (inode, size, modtime, checksum) VALUES (?1, ?2, ?3, ?4);"), _db);
+    if (!query) {
+        return;
+    }
+    query->bindValue(1, inode);
+    query->bindValue(2, size);
+    query->bindValue(3, modtime);
+    query->bindValue(4, checksumHeader);
+    query->exec();
+}
+
 QVector<uint> SyncJournalDb::deleteStaleUploadInfos(const QSet<QString> &keep)
 {
     QMutexLocker locker(&_mutex);
@@ -1544,6 +2259,39 @@ SyncJournalErrorBlacklistRecord SyncJournalDb::errorBlacklistEntry(const QString
     return entry;
 }
 
+QHash<QString, SyncJournalErrorBlacklistRecord> SyncJournalDb::errorBlacklistMap()
+{
+    QMutexLocker locker(&_mutex);
+    QHash<QString, SyncJournalErrorBlacklistRecord> entries;
+
+    if (!checkConnect()) {
+        return entries;
+    }
+
+    SqlQuery query(_db);
+    query.prepare("SELECT path, lastTryEtag, lastTryModtime, retrycount, errorstring, lastTryTime, ignoreDuration, renameTarget, errorCategory, requestId "
+                  "FROM blacklist");
+    if (!query.exec()) {
+        return entries;
+    }
+
+    while (query.next().hasData) {
+        SyncJournalErrorBlacklistRecord entry;
+        entry._file = query.stringValue(0);
+        entry._lastTryEtag = query.baValue(1);
+        entry._lastTryModtime = query.int64Value(2);
+        entry._retryCount = query.intValue(3);
+        entry._errorString = query.stringValue(4);
+        entry._lastTryTime = query.int64Value(5);
+        entry._ignoreDuration = query.int64Value(6);
+        entry._renameTarget = query.stringValue(7);
+        entry._errorCategory = static_cast<SyncJournalErrorBlacklistRecord::Category>(query.intValue(8));
+        entry._requestId = query.baValue(9);
+        entries.insert(entry._file, entry);
+    }
+    return entries;
+}
+
 bool SyncJournalDb::deleteStaleErrorBlacklistEntries(const QSet<QString> &keep)
 {
     QMutexLocker locker(&_mutex);
@@ -1787,6 +2535,7 @@ void SyncJournalDb::avoidRenamesOnNextSync(const QByteArray &path)
     query.prepare("UPDATE metadata SET fileid = '', inode = '0' WHERE " IS_PREFIX_PATH_OR_EQUAL("?1", "path"));
     query.bindValue(1, path);
     query.exec();
+    _fileRecordCache.clear();
 
     // We also need to remove the ETags so the update phase refreshes the directory paths
     // on the next sync
@@ -1812,11 +2561,13 @@ void SyncJournalDb::schedulePathForRemoteDiscovery(const QByteArray &fileName)
     query.prepare("UPDATE metadata SET md5='_invalid_' WHERE " IS_PREFIX_PATH_OR_EQUAL("path", "?1") " AND type == 2;");
     query.bindValue(1, argument);
     query.exec();
+    _fileRecordCache.clear();
 
     // Prevent future overwrite of the etags of this folder and all
     // parent folders for this sync
     argument.append('/');
     _etagStorageFilter.append(argument);
+    _remoteDiscoveryForced = true;
 }
 
 void SyncJournalDb::clearEtagStorageFilter()
@@ -1835,12 +2586,22 @@ void SyncJournalDb::forceRemoteDiscoveryNextSync()
     forceRemoteDiscoveryNextSyncLocked();
 }
 
+bool SyncJournalDb::takeRemoteDiscoveryForced()
+{
+    QMutexLocker locker(&_mutex);
+    const bool forced = _remoteDiscoveryForced;
+    _remoteDiscoveryForced = false;
+    return forced;
+}
+
 void SyncJournalDb::forceRemoteDiscoveryNextSyncLocked()
 {
     qCInfo(lcDb) << "Forcing remote re-discovery by deleting folder Etags";
     SqlQuery deleteRemoteFolderEtagsQuery(_db);
     deleteRemoteFolderEtagsQuery.prepare("UPDATE metadata SET md5='_invalid_' WHERE type=2;");
     deleteRemoteFolderEtagsQuery.exec();
+    _fileRecordCache.clear();
+    _remoteDiscoveryForced = true;
 }
 
 
@@ -1955,6 +2716,170 @@ void SyncJournalDb::setDataFingerprint(const QByteArray &dataFingerprint)
     setDataFingerprintQuery2->exec();
 }
 
+void SyncJournalDb::keyValueStoreSet(const QString &key, qint64 value)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return;
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::SetKeyValueStoreQuery, QByteArrayLiteral("INSERT OR REPLACE INTO keyvalue (key, value) VALUES (?1, ?2);"), _db);
+    if (!query) {
+        return;
+    }
+    query->bindValue(1, key);
+    query->bindValue(2, value);
+    query->exec();
+}
+
+void SyncJournalDb::keyValueStoreSet(const QString &key, const QString &value)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return;
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::SetKeyValueStoreQuery, QByteArrayLiteral("INSERT OR REPLACE INTO keyvalue (key, value) VALUES (?1, ?2);"), _db);
+    if (!query) {
+        return;
+    }
+    query->bindValue(1, key);
+    query->bindValue(2, value);
+    query->exec();
+}
+
+qint64 SyncJournalDb::keyValueStoreGetInt(const QString &key, qint64 defaultValue)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return defaultValue;
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetKeyValueStoreQuery, QByteArrayLiteral("SELECT value FROM keyvalue WHERE key=?1"), _db);
+    if (!query) {
+        return defaultValue;
+    }
+    query->bindValue(1, key);
+    if (!query->exec() || !query->next().hasData) {
+        return defaultValue;
+    }
+    return query->int64Value(0);
+}
+
+QString SyncJournalDb::keyValueStoreGetString(const QString &key, const QString &defaultValue)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return defaultValue;
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetKeyValueStoreQuery, QByteArrayLiteral("SELECT value FROM keyvalue WHERE key=?1"), _db);
+    if (!query) {
+        return defaultValue;
+    }
+    query->bindValue(1, key);
+    if (!query->exec() || !query->next().hasData) {
+        return defaultValue;
+    }
+    return query->stringValue(0);
+}
+
+void SyncJournalDb::deleteKeyValueStoreEntry(const QString &key)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return;
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::DeleteKeyValueStoreQuery, QByteArrayLiteral("DELETE FROM keyvalue WHERE key=?1"), _db);
+    if (!query) {
+        return;
+    }
+    query->bindValue(1, key);
+    query->exec();
+}
+
+bool SyncJournalDb::addHistoryEntries(const QVector<HistoryEntry> &entries, qint64 maxHistoryEntries)
+{
+    if (entries.isEmpty()) {
+        return true;
+    }
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return false;
+    }
+
+    const auto insertQuery = _queryManager.get(PreparedSqlQueryManager::AddHistoryEntryQuery,
+        QByteArrayLiteral("INSERT INTO history (timestamp, path, size, status, direction, message) VALUES (?1, ?2, ?3, ?4, ?5, ?6);"), _db);
+    if (!insertQuery) {
+        return false;
+    }
+
+    startTransaction();
+    for (const auto &entry : entries) {
+        insertQuery->reset_and_clear_bindings();
+        insertQuery->bindValue(1, entry.timestamp);
+        insertQuery->bindValue(2, entry.path);
+        insertQuery->bindValue(3, entry.size);
+        insertQuery->bindValue(4, entry.status);
+        insertQuery->bindValue(5, entry.direction);
+        insertQuery->bindValue(6, entry.message);
+        if (!insertQuery->exec()) {
+            commitTransaction();
+            return false;
+        }
+    }
+
+    const auto pruneQuery = _queryManager.get(PreparedSqlQueryManager::PruneHistoryQuery,
+        QByteArrayLiteral("DELETE FROM history WHERE rowid NOT IN (SELECT rowid FROM history ORDER BY rowid DESC LIMIT ?1);"), _db);
+    if (pruneQuery) {
+        pruneQuery->bindValue(1, maxHistoryEntries);
+        pruneQuery->exec();
+    }
+    commitTransaction();
+    return true;
+}
+
+QVector<SyncJournalDb::HistoryEntry> SyncJournalDb::historyEntriesBefore(qint64 beforeId, int limit)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect()) {
+        return {};
+    }
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::GetHistoryEntriesQuery,
+        QByteArrayLiteral("SELECT rowid, timestamp, path, size, status, direction, message FROM history "
+                          "WHERE (?1 == 0 OR rowid < ?1) ORDER BY rowid DESC LIMIT ?2;"),
+        _db);
+    if (!query) {
+        return {};
+    }
+    query->bindValue(1, beforeId);
+    query->bindValue(2, limit);
+    if (!query->exec()) {
+        return {};
+    }
+
+    QVector<HistoryEntry> entries;
+    entries.reserve(limit);
+    while (true) {
+        const auto next = query->next();
+        if (!next.ok || !next.hasData) {
+            break;
+        }
+        HistoryEntry entry;
+        entry.id = query->int64Value(0);
+        entry.timestamp = query->int64Value(1);
+        entry.path = query->stringValue(2);
+        entry.size = query->int64Value(3);
+        entry.status = query->intValue(4);
+        entry.direction = query->intValue(5);
+        entry.message = query->stringValue(6);
+        entries.append(entry);
+    }
+    return entries;
+}
+
 void SyncJournalDb::setConflictRecord(const ConflictRecord &record)
 {
     QMutexLocker locker(&_mutex);
@@ -1972,6 +2897,7 @@ void SyncJournalDb::setConflictRecord(const ConflictRecord &record)
     query->bindValue(4, record.baseEtag);
     query->bindValue(5, record.initialBasePath);
     OC_ASSERT(query->exec());
+    Q_EMIT conflictRecordAdded(record.path);
 }
 
 ConflictRecord SyncJournalDb::conflictRecord(const QByteArray &path)
@@ -2007,6 +2933,9 @@ void SyncJournalDb::deleteConflictRecord(const QByteArray &path)
     OC_ASSERT(query);
     query->bindValue(1, path);
     OC_ASSERT(query->exec());
+    if (query->numRowsAffected() > 0) {
+        Q_EMIT conflictRecordRemoved(path);
+    }
 }
 
 QByteArrayList SyncJournalDb::conflictRecordPaths()
@@ -2026,6 +2955,20 @@ QByteArrayList SyncJournalDb::conflictRecordPaths()
     return paths;
 }
 
+int SyncJournalDb::conflictRecordCount()
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect())
+        return 0;
+
+    SqlQuery query(_db);
+    query.prepare("SELECT count(*) FROM conflicts");
+    OC_ASSERT(query.exec());
+    if (!query.next().hasData)
+        return 0;
+    return query.intValue(0);
+}
+
 QByteArray SyncJournalDb::conflictFileBaseName(const QByteArray &conflictName)
 {
     auto conflict = conflictRecord(conflictName);
@@ -2042,12 +2985,64 @@ QByteArray SyncJournalDb::conflictFileBaseName(const QByteArray &conflictName)
     return result;
 }
 
+void SyncJournalDb::setVfsIntent(const QByteArray &path, VfsIntentOp op)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect())
+        return;
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::SetVfsIntentQuery, QByteArrayLiteral("INSERT OR REPLACE INTO vfsintents "
+                                                                                                       "(path, operation) "
+                                                                                                       "VALUES (?1, ?2);"),
+        _db);
+    OC_ASSERT(query);
+    query->bindValue(1, path);
+    query->bindValue(2, static_cast<int>(op));
+    OC_ASSERT(query->exec());
+}
+
+void SyncJournalDb::removeVfsIntent(const QByteArray &path)
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect())
+        return;
+
+    const auto query = _queryManager.get(PreparedSqlQueryManager::DeleteVfsIntentQuery, QByteArrayLiteral("DELETE FROM vfsintents WHERE path=?1;"), _db);
+    OC_ASSERT(query);
+    query->bindValue(1, path);
+    OC_ASSERT(query->exec());
+}
+
+QByteArrayList SyncJournalDb::getAndClearVfsIntents()
+{
+    QMutexLocker locker(&_mutex);
+    if (!checkConnect())
+        return {};
+
+    SqlQuery query(_db);
+    query.prepare("SELECT path FROM vfsintents");
+    OC_ASSERT(query.exec());
+
+    QByteArrayList paths;
+    while (query.next().hasData)
+        paths.append(query.baValue(0));
+
+    if (!paths.isEmpty()) {
+        SqlQuery clearQuery(_db);
+        clearQuery.prepare("DELETE FROM vfsintents");
+        OC_ASSERT(clearQuery.exec());
+    }
+
+    return paths;
+}
+
 void SyncJournalDb::clearFileTable()
 {
     QMutexLocker lock(&_mutex);
     SqlQuery query(_db);
     query.prepare("DELETE FROM metadata;");
     query.exec();
+    _fileRecordCache.clear();
 }
 
 void SyncJournalDb::markVirtualFileForDownloadRecursively(const QByteArray &path)
@@ -2070,6 +3065,8 @@ void SyncJournalDb::markVirtualFileForDownloadRecursively(const QByteArray &path
                   "(" IS_PREFIX_PATH_OF("?1", "path") " OR ?1 == '' OR " IS_PREFIX_PATH_OR_EQUAL("path", "?1") ") AND type == 2;");
     query.bindValue(1, path);
     query.exec();
+    _fileRecordCache.clear();
+    _remoteDiscoveryForced = true;
 }
 
 Optional<PinState> SyncJournalDb::PinStateInterface::rawForPath(const QByteArray &path)
@@ -2225,6 +3222,22 @@ void SyncJournalDb::commit(const QString &context, bool startTrans)
     commitInternal(context, startTrans);
 }
 
+void SyncJournalDb::commitAsync(const QString &context)
+{
+    bool expected = false;
+    if (!_asyncCommitPending.compare_exchange_strong(expected, true)) {
+        // A commit is already on its way; it covers everything written so far.
+        return;
+    }
+    _asyncCommitFuture = QtConcurrent::run([this, context] {
+        QMutexLocker lock(&_mutex);
+        if (_db.isOpen()) {
+            commitInternal(context, true);
+        }
+        _asyncCommitPending = false;
+    });
+}
+
 void SyncJournalDb::commitIfNeededAndStartNewTransaction(const QString &context)
 {
     QMutexLocker lock(&_mutex);
@@ -2247,9 +3260,39 @@ bool SyncJournalDb::isOpen() const
     return _db.isOpen();
 }
 
+void SyncJournalDb::prefetchPageCacheAsync()
+{
+    const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+    auto nextAllowed = _nextPrefetchAfterMs.load();
+    if (now.count() < nextAllowed) {
+        // Prefetched (or in active use) recently, the pages are still warm.
+        return;
+    }
+    const auto next = now + journalPrefetchIntervalC;
+    if (!_nextPrefetchAfterMs.compare_exchange_strong(nextAllowed, next.count())) {
+        // Lost the race against a concurrent call, that one does the read.
+        return;
+    }
+    QtConcurrent::run([files = QStringList{ _dbFile, _dbFile + QStringLiteral("-wal") }] {
+        char buffer[64 * 1024];
+        for (const auto &fileName : files) {
+            QFile file(fileName);
+            if (!file.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+            // Sequential read for the side effect of populating the OS page
+            // cache, the data itself is discarded.
+            while (file.read(buffer, sizeof(buffer)) > 0) { }
+        }
+    });
+}
+
 void SyncJournalDb::commitInternal(const QString &context, bool startTrans)
 {
+    OC_WATCHDOG_OP("SyncJournalDb::commit");
     qCDebug(lcDb) << "Transaction commit" << context << (startTrans ? "and starting new transaction" : "");
+    flushFileRecordQueueLocked();
     commitTransaction();
 
     if (startTrans) {
@@ -2321,7 +3364,8 @@ bool operator==(const SyncJournalDb::DownloadInfo &lhs,
     return lhs._errorCount == rhs._errorCount
         && lhs._etag == rhs._etag
         && lhs._tmpfile == rhs._tmpfile
-        && lhs._valid == rhs._valid;
+        && lhs._valid == rhs._valid
+        && lhs._segments == rhs._segments;
 }
 
 bool operator==(const SyncJournalDb::UploadInfo &lhs,
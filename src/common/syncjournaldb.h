@@ -19,13 +19,18 @@
 #ifndef SYNCJOURNALDB_H
 #define SYNCJOURNALDB_H
 
+#include <QFuture>
 #include <QObject>
 #include <qmutex.h>
+#include <QCache>
 #include <QDateTime>
 #include <QHash>
+#include <atomic>
 #include <functional>
+#include <memory>
 
 #include "common/checksumalgorithms.h"
+#include "common/contentchunker.h"
 #include "common/ownsql.h"
 #include "common/pinstate.h"
 #include "common/preparedsqlquerymanager.h"
@@ -62,9 +67,94 @@ public:
     bool getFileRecordsByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
     bool getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
     bool listFilesInPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
+
+    /** Estimated heap footprint of the file record cache in bytes.
+     *
+     * Count of cached records times an average record size; QCache cannot be
+     * iterated, so the payload share is a fixed estimate. Feeds the memory
+     * accounting of the sync performance report.
+     */
+    qint64 fileRecordCacheEstimatedBytes() const;
+
+    /** Pages through file records in path order, for slow background walks.
+     *
+     * Fetches up to limit records whose path sorts after afterPath; pass the
+     * last delivered path to continue the walk, an empty array to start it.
+     * Unlike filesBelowPathCursor() the database lock is only held for one
+     * page, so a consumer that pauses between pages does not block the sync.
+     * Returns false on database errors; an exhausted walk succeeds without
+     * invoking the callback.
+     */
+    bool getFileRecordsAfterPath(const QByteArray &afterPath, int limit, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+
+    /** Forward-only streaming cursor over file records below a path.
+     *
+     * Unlike getFilesBelowPath() the cursor reuses a single record buffer, so
+     * a whole-journal scan does not construct a fresh SyncJournalFileRecord
+     * (and its QByteArray members) for every row. The cursor keeps the
+     * database mutex locked for its whole lifetime, keep it short-lived.
+     */
+    class OCSYNC_EXPORT FileRecordCursor
+    {
+    public:
+        ~FileRecordCursor();
+        FileRecordCursor(FileRecordCursor &&other) noexcept;
+        FileRecordCursor &operator=(FileRecordCursor &&other) = delete;
+
+        /** Advance to the next row. Returns false at the end of the scan or on error. */
+        bool next();
+
+        /** Whether the scan is error free so far. */
+        bool ok() const { return _ok; }
+
+        /** The current record. Only valid until the next call to next(). */
+        const SyncJournalFileRecord &record() const { return _record; }
+
+    private:
+        friend class SyncJournalDb;
+        FileRecordCursor(SyncJournalDb *db, const QByteArray &path);
+
+        SyncJournalDb *_db;
+        std::unique_ptr<SqlQuery> _query;
+        SyncJournalFileRecord _record;
+        bool _ok = false;
+    };
+    friend class FileRecordCursor;
+
+    /** Returns a cursor over all file records below path, "" scans the whole journal. */
+    FileRecordCursor filesBelowPathCursor(const QByteArray &path);
+
+    /** Number of file records below path, "" counts the whole journal.
+     *
+     * Runs entirely inside sqlite as a range scan over the covering path
+     * index, no rows are materialized. Returns none on db error.
+     */
+    Optional<qint64> countFilesBelowPath(const QByteArray &path);
+
     const QVector<SyncJournalFileRecord> getFileRecordsWithDirtyPlaceholders() const;
     Result<void, QString> setFileRecord(const SyncJournalFileRecord &record);
 
+    /** Batch variant of setFileRecord().
+     *
+     * Stores the records with multi-row INSERT OR REPLACE statements inside the
+     * current transaction. Much faster than calling setFileRecord() in a loop
+     * when many records arrive back-to-back, like from the propagator on large syncs.
+     */
+    Result<void, QString> setFileRecords(const QVector<SyncJournalFileRecord> &records);
+
+    /** Enable or disable write batching for setFileRecord().
+     *
+     * While enabled, setFileRecord() accumulates records in memory and writes
+     * them out through setFileRecords() once enough have queued up. All metadata
+     * read and delete paths as well as commit() and close() flush the queue
+     * first, so read-your-writes semantics are preserved. Disabling flushes any
+     * queued records.
+     */
+    Result<void, QString> setWriteBatchingEnabled(bool enabled);
+
+    /** Write out any records queued by setFileRecord() while batching is enabled. */
+    Result<void, QString> flushFileRecordQueue();
+
     bool deleteFileRecord(const QString &filename, bool recursively = false);
     bool updateFileRecordChecksum(const QString &filename,
         const QByteArray &contentChecksum,
@@ -81,7 +171,39 @@ public:
     Optional<HasHydratedDehydrated> hasHydratedOrDehydratedFiles(const QByteArray &filename);
 
     bool exists();
-    void walCheckpoint();
+
+    /** How much work a WAL checkpoint is allowed to do, see walCheckpoint(). */
+    enum class CheckpointMode {
+        Passive, ///< checkpoint what is possible without blocking on readers
+        Full, ///< wait for readers and checkpoint the whole log
+        Truncate ///< like Full, but also truncate the -wal file afterwards
+    };
+
+    /** Checkpoint the WAL into the main database file.
+     *
+     * A Passive checkpoint is cheap and suitable for the end of a sync run;
+     * the more thorough Truncate mode should be scheduled when the folder is
+     * idle (see Folder::slotSyncFinished()).
+     */
+    void walCheckpoint(CheckpointMode mode = CheckpointMode::Full);
+
+    /** Progress of online journal maintenance, see maintenanceSlice(). */
+    struct MaintenanceProgress
+    {
+        qint64 freePagesRemaining = 0;
+        bool done = false;
+    };
+
+    /** Run one bounded slice of journal maintenance.
+     *
+     * Releases up to pageBudget free pages back to the filesystem through
+     * incremental vacuum and, once the freelist is drained, refreshes the
+     * query planner statistics with PRAGMA optimize. Meant to be called
+     * repeatedly from an idle timer so a journal that grew during a big
+     * reorganization shrinks again without a full resync; each slice stays
+     * small enough not to delay a starting sync. Returns none on db error.
+     */
+    Optional<MaintenanceProgress> maintenanceSlice(int pageBudget = 1000);
 
     QString databaseFilePath() const;
 
@@ -105,6 +227,9 @@ public:
         QByteArray _etag;
         int _errorCount;
         bool _valid;
+        /// Serialized per-segment progress of a segmented download, empty
+        /// for single-stream transfers. Opaque to the journal.
+        QByteArray _segments;
     };
     struct UploadInfo
     {
@@ -144,7 +269,38 @@ public:
     // Return the list of transfer ids that were removed.
     QVector<uint> deleteStaleUploadInfos(const QSet<QString> &keep);
 
+    /** Content-defined chunk hashes of the last uploaded revision of a file.
+     *
+     * Kept so a delta upload can tell which chunks of a modified file the
+     * server already has. Ordered by offset; empty when nothing is stored.
+     */
+    QVector<ContentChunk> getContentChunks(const QString &file);
+
+    /// Replaces the stored chunk list; an empty list clears it.
+    void setContentChunks(const QString &file, const QVector<ContentChunk> &chunks);
+
+    /** Content checksum cache, keyed by local file identity.
+     *
+     * Lets upload paths reuse a checksum computed in an earlier run when
+     * inode, size and mtime are unchanged — re-shares and moved folders
+     * would otherwise re-hash gigabytes the client hashed before. Stores
+     * the full "TYPE:checksum" header; callers must check that the cached
+     * algorithm is the one they need. Returns an empty array on a miss.
+     */
+    QByteArray checksumCacheEntry(quint64 inode, qint64 size, qint64 modtime);
+    void setChecksumCacheEntry(quint64 inode, qint64 size, qint64 modtime, const QByteArray &checksumHeader);
+
     SyncJournalErrorBlacklistRecord errorBlacklistEntry(const QString &);
+
+    /** Load the whole error blacklist in one query.
+     *
+     * The blacklist rarely holds more than a few thousand entries, so the
+     * sync engine fetches it once per sync run instead of issuing a point
+     * query per discovered item. Keys are the stored paths; callers on
+     * case-insensitive filesystems need to do their own case folding.
+     */
+    QHash<QString, SyncJournalErrorBlacklistRecord> errorBlacklistMap();
+
     bool deleteStaleErrorBlacklistEntries(const QSet<QString> &keep);
 
     /// Delete flags table entries that have no metadata correspondent
@@ -207,12 +363,34 @@ public:
      */
     void forceRemoteDiscoveryNextSync();
 
+    /**
+     * Whether a path was scheduled for remote discovery since the last call.
+     *
+     * Lets the sync engine know that it must not serve the remote tree from
+     * the journal based on an unchanged root etag. The flag is deliberately
+     * process-local: after a restart the engine has no cached root etag to
+     * skip with anyway.
+     */
+    bool takeRemoteDiscoveryForced();
+
     /* Because sqlite transactions are really slow, we encapsulate everything in big transactions
      * Commit will actually commit the transaction and create a new one.
      */
     void commit(const QString &context, bool startTrans = true);
     void commitIfNeededAndStartNewTransaction(const QString &context);
 
+    /** Like commit(), but runs the actual transaction commit on a worker
+     * thread so the caller does not wait for sqlite's fsync.
+     *
+     * Later database calls serialize against the in-flight commit via the
+     * regular mutex. While a commit is pending further calls are no-ops;
+     * the pending commit covers all work written before it takes the mutex
+     * and everything later lands in the next transaction. Used from the
+     * propagator's per-item completion paths, where synchronous commits
+     * throttle small-file syncs.
+     */
+    void commitAsync(const QString &context);
+
     /** Open the db if it isn't already.
      *
      * This usually creates some temporary files next to the db file, like
@@ -225,6 +403,18 @@ public:
     /** Returns whether the db is currently openend. */
     bool isOpen() const;
 
+    /** Reads the database file and its WAL into the OS page cache.
+     *
+     * Called when a sync of the folder is queued, so that by the time the
+     * engine issues its first queries the journal no longer comes from cold
+     * storage - on network homes a cold open costs seconds. The read runs
+     * on the global thread pool, touches the files read-only and therefore
+     * needs no coordination with concurrent database use. Repeat calls
+     * within a short interval are no-ops; a recently used journal is warm
+     * anyway.
+     */
+    void prefetchPageCacheAsync();
+
     /** Close the database */
     void close();
 
@@ -245,6 +435,47 @@ public:
     void setDataFingerprint(const QByteArray &dataFingerprint);
     QByteArray dataFingerprint();
 
+    /**
+     * Small generic key-value store for state that must live and die with
+     * the journal, e.g. the platform watcher's persisted event position.
+     * An absent key yields defaultValue, deleteKeyValueStoreEntry removes
+     * the key.
+     */
+    void keyValueStoreSet(const QString &key, qint64 value);
+    void keyValueStoreSet(const QString &key, const QString &value);
+    qint64 keyValueStoreGetInt(const QString &key, qint64 defaultValue);
+    QString keyValueStoreGetString(const QString &key, const QString &defaultValue = {});
+    void deleteKeyValueStoreEntry(const QString &key);
+
+    /**
+     * One completed-item summary in the history table.
+     *
+     * status and direction hold the numeric values of SyncFileItem::Status
+     * and SyncFileItem::Direction; the journal stores them opaquely.
+     */
+    struct OCSYNC_EXPORT HistoryEntry
+    {
+        qint64 id = 0; ///< rowid, assigned by the database, paging cursor
+        qint64 timestamp = 0; ///< msecs since epoch, UTC
+        QString path;
+        qint64 size = 0;
+        int status = 0;
+        int direction = 0;
+        QString message;
+    };
+
+    /**
+     * Appends completed-item summaries in one transaction and prunes the
+     * oldest rows once the table exceeds maxHistoryEntries. The activity
+     * views page over this table instead of holding their history in
+     * memory, so it survives a restart.
+     */
+    bool addHistoryEntries(const QVector<HistoryEntry> &entries, qint64 maxHistoryEntries);
+
+    /** Fetches up to limit history entries with rowid smaller than beforeId,
+     *  newest first. Pass 0 as beforeId to start at the newest entry. */
+    QVector<HistoryEntry> historyEntriesBefore(qint64 beforeId, int limit);
+
 
     // Conflict record functions
 
@@ -260,6 +491,9 @@ public:
     /// Return all paths of files with a conflict tag in the name and records in the db
     QByteArrayList conflictRecordPaths();
 
+    /// Number of pending conflicts, a cheap count on the indexed conflicts table
+    int conflictRecordCount();
+
     /** Find the base name for a conflict file name, using journal or name pattern
      *
      * The path must by sync-folder relative.
@@ -268,6 +502,33 @@ public:
      */
     QByteArray conflictFileBaseName(const QByteArray &conflictName);
 
+
+    // Vfs intent log functions
+
+    /** Placeholder state transition logged in the vfs intent log. */
+    enum class VfsIntentOp {
+        Hydrate = 1,
+        Dehydrate = 2,
+        Pin = 3,
+    };
+
+    /** Log that a placeholder state transition for path is starting.
+     *
+     * Between changing the on-disk placeholder and writing the matching
+     * metadata the two stores disagree; if the process dies in that window
+     * the leftover entry identifies the affected path. Replaying the log on
+     * the next start re-inspects just the in-flight items instead of
+     * re-verifying the whole tree. A path has at most one entry, a new
+     * intent replaces the old one.
+     */
+    void setVfsIntent(const QByteArray &path, VfsIntentOp op);
+
+    /// Remove the intent for path once placeholder and journal agree again
+    void removeVfsIntent(const QByteArray &path);
+
+    /// Return all logged paths and empty the log, for startup replay
+    QByteArrayList getAndClearVfsIntents();
+
     /**
      * Delete any file entry. This will force the next sync to re-sync everything as if it was new,
      * restoring everyfile on every remote. If a file is there both on the client and server side,
@@ -378,10 +639,34 @@ public:
      */
     int autotestFailCounter = -1;
 
+Q_SIGNALS:
+    /**
+     * Emitted between the chunked transactions of a schema migration that
+     * rewrites table rows, e.g. the phash rehash after an upgrade.
+     * Lets the GUI show that a long "checking" phase is making progress.
+     */
+    void migrationProgress(const QString &step, qint64 done, qint64 total);
+
+    /**
+     * Emitted when a conflict record is stored, also when an existing record
+     * is updated. Together with conflictRecordRemoved this lets the GUI track
+     * pending conflicts incrementally, with the journal as the single source
+     * of truth.
+     */
+    void conflictRecordAdded(const QByteArray &path);
+
+    /// Emitted when a conflict record is removed, i.e. the conflict was resolved
+    void conflictRecordRemoved(const QByteArray &path);
+
 private:
     int getFileRecordCount();
+    Result<void, QString> setFileRecordsInternal(const QVector<SyncJournalFileRecord> &records);
+    Result<void, QString> flushFileRecordQueueLocked();
+    Optional<bool> getFileRecordFromReadConnection(const QByteArray &filename, SyncJournalFileRecord *rec);
+    void applyEtagStorageFilter(SyncJournalFileRecord &record);
     bool updateDatabaseStructure();
     bool updateMetadataTableStructure();
+    bool updateDownloadInfoTableStructure();
     bool updateErrorBlacklistTableStructure();
     bool sqlFail(const QString &log, const SqlQuery &query);
     void commitInternal(const QString &context, bool startTrans = true);
@@ -403,6 +688,18 @@ private:
     SqlDatabase _db;
     QString _dbFile;
     mutable QRecursiveMutex _mutex; // Public functions are protected with the mutex.
+
+    /** Second, read-only connection for concurrent point lookups.
+     *
+     * While the propagator holds _mutex for writes, discovery can still
+     * resolve getFileRecord() through this connection. Only used in WAL
+     * journal mode without exclusive locking, see getFileRecordFromReadConnection().
+     */
+    SqlDatabase _readDb;
+    mutable QMutex _readMutex; // protects _readDb, _readQueryManager and _readConnectionFailed
+    mutable PreparedSqlQueryManager _readQueryManager;
+    bool _readConnectionFailed = false;
+    QByteArray _lockingMode;
     QMap<CheckSums::Algorithm, int> _checksymTypeCache;
     int _transaction;
     bool _metadataTableIsEmpty;
@@ -422,6 +719,9 @@ private:
      */
     QList<QByteArray> _etagStorageFilter;
 
+    /** See takeRemoteDiscoveryForced(). */
+    bool _remoteDiscoveryForced = false;
+
     /** The journal mode to use for the db.
      *
      * Typically WAL initially, but may be set to other modes via environment
@@ -431,6 +731,24 @@ private:
 
     mutable PreparedSqlQueryManager _queryManager;
 
+    /** Records queued by setFileRecord() while write batching is enabled. */
+    QVector<SyncJournalFileRecord> _fileRecordQueue;
+    std::atomic<bool> _writeBatchingEnabled = false;
+
+    /** Read-through LRU cache for getFileRecord(), keyed by phash.
+     *
+     * Serves repeated point lookups from the discovery pipeline without
+     * touching sqlite. All metadata write paths update or clear it.
+     */
+    QCache<qint64, SyncJournalFileRecord> _fileRecordCache;
+
+    /** Tracks the commit scheduled by commitAsync(), see close(). */
+    QFuture<void> _asyncCommitFuture;
+    std::atomic<bool> _asyncCommitPending = false;
+
+    /** Rate limit for prefetchPageCacheAsync(), milliseconds since steady clock epoch. */
+    std::atomic<qint64> _nextPrefetchAfterMs = 0;
+
     /**
      * Whether the db was already closed, prevent recreation
      */
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#include "tracer.h"
+
+#include "fixedsizeringbuffer.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace OCC;
+
+namespace {
+
+// events kept per thread; at ~40 bytes each this bounds memory to a few
+// hundred kilobytes per thread while still covering seconds of a busy sync
+constexpr size_t traceRingSizeC = 4096;
+
+struct ThreadRing
+{
+    ThreadRing()
+        : threadId(quint64(quintptr(QThread::currentThreadId())))
+        , events(traceRingSizeC)
+    {
+    }
+
+    // Guards events. Only the owning thread writes, the lock exists for the
+    // export; it is uncontended on the hot path.
+    QMutex mutex;
+    const quint64 threadId;
+    FixedSizeRingBuffer<Tracer::TraceEvent> events;
+};
+
+struct Registry
+{
+    QMutex mutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+};
+
+Registry &registry()
+{
+    static Registry reg;
+    return reg;
+}
+
+ThreadRing *threadRing()
+{
+    // The registry holds a second reference, so a finished thread's tail of
+    // events stays exportable for the lifetime of the process.
+    thread_local std::shared_ptr<ThreadRing> ring = [] {
+        auto out = std::make_shared<ThreadRing>();
+        auto &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        reg.rings.push_back(out);
+        return out;
+    }();
+    return ring.get();
+}
+
+} // anonymous namespace
+
+qint64 Tracer::nowUs()
+{
+    using namespace std::chrono;
+    static const steady_clock::time_point baseline = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - baseline).count();
+}
+
+void Tracer::record(const char *category, const char *name, qint64 timestampUs, qint64 durationUs)
+{
+    auto *ring = threadRing();
+    QMutexLocker locker(&ring->mutex);
+    if (ring->events.isFull()) {
+        ring->events.pop_front();
+    }
+    ring->events.push_back({ category, name, timestampUs, durationUs });
+}
+
+QJsonArray Tracer::toTraceEventJson()
+{
+    // Copy the ring handles first so the registry lock is not held while
+    // serializing; new threads registering meanwhile miss this export only.
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        auto &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        rings = reg.rings;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray out;
+    for (const auto &ring : rings) {
+        QMutexLocker locker(&ring->mutex);
+        for (size_t i = 0; i < ring->events.size(); ++i) {
+            const auto &event = ring->events.at(i);
+            out.append(QJsonObject {
+                { QStringLiteral("ph"), QStringLiteral("X") },
+                { QStringLiteral("cat"), QString::fromUtf8(event.category) },
+                { QStringLiteral("name"), QString::fromUtf8(event.name) },
+                { QStringLiteral("ts"), event.timestampUs },
+                { QStringLiteral("dur"), event.durationUs },
+                { QStringLiteral("pid"), pid },
+                { QStringLiteral("tid"), qint64(ring->threadId) },
+            });
+        }
+    }
+    return out;
+}
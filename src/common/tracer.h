@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QtGlobal>
+
+class QJsonArray;
+
+namespace OCC {
+
+/**
+ * Always-on lightweight tracing.
+ *
+ * Hot paths record span events into fixed-size per-thread ring buffers, so
+ * instrumentation stays cheap enough to leave enabled in production builds:
+ * recording one event is a timestamp read and a store under an uncontended
+ * per-thread lock, and memory use is bounded. The rings always hold the most
+ * recent events; toTraceEventJson() exports them in Chrome trace-event
+ * format, loadable in chrome://tracing and Perfetto.
+ */
+namespace Tracer {
+
+    /** One completed span.
+     *
+     * Category and name must be string literals (or otherwise outlive the
+     * ring): events are recorded on hot paths and must not allocate.
+     */
+    struct TraceEvent
+    {
+        const char *category = nullptr;
+        const char *name = nullptr;
+        qint64 timestampUs = 0;
+        qint64 durationUs = 0;
+    };
+
+    /// Microseconds on the tracing clock, a monotonic clock starting near process start
+    OCSYNC_EXPORT qint64 nowUs();
+
+    /// Records a completed span in the calling thread's ring, overwriting the oldest event when full
+    OCSYNC_EXPORT void record(const char *category, const char *name, qint64 timestampUs, qint64 durationUs);
+
+    /// All buffered events of all threads as a Chrome trace-event array
+    OCSYNC_EXPORT QJsonArray toTraceEventJson();
+
+    /// RAII helper recording the span from construction to destruction, see OC_TRACE_SPAN
+    class Span
+    {
+        Q_DISABLE_COPY(Span)
+    public:
+        Span(const char *category, const char *name)
+            : _category(category)
+            , _name(name)
+            , _start(nowUs())
+        {
+        }
+
+        ~Span()
+        {
+            record(_category, _name, _start, nowUs() - _start);
+        }
+
+    private:
+        const char *_category;
+        const char *_name;
+        qint64 _start;
+    };
+
+} // namespace Tracer
+
+} // namespace OCC
+
+/// Traces the enclosing scope as one span, e.g. OC_TRACE_SPAN("journal", "SqlQuery::exec")
+#define OC_TRACE_SPAN(category, name) const ::OCC::Tracer::Span _ocTraceSpan { category, name }
@@ -167,6 +167,39 @@ OCSYNC_EXPORT Q_DECLARE_LOGGING_CATEGORY(lcUtility)
         return s.toString();
     }
 
+    /**
+     * Joins base and name with a '/' separator into a caller-provided buffer.
+     *
+     * The buffer's capacity is kept between calls, so a loop that probes many
+     * paths without storing them does not allocate at all once the buffer is
+     * warm. Returns out for use as a call argument.
+     */
+    inline QString &joinPathInto(QString &out, QStringView base, QStringView name)
+    {
+        out.resize(0); // keeps the capacity
+        out.reserve(base.size() + 1 + name.size());
+        out += base;
+        if (!base.isEmpty()) {
+            out += QLatin1Char('/');
+        }
+        out += name;
+        return out;
+    }
+
+    /**
+     * Single-allocation join of base and name with a '/' separator.
+     *
+     * The plain `base + QLatin1Char('/') + name` chain allocates twice; this
+     * reserves the final size up front. Meant for per-entry path construction
+     * on the discovery and propagator hot paths.
+     */
+    inline QString joinPath(QStringView base, QStringView name)
+    {
+        QString out;
+        joinPathInto(out, base, name);
+        return out;
+    }
+
     // Call the given command with the switch --version and rerun the first line
     // of the output.
     // If command is empty, the function calls the running application which, on
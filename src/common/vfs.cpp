@@ -42,6 +42,16 @@ Vfs::Vfs(QObject* parent)
 
 Vfs::~Vfs() = default;
 
+QVector<Result<void, QString>> Vfs::createPlaceholders(const QVector<const SyncFileItem *> &items)
+{
+    QVector<Result<void, QString>> results;
+    results.reserve(items.size());
+    for (const auto *item : items) {
+        results.append(createPlaceholder(*item));
+    }
+    return results;
+}
+
 Vfs::Mode Vfs::modeFromString(const QString &str)
 {
     // Note: Strings are used for config and must be stable
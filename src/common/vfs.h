@@ -27,6 +27,7 @@
 
 #include <QObject>
 #include <QUrl>
+#include <QVector>
 #include <QVersionNumber>
 
 #include <memory>
@@ -179,6 +180,15 @@ public:
     /// Create a new dehydrated placeholder. Called from PropagateDownload.
     [[nodiscard]] virtual Result<void, QString> createPlaceholder(const SyncFileItem &item) = 0;
 
+    /** Create several new dehydrated placeholders in one go.
+     *
+     * Returns one result per item, in item order. The base implementation
+     * forwards to createPlaceholder() one by one; plugins whose provider
+     * has a native batch interface override it to amortize the per-call
+     * overhead (see the cfapi plugin).
+     */
+    [[nodiscard]] virtual QVector<Result<void, QString>> createPlaceholders(const QVector<const SyncFileItem *> &items);
+
     /** Discovery hook: even unchanged files may need UPDATE_METADATA.
      *
      * For instance cfapi vfs wants local hydrated non-placeholder files to
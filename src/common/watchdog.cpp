@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#include "watchdog.h"
+
+#include "tracer.h"
+
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace OCC;
+using namespace std::chrono_literals;
+
+namespace {
+
+Q_LOGGING_CATEGORY(lcWatchdog, "sync.watchdog", QtInfoMsg)
+
+qint64 budgetUs()
+{
+    static const qint64 value = [] {
+        bool ok = false;
+        const int ms = qEnvironmentVariableIntValue("OWNCLOUD_WATCHDOG_BUDGET_MS", &ok);
+        return qint64(ok && ms > 0 ? ms : 1000) * 1000;
+    }();
+    return value;
+}
+
+struct ThreadSlot
+{
+    const quint64 threadId = quint64(quintptr(QThread::currentThreadId()));
+    // The current outermost operation, nullptr when none is running. The
+    // name is stored after the start time and cleared on exit, so the
+    // sampler never sees a name without a start; a start belonging to a
+    // newer operation than the name only makes the pair look younger,
+    // which at worst delays a report by one sampling round.
+    std::atomic<const char *> opName = nullptr;
+    std::atomic<qint64> opStartUs = 0;
+    // Start of the last reported occurrence, so a stall is reported once
+    // rather than on every sampling round it spans.
+    std::atomic<qint64> reportedStartUs = -1;
+    // Nesting depth, touched by the owning thread only
+    int depth = 0;
+};
+
+struct Heartbeat
+{
+    const char *name = nullptr;
+    quint64 threadId = 0;
+    std::atomic<qint64> lastBeatUs = 0;
+    std::atomic<qint64> reportedBeatUs = -1;
+};
+
+struct Registry
+{
+    QMutex mutex;
+    std::vector<std::shared_ptr<ThreadSlot>> slots;
+    std::vector<std::shared_ptr<Heartbeat>> heartbeats;
+};
+
+Registry &registry()
+{
+    static Registry reg;
+    return reg;
+}
+
+void sampleOnce(const std::vector<std::shared_ptr<ThreadSlot>> &slots,
+    const std::vector<std::shared_ptr<Heartbeat>> &heartbeats)
+{
+    const qint64 now = Tracer::nowUs();
+    for (const auto &slot : slots) {
+        const char *name = slot->opName.load(std::memory_order_acquire);
+        if (!name) {
+            continue;
+        }
+        const qint64 start = slot->opStartUs.load(std::memory_order_relaxed);
+        if (now - start < budgetUs() || slot->reportedStartUs.exchange(start) == start) {
+            continue;
+        }
+        Tracer::record("watchdog", name, start, now - start);
+        qCWarning(lcWatchdog) << "Operation" << name << "on thread" << slot->threadId
+                              << "still running after" << (now - start) / 1000 << "ms";
+    }
+    for (const auto &heartbeat : heartbeats) {
+        const qint64 beat = heartbeat->lastBeatUs.load(std::memory_order_relaxed);
+        if (now - beat < budgetUs() || heartbeat->reportedBeatUs.exchange(beat) == beat) {
+            continue;
+        }
+        Tracer::record("watchdog", heartbeat->name, beat, now - beat);
+        qCWarning(lcWatchdog) << "Event loop" << heartbeat->name << "on thread" << heartbeat->threadId
+                              << "has not run for" << (now - beat) / 1000 << "ms";
+    }
+}
+
+// The sampling thread. Started on the first registration and joined at
+// static destruction, so it never outlives the registries it reads.
+struct Sampler
+{
+    Sampler()
+    {
+        thread = std::thread([this] { loop(); });
+    }
+
+    ~Sampler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!quit) {
+            wake.wait_for(lock, 250ms);
+            if (quit) {
+                return;
+            }
+            // Copy the handles so the registry is not locked while sampling
+            std::vector<std::shared_ptr<ThreadSlot>> slots;
+            std::vector<std::shared_ptr<Heartbeat>> heartbeats;
+            {
+                auto &reg = registry();
+                QMutexLocker locker(&reg.mutex);
+                slots = reg.slots;
+                heartbeats = reg.heartbeats;
+            }
+            sampleOnce(slots, heartbeats);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit = false;
+    std::thread thread;
+};
+
+void ensureSampler()
+{
+    static Sampler sampler;
+    Q_UNUSED(sampler)
+}
+
+ThreadSlot *threadSlot()
+{
+    // Like the tracer's rings: the registry keeps a second reference so the
+    // sampler can keep reading a slot after its thread has finished.
+    thread_local std::shared_ptr<ThreadSlot> slot = [] {
+        auto out = std::make_shared<ThreadSlot>();
+        auto &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        reg.slots.push_back(out);
+        return out;
+    }();
+    ensureSampler();
+    return slot.get();
+}
+
+} // anonymous namespace
+
+Watchdog::OperationScope::OperationScope(const char *name)
+{
+    auto *slot = threadSlot();
+    if (slot->depth++ == 0) {
+        slot->opStartUs.store(Tracer::nowUs(), std::memory_order_relaxed);
+        slot->opName.store(name, std::memory_order_release);
+    }
+}
+
+Watchdog::OperationScope::~OperationScope()
+{
+    auto *slot = threadSlot();
+    if (--slot->depth == 0) {
+        slot->opName.store(nullptr, std::memory_order_release);
+    }
+}
+
+void Watchdog::watchEventLoop(QObject *owner, const char *name)
+{
+    auto heartbeat = std::make_shared<Heartbeat>();
+    heartbeat->name = name;
+    heartbeat->threadId = quint64(quintptr(QThread::currentThreadId()));
+    heartbeat->lastBeatUs = Tracer::nowUs();
+    {
+        auto &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        reg.heartbeats.push_back(heartbeat);
+    }
+    ensureSampler();
+
+    auto *timer = new QTimer(owner);
+    timer->setInterval(100ms);
+    QObject::connect(timer, &QTimer::timeout, owner, [heartbeat] {
+        heartbeat->lastBeatUs.store(Tracer::nowUs(), std::memory_order_relaxed);
+    });
+    timer->start();
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "ocsynclib.h"
+
+#include <QtGlobal>
+
+class QObject;
+
+namespace OCC {
+
+/**
+ * Watchdog for operations that overstay their budget.
+ *
+ * Threads mark known-risky operations (journal commits, filesystem calls)
+ * with OC_WATCHDOG_OP. A sampling thread checks the marks a few times per
+ * second; an operation that runs longer than the budget is reported into
+ * the trace buffer and the log *while it is still running*, so a stall is
+ * caught in the act rather than reconstructed from its aftermath. Event
+ * loops register a heartbeat through watchEventLoop(); a loop that stops
+ * beating longer than the budget (a frozen GUI) is reported the same way.
+ *
+ * The budget defaults to 1000ms and can be tuned with
+ * OWNCLOUD_WATCHDOG_BUDGET_MS. Reports carry the operation name, thread
+ * and elapsed time; they appear in the "watchdog" category of the
+ * Tracer export, on the watchdog's own track.
+ */
+namespace Watchdog {
+
+    /** RAII mark making the enclosing scope visible to the watchdog, see OC_WATCHDOG_OP.
+     *
+     * The name must be a string literal. Scopes nest; only the outermost
+     * one on a thread is sampled. Marking is two relaxed stores, cheap
+     * enough for per-file operations.
+     */
+    class OCSYNC_EXPORT OperationScope
+    {
+        Q_DISABLE_COPY(OperationScope)
+    public:
+        explicit OperationScope(const char *name);
+        ~OperationScope();
+    };
+
+    /** Starts a heartbeat for the calling thread's event loop.
+     *
+     * Must be called from the thread whose loop is to be watched. The
+     * heartbeat timer is parented to \a owner and stops with it; the
+     * watchdog reports the loop as stalled while beats stay overdue
+     * beyond the budget.
+     */
+    OCSYNC_EXPORT void watchEventLoop(QObject *owner, const char *name);
+
+} // namespace Watchdog
+
+} // namespace OCC
+
+/// Marks the enclosing scope for the watchdog, e.g. OC_WATCHDOG_OP("SyncJournalDb::commit")
+#define OC_WATCHDOG_OP(name) const ::OCC::Watchdog::OperationScope _ocWatchdogOp { name }
@@ -373,6 +373,44 @@ bool ExcludedFiles::isExcludedRemote(QStringView filePath, QStringView basePath,
     return fullPatternMatch(relativePath, type) != CSYNC_NOT_EXCLUDED;
 }
 
+/** Mirrors "^pattern(?:$|/)": the path itself or any of its parent paths matches exactly. */
+static bool fullLiteralMatch(const QSet<QString> &patterns, const QString &path)
+{
+    if (patterns.isEmpty())
+        return false;
+    qsizetype slash = path.size();
+    while (slash > 0) {
+        if (patterns.contains(path.left(slash)))
+            return true;
+        slash = path.lastIndexOf(QLatin1Char('/'), slash - 1);
+    }
+    return false;
+}
+
+/** Mirrors "(?:^|/)pattern(?:$|/)" resp. "(?:^|/)pattern/" for the dir-only set:
+ * some path component matches exactly, where dir-only patterns only match the
+ * final component if the checked path is a directory itself. */
+static bool literalComponentMatch(const QSet<QString> &fileDir, const QSet<QString> &dirOnly, const QString &path, bool isDir)
+{
+    if (fileDir.isEmpty() && dirOnly.isEmpty())
+        return false;
+    qsizetype start = 0;
+    while (true) {
+        qsizetype end = path.indexOf(QLatin1Char('/'), start);
+        const bool last = end < 0;
+        if (last)
+            end = path.size();
+        const QString component = path.mid(start, end - start);
+        if (fileDir.contains(component))
+            return true;
+        if ((!last || isDir) && dirOnly.contains(component))
+            return true;
+        if (last)
+            return false;
+        start = end + 1;
+    }
+}
+
 CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(QStringView path, ItemType filetype) const
 {
     auto match = _csync_excluded_common(path);
@@ -389,27 +427,73 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(QStringView path, ItemTy
         bnameStr = path.mid(lastSlash + 1);
     }
 
+    // The literal patterns live in hash sets and the regexes only contain the
+    // patterns with actual wildcards. The checks below interleave both to
+    // preserve the result precedence of the previous combined alternations:
+    // bname excludes, bname remove-excludes, then - only when a trigger
+    // fired - the full-path excludes and remove-excludes.
+    //
+    // When no full-path pattern can match below the parent directory at all,
+    // the trigger alternation and the full-path checks are skipped entirely:
+    // only the bname patterns remain relevant for anything in it.
+    const bool fullPatternsPossible = fullPatternsPossibleBelow(lastSlash >= 0 ? path.left(lastSlash).toString() : QString());
+    const bool isDir = filetype == ItemTypeDirectory;
+    const bool haveLiterals = !_literalKeep.isEmpty() || !_literalRemove.isEmpty();
+    QString literalBname;
+    if (haveLiterals) {
+        literalBname = _literalCaseInsensitive ? bnameStr.toString().toCaseFolded() : bnameStr.toString();
+        if (_literalKeep.bnameFileDir.contains(literalBname)
+            || (isDir && _literalKeep.bnameDir.contains(literalBname))) {
+            return CSYNC_FILE_EXCLUDE_LIST;
+        }
+    }
+
     QRegularExpressionMatch regularExpressionMatch;
-    if (filetype == ItemTypeDirectory) {
-        regularExpressionMatch = _bnameTraversalRegexDir.matchView(bnameStr);
+    if (isDir) {
+        regularExpressionMatch = (fullPatternsPossible ? _bnameTraversalRegexDir : _bnameOnlyTraversalRegexDir).matchView(bnameStr);
     } else {
-        regularExpressionMatch = _bnameTraversalRegexFile.matchView(bnameStr);
+        regularExpressionMatch = (fullPatternsPossible ? _bnameTraversalRegexFile : _bnameOnlyTraversalRegexFile).matchView(bnameStr);
     }
-    if (!regularExpressionMatch.hasMatch())
-        return CSYNC_NOT_EXCLUDED;
-    if (regularExpressionMatch.capturedStart(QStringLiteral("exclude")) != -1) {
-        return CSYNC_FILE_EXCLUDE_LIST;
-    } else if (regularExpressionMatch.capturedStart(QStringLiteral("excluderemove")) != -1) {
+    if (regularExpressionMatch.hasMatch()) {
+        if (regularExpressionMatch.capturedStart(QStringLiteral("exclude")) != -1) {
+            return CSYNC_FILE_EXCLUDE_LIST;
+        } else if (regularExpressionMatch.capturedStart(QStringLiteral("excluderemove")) != -1) {
+            return CSYNC_FILE_EXCLUDE_AND_REMOVE;
+        }
+    }
+    if (haveLiterals
+        && (_literalRemove.bnameFileDir.contains(literalBname)
+            || (isDir && _literalRemove.bnameDir.contains(literalBname)))) {
         return CSYNC_FILE_EXCLUDE_AND_REMOVE;
     }
 
-    // third capture: full path matching is triggered
-    QStringView pathStr = path;
+    if (!fullPatternsPossible)
+        return CSYNC_NOT_EXCLUDED;
+
+    // Full path matching is triggered either by the regexes' trigger capture
+    // (the only capture left when the match didn't return above) or by the
+    // bname of a literal full-path pattern.
+    bool triggered = regularExpressionMatch.hasMatch();
+    if (!triggered && haveLiterals) {
+        triggered = _literalFullTriggerFileDir.contains(literalBname)
+            || (isDir && _literalFullTriggerDir.contains(literalBname));
+    }
+    if (!triggered)
+        return CSYNC_NOT_EXCLUDED;
+
+    QString literalPath;
+    if (haveLiterals) {
+        literalPath = _literalCaseInsensitive ? path.toString().toCaseFolded() : path.toString();
+        if (fullLiteralMatch(_literalKeep.fullFileDir, literalPath)
+            || (isDir && fullLiteralMatch(_literalKeep.fullDir, literalPath))) {
+            return CSYNC_FILE_EXCLUDE_LIST;
+        }
+    }
 
-    if (filetype == ItemTypeDirectory) {
-        regularExpressionMatch = _fullTraversalRegexDir.matchView(pathStr);
+    if (isDir) {
+        regularExpressionMatch = _fullTraversalRegexDir.matchView(path);
     } else {
-        regularExpressionMatch = _fullTraversalRegexFile.matchView(pathStr);
+        regularExpressionMatch = _fullTraversalRegexFile.matchView(path);
     }
     if (regularExpressionMatch.hasMatch()) {
         if (regularExpressionMatch.capturedStart(QStringLiteral("exclude")) != -1) {
@@ -419,6 +503,11 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::traversalPatternMatch(QStringView path, ItemTy
             return CSYNC_FILE_EXCLUDE_AND_REMOVE;
         }
     }
+    if (haveLiterals
+        && (fullLiteralMatch(_literalRemove.fullFileDir, literalPath)
+            || (isDir && fullLiteralMatch(_literalRemove.fullDir, literalPath)))) {
+        return CSYNC_FILE_EXCLUDE_AND_REMOVE;
+    }
     return CSYNC_NOT_EXCLUDED;
 }
 
@@ -430,8 +519,23 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::fullPatternMatch(QStringView p, ItemType filet
     if (_allExcludes.isEmpty())
         return CSYNC_NOT_EXCLUDED;
 
+    // Like in traversalPatternMatch the literal patterns are checked
+    // separately, keeping the excludes-before-remove-excludes precedence of
+    // the combined regexes.
+    const bool isDir = filetype == ItemTypeDirectory;
+    const bool haveLiterals = !_literalKeep.isEmpty() || !_literalRemove.isEmpty();
+    QString literalPath;
+    if (haveLiterals) {
+        literalPath = _literalCaseInsensitive ? p.toString().toCaseFolded() : p.toString();
+        if (fullLiteralMatch(_literalKeep.fullFileDir, literalPath)
+            || (isDir && fullLiteralMatch(_literalKeep.fullDir, literalPath))
+            || literalComponentMatch(_literalKeep.bnameFileDir, _literalKeep.bnameDir, literalPath, isDir)) {
+            return CSYNC_FILE_EXCLUDE_LIST;
+        }
+    }
+
     QRegularExpressionMatch m;
-    if (filetype == ItemTypeDirectory) {
+    if (isDir) {
         m = _fullRegexDir.matchView(p);
     } else {
         m = _fullRegexFile.matchView(p);
@@ -443,9 +547,40 @@ CSYNC_EXCLUDE_TYPE ExcludedFiles::fullPatternMatch(QStringView p, ItemType filet
             return CSYNC_FILE_EXCLUDE_AND_REMOVE;
         }
     }
+    if (haveLiterals
+        && (fullLiteralMatch(_literalRemove.fullFileDir, literalPath)
+            || (isDir && fullLiteralMatch(_literalRemove.fullDir, literalPath))
+            || literalComponentMatch(_literalRemove.bnameFileDir, _literalRemove.bnameDir, literalPath, isDir))) {
+        return CSYNC_FILE_EXCLUDE_AND_REMOVE;
+    }
     return CSYNC_NOT_EXCLUDED;
 }
 
+bool ExcludedFiles::fullPatternsPossibleBelow(const QString &directoryPath) const
+{
+    if (_fullPatternPrefixes.isEmpty())
+        return false;
+    if (directoryPath.isEmpty())
+        return true;
+    auto it = _fullPatternsPossibleBelow.constFind(directoryPath);
+    if (it != _fullPatternsPossibleBelow.cend())
+        return *it;
+
+    // The full-path patterns are anchored to the front, so a match below the
+    // directory requires its wildcard-free leading part and the directory
+    // path to be prefixes of one another.
+    const QString dirPrefix = (_literalCaseInsensitive ? directoryPath.toCaseFolded() : directoryPath) + QLatin1Char('/');
+    bool possible = false;
+    for (const QString &prefix : _fullPatternPrefixes) {
+        if (prefix.startsWith(dirPrefix) || dirPrefix.startsWith(prefix)) {
+            possible = true;
+            break;
+        }
+    }
+    _fullPatternsPossibleBelow.insert(directoryPath, possible);
+    return possible;
+}
+
 /**
  * On linux we used to use fnmatch with FNM_PATHNAME, but the windows function we used
  * didn't have that behavior. wildcardsMatchSlash can be used to control which behavior
@@ -541,6 +676,17 @@ QString ExcludedFiles::convertToRegexpSyntax(QString exclude, bool wildcardsMatc
     return regex;
 }
 
+/** Whether a pattern contains nothing convertToRegexpSyntax() treats specially.
+ *
+ * Wildcards, bracket expressions and remaining escape sequences disqualify a
+ * pattern from the literal fast path.
+ */
+static bool isLiteralPattern(const QString &pattern)
+{
+    return !pattern.contains(QLatin1Char('*')) && !pattern.contains(QLatin1Char('?'))
+        && !pattern.contains(QLatin1Char('[')) && !pattern.contains(QLatin1Char('\\'));
+}
+
 QString ExcludedFiles::extractBnameTrigger(const QString &exclude, bool wildcardsMatchSlash)
 {
     // We can definitely drop everything to the left of a / - that will never match
@@ -599,6 +745,18 @@ void ExcludedFiles::prepare()
     // * trailing-slash patterns match directories only. They get collected
     //   in the pattern strings saying "Dir", the others go into "FileDir"
     //   because they match files and directories.
+    //
+    // Patterns without any wildcard never enter the regexes at all: they are
+    // collected in the _literal* sets (same 4 variants) and matched with
+    // hash lookups, which keeps the regex alternations small.
+
+    _literalKeep.clear();
+    _literalRemove.clear();
+    _literalFullTriggerFileDir.clear();
+    _literalFullTriggerDir.clear();
+    _fullPatternPrefixes.clear();
+    _fullPatternsPossibleBelow.clear();
+    _literalCaseInsensitive = OCC::Utility::fsCasePreservingButCaseInsensitive();
 
     QString fullFileDirKeep;
     QString fullFileDirRemove;
@@ -636,6 +794,22 @@ void ExcludedFiles::prepare()
 
         bool fullPath = exclude.contains(QLatin1Char('/'));
 
+        if (isLiteralPattern(exclude)) {
+            auto &literals = removeExcluded ? _literalRemove : _literalKeep;
+            const QString key = _literalCaseInsensitive ? exclude.toCaseFolded() : exclude;
+            if (!fullPath) {
+                (matchDirOnly ? literals.bnameDir : literals.bnameFileDir).insert(key);
+            } else {
+                (matchDirOnly ? literals.fullDir : literals.fullFileDir).insert(key);
+                // Like the trigger groups of the regexes, the bname part
+                // activates the full-path matching during traversal.
+                const QString trigger = key.mid(key.lastIndexOf(QLatin1Char('/')) + 1);
+                (matchDirOnly ? _literalFullTriggerDir : _literalFullTriggerFileDir).insert(trigger);
+                _fullPatternPrefixes.append(key);
+            }
+            continue;
+        }
+
         /* Use QRegularExpression, append to the right pattern */
         auto &bnameFileDir = removeExcluded ? bnameFileDirRemove : bnameFileDirKeep;
         auto &bnameDir = removeExcluded ? bnameDirRemove : bnameDirKeep;
@@ -652,6 +826,17 @@ void ExcludedFiles::prepare()
             QString bnameExclude = extractBnameTrigger(exclude, _wildcardsMatchSlash);
             auto regexBname = convertToRegexpSyntax(bnameExclude, true);
             regexAppend(bnameTriggerFileDir, bnameTriggerDir, regexBname, matchDirOnly);
+
+            // The wildcard-free leading part feeds the per-directory
+            // short-circuit, see fullPatternsPossibleBelow().
+            qsizetype wildcardPos = 0;
+            while (wildcardPos < exclude.size()
+                && exclude[wildcardPos] != QLatin1Char('*') && exclude[wildcardPos] != QLatin1Char('?')
+                && exclude[wildcardPos] != QLatin1Char('[') && exclude[wildcardPos] != QLatin1Char('\\')) {
+                ++wildcardPos;
+            }
+            const QString prefix = exclude.left(wildcardPos);
+            _fullPatternPrefixes.append(_literalCaseInsensitive ? prefix.toCaseFolded() : prefix);
         }
     }
 
@@ -689,6 +874,18 @@ void ExcludedFiles::prepare()
                        "^(?P<trigger>%5|%6)$")
             .arg(bnameFileDirKeep, bnameDirKeep, bnameFileDirRemove, bnameDirRemove, bnameTriggerFileDir, bnameTriggerDir));
 
+    // The variants without the trigger alternation, used when
+    // fullPatternsPossibleBelow() ruled out full-path matches for the
+    // directory being traversed.
+    _bnameOnlyTraversalRegexFile.setPattern(
+        QStringLiteral("^(?P<exclude>%1)$|"
+                       "^(?P<excluderemove>%2)$")
+            .arg(bnameFileDirKeep, bnameFileDirRemove));
+    _bnameOnlyTraversalRegexDir.setPattern(
+        QStringLiteral("^(?P<exclude>%1|%2)$|"
+                       "^(?P<excluderemove>%3|%4)$")
+            .arg(bnameFileDirKeep, bnameDirKeep, bnameFileDirRemove, bnameDirRemove));
+
     // The full traveral regex is applied to the full path if the trigger capture of
     // the bname regex matches. Its basic form is (exclude)|(excluderemove)".
     // This pattern can be much simpler than fullRegex since we can assume a traversal
@@ -739,6 +936,10 @@ void ExcludedFiles::prepare()
     _bnameTraversalRegexFile.optimize();
     _bnameTraversalRegexDir.setPatternOptions(patternOptions);
     _bnameTraversalRegexDir.optimize();
+    _bnameOnlyTraversalRegexFile.setPatternOptions(patternOptions);
+    _bnameOnlyTraversalRegexFile.optimize();
+    _bnameOnlyTraversalRegexDir.setPatternOptions(patternOptions);
+    _bnameOnlyTraversalRegexDir.optimize();
     _fullTraversalRegexFile.setPatternOptions(patternOptions);
     _fullTraversalRegexFile.optimize();
     _fullTraversalRegexDir.setPatternOptions(patternOptions);
@@ -25,6 +25,7 @@
 
 #include "csync.h"
 
+#include <QHash>
 #include <QObject>
 #include <QRegularExpression>
 #include <QSet>
@@ -170,6 +171,18 @@ private:
      */
     CSYNC_EXCLUDE_TYPE fullPatternMatch(QStringView path, ItemType filetype) const;
 
+    /**
+     * @brief Whether any full-path pattern could match a path below the directory.
+     *
+     * Compares the directory against the wildcard-free leading parts of all
+     * full-path patterns: since those patterns are anchored to the front, a
+     * match below the directory is impossible when no leading part is
+     * prefix-compatible with it. traversalPatternMatch() then falls back to
+     * the bname-only checks for everything in such a directory. The answer
+     * is memoized per directory; prepare() drops the memo.
+     */
+    bool fullPatternsPossibleBelow(const QString &directoryPath) const;
+
     /**
      * Generate optimized regular expressions for the exclude patterns.
      *
@@ -221,6 +234,44 @@ private:
     QRegularExpression _fullRegexFile;
     QRegularExpression _fullRegexDir;
 
+    /// see prepare(): the bname traversal regexes without the trigger
+    /// alternation, used when fullPatternsPossibleBelow() ruled out
+    /// full-path matches
+    QRegularExpression _bnameOnlyTraversalRegexFile;
+    QRegularExpression _bnameOnlyTraversalRegexDir;
+
+    /// wildcard-free leading parts of all full-path patterns, case-folded
+    /// like the literal sets; see fullPatternsPossibleBelow()
+    QStringList _fullPatternPrefixes;
+    /// memoized per-directory answers of fullPatternsPossibleBelow()
+    mutable QHash<QString, bool> _fullPatternsPossibleBelow;
+
+    /**
+     * Wildcard-free patterns, see prepare().
+     *
+     * These are kept out of the regex alternations and matched with hash
+     * lookups (bname patterns) and parent-path prefix checks (full-path
+     * patterns) instead. Keys are case-folded whenever the regexes match
+     * case-insensitively.
+     */
+    struct LiteralPatterns
+    {
+        QSet<QString> bnameFileDir; // no slash, matches files and directories
+        QSet<QString> bnameDir; // no slash, matches directories only
+        QSet<QString> fullFileDir; // with slash, matches files and directories
+        QSet<QString> fullDir; // with slash, matches directories only
+
+        bool isEmpty() const { return bnameFileDir.isEmpty() && bnameDir.isEmpty() && fullFileDir.isEmpty() && fullDir.isEmpty(); }
+        void clear() { *this = {}; }
+    };
+    LiteralPatterns _literalKeep;
+    LiteralPatterns _literalRemove;
+    /// bnames of the literal full-path patterns, the literal counterpart of the regexes' trigger captures
+    QSet<QString> _literalFullTriggerFileDir;
+    QSet<QString> _literalFullTriggerDir;
+    /// mirrors the CaseInsensitiveOption applied to the regexes
+    bool _literalCaseInsensitive = false;
+
     /**
      * Whether * and ? in patterns can match a /
      *
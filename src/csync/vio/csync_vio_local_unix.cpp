@@ -26,6 +26,16 @@
 #include <dirent.h>
 #include <stdio.h>
 
+#ifdef __linux__
+#include <linux/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(SYS_getdents64) && defined(SYS_statx) && defined(STATX_BASIC_STATS)
+#define CSYNC_BATCHED_ENUMERATION
+#include <vector>
+#endif
+#endif
+
 #include "csync.h"
 
 #include "common/filesystembase.h"
@@ -40,9 +50,36 @@ Q_LOGGING_CATEGORY(lcCSyncVIOLocal, "sync.csync.vio_local", QtInfoMsg)
  * directory functions
  */
 
+#ifdef CSYNC_BATCHED_ENUMERATION
+/* Layout of the records getdents64 writes into the buffer. */
+struct linux_dirent64_t {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+/* Large enough to enumerate most directories with a single syscall. */
+static const size_t DIRENT_BUFFER_SIZE = 256 * 1024;
+#endif
+
 struct csync_vio_handle_t {
-  DIR *dh;
+  DIR *dh = nullptr;
   QString path;
+  /* The encoded form of path, kept so per-entry stats don't re-encode the
+   * directory part for every entry. */
+  QByteArray encodedPath;
+#ifdef CSYNC_BATCHED_ENUMERATION
+  /* When fd is valid, entries are enumerated in batches via getdents64 and
+   * stat'ed relative to the fd via statx instead of going through readdir
+   * plus a full-path lstat per entry. */
+  int fd = -1;
+  std::vector<char> buffer;
+  size_t buffer_pos = 0;
+  size_t buffer_end = 0;
+  bool statx_supported = true;
+#endif
 };
 
 csync_vio_handle_t *csync_vio_local_opendir(const QString &name) {
@@ -50,26 +87,127 @@ csync_vio_handle_t *csync_vio_local_opendir(const QString &name) {
 
     auto dirname = OCC::FileSystem::encodeFileName(name);
 
+#ifdef CSYNC_BATCHED_ENUMERATION
+    handle->fd = open(dirname.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (handle->fd >= 0) {
+        handle->buffer.resize(DIRENT_BUFFER_SIZE);
+        handle->path = name;
+        handle->encodedPath = dirname;
+        return handle.release();
+    }
+    /* Whatever failed here (EACCES, ENOENT, ...) will fail the same way in
+     * opendir() below, which keeps the errno contract of this function. */
+#endif
+
     handle->dh = opendir(dirname.constData());
     if (!handle->dh) {
         return nullptr;
     }
 
     handle->path = name;
+    handle->encodedPath = dirname;
     return handle.release();
 }
 
 int csync_vio_local_closedir(csync_vio_handle_t *dhandle) {
     Q_ASSERT(dhandle);
+#ifdef CSYNC_BATCHED_ENUMERATION
+    if (dhandle->fd >= 0) {
+        auto rc = close(dhandle->fd);
+        delete dhandle;
+        return rc;
+    }
+#endif
     auto rc = closedir(dhandle->dh);
     delete dhandle;
     return rc;
 }
 
+static int _csync_vio_local_stat_encoded(const QByteArray &encodedUri, csync_file_stat_t *buf);
+
+#ifdef CSYNC_BATCHED_ENUMERATION
+static const linux_dirent64_t *_csync_next_batched_dirent(csync_vio_handle_t *handle) {
+    while (true) {
+        if (handle->buffer_pos >= handle->buffer_end) {
+            auto n = syscall(SYS_getdents64, handle->fd, handle->buffer.data(), handle->buffer.size());
+            if (n <= 0) {
+                /* 0 is the end of the directory and leaves errno alone,
+                 * < 0 leaves errno set, both just like readdir(). */
+                return nullptr;
+            }
+            handle->buffer_pos = 0;
+            handle->buffer_end = static_cast<size_t>(n);
+        }
+        auto dirent = reinterpret_cast<const linux_dirent64_t *>(handle->buffer.data() + handle->buffer_pos);
+        handle->buffer_pos += dirent->d_reclen;
+        if (qstrcmp(dirent->d_name, ".") == 0 || qstrcmp(dirent->d_name, "..") == 0)
+            continue;
+        return dirent;
+    }
+}
+
+/* statx relative to the directory fd, so the kernel resolves a single path
+ * component instead of re-walking the whole path for every entry, and with
+ * a minimal field mask. Falls back to lstat on kernels without statx. */
+static int _csync_batched_entry_stat(csync_vio_handle_t *handle, const char *name, csync_file_stat_t *buf) {
+    if (handle->statx_supported) {
+        struct statx stx;
+        if (syscall(SYS_statx, handle->fd, name, AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_INO | STATX_MTIME | STATX_SIZE, &stx) == 0) {
+            switch (stx.stx_mode & S_IFMT) {
+            case S_IFDIR:
+              buf->type = ItemTypeDirectory;
+              break;
+            case S_IFREG:
+              buf->type = ItemTypeFile;
+              break;
+            case S_IFLNK:
+            case S_IFSOCK:
+              buf->type = ItemTypeSoftLink;
+              break;
+            default:
+              buf->type = ItemTypeSkip;
+              break;
+            }
+            buf->inode = stx.stx_ino;
+            buf->modtime = stx.stx_mtime.tv_sec;
+            buf->size = stx.stx_size;
+            return 0;
+        }
+        if (errno != ENOSYS) {
+            return -1;
+        }
+        handle->statx_supported = false;
+    }
+    return _csync_vio_local_stat_encoded(handle->encodedPath + '/' + name, buf);
+}
+#endif
+
 std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *handle, OCC::Vfs *vfs) {
     struct dirent *dirent = nullptr;
     std::unique_ptr<csync_file_stat_t> file_stat;
 
+#ifdef CSYNC_BATCHED_ENUMERATION
+    if (handle->fd >= 0) {
+        auto batched = _csync_next_batched_dirent(handle);
+        if (!batched)
+            return {};
+
+        file_stat.reset(new csync_file_stat_t);
+        file_stat->path = OCC::FileSystem::decodeFileName(batched->d_name);
+
+        if (_csync_batched_entry_stat(handle, batched->d_name, file_stat.get()) < 0) {
+            /* Will get excluded by _csync_detect_update. */
+            file_stat->type = ItemTypeSkip;
+        }
+
+        if (vfs) {
+            vfs->statTypeVirtualFile(file_stat.get(), nullptr);
+        }
+
+        return file_stat;
+    }
+#endif
+
     do {
         dirent = readdir(handle->dh);
         if (dirent == nullptr)
@@ -100,7 +238,9 @@ std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *h
   }
 #endif
 
-  if (csync_vio_local_stat(handle->path + QLatin1Char('/') + file_stat->path, file_stat.get()) < 0) {
+  /* Compose the encoded path from the raw dirent name; encodeFileName() of
+   * the decoded QString would produce the very same bytes. */
+  if (_csync_vio_local_stat_encoded(handle->encodedPath + '/' + dirent->d_name, file_stat.get()) < 0) {
       // Will get excluded by _csync_detect_update.
       file_stat->type = ItemTypeSkip;
   }
@@ -117,10 +257,15 @@ std::unique_ptr<csync_file_stat_t> csync_vio_local_readdir(csync_vio_handle_t *h
 
 
 int csync_vio_local_stat(const QString &uri, csync_file_stat_t *buf)
+{
+    return _csync_vio_local_stat_encoded(OCC::FileSystem::encodeFileName(uri), buf);
+}
+
+static int _csync_vio_local_stat_encoded(const QByteArray &encodedUri, csync_file_stat_t *buf)
 {
     struct stat sb;
 
-    if (lstat(OCC::FileSystem::encodeFileName(uri).constData(), &sb) < 0) {
+    if (lstat(encodedUri.constData(), &sb) < 0) {
       return -1;
     }
 
@@ -20,6 +20,7 @@
 #include "commonstrings.h"
 #include "configfile.h"
 #include "foldermodelcontroller.h"
+#include "scheduling/syncscheduler.h"
 #include "selectivesyncwidget.h"
 
 #include "guiutility.h"
@@ -342,11 +343,25 @@ void AccountFoldersController::onChooseSync()
     // as with so many of these async impls the details are way too complicated but that's a topic for a future refactoring
     auto *modalWidget = new AccountModalWidget(tr("Choose what to sync"), selectiveSync, nullptr);
     modalWidget->setStandardButtons(QDialogButtonBox::Cancel | QDialogButtonBox::Ok);
-    connect(modalWidget, &AccountModalWidget::accepted, this, [selectiveSync, this] {
+    connect(modalWidget, &AccountModalWidget::accepted, this, [selectiveSync, oldBlackList = selectiveSyncList, this] {
         if (!_currentFolder)
             return;
-        _currentFolder->journalDb()->setSelectiveSyncList(SyncJournalDb::SelectiveSyncBlackList, selectiveSync->createBlackList());
-        FolderMan::instance()->forceFolderSync(_currentFolder);
+        const QSet<QString> newBlackList = selectiveSync->createBlackList();
+        _currentFolder->journalDb()->setSelectiveSyncList(SyncJournalDb::SelectiveSyncBlackList, newBlackList);
+
+        // Apply the change incrementally: only the subtrees whose selection
+        // flipped need rediscovery - deselected ones to propagate the local
+        // removal, reselected ones to fetch the remote content again. The
+        // rest of the folder syncs from the journal as usual instead of
+        // paying a full-folder discovery for one changed checkbox.
+        const QSet<QString> changedSubtrees = (oldBlackList - newBlackList) + (newBlackList - oldBlackList);
+        for (const auto &path : changedSubtrees) {
+            _currentFolder->journalDb()->schedulePathForRemoteDiscovery(path);
+            _currentFolder->schedulePathForLocalDiscovery(path);
+        }
+        if (!changedSubtrees.isEmpty()) {
+            FolderMan::instance()->scheduler()->enqueueFolder(_currentFolder, SyncScheduler::Priority::High);
+        }
     });
 
     emit requestAccountModalWidget(modalWidget);
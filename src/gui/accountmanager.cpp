@@ -18,6 +18,7 @@
 #include "creds/credentialmanager.h"
 #include "creds/credentials.h"
 #include "guiutility.h"
+#include "libsync/networkjobs.h"
 
 #include <theme.h>
 
@@ -69,6 +70,11 @@ QString capabilitesC()
 {
     return "capabilities";
 }
+
+QString capabilitiesEtagC()
+{
+    return "capabilitiesEtag";
+}
 }
 
 
@@ -115,6 +121,8 @@ bool AccountManager::restore()
         settings->endGroup();
     }
 
+    Q_EMIT restoreFinished();
+
     return true;
 }
 
@@ -166,6 +174,7 @@ void AccountManager::saveAccount(Account *account)
     settings->setValue(userUUIDC(), account->uuid());
     if (account->hasCapabilities()) {
         settings->setValue(capabilitesC(), account->capabilities().raw());
+        settings->setValue(capabilitiesEtagC(), account->capabilitiesEtag());
     }
     if (account->hasDefaultSyncRoot()) {
         settings->setValue(defaultSyncRootC(), account->defaultSyncRoot());
@@ -283,6 +292,13 @@ Account *AccountManager::loadAccountHelper(QSettings &settings)
 
     acc->setDavDisplayName(settings.value(davUserDisplyNameC()).toString());
     acc->setCapabilities(caps);
+    acc->setCapabilitiesEtag(settings.value(capabilitiesEtagC()).toByteArray());
+
+    // show the avatar cached by the previous session right away instead of after the first validation
+    const QIcon cachedAvatar = AvatarJob::cachedAvatar(acc, user, 128);
+    if (!cachedAvatar.isNull()) {
+        acc->setAvatar(cachedAvatar);
+    }
     acc->setDefaultSyncRoot(settings.value(defaultSyncRootC()).toString());
 
     acc->setCredentials(new Credentials(acc));
@@ -107,6 +107,9 @@ public Q_SLOTS:
     void saveAccount(Account *account /*, bool saveCredentials*/);
 
 Q_SIGNALS:
+    /// Emitted once restore() has loaded all accounts from the settings
+    void restoreFinished();
+
     void accountAdded(AccountState *account);
     void accountRemoved(AccountState *account);
     void lastAccountRemoved();
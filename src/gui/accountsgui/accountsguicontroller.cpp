@@ -55,9 +55,20 @@ AccountsGuiController::AccountsGuiController(AccountManager *accountMgr, MainWin
     connect(_accountMgr, &AccountManager::lastAccountRemoved, this, &AccountsGuiController::onLastAccountRemoved);
 
     if (accounts.isEmpty()) {
-        // this is a genuinely reasonable use of timer to execute an operation after construction and any
-        // other event loop actions have finished
-        QTimer::singleShot(0, this, &AccountsGuiController::runAccountWizard);
+        // Account restore is staged to the event loop after the UI comes up,
+        // so an empty manager here does not yet mean there are no accounts.
+        // Run the wizard only once the restore has finished and the manager
+        // is still empty.
+        // Queued so the modal wizard does not run from inside restore(),
+        // before the startup sequence has set up the folders.
+        connect(
+            _accountMgr, &AccountManager::restoreFinished, this,
+            [this] {
+                if (_accountMgr->accounts().isEmpty()) {
+                    runAccountWizard();
+                }
+            },
+            Qt::QueuedConnection);
     }
 }
 
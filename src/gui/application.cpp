@@ -22,6 +22,7 @@
 #include "accountsgui/accountsguicontroller.h"
 #include "accountstate.h"
 #include "common/vfs.h"
+#include "common/watchdog.h"
 #include "configfile.h"
 #include "folder.h"
 #include "folderman.h"
@@ -100,6 +101,9 @@ Application::Application(Platform *platform, const QString &displayLanguage, boo
     // Cleanup at Quit.
     connect(qApp, &QCoreApplication::aboutToQuit, this, &Application::slotCleanup);
     qApp->installEventFilter(this);
+
+    // Report GUI freezes (a main loop that stops running) while they happen
+    Watchdog::watchEventLoop(this, "gui.eventLoop");
 }
 
 Application::~Application()
@@ -15,16 +15,46 @@
 #include "clientproxy.h"
 
 #include "configfile.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QLoggingCategory>
 #include <QUrl>
 #include <QThreadPool>
 
+#include <chrono>
+
+using namespace std::chrono_literals;
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcClientProxy, "sync.clientproxy", QtInfoMsg)
 
 namespace {
 
+    // How long a cached proxy decision is served without re-running the
+    // system resolver. Stale entries are still served immediately, the
+    // re-evaluation happens in the background.
+    constexpr auto proxyCacheRefreshIntervalC = 2min;
+
+    struct CachedProxyDecision
+    {
+        QNetworkProxy proxy;
+        QElapsedTimer resolvedAt;
+    };
+
+    // Main thread only, like the callers.
+    QHash<QString, CachedProxyDecision> &proxyDecisionCache()
+    {
+        static QHash<QString, CachedProxyDecision> cache;
+        return cache;
+    }
+
+    QString proxyCacheKey(const QUrl &url)
+    {
+        return url.host() + QLatin1Char(':') + QString::number(url.port(443));
+    }
+
     QNetworkProxy proxyFromConfig(const QString &password, const ConfigFile &cfg)
     {
         QNetworkProxy proxy;
@@ -99,10 +129,32 @@ void ClientProxy::setupQtProxyFromConfig(const QString &password)
     }
 }
 
-void ClientProxy::lookupSystemProxyAsync(const QUrl &url, QObject *dst, const char *slot)
+void ClientProxy::lookupSystemProxyAsync(const QUrl &url, QObject *context, const std::function<void(const QNetworkProxy &)> &callback)
 {
+    const QString key = proxyCacheKey(url);
+    auto &cache = proxyDecisionCache();
+    const auto cached = cache.constFind(key);
+    if (cached != cache.cend()) {
+        const QNetworkProxy proxy = cached->proxy;
+        QMetaObject::invokeMethod(
+            context, [callback, proxy] { callback(proxy); }, Qt::QueuedConnection);
+        if (!cached->resolvedAt.hasExpired(std::chrono::milliseconds(proxyCacheRefreshIntervalC).count())) {
+            return;
+        }
+        // Stale entry: the caller got the cached decision above, re-evaluate
+        // in the background so the next lookup sees a fresh one.
+        qCDebug(lcClientProxy) << "Refreshing cached proxy decision for" << key;
+    }
+
     SystemProxyRunnable *runnable = new SystemProxyRunnable(url);
-    QObject::connect(runnable, SIGNAL(systemProxyLookedUp(QNetworkProxy)), dst, slot);
+    QObject::connect(runnable, &SystemProxyRunnable::systemProxyLookedUp, QCoreApplication::instance(), [key](const QNetworkProxy &proxy) {
+        auto &entry = proxyDecisionCache()[key];
+        entry.proxy = proxy;
+        entry.resolvedAt.start();
+    });
+    if (cached == cache.cend()) {
+        QObject::connect(runnable, &SystemProxyRunnable::systemProxyLookedUp, context, callback);
+    }
     QThreadPool::globalInstance()->start(runnable); // takes ownership and deletes
 }
 
@@ -23,6 +23,8 @@
 #include "common/utility.h"
 #include "csync.h"
 
+#include <functional>
+
 namespace OCC {
 
 class ConfigFile;
@@ -33,7 +35,19 @@ class ConfigFile;
  */
 namespace ClientProxy {
     bool isUsingSystemDefault();
-    void lookupSystemProxyAsync(const QUrl &url, QObject *dst, const char *slot);
+
+    /**
+     * Resolves the system proxy for url without blocking the caller.
+     *
+     * Resolved decisions are cached per host so repeated lookups are served
+     * immediately - on Windows a PAC script evaluation can take hundreds of
+     * milliseconds, and the connection validator asks for the same host over
+     * and over. A cached decision older than the refresh interval is still
+     * served right away, but triggers a background re-evaluation that
+     * updates the cache for the next caller. The callback only runs while
+     * context is alive.
+     */
+    void lookupSystemProxyAsync(const QUrl &url, QObject *context, const std::function<void(const QNetworkProxy &)> &callback);
     void setupQtProxyFromConfig(const QString &password);
 
     QString printQNetworkProxy(const QNetworkProxy &proxy);
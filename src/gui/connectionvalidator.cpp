@@ -39,6 +39,15 @@ namespace {
     {
         return std::min(ConnectionValidator::DefaultCallingInterval - 5s, AbstractNetworkJob::httpTimeout);
     };
+
+    // Capabilities and server settings rarely change, so within this TTL a
+    // re-validation (frequent on flaky Wi-Fi) skips the settings fetch and
+    // reconnects after just the status and auth probes.
+    constexpr auto serverSettingsTtlC = 5min;
+
+    // When the last successful FetchServerSettingsJob ran, keyed by the stable
+    // account uuid so removed accounts can't alias a new entry.
+    QHash<QUuid, std::chrono::steady_clock::time_point> lastServerSettingsFetch;
 }
 
 ConnectionValidator::ConnectionValidator(Account *account, QObject *parent)
@@ -81,7 +90,7 @@ void ConnectionValidator::checkServer(ConnectionValidator::ValidationMode mode)
     if (ClientProxy::isUsingSystemDefault()) {
         qCDebug(lcConnectionValidator) << "Trying to look up system proxy";
         ClientProxy::lookupSystemProxyAsync(_account->url(),
-            this, SLOT(systemProxyLookupDone(QNetworkProxy)));
+            this, [this](const QNetworkProxy &proxy) { systemProxyLookupDone(proxy); });
     } else {
         // We want to reset the QNAM proxy so that the global proxy settings are used (via ClientProxy settings)
         _account->accessManager()->setProxy(QNetworkProxy(QNetworkProxy::DefaultProxy));
@@ -127,10 +136,22 @@ void ConnectionValidator::slotCheckServerAndAuth()
     });
 
     connect(_checkServerJob, &CoreJob::finished, this, &ConnectionValidator::checkServerJobFinished);
+
+    // The auth probe only depends on the credentials, not on the status.php
+    // result, so run it in parallel with the server check instead of after it.
+    // The combined result is evaluated once both probes finished.
+    if (_mode != ValidationMode::ValidateServer && _account->credentials()->ready()) {
+        _authStarted = true;
+        checkAuthentication();
+    }
 }
 
 void ConnectionValidator::checkServerJobFinished()
 {
+    if (_finished) {
+        // the parallel auth probe already failed and reported
+        return;
+    }
     if (!_account) {
         qCWarning(lcConnectionValidator) << "Bailing out, Account had been deleted";
         reportResult(NotConfigured);
@@ -210,9 +231,17 @@ void ConnectionValidator::statusFound(const QUrl &url, const QJsonObject &info)
         reportResult(CredentialsNotReady);
         return;
     }
+    _statusOk = true;
     // now check the authentication
     if (_mode != ConnectionValidator::ValidationMode::ValidateServer) {
-        checkAuthentication();
+        if (!_authStarted) {
+            // the credentials were not ready when the probes were launched
+            checkAuthentication();
+        } else if (_authDone) {
+            // the parallel auth probe already succeeded and waited for us
+            slotAuthSuccess();
+        }
+        // otherwise the auth probe is still in flight and continues on its own
     } else {
         reportResult(Connected);
     }
@@ -243,6 +272,10 @@ void ConnectionValidator::checkAuthentication()
 // Lisa todo: I hit this once and nothing happened in the gui?!
 void ConnectionValidator::slotAuthFailed()
 {
+    if (_finished) {
+        // the server check already failed and reported
+        return;
+    }
     if (!_account) {
         qCWarning(lcConnectionValidator) << "Bailing out, Account had been deleted";
         reportResult(NotConfigured);
@@ -277,14 +310,31 @@ void ConnectionValidator::slotAuthFailed()
 
 void ConnectionValidator::slotAuthSuccess()
 {
+    if (_finished) {
+        // the server check already failed and reported
+        return;
+    }
     if (!_account) {
         qCWarning(lcConnectionValidator) << "Bailing out, Account had been deleted";
         reportResult(NotConfigured);
         return;
     }
 
+    _authDone = true;
+    if (_checkServerJob && !_statusOk) {
+        // the parallel server check is still in flight, statusFound re-enters here
+        return;
+    }
+
     _errors.clear();
     if (_mode != ConnectionValidator::ValidationMode::ValidateAuth) {
+        const auto lastFetch = lastServerSettingsFetch.value(_account->uuid());
+        if (lastFetch != std::chrono::steady_clock::time_point {} && std::chrono::steady_clock::now() - lastFetch < serverSettingsTtlC
+            && _account->hasCapabilities() && _account->serverSupportLevel() != Account::ServerSupportLevel::Unknown) {
+            qCDebug(lcConnectionValidator) << "Server settings were fetched recently, reusing them for" << _account->displayNameWithHost();
+            reportResult(Connected);
+            return;
+        }
         auto *fetchSetting = new FetchServerSettingsJob(_account, this);
         const auto unsupportedServerError = [this] {
             _errors.append({tr("The configured server for this client is too old."), tr("Please update to the latest server and restart the client.")});
@@ -305,6 +355,7 @@ void ConnectionValidator::slotAuthSuccess()
                 if (_account->serverSupportLevel() == Account::ServerSupportLevel::Unknown) {
                     unsupportedServerError();
                 }
+                lastServerSettingsFetch.insert(_account->uuid(), std::chrono::steady_clock::now());
                 reportResult(Connected);
                 break;
             case FetchServerSettingsJob::Result::Undefined:
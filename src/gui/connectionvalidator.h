@@ -45,7 +45,8 @@ namespace OCC {
 *---> checkServerAndAuth  (check status.php)
         Will asynchronously check for system proxy (if using system proxy)
         And then invoke slotCheckServerAndAuth
-        CheckServerJob
+        CheckServerJob, started in parallel with checkAuthentication when
+        the credentials are ready (the probes are independent)
         |
         +-> slotNoStatusFound --> X
         |
@@ -60,8 +61,8 @@ namespace OCC {
         |
         +-> slotAuthFailed --> X
         |
-        +-> slotAuthSuccess --+--> X (depending if coming from checkServerAndAuth or not)
-                              |
+        +-> slotAuthSuccess --+--> X (waits for the parallel server check
+                              |      before continuing)
   +---------------------------+
   |
   +-> checkServerCapabilities
@@ -159,6 +160,12 @@ private:
     Utility::ChronoElapsedTimer _duration;
     bool _finished = false;
 
+    // Both probes run in parallel; whoever finishes last with an overall
+    // success continues with the server settings.
+    bool _authStarted = false;
+    bool _authDone = false;
+    bool _statusOk = false;
+
     CoreJob *_checkServerJob;
 
     ConnectionValidator::ValidationMode _mode = ConnectionValidator::ValidationMode::ValidateAuthAndUpdate;
@@ -27,6 +27,7 @@
 #include <QNetworkInformation>
 #include <QNetworkReply>
 
+#include <algorithm>
 #include <chrono>
 
 using namespace std::chrono_literals;
@@ -36,6 +37,10 @@ Q_LOGGING_CATEGORY(lcCredentials, "gui.credentials", QtInfoMsg)
 namespace {
 constexpr int TokenRefreshMaxRetries = 3;
 constexpr std::chrono::seconds TokenRefreshDefaultTimeout = 30s;
+// proactive refresh fires this long before the stated token expiry...
+constexpr std::chrono::seconds TokenRefreshEarlyMargin = 60s;
+// ...but never sooner than this, to not hammer servers stating tiny lifetimes
+constexpr std::chrono::seconds TokenRefreshMinimumDelay = 30s;
 const char authenticationFailedC[] = "owncloud-authentication-failed";
 
 // when creating new keys we should probably stick with this idea related to a creds "type" in case we need to add or remove
@@ -89,6 +94,12 @@ Credentials::Credentials(const QString &token, const QString &refreshToken, Acco
 {
     if (!token.isEmpty() && !refreshToken.isEmpty())
         _ready = true;
+
+    _proactiveRefreshTimer.setSingleShot(true);
+    connect(&_proactiveRefreshTimer, &QTimer::timeout, this, [this] {
+        qCInfo(lcCredentials) << "Access token expires soon, refreshing proactively";
+        refreshAccessToken();
+    });
 }
 
 Credentials::Credentials(Account *account)
@@ -246,7 +257,7 @@ void Credentials::handleRefreshError(QNetworkReply::NetworkError error, const QS
     Q_EMIT authenticationFailed();
 }
 
-void Credentials::handleRefreshSuccess(const QString &accessToken, const QString &refreshToken)
+void Credentials::handleRefreshSuccess(const QString &accessToken, const QString &refreshToken, qint64 expiresIn)
 {
     _oAuthJob->deleteLater();
     _tokenRefreshRetriesCount = 0;
@@ -260,6 +271,12 @@ void Credentials::handleRefreshSuccess(const QString &accessToken, const QString
         _ready = true;
         _accessToken = accessToken;
         persist();
+
+        if (expiresIn > 0) {
+            const auto delay = std::max(std::chrono::seconds(expiresIn) - TokenRefreshEarlyMargin, TokenRefreshMinimumDelay);
+            qCDebug(lcCredentials) << "Access token expires in" << expiresIn << "s, scheduling proactive refresh in" << delay.count() << "s";
+            _proactiveRefreshTimer.start(delay);
+        }
     }
     Q_EMIT fetched();
 }
@@ -288,6 +305,9 @@ void Credentials::refreshAccessTokenInternal()
     if (!_account)
         return;
 
+    // a reactive refresh supersedes a scheduled proactive one; success re-arms it
+    _proactiveRefreshTimer.stop();
+
     // parent with nam to ensure we reset when the nam is reset
     // todo: #22 - the parenting here is highly questionable, as is the use of the shared account ptr
     _oAuthJob = new AccountBasedOAuth(_account, _openIdConfig, this);
@@ -23,6 +23,7 @@
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QNetworkRequest>
+#include <QTimer>
 
 class QNetworkReply;
 class QAuthenticator;
@@ -78,7 +79,7 @@ protected:
 
 
     void handleRefreshError(QNetworkReply::NetworkError error, const QString &message);
-    void handleRefreshSuccess(const QString &accessToken, const QString &refreshToken);
+    void handleRefreshSuccess(const QString &accessToken, const QString &refreshToken, qint64 expiresIn);
     void finishFailedRefresh();
     void handleKeychainError(const QString &message);
 
@@ -99,6 +100,15 @@ protected:
 
     QPointer<AccountBasedOAuth> _oAuthJob;
 
+    /** Renews the access token shortly before it expires.
+     *
+     * Without this the first job after expiry - usually a sync start - pays
+     * for a full token round trip before any sync work begins. Armed on
+     * every refresh success from the server's expires_in; servers that
+     * don't state a lifetime keep the old refresh-on-401 behavior.
+     */
+    QTimer _proactiveRefreshTimer;
+
     RequestAuthenticationController *_requestAuth = nullptr;
 };
 
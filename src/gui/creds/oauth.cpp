@@ -565,7 +565,7 @@ void AccountBasedOAuth::refreshAuthentication(const QString &refreshToken)
                     }
                 }
             }
-            Q_EMIT refreshFinished(accessToken, newRefreshToken);
+            Q_EMIT refreshFinished(accessToken, newRefreshToken, data.value(QStringLiteral("expires_in")).toLongLong());
         });
     };
 
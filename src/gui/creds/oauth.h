@@ -156,7 +156,8 @@ Q_SIGNALS:
     // this can either come from refreshAuthentication or the fetchWellKnown's
     // checkServerJob
     void refreshError(QNetworkReply::NetworkError error, const QString &errorString);
-    void refreshFinished(const QString &accessToken, const QString &refreshToken);
+    /// expiresIn is the token lifetime in seconds as stated by the server, 0 when not provided
+    void refreshFinished(const QString &accessToken, const QString &refreshToken, qint64 expiresIn);
 
 protected:
     void fetchWellKnown() override;
@@ -48,24 +48,45 @@ void FetchServerSettingsJob::start()
         return;
     }
 
-    // The main flow now needs the capabilities
-    auto *job = new JsonApiJob(_account, QStringLiteral("ocs/v2.php/cloud/capabilities"), {}, {}, this);
+    // The main flow now needs the capabilities.
+    // This request doubles as the HTTP/2 probe: it explicitly allows HTTP/2 so
+    // the reply tells us whether the server negotiates it, while all other
+    // requests stay on HTTP/1.1 until the probe result is in.
+    QNetworkRequest probeRequest;
+    probeRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    // With valid capabilities from a previous fetch (they are persisted in the
+    // account settings) ask the server for changes only: an unchanged
+    // capabilities document is answered with an empty 304.
+    if (_account->hasCapabilities() && !_account->capabilitiesEtag().isEmpty()) {
+        probeRequest.setRawHeader(QByteArrayLiteral("If-None-Match"), _account->capabilitiesEtag());
+    }
+    auto *job = new JsonApiJob(_account, QStringLiteral("ocs/v2.php/cloud/capabilities"), {}, probeRequest, this);
     job->setAuthenticationJob(isAuthJob());
     job->setTimeout(fetchSettingsTimeout());
 
     connect(job, &JsonApiJob::finishedSignal, this, [job, this] {
-        auto caps =
-            job->data().value(QStringLiteral("ocs")).toObject().value(QStringLiteral("data")).toObject().value(QStringLiteral("capabilities")).toObject();
-        qCInfo(lcfetchserversettings) << "Server capabilities" << caps;
-        if (job->ocsSuccess()) {
+        const bool notModified = job->httpStatusCode() == 304;
+        if (job->ocsSuccess() || notModified) {
             // todo: #23 - this comment is important relative to that review
-            // Record that the server supports HTTP/2
-            // Actual decision if we should use HTTP/2 is done in AccessManager::createRequest
-            // TODO: http2 support is currently disabled in the client code
+            // Record whether the server negotiated HTTP/2 on the probe above;
+            // this also switches the access manager to multiplexed connections.
             if (auto reply = job->reply()) {
                 _account->setHttp2Supported(reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool());
             }
-            _account->setCapabilities({_account->url(), caps.toVariantMap()});
+            if (notModified) {
+                qCDebug(lcfetchserversettings) << "Server capabilities are unchanged (304), keeping the persisted ones";
+            } else {
+                auto caps = job->data()
+                                .value(QStringLiteral("ocs"))
+                                .toObject()
+                                .value(QStringLiteral("data"))
+                                .toObject()
+                                .value(QStringLiteral("capabilities"))
+                                .toObject();
+                qCInfo(lcfetchserversettings) << "Server capabilities" << caps;
+                _account->setCapabilities({_account->url(), caps.toVariantMap()});
+                _account->setCapabilitiesEtag(job->reply() ? job->reply()->rawHeader(QByteArrayLiteral("ETag")) : QByteArray {});
+            }
             // We cannot deal with servers < 10.0.0
             switch (_account->serverSupportLevel()) {
             case Account::ServerSupportLevel::Unknown:
@@ -133,7 +154,12 @@ void FetchServerSettingsJob::runAsyncUpdates()
     if (_account->capabilities().avatarsAvailable()) {
         // the avatar job uses the legacy WebDAV URL and ocis will require a new approach
         auto *avatarJob = new AvatarJob(_account, _account->davUser(), 128, nullptr);
-        connect(avatarJob, &AvatarJob::avatarPixmap, this, [this](const QPixmap &img) { _account->setAvatar(AvatarJob::makeCircularAvatar(img)); });
+        connect(avatarJob, &AvatarJob::avatarPixmap, this, [this](const QPixmap &img) {
+            // an empty pixmap means a fetch error; keep the avatar restored from the disk cache in that case
+            if (!img.isNull() || !_account->hasAvatar()) {
+                _account->setAvatar(AvatarJob::makeAvatarIcon(img));
+            }
+        });
         avatarJob->start();
     };
 
@@ -29,6 +29,7 @@
 #include "filesystem.h"
 #include "folderman.h"
 #include "folderwatcher.h"
+#include "integrityscrubber.h"
 #include "libsync/graphapi/spacesmanager.h"
 #include "localdiscoverytracker.h"
 #include "scheduling/syncscheduler.h"
@@ -42,6 +43,10 @@
 #include "common/utility_win.h"
 #endif
 
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaEnum>
 #include <QTimer>
 #include <QUrl>
 #include <QDir>
@@ -57,6 +62,40 @@ namespace {
  */
 constexpr int retrySyncLimitC = 3;
 
+// cap of the journal history table and the batch size at which pending
+// completed-item summaries are flushed to it during a running sync
+constexpr qint64 maxHistoryEntriesC = 20000;
+constexpr int historyFlushBatchSizeC = 5000;
+
+/* How long a folder needs to stay idle after a sync before we run the
+ * expensive truncating WAL checkpoint on its journal.
+ */
+constexpr auto walCheckpointIdleDelayC = 30s;
+
+/* Set OWNCLOUD_PREDICTIVE_HYDRATION=1 to pre-hydrate the remaining virtual
+ * files of a directory once this many of them were implicitly hydrated
+ * within the given window. See Folder::maybePreHydrateSiblings().
+ */
+bool preHydrateSiblingsEnabled()
+{
+    static const bool enabled = qEnvironmentVariableIntValue("OWNCLOUD_PREDICTIVE_HYDRATION") > 0;
+    return enabled;
+}
+
+constexpr int preHydrateSiblingThresholdC = 2;
+constexpr qint64 preHydrateSiblingWindowMsC = 60 * 1000;
+
+/* Set OWNCLOUD_SCRUB_RATE to a number of MB/s to enable the background
+ * integrity scrubber: idle folders then slowly re-verify local files
+ * against the checksums recorded at sync time and re-download files that
+ * no longer match. See IntegrityScrubber.
+ */
+qint64 scrubRateBytesPerSecond()
+{
+    static const qint64 rate = qint64(qEnvironmentVariableIntValue("OWNCLOUD_SCRUB_RATE")) * 1024 * 1024;
+    return rate;
+}
+
 auto davUrlC()
 {
     return QStringLiteral("davUrl");
@@ -90,6 +129,41 @@ using namespace FileSystem::SizeLiterals;
 
 Q_LOGGING_CATEGORY(lcFolder, "gui.folder", QtInfoMsg)
 
+namespace {
+
+    /* Appends one JSON object per finished sync to the file named by
+     * OWNCLOUD_METRICS_OUT (a path, so /dev/fd/N works for wrapper scripts
+     * that pass a descriptor). Fleet automation aggregates these lines
+     * instead of parsing the human-readable log; bump schemaVersion
+     * whenever a field changes meaning.
+     */
+    void appendMetricsOut(const QByteArray &folderId, const QString &spaceId, const char *status, const QStringList &errors,
+        std::chrono::milliseconds duration, const QJsonObject &performanceReport)
+    {
+        static const QString path = QString::fromLocal8Bit(qgetenv("OWNCLOUD_METRICS_OUT"));
+        if (path.isEmpty()) {
+            return;
+        }
+        const QJsonObject entry {
+            { QStringLiteral("schemaVersion"), 1 },
+            { QStringLiteral("timestamp"), QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs) },
+            { QStringLiteral("folder"), QString::fromUtf8(folderId) },
+            { QStringLiteral("space"), spaceId },
+            { QStringLiteral("status"), QString::fromLatin1(status) },
+            { QStringLiteral("errors"), QJsonArray::fromStringList(errors) },
+            { QStringLiteral("durationMs"), static_cast<qint64>(duration.count()) },
+            { QStringLiteral("performance"), performanceReport },
+        };
+        QFile out(path);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qCWarning(lcFolder) << "Cannot open metrics output file" << path << ":" << out.errorString();
+            return;
+        }
+        out.write(QJsonDocument(entry).toJson(QJsonDocument::Compact) + '\n');
+    }
+
+} // anonymous namespace
+
 Folder::Folder(const FolderDefinition &definition, AccountState *accountState, SyncJournalDb *journal, Vfs *vfs, SyncEngine *engine, QObject *parent)
     : QObject(parent)
     , _accountState(accountState)
@@ -123,6 +197,15 @@ Folder::Folder(const FolderDefinition &definition, AccountState *accountState, S
 
     connect(_accountState, &AccountState::isConnectedChanged, this, &Folder::canSyncChanged);
 
+    // Schema migrations on a big journal can take a while after an upgrade;
+    // show the folder as preparing instead of appearing hung.
+    connect(_journal, &SyncJournalDb::migrationProgress, this, [this](const QString &step, qint64 done, qint64 total) {
+        qCInfo(lcFolder) << "Journal migration" << step << ":" << done << "of" << total << "rows";
+        if (_syncResult.status() == SyncResult::NotYetStarted) {
+            setSyncState(SyncResult::SyncPrepare);
+        }
+    });
+
     // connect engine to folderman:
     connect(_engine, &SyncEngine::seenLockedFile, FolderMan::instance(), &FolderMan::slotSyncOnceFileUnlocks);
 
@@ -138,10 +221,24 @@ Folder::Folder(const FolderDefinition &definition, AccountState *accountState, S
 
     connect(_engine, &SyncEngine::transmissionProgress, this, &Folder::progressUpdate);
     connect(_engine, &SyncEngine::itemCompleted, this, &Folder::slotItemCompleted);
+    connect(_engine, &SyncEngine::transferMetrics, this, [this](const TransferMetrics &metrics) { _syncResult.registerTransferMetrics(metrics); });
     connect(_engine, &SyncEngine::aboutToPropagate, this, &Folder::slotLogPropagationStart);
     connect(_engine, &SyncEngine::syncError, this, &Folder::slotSyncError);
     connect(_engine, &SyncEngine::excluded, this, [this](const QString &path) { Q_EMIT ProgressDispatcher::instance()->excluded(this, path); });
 
+    if (scrubRateBytesPerSecond() > 0) {
+        _scrubber = new IntegrityScrubber(path(), _journal, scrubRateBytesPerSecond(), this);
+        connect(_scrubber, &IntegrityScrubber::corruptionDetected, this, [this](const QString &relativePath) {
+            qCWarning(lcFolder) << "Scheduling a re-download of the corrupted file" << relativePath;
+            // Invalidating the etag makes the next sync fetch the file's
+            // metadata from the server; the local copy still matches the
+            // journal, so the differing checksum comes down as a plain
+            // remote update, without a conflict copy.
+            _journal->schedulePathForRemoteDiscovery(relativePath);
+            FolderMan::instance()->scheduler()->enqueueFolder(this);
+        });
+    }
+
     // setup local discovery tracker
     _localDiscoveryTracker = new LocalDiscoveryTracker(this);
     connect(_engine, &SyncEngine::finished, _localDiscoveryTracker, &LocalDiscoveryTracker::slotSyncFinished);
@@ -191,13 +288,24 @@ SyncOptions Folder::loadSyncOptions()
         return SyncOptions();
 
     SyncOptions opt(_vfs);
-    opt._parallelNetworkJobs = _accountState->account()->isHttp2Supported() ? 20 : 6;
+    // With HTTP/2 the jobs share a few multiplexed connections, so the value
+    // is the target number of concurrent streams rather than TCP sockets and
+    // a much higher fan-out is cheap.
+    int http2Streams = qEnvironmentVariableIntValue("OWNCLOUD_HTTP2_CONCURRENT_STREAMS");
+    if (http2Streams <= 0)
+        http2Streams = 20;
+    opt._parallelNetworkJobs = _accountState->account()->isHttp2Supported() ? http2Streams : 6;
 
     // apparently the env can override the default
     int maxParallel = qEnvironmentVariableIntValue("OWNCLOUD_MAX_PARALLEL");
     if (maxParallel > 0)
         opt._parallelNetworkJobs = maxParallel;
 
+    // discovery fan-out can be tuned independently, 0 derives it from the above
+    int maxParallelDiscovery = qEnvironmentVariableIntValue("OWNCLOUD_MAX_PARALLEL_DISCOVERY");
+    if (maxParallelDiscovery > 0)
+        opt._parallelDiscoveryJobs = maxParallelDiscovery;
+
     return opt;
 }
 
@@ -465,6 +573,16 @@ void Folder::startVfs()
         _engine->setSyncOptions(loadSyncOptions());
         registerFolderWatcher();
 
+        // Replay the vfs intent log: placeholder transitions that were still
+        // in flight when the last process ended may have left the on-disk
+        // state and the journal disagreeing. Re-inspect just those paths, a
+        // full tree walk is not needed for crash recovery.
+        const auto pendingVfsIntents = _journal->getAndClearVfsIntents();
+        for (const auto &intentPath : pendingVfsIntents) {
+            qCInfo(lcFolder) << "Replaying vfs intent for" << intentPath;
+            schedulePathForLocalDiscovery(QString::fromUtf8(intentPath));
+        }
+
         connect(_vfs, &Vfs::needSync, this, [this] {
             if (canSync()) {
                 // the vfs plugin detected that its metadata is out of sync and requests a new sync
@@ -516,6 +634,14 @@ void Folder::slotWatchedPathsChanged(const QSet<QString> &paths, ChangeReason re
         // we might be switching backend
         return;
     }
+
+    // Single-file events that only changed the mtime are verified against
+    // the journal instead of scheduling a whole sync run.
+    if (reason == ChangeReason::Other && paths.size() == 1 && !isSyncRunning()
+        && maybeHandleTouchOnlyChange(*paths.cbegin())) {
+        return;
+    }
+
     bool needSync = false;
     for (const auto &path : paths) {
         Q_ASSERT(FileSystem::isChildPathOf(path, this->path()));
@@ -575,10 +701,71 @@ void Folder::slotWatchedPathsChanged(const QSet<QString> &paths, ChangeReason re
         needSync = true;
     }
     if (needSync && canSync()) {
-        FolderMan::instance()->scheduler()->enqueueFolder(this);
+        auto *scheduler = FolderMan::instance()->scheduler();
+        // watcher activity heats up the folder's periodic re-sync interval
+        scheduler->recordActivity(this);
+        scheduler->enqueueFolder(this);
     }
 }
 
+bool Folder::maybeHandleTouchOnlyChange(const QString &path)
+{
+    if (!FileSystem::isChildPathOf(path, this->path())) {
+        return false;
+    }
+    const QString relativePath = path.mid(this->path().size());
+
+    SyncJournalFileRecord record;
+    _journal->getFileRecord(relativePath.toUtf8(), &record);
+    if (!record.isValid() || !record.isFile() || record.isVirtualFile()) {
+        return false;
+    }
+    const auto checksumHeader = ChecksumHeader::parseChecksumHeader(record._checksumHeader);
+    if (!checksumHeader.isValid()) {
+        return false;
+    }
+
+    const QFileInfo info(path);
+    if (!info.isFile()) {
+        return false;
+    }
+    const time_t modtime = FileSystem::getModTime(path);
+    quint64 inode = 0;
+    if (FileSystem::getSize(info) != record._fileSize || modtime == record._modtime
+        || !FileSystem::getInode(path, &inode) || inode != record._inode) {
+        // Not an mtime-only candidate (or spurious), the regular path handles it.
+        return false;
+    }
+
+    // As in the regular path: remember the touch so a later sync re-checks
+    // the file even if the verification below is overtaken by events.
+    _localDiscoveryTracker->addTouchedPath(relativePath);
+
+    qCDebug(lcFolder) << "Verifying potential touch-only change of" << relativePath;
+    auto computeChecksum = new ComputeChecksum(this);
+    computeChecksum->setChecksumType(checksumHeader.type());
+    connect(computeChecksum, &ComputeChecksum::done, computeChecksum, &QObject::deleteLater);
+    connect(computeChecksum, &ComputeChecksum::done, this,
+        [this, path, relativePath, record, modtime, expected = checksumHeader.checksum()](CheckSums::Algorithm, const QByteArray &checksum) mutable {
+            if (!checksum.isEmpty() && checksum == expected && !isSyncRunning()
+                && FileSystem::getModTime(path) == modtime
+                && FileSystem::getSize(QFileInfo { path }) == record._fileSize) {
+                qCInfo(lcFolder) << "Touch-only change of" << relativePath << "- updating the journal mtime without a sync run";
+                record._modtime = modtime;
+                _journal->setFileRecord(record);
+                return;
+            }
+            // The content did change after all (or keeps changing), go
+            // through the regular scheduling.
+            _engine->pathTouched(path);
+            if (canSync()) {
+                FolderMan::instance()->scheduler()->enqueueFolder(this);
+            }
+        });
+    computeChecksum->start(path);
+    return true;
+}
+
 void Folder::implicitlyHydrateFile(const QString &relativepath)
 {
     qCInfo(lcFolder) << "Implicitly hydrate virtual file:" << relativepath;
@@ -606,9 +793,34 @@ void Folder::implicitlyHydrateFile(const QString &relativepath)
 
     // Add to local discovery
     schedulePathForLocalDiscovery(relativepath);
+
+    maybePreHydrateSiblings(relativepath);
+
     FolderMan::instance()->scheduler()->enqueueFolder(this);
 }
 
+void Folder::maybePreHydrateSiblings(const QString &relativepath)
+{
+    if (!preHydrateSiblingsEnabled())
+        return;
+
+    const int slash = relativepath.lastIndexOf(QLatin1Char('/'));
+    const QString dir = slash < 0 ? QString() : relativepath.left(slash);
+
+    auto &burst = _hydrationBursts[dir];
+    if (burst.count > 0 && burst.lastRequest.hasExpired(preHydrateSiblingWindowMsC)) {
+        burst.count = 0;
+    }
+    burst.lastRequest.start();
+    if (++burst.count < preHydrateSiblingThresholdC)
+        return;
+
+    qCInfo(lcFolder) << "Pre-hydrating remaining virtual files in" << dir;
+    burst.count = 0;
+    _journal->markVirtualFileForDownloadRecursively(dir.toUtf8());
+    schedulePathForLocalDiscovery(dir);
+}
+
 void Folder::setVirtualFilesEnabled(bool enabled)
 {
     Vfs::Mode newMode = _definition.virtualFilesMode();
@@ -817,6 +1029,9 @@ void Folder::startSync()
     _timeSinceLastSyncStart.start();
     setSyncState(SyncResult::SyncPrepare);
     _syncResult.reset();
+    if (_scrubber) {
+        _scrubber->stop();
+    }
 
     qCInfo(lcFolder) << "*** Start syncing " << remoteUrl().toString() << "client version"
                      << Theme::instance()->aboutVersions(Theme::VersionFormat::OneLiner);
@@ -833,15 +1048,24 @@ void Folder::startSync()
     // get the latest touched files
     // this will enqueue this folder again, it doesn't matter
     slotWatchedPathsChanged(_folderWatcher->popChangeSet(), Folder::ChangeReason::Other);
+    // everything up to here is covered by the journal once this sync succeeds
+    _folderWatcher->recordSyncBaseline();
 
     const std::chrono::milliseconds fullLocalDiscoveryInterval = ConfigFile().fullLocalDiscoveryInterval();
     const bool hasDoneFullLocalDiscovery = _timeSinceLastFullLocalDiscovery.isValid();
     // negative fullLocalDiscoveryInterval means we don't require periodic full runs
     const bool periodicFullLocalDiscoveryNow =
         fullLocalDiscoveryInterval.count() >= 0 && _timeSinceLastFullLocalDiscovery.hasExpired(fullLocalDiscoveryInterval.count());
+    // A watcher that replayed persisted platform events on startup covers
+    // the offline gap, a full local walk is not needed in that case either.
+    const bool coversOfflineGap = _folderWatcher && _folderWatcher->resumedFromPersistedState();
+    // Optionally trust the journal for the first sync after process start:
+    // the startup walk over a large placeholder tree is skipped, offline
+    // changes are caught up by the next periodic full local discovery.
+    const bool trustJournalAtStartup = !hasDoneFullLocalDiscovery && ConfigFile().trustJournalAtStartup();
     if (_folderWatcher && _folderWatcher->isReliable()
-        && hasDoneFullLocalDiscovery
-        && !periodicFullLocalDiscoveryNow) {
+        && (hasDoneFullLocalDiscovery || coversOfflineGap || trustJournalAtStartup)
+        && !(hasDoneFullLocalDiscovery && periodicFullLocalDiscoveryNow)) {
         qCInfo(lcFolder) << "Allowing local discovery to read from the database";
         _engine->setLocalDiscoveryOptions(
             LocalDiscoveryStyle::DatabaseAndFilesystem,
@@ -890,7 +1114,13 @@ void Folder::slotSyncFinished(bool success)
     } else {
         qCInfo(lcFolder) << "SyncEngine finished without problem.";
     }
+    if (_syncResult.numStalledTransfers() > 0) {
+        qCInfo(lcFolder) << _syncResult.numStalledTransfers() << "transfers stalled for a total of" << _syncResult.transferStallTime().count() << "ms";
+    }
+    _syncResult.setPerformanceReport(_engine->performanceReport());
     _fileLog->finish();
+    _journal->addHistoryEntries(_pendingHistoryEntries, maxHistoryEntriesC);
+    _pendingHistoryEntries.clear();
     showSyncResultPopup();
 
     auto anotherSyncNeeded = false;
@@ -926,6 +1156,9 @@ void Folder::slotSyncFinished(bool success)
         if (_engine->lastLocalDiscoveryStyle() == LocalDiscoveryStyle::FilesystemOnly) {
             _timeSinceLastFullLocalDiscovery.start();
         }
+        if (_folderWatcher) {
+            _folderWatcher->commitSyncBaseline();
+        }
     }
 
     if (syncStatus != SyncResult::Undefined) {
@@ -938,6 +1171,9 @@ void Folder::slotSyncFinished(bool success)
     _lastSyncDuration = std::chrono::milliseconds(_timeSinceLastSyncStart.elapsed());
     _timeSinceLastSyncDone.start();
 
+    appendMetricsOut(id(), spaceId(), QMetaEnum::fromType<SyncResult::Status>().valueToKey(syncStatus), _syncResult.errorStrings(), _lastSyncDuration,
+        _syncResult.performanceReport());
+
     // Increment the follow-up sync counter if necessary.
     if (_engine->isAnotherSyncNeeded()) {
         _consecutiveFollowUpSyncs++;
@@ -955,6 +1191,33 @@ void Folder::slotSyncFinished(bool success)
         // the folder again.
         QTimer::singleShot(SyncEngine::minimumFileAgeForUpload, this, [this] { FolderMan::instance()->scheduler()->enqueueFolder(this); });
     }
+
+    // Checkpoint the WAL into the main db file so the next sync and the
+    // SocketAPI get fast reads. Only do the cheap passive variant now; the
+    // expensive truncating checkpoint can stall for seconds on big journals,
+    // so defer it until the folder has been idle for a while.
+    _journal->walCheckpoint(SyncJournalDb::CheckpointMode::Passive);
+    QTimer::singleShot(walCheckpointIdleDelayC, this, &Folder::slotIdleJournalMaintenance);
+}
+
+void Folder::slotIdleJournalMaintenance()
+{
+    if (!isReady() || isSyncRunning()) {
+        // A sync started in the meantime, it will reschedule us when it finishes.
+        return;
+    }
+    _journal->walCheckpoint(SyncJournalDb::CheckpointMode::Truncate);
+    const auto progress = _journal->maintenanceSlice();
+    if (progress && !progress->done) {
+        qCInfo(lcFolder) << "Journal maintenance:" << progress->freePagesRemaining << "free pages left to vacuum";
+        QTimer::singleShot(walCheckpointIdleDelayC, this, &Folder::slotIdleJournalMaintenance);
+        return;
+    }
+    if (_scrubber) {
+        // The journal is in shape, spend the remaining idle time on the
+        // slow checksum walk.
+        _scrubber->start();
+    }
 }
 
 // an item is completed: count the errors and forward to the ProgressDispatcher
@@ -968,6 +1231,26 @@ void Folder::slotItemCompleted(const SyncFileItemPtr &item)
     _syncResult.processCompletedItem(item);
 
     _fileLog->logItem(*item);
+
+    // Queue a compact summary for the journal history table. Only items the
+    // protocol tab would show are persisted, so the restored feed matches the
+    // live one. The instruction is not stored, so the "Downloaded"/"Deleted"
+    // style result text has to be resolved here rather than at display time.
+    if (item->showInProtocolTab()) {
+        SyncJournalDb::HistoryEntry historyEntry;
+        historyEntry.timestamp = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch();
+        historyEntry.path = item->destination();
+        historyEntry.size = item->_size;
+        historyEntry.status = item->_status;
+        historyEntry.direction = item->_direction;
+        historyEntry.message = item->_errorString.isEmpty() ? Progress::asResultString(*item) : item->_errorString;
+        _pendingHistoryEntries.append(historyEntry);
+        if (_pendingHistoryEntries.size() >= historyFlushBatchSizeC) {
+            _journal->addHistoryEntries(_pendingHistoryEntries, maxHistoryEntriesC);
+            _pendingHistoryEntries.clear();
+        }
+    }
+
     Q_EMIT ProgressDispatcher::instance()->itemCompleted(this, item);
 }
 
@@ -43,6 +43,7 @@ class Vfs;
 class SyncEngine;
 class SyncRunFileLog;
 class FolderWatcher;
+class IntegrityScrubber;
 class LocalDiscoveryTracker;
 
 
@@ -424,6 +425,8 @@ public Q_SLOTS:
     bool reloadExcludes();
 
 private Q_SLOTS:
+    /** Incremental journal vacuum and checkpointing while the folder is idle */
+    void slotIdleJournalMaintenance();
     void slotSyncStarted();
     void slotSyncFinished(bool);
 
@@ -453,6 +456,21 @@ private:
 
     SyncOptions loadSyncOptions();
 
+    /**
+     * Short-circuits a single-file watcher event that looks like a touch.
+     *
+     * Editors frequently rewrite files with identical content, so only the
+     * mtime changes. Instead of scheduling a whole sync run for that, the
+     * file's checksum is verified (asynchronously) against the journal: if
+     * the content is unchanged the new mtime is recorded in the journal
+     * directly - exactly what the sync's UPDATE_METADATA would do at far
+     * greater cost - and no sync is scheduled. On a mismatch the sync is
+     * scheduled as usual.
+     *
+     * Returns true when it took over handling of the path.
+     */
+    bool maybeHandleTouchOnlyChange(const QString &path);
+
     /**
      * Sets up this folder's folderWatcher if possible.
      *
@@ -482,6 +500,16 @@ private:
 
     void changeVfsMode(Vfs::Mode newMode);
 
+    /**
+     * Opt-in sibling pre-hydration, called from implicitlyHydrateFile().
+     *
+     * When several files of the same directory are implicitly hydrated in
+     * short succession, the application the user works with will likely
+     * open the remaining ones too (CAD assemblies, photo albums, ...), so
+     * the directory's other placeholders are marked for download as well.
+     */
+    void maybePreHydrateSiblings(const QString &relativepath);
+
     QPointer<AccountState> _accountState;
     FolderDefinition _definition;
 
@@ -509,6 +537,10 @@ private:
     // ehhh...it's not a qobject so this actually makes sense.
     QScopedPointer<SyncRunFileLog> _fileLog;
 
+    // completed-item summaries queued for the journal history table,
+    // flushed in batches while syncing and once more when the sync ends
+    QVector<SyncJournalDb::HistoryEntry> _pendingHistoryEntries;
+
     QTimer _scheduleSelfTimer;
 
     /**
@@ -535,5 +567,15 @@ private:
      * Keeps track of locally dirty files so we can skip local discovery sometimes.
      */
     LocalDiscoveryTracker *_localDiscoveryTracker = nullptr;
+    /// Opt-in background checksum verification, see scrubRateBytesPerSecond()
+    IntegrityScrubber *_scrubber = nullptr;
+
+    /// Recent implicit hydration requests per directory, see maybePreHydrateSiblings()
+    struct HydrationBurst
+    {
+        QElapsedTimer lastRequest;
+        int count = 0;
+    };
+    QHash<QString, HydrationBurst> _hydrationBursts;
 };
 }
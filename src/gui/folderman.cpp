@@ -38,15 +38,25 @@
 #include "common/utility_win.h"
 #endif
 
+#include <QCoreApplication>
 #include <QMessageBox>
 #include <QMutableSetIterator>
 #include <QNetworkProxy>
+#include <QScopeGuard>
 #include <QStringLiteral>
+#include <QtConcurrentMap>
 
 using namespace std::chrono;
 using namespace std::chrono_literals;
 
 namespace {
+// Result of preparing one folder journal on the thread pool,
+// see FolderMan::setupFoldersFromConfig().
+struct JournalProbeResult
+{
+    bool dbIsTooNew = false;
+    OCC::SyncJournalDb *journal = nullptr;
+};
 }
 
 namespace OCC {
@@ -202,6 +212,10 @@ std::optional<qsizetype> FolderMan::setupFoldersFromConfig()
     const auto &accountsWithSettings = settings.childGroups();
     qCInfo(lcFolderMan) << "Setup folders from settings file";
 
+    // Pass 1: read the folder definitions, this only touches the settings file.
+    QList<AccountState *> accounts;
+    QList<AccountState *> definitionOwners;
+    QList<FolderDefinition> definitions;
     for (const auto &account : AccountManager::instance()->accounts()) {
         const auto accountIndex = account->account()->groupIndex();
         Q_ASSERT(!accountIndex.isEmpty());
@@ -210,13 +224,74 @@ std::optional<qsizetype> FolderMan::setupFoldersFromConfig()
             continue;
         }
 
-        // Process config for this account.
-        if (!addFoldersFromConfigByAccount(settings, account)) {
+        QList<FolderDefinition> accountDefinitions;
+        if (!collectFolderDefinitionsFromConfig(settings, account, accountDefinitions)) {
             return {};
         }
+        for (const auto &definition : std::as_const(accountDefinitions)) {
+            definitionOwners.append(account);
+            definitions.append(definition);
+        }
+        accounts.append(account);
     }
     settings.endGroup(); // "Accounts"
 
+    // Pass 2: probe, open and upgrade the journals on the thread pool.
+    // Opening a journal is disk bound - with many folders the serial version
+    // blocked startup on the sum of all disks, this blocks on the slowest
+    // one. The results have to be complete before any folder goes live
+    // because a detected downgrade aborts the whole application startup.
+    const QList<JournalProbeResult> probes = QtConcurrent::blockingMapped(definitions, [](const FolderDefinition &definition) -> JournalProbeResult {
+        // this can only happen when loading from config
+        // does not belong in general addFolder routine
+        if (SyncJournalDb::dbIsTooNewForClient(definition.absoluteJournalPath())) {
+            return { true, nullptr };
+        }
+        auto *journal = new SyncJournalDb(definition.absoluteJournalPath(), nullptr);
+        if (!journal->open()) {
+            delete journal;
+            return { false, nullptr };
+        }
+        journal->close();
+        journal->allowReopen();
+        // those errors should not persist over sessions so kill them if there are any in an existing journal
+        journal->wipeErrorBlacklistCategory(SyncJournalErrorBlacklistRecord::Category::LocalSoftError);
+        // hand the journal over to the gui thread, the folder builder takes ownership
+        journal->moveToThread(qApp->thread());
+        return { false, journal };
+    });
+
+    if (std::any_of(probes.cbegin(), probes.cend(), [](const JournalProbeResult &probe) { return probe.dbIsTooNew; })) {
+        for (const auto &probe : probes) {
+            delete probe.journal;
+        }
+        return {};
+    }
+
+    // Pass 3: create the folders, the disk-heavy journal work is already done.
+    for (qsizetype i = 0; i < definitions.size(); ++i) {
+        if (!probes.at(i).journal) {
+            qCWarning(lcFolderMan) << "Could not open database when creating new folder:" << definitions.at(i).absoluteJournalPath() << ". Skipping folder.";
+            continue;
+        }
+
+        Folder *folder = addFolder(definitionOwners.at(i), definitions.at(i), probes.at(i).journal);
+        if (!folder) {
+            // todo: decide if we should actively remove the folder data from the config! I think we should but let's see
+            continue;
+        }
+
+        // this is checked before the spaces manager has loaded the spaces so it will always be null.
+        // this is a bit odd for now as in the gui it shows the unavailable state until after login. I think
+        // in most cases this will be ok as it's not a common workflow, we just have it on demo
+        // if we don't set this here a sync will be attempted, then it just shows as failed.
+        folder->setAvailable(folder->space() != nullptr);
+    }
+
+    for (auto *account : std::as_const(accounts)) {
+        finishAccountFolderSetup(account);
+    }
+
     if (!_folders.empty()) {
         // couldn't this be "schedule new folders"?
         scheduleAllFolders();
@@ -226,7 +301,7 @@ std::optional<qsizetype> FolderMan::setupFoldersFromConfig()
     return _folders.size();
 }
 
-bool FolderMan::addFoldersFromConfigByAccount(QSettings &settings, AccountState *account)
+bool FolderMan::collectFolderDefinitionsFromConfig(QSettings &settings, AccountState *account, QList<FolderDefinition> &definitions)
 {
     if (!account || !account->account() || !account->account()->spacesManager())
         return false;
@@ -240,29 +315,17 @@ bool FolderMan::addFoldersFromConfigByAccount(QSettings &settings, AccountState
         FolderDefinition folderDefinition = FolderDefinition::load(settings, folderAlias.toUtf8());
         // this should NEVER happen
         Q_ASSERT(!folderDefinition.id().isEmpty());
-
-        // this can only happen when loading from config
-        // does not belong in general addFolder routine
-        if (SyncJournalDb::dbIsTooNewForClient(folderDefinition.absoluteJournalPath())) {
-            return false;
-        }
-
-        Folder *folder = addFolder(account, folderDefinition);
-        if (!folder) {
-            // todo: decide if we should actively remove the folder data from the config! I think we should but let's see
-            continue;
-        }
-
-        // this is checked before the spaces manager has loaded the spaces so it will always be null.
-        // this is a bit odd for now as in the gui it shows the unavailable state until after login. I think
-        // in most cases this will be ok as it's not a common workflow, we just have it on demo
-        // if we don't set this here a sync will be attempted, then it just shows as failed.
-        folder->setAvailable(folder->space() != nullptr);
+        definitions.append(folderDefinition);
 
         settings.endGroup(); // folderAlias
     }
     settings.endGroup(); // accountId\Folders
 
+    return true;
+}
+
+void FolderMan::finishAccountFolderSetup(AccountState *account)
+{
     GraphApi::SpacesManager *spaceMan = account->account()->spacesManager();
     _scheduler->connectSpacesManager(spaceMan);
     connect(spaceMan, &GraphApi::SpacesManager::spacesAdded, this, &FolderMan::onSpacesAdded);
@@ -274,8 +337,6 @@ bool FolderMan::addFoldersFromConfigByAccount(QSettings &settings, AccountState
     int spaceCount = spaceMan->spacesCount();
     int unsyncedCount = _unsyncedSpaces.contains(accountId) ? _unsyncedSpaces[accountId].count() : 0;
     emit unsyncedSpaceCountChanged(accountId, unsyncedCount, spaceCount);
-
-    return true;
 }
 
 void FolderMan::setUpInitialSyncFolders(AccountState *accountState, bool useVfs)
@@ -722,8 +783,11 @@ bool FolderMan::validateFolderDefinition(const FolderDefinition &folderDefinitio
 }
 
 
-Folder *FolderMan::addFolder(AccountState *accountState, const FolderDefinition &folderDefinition)
+Folder *FolderMan::addFolder(AccountState *accountState, const FolderDefinition &folderDefinition, SyncJournalDb *preparedJournal)
 {
+    // the prepared journal is ours until the builder takes it
+    auto discardPreparedJournal = qScopeGuard([&preparedJournal] { delete preparedJournal; });
+
     if (!accountState || !accountState->account())
         return nullptr;
 
@@ -740,6 +804,10 @@ Folder *FolderMan::addFolder(AccountState *accountState, const FolderDefinition
     }
 
     FolderBuilder builder(folderDefinition);
+    if (preparedJournal) {
+        builder.setPreparedJournal(preparedJournal);
+        preparedJournal = nullptr;
+    }
     auto folder = builder.buildFolder(accountState, _ignoreHiddenFiles, _moveToTrash, this);
 
     if (!folder) {
@@ -904,13 +972,24 @@ void FolderMan::deleteFolderSync(Folder *f)
 
     qCInfo(lcFolderMan) << "Removing " << f->path();
 
+    // Disconnect our slots first: the folder is going away, so its pause
+    // and canSync notifications below must not write settings back or
+    // re-trigger scheduling for the remaining folders. The engine-internal
+    // connections stay up until the sync has been terminated.
+    if (!f->hasSetupError()) {
+        _socketApi->slotUnregisterPath(f);
+        disconnect(f, nullptr, this, nullptr);
+        disconnect(f, nullptr, _socketApi.get(), nullptr);
+    }
+    _disabledFolders.remove(f);
+
     const bool currentlyRunning = f->isSyncRunning();
     if (currentlyRunning) {
         // abort the sync now
         f->slotTerminateSync(tr("Folder is about to be removed"));
     }
 
-    // this aborts any running sync so the sync engine should be idle 
+    // this aborts any running sync so the sync engine should be idle
     f->setSyncPaused(true);
 
     // this function includes the stuff to remove the database files.
@@ -1217,8 +1296,11 @@ void FolderMan::addFolderFromGui(AccountState *accountState, const SyncConnectio
     if (!accountState || !accountState->account())
         return;
 
-    setSyncEnabled(false);
-
+    // Deliberately no global setSyncEnabled() toggle here: adding a folder
+    // only touches the new Folder object and its own config section. The
+    // scheduler stop/start that used to bracket this caused a reschedule
+    // pass over every folder for each one added, which adds up when scripts
+    // provision many folders in a row.
     FolderDefinition definition(description.davUrl, description.spaceId, description.displayName);
     definition.setLocalPath(description.localPath);
     definition.setTargetPath(description.remotePath);
@@ -1242,7 +1324,6 @@ void FolderMan::addFolderFromGui(AccountState *accountState, const SyncConnectio
 
         _scheduler->enqueueFolder(f, SyncScheduler::Priority::High);
     }
-    setSyncEnabled(true);
 }
 
 QString FolderMan::suggestSyncFolder(NewFolderType folderType, const QUuid &accountUuid)
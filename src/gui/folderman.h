@@ -35,6 +35,7 @@ class Application;
 class SyncResult;
 class SocketApi;
 class LockWatcher;
+class SyncJournalDb;
 
 /**
  * @brief Return object for Folder::trayOverallStatus.
@@ -179,8 +180,10 @@ public:
      *  it is up to the caller to create the local sync folder (corresponding to the local path in the def) using the new FolderManagementUtils::prepareFolder,
      *  connect the folder, save it to settings, etc.
      *
+     *  preparedJournal optionally passes in a journal that was already opened and upgraded (on another
+     *  thread, see setupFoldersFromConfig); ownership is taken in any case.
      */
-    Folder *addFolder(AccountState *accountState, const FolderDefinition &folderDefinition);
+    Folder *addFolder(AccountState *accountState, const FolderDefinition &folderDefinition, SyncJournalDb *preparedJournal = nullptr);
 
 
     /**
@@ -408,15 +411,21 @@ private:
     void onSpacesRemoved(const QUuid &accountId, QList<QString> spaceIds, int totalSpaceCount);
 
     /**
-     *  reads the folder defs from the config for a single account.
+     *  reads the folder defs from the config for a single account into definitions.
      *  it is important to use a preconfigured settings instance here instead of using a series of one-off instances, to improve efficiecy
      *  by reducing file operations when loading many folders.
      *
      *  The settings should be configured to group "Accounts" before it's passed to this function.
      *
-     *  returns false when a downgrade of the database is detected, true otherwise.
+     *  returns false when the account is not usable, true otherwise.
      */
-    bool addFoldersFromConfigByAccount(QSettings &settings, AccountState *account);
+    bool collectFolderDefinitionsFromConfig(QSettings &settings, AccountState *account, QList<FolderDefinition> &definitions);
+
+    /**
+     *  per-account post processing after its folders were created: wires up the
+     *  spaces manager and emits the folder list notifications.
+     */
+    void finishAccountFolderSetup(AccountState *account);
 
     // tests folder def for minimum reqs
     bool validateFolderDefinition(const FolderDefinition &folderDefinition);
@@ -47,8 +47,19 @@ Folder *FolderBuilder::buildFolder(AccountState *accountState, bool ignoreHidden
     return nullptr;
 }
 
+void FolderBuilder::setPreparedJournal(SyncJournalDb *journal)
+{
+    _preparedJournal = journal;
+    _preparedJournal->setParent(this);
+}
+
 SyncJournalDb *FolderBuilder::buildJournal()
 {
+    if (_preparedJournal) {
+        // already opened, upgraded and cleaned, typically on the thread pool
+        return _preparedJournal;
+    }
+
     SyncJournalDb *journal = new SyncJournalDb(_definition.absoluteJournalPath(), this);
     if (!journal->open()) {
         qCWarning(lcFolderBuilder) << "Could not open database when creating new folder: " << _definition.absoluteJournalPath() << ". Aborting Folder build.";
@@ -33,6 +33,12 @@ public:
 
     Folder *buildFolder(AccountState *accountState, bool ignoreHiddenFiles, bool moveToTrash, QObject *parent);
 
+    /**
+     * Passes in a journal that was already opened, upgraded and cleaned, so
+     * buildFolder skips that disk-bound work. Takes ownership.
+     */
+    void setPreparedJournal(SyncJournalDb *journal);
+
 
 private:
     SyncJournalDb *buildJournal();
@@ -40,5 +46,6 @@ private:
     SyncEngine *buildEngine(Account *account, SyncJournalDb *journal, bool ignoreHiddenFiles, bool moveToTrash);
 
     FolderDefinition _definition;
+    SyncJournalDb *_preparedJournal = nullptr;
 };
 }
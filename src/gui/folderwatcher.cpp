@@ -34,7 +34,16 @@
 using namespace std::chrono_literals;
 
 namespace {
+// Upper bound on notification latency: during a sustained event storm the
+// change set is flushed at least this often.
 constexpr auto notificationTimeoutC = 10s;
+
+// A burst of events is flushed once no new event arrived for this long.
+constexpr auto quiescenceTimeoutC = 1s;
+
+// Above this many accumulated paths the change set is collapsed to
+// per-directory hints, see FolderWatcher::coalesceChangeSet().
+constexpr int coalesceThresholdC = 1000;
 }
 
 namespace OCC {
@@ -46,13 +55,11 @@ FolderWatcher::FolderWatcher(Folder *folder)
     , _folder(folder)
 {
     _timer.setInterval(notificationTimeoutC);
-    connect(&_timer, &QTimer::timeout, this, [this] {
-        auto paths = popChangeSet();
-        if (!paths.isEmpty()) {
-            qCInfo(lcFolderWatcher) << "Detected changes in paths:" << paths;
-            Q_EMIT pathChanged(paths);
-        }
-    });
+    connect(&_timer, &QTimer::timeout, this, &FolderWatcher::flushChangeSet);
+
+    _quiescenceTimer.setInterval(quiescenceTimeoutC);
+    _quiescenceTimer.setSingleShot(true);
+    connect(&_quiescenceTimer, &QTimer::timeout, this, &FolderWatcher::flushChangeSet);
 }
 
 FolderWatcher::~FolderWatcher()
@@ -61,6 +68,10 @@ FolderWatcher::~FolderWatcher()
 
 void FolderWatcher::init(const QString &root)
 {
+    _root = root;
+    if (!_root.endsWith(QLatin1Char('/'))) {
+        _root += QLatin1Char('/');
+    }
     _d.reset(new FolderWatcherPrivate(this, root));
 }
 
@@ -126,6 +137,25 @@ void FolderWatcher::startNotificationTestWhenReady()
 }
 
 
+void FolderWatcher::recordSyncBaseline()
+{
+    if (_d) {
+        _d->recordSyncBaseline();
+    }
+}
+
+void FolderWatcher::commitSyncBaseline()
+{
+    if (_d) {
+        _d->commitSyncBaseline();
+    }
+}
+
+bool FolderWatcher::resumedFromPersistedState() const
+{
+    return _d && _d->resumedFromPersistedState();
+}
+
 int FolderWatcher::testLinuxWatchCount() const
 {
 #ifdef Q_OS_LINUX
@@ -139,11 +169,49 @@ void FolderWatcher::changeDetected(const QSet<QString> &paths)
 {
     Q_ASSERT(thread() == QThread::currentThread());
     _changeSet.unite(paths);
+    if (_changeSet.size() > coalesceThresholdC) {
+        coalesceChangeSet();
+    }
+    // Flush as soon as the burst is over; the long timer caps the latency
+    // when events keep streaming in.
+    _quiescenceTimer.start();
     if (!_timer.isActive()) {
         _timer.start();
     }
 }
 
+void FolderWatcher::coalesceChangeSet()
+{
+    if (_root.isEmpty()) {
+        return;
+    }
+    QSet<QString> coalesced;
+    coalesced.reserve(_changeSet.size() / 2);
+    for (const auto &path : std::as_const(_changeSet)) {
+        const auto slash = path.lastIndexOf(QLatin1Char('/'));
+        // Entries directly below the sync root are kept as they are, the
+        // root itself must not end up in the change set.
+        if (slash >= _root.size()) {
+            coalesced.insert(path.left(slash));
+        } else {
+            coalesced.insert(path);
+        }
+    }
+    qCInfo(lcFolderWatcher) << "Coalesced" << _changeSet.size() << "changed paths into" << coalesced.size() << "directory hints";
+    _changeSet = std::move(coalesced);
+}
+
+void FolderWatcher::flushChangeSet()
+{
+    _timer.stop();
+    _quiescenceTimer.stop();
+    const auto paths = popChangeSet();
+    if (!paths.isEmpty()) {
+        qCInfo(lcFolderWatcher) << "Detected changes in paths:" << paths;
+        Q_EMIT pathChanged(paths);
+    }
+}
+
 QSet<QString> FolderWatcher::popChangeSet()
 {
     auto paths = std::move(_changeSet);
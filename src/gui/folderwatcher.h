@@ -82,9 +82,44 @@ public:
     /// For testing linux behavior only
     int testLinuxWatchCount() const;
 
+    /**
+     * Snapshot and persist the platform event stream position.
+     *
+     * recordSyncBaseline() is called when a sync starts and snapshots the
+     * current position of the platform event stream; commitSyncBaseline()
+     * persists the snapshot to the journal once that sync succeeded.
+     * Everything up to the snapshot was handed to the engine before the
+     * sync, so the persisted position is fully covered by the journal.
+     * No-ops on platforms without historical event replay.
+     */
+    void recordSyncBaseline();
+    void commitSyncBaseline();
+
+    /**
+     * Whether this watcher replayed persisted events on startup.
+     *
+     * True means changes made while the client was not running were
+     * delivered as regular notifications (FSEvents on macOS), so the first
+     * sync does not need a full local tree walk. Becomes false again if
+     * the platform reports that events were dropped.
+     */
+    bool resumedFromPersistedState() const;
+
     // pop the accumulated changes
     QSet<QString> popChangeSet();
 
+    /**
+     * Collapses the accumulated change set to per-directory hints.
+     *
+     * Event storms - build tools, bulk copies - produce far more individual
+     * paths than the downstream per-path processing (journal lookups, stat
+     * calls, discovery bookkeeping) can afford. Each path is replaced by its
+     * parent directory: local discovery re-lists a touched directory anyway,
+     * so one directory hint covers all its changed entries. When storms keep
+     * overflowing the set, repeated collapsing walks further up the tree.
+     */
+    void coalesceChangeSet();
+
 
 Q_SIGNALS:
     /** Emitted when one of the watched directories or one
@@ -115,9 +150,13 @@ private Q_SLOTS:
     void startNotificationTestWhenReady();
 
 private:
+    void flushChangeSet();
+
     QScopedPointer<FolderWatcherPrivate> _d;
     QTimer _timer;
+    QTimer _quiescenceTimer;
     QSet<QString> _changeSet;
+    QString _root;
     Folder *_folder;
     bool _isReliable = true;
 
@@ -41,8 +41,14 @@ FolderWatcherPrivate::FolderWatcherPrivate(FolderWatcher *p, const QString &path
     QMetaObject::invokeMethod(this, [path, this] { slotAddFolderRecursive(path); });
 }
 
-// attention: result list passed by reference!
-bool FolderWatcherPrivate::findFoldersBelow(const QDir &dir, QStringList &fullList)
+// Registers a watch on every directory below dir, depth first. Each
+// directory is watched *before* its children are listed, so changes that
+// happen while the traversal is still running are queued by the kernel
+// instead of being missed. Ignored subtrees (e.g. build or VCS
+// directories) are pruned entirely - on big working trees descending into
+// them used to dominate setup time. The number of directories added is
+// returned through addedCount.
+bool FolderWatcherPrivate::addFoldersBelow(const QDir &dir, int &addedCount)
 {
     if (!dir.exists()) {
         qCDebug(lcFolderWatcher) << "      - non existing path coming in: " << dir.absolutePath();
@@ -57,8 +63,17 @@ bool FolderWatcherPrivate::findFoldersBelow(const QDir &dir, QStringList &fullLi
     bool ok = true;
     for (const QString &path : dir.entryList({ QStringLiteral("*") }, filter)) {
         const QString fullPath(dir.path() + QLatin1String("/") + path);
-        fullList.append(fullPath);
-        ok &= findFoldersBelow(QDir(fullPath), fullList);
+        if (_pathToWatch.contains(fullPath)) {
+            continue;
+        }
+        // _parent is unset when the traversal is driven directly by the tests
+        if (_parent && _parent->pathIsIgnored(fullPath)) {
+            qCDebug(lcFolderWatcher) << "* Not adding" << fullPath;
+            continue;
+        }
+        ++addedCount;
+        inotifyRegisterPath(fullPath);
+        ok &= addFoldersBelow(QDir(fullPath), addedCount);
     }
     return ok;
 }
@@ -76,7 +91,7 @@ void FolderWatcherPrivate::inotifyRegisterPath(const QString &path)
         _pathToWatch.insert(path, wd);
     } else {
         // If we're running out of memory or inotify watches, become unreliable.
-        if (_parent->_isReliable && (errno == ENOMEM || errno == ENOSPC)) {
+        if (_parent && _parent->_isReliable && (errno == ENOMEM || errno == ENOSPC)) {
             _parent->_isReliable = false;
             Q_EMIT _parent->becameUnreliable(tr("This problem usually happens when the inotify watches are exhausted. "
                                                 "Check the FAQ for details."));
@@ -90,32 +105,17 @@ void FolderWatcherPrivate::slotAddFolderRecursive(const QString &path)
         return;
     }
 
-    int subdirCount = 0;
     qCDebug(lcFolderWatcher) << "(+) Watcher:" << path;
 
     QDir inPath(path);
     inotifyRegisterPath(inPath.absolutePath());
 
-    QStringList allSubfolders;
-    if (!findFoldersBelow(QDir(path), allSubfolders)) {
+    int subdirCount = 0;
+    if (!addFoldersBelow(inPath, subdirCount)) {
         qCWarning(lcFolderWatcher).nospace() << "Could not traverse all sub folders of '"
                                              << path << "'";
     }
 
-    for (const auto &subfolder : std::as_const(allSubfolders)) {
-        QDir folder(subfolder);
-        if (folder.exists() && !_pathToWatch.contains(folder.absolutePath())) {
-            ++subdirCount;
-            if (_parent->pathIsIgnored(subfolder)) {
-                qCDebug(lcFolderWatcher) << "* Not adding" << folder.path();
-                continue;
-            }
-            inotifyRegisterPath(folder.absolutePath());
-        } else {
-            qCDebug(lcFolderWatcher) << "    `-> discarded:" << folder.path();
-        }
-    }
-
     if (subdirCount > 0) {
         qCDebug(lcFolderWatcher) << "    `-> and" << subdirCount << "subdirectories";
     }
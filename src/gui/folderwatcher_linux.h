@@ -42,22 +42,27 @@ public:
     /// On linux the watcher is ready when the ctor finished.
     constexpr bool isReady() const { return true; }
 
+    /// inotify has no historical event replay.
+    void recordSyncBaseline() { }
+    void commitSyncBaseline() { }
+    constexpr bool resumedFromPersistedState() const { return false; }
+
 protected Q_SLOTS:
     void slotReceivedNotification(int fd);
     void slotAddFolderRecursive(const QString &path);
 
 protected:
-    bool findFoldersBelow(const QDir &dir, QStringList &fullList);
+    bool addFoldersBelow(const QDir &dir, int &addedCount);
     void inotifyRegisterPath(const QString &path);
     void removeFoldersBelow(const QString &path);
 
 private:
-    FolderWatcher *_parent;
+    FolderWatcher *_parent = nullptr;
 
     QString _folder;
     QHash<int, QString> _watchToPath;
     QMap<QString, int> _pathToWatch;
     QScopedPointer<QSocketNotifier> _socket;
-    int _fd;
+    int _fd = -1;
 };
 }
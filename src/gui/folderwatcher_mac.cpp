@@ -15,11 +15,20 @@
 #include "folderwatcher.h"
 #include "folderwatcher_mac.h"
 
+#include "common/syncjournaldb.h"
+#include "folder.h"
+
 #include <cerrno>
 
 #include <QScopeGuard>
 #include <QStringList>
 
+namespace {
+// Journal key for the last FSEvents event id that is fully covered by the
+// journal, see FolderWatcher::recordSyncBaseline().
+const QString fsEventsLastEventIdC = QStringLiteral("fseventsLastEventId");
+}
+
 
 namespace OCC {
 
@@ -46,7 +55,6 @@ static void callback(
     const FSEventStreamEventId eventIds[])
 {
     Q_UNUSED(streamRef)
-    Q_UNUSED(eventFlags)
     Q_UNUSED(eventIds)
 
     const FSEventStreamEventFlags c_interestingFlags =
@@ -57,13 +65,28 @@ static void callback(
         | kFSEventStreamEventFlagItemModified; // for content change
     // We ignore other flags, e.g. for owner change, xattr change, Finder label change etc
 
+    // When these are set the event does not describe a single change - the
+    // whole subtree below the path must be rescanned.
+    const FSEventStreamEventFlags c_lostEventsFlags =
+        kFSEventStreamEventFlagMustScanSubDirs
+        | kFSEventStreamEventFlagUserDropped
+        | kFSEventStreamEventFlagKernelDropped;
+
     QSet<QString> paths;
+    bool lostEvents = false;
     CFArrayRef eventPaths = static_cast<CFArrayRef>(eventPathsVoid);
 
     for (CFIndex i = 0; i < static_cast<CFIndex>(numEvents); ++i) {
         auto cfPath = reinterpret_cast<CFStringRef>(CFArrayGetValueAtIndex(eventPaths, i));
         const auto qPath = QString::fromCFString(cfPath).normalized(QString::NormalizationForm_C);
 
+        if (eventFlags[i] & c_lostEventsFlags) {
+            qCWarning(lcFolderWatcher) << "FSEvents dropped events below" << qPath;
+            paths.insert(qPath);
+            lostEvents = true;
+            continue;
+        }
+
         if (!(eventFlags[i] & c_interestingFlags)) {
             qCDebug(lcFolderWatcher) << "Ignoring non-content changes for" << qPath;
             continue;
@@ -72,8 +95,12 @@ static void callback(
         paths.insert(qPath);
     }
 
+    auto watcher = reinterpret_cast<FolderWatcherPrivate *>(clientCallBackInfo);
+    if (lostEvents) {
+        watcher->doNotifyLostEvents();
+    }
     if (!paths.isEmpty()) {
-        reinterpret_cast<FolderWatcherPrivate *>(clientCallBackInfo)->doNotifyParent(paths);
+        watcher->doNotifyParent(paths);
     }
 }
 
@@ -91,11 +118,24 @@ void FolderWatcherPrivate::startWatching()
 
     // TODO: Add kFSEventStreamCreateFlagFileEvents ?
 
+    // Resume from the event id persisted after the last successful sync, so
+    // changes made while the client was not running arrive as regular
+    // notifications instead of requiring a full local tree walk.
+    FSEventStreamEventId sinceWhen = kFSEventStreamEventIdSinceNow;
+    if (auto *db = journal()) {
+        const qint64 persisted = db->keyValueStoreGetInt(fsEventsLastEventIdC, 0);
+        if (persisted > 0) {
+            sinceWhen = static_cast<FSEventStreamEventId>(persisted);
+            _resumedFromPersistedState = true;
+            qCInfo(lcFolderWatcher) << "Replaying FSEvents since event id" << persisted << "for" << _folder;
+        }
+    }
+
     _stream = FSEventStreamCreate(nullptr,
         &callback,
         &ctx,
         pathsToWatch,
-        kFSEventStreamEventIdSinceNow,
+        sinceWhen,
         0, // latency
         kFSEventStreamCreateFlagUseCFTypes | kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagIgnoreSelf);
 
@@ -108,5 +148,34 @@ void FolderWatcherPrivate::doNotifyParent(const QSet<QString> &paths)
     _parent->changeDetected(paths);
 }
 
+void FolderWatcherPrivate::doNotifyLostEvents()
+{
+    // The replayed history is incomplete now, the next sync must walk the
+    // full local tree again.
+    _resumedFromPersistedState = false;
+    Q_EMIT _parent->lostChanges();
+}
+
+void FolderWatcherPrivate::recordSyncBaseline()
+{
+    _syncBaseline = FSEventsGetCurrentEventId();
+}
+
+void FolderWatcherPrivate::commitSyncBaseline()
+{
+    if (_syncBaseline == 0) {
+        return;
+    }
+    if (auto *db = journal()) {
+        db->keyValueStoreSet(fsEventsLastEventIdC, static_cast<qint64>(_syncBaseline));
+    }
+}
+
+SyncJournalDb *FolderWatcherPrivate::journal() const
+{
+    // _parent->_folder is unset in the tests
+    return _parent && _parent->_folder ? _parent->_folder->journalDb() : nullptr;
+}
+
 
 } // ns mirall
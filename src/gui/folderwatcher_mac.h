@@ -24,6 +24,7 @@
 namespace OCC {
 
 class FolderWatcher;
+class SyncJournalDb;
 
 /**
  * @brief Mac OS X API implementation of FolderWatcher
@@ -37,16 +38,30 @@ public:
 
     void startWatching();
     void doNotifyParent(const QSet<QString> &);
+    void doNotifyLostEvents();
 
     /// On OSX the watcher is ready when the ctor finished.
     constexpr bool isReady() const { return true; }
 
+    /// Snapshots the current FSEvents stream position.
+    void recordSyncBaseline();
+    /// Persists the snapshot to the journal, see FolderWatcher::commitSyncBaseline().
+    void commitSyncBaseline();
+    /// Whether the stream was created from a persisted event id, replaying
+    /// the events that happened while the client was not running.
+    bool resumedFromPersistedState() const { return _resumedFromPersistedState; }
+
 private:
+    SyncJournalDb *journal() const;
+
     FolderWatcher *_parent;
 
     QString _folder;
 
     FSEventStreamRef _stream;
+
+    FSEventStreamEventId _syncBaseline = 0;
+    bool _resumedFromPersistedState = false;
 };
 
 } // namespace OCC
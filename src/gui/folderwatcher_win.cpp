@@ -27,6 +27,18 @@
 #include <stdio.h>
 #include <tchar.h>
 
+namespace {
+
+// ReadDirectoryChangesW rejects buffers above 64 KiB for directories on
+// network paths, see the API documentation.
+constexpr size_t networkPathBufferLimitC = 64 * 1024;
+
+// Local NTFS accepts multi-megabyte buffers; overflows double the buffer
+// up to this bound.
+constexpr size_t maxBufferSizeC = 4 * 1024 * 1024;
+
+}
+
 namespace OCC {
 
 WatcherThread::WatchChanges WatcherThread::watchChanges(size_t fileNotifyBufferSize)
@@ -51,7 +63,7 @@ WatcherThread::WatchChanges WatcherThread::watchChanges(size_t fileNotifyBufferS
     overlapped.hEvent = _resultEvent;
 
     // QVarLengthArray ensures the stack-buffer is aligned like double and qint64.
-    QVarLengthArray<char, 4096 * 10> fileNotifyBuffer;
+    QVarLengthArray<char, networkPathBufferLimitC> fileNotifyBuffer;
     fileNotifyBuffer.resize(static_cast<int>(fileNotifyBufferSize));
 
     while (true) {
@@ -70,8 +82,12 @@ WatcherThread::WatchChanges WatcherThread::watchChanges(size_t fileNotifyBufferS
             const DWORD errorCode = GetLastError();
             if (errorCode == ERROR_NOTIFY_ENUM_DIR) {
                 qCDebug(lcFolderWatcher) << "The buffer for changes overflowed! Triggering a generic change and resizing";
+                Q_EMIT lostChanges();
                 Q_EMIT changed({_path});
                 return WatchChanges::NeedBiggerBuffer;
+            } else if (errorCode == ERROR_INVALID_PARAMETER && fileNotifyBufferSize > networkPathBufferLimitC) {
+                qCWarning(lcFolderWatcher) << "Buffer of" << fileNotifyBufferSize << "bytes is too large for" << _path << "(network path?), clamping";
+                return WatchChanges::BufferTooLarge;
             } else {
                 qCWarning(lcFolderWatcher) << "ReadDirectoryChangesW error" << Utility::formatWinError(errorCode);
                 return WatchChanges::Error;
@@ -171,15 +187,19 @@ void WatcherThread::run()
     _resultEvent = CreateEvent(nullptr, true, false, nullptr);
     _stopEvent = CreateEvent(nullptr, true, false, nullptr);
 
-    // If this buffer fills up before we've extracted its data we will lose
-    // change information. Therefore start big.
-    size_t bufferSize = 4096 * 10;
-    const size_t maxBuffer = 64 * 1024;
+    // If this buffer fills up before we've extracted its data we lose change
+    // information and the whole folder needs a local rediscovery - on big
+    // sync folders that is far more expensive than the memory spent here.
+    // Start at the limit that is safe everywhere and grow on overflow.
+    size_t bufferSize = networkPathBufferLimitC;
 
     while (true) {
         switch (watchChanges(bufferSize)) {
         case WatchChanges::NeedBiggerBuffer:
-            bufferSize = qMin(bufferSize * 2, maxBuffer);
+            bufferSize = qMin(bufferSize * 2, maxBufferSizeC);
+            continue;
+        case WatchChanges::BufferTooLarge:
+            bufferSize = networkPathBufferLimitC;
             continue;
         case WatchChanges::Done:
             return;
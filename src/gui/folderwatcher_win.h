@@ -41,6 +41,9 @@ protected:
     enum class WatchChanges {
         Done,
         NeedBiggerBuffer,
+        /// The grown buffer exceeds what the path supports (64 KiB on
+        /// network paths), fall back to the limit.
+        BufferTooLarge,
         Error,
     };
 
@@ -64,6 +67,15 @@ private:
 
 /**
  * @brief Windows implementation of FolderWatcher
+ *
+ * Note on the NTFS USN change journal: reading it (FSCTL_READ_USN_JOURNAL)
+ * would give the exact changed-file set since the last sync without any
+ * tree traversal - including across client restarts. It is not used here
+ * because it requires opening a volume handle (\\.\C:), which needs
+ * administrator rights; clients that ship a USN-based discovery install a
+ * privileged service for it. ReadDirectoryChangesW is the best an
+ * unprivileged process can do.
+ *
  * @ingroup gui
  */
 class FolderWatcherPrivate : public QObject
@@ -79,6 +91,11 @@ public:
         return _ready;
     }
 
+    /// ReadDirectoryChangesW has no historical event replay.
+    void recordSyncBaseline() { }
+    void commitSyncBaseline() { }
+    constexpr bool resumedFromPersistedState() const { return false; }
+
 private:
     FolderWatcher *_parent;
     QScopedPointer<WatcherThread> _thread;
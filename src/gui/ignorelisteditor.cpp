@@ -15,6 +15,7 @@
 #include "ignorelisteditor.h"
 #include "ui_ignorelisteditor.h"
 
+#include "common/utility.h"
 #include "configfile.h"
 #include "gui/folderman.h"
 
@@ -81,10 +82,77 @@ void IgnoreListEditor::slotRemoveCurrentItem()
     ui->tableWidget->removeRow(ui->tableWidget->currentRow());
 }
 
+/** Read the raw pattern lines of an ignore file (comments and empty lines skipped). */
+static QSet<QString> readPatternLines(const QString &file)
+{
+    QSet<QString> patterns;
+    QFile ignores(file);
+    if (!ignores.open(QIODevice::ReadOnly))
+        return patterns;
+    while (!ignores.atEnd()) {
+        QString line = QString::fromUtf8(ignores.readLine());
+        line.chop(1);
+        if (line.isEmpty() || line.startsWith(QLatin1String("#")))
+            continue;
+        patterns.insert(line);
+    }
+    return patterns;
+}
+
+/** The folder-relative subtree a no-longer-applying pattern could unhide.
+ *
+ * Returns a null string when the pattern can't be pinned down to one
+ * subtree, in which case the caller has to fall back to full rediscovery.
+ */
+static QString affectedSubtree(QString pattern)
+{
+    if (pattern.startsWith(QLatin1Char(']')))
+        pattern = pattern.mid(1);
+    // Only patterns anchored to the folder root cover a known subtree; a
+    // plain name pattern can match anywhere in the tree.
+    if (!pattern.startsWith(QLatin1Char('/')))
+        return QString();
+    // Escaped characters would need real pattern parsing, and on Windows
+    // wildcards can match slashes and reach arbitrarily deep.
+    if (pattern.contains(QLatin1Char('\\')) || Utility::isWindows())
+        return QString();
+    pattern.remove(0, 1);
+    if (pattern.endsWith(QLatin1Char('/')))
+        pattern.chop(1);
+    if (pattern.isEmpty())
+        return QString();
+
+    int firstWildcard = -1;
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('[')) {
+            firstWildcard = i;
+            break;
+        }
+    }
+    if (firstWildcard < 0) {
+        // A literal pattern hid exactly this path (and everything below it).
+        return pattern;
+    }
+    // A wildcard only stays contained if it sits in the last path component;
+    // the affected subtree is then the enclosing directory. A wildcard in
+    // the first component covers the whole folder.
+    if (pattern.indexOf(QLatin1Char('/'), firstWildcard) >= 0)
+        return QString();
+    const int lastSlash = pattern.lastIndexOf(QLatin1Char('/'), firstWildcard);
+    return lastSlash < 0 ? QString() : pattern.left(lastSlash);
+}
+
 void IgnoreListEditor::slotUpdateLocalIgnoreList()
 {
     ConfigFile cfgFile;
     QString ignoreFile = cfgFile.excludeFile(ConfigFile::UserScope);
+
+    // Remember the previous patterns so rediscovery can be limited to the
+    // subtrees whose match outcome may actually change.
+    const QSet<QString> oldPatterns = readPatternLines(ignoreFile);
+    QSet<QString> newPatterns;
+
     QFile ignores(ignoreFile);
     if (ignores.open(QIODevice::WriteOnly)) {
         for (int row = 0; row < ui->tableWidget->rowCount(); ++row) {
@@ -105,23 +173,49 @@ void IgnoreListEditor::slotUpdateLocalIgnoreList()
                 prepend = "\\";
             }
             ignores.write(prepend + patternItem->text().toUtf8() + '\n');
+            newPatterns.insert(QString::fromUtf8(prepend) + patternItem->text());
         }
     } else {
         QMessageBox::warning(this, tr("Could not open file"),
             tr("Cannot write changes to '%1'.").arg(ignoreFile));
+        // Nothing was written, so nothing changed on disk.
+        newPatterns = oldPatterns;
     }
     ignores.close(); //close the file before reloading stuff.
 
+    // We need a remote discovery of the affected subtrees after a change of
+    // the ignore list. Otherwise we would not download the files/directories
+    // that are no longer ignored (because the remote etag did not change)
+    // (issue #3172). Added patterns need no rediscovery at all: exclusion is
+    // re-evaluated on every traversal anyway. Only removed (or changed)
+    // patterns can unhide files that were never synced, and when all of them
+    // are anchored we know which subtrees to list again.
+    QStringList rediscoverPaths;
+    bool fullRediscovery = false;
+    const QSet<QString> removedPatterns = oldPatterns - newPatterns;
+    for (const QString &pattern : removedPatterns) {
+        const QString subtree = affectedSubtree(pattern);
+        if (subtree.isNull()) {
+            fullRediscovery = true;
+            break;
+        }
+        rediscoverPaths.append(subtree);
+    }
+
     FolderMan *folderMan = FolderMan::instance();
 
-    // We need to force a remote discovery after a change of the ignore list.
-    // Otherwise we would not download the files/directories that are no longer
-    // ignored (because the remote etag did not change)   (issue #3172)
     for (auto *folder : folderMan->folders()) {
         if (folder->isReady()) {
-            folder->journalDb()->forceRemoteDiscoveryNextSync();
+            if (fullRediscovery) {
+                folder->journalDb()->forceRemoteDiscoveryNextSync();
+                folder->slotNextSyncFullLocalDiscovery();
+            } else {
+                for (const QString &path : rediscoverPaths) {
+                    folder->journalDb()->schedulePathForRemoteDiscovery(path);
+                    folder->schedulePathForLocalDiscovery(path);
+                }
+            }
             folder->reloadExcludes();
-            folder->slotNextSyncFullLocalDiscovery();
             folderMan->scheduler()->enqueueFolder(folder);
         }
     }
@@ -27,11 +27,17 @@
 #include <QActionGroup>
 #include <QClipboard>
 #include <QMenu>
+#include <QScrollBar>
 
 #include "ui_localactivitywidget.h"
 
 namespace OCC {
 
+namespace {
+    // Number of persisted history entries fetched per folder and page.
+    constexpr int historyPageSizeC = 200;
+}
+
 LocalActivityWidget::LocalActivityWidget(QWidget *parent)
     : QWidget(parent)
     , _ui(new Ui::LocalActivityWidget)
@@ -71,6 +77,20 @@ LocalActivityWidget::LocalActivityWidget(QWidget *parent)
 
     connect(FolderMan::instance(), &FolderMan::folderRemoved, this, &LocalActivityWidget::onFolderRemoved);
     connect(FolderMan::instance(), &FolderMan::folderListChanged, this, &LocalActivityWidget::onFolderListChanged);
+
+    // Restore the feed from the journal history table and page in older
+    // entries when the user scrolls to the end of the list.
+    for (auto *folder : FolderMan::instance()->folders()) {
+        loadHistoryPage(folder);
+    }
+    connect(_ui->_tableView->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        if (value == _ui->_tableView->verticalScrollBar()->maximum()) {
+            const auto folders = _historyCursors.keys();
+            for (auto *folder : folders) {
+                loadHistoryPage(folder);
+            }
+        }
+    });
 }
 
 LocalActivityWidget::~LocalActivityWidget()
@@ -83,12 +103,39 @@ void LocalActivityWidget::onFolderListChanged(const QUuid &accountId, const QLis
     _model->remove_if([accountId, folders](const ProtocolItem &item) {
         return (item.folder()->accountState()->account()->uuid() == accountId && !folders.contains(item.folder()));
     });
+    _historyCursors.removeIf([accountId, folders](const auto &it) {
+        return (it.key()->accountState()->account()->uuid() == accountId && !folders.contains(it.key()));
+    });
+    for (auto *folder : folders) {
+        if (!_historyCursors.contains(folder)) {
+            loadHistoryPage(folder);
+        }
+    }
 }
 
 void LocalActivityWidget::onFolderRemoved(const QUuid &accountId, Folder *f)
 {
     Q_UNUSED(accountId);
     _model->remove_if([f](const ProtocolItem &item) { return item.folder() == f; });
+    _historyCursors.remove(f);
+}
+
+void LocalActivityWidget::loadHistoryPage(Folder *folder)
+{
+    // The model is a bounded ring buffer, paging past its capacity would only
+    // evict rows we just restored.
+    if (_model->isModelFull()) {
+        return;
+    }
+    const qint64 cursor = _historyCursors.value(folder, 0);
+    if (cursor < 0) {
+        return;
+    }
+    const auto entries = folder->journalDb()->historyEntriesBefore(cursor, historyPageSizeC);
+    _historyCursors.insert(folder, entries.size() < historyPageSizeC ? -1 : entries.last().id);
+    for (const auto &entry : entries) {
+        _model->addProtocolItem(ProtocolItem { folder, entry });
+    }
 }
 /**
  * @brief Show a filter menu for the given model.
@@ -59,8 +59,19 @@ private Q_SLOTS:
     void onFolderRemoved(const QUuid &accountId, Folder *f);
 
 private:
+    /**
+     * Load the next page of persisted history entries for @p folder into the
+     * model, newest first. Called once per folder to restore the feed after a
+     * restart, and again when the view is scrolled to the bottom.
+     */
+    void loadHistoryPage(Folder *folder);
+
     ProtocolItemModel *_model;
     Models::SignalledQSortFilterProxyModel *_sortModel;
     Ui::LocalActivityWidget *_ui;
+
+    // Paging cursor per folder: the oldest history rowid loaded so far,
+    // -1 once the folder's history is exhausted.
+    QHash<Folder *, qint64> _historyCursors;
 };
 }
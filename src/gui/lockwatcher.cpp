@@ -15,8 +15,10 @@
 #include "lockwatcher.h"
 #include "filesystem.h"
 
+#include <QFutureWatcher>
 #include <QLoggingCategory>
 #include <QTimer>
+#include <QtConcurrentRun>
 
 #include <chrono>
 
@@ -28,10 +30,19 @@ Q_LOGGING_CATEGORY(lcLockWatcher, "gui.lockwatcher", QtInfoMsg)
 
 namespace {
 const auto check_frequency = 20s;
+
+// Time budget for one probe batch on the worker thread. Files that did not
+// get probed before the budget ran out stay due and are probed on the next
+// timer tick.
+const auto probeBudgetC = 250ms;
+
+// Upper bound for the per-file exponential poll backoff.
+const auto maxPollIntervalC = std::chrono::milliseconds(5min);
 }
 
 LockWatcher::LockWatcher(QObject *parent)
     : QObject(parent)
+    , _checkInterval(check_frequency)
 {
     connect(&_timer, &QTimer::timeout,
         this, &LockWatcher::checkFiles);
@@ -41,11 +52,13 @@ LockWatcher::LockWatcher(QObject *parent)
 void LockWatcher::addFile(const QString &path, FileSystem::LockMode mode)
 {
     qCInfo(lcLockWatcher) << "Watching for lock of" << path << mode << "being released";
-    _watchedPaths.insert({ path, mode });
+    // an already-expired deadline, the file is probed on the next tick
+    _watchedPaths.insert({ { path, mode }, Watch { _checkInterval, QDeadlineTimer(0ms) } });
 }
 
 void LockWatcher::setCheckInterval(std::chrono::milliseconds interval)
 {
+    _checkInterval = interval;
     _timer.start(interval.count());
 }
 
@@ -56,17 +69,57 @@ bool LockWatcher::contains(const QString &path, OCC::FileSystem::LockMode mode)
 
 void LockWatcher::checkFiles()
 {
-    // copy as Q_EMIT fileUnlocked might trigger a new insert
-    const auto watchedPathsCopy = _watchedPaths;
-    decltype(_watchedPaths) unlocked;
-    for (const auto &p : watchedPathsCopy) {
-        if (!FileSystem::isFileLocked(p.first, p.second)) {
-            qCInfo(lcLockWatcher) << "Lock of" << p.first << p.second << "was released";
-            Q_EMIT fileUnlocked(p.first, p.second);
-            unlocked.insert(p);
+    if (_probeInProgress) {
+        // the previous batch is still running, its leftovers stay due
+        return;
+    }
+
+    QList<LockKey> due;
+    for (const auto &p : _watchedPaths) {
+        if (p.second.nextProbe.hasExpired()) {
+            due.append(p.first);
         }
     }
-    for (const auto &removed : std::as_const(unlocked)) {
-        _watchedPaths.erase(removed);
+    if (due.isEmpty()) {
+        return;
+    }
+
+    _probeInProgress = true;
+    auto watcher = new QFutureWatcher<QList<std::pair<LockKey, bool>>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher] {
+        watcher->deleteLater();
+        _probeInProgress = false;
+        handleProbeResults(watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run([due = std::move(due)]() {
+        QList<std::pair<LockKey, bool>> results;
+        results.reserve(due.size());
+        QDeadlineTimer budget(probeBudgetC);
+        for (const auto &key : due) {
+            results.append({ key, FileSystem::isFileLocked(key.first, key.second) });
+            if (budget.hasExpired()) {
+                break;
+            }
+        }
+        return results;
+    }));
+}
+
+void LockWatcher::handleProbeResults(const QList<std::pair<LockKey, bool>> &results)
+{
+    for (const auto &result : results) {
+        auto it = _watchedPaths.find(result.first);
+        if (it == _watchedPaths.cend()) {
+            continue;
+        }
+        if (!result.second) {
+            qCInfo(lcLockWatcher) << "Lock of" << result.first.first << result.first.second << "was released";
+            // erase before emitting, the slot might insert the file again
+            _watchedPaths.erase(it);
+            Q_EMIT fileUnlocked(result.first.first, result.first.second);
+        } else {
+            it->second.pollInterval = std::min(it->second.pollInterval * 2, maxPollIntervalC);
+            it->second.nextProbe = QDeadlineTimer(it->second.pollInterval);
+        }
     }
 }
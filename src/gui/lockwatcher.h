@@ -18,14 +18,14 @@
 
 #include "filesystem.h"
 
+#include <QDeadlineTimer>
 #include <QList>
 #include <QObject>
 #include <QString>
-#include <QSet>
 #include <QTimer>
 
 #include <chrono>
-#include <unordered_set>
+#include <unordered_map>
 
 namespace OCC {
 
@@ -40,6 +40,12 @@ namespace OCC {
  * becomes available again. To do that, we need to regularly check whether
  * the file is still being locked.
  *
+ * The open-probes run batched on a worker thread: on slow paths (SMB) a
+ * single probe can take long enough that probing many files serially would
+ * freeze the GUI thread. Each batch stops probing once a time budget is
+ * used up, the remaining files are probed on the next timer tick. Files
+ * that stay locked are re-probed with exponentially growing intervals.
+ *
  * @ingroup gui
  */
 
@@ -81,7 +87,19 @@ private:
         }
     };
 
-    std::unordered_set<LockKey, HashLockKey> _watchedPaths;
+    struct Watch
+    {
+        /// Current poll interval, doubles while the file stays locked.
+        std::chrono::milliseconds pollInterval;
+        /// The file is probed on the first timer tick after this expired.
+        QDeadlineTimer nextProbe;
+    };
+
+    void handleProbeResults(const QList<std::pair<LockKey, bool>> &results);
+
+    std::unordered_map<LockKey, Watch, HashLockKey> _watchedPaths;
     QTimer _timer;
+    std::chrono::milliseconds _checkInterval;
+    bool _probeInProgress = false;
 };
 }
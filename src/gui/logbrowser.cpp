@@ -79,6 +79,8 @@ void LogBrowser::setupLoggingFromConfig()
     ConfigFile config;
     auto logger = Logger::instance();
 
+    logger->setBinaryLogFormat(config.binaryLogFormat());
+
     if (config.automaticLogDir()) {
         // Don't override other configured logging
         if (logger->isLoggingToFile())
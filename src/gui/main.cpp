@@ -301,35 +301,31 @@ QString setupTranslations(QApplication *app)
             const QString qtBaseTrFile = QLatin1String("qtbase_") + lang;
             qCDebug(lcMain) << "qtBaseTrFile:" << qtBaseTrFile;
 
-            QTranslator *qtTranslator = new QTranslator(app);
-            QTranslator *qtkeychainTranslator = new QTranslator(app);
-
-            if (!qtTranslator->load(qtTrFile, qtTrPath)) {
-                if (!qtTranslator->load(qtTrFile, trPath)) {
-                    if (!qtTranslator->load(qtBaseTrFile, qtTrPath)) {
-                        if (!qtTranslator->load(qtBaseTrFile, trPath)) {
-                            qCCritical(lcMain) << "Could not load Qt translations";
-                        }
-                    }
-                }
-            }
+            // Our own catalog above comes from a compiled-in resource and is cheap
+            // to load. The Qt and qtkeychain catalogs live on disk - probing for
+            // them costs several file system round trips on a network home - and
+            // none of their strings are needed before the first dialog, so defer
+            // loading them until a string is actually looked up.
+            auto *qtTranslator = new Translations::LazyTranslator(app);
+            qtTranslator->addCandidate(qtTrFile, qtTrPath);
+            qtTranslator->addCandidate(qtTrFile, trPath);
+            qtTranslator->addCandidate(qtBaseTrFile, qtTrPath);
+            qtTranslator->addCandidate(qtBaseTrFile, trPath);
 
             const QString qtkeychainTrFile = QLatin1String("qtkeychain_") + lang;
-            if (!qtkeychainTranslator->load(qtkeychainTrFile, qtTrPath)) {
-                if (!qtkeychainTranslator->load(qtkeychainTrFile, trPath)) {
-                    qCCritical(lcMain) << "Could not load qtkeychain translations";
-                }
-            }
+            auto *qtkeychainTranslator = new Translations::LazyTranslator(app);
+            qtkeychainTranslator->addCandidate(qtkeychainTrFile, qtTrPath);
+            qtkeychainTranslator->addCandidate(qtkeychainTrFile, trPath);
 
             if (!translator->isEmpty() && !qApp->installTranslator(translator)) {
                 qCCritical(lcMain) << "Failed to install translator";
                 translator->deleteLater();
             }
-            if (!qtTranslator->isEmpty() && !qApp->installTranslator(qtTranslator)) {
+            if (!qApp->installTranslator(qtTranslator)) {
                 qCCritical(lcMain) << "Failed to install Qt translator";
                 qtTranslator->deleteLater();
             }
-            if (!qtkeychainTranslator->isEmpty() && !qApp->installTranslator(qtkeychainTranslator)) {
+            if (!qApp->installTranslator(qtkeychainTranslator)) {
                 qCCritical(lcMain) << "Failed to install qtkeychain translator";
                 qtkeychainTranslator->deleteLater();
             }
@@ -428,15 +424,6 @@ int main(int argc, char **argv)
 
         auto folderManager = FolderMan::createInstance();
 
-        if (!AccountManager::instance()->restore()) {
-            qCCritical(lcMain) << "Could not read the account settings, quitting";
-            QMessageBox::critical(nullptr, QCoreApplication::translate("account loading", "Error accessing the configuration file"),
-                QCoreApplication::translate("account loading", "There was an error while accessing the configuration file at %1.")
-                    .arg(ConfigFile::configFile()),
-                QMessageBox::Close);
-            return -1;
-        }
-
         std::unique_ptr<Application> ocApp = Application::createInstance(platform.get(), displayLanguage, options.debugMode);
         ocApp->updateAutoRun(firstRun);
         QObject::connect(platform.get(), &Platform::requestAttention, ocApp.get(), &Application::ensureVisible);
@@ -466,25 +453,45 @@ int main(int argc, char **argv)
 #endif
 
 
-        // We cannot do this earlier, because the UI needs to be set up in order to
-        // show sync errors. We also want to wait for the auto-updater to finish, in case it needs
-        // to install an update.
-        // Set up the folders and start syncing. This includes a downgrade-detection, in which case the return value
-        // is empty. Note that the value 0 (zero) is a valid return value (non-empty), in which case
-        // the dialog is not shown.
-        if (!FolderMan::instance()->setupFoldersFromConfig().has_value()) {
-            // Empty return value: there was a downgrade detected on one of the databases
-            showDowngradeDialog();
-            return -1;
-        }
+        // Staged startup: the tray and UI are up at this point, the heavy part
+        // of the start - reading account settings, probing the keychain and
+        // opening the journals - is deferred to the event loop so it no longer
+        // delays the tray icon. Restoring an account kicks off its
+        // ConnectionValidator right away (AccountManager::addAccountState),
+        // so the per-account connection checks run in parallel while the rest
+        // of the accounts still load.
+        QTimer::singleShot(0, ocApp.get(), [&folderManager] {
+            if (!AccountManager::instance()->restore()) {
+                qCCritical(lcMain) << "Could not read the account settings, quitting";
+                QMessageBox::critical(nullptr, QCoreApplication::translate("account loading", "Error accessing the configuration file"),
+                    QCoreApplication::translate("account loading", "There was an error while accessing the configuration file at %1.")
+                        .arg(ConfigFile::configFile()),
+                    QMessageBox::Close);
+                QCoreApplication::exit(-1);
+                return;
+            }
+
+            // We cannot do this earlier, because the UI needs to be set up in order to
+            // show sync errors. We also want to wait for the auto-updater to finish, in case it needs
+            // to install an update.
+            // Set up the folders and start syncing. This includes a downgrade-detection, in which case the return value
+            // is empty. Note that the value 0 (zero) is a valid return value (non-empty), in which case
+            // the dialog is not shown.
+            if (!FolderMan::instance()->setupFoldersFromConfig().has_value()) {
+                // Empty return value: there was a downgrade detected on one of the databases
+                showDowngradeDialog();
+                QCoreApplication::exit(-1);
+                return;
+            }
+
+            // Now that everything is up and running, start accepting connections/requests from the shell integration.
+            folderManager->socketApi()->startShellIntegration();
+        });
 
         if (options.show) {
             ocApp->ensureVisible();
         }
 
-        // Now that everything is up and running, start accepting connections/requests from the shell integration.
-        folderManager->socketApi()->startShellIntegration();
-
         return app.exec();
     }).exec(argc, argv);
 }
@@ -17,6 +17,7 @@
 #include "progressdispatcher.h"
 
 #include <QMenu>
+#include <QTimeZone>
 
 
 using namespace OCC;
@@ -41,6 +42,20 @@ ProtocolItem::ProtocolItem(Folder *folder, const SyncFileItemPtr &item)
     }
 }
 
+ProtocolItem::ProtocolItem(Folder *folder, const SyncJournalDb::HistoryEntry &entry)
+    : _path(entry.path)
+    , _folder(folder)
+    , _timestamp(QDateTime::fromMSecsSinceEpoch(entry.timestamp, QTimeZone::utc()))
+    , _size(entry.size)
+    , _status(static_cast<SyncFileItem::Status>(entry.status))
+    , _direction(static_cast<SyncFileItem::Direction>(entry.direction))
+    , _message(entry.message)
+    // Size dependence is not persisted; entries without a transferred size
+    // (deletes, renames, metadata updates) were stored with size 0.
+    , _sizeIsRelevant(entry.size > 0)
+{
+}
+
 QString ProtocolItem::path() const
 {
     return _path;
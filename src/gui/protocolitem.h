@@ -30,6 +30,11 @@ class OWNCLOUDGUI_EXPORT ProtocolItem
 public:
     ProtocolItem() = default;
     explicit ProtocolItem(Folder *folder, const SyncFileItemPtr &item);
+    /**
+     * Rebuild an item from a persisted journal history entry, used to restore
+     * the local activity list after a restart.
+     */
+    explicit ProtocolItem(Folder *folder, const SyncJournalDb::HistoryEntry &entry);
     QString path() const;
 
     Folder *folder() const;
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "gui/scheduling/diskspacemanager.h"
+
+#include "folder.h"
+#include "folderman.h"
+
+#include "common/utility.h"
+#include "libsync/owncloudpropagator.h" // freeSpaceLimit()
+
+#include <QFileInfo>
+#include <QStorageInfo>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+using namespace OCC;
+
+Q_LOGGING_CATEGORY(lcDiskSpaceManager, "gui.scheduler.diskspacemanager", QtInfoMsg)
+
+namespace {
+// how often the free space on the folders' volumes is checked
+constexpr auto diskSpaceCheckIntervalC = 5min;
+}
+
+DiskSpaceManager::DiskSpaceManager(FolderMan *folderMan, QObject *parent)
+    : QObject(parent)
+    , _folderMan(folderMan)
+{
+    _checkTimer.setInterval(diskSpaceCheckIntervalC);
+    connect(&_checkTimer, &QTimer::timeout, this, &DiskSpaceManager::checkDiskSpace);
+    _checkTimer.start();
+}
+
+void DiskSpaceManager::checkDiskSpace()
+{
+    const QList<Folder *> folders = _folderMan->folders();
+    for (auto *folder : folders) {
+        if (!folder->isReady() || folder->vfs().mode() == Vfs::Off) {
+            continue;
+        }
+
+        const QStorageInfo storage(folder->path());
+        if (!storage.isValid()) {
+            continue;
+        }
+        const qint64 freeBytes = storage.bytesAvailable();
+        if (freeBytes < 0 || freeBytes >= freeSpaceLimit()) {
+            continue;
+        }
+
+        // Aim for twice the limit so the check doesn't re-trigger right away.
+        const qint64 bytesToFree = 2 * freeSpaceLimit() - freeBytes;
+        qCInfo(lcDiskSpaceManager) << "Low disk space for" << folder->path() << ":" << Utility::octetsToString(freeBytes)
+                                   << "free, trying to dehydrate" << Utility::octetsToString(bytesToFree);
+        if (dehydrateLeastRecentlyUsed(folder, bytesToFree) > 0) {
+            Q_EMIT requestEnqueueFolder(folder);
+        }
+    }
+}
+
+qint64 DiskSpaceManager::dehydrateLeastRecentlyUsed(Folder *folder, qint64 bytesToFree)
+{
+    struct Candidate
+    {
+        QString relativePath;
+        qint64 size;
+        QDateTime lastRead;
+    };
+    std::vector<Candidate> candidates;
+
+    folder->journalDb()->getFilesBelowPath(QByteArray(), [&](const SyncJournalFileRecord &record) {
+        // Only hydrated files occupy the space; skip directories, virtual
+        // files and files in a dehydration or download transition.
+        if (record._type != ItemTypeFile) {
+            return;
+        }
+        const QString relativePath = QString::fromUtf8(record._path);
+        const auto pin = folder->vfs().pinState(relativePath);
+        if (!pin || *pin == PinState::AlwaysLocal) {
+            return;
+        }
+        const QFileInfo fi(folder->path() + relativePath);
+        if (!fi.exists()) {
+            return;
+        }
+        candidates.push_back({relativePath, record._fileSize, fi.lastRead()});
+    });
+
+    // least recently read first
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.lastRead < b.lastRead;
+    });
+
+    qint64 marked = 0;
+    for (const auto &candidate : candidates) {
+        if (marked >= bytesToFree) {
+            break;
+        }
+        // The sync engine dehydrates the file once it sees the pin state; a
+        // file with unsynced local changes is uploaded first, never dropped.
+        if (!folder->vfs().setPinState(candidate.relativePath, PinState::OnlineOnly)) {
+            qCWarning(lcDiskSpaceManager) << "Failed to mark" << candidate.relativePath << "for dehydration";
+            continue;
+        }
+        folder->schedulePathForLocalDiscovery(candidate.relativePath);
+        marked += candidate.size;
+    }
+    if (marked > 0) {
+        qCInfo(lcDiskSpaceManager) << "Marked" << Utility::octetsToString(marked) << "for dehydration in" << folder->path();
+    }
+    return marked;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+namespace OCC {
+
+class Folder;
+class FolderMan;
+
+/**
+ * Frees disk space by dehydrating placeholders that haven't been read in a
+ * long time.
+ *
+ * Periodically checks the free space on each vfs-enabled folder's volume.
+ * When it falls below the limit the propagator also enforces for downloads
+ * (freeSpaceLimit()), the least recently read hydrated files that aren't
+ * pinned AlwaysLocal are marked OnlineOnly and a sync is requested; the
+ * sync performs the actual dehydration. Enough files are marked to bring
+ * the free space up to twice the limit, so the check doesn't re-trigger on
+ * the next pass.
+ */
+class DiskSpaceManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DiskSpaceManager(FolderMan *folderMan, QObject *parent);
+
+Q_SIGNALS:
+    void requestEnqueueFolder(Folder *folder);
+
+private:
+    void checkDiskSpace();
+
+    /// Marks the least recently read unpinned files for dehydration until
+    /// their sizes add up to bytesToFree. Returns the marked amount.
+    qint64 dehydrateLeastRecentlyUsed(Folder *folder, qint64 bytesToFree);
+
+    FolderMan *_folderMan;
+    QTimer _checkTimer;
+};
+
+} // OCC namespace
@@ -91,6 +91,9 @@ void ETagWatcher::updateEtag(const QUuid &accountId, const QString &spaceId, con
     // https://github.com/owncloud/ocis/issues/7160
     if (!etag.isEmpty() && _lastEtagJobForSpace.contains(accountId) && _lastEtagJobForSpace[accountId].contains(spaceId)) {
         auto &info = _lastEtagJobForSpace[accountId][spaceId];
+        // Keep the engine up to date so it can serve the remote tree from the
+        // journal while the root etag is unchanged.
+        info.folder->syncEngine()->setKnownRemoteRootEtag(etag);
         if (info.folder->canSync() && info.etag != etag) {
             const bool folderWasSyncedOnce = !info.etag.isEmpty();
             info.etag = etag;
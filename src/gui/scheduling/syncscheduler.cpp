@@ -16,6 +16,7 @@
 
 #include "gui/folderman.h"
 #include "gui/networkinformation.h"
+#include "gui/scheduling/diskspacemanager.h"
 #include "gui/scheduling/etagwatcher.h"
 #include "libsync/configfile.h"
 #include "libsync/syncengine.h"
@@ -27,6 +28,23 @@ using namespace OCC;
 
 Q_LOGGING_CATEGORY(lcSyncScheduler, "gui.scheduler.syncscheduler", QtInfoMsg)
 
+namespace {
+// Heat-based periodic re-sync: a folder with recent watcher activity or
+// user interaction is re-synced this often.
+constexpr auto hotSyncIntervalC = 5min;
+
+// Without further activity the interval doubles once per elapsed interval
+// until it reaches the dormant interval.
+constexpr int heatDecayFactorC = 2;
+
+// How often the policy is evaluated against all folders.
+constexpr auto policyEvaluationIntervalC = 1min;
+
+// A sync that finished faster than this last time is predicted to find no
+// changes (discovery only) and may start beyond the transfer budget.
+constexpr auto lightSyncDurationC = 10s;
+}
+
 class FolderPriorityQueue
 {
 private:
@@ -114,6 +132,23 @@ SyncScheduler::SyncScheduler(FolderMan *parent)
     , _pauseSyncWhenMetered(ConfigFile().pauseSyncWhenMetered())
     , _queue(new FolderPriorityQueue)
 {
+    // Number of folders allowed to sync at once: one huge folder must not
+    // starve the small ones. Folders of one account still share the
+    // account's bandwidth limiters and throttling feedback, so the
+    // transfer budget stays pooled while several of them run.
+    _maxParallelSyncs = qEnvironmentVariableIntValue("OWNCLOUD_MAX_PARALLEL_FOLDER_SYNCS");
+    if (_maxParallelSyncs <= 0) {
+        _maxParallelSyncs = 2;
+    }
+
+    // Accounts with many spaces spend most polls on no-change passes which
+    // are discovery bound, not transfer bound, so they get their own, larger
+    // budget on top of the transfer slots.
+    _maxParallelDiscoveries = qEnvironmentVariableIntValue("OWNCLOUD_MAX_PARALLEL_DISCOVERIES");
+    if (_maxParallelDiscoveries <= 0) {
+        _maxParallelDiscoveries = 6;
+    }
+
     _watcher = new ETagWatcher(this);
 
     connect(parent, &FolderMan::folderAdded, _watcher, &ETagWatcher::onFolderAdded);
@@ -122,22 +157,34 @@ SyncScheduler::SyncScheduler(FolderMan *parent)
 
     connect(_watcher, &ETagWatcher::requestEnqueueFolder, this, &SyncScheduler::handleEnqueueFolder);
 
+    _diskSpaceManager = new DiskSpaceManager(parent, this);
+    connect(_diskSpaceManager, &DiskSpaceManager::requestEnqueueFolder, this, &SyncScheduler::handleEnqueueFolder);
+
+    connect(parent, &FolderMan::folderRemoved, this, [this](const QUuid &, Folder *folder) {
+        _lastActivity.erase(folder);
+        _heavySyncs.remove(folder);
+    });
+
     // Normal syncs are performed incremental but when fullLocalDiscoveryInterval times out
     // a complete local discovery is performed.
-    // This timer here triggers a sync independent of etag changes on the server.
-    auto *fullLocalDiscoveryTimer = new QTimer(this);
-    fullLocalDiscoveryTimer->setInterval(ConfigFile().fullLocalDiscoveryInterval() + 2min);
-    connect(fullLocalDiscoveryTimer, &QTimer::timeout, this, [parent, this] {
+    // This timer here triggers syncs independent of etag changes on the server:
+    // each folder is re-synced once its heat-based interval expired, see
+    // currentSyncInterval(). Dormant folders keep the old uniform cadence,
+    // active ones sync considerably more often.
+    auto *policyTimer = new QTimer(this);
+    policyTimer->setInterval(policyEvaluationIntervalC);
+    connect(policyTimer, &QTimer::timeout, this, [parent, this] {
         // I'm doing it this way as std::as_const won't compile as it's "deleted" (no idea)
         // and if I just hit folders() we get clazy complaining that it might detach :/
         const QList<Folder *> folders = parent->folders();
         for (auto *f : folders) {
-            if (f->isReady() && f->accountState()->state() == AccountState::State::Connected) {
+            if (f->isReady() && f->accountState()->state() == AccountState::State::Connected
+                && f->msecSinceLastSync() >= currentSyncInterval(f)) {
                 enqueueFolder(f);
             }
         }
     });
-    fullLocalDiscoveryTimer->start();
+    policyTimer->start();
 }
 
 
@@ -163,11 +210,43 @@ void SyncScheduler::enqueueFolder(Folder *folder, Priority priority)
         return;
     }
 
+    // Medium and High priority syncs are tied to a user action.
+    if (priority >= Priority::Medium) {
+        recordActivity(folder);
+    }
+
+    // The folder will sync shortly; warming the journal overlaps the queue
+    // wait instead of stalling the engine's first queries on a cold disk.
+    folder->journalDb()->prefetchPageCacheAsync();
+
     qCInfo(lcSyncScheduler) << "Enqueue" << folder->path() << priority << "QueueSize:" << _queue->size();
     _queue->enqueueFolder(folder, priority);
-    if (!_currentSync) {
-        startNext();
+    startNext();
+}
+
+void SyncScheduler::recordActivity(Folder *folder)
+{
+    _lastActivity[folder].reset();
+}
+
+std::chrono::milliseconds SyncScheduler::currentSyncInterval(Folder *folder) const
+{
+    // The dormant interval keeps the guarantee that every folder is synced
+    // often enough for the periodic full local discovery to happen.
+    const auto dormantInterval = std::max<std::chrono::milliseconds>(
+        ConfigFile().fullLocalDiscoveryInterval() + 2min, hotSyncIntervalC);
+
+    const auto it = _lastActivity.find(folder);
+    if (it == _lastActivity.cend()) {
+        return dormantInterval;
     }
+
+    const auto sinceActivity = std::chrono::duration_cast<std::chrono::milliseconds>(it->second.duration());
+    std::chrono::milliseconds interval = hotSyncIntervalC;
+    while (interval < dormantInterval && sinceActivity >= interval * heatDecayFactorC) {
+        interval *= heatDecayFactorC;
+    }
+    return std::min(interval, dormantInterval);
 }
 
 void SyncScheduler::startNext()
@@ -177,40 +256,81 @@ void SyncScheduler::startNext()
         return;
     }
 
-    if (!_currentSync.isNull()) {
-        qCInfo(lcSyncScheduler) << "Another sync is already running, waiting for that to finish before starting a new sync";
-        return;
-    }
+    // Folders deleted mid-sync leave null pointers behind.
+    _runningSyncs.removeAll(nullptr);
 
-    auto nextSync = _queue->pop();
-    while (nextSync.first && !nextSync.first->canSync()) {
-        nextSync = _queue->pop();
+    // Syncs deferred on an exhausted transfer budget get the first claim on freed slots.
+    const auto deferred = std::exchange(_deferredSyncs, {});
+    for (const auto &[deferredFolder, deferredPriority] : deferred) {
+        if (deferredFolder) {
+            _queue->enqueueFolder(deferredFolder, deferredPriority);
+        }
     }
-    _currentSync = nextSync.first;
-    auto syncPriority = nextSync.second;
 
-    if (!_currentSync.isNull()) {
+    while (_runningSyncs.size() < _maxParallelSyncs + _maxParallelDiscoveries && !_queue->empty()) {
+        auto nextSync = _queue->pop();
+        Folder *folder = nextSync.first;
+        const auto syncPriority = nextSync.second;
+
+        if (!folder) {
+            break;
+        }
+        if (!folder->canSync() || _runningSyncs.contains(folder)) {
+            continue;
+        }
+
+        // A folder whose previous sync took a while, or that never synced in
+        // this session, is predicted to propagate changes and needs a slot of
+        // the transfer budget. Quick previous syncs only claim a discovery slot.
+        const auto lastDuration = folder->msecLastSyncDuration();
+        const bool predictedHeavy = lastDuration <= 0ms || lastDuration > lightSyncDurationC;
+        if (predictedHeavy && _heavySyncs.size() >= _maxParallelSyncs) {
+            // Park it and keep going: the small spaces queued behind it can
+            // still use the remaining discovery slots.
+            _deferredSyncs.append({folder, syncPriority});
+            continue;
+        }
+
         if (_pauseSyncWhenMetered && NetworkInformation::instance()->isMetered()) {
             if (syncPriority == Priority::High) {
                 qCInfo(lcSyncScheduler) << "Scheduler is paused due to metered internet connection, BUT next sync is HIGH priority, so allow sync to start";
             } else {
-                enqueueFolder(_currentSync, syncPriority);
+                // The queue is priority ordered, everything behind this entry is not urgent either.
+                _queue->enqueueFolder(folder, syncPriority);
                 qCInfo(lcSyncScheduler) << "Scheduler is paused due to metered internet connection, next sync is not started";
                 return;
             }
         }
 
+        if (predictedHeavy) {
+            _heavySyncs.insert(folder);
+        } else {
+            // A predicted no-change pass that turns out to propagate real work
+            // is promoted to the transfer budget. This may overcommit the
+            // budget briefly, but stops further heavy syncs from starting.
+            connect(
+                folder->syncEngine(), &SyncEngine::aboutToPropagate, this,
+                [this, folder](const SyncFileItemSet &items) {
+                    if (!items.empty()) {
+                        _heavySyncs.insert(folder);
+                    }
+                },
+                Qt::SingleShotConnection);
+        }
         connect(
-            _currentSync, &Folder::syncFinished, this,
-            [this](const SyncResult &result) {
-                qCInfo(lcSyncScheduler) << "Sync finished for" << _currentSync->path() << "with status" << result.status();
-                _currentSync = nullptr;
+            folder, &Folder::syncFinished, this,
+            [this, folder](const SyncResult &result) {
+                qCInfo(lcSyncScheduler) << "Sync finished for" << folder->path() << "with status" << result.status();
+                _runningSyncs.removeAll(folder);
+                _heavySyncs.remove(folder);
                 startNext();
             },
             Qt::SingleShotConnection);
-        connect(_currentSync, &Folder::destroyed, this, &SyncScheduler::startNext, Qt::SingleShotConnection);
-        qCInfo(lcSyncScheduler) << "Starting sync for" << _currentSync->path();
-        _currentSync->startSync();
+        connect(folder, &Folder::destroyed, this, &SyncScheduler::startNext, Qt::SingleShotConnection);
+        qCInfo(lcSyncScheduler) << "Starting sync for" << folder->path() << "(" << _heavySyncs.size() << "of" << _maxParallelSyncs << "transfer slots,"
+                                << _runningSyncs.size() + 1 << "syncs running)";
+        _runningSyncs.append(folder);
+        folder->startSync();
     }
 }
 
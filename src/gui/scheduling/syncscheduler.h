@@ -14,19 +14,24 @@
 
 #pragma once
 
+#include "common/chronoelapsedtimer.h"
 #include "etagwatcher.h"
 #include "gui/folder.h"
 
 #include <QObject>
+#include <QSet>
 
+#include <chrono>
 #include <queue>
 #include <unordered_map>
+#include <utility>
 
 
 class FolderPriorityQueue;
 
 namespace OCC {
 
+class DiskSpaceManager;
 class FolderMan;
 
 class SyncScheduler : public QObject
@@ -50,6 +55,26 @@ public:
 
     void enqueueFolder(Folder *folder, Priority priority = Priority::Low);
 
+    /**
+     * Marks the folder as recently active.
+     *
+     * Called when the folder watcher reports local changes or a user
+     * interacts with the folder. Active folders are re-synced at short
+     * intervals; without further activity the interval decays back to the
+     * dormant interval, see currentSyncInterval().
+     */
+    void recordActivity(Folder *folder);
+
+    /**
+     * The periodic re-sync interval the policy currently applies to the folder.
+     *
+     * Starts at the hot interval after recorded activity and doubles per
+     * elapsed interval until it reaches the dormant interval, which matches
+     * the configured full-local-discovery interval. Folders without any
+     * recorded activity use the dormant interval.
+     */
+    std::chrono::milliseconds currentSyncInterval(Folder *folder) const;
+
     void start();
 
     void stop();
@@ -68,7 +93,29 @@ private:
     bool _running = false;
     bool _pauseSyncWhenMetered;
     ETagWatcher *_watcher = nullptr;
-    QPointer<Folder> _currentSync;
+    DiskSpaceManager *_diskSpaceManager = nullptr;
+
+    /// How many folders may propagate changes at the same time (the transfer budget).
+    int _maxParallelSyncs;
+
+    /// How many additional predicted no-change passes may run on top of the
+    /// transfer budget (the discovery budget). Lets many small unchanged
+    /// spaces cycle concurrently while a big transfer is running.
+    int _maxParallelDiscoveries;
+
+    /// The folders currently syncing. Entries go null when a folder is deleted mid-sync.
+    QVector<QPointer<Folder>> _runningSyncs;
+
+    /// The subset of _runningSyncs that propagates changes and thus occupies a transfer slot.
+    QSet<Folder *> _heavySyncs;
+
+    /// Predicted-heavy folders waiting for a free transfer slot; re-enqueued
+    /// ahead of the queue once a slot frees up.
+    QVector<std::pair<QPointer<Folder>, Priority>> _deferredSyncs;
+
+    /// When the folder last saw watcher activity or user interaction.
+    std::unordered_map<Folder *, Utility::ChronoElapsedTimer> _lastActivity;
+
     FolderPriorityQueue *_queue;
 };
 }
@@ -26,6 +26,12 @@
 #include <QTreeWidget>
 #include <QVBoxLayout>
 
+namespace {
+// How many background prefetch PROPFINDs may run at once. User-requested
+// fetches start immediately and are not counted against this limit.
+constexpr int maxParallelPrefetchJobsC = 3;
+}
+
 namespace OCC {
 
 
@@ -104,21 +110,77 @@ void SelectiveSyncWidget::refreshFolders()
     if (!_account)
         return;
 
-    auto *job = new PropfindJob(_account, davUrl(), _folderPath, PropfindJob::Depth::One, this);
+    _loadedDirs.clear();
+    _pendingDirs.clear();
+    _prefetchQueue.clear();
+    _activePrefetchJobs = 0;
+
+    fetchDirectory(QString(), FetchReason::UserRequested);
+    _folderTree->clear();
+    _loading->show();
+    _loading->move(10, _folderTree->header()->height() + 10);
+}
+
+void SelectiveSyncWidget::fetchDirectory(const QString &dir, FetchReason reason)
+{
+    if (_loadedDirs.contains(dir) || _pendingDirs.contains(dir)) {
+        return;
+    }
+    _pendingDirs.insert(dir);
+
+    auto *job = new PropfindJob(_account, davUrl(), dir.isEmpty() ? _folderPath : Utility::concatUrlPathItems({_folderPath, dir}), PropfindJob::Depth::One, this);
     job->setProperties({QByteArrayLiteral("resourcetype"), QByteArrayLiteral("http://owncloud.org/ns:size")});
-    connect(job, &PropfindJob::directoryListingSubfolders, this, &SelectiveSyncWidget::slotUpdateDirectories);
-    connect(job, &PropfindJob::finishedWithError, this, [job, this] {
-        if (job->reply()->error() == QNetworkReply::ContentNotFoundError) {
-            _loading->setText(tr("Currently there are no subfolders on the server."));
-        } else {
-            _loading->setText(tr("An error occurred while loading the list of subfolders."));
+    connect(job, &PropfindJob::directoryListingSubfolders, this, [job, dir, reason, this](const QStringList &list) {
+        _pendingDirs.remove(dir);
+        _loadedDirs.insert(dir);
+        if (reason == FetchReason::Prefetch) {
+            _activePrefetchJobs = qMax(0, _activePrefetchJobs - 1);
         }
-        _loading->resize(_loading->sizeHint()); // because it's not in a layout
+        const QStringList insertedDirs = updateDirectories(job, list);
+        if (reason == FetchReason::UserRequested) {
+            // line up the level below the one the user is looking at
+            for (const QString &insertedDir : insertedDirs) {
+                enqueuePrefetch(insertedDir);
+            }
+        }
+        startNextPrefetch();
+    });
+    connect(job, &PropfindJob::finishedWithError, this, [job, dir, reason, this] {
+        _pendingDirs.remove(dir);
+        if (reason == FetchReason::Prefetch) {
+            _activePrefetchJobs = qMax(0, _activePrefetchJobs - 1);
+        }
+        if (dir.isEmpty()) {
+            if (job->reply()->error() == QNetworkReply::ContentNotFoundError) {
+                _loading->setText(tr("Currently there are no subfolders on the server."));
+            } else {
+                _loading->setText(tr("An error occurred while loading the list of subfolders."));
+            }
+            _loading->resize(_loading->sizeHint()); // because it's not in a layout
+        }
+        startNextPrefetch();
     });
     job->start();
-    _folderTree->clear();
-    _loading->show();
-    _loading->move(10, _folderTree->header()->height() + 10);
+}
+
+void SelectiveSyncWidget::enqueuePrefetch(const QString &dir)
+{
+    if (_loadedDirs.contains(dir) || _pendingDirs.contains(dir) || _prefetchQueue.contains(dir)) {
+        return;
+    }
+    _prefetchQueue.append(dir);
+}
+
+void SelectiveSyncWidget::startNextPrefetch()
+{
+    while (_activePrefetchJobs < maxParallelPrefetchJobsC && !_prefetchQueue.isEmpty()) {
+        const QString dir = _prefetchQueue.takeFirst();
+        if (_loadedDirs.contains(dir) || _pendingDirs.contains(dir)) {
+            continue;
+        }
+        ++_activePrefetchJobs;
+        fetchDirectory(dir, FetchReason::Prefetch);
+    }
 }
 
 void SelectiveSyncWidget::setFolderInfo(const QString &folderPath, const QString &rootName, const QSet<QString> &oldBlackList)
@@ -208,9 +270,8 @@ void SelectiveSyncWidget::recursiveInsert(QTreeWidgetItem *parent, QStringList p
     }
 }
 
-void SelectiveSyncWidget::slotUpdateDirectories(QStringList list)
+QStringList SelectiveSyncWidget::updateDirectories(PropfindJob *job, QStringList list)
 {
-    auto job = qobject_cast<PropfindJob *>(sender());
     QScopedValueRollback<bool> isInserting(_inserting, true);
 
     SelectiveSyncTreeViewItem *root = static_cast<SelectiveSyncTreeViewItem *>(_folderTree->topLevelItem(0));
@@ -246,7 +307,7 @@ void SelectiveSyncWidget::slotUpdateDirectories(QStringList list)
     if (!root && list.size() <= 1) {
         _loading->setText(tr("Currently there are no subfolders on the server."));
         _loading->resize(_loading->sizeHint()); // because it's not in a layout
-        return;
+        return {};
     } else {
         _loading->hide();
     }
@@ -271,6 +332,8 @@ void SelectiveSyncWidget::slotUpdateDirectories(QStringList list)
     const bool showChildIndicator = relativeList.size() > 1 || list.contains(rootPath);
 
     Utility::sortFilenames(relativeList);
+    QStringList insertedDirs;
+    insertedDirs.reserve(relativeList.size());
     for (const QString &path : std::as_const(relativeList)) {
         const auto size = job ? job->sizes().value(Utility::ensureTrailingSlash(Utility::concatUrlPathItems({rootPath, path}))) : 0;
         const QStringList paths = path.split(QLatin1Char('/'), Qt::SkipEmptyParts);
@@ -278,6 +341,7 @@ void SelectiveSyncWidget::slotUpdateDirectories(QStringList list)
             continue;
         }
         recursiveInsert(root, paths, Utility::ensureTrailingSlash(path), size, showChildIndicator);
+        insertedDirs.append(Utility::stripTrailingSlash(path));
     }
 
     // Root is partially checked if any children are not checked
@@ -290,6 +354,7 @@ void SelectiveSyncWidget::slotUpdateDirectories(QStringList list)
     }
 
     root->setExpanded(true);
+    return insertedDirs;
 }
 
 void SelectiveSyncWidget::slotItemExpanded(QTreeWidgetItem *item)
@@ -301,10 +366,19 @@ void SelectiveSyncWidget::slotItemExpanded(QTreeWidgetItem *item)
     if (dir.isEmpty()) {
         return;
     }
-    PropfindJob *job = new PropfindJob(_account, davUrl(), Utility::concatUrlPathItems({_folderPath, dir}), PropfindJob::Depth::One, this);
-    job->setProperties({QByteArrayLiteral("resourcetype"), QByteArrayLiteral("http://owncloud.org/ns:size")});
-    connect(job, &PropfindJob::directoryListingSubfolders, this, &SelectiveSyncWidget::slotUpdateDirectories);
-    job->start();
+    if (_loadedDirs.contains(dir)) {
+        // this level is already in the tree (typically prefetched), just
+        // line up the level below it
+        for (int i = 0; i < item->childCount(); ++i) {
+            const QString childDir = item->child(i)->data(0, Qt::UserRole).toString();
+            if (!childDir.isEmpty()) {
+                enqueuePrefetch(childDir);
+            }
+        }
+        startNextPrefetch();
+        return;
+    }
+    fetchDirectory(dir, FetchReason::UserRequested);
 }
 
 void SelectiveSyncWidget::slotItemChanged(QTreeWidgetItem *item, int col)
@@ -28,6 +28,7 @@ namespace OCC {
 
 class Folder;
 class Account;
+class PropfindJob;
 
 /**
  * @brief The SelectiveSyncWidget contains a folder tree with labels
@@ -53,12 +54,32 @@ public:
     void setDavUrl(const QUrl &davUrl);
 
 private Q_SLOTS:
-    void slotUpdateDirectories(QStringList);
     void slotItemExpanded(QTreeWidgetItem *);
     void slotItemChanged(QTreeWidgetItem *, int);
 
 private:
+    enum class FetchReason {
+        /// The user expanded an item (or opened the dialog), fetch right away.
+        UserRequested,
+        /// Background prefetch of the level below what the user is looking at.
+        Prefetch,
+    };
+
     void refreshFolders();
+
+    /**
+     * Fetches the listing of one directory (relative to the widget root,
+     * empty for the root itself) unless it is already loaded or in flight.
+     * User-requested fetches additionally queue their subfolders for
+     * prefetch, so the next expansion usually hits the tree directly.
+     */
+    void fetchDirectory(const QString &dir, FetchReason reason);
+    void enqueuePrefetch(const QString &dir);
+    void startNextPrefetch();
+
+    /// Inserts the listing into the tree, returns the inserted directories
+    /// relative to the widget root (without trailing slash).
+    QStringList updateDirectories(PropfindJob *job, QStringList list);
     void recursiveInsert(QTreeWidgetItem *parent, QStringList pathTrail, QString path, qint64 size, bool showChildIndicator);
     QUrl davUrl() const;
 
@@ -74,6 +95,14 @@ private:
     bool _inserting; // set to true when we are inserting new items on the list
     QLabel *_loading;
 
+    // Lazy-loading bookkeeping: directories (relative to the widget root)
+    // whose listing is already in the tree, those with a PROPFIND in flight
+    // and those queued for background prefetch.
+    QSet<QString> _loadedDirs;
+    QSet<QString> _pendingDirs;
+    QStringList _prefetchQueue;
+    int _activePrefetchJobs = 0;
+
     QTreeWidget *_folderTree;
 
     // During account setup we want to filter out excluded folders from the
@@ -17,13 +17,17 @@
 #include "socketapi.h"
 #include "scheduling/syncscheduler.h"
 #include "socketapi_p.h"
+#include "socketapistatusshm.h"
 
 #include "gui/commonstrings.h"
 
 #include "accountmanager.h"
 #include "accountstate.h"
 #include "common/asserts.h"
+#include "common/metrics.h"
+#include "common/ownsql.h"
 #include "common/syncjournalfilerecord.h"
+#include "common/tracer.h"
 #include "common/version.h"
 #include "filesystem.h"
 #include "folder.h"
@@ -44,8 +48,10 @@
 #include <QScopedPointer>
 #include <QUrl>
 #include <array>
+#include <chrono>
 
 
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QWidget>
@@ -61,10 +67,18 @@
 // This is the version that is returned when the client asks for the VERSION.
 // The first number should be changed if there is an incompatible change that breaks old clients.
 // The second number should be changed when there are new features.
-#define SOCKET_API_VERSION "1.1"
+#define SOCKET_API_VERSION "1.2"
+
+using namespace std::chrono_literals;
 
 namespace {
 
+// How long coalesced status pushes may sit in the queue before they are
+// flushed, and for how long after a status query for a directory its
+// entries bypass the batching.
+constexpr std::chrono::milliseconds statusPushFlushIntervalC = 100ms;
+constexpr std::chrono::milliseconds recentQueryWindowC = 5s;
+
 const QString unregisterPathMessageC()
 {
     return QStringLiteral("UNREGISTER_PATH");
@@ -130,6 +144,7 @@ SocketApi::SocketApi(QObject *parent)
     qRegisterMetaType<QSharedPointer<SocketApiJobV2>>("QSharedPointer<SocketApiJobV2>");
 
     _socketPath = Utility::socketApiSocketPath();
+    _statusShm = std::make_unique<SocketApiStatusShm>();
 
     // Remove any old socket that might be lying around:
     SocketApiServer::removeServer(_socketPath);
@@ -149,6 +164,10 @@ SocketApi::SocketApi(QObject *parent)
         }
     }
 
+    _statusPushFlushTimer.setSingleShot(true);
+    _statusPushFlushTimer.setInterval(statusPushFlushIntervalC);
+    connect(&_statusPushFlushTimer, &QTimer::timeout, this, &SocketApi::flushPendingStatusPushes);
+
     // Wire up the server instance to us, so we can accept new connections:
     connect(&_localServer, &SocketApiServer::newConnection, this, &SocketApi::slotNewConnection);
 
@@ -201,6 +220,11 @@ void SocketApi::slotNewConnection()
 
     auto listener = QSharedPointer<SocketListener>::create(socket);
     _listeners.insert(socket, listener);
+    if (_statusShm->isValid()) {
+        // Extensions that know the verb attach the segment and resolve
+        // statuses locally; others just ignore the unknown message.
+        listener->sendMessage(QStringLiteral("STATUS_SHM:") + _statusShm->nativeKey());
+    }
     for (const auto &a : std::as_const(_registeredAccounts)) {
         if (a && !a->defaultSyncRoot().isEmpty()) {
             broadcastMessage(buildRegisterPathMessage(Utility::stripTrailingSlash(a->defaultSyncRoot())));
@@ -332,6 +356,9 @@ void SocketApi::slotUnregisterPath(Folder *folder)
 
     broadcastMessage(buildMessage(unregisterPathMessageC(), Utility::stripTrailingSlash(folder->path()), QString()), true);
     _registeredFolders.remove(folder);
+
+    const QString folderPath = folder->path();
+    _statusCache.removeIf([&folderPath](const auto &it) { return it.key().startsWith(folderPath); });
 }
 
 void SocketApi::slotUpdateFolderView(Folder *f)
@@ -385,14 +412,53 @@ void SocketApi::broadcastMessage(const QString &msg, bool doWait)
 
 void SocketApi::broadcastStatusPushMessage(const QString &systemPath, SyncFileStatus fileStatus)
 {
-    QString msg = buildMessage(QStringLiteral("STATUS"), systemPath, fileStatus.toSocketAPIString());
     Q_ASSERT(!systemPath.endsWith(QLatin1Char('/')));
-    auto directoryHash = qHash(systemPath.left(systemPath.lastIndexOf(QLatin1Char('/'))));
+    // Update the table first so an extension that reacts to the push by
+    // re-reading it already sees the new status.
+    _statusShm->setStatus(systemPath, fileStatus);
+    // Refresh the snapshot, but only for paths the shell asked about before;
+    // that keeps the cache bounded by what is actually visible.
+    auto cacheIt = _statusCache.find(systemPath);
+    if (cacheIt != _statusCache.end()) {
+        *cacheIt = fileStatus;
+    }
+
+    const auto directoryHash = qHash(systemPath.left(systemPath.lastIndexOf(QLatin1Char('/'))));
+    const auto recentIt = _recentlyQueriedDirs.constFind(directoryHash);
+    if (recentIt != _recentlyQueriedDirs.constEnd() && !recentIt->hasExpired()) {
+        // The user is most likely looking at this directory, don't sit on
+        // the update.
+        _pendingStatusPushes.remove(systemPath);
+        sendStatusPushMessage(systemPath, fileStatus);
+        return;
+    }
+    // Coalesce the rest: during bulk propagation a path flips through
+    // several states (plus one update per parent) within milliseconds and
+    // only the latest state is worth a message.
+    _pendingStatusPushes.insert(systemPath, fileStatus);
+    if (!_statusPushFlushTimer.isActive()) {
+        _statusPushFlushTimer.start();
+    }
+}
+
+void SocketApi::sendStatusPushMessage(const QString &systemPath, const SyncFileStatus &fileStatus)
+{
+    const QString msg = buildMessage(QStringLiteral("STATUS"), systemPath, fileStatus.toSocketAPIString());
+    const auto directoryHash = qHash(systemPath.left(systemPath.lastIndexOf(QLatin1Char('/'))));
     for (const auto &listener : std::as_const(_listeners)) {
         listener->sendMessageIfDirectoryMonitored(msg, directoryHash);
     }
 }
 
+void SocketApi::flushPendingStatusPushes()
+{
+    const auto pending = std::exchange(_pendingStatusPushes, {});
+    for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+        sendStatusPushMessage(it.key(), it.value());
+    }
+    _recentlyQueriedDirs.removeIf([](const auto &it) { return it.value().hasExpired(); });
+}
+
 void SocketApi::command_RETRIEVE_FOLDER_STATUS(const QString &argument, SocketListener *listener)
 {
     // This command is the same as RETRIEVE_FILE_STATUS
@@ -412,14 +478,55 @@ void SocketApi::command_RETRIEVE_FILE_STATUS(const QString &argument, SocketList
         // Let the listener know that it should now send status pushes for siblings of this file.
         QString directory = fileData.localPath.left(fileData.localPath.lastIndexOf(QLatin1Char('/')));
         listener->registerMonitoredDirectory(qHash(directory));
+        _recentlyQueriedDirs.insert(qHash(directory), QDeadlineTimer(recentQueryWindowC));
 
-        statusString = fileData.syncFileStatus().toSocketAPIString();
+        const auto cacheIt = _statusCache.constFind(fileData.localPath);
+        const SyncFileStatus status = cacheIt != _statusCache.constEnd() ? *cacheIt : fileData.syncFileStatus();
+        if (cacheIt == _statusCache.constEnd()) {
+            _statusCache.insert(fileData.localPath, status);
+        }
+        // Seed the shared-memory table so the next lookup for this path is
+        // a memory read instead of a round trip.
+        _statusShm->setStatus(argument, status);
+        statusString = status.toSocketAPIString();
     }
 
     const QString message = QStringLiteral("STATUS:") % statusString % QLatin1Char(':') % QDir::toNativeSeparators(argument);
     listener->sendMessage(message);
 }
 
+void SocketApi::command_RETRIEVE_DIR_STATUS(const QString &argument, SocketListener *listener)
+{
+    auto fileData = FileData::get(argument);
+    const QString nativeDir = QDir::toNativeSeparators(fileData.localPath);
+    if (!fileData.folder || !fileData.folder->canSync()) {
+        // An empty listing; the extension falls back to its defaults.
+        listener->sendMessage(QStringLiteral("DIR_STATUS:") + nativeDir);
+        return;
+    }
+
+    // Like RETRIEVE_FILE_STATUS: the user is looking at this directory, so
+    // the listener wants status pushes for its entries from now on.
+    listener->registerMonitoredDirectory(qHash(fileData.localPath));
+    _recentlyQueriedDirs.insert(qHash(fileData.localPath), QDeadlineTimer(recentQueryWindowC));
+
+    QString message = QStringLiteral("DIR_STATUS:") + nativeDir;
+    SyncEngine *engine = fileData.folder->syncEngine();
+    fileData.folder->journalDb()->listFilesInPath(fileData.folderRelativePath.toUtf8(), [&](const SyncJournalFileRecord &rec) {
+        const QString relativePath = QString::fromUtf8(rec._path);
+        const QString name = relativePath.mid(relativePath.lastIndexOf(QLatin1Char('/')) + 1);
+        const QString localPath = fileData.localPath + QLatin1Char('/') + name;
+        const auto cacheIt = _statusCache.constFind(localPath);
+        const SyncFileStatus status = cacheIt != _statusCache.constEnd() ? *cacheIt : engine->fileStatus(relativePath);
+        if (cacheIt == _statusCache.constEnd()) {
+            _statusCache.insert(localPath, status);
+        }
+        _statusShm->setStatus(localPath, status);
+        message += RecordSeparator() + status.toSocketAPIString() + QLatin1Char(':') + name;
+    });
+    listener->sendMessage(message);
+}
+
 void SocketApi::command_SHARE(const QString &localFile, SocketListener *listener)
 {
     auto fileData = FileData::get(localFile);
@@ -532,15 +639,38 @@ void SocketApi::command_MAKE_AVAILABLE_LOCALLY(const QString &filesArg, SocketLi
         if (!data.folder || !data.folder->isReady())
             continue;
 
+        // Persist the pending pin flip: if we exit before the scheduled
+        // discovery below ran, the next start replays it from the intent log.
+        data.folder->journalDb()->setVfsIntent(data.folderRelativePath.toUtf8(), SyncJournalDb::VfsIntentOp::Pin);
+
         // Update the pin state on all items
         std::ignore = data.folder->vfs().setPinState(data.folderRelativePath, PinState::AlwaysLocal);
 
+        // The user is waiting for exactly these files: put them ahead of
+        // whatever bulk propagation is already queued.
+        data.folder->syncEngine()->prioritizePath(data.folderRelativePath);
+
         // Trigger sync
         data.folder->schedulePathForLocalDiscovery(data.folderRelativePath);
         FolderMan::instance()->scheduler()->enqueueFolder(data.folder, SyncScheduler::Priority::Medium);
     }
 }
 
+/* Bump the files ahead of the remaining bulk of a running or queued sync,
+ * e.g. for a placeholder the user just opened. */
+void SocketApi::command_PRIORITIZE_DOWNLOAD(const QString &filesArg, SocketListener *)
+{
+    const QStringList files = split(filesArg);
+
+    for (const auto &file : files) {
+        auto data = FileData::get(file);
+        if (!data.folder || !data.folder->isReady())
+            continue;
+
+        data.folder->syncEngine()->prioritizePath(data.folderRelativePath);
+    }
+}
+
 /* Go over all the files and replace them by a virtual file */
 void SocketApi::command_MAKE_ONLINE_ONLY(const QString &filesArg, SocketListener *)
 {
@@ -551,6 +681,9 @@ void SocketApi::command_MAKE_ONLINE_ONLY(const QString &filesArg, SocketListener
         if (!data.folder || !data.folder->isReady())
             continue;
 
+        // As above, persist the pin flip until the scheduled discovery ran
+        data.folder->journalDb()->setVfsIntent(data.folderRelativePath.toUtf8(), SyncJournalDb::VfsIntentOp::Pin);
+
         // Update the pin state on all items
         std::ignore = data.folder->vfs().setPinState(data.folderRelativePath, PinState::OnlineOnly);
 
@@ -689,6 +822,22 @@ void SocketApi::command_V2_GET_CLIENT_ICON(const QSharedPointer<SocketApiJobV2>
     job->success({ { QStringLiteral("png"), QString::fromUtf8(data) } });
 }
 
+void SocketApi::command_V2_GET_TRACE(const QSharedPointer<SocketApiJobV2> &job) const
+{
+    OC_ASSERT(job);
+    job->success({ { QStringLiteral("traceEvents"), Tracer::toTraceEventJson() } });
+}
+
+void SocketApi::command_V2_GET_METRICS(const QSharedPointer<SocketApiJobV2> &job) const
+{
+    OC_ASSERT(job);
+    QJsonObject result { { QStringLiteral("metrics"), Metrics::toJson() } };
+    if (sqlAuditEnabled()) {
+        result[QStringLiteral("sqlAudit")] = sqlAuditReport();
+    }
+    job->success(result);
+}
+
 void SocketApi::emailPrivateLink(const QUrl &link)
 {
     Utility::openEmailComposer(
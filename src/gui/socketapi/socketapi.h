@@ -21,7 +21,11 @@
 #include "libsync/account.h"
 #include "syncfileitem.h"
 
+#include <QDeadlineTimer>
 #include <QPointer>
+#include <QTimer>
+
+#include <memory>
 
 #if defined(Q_OS_MAC)
 #include "socketapisocket_mac.h"
@@ -41,6 +45,7 @@ class SyncFileStatus;
 class Folder;
 class SocketListener;
 class SocketApiJobV2;
+class SocketApiStatusShm;
 
 Q_DECLARE_LOGGING_CATEGORY(lcSocketApi)
 
@@ -106,9 +111,22 @@ private:
 
     void broadcastMessage(const QString &msg, bool doWait = false);
 
+    /// Sends one STATUS push to every listener monitoring the parent directory.
+    void sendStatusPushMessage(const QString &systemPath, const SyncFileStatus &fileStatus);
+    void flushPendingStatusPushes();
+
     Q_INVOKABLE void command_RETRIEVE_FOLDER_STATUS(const QString &argument, SocketListener *listener);
     Q_INVOKABLE void command_RETRIEVE_FILE_STATUS(const QString &argument, SocketListener *listener);
 
+    /** Send the status of every direct child of a directory in one message.
+     * (added in version 1.2)
+     * Replies with DIR_STATUS:[dir] followed by one [status]:[name] record
+     * per journal entry in the directory, separated by '\x1e'. The names are
+     * relative to the directory. Entries the journal does not know yet are
+     * simply absent; the extension asks for those individually.
+     */
+    Q_INVOKABLE void command_RETRIEVE_DIR_STATUS(const QString &argument, SocketListener *listener);
+
     Q_INVOKABLE void command_VERSION(const QString &argument, SocketListener *listener);
 
     Q_INVOKABLE void command_SHARE_MENU_TITLE(const QString &argument, SocketListener *listener);
@@ -121,6 +139,7 @@ private:
     Q_INVOKABLE void command_OPEN_PRIVATE_LINK_VERSIONS(const QString &localFile, SocketListener *listener);
     Q_INVOKABLE void command_MAKE_AVAILABLE_LOCALLY(const QString &filesArg, SocketListener *listener);
     Q_INVOKABLE void command_MAKE_ONLINE_ONLY(const QString &filesArg, SocketListener *listener);
+    Q_INVOKABLE void command_PRIORITIZE_DOWNLOAD(const QString &filesArg, SocketListener *listener);
     Q_INVOKABLE void command_DELETE_ITEM(const QString &localFile, SocketListener *listener);
     Q_INVOKABLE void command_MOVE_ITEM(const QString &localFile, SocketListener *listener);
 
@@ -133,6 +152,16 @@ private:
     // e.g. { "id" : "1", "arguments" : { "size" : 16 } }
     Q_INVOKABLE void command_V2_GET_CLIENT_ICON(const QSharedPointer<SocketApiJobV2> &job) const;
 
+    // Debug interface: dumps the buffered tracing spans as a Chrome
+    // trace-event array in Json key "traceEvents", loadable in
+    // chrome://tracing and Perfetto. See common/tracer.h.
+    Q_INVOKABLE void command_V2_GET_TRACE(const QSharedPointer<SocketApiJobV2> &job) const;
+
+    // Dumps the process-wide metrics registry (counters and gauges, keyed by
+    // name) in Json key "metrics", for local monitoring agents. See
+    // common/metrics.h.
+    Q_INVOKABLE void command_V2_GET_METRICS(const QSharedPointer<SocketApiJobV2> &job) const;
+
     // Fetch the private link and call targetFun
     void fetchPrivateLinkUrlHelper(const QString &localFile, const std::function<void(const QUrl &url)> &targetFun);
 
@@ -154,11 +183,28 @@ private:
     QString buildRegisterPathMessage(const QString &path);
 
     QString _socketPath;
+    // Snapshot of the last answered or pushed status per local path. Only
+    // paths the shell asked about are tracked and the tracker's
+    // fileStatusChanged pushes keep them fresh, so RETRIEVE_FILE_STATUS can
+    // answer shell-visible files without going back to the status tracker
+    // (journal lookup, exclude matching and a stat) while a sync keeps the
+    // GUI thread and the journal busy.
+    QHash<QString, SyncFileStatus> _statusCache;
+    // Status pushes are coalesced per path and flushed on a short cadence so
+    // bulk propagation doesn't saturate the pipe with one message per file.
+    // Paths in a directory the shell queried recently bypass the batching,
+    // see broadcastStatusPushMessage().
+    QHash<QString, SyncFileStatus> _pendingStatusPushes;
+    QHash<uint, QDeadlineTimer> _recentlyQueriedDirs;
+    QTimer _statusPushFlushTimer;
     QSet<Folder *> _registeredFolders;
     // todo: we really should not keep any pointer to the account, as we only ever need the defaultSyncRoot, but this needs to go into a future
     // refactoring to ensure full testing of that change. IMO we could just store the defaultSyncRoot alone, no uuid or account required at all
     QHash<QUuid, QPointer<Account>> _registeredAccounts;
     QMap<SocketApiSocket *, QSharedPointer<SocketListener>> _listeners;
     SocketApiServer _localServer;
+    // Shared-memory status table the shell extensions can read directly,
+    // see SocketApiStatusShm. May be invalid if the segment is unavailable.
+    std::unique_ptr<SocketApiStatusShm> _statusShm;
 };
 }
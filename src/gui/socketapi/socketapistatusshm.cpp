@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "socketapistatusshm.h"
+
+#include "common/utility.h"
+#include "theme.h"
+
+#include <QDir>
+#include <QLoggingCategory>
+
+#include <cstring>
+
+namespace {
+
+constexpr quint32 magicC = 0x4F435353; // "OCSS"
+constexpr quint32 layoutVersionC = 1;
+// 64k entries of 16 bytes, a 1 MiB segment. Plenty for the set of files a
+// user has visible in file browsers at any one time.
+constexpr quint32 capacityC = 64 * 1024;
+// How far an entry may be displaced from its home slot before we evict.
+constexpr quint32 probeLengthC = 16;
+
+constexpr quint32 sharedFlagC = 0x100;
+
+struct Header
+{
+    quint32 magic;
+    quint32 layoutVersion;
+    quint32 capacity;
+    quint32 reserved;
+};
+
+}
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcSocketApiShm, "gui.socketapi.shm", QtInfoMsg)
+
+struct SocketApiStatusShm::Entry
+{
+    quint64 pathHash;
+    quint32 status;
+    quint32 reserved;
+};
+
+SocketApiStatusShm::SocketApiStatusShm()
+{
+    // One segment per user session. The socket path is already unique per
+    // user and branding, so derive the key from it - with our own hash, the
+    // seeded qHash differs between processes and runs.
+    _sharedMemory.setNativeKey(QStringLiteral("%1-status-%2")
+            .arg(Theme::instance()->appName(), QString::number(pathHash(Utility::socketApiSocketPath()), 16)));
+
+    const qsizetype size = sizeof(Header) + capacityC * sizeof(Entry);
+    if (!_sharedMemory.create(size)) {
+        // A segment of a previous run of this client may still be attached
+        // by an extension; reuse it instead of failing.
+        if (_sharedMemory.error() != QSharedMemory::AlreadyExists || !_sharedMemory.attach()) {
+            qCWarning(lcSocketApiShm) << "Could not create status segment:" << _sharedMemory.errorString();
+            return;
+        }
+        if (_sharedMemory.size() < size) {
+            qCWarning(lcSocketApiShm) << "Stale status segment has wrong size, not using it";
+            _sharedMemory.detach();
+            return;
+        }
+    }
+
+    // (Re)initialize: zero entries, then make the header valid.
+    std::memset(_sharedMemory.data(), 0, size);
+    auto *header = static_cast<Header *>(_sharedMemory.data());
+    header->layoutVersion = layoutVersionC;
+    header->capacity = capacityC;
+    header->magic = magicC;
+    _valid = true;
+    qCInfo(lcSocketApiShm) << "Status segment ready, key" << _sharedMemory.nativeKey();
+}
+
+SocketApiStatusShm::~SocketApiStatusShm()
+{
+    if (_valid) {
+        // Readers that are still attached must not trust stale statuses.
+        static_cast<Header *>(_sharedMemory.data())->magic = 0;
+    }
+}
+
+bool SocketApiStatusShm::isValid() const
+{
+    return _valid;
+}
+
+QString SocketApiStatusShm::nativeKey() const
+{
+    return _sharedMemory.nativeKey();
+}
+
+quint64 SocketApiStatusShm::pathHash(const QString &nativePath)
+{
+    const QByteArray utf8 = nativePath.toUtf8();
+    quint64 hash = Q_UINT64_C(0xcbf29ce484222325);
+    for (char c : utf8) {
+        hash ^= static_cast<quint8>(c);
+        hash *= Q_UINT64_C(0x100000001b3);
+    }
+    // 0 marks an empty slot
+    return hash == 0 ? 1 : hash;
+}
+
+SocketApiStatusShm::Entry *SocketApiStatusShm::entries() const
+{
+    return reinterpret_cast<Entry *>(static_cast<char *>(_sharedMemory.data()) + sizeof(Header));
+}
+
+SocketApiStatusShm::Entry *SocketApiStatusShm::findEntry(quint64 hash, bool allocate) const
+{
+    Entry *const table = entries();
+    const quint32 home = hash % capacityC;
+    Entry *freeSlot = nullptr;
+    for (quint32 i = 0; i < probeLengthC; ++i) {
+        Entry *entry = &table[(home + i) % capacityC];
+        if (entry->pathHash == hash) {
+            return entry;
+        }
+        if (!freeSlot && entry->pathHash == 0) {
+            freeSlot = entry;
+        }
+    }
+    if (!allocate) {
+        return nullptr;
+    }
+    // The whole probe window is taken by other paths: evict the home slot.
+    // The displaced path is simply answered over the socket again.
+    return freeSlot ? freeSlot : &table[home];
+}
+
+void SocketApiStatusShm::setStatus(const QString &systemPath, const SyncFileStatus &status)
+{
+    if (!_valid) {
+        return;
+    }
+    const quint64 hash = pathHash(QDir::toNativeSeparators(systemPath));
+    Entry *entry = findEntry(hash, true);
+    const quint32 packed = quint32(status.tag()) | (status.shared() ? sharedFlagC : 0);
+    // Single writer; publish the status before the hash so a reader never
+    // resolves a fresh hash to the previous occupant's status. An in-place
+    // update is just the (aligned, hence atomic) status store.
+    if (entry->pathHash != hash) {
+        entry->pathHash = 0;
+        entry->status = packed;
+        entry->pathHash = hash;
+    } else {
+        entry->status = packed;
+    }
+}
+
+void SocketApiStatusShm::remove(const QString &systemPath)
+{
+    if (!_valid) {
+        return;
+    }
+    Entry *entry = findEntry(pathHash(QDir::toNativeSeparators(systemPath)), false);
+    if (entry) {
+        entry->pathHash = 0;
+        entry->status = 0;
+    }
+}
+}
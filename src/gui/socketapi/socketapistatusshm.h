@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "gui/owncloudguilib.h"
+
+#include "common/syncfilestatus.h"
+
+#include <QSharedMemory>
+#include <QString>
+
+namespace OCC {
+
+/**
+ * @brief Shared-memory table of file sync statuses for the shell extensions.
+ *
+ * Overlay icon providers ask for the status of every file that becomes
+ * visible. Through the socket API that is one round trip plus an on-demand
+ * status computation on the GUI thread per file - scrolling through a large
+ * directory floods both sides. With this table an extension resolves a path
+ * to a status with a plain memory read and only falls back to
+ * RETRIEVE_FILE_STATUS for paths it does not find; the STATUS pushes the
+ * socket API already sends double as the invalidation signal.
+ *
+ * Layout of the segment (little-endian, no padding between fields):
+ *
+ *     Header:  quint32 magic ("OCSS"), quint32 layoutVersion,
+ *              quint32 capacity, quint32 reserved
+ *     Entries: capacity x { quint64 pathHash, quint32 status, quint32 reserved }
+ *
+ * pathHash is 64-bit FNV-1a over the UTF-8 bytes of the absolute path with
+ * native separators, so non-Qt readers can compute it; 0 marks an empty
+ * slot. An entry lives at slot (pathHash % capacity) or is displaced by
+ * linear probing up to probeLengthC slots. status carries the
+ * SyncFileStatus::SyncFileStatusTag value in the low byte and the shared
+ * flag as bit 8.
+ *
+ * This process is the only writer; readers do not take the QSharedMemory
+ * lock. A torn read can at worst yield a briefly wrong overlay, which the
+ * next STATUS push corrects. The table is a cache, not a registry: when the
+ * probe window is full the home slot is evicted and the displaced path is
+ * served through the line protocol again.
+ *
+ * The segment key is announced to every listener with the STATUS_SHM
+ * message; extensions that do not know the verb ignore it and keep using
+ * the line protocol exclusively.
+ */
+class OWNCLOUDGUI_EXPORT SocketApiStatusShm
+{
+public:
+    SocketApiStatusShm();
+    ~SocketApiStatusShm();
+
+    /// Whether the segment was created (or attached) and initialized.
+    bool isValid() const;
+
+    /// The platform key a reader passes to its shared memory api.
+    QString nativeKey() const;
+
+    /// Stores or updates the status of an absolute path.
+    void setStatus(const QString &systemPath, const SyncFileStatus &status);
+
+    /// Drops the entry for an absolute path, if present.
+    void remove(const QString &systemPath);
+
+    /// The documented FNV-1a hash over the UTF-8 bytes of @p nativePath.
+    static quint64 pathHash(const QString &nativePath);
+
+private:
+    struct Entry;
+    Entry *entries() const;
+    Entry *findEntry(quint64 hash, bool allocate) const;
+
+    QSharedMemory _sharedMemory;
+    bool _valid = false;
+};
+}
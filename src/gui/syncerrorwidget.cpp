@@ -260,6 +260,20 @@ SyncErrorWidget::SyncErrorWidget(QWidget *parent)
     connect(FolderMan::instance(), &FolderMan::folderRemoved, this, &SyncErrorWidget::onFolderRemoved);
 
     connect(FolderMan::instance(), &FolderMan::folderListChanged, this, &SyncErrorWidget::onFolderListChanged);
+
+    // Conflict records change while a sync runs; keep the conflict help
+    // banner current without waiting for the sync to finish.
+    connect(FolderMan::instance(), &FolderMan::folderAdded, this, [this](const QUuid &, Folder *f) {
+        connect(f->journalDb(), &SyncJournalDb::conflictRecordAdded, this,
+            [this](const QByteArray &) { _ui->_conflictHelp->setHidden(Theme::instance()->conflictHelpUrl().isEmpty()); });
+        connect(f->journalDb(), &SyncJournalDb::conflictRecordRemoved, this, [this](const QByteArray &) {
+            // hide the banner once the last pending conflict is resolved
+            const auto folders = FolderMan::instance()->folders();
+            const bool anyConflicts =
+                std::any_of(folders.cbegin(), folders.cend(), [](Folder *folder) { return folder->journalDb()->conflictRecordCount() > 0; });
+            _ui->_conflictHelp->setHidden(Theme::instance()->conflictHelpUrl().isEmpty() || !anyConflicts);
+        });
+    });
 }
 
 SyncErrorWidget::~SyncErrorWidget()
@@ -347,13 +361,14 @@ void SyncErrorWidget::slotProgressInfo(Folder *folder, const ProgressInfo &progr
         });
     }
     if (progress.status() == ProgressInfo::Done) {
-        // We keep track very well of pending conflicts.
-        // Inform other components about them.
+        // The journal's conflicts table is the single source of truth for
+        // pending conflicts; an indexed query beats scanning the model or
+        // walking the tree for conflict-marker names.
         QStringList conflicts;
-        for (const auto &rawData : _model->rawData()) {
-            if (rawData.folder() == folder && rawData.status() == SyncFileItem::Conflict) {
-                conflicts.append(rawData.path());
-            }
+        const QByteArrayList conflictPaths = folder->journalDb()->conflictRecordPaths();
+        conflicts.reserve(conflictPaths.size());
+        for (const auto &path : conflictPaths) {
+            conflicts.append(QString::fromUtf8(path));
         }
         Q_EMIT ProgressDispatcher::instance()->folderConflicts(folder, conflicts);
 
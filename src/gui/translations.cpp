@@ -22,12 +22,55 @@
 #include <QLoggingCategory>
 #include <QStandardPaths>
 
+#include <utility>
+
 namespace OCC {
 
 namespace Translations {
 
     Q_LOGGING_CATEGORY(lcTranslations, "gui.translations", QtInfoMsg)
 
+    void LazyTranslator::addCandidate(const QString &fileName, const QString &directory)
+    {
+        _candidates.append({ fileName, directory });
+    }
+
+    bool LazyTranslator::isEmpty() const
+    {
+        // report non-empty while candidates are pending, so installing the
+        // translator up front is not skipped
+        return _candidates.isEmpty() && QTranslator::isEmpty();
+    }
+
+    QString LazyTranslator::translate(const char *context, const char *sourceText, const char *disambiguation, int n) const
+    {
+        ensureLoaded();
+        return QTranslator::translate(context, sourceText, disambiguation, n);
+    }
+
+    void LazyTranslator::ensureLoaded() const
+    {
+        if (_candidates.isEmpty()) {
+            return;
+        }
+        const auto candidates = std::exchange(_candidates, {});
+        // QTranslator::load is non-const, but lazily populating the catalog
+        // does not change the observable state of the translator
+        auto *self = const_cast<LazyTranslator *>(this);
+        for (const auto &candidate : candidates) {
+            if (self->load(candidate.fileName, candidate.directory)) {
+                qCDebug(lcTranslations) << "Lazily loaded translation catalog" << filePath();
+                return;
+            }
+        }
+        QStringList fileNames;
+        fileNames.reserve(candidates.size());
+        for (const auto &candidate : candidates) {
+            fileNames.append(candidate.fileName);
+        }
+        qCWarning(lcTranslations) << "Could not load any of the translation catalogs" << fileNames;
+    }
+
     const QString translationsFilePrefix()
     {
         return QStringLiteral("client_");
@@ -18,11 +18,45 @@
 
 #include <QSet>
 #include <QString>
+#include <QTranslator>
+#include <QVector>
 
 namespace OCC {
 
 namespace Translations {
 
+    /**
+     * Translator that defers loading its .qm catalog until the first string lookup.
+     *
+     * Candidates are probed in the order they were added; the first one that
+     * loads wins. QTranslator maps a catalog into memory instead of reading it,
+     * so what this defers off the startup path is mostly the open/stat traffic
+     * of the probing - which is exactly what hurts when the install or home
+     * directory sits on a network share.
+     */
+    class OWNCLOUDGUI_EXPORT LazyTranslator : public QTranslator
+    {
+        Q_OBJECT
+    public:
+        using QTranslator::QTranslator;
+
+        /// Adds a catalog candidate to try; see class description for the semantics.
+        void addCandidate(const QString &fileName, const QString &directory);
+
+        QString translate(const char *context, const char *sourceText, const char *disambiguation = nullptr, int n = -1) const override;
+        bool isEmpty() const override;
+
+    private:
+        void ensureLoaded() const;
+
+        struct Candidate
+        {
+            QString fileName;
+            QString directory;
+        };
+        mutable QVector<Candidate> _candidates;
+    };
+
     /**
     * @return translation files' filename prefix
     */
@@ -30,6 +30,11 @@
 
 using namespace std::chrono_literals;
 
+namespace {
+// upper bound on how often bursts of folder state changes may re-render the tray icon
+constexpr auto trayStatusRecomputeIntervalC = 250ms;
+}
+
 namespace OCC {
 
 // simple helper to compute the overall status for the tray icon
@@ -54,6 +59,10 @@ TrayMenuController::TrayMenuController(QObject *parent)
 
     setupTrayContextMenu();
 
+    _statusRecomputeTimer.setSingleShot(true);
+    _statusRecomputeTimer.setInterval(trayStatusRecomputeIntervalC);
+    connect(&_statusRecomputeTimer, &QTimer::timeout, this, &TrayMenuController::slotComputeOverallSyncStatus);
+
     // init systray
     slotComputeOverallSyncStatus();
     _tray->show();
@@ -85,7 +94,11 @@ void TrayMenuController::slotTrayClicked(QSystemTrayIcon::ActivationReason reaso
 
 void TrayMenuController::slotSyncStateChange(Folder *folder)
 {
-    slotComputeOverallSyncStatus();
+    // Folders fire state changes in bursts, e.g. when connectivity flips for
+    // all folders of an account. Let the timer coalesce them.
+    if (!_statusRecomputeTimer.isActive()) {
+        _statusRecomputeTimer.start();
+    }
 
     if (!folder) {
         return; // Valid, just a general GUI redraw was needed.
@@ -115,9 +128,16 @@ QIcon TrayMenuController::getTrayStatusIcon(const SyncResult::Status &status) co
 
 void TrayMenuController::slotComputeOverallSyncStatus()
 {
-    auto status = trayOverallStatus();
-    const QIcon statusIcon = getTrayStatusIcon(status);
-    _tray->setIcon(statusIcon);
+    const auto status = trayOverallStatus();
+    const bool menuVisible = _tray->contextMenu() && _tray->contextMenu()->isVisible();
+    // Rendering the themed icon is the expensive part, skip it when nothing
+    // that influences it changed.
+    if (status == _lastTrayStatus && menuVisible == _lastTrayMenuVisible) {
+        return;
+    }
+    _lastTrayStatus = status;
+    _lastTrayMenuVisible = menuVisible;
+    _tray->setIcon(getTrayStatusIcon(status));
 }
 
 void TrayMenuController::setupTrayContextMenu()
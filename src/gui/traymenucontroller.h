@@ -20,6 +20,7 @@
 #include <QObject>
 #include <QPointer>
 #include <QSystemTrayIcon>
+#include <QTimer>
 
 namespace OCC {
 
@@ -66,6 +67,15 @@ private:
 
     QSystemTrayIcon *_tray;
     QPointer<ShareDialog> _shareDialog;
+
+    // Coalesces bursts of folder state changes into a single recomputation
+    // of the overall tray status.
+    QTimer _statusRecomputeTimer;
+
+    // The status and menu visibility the current tray icon was rendered for,
+    // used to skip re-rendering when the rollup did not actually change.
+    SyncResult::Status _lastTrayStatus = SyncResult::Undefined;
+    bool _lastTrayMenuVisible = false;
 };
 
 } // namespace OCC
@@ -68,8 +68,11 @@ UpdaterScheduler::UpdaterScheduler(Application *app, QObject *parent)
         });
     }
 
-    // at startup, do a check in any case.
-    QTimer::singleShot(3s, this, &UpdaterScheduler::slotTimerFired);
+    // At startup, do a check in any case - but give the sync startup a head
+    // start. With a fresh cache (see OCUpdater::checkForUpdate) the check
+    // costs nothing, and a stale cache is refreshed without the update
+    // server contending with the folders' first connections.
+    QTimer::singleShot(1min, this, &UpdaterScheduler::slotTimerFired);
 
     ConfigFile cfg;
     auto checkInterval = cfg.updateCheckInterval();
@@ -199,6 +202,22 @@ QString OCUpdater::availableVersionString() const
 
 void OCUpdater::checkForUpdate()
 {
+    // Serve the last fetched version information while it is fresh. A slow
+    // update server then cannot delay the startup check, and frequently
+    // restarted clients query it at most once per check interval.
+    auto settings = ConfigFile::makeQSettings();
+    const auto cacheTime = settings.value(cachedUpdateInfoTimeC).toDateTime();
+    if (cacheTime.isValid() && cacheTime.msecsTo(QDateTime::currentDateTimeUtc()) < ConfigFile().updateCheckInterval().count()) {
+        bool ok = false;
+        const auto cachedInfo = UpdateInfo::parseString(settings.value(cachedUpdateInfoC).toString(), &ok);
+        if (ok) {
+            qCInfo(lcUpdater) << "Using update information cached at" << cacheTime;
+            _updateInfo = cachedInfo;
+            versionInfoArrived(cachedInfo);
+            return;
+        }
+    }
+
     QNetworkReply *reply = _accessManager->get(QNetworkRequest(_updateUrl));
     connect(_timeoutWatchdog, &QTimer::timeout, this, &OCUpdater::slotTimedOut);
     _timeoutWatchdog->start(30s);
@@ -237,6 +256,9 @@ void OCUpdater::slotVersionInfoArrived()
     bool ok;
     _updateInfo = UpdateInfo::parseString(xml, &ok);
     if (ok) {
+        auto settings = ConfigFile::makeQSettings();
+        settings.setValue(cachedUpdateInfoC, xml);
+        settings.setValue(cachedUpdateInfoTimeC, QDateTime::currentDateTimeUtc());
         versionInfoArrived(_updateInfo);
     } else {
         qCWarning(lcUpdater) << "Could not parse update information.";
@@ -21,4 +21,8 @@ static const QString updateTargetVersionStringC = QStringLiteral("Updater/update
 // the config file key's name is preserved for legacy reasons
 static const QString previouslySkippedVersionC = QStringLiteral("Updater/seenVersion");
 static const QString autoUpdateAttemptedC = QStringLiteral("Updater/autoUpdateAttempted");
+// last successfully fetched version information, served instead of a
+// network round trip while younger than the update check interval
+static const QString cachedUpdateInfoC = QStringLiteral("Updater/cachedUpdateInfo");
+static const QString cachedUpdateInfoTimeC = QStringLiteral("Updater/cachedUpdateInfoTime");
 }
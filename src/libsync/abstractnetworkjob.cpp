@@ -199,6 +199,15 @@ void AbstractNetworkJob::slotFinished()
         _account->invalidCredentialsEncountered();
     }
 
+    // Feed the shared backoff state: overload replies raise the endpoint's
+    // backoff for every job, any success clears it.
+    const int httpStatus = _reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (httpStatus == 429 || httpStatus == 503) {
+        _account->retryBackoff().recordFailure(_reply->url());
+    } else if (_reply->error() == QNetworkReply::NoError) {
+        _account->retryBackoff().recordSuccess(_reply->url());
+    }
+
     if (_reply->error() != QNetworkReply::NoError) {
         if (_account->jobQueue()->retry(this)) {
             qCDebug(lcNetworkJob) << "Queued:" << this << "for retry";
@@ -361,6 +370,16 @@ QString networkReplyErrorString(const QNetworkReply &reply)
 void AbstractNetworkJob::retry()
 {
     OC_ENFORCE(!_verb.isEmpty());
+    if (_account) {
+        const auto delay = _account->retryBackoff().retryDelay(url());
+        // While the endpoint backs off, only the designated probe is sent;
+        // everyone else re-checks after their (individually jittered) delay.
+        if (delay > 0ms && !_account->retryBackoff().tryProbe(url())) {
+            qCInfo(lcNetworkJob) << "Endpoint is backing off, delaying retry of" << this << "by" << delay.count() << "ms";
+            QTimer::singleShot(delay, this, &AbstractNetworkJob::retry);
+            return;
+        }
+    }
     _retryCount++;
     qCInfo(lcNetworkJob) << "Restarting" << this << "for the" << _retryCount << "time";
     if (_requestBody) {
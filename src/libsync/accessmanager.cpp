@@ -13,6 +13,7 @@
  */
 
 #include <QAuthenticator>
+#include <QHostInfo>
 #include <QNetworkCookie>
 #include <QUuid>
 
@@ -60,6 +61,8 @@ QByteArray AccessManager::generateRequestId()
 
 QNetworkReply *AccessManager::createRequest(QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData)
 {
+    _lastRequest.start();
+
     QNetworkRequest newRequest(request);
     newRequest.setRawHeader(QByteArrayLiteral("User-Agent"), Utility::userAgentString());
 
@@ -92,15 +95,30 @@ QNetworkReply *AccessManager::createRequest(QNetworkAccessManager::Operation op,
 
     // todo: #23
     if (newRequest.url().scheme() == QLatin1String("https")) { // Not for "http": QTBUG-61397
-        // http2 seems to cause issues, as with our recommended server setup we don't support http2, disable it by default for now
-        static const bool http2EnabledEnv = qEnvironmentVariableIntValue("OWNCLOUD_HTTP2_ENABLED") == 1;
-
-        newRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, http2EnabledEnv);
+        // A request that set the attribute itself (the capability probe) keeps its choice.
+        if (newRequest.attribute(QNetworkRequest::Http2AllowedAttribute).isNull()) {
+            // Off until setHttp2Allowed() confirmed the server side: with our historically
+            // recommended server setup HTTP/2 was not supported and caused issues.
+            static const int http2EnabledEnv =
+                qEnvironmentVariableIsSet("OWNCLOUD_HTTP2_ENABLED") ? qEnvironmentVariableIntValue("OWNCLOUD_HTTP2_ENABLED") : -1;
+            const bool allowHttp2 = http2EnabledEnv < 0 ? _http2Allowed : http2EnabledEnv == 1;
+            newRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, allowHttp2);
+        }
     }
 
     // allow http pipelining
     newRequest.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
 
+    // Bulk transfer jobs mark themselves LowPriority (see the GET/PUT jobs),
+    // which already drives the HTTP/2 stream weights. Additionally tag them
+    // as background requests so platforms with a background transfer policy
+    // can let interactive traffic - hydration, video calls over the same
+    // VPN - go first. Socket-level DSCP marking is not reachable through
+    // QNetworkAccessManager, this attribute is as close as Qt gets.
+    if (newRequest.priority() == QNetworkRequest::LowPriority) {
+        newRequest.setAttribute(QNetworkRequest::BackgroundRequestAttribute, true);
+    }
+
     auto sslConfiguration = newRequest.sslConfiguration();
 
     sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
@@ -113,11 +131,67 @@ QNetworkReply *AccessManager::createRequest(QNetworkAccessManager::Operation op,
     }
     newRequest.setSslConfiguration(sslConfiguration);
 
+    {
+        QMutexLocker locker(&_verbCountsMutex);
+        ++_verbCounts[HttpLogger::requestVerb(op, newRequest)];
+    }
+
     const auto reply = QNetworkAccessManager::createRequest(op, newRequest, outgoingData);
     HttpLogger::logRequest(reply, op, outgoingData);
     return reply;
 }
 
+QHash<QByteArray, quint64> AccessManager::requestVerbCounts() const
+{
+    QMutexLocker locker(&_verbCountsMutex);
+    return _verbCounts;
+}
+
+void AccessManager::preconnect(const QUrl &url, int connectionCount)
+{
+    if (url.scheme() != QLatin1String("https")) {
+        return;
+    }
+    // The result is not needed here, the point is warming the resolver cache.
+    QHostInfo::lookupHost(url.host(), this, [](const QHostInfo &) { });
+
+    // Session reuse options as in createRequest(), so the handshakes these
+    // connections perform resume earlier sessions and the sessions they
+    // establish are available to the sync's requests.
+    auto sslConfiguration = QSslConfiguration::defaultConfiguration();
+    sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
+    sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionSharing, false);
+    sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    if (!_customTrustedCaCertificates.isEmpty()) {
+        sslConfiguration.addCaCertificates({ _customTrustedCaCertificates.begin(), _customTrustedCaCertificates.end() });
+    }
+    for (int i = 0; i < connectionCount; ++i) {
+        connectToHostEncrypted(url.host(), quint16(url.port(443)), sslConfiguration);
+    }
+}
+
+bool AccessManager::wasRecentlyUsed(std::chrono::milliseconds timespan) const
+{
+    return _lastRequest.isValid() && !_lastRequest.hasExpired(timespan.count());
+}
+
+bool AccessManager::isHttp2Allowed() const
+{
+    return _http2Allowed;
+}
+
+void AccessManager::setHttp2Allowed(bool allowed)
+{
+    if (_http2Allowed == allowed) {
+        return;
+    }
+    qCInfo(lcAccessManager) << "HTTP/2" << (allowed ? "enabled" : "disabled");
+    _http2Allowed = allowed;
+    // Drop the cached HTTP/1.1 connections so new requests consolidate onto
+    // multiplexed ones instead of reusing the old sockets indefinitely.
+    clearConnectionCache();
+}
+
 QSet<QSslCertificate> AccessManager::customTrustedCaCertificates()
 {
     return _customTrustedCaCertificates;
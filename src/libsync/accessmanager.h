@@ -16,8 +16,13 @@
 #define MIRALL_ACCESS_MANAGER_H
 
 #include "owncloudlib.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QNetworkAccessManager>
 
+#include <chrono>
+
 class QByteArray;
 class QUrl;
 
@@ -52,6 +57,41 @@ public:
 
     CookieJar *ownCloudCookieJar() const;
 
+    /***
+     * Whether new requests may negotiate HTTP/2
+     *
+     * Off by default; the account enables it once the capability probe
+     * confirmed the server actually negotiates HTTP/2, so the many small
+     * requests of a sync share a few multiplexed connections instead of
+     * six TCP sockets. OWNCLOUD_HTTP2_ENABLED=0/1 overrides in either
+     * direction.
+     */
+    bool isHttp2Allowed() const;
+    void setHttp2Allowed(bool allowed);
+
+    /***
+     * Opens (or refreshes) encrypted connections to the given server
+     *
+     * Called between syncs to keep a small pool of live connections, so the
+     * next sync starts on TLS-resumed sockets instead of paying DNS, TCP and
+     * TLS handshakes. Also re-resolves the host asynchronously to keep the
+     * resolver cache hot.
+     */
+    void preconnect(const QUrl &url, int connectionCount);
+
+    /***
+     * Whether a request went through this manager within the given timespan
+     */
+    bool wasRecentlyUsed(std::chrono::milliseconds timespan) const;
+
+    /***
+     * Number of requests issued per HTTP verb since construction
+     *
+     * Monotonically growing; consumers snapshot it around an operation to
+     * attribute request load, as the sync engine's performance report does.
+     */
+    QHash<QByteArray, quint64> requestVerbCounts() const;
+
     /***
      * Remove all errors for already accepted certificates
      */
@@ -62,6 +102,10 @@ protected:
 
 private:
     QSet<QSslCertificate> _customTrustedCaCertificates;
+    bool _http2Allowed = false;
+    QElapsedTimer _lastRequest;
+    mutable QMutex _verbCountsMutex;
+    QHash<QByteArray, quint64> _verbCounts;
 };
 
 } // namespace OCC
@@ -14,6 +14,7 @@
 
 #include "account.h"
 #include "accessmanager.h"
+#include "bandwidthlimiter.h"
 #include "capabilities.h"
 #include "cookiejar.h"
 #include "creds/abstractcredentials.h"
@@ -32,10 +33,34 @@
 #include <QSslKey>
 #include <QStandardPaths>
 
+#include <chrono>
+
+using namespace std::chrono_literals;
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcAccount, "sync.account", QtInfoMsg)
 
+namespace {
+    /// Below Qt's idle connection timeout and the scheduler's sync interval,
+    /// so the warm connections never get to expire between syncs.
+    constexpr auto connectionWarmupIntervalC = 20s;
+    /// An account that saw no request for this long stops being kept warm.
+    constexpr auto connectionWarmupIdleCutoffC = 10min;
+
+    /** Number of connections kept alive between syncs.
+     *
+     * OWNCLOUD_WARM_CONNECTIONS overrides it, 0 disables the warm pool.
+     */
+    int warmConnectionCount()
+    {
+        static const int count = qEnvironmentVariableIsSet("OWNCLOUD_WARM_CONNECTIONS")
+            ? qEnvironmentVariableIntValue("OWNCLOUD_WARM_CONNECTIONS")
+            : 2;
+        return count;
+    }
+}
+
 QString Account::_customCommonCacheDirectory = {};
 
 void Account::setCommonCacheDirectory(const QString &directory)
@@ -82,6 +107,20 @@ Account::Account(const QUuid &uuid, const QString &user, const QUrl &url, QObjec
     _resourcesCache = new ResourcesCache(resourcesCacheDir, this);
 
     _spacesManager = new GraphApi::SpacesManager(this);
+
+    // Bytes per second, 0 (or unset) disables pacing. The caps are global
+    // per account: all folders' transfer jobs share the same bucket.
+    _uploadLimiter = new BandwidthLimiter(qEnvironmentVariableIntValue("OWNCLOUD_UPLOAD_BANDWIDTH_LIMIT"), this);
+    _downloadLimiter = new BandwidthLimiter(qEnvironmentVariableIntValue("OWNCLOUD_DOWNLOAD_BANDWIDTH_LIMIT"), this);
+
+    _connectionWarmupTimer.setInterval(connectionWarmupIntervalC);
+    connect(&_connectionWarmupTimer, &QTimer::timeout, this, [this] {
+        // Only keep the pool warm while the account is actually in use,
+        // an idle account's connections may expire.
+        if (_am && _am->wasRecentlyUsed(connectionWarmupIdleCutoffC)) {
+            _am->preconnect(url(), warmConnectionCount());
+        }
+    });
 }
 
 Account::~Account()
@@ -108,6 +147,11 @@ void Account::cleanupForRemoval()
     }
 }
 
+QString Account::cacheDirectory() const
+{
+    return _cacheDirectory;
+}
+
 QString Account::davPath() const
 {
     return QLatin1String("/remote.php/dav/files/") + davUser() + QLatin1Char('/');
@@ -229,6 +273,10 @@ void Account::setCredentials(AbstractCredentials *cred)
     if (jar) {
         _am->setCookieJar(jar);
     }
+    _am->setHttp2Allowed(_http2Supported);
+    if (warmConnectionCount() > 0) {
+        _connectionWarmupTimer.start();
+    }
 
     // the network access manager takes ownership when setCache is called, so we have to reinitialize it every time we reset the manager
     _networkCache = new QNetworkDiskCache(this);
@@ -264,6 +312,14 @@ AccessManager *Account::accessManager() const
     return _am;
 }
 
+void Account::setHttp2Supported(bool value)
+{
+    _http2Supported = value;
+    if (_am) {
+        _am->setHttp2Allowed(value);
+    }
+}
+
 QNetworkReply *Account::sendRawRequest(const QByteArray &verb, const QUrl &url, QNetworkRequest req, QIODevice *data)
 {
     Q_ASSERT(verb.isUpper());
@@ -344,6 +400,16 @@ void Account::setCapabilities(const Capabilities &caps)
     }
 }
 
+QByteArray Account::capabilitiesEtag() const
+{
+    return _capabilitiesEtag;
+}
+
+void Account::setCapabilitiesEtag(const QByteArray &etag)
+{
+    _capabilitiesEtag = etag;
+}
+
 Account::ServerSupportLevel Account::serverSupportLevel() const
 {
     if (!hasCapabilities()) {
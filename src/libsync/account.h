@@ -21,6 +21,7 @@
 #include "appprovider.h"
 #include "capabilities.h"
 #include "jobqueue.h"
+#include "retrybackoff.h"
 
 #include <QPointer>
 #include <QByteArray>
@@ -30,6 +31,7 @@
 #include <QNetworkRequest>
 
 #include <QSslCertificate>
+#include <QTimer>
 #include <QUrl>
 #include <QUuid>
 #include <QtQmlIntegration/QtQmlIntegration>
@@ -40,6 +42,7 @@ class AccessManager;
 
 namespace OCC {
 
+class BandwidthLimiter;
 class CredentialManager;
 class AbstractCredentials;
 class AccessManager;
@@ -79,6 +82,9 @@ public:
     static void setCommonCacheDirectory(const QString &directory);
     static QString commonCacheDirectory();
 
+    /// The per-account cache directory; it outlives the session and is only removed with the account
+    QString cacheDirectory() const;
+
     // static AccountPtr create(const QUuid &uuid, const QString &user, const QUrl &url);
     Account(const QUuid &uuid, const QString &user, const QUrl &url, QObject *parent = nullptr);
     ~Account() override;
@@ -185,6 +191,14 @@ public:
 
     bool hasCapabilities() const;
 
+    /** Etag of the capabilities response the current capabilities came from.
+     *
+     * Persisted alongside the capabilities so a revalidation can send
+     * If-None-Match and get a cheap 304 when nothing changed on the server.
+     */
+    QByteArray capabilitiesEtag() const;
+    void setCapabilitiesEtag(const QByteArray &etag);
+
     void setAppProvider(AppProvider &&p);
     const AppProvider &appProvider() const;
 
@@ -198,7 +212,8 @@ public:
 
     /** True when the server connection is using HTTP2  */
     bool isHttp2Supported() { return _http2Supported; }
-    void setHttp2Supported(bool value) { _http2Supported = value; }
+    /** Also switches the access manager to multiplexed connections, see AccessManager::setHttp2Allowed() */
+    void setHttp2Supported(bool value);
 
     void clearCookieJar();
 
@@ -206,10 +221,19 @@ public:
 
     JobQueue *jobQueue();
 
+    /** Shared per-endpoint retry backoff, consulted by AbstractNetworkJob::retry() */
+    RetryBackoff &retryBackoff() { return _retryBackoff; }
+
     CredentialManager *credentialManager() const;
 
     GraphApi::SpacesManager *spacesManager() const { return _spacesManager; }
 
+    /** Token-bucket pacers shared by the transfer jobs of all folders
+     * syncing this account. Inactive unless a rate cap is configured.
+     */
+    BandwidthLimiter *uploadLimiter() const { return _uploadLimiter; }
+    BandwidthLimiter *downloadLimiter() const { return _downloadLimiter; }
+
     /**
      * We encountered an authentication error.
      */
@@ -258,18 +282,26 @@ private:
 
     QSet<QSslCertificate> _approvedCerts;
     Capabilities _capabilities;
+    QByteArray _capabilitiesEtag;
     QPointer<AccessManager> _am;
     QPointer<QNetworkDiskCache> _networkCache = nullptr;
     QPointer<ResourcesCache> _resourcesCache;
     QPointer<AbstractCredentials> _credentials;
     bool _http2Supported = false;
+    /// Periodically refreshes live connections between syncs, see setCredentials()
+    QTimer _connectionWarmupTimer;
 
     JobQueue _jobQueue;
     JobQueueGuard _queueGuard;
+    RetryBackoff _retryBackoff;
     CredentialManager *_credentialManager;
     AppProvider _appProvider;
 
     GraphApi::SpacesManager *_spacesManager = nullptr;
+
+    BandwidthLimiter *_uploadLimiter = nullptr;
+    BandwidthLimiter *_downloadLimiter = nullptr;
+
     friend class AccountManager;
 };
 }
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "bandwidthlimiter.h"
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+namespace OCC {
+
+// Refilling in small slices keeps concurrent transfers smooth without
+// busy-waking idle limiters.
+static const auto refillInterval = 100ms;
+
+BandwidthLimiter::BandwidthLimiter(qint64 bytesPerSecond, QObject *parent)
+    : QObject(parent)
+    , _bytesPerSecond(bytesPerSecond)
+    , _tokens(capacity())
+    , _lastRefill(steady_clock::now())
+{
+    _refillTimer.setInterval(refillInterval);
+    connect(&_refillTimer, &QTimer::timeout, this, &BandwidthLimiter::slotRefillTimeout);
+}
+
+qint64 BandwidthLimiter::capacity() const
+{
+    // Half a second worth of data: enough to even out scheduling jitter,
+    // small enough that a pause doesn't turn into a burst over the cap.
+    return qMax(_bytesPerSecond / 2, qint64(16 * 1024));
+}
+
+void BandwidthLimiter::setRate(qint64 bytesPerSecond)
+{
+    _bytesPerSecond = bytesPerSecond;
+    _tokens = qMin(_tokens, capacity());
+    if (!isActive()) {
+        _refillTimer.stop();
+        // Wake consumers that were waiting for tokens.
+        Q_EMIT replenished();
+    }
+}
+
+void BandwidthLimiter::addElapsedTokens()
+{
+    const auto now = steady_clock::now();
+    const auto elapsed = duration_cast<milliseconds>(now - _lastRefill);
+    _lastRefill = now;
+    _tokens = qMin(_tokens + _bytesPerSecond * elapsed.count() / 1000, capacity());
+}
+
+qint64 BandwidthLimiter::acquire(qint64 maxLen)
+{
+    if (!isActive()) {
+        return maxLen;
+    }
+    addElapsedTokens();
+    const qint64 granted = qMin(maxLen, _tokens);
+    _tokens -= granted;
+    if (granted == 0 && !_refillTimer.isActive()) {
+        _refillTimer.start();
+    }
+    return granted;
+}
+
+void BandwidthLimiter::slotRefillTimeout()
+{
+    addElapsedTokens();
+    if (_tokens > 0) {
+        _refillTimer.stop();
+        Q_EMIT replenished();
+    }
+}
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+
+namespace OCC {
+
+/**
+ * @brief Token bucket pacing transfers under a global rate cap
+ * @ingroup libsync
+ *
+ * One instance per account and direction is shared by the transfer jobs of
+ * all folders, so multiple parallel transfers together stay under the cap
+ * instead of parallelism being sacrificed for rate limiting.
+ *
+ * Consumers call acquire() before reading a slice of data. When the bucket
+ * is empty they stop consuming and resume on replenished(). A limiter with
+ * rate 0 is inactive and grants everything immediately.
+ */
+class OWNCLOUDSYNC_EXPORT BandwidthLimiter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BandwidthLimiter(qint64 bytesPerSecond, QObject *parent = nullptr);
+
+    bool isActive() const { return _bytesPerSecond > 0; }
+
+    qint64 rate() const { return _bytesPerSecond; }
+    void setRate(qint64 bytesPerSecond);
+
+    /** Take up to @p maxLen bytes worth of tokens from the bucket.
+     *
+     * Returns the granted amount, 0 when the bucket is empty. After a 0
+     * grant, replenished() is emitted once tokens are available again.
+     */
+    qint64 acquire(qint64 maxLen);
+
+Q_SIGNALS:
+    /** The bucket holds tokens again after acquire() returned 0. */
+    void replenished();
+
+private:
+    /// The burst the bucket can accumulate while no one is consuming.
+    qint64 capacity() const;
+    void addElapsedTokens();
+    void slotRefillTimeout();
+
+    qint64 _bytesPerSecond;
+    qint64 _tokens;
+    std::chrono::steady_clock::time_point _lastRefill;
+    /// Runs only while consumers are starved, to emit replenished().
+    QTimer _refillTimer;
+};
+}
@@ -17,6 +17,8 @@
 #include <QDebug>
 #include <QVariantMap>
 
+#include <iterator>
+
 using namespace std::chrono;
 
 namespace OCC {
@@ -24,15 +26,72 @@ namespace OCC {
 
 Capabilities::Capabilities(const QUrl &url, const QVariantMap &capabilities)
     : _capabilities(capabilities)
-    , _fileSharingCapabilities(_capabilities.value(QStringLiteral("files_sharing")).toMap())
-    , _fileSharingPublicCapabilities(_fileSharingCapabilities.value(QStringLiteral("public"), {}).toMap())
     , _tusSupport(_capabilities.value(QStringLiteral("files")).toMap().value(QStringLiteral("tus_support")).toMap())
     , _spaces(_capabilities.value(QStringLiteral("spaces")).toMap())
     , _status(_capabilities.value(QStringLiteral("core")).toMap().value(QStringLiteral("status")).toMap())
     , _appProviders(AppProviders::findVersion(
           url, _capabilities.value(QStringLiteral("files")).toMap().value(QStringLiteral("app_providers")).toList(), QVersionNumber({1, 1, 0})))
-    , _filesSharing(_fileSharingCapabilities)
-{
+    , _filesSharing(_capabilities.value(QStringLiteral("files_sharing")).toMap())
+{
+    // Parse everything once; queries like the per-job checksum checks then
+    // cost a plain field read instead of digging through nested maps.
+    const QVariantMap fileSharing = _capabilities.value(QStringLiteral("files_sharing")).toMap();
+    const QVariantMap fileSharingPublic = fileSharing.value(QStringLiteral("public"), {}).toMap();
+    const QVariantMap files = _capabilities.value(QStringLiteral("files")).toMap();
+    const QVariantMap dav = _capabilities.value(QStringLiteral("dav")).toMap();
+    const QVariantMap checksums = _capabilities.value(QStringLiteral("checksums")).toMap();
+
+    // These were added later, so if not present just assume the API and
+    // link sharing are enabled.
+    _shareAPI = fileSharing.value(QStringLiteral("api_enabled"), true).toBool();
+    _sharePublicLink = _shareAPI && fileSharingPublic.value(QStringLiteral("enabled"), true).toBool();
+    _defaultPermissions = fileSharing.value(QStringLiteral("default_permissions"), 1).toInt();
+    _avatarsAvailable = fileSharing.value(QStringLiteral("user")).toMap().value(QStringLiteral("profile_picture"), false).toBool();
+
+    _remotePollInterval =
+        duration_cast<seconds>(milliseconds(_capabilities.value(QStringLiteral("core")).toMap().value(QStringLiteral("pollinterval")).toInt()));
+
+    // We require the OCS style API in 9.x, can't deal with the REST one only found in 8.2
+    _notificationsAvailable = _capabilities.contains(QStringLiteral("notifications"))
+        && _capabilities.value(QStringLiteral("notifications")).toMap().contains(QStringLiteral("ocs-endpoints"));
+
+    const auto supportedTypes = checksums.value(QStringLiteral("supportedTypes")).toList();
+    for (const auto &t : supportedTypes) {
+        _supportedChecksumTypes.push_back(CheckSums::fromByteArray(t.toByteArray()));
+    }
+    _preferredUploadChecksumType =
+        CheckSums::fromByteArray(checksums.value(QStringLiteral("preferredUploadType"), QStringLiteral("SHA1")).toString().toUpper().toUtf8());
+    _transmissionChecksumType = [this] {
+        static auto envType = CheckSums::fromByteArray(qgetenv("OWNCLOUD_TRANSMISSION_CHECKSUM_TYPE"));
+        if (envType != CheckSums::Algorithm::NONE && envType != CheckSums::Algorithm::PARSE_ERROR
+            && _supportedChecksumTypes.contains(envType)) {
+            return envType;
+        }
+        const auto preferred = preferredUploadChecksumType();
+        if (preferred != CheckSums::Algorithm::PARSE_ERROR)
+            return preferred;
+        // No usable preference: take the cheapest algorithm the server accepts.
+        // CheckSums::All is ordered strongest first, so walk it backwards.
+        for (auto it = std::rbegin(CheckSums::All); it != std::rend(CheckSums::All); ++it) {
+            if (it->first != CheckSums::Algorithm::DUMMY_FOR_TESTS && _supportedChecksumTypes.contains(it->first)) {
+                return it->first;
+            }
+        }
+        return CheckSums::Algorithm::PARSE_ERROR;
+    }();
+
+    _supportsDeltaUpload = files.value(QStringLiteral("delta_upload")).toBool();
+    _uploadBundling = !dav.value(QStringLiteral("bundling")).toString().isEmpty();
+    _privateLinkPropertyAvailable = files.value(QStringLiteral("privateLinks")).toBool();
+    _privateLinkDetailsParamAvailable = files.value(QStringLiteral("privateLinksDetailsParam")).toBool();
+    _versioningEnabled = files.value(QStringLiteral("versioning")).toBool();
+    _blacklistedFiles = files.value(QStringLiteral("blacklisted_files")).toStringList();
+
+    const auto errorCodes = dav.value(QStringLiteral("httpErrorCodesThatResetFailingChunkedUploads")).toList();
+    for (const auto &t : errorCodes) {
+        _httpErrorCodesThatResetFailingChunkedUploads.push_back(t.toInt());
+    }
+    _invalidFilenameRegex = dav.value(QStringLiteral("invalidFilenameRegex")).toString();
 }
 
 QVariantMap Capabilities::raw() const
@@ -42,30 +101,27 @@ QVariantMap Capabilities::raw() const
 
 bool Capabilities::shareAPI() const
 {
-    // This was later added so if it is not present just assume the API is enabled.
-    return _fileSharingCapabilities.value(QStringLiteral("api_enabled"), true).toBool();
+    return _shareAPI;
 }
 
 bool Capabilities::sharePublicLink() const
 {
-    // This was later added so if it is not present just assume that link sharing is enabled.
-    return shareAPI() && _fileSharingPublicCapabilities.value(QStringLiteral("enabled"), true).toBool();
+    return _sharePublicLink;
 }
 
 int Capabilities::defaultPermissions() const
 {
-    return _fileSharingCapabilities.value(QStringLiteral("default_permissions"), 1).toInt();
+    return _defaultPermissions;
 }
 
 std::chrono::seconds Capabilities::remotePollInterval() const
 {
-    return duration_cast<seconds>(milliseconds(_capabilities.value(QStringLiteral("core")).toMap().value(QStringLiteral("pollinterval")).toInt()));
+    return _remotePollInterval;
 }
 
 bool Capabilities::notificationsAvailable() const
 {
-    // We require the OCS style API in 9.x, can't deal with the REST one only found in 8.2
-    return _capabilities.contains(QStringLiteral("notifications")) && _capabilities.value(QStringLiteral("notifications")).toMap().contains(QStringLiteral("ocs-endpoints"));
+    return _notificationsAvailable;
 }
 
 bool Capabilities::isValid() const
@@ -75,13 +131,7 @@ bool Capabilities::isValid() const
 
 QList<CheckSums::Algorithm> Capabilities::supportedChecksumTypes() const
 {
-    // TODO: compute once
-    QList<CheckSums::Algorithm> list;
-    const auto &supportedTypes = _capabilities.value(QStringLiteral("checksums")).toMap().value(QStringLiteral("supportedTypes")).toList();
-    for (const auto &t : supportedTypes) {
-        list.push_back(CheckSums::fromByteArray(t.toByteArray()));
-    }
-    return list;
+    return _supportedChecksumTypes;
 }
 
 CheckSums::Algorithm Capabilities::preferredUploadChecksumType() const
@@ -90,19 +140,12 @@ CheckSums::Algorithm Capabilities::preferredUploadChecksumType() const
     if (envType != CheckSums::Algorithm::NONE && envType != CheckSums::Algorithm::PARSE_ERROR) {
         return envType;
     }
-    const auto val = _capabilities.value(QStringLiteral("checksums")).toMap().value(QStringLiteral("preferredUploadType"), QStringLiteral("SHA1")).toString().toUpper().toUtf8();
-    return CheckSums::fromByteArray(val);
+    return _preferredUploadChecksumType;
 }
 
-CheckSums::Algorithm Capabilities::uploadChecksumType() const
+CheckSums::Algorithm Capabilities::transmissionChecksumType() const
 {
-    auto preferred = preferredUploadChecksumType();
-    if (preferred != CheckSums::Algorithm::PARSE_ERROR)
-        return preferred;
-    QList<CheckSums::Algorithm> supported = supportedChecksumTypes();
-    if (!supported.isEmpty())
-        return supported.first();
-    return CheckSums::Algorithm::PARSE_ERROR;
+    return _transmissionChecksumType;
 }
 
 const Status &Capabilities::status() const
@@ -120,45 +163,49 @@ const SpaceSupport &Capabilities::spacesSupport() const
     return _spaces;
 }
 
+bool Capabilities::supportsDeltaUpload() const
+{
+    return _supportsDeltaUpload;
+}
+
+bool Capabilities::uploadBundling() const
+{
+    return _uploadBundling;
+}
+
 bool Capabilities::privateLinkPropertyAvailable() const
 {
-    return _capabilities.value(QStringLiteral("files")).toMap().value(QStringLiteral("privateLinks")).toBool();
+    return _privateLinkPropertyAvailable;
 }
 
 bool Capabilities::privateLinkDetailsParamAvailable() const
 {
-    return _capabilities.value(QStringLiteral("files")).toMap().value(QStringLiteral("privateLinksDetailsParam")).toBool();
+    return _privateLinkDetailsParamAvailable;
 }
 
 QList<int> Capabilities::httpErrorCodesThatResetFailingChunkedUploads() const
 {
-    QList<int> list;
-    const auto &errorCodes = _capabilities.value(QStringLiteral("dav")).toMap().value(QStringLiteral("httpErrorCodesThatResetFailingChunkedUploads")).toList();
-    for (const auto &t : errorCodes) {
-        list.push_back(t.toInt());
-    }
-    return list;
+    return _httpErrorCodesThatResetFailingChunkedUploads;
 }
 
 QString Capabilities::invalidFilenameRegex() const
 {
-    return _capabilities[QStringLiteral("dav")].toMap()[QStringLiteral("invalidFilenameRegex")].toString();
+    return _invalidFilenameRegex;
 }
 
 bool Capabilities::versioningEnabled() const
 {
-    return _capabilities.value(QStringLiteral("files")).toMap().value(QStringLiteral("versioning")).toBool();
+    return _versioningEnabled;
 }
 
 bool Capabilities::avatarsAvailable() const
 {
-    auto userCaps = _fileSharingCapabilities.value(QStringLiteral("user")).toMap();
-    return userCaps.value(QStringLiteral("profile_picture"), false).toBool();
+    return _avatarsAvailable;
 }
 
 QStringList Capabilities::blacklistedFiles() const
 {
-    return _capabilities.value(QStringLiteral("files")).toMap().value(QStringLiteral("blacklisted_files")).toStringList();
+    return _blacklistedFiles;
 }
 
 Status::Status(const QVariantMap &status)
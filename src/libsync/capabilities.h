@@ -165,6 +165,23 @@ public:
     const TusSupport &tusSupport() const;
     const SpaceSupport &spacesSupport() const;
 
+    /** Whether the server accepts delta uploads of changed chunks only.
+     *
+     * Path: files/delta_upload
+     * Default: false. No released server advertises this yet; the client
+     * only tracks per-chunk content hashes while it is on.
+     */
+    bool supportsDeltaUpload() const;
+
+    /** Whether the server offers the upload bundling endpoint that takes
+     * many small files in one multipart request.
+     *
+     * Path: dav/bundling (version string)
+     * Default: off. The UploadBundler additionally disables itself for a
+     * sync run when the endpoint turns out to be missing after all.
+     */
+    bool uploadBundling() const;
+
     /// Whether the "privatelink" DAV property is available
     bool privateLinkPropertyAvailable() const;
 
@@ -199,10 +216,19 @@ public:
     OCC::CheckSums::Algorithm preferredUploadChecksumType() const;
 
     /**
-     * Helper that returns the preferredUploadChecksumType() if set, or one
-     * of the supportedChecksumTypes() if it isn't.
+     * The algorithm for the transmission checksum of uploads.
+     *
+     * The transmission checksum only guards the transfer itself - the
+     * journal keeps a separate content checksum - so the cheapest
+     * algorithm the server accepts is good enough. Returns the
+     * preferredUploadChecksumType() when the server states a usable one,
+     * otherwise the cheapest of the supportedChecksumTypes().
+     *
+     * OWNCLOUD_TRANSMISSION_CHECKSUM_TYPE overrides the server's
+     * preference, for deployments where hashing limits upload throughput
+     * on weak CPUs; an algorithm the server does not support is ignored.
      */
-    CheckSums::Algorithm uploadChecksumType() const;
+    CheckSums::Algorithm transmissionChecksumType() const;
 
     /**
      * List of HTTP error codes should be guaranteed to eventually reset
@@ -254,14 +280,33 @@ public:
     QVariantMap raw() const;
 
 private:
+    // The original parsed JSON. Kept only so raw() can persist the
+    // capabilities to the account settings; all queries are answered from
+    // the typed fields below, parsed once at construction.
     QVariantMap _capabilities;
-    QVariantMap _fileSharingCapabilities;
-    QVariantMap _fileSharingPublicCapabilities;
     TusSupport _tusSupport;
     SpaceSupport _spaces;
     Status _status;
     AppProviders _appProviders;
     FilesSharing _filesSharing;
+
+    bool _shareAPI = true;
+    bool _sharePublicLink = true;
+    int _defaultPermissions = 1;
+    std::chrono::seconds _remotePollInterval { 0 };
+    bool _notificationsAvailable = false;
+    QList<CheckSums::Algorithm> _supportedChecksumTypes;
+    CheckSums::Algorithm _preferredUploadChecksumType = CheckSums::Algorithm::NONE;
+    CheckSums::Algorithm _transmissionChecksumType = CheckSums::Algorithm::NONE;
+    bool _supportsDeltaUpload = false;
+    bool _uploadBundling = false;
+    bool _privateLinkPropertyAvailable = false;
+    bool _privateLinkDetailsParamAvailable = false;
+    QList<int> _httpErrorCodesThatResetFailingChunkedUploads;
+    QString _invalidFilenameRegex;
+    QStringList _blacklistedFiles;
+    bool _versioningEnabled = false;
+    bool _avatarsAvailable = false;
 };
 }
 
@@ -30,7 +30,10 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QLoggingCategory>
+#include <QMutex>
 #include <QSettings>
 #include <QNetworkProxy>
 #include <QOperatingSystemVersion>
@@ -46,9 +49,12 @@ namespace chrono = std::chrono;
 Q_LOGGING_CATEGORY(lcConfigFile, "sync.configfile", QtInfoMsg)
 namespace  {
 const QString logHttpC() { return QStringLiteral("logHttp"); }
+const QString binaryLogFormatC() { return QStringLiteral("binaryLogFormat"); }
+const QString httpLogBodySampleRateC() { return QStringLiteral("httpLogBodySampleRate"); }
 const QString remotePollIntervalC() { return QStringLiteral("remotePollInterval"); }
 const QString forceSyncIntervalC() { return QStringLiteral("forceSyncInterval"); }
 const QString fullLocalDiscoveryIntervalC() { return QStringLiteral("fullLocalDiscoveryInterval"); }
+const QString trustJournalAtStartupC() { return QStringLiteral("trustJournalAtStartup"); }
 const QString monoIconsC() { return QStringLiteral("monoIcons"); }
 const QString promptDeleteC() { return QStringLiteral("promptDeleteAllFiles"); }
 const QString crashReporterC() { return QStringLiteral("crashReporter"); }
@@ -89,20 +95,110 @@ const QString issuesWidgetFilterC()
     return QStringLiteral("issuesWidgetFilter");
 }
 
+const QString vfsHydrationDenylistC()
+{
+    return QStringLiteral("vfsHydrationDenylist");
+}
+
 QString excludeFileNameC()
 {
     return QStringLiteral("sync-exclude.lst");
 }
 
+/** Process-wide cache of the config file's contents.
+ *
+ * ConfigFile reads used to construct a QSettings - and thereby re-parse the
+ * INI file - on nearly every access; timeouts and intervals are queried per
+ * job, so the parsing showed up in propagation profiles. The cache parses
+ * the file once and serves reads from a hash. It is invalidated by
+ * ConfigFile's own writers, and by a file watcher for writes that go
+ * through other QSettings instances or an external editor, so changes
+ * still take effect without a restart.
+ */
+class ConfigCache
+{
+public:
+    static ConfigCache *instance()
+    {
+        static ConfigCache cache;
+        return &cache;
+    }
+
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant())
+    {
+        QMutexLocker locker(&_mutex);
+        ensureLoaded();
+        return _values.value(key, defaultValue);
+    }
+
+    bool contains(const QString &key)
+    {
+        QMutexLocker locker(&_mutex);
+        ensureLoaded();
+        return _values.contains(key);
+    }
+
+    void invalidate()
+    {
+        QMutexLocker locker(&_mutex);
+        _loaded = false;
+        _values.clear();
+    }
+
+private:
+    ConfigCache() = default;
+
+    void ensureLoaded()
+    {
+        if (_loaded) {
+            return;
+        }
+        auto settings = ConfigFile::makeQSettings();
+        const QStringList keys = settings.allKeys();
+        _values.clear();
+        _values.reserve(keys.size());
+        for (const auto &key : keys) {
+            _values.insert(key, settings.value(key));
+        }
+        _loaded = true;
+        installWatcher();
+    }
+
+    void installWatcher()
+    {
+        if (_watcherInstalled || !qApp) {
+            return;
+        }
+        _watcherInstalled = true;
+        // The watcher needs a thread with an event loop, create it there
+        QMetaObject::invokeMethod(qApp, [] {
+            auto watcher = new QFileSystemWatcher(qApp);
+            const QString path = ConfigFile::configFile();
+            watcher->addPath(path);
+            QObject::connect(watcher, &QFileSystemWatcher::fileChanged, qApp, [watcher, path] {
+                ConfigCache::instance()->invalidate();
+                // QSettings and most editors replace the file, re-arm the watch
+                if (!watcher->files().contains(path)) {
+                    watcher->addPath(path);
+                }
+            });
+        });
+    }
+
+    QMutex _mutex;
+    bool _loaded = false;
+    bool _watcherInstalled = false;
+    QHash<QString, QVariant> _values;
+};
+
 } // anonymous namespace
 
 QString ConfigFile::_confDir = QString();
 const std::chrono::seconds DefaultRemotePollInterval { 30 };
 
-static chrono::milliseconds millisecondsValue(const QSettings &setting, const QString &key,
-    chrono::milliseconds defaultValue)
+static chrono::milliseconds millisecondsValue(const QString &key, chrono::milliseconds defaultValue)
 {
-    return chrono::milliseconds(setting.value(key, qlonglong(defaultValue.count())).toLongLong());
+    return chrono::milliseconds(ConfigCache::instance()->value(key, qlonglong(defaultValue.count())).toLongLong());
 }
 
 ConfigFile::ConfigFile()
@@ -125,6 +221,7 @@ bool ConfigFile::setConfDir(const QString &value)
         dirPath = fi.absoluteFilePath();
         qCInfo(lcConfigFile) << "Using custom config dir " << dirPath;
         _confDir = dirPath;
+        ConfigCache::instance()->invalidate();
         return true;
     }
     return false;
@@ -132,31 +229,34 @@ bool ConfigFile::setConfDir(const QString &value)
 
 bool ConfigFile::optionalDesktopNotifications() const
 {
-    auto settings = makeQSettings();
-    return settings.value(optionalDesktopNotificationsC(), true).toBool();
+    return ConfigCache::instance()->value(optionalDesktopNotificationsC(), true).toBool();
 }
 
 std::optional<QStringList> ConfigFile::issuesWidgetFilter() const
 {
-    auto settings = makeQSettings();
-    if (settings.contains(issuesWidgetFilterC())) {
-        return settings.value(issuesWidgetFilterC()).toStringList();
+    if (ConfigCache::instance()->contains(issuesWidgetFilterC())) {
+        return ConfigCache::instance()->value(issuesWidgetFilterC()).toStringList();
     }
 
     return {};
 }
 
+QStringList ConfigFile::vfsHydrationDenylist() const
+{
+    return ConfigCache::instance()->value(vfsHydrationDenylistC()).toStringList();
+}
+
 void ConfigFile::setIssuesWidgetFilter(const QStringList &checked)
 {
     auto settings = makeQSettings();
     settings.setValue(issuesWidgetFilterC(), checked);
     settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 std::chrono::seconds ConfigFile::timeout() const
 {
-    auto settings = makeQSettings();
-    const auto val = settings.value(timeoutC()).toInt(); // default to 5 min
+    const auto val = ConfigCache::instance()->value(timeoutC()).toInt(); // default to 5 min
     return val ? std::chrono::seconds(val) : 5min;
 }
 
@@ -165,6 +265,7 @@ void ConfigFile::setOptionalDesktopNotifications(bool show)
     auto settings = makeQSettings();
     settings.setValue(optionalDesktopNotificationsC(), show);
     settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 void ConfigFile::saveGeometry(QWidget *w)
@@ -174,6 +275,7 @@ void ConfigFile::saveGeometry(QWidget *w)
     settings.beginGroup(w->objectName());
     settings.setValue(geometryC(), w->saveGeometry());
     settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 void ConfigFile::restoreGeometry(QWidget *w)
@@ -191,16 +293,16 @@ void ConfigFile::saveGeometryHeader(QHeaderView *header)
     settings.beginGroup(header->objectName());
     settings.setValue(geometryC(), header->saveState());
     settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 bool ConfigFile::restoreGeometryHeader(QHeaderView *header)
 {
     Q_ASSERT(header && !header->objectName().isNull());
 
-    auto settings = makeQSettings();
-    settings.beginGroup(header->objectName());
-    if (settings.contains(geometryC())) {
-        header->restoreState(settings.value(geometryC()).toByteArray());
+    const QString key = header->objectName() + QLatin1Char('/') + geometryC();
+    if (ConfigCache::instance()->contains(key)) {
+        header->restoreState(ConfigCache::instance()->value(key).toByteArray());
         return true;
     }
     return false;
@@ -302,6 +404,7 @@ void ConfigFile::storeData(const QString &group, const QString &key, const QVari
     settings.beginGroup(con);
     settings.setValue(key, value);
     settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 void ConfigFile::removeData(const QString &group, const QString &key)
@@ -311,15 +414,13 @@ void ConfigFile::removeData(const QString &group, const QString &key)
 
     settings.beginGroup(con);
     settings.remove(key);
+    ConfigCache::instance()->invalidate();
 }
 
 bool ConfigFile::dataExists(const QString &group, const QString &key) const
 {
     const QString con(group.isEmpty() ? defaultConnection() : group);
-    auto settings = makeQSettings();
-
-    settings.beginGroup(con);
-    return settings.contains(key);
+    return ConfigCache::instance()->contains(con + QLatin1Char('/') + key);
 }
 
 chrono::milliseconds ConfigFile::remotePollInterval(std::chrono::seconds defaultVal, const QString &connection) const
@@ -328,9 +429,6 @@ chrono::milliseconds ConfigFile::remotePollInterval(std::chrono::seconds default
     if (connection.isEmpty())
         con = defaultConnection();
 
-    auto settings = makeQSettings();
-    settings.beginGroup(con);
-
     auto defaultPollInterval { DefaultRemotePollInterval };
 
     // The server default-capabilities was set to 60 in some server releases,
@@ -341,7 +439,7 @@ chrono::milliseconds ConfigFile::remotePollInterval(std::chrono::seconds default
     if (defaultVal > chrono::seconds(5)) {
         defaultPollInterval = defaultVal;
     }
-    auto remoteInterval = millisecondsValue(settings, remotePollIntervalC(), defaultPollInterval);
+    auto remoteInterval = millisecondsValue(con + QLatin1Char('/') + remotePollIntervalC(), defaultPollInterval);
     if (remoteInterval < chrono::seconds(5)) {
         remoteInterval = defaultPollInterval;
         qCWarning(lcConfigFile) << "Remote Interval is less than 5 seconds, reverting to" << remoteInterval.count();
@@ -363,6 +461,7 @@ void ConfigFile::setRemotePollInterval(chrono::milliseconds interval, const QStr
     settings.beginGroup(con);
     settings.setValue(remotePollIntervalC(), qlonglong(interval.count()));
     settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 chrono::milliseconds ConfigFile::forceSyncInterval(std::chrono::seconds remoteFromCapabilities, const QString &connection) const
@@ -372,11 +471,9 @@ chrono::milliseconds ConfigFile::forceSyncInterval(std::chrono::seconds remoteFr
     QString con(connection);
     if (connection.isEmpty())
         con = defaultConnection();
-    auto settings = makeQSettings();
-    settings.beginGroup(con);
 
     auto defaultInterval = chrono::hours(2);
-    auto interval = millisecondsValue(settings, forceSyncIntervalC(), defaultInterval);
+    auto interval = millisecondsValue(con + QLatin1Char('/') + forceSyncIntervalC(), defaultInterval);
     if (interval < pollInterval) {
         qCWarning(lcConfigFile) << "Force sync interval is less than the remote poll inteval, reverting to" << pollInterval.count();
         interval = pollInterval;
@@ -386,9 +483,12 @@ chrono::milliseconds ConfigFile::forceSyncInterval(std::chrono::seconds remoteFr
 
 chrono::milliseconds OCC::ConfigFile::fullLocalDiscoveryInterval() const
 {
-    auto settings = makeQSettings();
-    settings.beginGroup(defaultConnection());
-    return millisecondsValue(settings, fullLocalDiscoveryIntervalC(), 1h);
+    return millisecondsValue(defaultConnection() + QLatin1Char('/') + fullLocalDiscoveryIntervalC(), 1h);
+}
+
+bool ConfigFile::trustJournalAtStartup() const
+{
+    return ConfigCache::instance()->value(trustJournalAtStartupC(), false).toBool();
 }
 
 chrono::milliseconds ConfigFile::updateCheckInterval(const QString &connection) const
@@ -396,11 +496,9 @@ chrono::milliseconds ConfigFile::updateCheckInterval(const QString &connection)
     QString con(connection);
     if (connection.isEmpty())
         con = defaultConnection();
-    auto settings = makeQSettings();
-    settings.beginGroup(con);
 
     auto defaultInterval = chrono::hours(10);
-    auto interval = millisecondsValue(settings, updateCheckIntervalC(), defaultInterval);
+    auto interval = millisecondsValue(con + QLatin1Char('/') + updateCheckIntervalC(), defaultInterval);
 
     auto minInterval = chrono::minutes(5);
     if (interval < minInterval) {
@@ -412,14 +510,15 @@ chrono::milliseconds ConfigFile::updateCheckInterval(const QString &connection)
 
 QString ConfigFile::uiLanguage() const
 {
-    auto settings = makeQSettings();
-    return settings.value(uiLanguageC(), QString()).toString();
+    return ConfigCache::instance()->value(uiLanguageC(), QString()).toString();
 }
 
 void ConfigFile::setUiLanguage(const QString &uiLanguage)
 {
     auto settings = makeQSettings();
     settings.setValue(uiLanguageC(), uiLanguage);
+    settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 void ConfigFile::setProxyType(QNetworkProxy::ProxyType proxyType, const QString &host, int port, bool needsAuth, const QString &user)
@@ -435,16 +534,16 @@ void ConfigFile::setProxyType(QNetworkProxy::ProxyType proxyType, const QString
         settings.setValue(proxyUserC(), user);
     }
     settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 QVariant ConfigFile::getValue(const QString &param, const QString &group,
     const QVariant &defaultValue) const
 {
-    auto settings = makeQSettings();
-    if (!group.isEmpty())
-        settings.beginGroup(group);
-
-    return settings.value(param, defaultValue);
+    if (!group.isEmpty()) {
+        return ConfigCache::instance()->value(group + QLatin1Char('/') + param, defaultValue);
+    }
+    return ConfigCache::instance()->value(param, defaultValue);
 }
 
 void ConfigFile::setValue(const QString &key, const QVariant &value)
@@ -452,6 +551,8 @@ void ConfigFile::setValue(const QString &key, const QVariant &value)
     auto settings = makeQSettings();
 
     settings.setValue(key, value);
+    settings.sync();
+    ConfigCache::instance()->invalidate();
 }
 
 int ConfigFile::proxyType() const
@@ -494,67 +595,57 @@ void ConfigFile::setPauseSyncWhenMetered(bool isChecked)
 
 bool ConfigFile::promptDeleteFiles() const
 {
-    auto settings = makeQSettings();
-    return settings.value(promptDeleteC(), true).toBool();
+    return ConfigCache::instance()->value(promptDeleteC(), true).toBool();
 }
 
 void ConfigFile::setPromptDeleteFiles(bool promptDeleteFiles)
 {
-    auto settings = makeQSettings();
-    settings.setValue(promptDeleteC(), promptDeleteFiles);
+    setValue(promptDeleteC(), promptDeleteFiles);
 }
 
 bool ConfigFile::monoIcons() const
 {
-    auto settings = makeQSettings();
     bool monoDefault = false; // On Mac we want bw by default
 #ifdef Q_OS_MAC
     // OEM themes are not obliged to ship mono icons
     monoDefault = Theme::instance()->appNameGUI() == QStringLiteral("ownCloud");
 #endif
-    return settings.value(monoIconsC(), monoDefault).toBool();
+    return ConfigCache::instance()->value(monoIconsC(), monoDefault).toBool();
 }
 
 void ConfigFile::setMonoIcons(bool useMonoIcons)
 {
-    auto settings = makeQSettings();
-    settings.setValue(monoIconsC(), useMonoIcons);
+    setValue(monoIconsC(), useMonoIcons);
 }
 
 bool ConfigFile::crashReporter() const
 {
-    auto settings = makeQSettings();
-    return settings.value(crashReporterC(), true).toBool();
+    return ConfigCache::instance()->value(crashReporterC(), true).toBool();
 }
 
 void ConfigFile::setCrashReporter(bool enabled)
 {
-    auto settings = makeQSettings();
-    settings.setValue(crashReporterC(), enabled);
+    setValue(crashReporterC(), enabled);
 }
 
 bool ConfigFile::automaticLogDir() const
 {
-    auto settings = makeQSettings();
-    return settings.value(automaticLogDirC(), false).toBool();
+    return ConfigCache::instance()->value(automaticLogDirC(), false).toBool();
 }
 
 void ConfigFile::setAutomaticLogDir(bool enabled)
 {
-    auto settings = makeQSettings();
-    settings.setValue(automaticLogDirC(), enabled);
+    setValue(automaticLogDirC(), enabled);
 }
 
 int ConfigFile::automaticDeleteOldLogs() const
 {
-    auto settings = makeQSettings();
-    return settings.value(numberOfLogsToKeepC()).toInt();
+    return ConfigCache::instance()->value(numberOfLogsToKeepC()).toInt();
 }
 
 void ConfigFile::setAutomaticDeleteOldLogs(int number)
 {
-    auto settings = makeQSettings();
-    settings.setValue(numberOfLogsToKeepC(), number);
+    setValue(numberOfLogsToKeepC(), number);
 }
 
 void ConfigFile::configureHttpLogging(std::optional<bool> enable)
@@ -565,6 +656,8 @@ void ConfigFile::configureHttpLogging(std::optional<bool> enable)
 
     auto settings = makeQSettings();
     settings.setValue(logHttpC(), enable.value());
+    settings.sync();
+    ConfigCache::instance()->invalidate();
 
     static const QSet<QString> rule = { QStringLiteral("sync.httplogger=true") };
 
@@ -577,20 +670,27 @@ void ConfigFile::configureHttpLogging(std::optional<bool> enable)
 
 bool ConfigFile::logHttp() const
 {
-    auto settings = makeQSettings();
-    return settings.value(logHttpC(), false).toBool();
+    return ConfigCache::instance()->value(logHttpC(), false).toBool();
+}
+
+bool ConfigFile::binaryLogFormat() const
+{
+    return ConfigCache::instance()->value(binaryLogFormatC(), false).toBool();
+}
+
+int ConfigFile::httpLogBodySampleRate() const
+{
+    return ConfigCache::instance()->value(httpLogBodySampleRateC(), 1).toInt();
 }
 
 QString ConfigFile::clientVersionWithBuildNumberString() const
 {
-    auto settings = makeQSettings();
-    return settings.value(clientVersionC(), QString()).toString();
+    return ConfigCache::instance()->value(clientVersionC(), QString()).toString();
 }
 
 void ConfigFile::setClientVersionWithBuildNumberString(const QString &version)
 {
-    auto settings = makeQSettings();
-    settings.setValue(clientVersionC(), version);
+    setValue(clientVersionC(), version);
 }
 
 std::unique_ptr<QSettings> ConfigFile::settingsWithGroup(const QString &group)
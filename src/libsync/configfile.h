@@ -81,6 +81,18 @@ public:
      */
     std::chrono::milliseconds fullLocalDiscoveryInterval() const;
 
+    /** Whether the first sync after process start may serve local discovery
+     * from the journal even though no full local walk has run yet.
+     *
+     * Skips the startup tree walk over large (virtual) folders, which
+     * dominates login time on folders with hundreds of thousands of
+     * placeholders. Local changes made while the client wasn't running are
+     * picked up lazily: the folder watcher reports anything touched from now
+     * on, and the next periodic full local discovery verifies the rest, see
+     * fullLocalDiscoveryInterval(). Defaults to off.
+     */
+    bool trustJournalAtStartup() const;
+
     bool monoIcons() const;
     void setMonoIcons(bool);
 
@@ -104,12 +116,28 @@ public:
     /** Whether to log http traffic */
     bool logHttp() const;
 
+    /** Whether log files use the compact binary format.
+     *
+     * Binary logs are much smaller and cheaper to write than the text
+     * format and are rendered back to text with the logcat tool, see
+     * common/binarylog.h.
+     */
+    bool binaryLogFormat() const;
+
     /**
      * Set up HTTP logging.
      * This method should be called during application startup to make sure no messages are missed.
      */
     void configureHttpLogging(std::optional<bool> enable = std::nullopt);
 
+    /** Log only every Nth request/response body when HTTP logging is on.
+     *
+     * Bodies are the expensive part of HTTP logging; sampling them keeps
+     * logging affordable on busy deployments. Error replies always include
+     * their body. Defaults to 1, every body is logged.
+     */
+    int httpLogBodySampleRate() const;
+
     // proxy settings
     void setProxyType(
         QNetworkProxy::ProxyType proxyType, const QString &host = QString(), int port = 0, bool needsAuth = false, const QString &user = QString());
@@ -123,6 +151,13 @@ public:
     bool pauseSyncWhenMetered() const;
     void setPauseSyncWhenMetered(bool isChecked);
 
+    /** Executable base names (e.g. "SearchProtocolHost.exe") whose reads must
+     * not hydrate dehydrated placeholders. The VFS plugin denies fetch requests
+     * from these processes, so indexers and thumbnail extractors can't
+     * mass-hydrate whole folders by scanning them. Matched case-insensitively.
+     */
+    QStringList vfsHydrationDenylist() const;
+
     /// Used for testing, so we do not change the user's config file.
     static bool setConfDir(const QString &value);
 
@@ -20,7 +20,9 @@
 #include "csync/vio/csync_vio_local.h"
 
 #include "common/checksums.h"
+#include "common/chronoelapsedtimer.h"
 #include "common/syncjournaldb.h"
+#include "common/tracer.h"
 
 #include "libsync/theme.h"
 
@@ -38,9 +40,15 @@ void ProcessDirectoryJob::start()
     qCInfo(lcDisco) << "STARTING" << _currentFolder._server << _queryServer << _currentFolder._local << _queryLocal;
 
     if (_queryServer == NormalQuery) {
-        _serverJob = startAsyncServerQuery();
-        if (!_serverJob)
-            return;
+        if (auto prefetched = _discoveryData->takePrefetchedListing(_currentFolder._server)) {
+            // This subtree was already fetched by the recursive root PROPFIND.
+            _serverNormalQueryEntries = std::move(*prefetched);
+            _serverQueryDone = true;
+        } else {
+            _serverJob = startAsyncServerQuery();
+            if (!_serverJob)
+                return;
+        }
     } else {
         _serverQueryDone = true;
     }
@@ -50,11 +58,28 @@ void ProcessDirectoryJob::start()
         if (!_discoveryData->_shouldDiscoverLocaly(_currentFolder._local)
             && (_currentFolder._local == _currentFolder._original || !_discoveryData->_shouldDiscoverLocaly(_currentFolder._original))) {
             _queryLocal = ParentNotChanged;
+        } else if (_discoveryData->_localTouchedChildren && _currentFolder._local == _currentFolder._original
+            && _discoveryData->_syncOptions.isValid() && _discoveryData->_syncOptions.vfs()->mode() == Vfs::Off) {
+            // If this directory only needs discovery because individual
+            // entries below it were touched, stat just those and mirror the
+            // rest from the journal in process(). Not done with VFS since
+            // placeholder sizes on disk differ from the journal's.
+            _localTargetedNames = _discoveryData->_localTouchedChildren(_currentFolder._local);
         }
     }
 
     if (_queryLocal == NormalQuery) {
-        startAsyncLocalQuery();
+        Optional<QVector<LocalInfo>> prefetched;
+        if (_localTargetedNames.isEmpty() && _discoveryData->_localTreeWalker)
+            prefetched = _discoveryData->_localTreeWalker->takeListing(_currentFolder._local);
+        if (prefetched) {
+            // Already listed by the parallel local tree walker.
+            _localNormalQueryEntries = std::move(*prefetched);
+            ++_discoveryData->_statistics.localDirectoriesListed;
+            _localQueryDone = true;
+        } else {
+            startAsyncLocalQuery();
+        }
     } else {
         _localQueryDone = true;
     }
@@ -66,8 +91,11 @@ void ProcessDirectoryJob::start()
 
 void ProcessDirectoryJob::process()
 {
+    OC_TRACE_SPAN("discovery", "ProcessDirectoryJob::process");
     OC_ASSERT(_localQueryDone && _serverQueryDone);
 
+    Utility::ChronoElapsedTimer reconcileTimer;
+
     // Build lookup tables for local, remote and db entries.
     // For suffix-virtual files, the key will normally be the base file name
     // without the suffix.
@@ -80,28 +108,63 @@ void ProcessDirectoryJob::process()
         RemoteInfo serverEntry;
         LocalInfo localEntry;
     };
+    // The names from the three sources below are separate allocations of
+    // (usually) the same text; routing them through the interner makes them
+    // share one payload, which the map keys and the items then reuse.
     std::map<QString, Entries> entries;
     for (auto &e : _serverNormalQueryEntries) {
+        e.name = _discoveryData->_nameInterner.intern(e.name);
         entries[e.name].serverEntry = std::move(e);
     }
     _serverNormalQueryEntries.clear();
 
     // fetch all the name from the DB
     auto pathU8 = _currentFolder._original.toUtf8();
-    if (!_discoveryData->_statedb->listFilesInPath(pathU8, [&](const SyncJournalFileRecord &rec) {
-            auto name = pathU8.isEmpty() ? QString::fromUtf8(rec._path) : QString::fromUtf8(rec._path.constData() + (pathU8.size() + 1));
-            auto &dbEntry = entries[name].dbEntry;
-            dbEntry = rec;
-        })) {
+    Utility::ChronoElapsedTimer journalTimer;
+    const auto addDbEntry = [&](const SyncJournalFileRecord &rec) {
+        const auto name = _discoveryData->_nameInterner.intern(
+            pathU8.isEmpty() ? QString::fromUtf8(rec._path) : QString::fromUtf8(rec._path.constData() + (pathU8.size() + 1)));
+        auto &dbEntry = entries[name].dbEntry;
+        dbEntry = rec;
+    };
+    if (_discoveryData->_journalSnapshotValid) {
+        const auto it = _discoveryData->_journalSnapshot.constFind(pathU8);
+        if (it != _discoveryData->_journalSnapshot.cend()) {
+            for (const auto &rec : *it) {
+                addDbEntry(rec);
+            }
+        }
+    } else if (!_discoveryData->_statedb->listFilesInPath(pathU8, addDbEntry)) {
         dbError();
         return;
     }
+    _discoveryData->_statistics.journalListingTime += journalTimer.duration();
 
     for (auto &e : _localNormalQueryEntries) {
+        e.name = _discoveryData->_nameInterner.intern(e.name);
         entries[e.name].localEntry = e;
     }
     _localNormalQueryEntries.clear();
 
+    if (!_localTargetedNames.isEmpty()) {
+        // The local query only stat'ed the touched names. Everything else is
+        // unchanged on disk, so mirror it from the journal as if the full
+        // listing had returned it.
+        for (auto &entry : entries) {
+            const SyncJournalFileRecord &rec = entry.second.dbEntry;
+            if (!rec.isValid() || entry.second.localEntry.isValid() || _localTargetedNames.contains(entry.first))
+                continue;
+            LocalInfo &li = entry.second.localEntry;
+            li.name = entry.first;
+            li.modtime = rec._modtime;
+            li.size = rec._fileSize;
+            li.inode = rec._inode;
+            li.type = rec._type;
+            li.isDirectory = rec._type == ItemTypeDirectory;
+            li.isVirtualFile = rec.isVirtualFile();
+        }
+    }
+
     //
     // Iterate over entries and process them
     //
@@ -131,6 +194,7 @@ void ProcessDirectoryJob::process()
             if (!e.localEntry.isValid() && e.dbEntry.isValid()) {
                 qCWarning(lcDisco) << "Removing db entry for non existing ignored file:" << path._original;
                 _discoveryData->_statedb->deleteFileRecord(path._original, true);
+                _discoveryData->forgetRecordForMoveDetection(path._original.toUtf8());
             }
             continue;
         }
@@ -139,8 +203,17 @@ void ProcessDirectoryJob::process()
             processBlacklisted(path, e.localEntry, e.dbEntry);
             continue;
         }
+
+        // Most entries in a typical sync run are plain files that didn't
+        // change on either side. Skip building a SyncFileItem for them.
+        if (isUnchangedPlainFile(path, e.localEntry, e.serverEntry, e.dbEntry)) {
+            ++_discoveryData->_statistics.filesUnchanged;
+            continue;
+        }
         processFile(std::move(path), e.localEntry, e.serverEntry, e.dbEntry);
     }
+    _discoveryData->_statistics.entriesReconciled += static_cast<int>(entries.size());
+    _discoveryData->_statistics.reconcileTime += reconcileTimer.duration();
     QTimer::singleShot(0, _discoveryData, &DiscoveryPhase::scheduleMoreJobs);
 }
 
@@ -253,6 +326,48 @@ bool ProcessDirectoryJob::handleExcluded(const QString &path, const QString &loc
     return true;
 }
 
+bool ProcessDirectoryJob::isUnchangedPlainFile(const PathTuple &path,
+    const LocalInfo &localEntry, const RemoteInfo &serverEntry,
+    const SyncJournalFileRecord &dbEntry) const
+{
+    // Only plain files with virtual files disabled: anything else can have
+    // side effects beyond the CSYNC_INSTRUCTION_NONE the item would end
+    // up with (placeholder conversions, dehydration requests, ...).
+    if (_discoveryData->_syncOptions.vfs()->mode() != Vfs::Off)
+        return false;
+    if (!dbEntry.isValid() || dbEntry._type != ItemTypeFile)
+        return false;
+    if (!localEntry.isValid() || localEntry.isDirectory || localEntry.isVirtualFile
+        || localEntry.type != ItemTypeFile)
+        return false;
+    if (localEntry.modtime != dbEntry._modtime || localEntry.size != dbEntry._fileSize
+        || localEntry.inode != dbEntry._inode)
+        return false;
+
+    // The server side must match the journal as well. Without a server
+    // entry that's only known when the parent directory's etag was
+    // unchanged; incomplete PROPFIND data must go through the regular
+    // error handling.
+    if (serverEntry.isValid()) {
+        if (serverEntry.isDirectory || serverEntry.size == -1
+            || serverEntry.etag.isEmpty() || serverEntry.etag.toUtf8() != dbEntry._etag
+            || serverEntry.remotePerm.isNull() || serverEntry.remotePerm != dbEntry._remotePerm
+            || serverEntry.fileId.isEmpty() || serverEntry.fileId != dbEntry._fileId)
+            return false;
+    } else if (_queryServer != ParentNotChanged) {
+        return false;
+    }
+
+    // Inside a renamed directory even NONE items are turned into RENAME by
+    // processFileFinalize(); and the engine tracks conflict markers on
+    // otherwise clean items.
+    if (path._original != path._target || _discoveryData->isRenamed(path._original))
+        return false;
+    if (Utility::isConflictFile(path._original))
+        return false;
+    return true;
+}
+
 void ProcessDirectoryJob::processFile(const PathTuple &path,
     const LocalInfo &localEntry, const RemoteInfo &serverEntry,
     const SyncJournalFileRecord &dbEntry)
@@ -381,6 +496,10 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(
         }
     }
 
+    // Converted once: compared against db etags in several branches below,
+    // including once per rename candidate.
+    const QByteArray serverEtag = serverEntry.etag.toUtf8();
+
     // The file is known in the db already
     if (dbEntry.isValid()) {
         if (serverEntry.isDirectory != dbEntry.isDirectory()) {
@@ -404,7 +523,7 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(
             item->setInstruction(CSYNC_INSTRUCTION_SYNC);
             item->_type = ItemTypeVirtualFileDownload;
             item->_size = serverEntry.size;
-        } else if (dbEntry._etag != serverEntry.etag.toUtf8()) {
+        } else if (dbEntry._etag != serverEtag) {
             item->_direction = SyncFileItem::Down;
             item->_modtime = serverEntry.modtime;
             item->_size = serverEntry.size;
@@ -489,7 +608,7 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(
             done = true;
             return;
         }
-        if (!serverEntry.isDirectory && base._etag != serverEntry.etag.toUtf8()) {
+        if (!serverEntry.isDirectory && base._etag != serverEtag) {
             /* File with different etag, don't do a rename, but download the file again */
             qCInfo(lcDisco, "file etag different, not a rename");
             done = true;
@@ -557,35 +676,34 @@ void ProcessDirectoryJob::processFileAnalyzeRemoteInfo(
                 return;
             }
             _pendingAsyncJobs++;
-            auto job = new RequestEtagJob(_discoveryData->_account, _discoveryData->_baseUrl, _discoveryData->_remoteFolder + originalPath, this);
-            connect(job, &RequestEtagJob::finishedSignal, this, [=]() mutable {
-                _pendingAsyncJobs--;
-                QTimer::singleShot(0, _discoveryData, &DiscoveryPhase::scheduleMoreJobs);
-                if (job->httpStatusCode() == 207 ||
-                    // Somehow another item claimed this original path, consider as if it existed
-                    _discoveryData->isRenamed(originalPath)) {
-                    // If the file exist or if there is another error, consider it is a new file.
-                    postProcessServerNew();
-                    return;
-                } else if (job->httpStatusCode() == 404) {
-                    // The file do not exist, it is a rename
-
-                    // In case the deleted item was discovered in parallel
-                    _discoveryData->findAndCancelDeletedJob(originalPath);
-
-                    postProcessRename(path);
-                    processFileFinalize(
-                        item, path, item->isDirectory(), item->instruction() == CSYNC_INSTRUCTION_RENAME ? NormalQuery : ParentDontExist, _queryServer);
-                    return;
-                }
-                Q_EMIT _discoveryData->fatalError(tr("Error while doing a rename, unhandled status code: %1").arg(job->httpStatusCode()));
-            });
-            job->start();
+            RequestEtagJob::fetch(_discoveryData->_account, _discoveryData->_baseUrl, _discoveryData->_remoteFolder + originalPath, this,
+                [=](int statusCode, const QString &) mutable {
+                    _pendingAsyncJobs--;
+                    QTimer::singleShot(0, _discoveryData, &DiscoveryPhase::scheduleMoreJobs);
+                    if (statusCode == 207 ||
+                        // Somehow another item claimed this original path, consider as if it existed
+                        _discoveryData->isRenamed(originalPath)) {
+                        // If the file exist or if there is another error, consider it is a new file.
+                        postProcessServerNew();
+                        return;
+                    } else if (statusCode == 404) {
+                        // The file do not exist, it is a rename
+
+                        // In case the deleted item was discovered in parallel
+                        _discoveryData->findAndCancelDeletedJob(originalPath);
+
+                        postProcessRename(path);
+                        processFileFinalize(
+                            item, path, item->isDirectory(), item->instruction() == CSYNC_INSTRUCTION_RENAME ? NormalQuery : ParentDontExist, _queryServer);
+                        return;
+                    }
+                    Q_EMIT _discoveryData->fatalError(tr("Error while doing a rename, unhandled status code: %1").arg(statusCode));
+                });
             done = true; // Ideally, if the origin still exist on the server, we should continue searching...  but that'd be difficult
             async = true;
         }
     };
-    if (!_discoveryData->_statedb->getFileRecordsByFileId(serverEntry.fileId, renameCandidateProcessing)) {
+    if (!_discoveryData->getRecordsByFileId(serverEntry.fileId, renameCandidateProcessing)) {
         dbError();
         return;
     }
@@ -728,6 +846,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
             // Not locally, not on the server. The entry is stale!
             qCInfo(lcDisco) << "Stale DB entry";
             _discoveryData->_statedb->deleteFileRecord(path._original, true);
+            _discoveryData->forgetRecordForMoveDetection(path._original.toUtf8());
             return;
         } else if (!serverModified) {
             // Removed locally: also remove on the server.
@@ -848,7 +967,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
 
     // Check if it is a move
     SyncJournalFileRecord base;
-    if (!_discoveryData->_statedb->getFileRecordByInode(localEntry.inode, &base)) {
+    if (!_discoveryData->getRecordByInode(localEntry.inode, &base)) {
         dbError();
         return;
     }
@@ -909,6 +1028,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
             // More complicated. The REMOVE is canceled. Restore will happen next sync.
             qCInfo(lcDisco) << "Undid remove instruction on source" << originalPath;
             _discoveryData->_statedb->deleteFileRecord(originalPath, true);
+            _discoveryData->forgetRecordForMoveDetection(base._path);
             _discoveryData->_statedb->schedulePathForRemoteDiscovery(originalPath);
             _discoveryData->_anotherSyncNeeded = true;
         } else {
@@ -962,10 +1082,10 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
         // We must query the server to know if the etag has not changed
         _pendingAsyncJobs++;
         QString serverOriginalPath = _discoveryData->_remoteFolder + _discoveryData->adjustRenamedPath(originalPath, SyncFileItem::Down);
-        auto job = new RequestEtagJob(_discoveryData->_account.get(), _discoveryData->_baseUrl, serverOriginalPath, this);
-        connect(job, &RequestEtagJob::finishedSignal, this,
-            [job, recurseQueryServer, path = path, postProcessLocalNew, processRename, base, item, originalPath, this] {
-                if (job->httpStatusCode() == 404 || (job->etag().toUtf8() != base._etag && !item->isDirectory()) || _discoveryData->isRenamed(originalPath)) {
+        RequestEtagJob::fetch(_discoveryData->_account.get(), _discoveryData->_baseUrl, serverOriginalPath, this,
+            [recurseQueryServer, path = path, postProcessLocalNew, processRename, base, item, originalPath, this](int statusCode, const QString &etag) {
+                const QByteArray remoteEtag = etag.toUtf8();
+                if (statusCode == 404 || (remoteEtag != base._etag && !item->isDirectory()) || _discoveryData->isRenamed(originalPath)) {
                     qCInfo(lcDisco) << "Can't rename because the etag has changed or the directory is gone" << originalPath;
                     // Can't be a rename, leave it as a new.
                     postProcessLocalNew(path);
@@ -973,12 +1093,11 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
                 } else {
                     // In case the deleted item was discovered in parallel
                     _discoveryData->findAndCancelDeletedJob(originalPath);
-                    processFileFinalize(item, processRename(path), item->isDirectory(), NormalQuery, job->etag().toUtf8() == base._etag ? ParentNotChanged : NormalQuery);
+                    processFileFinalize(item, processRename(path), item->isDirectory(), NormalQuery, remoteEtag == base._etag ? ParentNotChanged : NormalQuery);
                 }
                 _pendingAsyncJobs--;
                 QTimer::singleShot(0, _discoveryData, &DiscoveryPhase::scheduleMoreJobs);
             });
-        job->start();
     }
 }
 
@@ -1323,15 +1442,24 @@ DiscoverySingleDirectoryJob *ProcessDirectoryJob::startAsyncServerQuery()
 
     auto discoveryJob =
         new DiscoverySingleDirectoryJob(_discoveryData->_account.get(), _discoveryData->_baseUrl, _discoveryData->_remoteFolder + _currentFolder._server, this);
-    if (!_dirItem)
+    if (!_dirItem) {
         discoveryJob->setIsRootPath(); // query the fingerprint on the root
+        if (_discoveryData->_useRecursiveDiscovery)
+            discoveryJob->setRecursive();
+    }
     connect(discoveryJob, &DiscoverySingleDirectoryJob::etag, this, &ProcessDirectoryJob::etag);
     _discoveryData->_currentlyActiveJobs++;
     _pendingAsyncJobs++;
-    connect(discoveryJob, &DiscoverySingleDirectoryJob::finished, this, [this, discoveryJob](const auto &results) {
+    connect(discoveryJob, &DiscoverySingleDirectoryJob::finished, this, [this, discoveryJob, timer = Utility::ChronoElapsedTimer()](const auto &results) {
         _discoveryData->_currentlyActiveJobs--;
         _pendingAsyncJobs--;
+        _discoveryData->_statistics.remoteListingTime += timer.duration();
         if (results) {
+            ++_discoveryData->_statistics.remoteDirectoriesListed;
+            if (discoveryJob->isRecursive()) {
+                _discoveryData->_prefetchedListings = discoveryJob->takeSubtreeListings();
+                _discoveryData->_prefetchedListingsValid = true;
+            }
             _serverNormalQueryEntries = *results;
             _serverQueryDone = true;
             if (!discoveryJob->_dataFingerprint.isEmpty() && _discoveryData->_dataFingerprint.isEmpty())
@@ -1340,6 +1468,14 @@ DiscoverySingleDirectoryJob *ProcessDirectoryJob::startAsyncServerQuery()
                 this->process();
         } else {
             auto code = results.error().code;
+            if (discoveryJob->isRecursive() && code >= 400 && code < 500) {
+                // The server (or this folder) rejects Depth: infinity,
+                // fall back to one PROPFIND per directory.
+                qCInfo(lcDisco) << "Recursive PROPFIND failed with" << code << "- falling back to per-directory discovery";
+                _discoveryData->_useRecursiveDiscovery = false;
+                _serverJob = startAsyncServerQuery();
+                return;
+            }
             qCWarning(lcDisco) << "Server error in directory" << _currentFolder._server << code;
             if (discoveryJob->isRootPath()) {
                 if (code == 404 && _discoveryData->isSpace()) {
@@ -1382,6 +1518,9 @@ void ProcessDirectoryJob::startAsyncLocalQuery()
 
     QString localPath = _discoveryData->_localDir + _currentFolder._local;
     auto localJob = new DiscoverySingleLocalDirectoryJob(localPath, _discoveryData->_syncOptions.vfs());
+    if (!_localTargetedNames.isEmpty()) {
+        localJob->setTargetedNames(_localTargetedNames);
+    }
 
     _discoveryData->_currentlyActiveJobs++;
     _pendingAsyncJobs++;
@@ -1415,9 +1554,11 @@ void ProcessDirectoryJob::startAsyncLocalQuery()
         }
     });
 
-    connect(localJob, &DiscoverySingleLocalDirectoryJob::finished, this, [this](const auto &results) {
+    connect(localJob, &DiscoverySingleLocalDirectoryJob::finished, this, [this, timer = Utility::ChronoElapsedTimer()](const auto &results) {
         _discoveryData->_currentlyActiveJobs--;
         _pendingAsyncJobs--;
+        _discoveryData->_statistics.localListingTime += timer.duration();
+        ++_discoveryData->_statistics.localDirectoriesListed;
 
         _localNormalQueryEntries = results;
         _localQueryDone = true;
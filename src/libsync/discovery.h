@@ -15,6 +15,7 @@
 #pragma once
 
 #include "common/syncjournaldb.h"
+#include "common/utility.h"
 #include "discoveryphase.h"
 #include "syncfileitem.h"
 #include <QObject>
@@ -63,9 +64,12 @@ public:
     /** For creating the root job
      *
      * The base pin state is used if the root dir's pin state can't be retrieved.
+     * queryServer can be ParentNotChanged to serve the whole remote tree from
+     * the journal when the engine knows the remote root etag did not change.
      */
-    explicit ProcessDirectoryJob(DiscoveryPhase *data, PinState basePinState, QObject *parent)
+    explicit ProcessDirectoryJob(DiscoveryPhase *data, PinState basePinState, QueryMode queryServer, QObject *parent)
         : QObject(parent)
+        , _queryServer(queryServer)
         , _discoveryData(data)
     {
         computePinState(basePinState);
@@ -114,7 +118,8 @@ private:
         QString _local; // Path locally (before the sync)
         static QString pathAppend(const QString &base, const QString &name)
         {
-            return base.isEmpty() ? name : base + QLatin1Char('/') + name;
+            // An empty base shares name's data, joinPath() allocates once.
+            return base.isEmpty() ? name : Utility::joinPath(base, name);
         }
         PathTuple addName(const QString &name) const
         {
@@ -153,6 +158,15 @@ private:
      */
     void processFile(const PathTuple &, const LocalInfo &, const RemoteInfo &, const SyncJournalFileRecord &);
 
+    /** Fast path for plain files that are unchanged on all sides.
+     *
+     * Returns true when the local metadata (inode, mtime, size) and the
+     * remote etag/permissions/id all match the journal, in which case the
+     * caller can skip building a SyncFileItem for the entry: the engine
+     * discards CSYNC_INSTRUCTION_NONE items right away anyway.
+     */
+    bool isUnchangedPlainFile(const PathTuple &, const LocalInfo &, const RemoteInfo &, const SyncJournalFileRecord &) const;
+
     /// processFile helper for when remote information is available, typically flows into AnalyzeLocalInfo when done
     void processFileAnalyzeRemoteInfo(const SyncFileItemPtr &item, PathTuple, const LocalInfo &, const RemoteInfo &, const SyncJournalFileRecord &);
 
@@ -225,6 +239,13 @@ private:
     QVector<RemoteInfo> _serverNormalQueryEntries;
     QVector<LocalInfo> _localNormalQueryEntries;
 
+    /** When non-empty, the local query only stats these names.
+     *
+     * Filled from DiscoveryPhase::_localTouchedChildren. The untouched
+     * entries are mirrored from the journal in process().
+     */
+    QSet<QString> _localTargetedNames;
+
     // Whether the local/remote directory item queries are done. Will be set
     // even for do-nothing (!= NormalQuery) queries.
     bool _serverQueryDone = false;
@@ -17,14 +17,22 @@
 
 #include "common/asserts.h"
 #include "common/checksums.h"
+#include "common/chronoelapsedtimer.h"
+#include "common/utility.h"
 
 #include "vio/csync_vio_local.h"
 
 #include <QDateTime>
 #include <QFile>
 #include <QLoggingCategory>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
 #include <QUrl>
 
+#include <algorithm>
+#include <atomic>
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcDiscovery, "sync.discovery", QtInfoMsg)
@@ -174,12 +182,121 @@ void DiscoveryPhase::setSelectiveSyncWhiteList(const QSet<QString> &list)
 
 void DiscoveryPhase::scheduleMoreJobs()
 {
-    auto limit = qMax(1, _syncOptions._parallelNetworkJobs);
+    // The fan-out defaults to twice the propagation job limit: discovery jobs
+    // are cheap on the server side compared to transfers, but we still want
+    // the back-pressure to scale with what the propagator would run.
+    auto limit = _syncOptions._parallelDiscoveryJobs > 0
+        ? _syncOptions._parallelDiscoveryJobs
+        : 2 * qMax(1, _syncOptions._parallelNetworkJobs);
     if (_currentRootJob && _currentlyActiveJobs < limit) {
         _currentRootJob->processSubJobs(limit - _currentlyActiveJobs);
     }
 }
 
+Optional<QVector<RemoteInfo>> DiscoveryPhase::takePrefetchedListing(const QString &serverPath)
+{
+    if (!_prefetchedListingsValid)
+        return {};
+    auto it = _prefetchedListings.find(serverPath);
+    if (it == _prefetchedListings.end()) {
+        // Not covered by the prefetch, e.g. a directory that appeared on the
+        // server afterwards. The caller falls back to a per-directory PROPFIND.
+        return {};
+    }
+    auto listing = std::move(it.value());
+    _prefetchedListings.erase(it);
+    return listing;
+}
+
+bool DiscoveryPhase::ensureMoveDetectionIndex()
+{
+    if (_moveIndexBuilt)
+        return true;
+    _moveIndexBuilt = true;
+
+    if (!_statedb->getFilesBelowPath(QByteArrayLiteral(""), [this](const SyncJournalFileRecord &rec) {
+            const int idx = static_cast<int>(_moveIndexRecords.size());
+            _moveIndexRecords.push_back(rec);
+            if (rec._inode != 0 && !_moveIndexByInode.contains(rec._inode)) {
+                _moveIndexByInode.insert(rec._inode, idx);
+            }
+            if (!rec._fileId.isEmpty()) {
+                _moveIndexByFileId[rec._fileId].append(idx);
+            }
+        })) {
+        return false;
+    }
+    qCInfo(lcDiscovery) << "Built move-detection index over" << _moveIndexRecords.size() << "journal records";
+    return true;
+}
+
+bool DiscoveryPhase::loadJournalSnapshot()
+{
+    Utility::ChronoElapsedTimer timer;
+    int records = 0;
+    if (!_statedb->getFilesBelowPath(QByteArrayLiteral(""), [this, &records](const SyncJournalFileRecord &rec) {
+            if (rec._path.isEmpty())
+                return;
+            const int lastSlash = rec._path.lastIndexOf('/');
+            _journalSnapshot[lastSlash < 0 ? QByteArray() : rec._path.left(lastSlash)].push_back(rec);
+            ++records;
+        })) {
+        _journalSnapshot.clear();
+        return false;
+    }
+    _journalSnapshotValid = true;
+    qCInfo(lcDiscovery) << "Loaded journal snapshot with" << records << "records in" << _journalSnapshot.size() << "directories in" << timer.duration();
+    return true;
+}
+
+bool DiscoveryPhase::getRecordByInode(quint64 inode, SyncJournalFileRecord *rec)
+{
+    Q_ASSERT(rec);
+    rec->_path.clear();
+    if (inode == 0)
+        return true; // no error, just nothing found
+    if (!ensureMoveDetectionIndex())
+        return false;
+    const auto it = _moveIndexByInode.constFind(inode);
+    if (it != _moveIndexByInode.cend()) {
+        const SyncJournalFileRecord &found = _moveIndexRecords[*it];
+        if (!isForgottenForMoveDetection(found._path)) {
+            *rec = found;
+        }
+    }
+    return true;
+}
+
+bool DiscoveryPhase::isForgottenForMoveDetection(const QByteArray &path) const
+{
+    // Deletions during discovery are rare (stale entries, undone moves), so a
+    // linear scan over the few forgotten prefixes is fine.
+    for (const QByteArray &prefix : _moveIndexDeletedPrefixes) {
+        if (path == prefix || (path.startsWith(prefix) && path.at(prefix.size()) == '/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DiscoveryPhase::getRecordsByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    if (fileId.isEmpty())
+        return true;
+    if (!ensureMoveDetectionIndex())
+        return false;
+    const auto it = _moveIndexByFileId.constFind(fileId);
+    if (it != _moveIndexByFileId.cend()) {
+        for (int idx : *it) {
+            const SyncJournalFileRecord &found = _moveIndexRecords[idx];
+            if (!isForgottenForMoveDetection(found._path)) {
+                rowCallback(found);
+            }
+        }
+    }
+    return true;
+}
+
 bool DiscoveryPhase::isSpace() const
 {
     if (!_account)
@@ -197,11 +314,49 @@ DiscoverySingleLocalDirectoryJob::DiscoverySingleLocalDirectoryJob(const QString
 }
 
 // Use as QRunnable
+static LocalInfo localInfoFromFileStat(const csync_file_stat_t &stat)
+{
+    LocalInfo i;
+    i.name = stat.path;
+    i.modtime = stat.modtime;
+    i.size = stat.size;
+    i.inode = stat.inode;
+    i.isDirectory = stat.type == ItemTypeDirectory;
+    i.isHidden = stat.is_hidden;
+    i.isSymLink = stat.type == ItemTypeSoftLink;
+    i.isVirtualFile = stat.type == ItemTypeVirtualFile || stat.type == ItemTypeVirtualFileDownload;
+    i.type = stat.type;
+    return i;
+}
+
 void DiscoverySingleLocalDirectoryJob::run() {
     QString localPath = _localPath;
     if (localPath.endsWith(QLatin1Char('/'))) // Happens if _currentFolder._local.isEmpty()
         localPath.chop(1);
 
+    if (!_targetedNames.isEmpty()) {
+        // Only individual entries in this directory were touched: stat
+        // exactly those instead of reading the whole directory. Entries that
+        // are gone simply produce no result, which discovery treats as a
+        // local removal.
+        QVector<LocalInfo> results;
+        QString statPath; // reused across the loop, see joinPathInto()
+        for (const QString &name : _targetedNames) {
+            csync_file_stat_t stat;
+            stat.path = name;
+            if (csync_vio_local_stat(Utility::joinPathInto(statPath, localPath, name), &stat) < 0)
+                continue;
+            if (_vfs) {
+                _vfs->statTypeVirtualFile(&stat, nullptr);
+            }
+            if (stat.type == ItemTypeSkip)
+                continue;
+            results.push_back(localInfoFromFileStat(stat));
+        }
+        Q_EMIT finished(results);
+        return;
+    }
+
     auto dh = csync_vio_local_opendir(localPath);
     if (!dh) {
         qCCritical(lcDiscovery) << "Error while opening directory" << (localPath) << errno;
@@ -229,17 +384,7 @@ void DiscoverySingleLocalDirectoryJob::run() {
             break;
         if (dirent->type == ItemTypeSkip)
             continue;
-        LocalInfo i;
-        i.name = dirent->path;
-        i.modtime = dirent->modtime;
-        i.size = dirent->size;
-        i.inode = dirent->inode;
-        i.isDirectory = dirent->type == ItemTypeDirectory;
-        i.isHidden = dirent->is_hidden;
-        i.isSymLink = dirent->type == ItemTypeSoftLink;
-        i.isVirtualFile = dirent->type == ItemTypeVirtualFile || dirent->type == ItemTypeVirtualFileDownload;
-        i.type = dirent->type;
-        results.push_back(i);
+        results.push_back(localInfoFromFileStat(*dirent));
     }
     if (errno != 0) {
         csync_vio_local_closedir(dh);
@@ -259,6 +404,99 @@ void DiscoverySingleLocalDirectoryJob::run() {
     Q_EMIT finished(results);
 }
 
+struct DiscoveryLocalTreeWalker::State
+{
+    QString rootPath; // ends with '/'
+    Vfs *vfs = nullptr;
+    QMutex mutex;
+    // Keyed by the folder-relative directory path, the root under "".
+    QHash<QString, QVector<LocalInfo>> listings;
+    std::atomic<bool> aborted { false };
+};
+
+DiscoveryLocalTreeWalker::DiscoveryLocalTreeWalker(const QString &rootPath, OCC::Vfs *vfs, QObject *parent)
+    : QObject(parent)
+    , _state(std::make_shared<State>())
+{
+    _state->rootPath = rootPath;
+    if (!_state->rootPath.endsWith(QLatin1Char('/')))
+        _state->rootPath += QLatin1Char('/');
+    _state->vfs = vfs;
+}
+
+DiscoveryLocalTreeWalker::~DiscoveryLocalTreeWalker()
+{
+    // Outstanding pool tasks only hold the shared state; they notice the
+    // abort and wind down on their own.
+    _state->aborted = true;
+}
+
+void DiscoveryLocalTreeWalker::start()
+{
+    auto state = _state;
+    QThreadPool::globalInstance()->start([state] { walkDirectory(state, QString()); });
+}
+
+Optional<QVector<LocalInfo>> DiscoveryLocalTreeWalker::takeListing(const QString &path)
+{
+    QMutexLocker lock(&_state->mutex);
+    auto it = _state->listings.find(path);
+    if (it == _state->listings.end())
+        return {};
+    auto listing = std::move(it.value());
+    _state->listings.erase(it);
+    return listing;
+}
+
+void DiscoveryLocalTreeWalker::walkDirectory(const std::shared_ptr<State> &state, const QString &path)
+{
+    if (state->aborted)
+        return;
+
+    QString localPath = state->rootPath + path;
+    if (localPath.endsWith(QLatin1Char('/'))) // the root
+        localPath.chop(1);
+
+    auto dh = csync_vio_local_opendir(localPath);
+    if (!dh) {
+        // Store no listing: the directory job falls back to
+        // DiscoverySingleLocalDirectoryJob which reports the error properly.
+        return;
+    }
+
+    QVector<LocalInfo> results;
+    QStringList subDirectories;
+    while (true) {
+        errno = 0;
+        auto dirent = csync_vio_local_readdir(dh, state->vfs);
+        if (!dirent)
+            break;
+        if (dirent->type == ItemTypeSkip)
+            continue;
+        if (dirent->type == ItemTypeDirectory)
+            subDirectories.append(dirent->path);
+        results.push_back(localInfoFromFileStat(*dirent));
+    }
+    const bool readdirFailed = errno != 0;
+    csync_vio_local_closedir(dh);
+    if (readdirFailed) {
+        // Fall back, see above.
+        return;
+    }
+
+    {
+        QMutexLocker lock(&state->mutex);
+        state->listings.insert(path, std::move(results));
+    }
+
+    for (const QString &name : std::as_const(subDirectories)) {
+        if (state->aborted)
+            return;
+        const QString childPath = path.isEmpty() ? name : Utility::joinPath(path, name);
+        QThreadPool::globalInstance()->start([state, childPath] { walkDirectory(state, childPath); });
+    }
+}
+
 DiscoverySingleDirectoryJob::DiscoverySingleDirectoryJob(Account *account, const QUrl &baseUrl, const QString &path, QObject *parent)
     : QObject(parent)
     , _subPath(path)
@@ -279,7 +517,7 @@ void DiscoverySingleDirectoryJob::start()
     }
 
     // Start the actual HTTP job
-    _proFindJob = new PropfindJob(_account, _baseUrl, _subPath, PropfindJob::Depth::One, this);
+    _proFindJob = new PropfindJob(_account, _baseUrl, _subPath, _recursive ? PropfindJob::Depth::Infinity : PropfindJob::Depth::One, this);
 
     QList<QByteArray> props {
         "resourcetype",
@@ -373,6 +611,7 @@ void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(const QString &fi
     if (!_ignoredFirst) {
         // The first entry is for the folder itself, we should process it differently.
         _ignoredFirst = true;
+        _hrefPrefix = file + QLatin1Char('/');
         if (auto it = Utility::optionalFind(map, QStringLiteral("permissions"))) {
             auto perm = RemotePermissions::fromServerString(it->value());
             Q_EMIT firstDirectoryPermissions(perm);
@@ -395,6 +634,19 @@ void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(const QString &fi
         if (result.isDirectory)
             result.size = 0;
 
+        if (_recursive && !file.startsWith(_hrefPrefix)) {
+            qCWarning(lcDiscovery) << "Ignoring unexpected href in recursive listing" << file << "expected starting with" << _hrefPrefix;
+            return;
+        }
+        const QString relativePath = _recursive ? file.mid(_hrefPrefix.size()) : QString();
+        if (int parentSlash = relativePath.lastIndexOf(QLatin1Char('/')); parentSlash >= 0) {
+            // An entry below a subdirectory, bucket it by its parent. The
+            // external storage normalization for these deeper levels happens
+            // in normalizeExternalStorageInSubtree() once all entries are in.
+            _subtreeListings[relativePath.left(parentSlash)].push_back(std::move(result));
+            return;
+        }
+
         if (_isExternalStorage && result.remotePerm.hasPermission(RemotePermissions::IsMounted)) {
             /* All the entries in a external storage have 'M' in their permission. However, for all
                purposes in the desktop client, we only need to know about the mount points.
@@ -413,6 +665,50 @@ void DiscoverySingleDirectoryJob::directoryListingIteratedSlot(const QString &fi
     }
 }
 
+void DiscoverySingleDirectoryJob::normalizeExternalStorageInSubtree()
+{
+    // The 'M' -> 'm' rewrite in directoryListingIteratedSlot only covers the
+    // direct children of the requested directory. In recursive mode the deeper
+    // levels arrive in the same response, so walk the tree top-down and apply
+    // the same rewrite below every mount point.
+    QSet<QString> externalDirs;
+    QStringList newEmptyBuckets;
+    for (const auto &info : std::as_const(_results)) {
+        if (!info.isDirectory)
+            continue;
+        if (info.remotePerm.hasPermission(RemotePermissions::IsMounted) || info.remotePerm.hasPermission(RemotePermissions::IsMountedSub))
+            externalDirs.insert(info.name);
+        if (!_subtreeListings.contains(info.name))
+            newEmptyBuckets.append(info.name);
+    }
+
+    // Lexicographic order visits parents before their children, as the parent
+    // path is a strict prefix.
+    auto paths = _subtreeListings.keys();
+    std::sort(paths.begin(), paths.end());
+    for (const auto &path : std::as_const(paths)) {
+        const bool isExternal = externalDirs.contains(path);
+        for (auto &info : _subtreeListings[path]) {
+            if (isExternal && info.remotePerm.hasPermission(RemotePermissions::IsMounted)) {
+                info.remotePerm.unsetPermission(RemotePermissions::IsMounted);
+                info.remotePerm.setPermission(RemotePermissions::IsMountedSub);
+            }
+            if (!info.isDirectory)
+                continue;
+            const QString childPath = Utility::joinPath(path, info.name);
+            if (info.remotePerm.hasPermission(RemotePermissions::IsMounted) || info.remotePerm.hasPermission(RemotePermissions::IsMountedSub))
+                externalDirs.insert(childPath);
+            if (!_subtreeListings.contains(childPath))
+                newEmptyBuckets.append(childPath);
+        }
+    }
+
+    // Make sure empty directories are served from the prefetch too, instead of
+    // falling back to a pointless PROPFIND.
+    for (const auto &path : std::as_const(newEmptyBuckets))
+        _subtreeListings.insert(path, {});
+}
+
 void DiscoverySingleDirectoryJob::lsJobFinishedWithoutErrorSlot()
 {
     if (!_ignoredFirst) {
@@ -433,6 +729,10 @@ void DiscoverySingleDirectoryJob::lsJobFinishedWithoutErrorSlot()
         lastResponse = QDateTime::currentDateTimeUtc();
     }
 
+    if (_recursive) {
+        normalizeExternalStorageInSubtree();
+    }
+
     Q_EMIT etag(_firstEtag, lastResponse);
     Q_EMIT finished(_results);
     deleteLater();
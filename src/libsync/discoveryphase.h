@@ -17,12 +17,16 @@
 #include <QObject>
 
 #include "account.h"
+#include "common/pathinterner.h"
 #include "networkjobs.h"
+#include "progressdispatcher.h"
 #include "syncfileitem.h"
 #include "syncoptions.h"
 
 #include <QHash>
+#include <memory>
 #include <set>
+#include <vector>
 
 class ExcludedFiles;
 
@@ -83,6 +87,15 @@ class DiscoverySingleLocalDirectoryJob : public QObject, public QRunnable
 public:
     explicit DiscoverySingleLocalDirectoryJob(const QString &localPath, OCC::Vfs *vfs, QObject *parent = nullptr);
 
+    /** Restrict the query to individual directory entries.
+     *
+     * Instead of listing the whole directory, only the given names are
+     * stat'ed. Used when the local discovery options know that nothing else
+     * in this directory changed; the caller mirrors the remaining entries
+     * from the journal.
+     */
+    void setTargetedNames(const QSet<QString> &names) { _targetedNames = names; }
+
     void run() override;
 Q_SIGNALS:
     void finished(QVector<LocalInfo> result);
@@ -95,7 +108,43 @@ Q_SIGNALS:
 private:
     QString _localPath;
     OCC::Vfs* _vfs;
+    QSet<QString> _targetedNames;
+public:
+};
+
+
+/**
+ * @brief Walks the whole local tree in parallel on the global thread pool
+ *
+ * A cold full local discovery lists one directory at a time through
+ * DiscoverySingleLocalDirectoryJob and is bound to a single core. The walker
+ * starts at the sync folder root and fans every subdirectory out as its own
+ * thread pool task, collecting the per-directory listings. Directory jobs
+ * consume them through takeListing() and fall back to the usual per-directory
+ * job for anything the walker has not reached (or failed to read), so result
+ * ordering and error handling are unchanged. The walker may descend into
+ * directories discovery later excludes; that only costs wasted listing work.
+ *
+ * @ingroup libsync
+ */
+class DiscoveryLocalTreeWalker : public QObject
+{
+    Q_OBJECT
 public:
+    explicit DiscoveryLocalTreeWalker(const QString &rootPath, OCC::Vfs *vfs, QObject *parent = nullptr);
+    ~DiscoveryLocalTreeWalker() override;
+
+    void start();
+
+    /** Take the finished listing for the given folder-relative path, if the walker got to it already. */
+    Optional<QVector<LocalInfo>> takeListing(const QString &path);
+
+private:
+    // Shared with the pool tasks so they stay safe if the walker is deleted mid-walk.
+    struct State;
+    static void walkDirectory(const std::shared_ptr<State> &state, const QString &path);
+
+    std::shared_ptr<State> _state;
 };
 
 
@@ -112,6 +161,23 @@ public:
     // Specify that this is the root and we need to check the data-fingerprint
     void setIsRootPath() { _isRootPath = true; }
     bool isRootPath() const { return _isRootPath; }
+
+    /** Fetch the entire subtree with a single Depth: infinity PROPFIND.
+     *
+     * The listings of the subdirectories are collected per directory and can
+     * be retrieved with takeSubtreeListings(), the listing of the requested
+     * directory itself is delivered through finished() as usual.
+     */
+    void setRecursive() { _recursive = true; }
+    bool isRecursive() const { return _recursive; }
+
+    /** The per-directory listings collected in recursive mode.
+     *
+     * Keyed by the directory path relative to the requested directory.
+     * Empty directories are present with an empty listing.
+     */
+    QHash<QString, QVector<RemoteInfo>> takeSubtreeListings() { return std::move(_subtreeListings); }
+
     void start();
     void abort();
 
@@ -126,9 +192,14 @@ private Q_SLOTS:
     void lsJobFinishedWithoutErrorSlot();
 
 private:
+    void normalizeExternalStorageInSubtree();
+
     QVector<RemoteInfo> _results;
+    QHash<QString, QVector<RemoteInfo>> _subtreeListings;
     QString _subPath;
     QString _firstEtag;
+    // href of the requested directory, used to relativize paths in recursive mode
+    QString _hrefPrefix;
     QPointer<Account> _account;
     const QUrl _baseUrl;
     // The first result is for the directory itself and need to be ignored.
@@ -138,6 +209,8 @@ private:
     bool _isRootPath;
     // If this directory is an external storage (The first item has 'M' in its permission)
     bool _isExternalStorage;
+    // If set, fetch the whole subtree with Depth: infinity instead of Depth: 1
+    bool _recursive = false;
     // If set, the discovery will finish with an error
     QString _error;
     QPointer<PropfindJob> _proFindJob;
@@ -198,6 +271,80 @@ class DiscoveryPhase : public QObject
 
     int _currentlyActiveJobs = 0;
 
+    /** Per-phase counters and timings, see ProgressInfo::DiscoveryStatistics.
+     *
+     * Updated by the directory jobs as they run; the engine copies it into
+     * the ProgressInfo it reports.
+     */
+    ProgressInfo::DiscoveryStatistics _statistics;
+
+    /** Pool deduplicating the entry names of this discovery run.
+     *
+     * Every file name arrives up to three times (server listing, local
+     * listing, journal) as separate allocations; common names repeat across
+     * directories on top. Only used from the reconcile step, which runs on
+     * the discovery thread.
+     */
+    PathInterner _nameInterner;
+
+    /** Subtree listings prefetched by a recursive PROPFIND on the root.
+     *
+     * Keyed by the server path relative to _remoteFolder. Only meaningful
+     * while _prefetchedListingsValid is set; the entries are consumed by
+     * takePrefetchedListing() as the directory jobs get to them.
+     */
+    QHash<QString, QVector<RemoteInfo>> _prefetchedListings;
+    bool _prefetchedListingsValid = false;
+
+    /** Take the prefetched listing for the given server path, if there is one.
+     *
+     * Returns nothing if the recursive discovery is disabled or didn't cover
+     * the path (e.g. a directory that appeared after the prefetch); the caller
+     * then falls back to a per-directory PROPFIND.
+     */
+    Optional<QVector<RemoteInfo>> takePrefetchedListing(const QString &serverPath);
+
+    /** In-memory move-detection index over the journal.
+     *
+     * Rename matching probes the journal by fileId (remote moves) and by
+     * inode (local moves) once per candidate; with large refactors that
+     * means one SQLite query per renamed file. The index loads the metadata
+     * table once on first use and answers all further probes from memory.
+     *
+     * Records deleted from the journal while discovery runs must be hidden
+     * from the index via forgetRecordForMoveDetection(), mirroring what the
+     * equivalent SQL probe would no longer find.
+     */
+    bool getRecordByInode(quint64 inode, SyncJournalFileRecord *rec);
+    bool getRecordsByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+    void forgetRecordForMoveDetection(const QByteArray &path) { _moveIndexDeletedPrefixes.append(path); }
+
+    bool ensureMoveDetectionIndex();
+    bool isForgottenForMoveDetection(const QByteArray &path) const;
+
+    // Records are stored once; the hashes map to indices into the vector.
+    std::vector<SyncJournalFileRecord> _moveIndexRecords;
+    QHash<quint64, int> _moveIndexByInode;
+    QHash<QByteArray, QVector<int>> _moveIndexByFileId;
+    // Paths deleted (recursively) from the journal during this discovery.
+    QVector<QByteArray> _moveIndexDeletedPrefixes;
+    bool _moveIndexBuilt = false;
+
+    /** Per-directory journal listings loaded with a single sequential scan.
+     *
+     * The journal part of every directory reconcile otherwise costs one
+     * indexed SQLite query per directory. When the snapshot is loaded (see
+     * loadJournalSnapshot()) the directory jobs read their listings from
+     * this map instead; directories without journal entries are simply
+     * absent, which process() treats the same as an empty listing.
+     *
+     * Like the move-detection index this is a start-of-discovery view of
+     * the journal. Records the discovery deletes afterwards belong to
+     * paths it does not descend into again, so the staleness is harmless.
+     */
+    QHash<QByteArray, std::vector<SyncJournalFileRecord>> _journalSnapshot;
+    bool _journalSnapshotValid = false;
+
     // both must contain a sorted list
     std::set<QString> _selectiveSyncBlackList;
     std::set<QString> _selectiveSyncWhiteList;
@@ -245,10 +392,31 @@ public:
     QRegularExpression _invalidFilenameRx; // FIXME: maybe move in ExcludedFiles
     QStringList _serverBlacklistedFiles; // The blacklist from the capabilities
     bool _ignoreHiddenFiles = false;
+    // Fetch the whole remote tree with one Depth: infinity PROPFIND instead of
+    // one request per directory. Falls back automatically if the server
+    // rejects the recursive listing with a 4xx error.
+    bool _useRecursiveDiscovery = false;
+    // Parallel local tree walker, see DiscoveryLocalTreeWalker. Owned by this
+    // phase when set; directory jobs consume its listings opportunistically.
+    DiscoveryLocalTreeWalker *_localTreeWalker = nullptr;
     std::function<bool(const QString &)> _shouldDiscoverLocaly;
+    /** Returns the touched entry names below a directory that needs local discovery.
+     *
+     * A non-empty result means only those entries changed: the directory is
+     * not re-listed, the named entries are stat'ed individually and the rest
+     * is mirrored from the journal. An empty result requests a full listing.
+     */
+    std::function<QSet<QString>(const QString &)> _localTouchedChildren;
 
     void startJob(ProcessDirectoryJob *);
 
+    /** Load _journalSnapshot with one scan of the journal's file table.
+     *
+     * Returns false on database errors; discovery then falls back to the
+     * per-directory queries.
+     */
+    bool loadJournalSnapshot();
+
     void setSelectiveSyncBlackList(const QSet<QString> &list);
     void setSelectiveSyncWhiteList(const QSet<QString> &list);
 
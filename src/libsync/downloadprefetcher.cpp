@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "downloadprefetcher.h"
+
+#include "filesystem.h"
+#include "propagatedownload.h"
+
+#include "common/syncjournaldb.h"
+
+#include <QFile>
+#include <QLoggingCategory>
+
+#include <utility>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcDownloadPrefetcher, "sync.downloadprefetcher", QtInfoMsg)
+
+namespace {
+    // Keep the fan-out below the propagator's transfer limit so a later
+    // abort-and-handoff doesn't stampede the server.
+    constexpr int maxParallelPrefetchJobsC = 3;
+    // Small files are dominated by the per-request round trip; prefetching
+    // them buys little and doubles the journal traffic.
+    constexpr qint64 minPrefetchFileSizeC = 1024 * 1024;
+}
+
+DownloadPrefetcher::DownloadPrefetcher(
+    Account *account, const QUrl &webDavUrl, const QString &localPath, const QString &remotePath, SyncJournalDb *journal, QObject *parent)
+    : QObject(parent)
+    , _account(account)
+    , _webDavUrl(webDavUrl)
+    , _localPath(localPath)
+    , _remotePath(remotePath)
+    , _journal(journal)
+{
+    if (!_localPath.endsWith(QLatin1Char('/')))
+        _localPath += QLatin1Char('/');
+    if (!_remotePath.endsWith(QLatin1Char('/')))
+        _remotePath += QLatin1Char('/');
+}
+
+void DownloadPrefetcher::enqueue(const SyncFileItemPtr &item)
+{
+    if (_aborted)
+        return;
+    // Only plain downloads whose instruction can't be rewritten by the
+    // rename/delete resolution that runs while discovery continues.
+    if (item->_direction != SyncFileItem::Down || item->_type != ItemTypeFile)
+        return;
+    if (item->instruction() != CSYNC_INSTRUCTION_SYNC && item->instruction() != CSYNC_INSTRUCTION_NEW)
+        return;
+    if (item->_etag.isEmpty() || !item->_directDownloadUrl.isEmpty())
+        return;
+    if (item->_size < minPrefetchFileSizeC)
+        return;
+
+    _queue.enqueue(item);
+    scheduleMoreJobs();
+}
+
+void DownloadPrefetcher::abort()
+{
+    _aborted = true;
+    _queue.clear();
+    for (auto *job : std::exchange(_runningJobs, {})) {
+        job->disconnect(this);
+        job->abort();
+        job->deleteLater();
+    }
+}
+
+void DownloadPrefetcher::scheduleMoreJobs()
+{
+    while (!_aborted && _runningJobs.size() < maxParallelPrefetchJobsC && !_queue.isEmpty()) {
+        startJob(_queue.dequeue());
+    }
+}
+
+void DownloadPrefetcher::startJob(const SyncFileItemPtr &item)
+{
+    QString tmpFileName;
+    const SyncJournalDb::DownloadInfo progressInfo = _journal->getDownloadInfo(item->_file);
+    if (progressInfo._valid) {
+        if (progressInfo._etag != item->_etag.toUtf8()) {
+            // Leave outdated temporaries to PropagateDownloadFile, it knows
+            // how to discard them.
+            return;
+        }
+        tmpFileName = progressInfo._tmpfile;
+    }
+    if (tmpFileName.isEmpty()) {
+        tmpFileName = createDownloadTmpFileName(item->_file);
+    }
+
+    auto *tmpFile = new QFile(_localPath + tmpFileName, this);
+    const qint64 resumeStart = tmpFile->size();
+    if (resumeStart > 0 && resumeStart == item->_size) {
+        qCDebug(lcDownloadPrefetcher) << "Temporary for" << item->_file << "is already complete";
+        delete tmpFile;
+        return;
+    }
+    if (tmpFile->exists())
+        FileSystem::setFileReadOnly(tmpFile->fileName(), false);
+    if (!tmpFile->open(QIODevice::Append | QIODevice::Unbuffered)) {
+        // E.g. the parent directory does not exist locally yet; propagation
+        // will download the file the normal way.
+        delete tmpFile;
+        return;
+    }
+    FileSystem::setFileHidden(tmpFile->fileName(), true);
+
+    // Record the download before starting it, exactly like
+    // PropagateDownloadFile does, so the temporary is resumable and
+    // deleteStaleDownloadInfos() can find it.
+    SyncJournalDb::DownloadInfo pi;
+    pi._etag = item->_etag.toUtf8();
+    pi._tmpfile = tmpFileName;
+    pi._valid = true;
+    _journal->setDownloadInfo(item->_file, pi);
+    _journal->commitAsync(QStringLiteral("download prefetch start"));
+
+    auto *job = new GETFileJob(_account.data(), _webDavUrl, _remotePath + item->_file, tmpFile, {}, item->_etag, resumeStart, this);
+    tmpFile->setParent(job);
+    job->setExpectedContentLength(item->_size - resumeStart);
+    connect(job, &GETFileJob::finishedSignal, this, [this, job, tmpFile, file = item->_file] {
+        tmpFile->close();
+        qCDebug(lcDownloadPrefetcher) << "Prefetch of" << file << "finished:" << job->errorString();
+        _runningJobs.removeOne(job);
+        job->deleteLater();
+        scheduleMoreJobs();
+    });
+    _runningJobs.append(job);
+    qCDebug(lcDownloadPrefetcher) << "Prefetching" << item->_file << "resuming at" << resumeStart;
+    job->start();
+}
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "owncloudlib.h"
+#include "syncfileitem.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QUrl>
+#include <QVector>
+
+namespace OCC {
+
+class Account;
+class GETFileJob;
+class SyncJournalDb;
+
+/**
+ * @brief Starts download transfers for discovered items while discovery is still running
+ * @ingroup libsync
+ *
+ * Reconciliation needs the complete discovery result before propagation can
+ * start, so on large trees the connection sits idle for the whole discovery
+ * phase. This class fills that gap: file downloads whose instruction is
+ * already final when itemDiscovered() fires are fetched into the regular
+ * download temporaries (see createDownloadTmpFileName()), with a matching
+ * downloadinfo journal entry written before the transfer begins.
+ *
+ * When propagation later reaches such an item, PropagateDownloadFile finds
+ * the journal entry and either resumes the temporary or, if it is complete,
+ * skips the GET entirely. All safety comes from the existing resume
+ * machinery: the etag is revalidated on resume, a mismatch discards the
+ * temporary, and deleteStaleDownloadInfos() cleans up prefetches whose item
+ * was reshuffled during reconciliation. The worst case is wasted bandwidth.
+ */
+class OWNCLOUDSYNC_EXPORT DownloadPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    DownloadPrefetcher(Account *account, const QUrl &webDavUrl, const QString &localPath, const QString &remotePath, SyncJournalDb *journal, QObject *parent);
+
+    /** Consider a discovered item for prefetching.
+     *
+     * Only plain file downloads above a minimum size are accepted; anything
+     * that could still change during reconciliation is left alone.
+     */
+    void enqueue(const SyncFileItemPtr &item);
+
+    /** Stop all running transfers and drop the queue.
+     *
+     * Partially downloaded temporaries and their journal entries are kept so
+     * propagation can resume them.
+     */
+    void abort();
+
+private:
+    void scheduleMoreJobs();
+    void startJob(const SyncFileItemPtr &item);
+
+    QPointer<Account> _account;
+    const QUrl _webDavUrl;
+    QString _localPath; // absolute, with trailing slash
+    QString _remotePath; // with trailing slash
+    SyncJournalDb *_journal;
+
+    QQueue<SyncFileItemPtr> _queue;
+    QVector<GETFileJob *> _runningJobs;
+    bool _aborted = false;
+};
+}
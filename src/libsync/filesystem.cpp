@@ -29,8 +29,27 @@
 #include <sys/xattr.h>
 #endif
 
+#if defined(Q_OS_MAC) || defined(Q_OS_LINUX)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_MAC
+#include <sys/clonefile.h>
+#endif
+
 #ifdef Q_OS_WIN32
 #include "common/utility_win.h"
+#include <io.h>
 #include <winsock2.h>
 #endif
 
@@ -100,6 +119,30 @@ bool FileSystem::setModTime(const QString &filename, time_t modTime)
 
 bool FileSystem::fileChanged(const QFileInfo &info, qint64 previousSize, time_t previousMtime, std::optional<quint64> previousInode)
 {
+#ifdef Q_OS_WIN
+    const bool isLnk = isLnkFile(info.fileName());
+#else
+    const bool isLnk = false;
+#endif
+    csync_file_stat_t stat;
+    if (!isLnk && csync_vio_local_stat(info.filePath(), &stat) == 0 && stat.modtime != 0) {
+        // A single stat yields size, mtime and inode in one syscall where
+        // the fallback below looks each of them up separately.
+        if (stat.size != previousSize) {
+            qCDebug(lcFileSystem) << "File" << info.filePath() << "has changed: size: " << previousSize << "<->" << stat.size;
+            return true;
+        }
+        if (stat.modtime != previousMtime) {
+            qCDebug(lcFileSystem) << "File" << info.filePath() << "has changed: mtime: " << previousMtime << "<->" << stat.modtime;
+            return true;
+        }
+        if (previousInode.has_value() && previousInode.value() != stat.inode) {
+            qCDebug(lcFileSystem) << "File" << info.filePath() << "has changed: inode" << previousInode.value() << "<-->" << stat.inode;
+            return true;
+        }
+        return false;
+    }
+
     // previousMtime == -1 indicates the file does not exist
     if (!info.exists() && previousMtime != -1) {
         qCDebug(lcFileSystem) << info.filePath() << "was removed";
@@ -126,6 +169,145 @@ bool FileSystem::fileChanged(const QFileInfo &info, qint64 previousSize, time_t
     return false;
 }
 
+void FileSystem::reserveSpace(QFile *file, qint64 expectedSize)
+{
+    if (expectedSize <= 0 || !file->isOpen()) {
+        return;
+    }
+    // All variants reserve allocation only: the logical size must stay
+    // untouched because the caller may have the file open in Append mode.
+#if defined(Q_OS_WIN)
+    const HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(file->handle()));
+    if (handle != INVALID_HANDLE_VALUE) {
+        FILE_ALLOCATION_INFO info;
+        info.AllocationSize.QuadPart = expectedSize;
+        if (!SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info))) {
+            qCDebug(lcFileSystem) << "Could not preallocate" << file->fileName() << Utility::formatWinError(GetLastError());
+        }
+    }
+#elif defined(Q_OS_MAC)
+    // F_PEOFPOSMODE reserves beyond the current end of file.
+    fstore_t store = {};
+    store.fst_flags = F_ALLOCATEALL;
+    store.fst_posmode = F_PEOFPOSMODE;
+    store.fst_length = expectedSize - file->size();
+    if (store.fst_length > 0 && fcntl(file->handle(), F_PREALLOCATE, &store) == -1) {
+        qCDebug(lcFileSystem) << "Could not preallocate" << file->fileName() << strerror(errno);
+    }
+#elif defined(Q_OS_LINUX)
+    if (fallocate(file->handle(), FALLOC_FL_KEEP_SIZE, 0, expectedSize) == -1) {
+        // Not supported on all filesystems (e.g. some FUSE mounts).
+        qCDebug(lcFileSystem) << "Could not preallocate" << file->fileName() << strerror(errno);
+    }
+#else
+    Q_UNUSED(file);
+#endif
+}
+
+void FileSystem::dropWriteCache(QFile *file, qint64 offset, qint64 length)
+{
+    if (length <= 0 || !file->isOpen()) {
+        return;
+    }
+#if defined(Q_OS_LINUX)
+    // Kick off writeback for the range first: POSIX_FADV_DONTNEED only
+    // drops pages that are clean by the time it runs.
+    sync_file_range(file->handle(), offset, length, SYNC_FILE_RANGE_WRITE);
+    posix_fadvise(file->handle(), offset, length, POSIX_FADV_DONTNEED);
+#elif defined(Q_OS_MAC)
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+    // No per-range control; stop caching this file altogether.
+    fcntl(file->handle(), F_NOCACHE, 1);
+#else
+    // No equivalent without reopening the file (e.g. FILE_FLAG_NO_BUFFERING
+    // on Windows requires aligned I/O throughout).
+    Q_UNUSED(file);
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+#endif
+}
+
+void FileSystem::syncDirectory(const QString &directory)
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_MAC)
+    const int fd = open(QFile::encodeName(directory).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+#ifdef Q_OS_MAC
+    // fsync() on mac does not force the write through the disk cache.
+    fcntl(fd, F_FULLFSYNC);
+#else
+    fsync(fd);
+#endif
+    close(fd);
+#else
+    Q_UNUSED(directory);
+#endif
+}
+
+bool FileSystem::copyFileCloned(const QString &source, const QString &destination, QString *errorString)
+{
+#if defined(Q_OS_LINUX)
+    const int srcFd = open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (srcFd >= 0) {
+        struct stat st = {};
+        if (fstat(srcFd, &st) == 0) {
+            const int destFd = open(QFile::encodeName(destination).constData(),
+                O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777);
+            if (destFd >= 0) {
+                bool ok = false;
+#ifdef FICLONE
+                // Shares the source's extents on btrfs and XFS: no data is read or written.
+                ok = ioctl(destFd, FICLONE, srcFd) == 0;
+#endif
+                if (!ok) {
+                    // No cloning across these filesystems; at least keep the
+                    // copy in the kernel instead of bouncing through buffers.
+                    qint64 remaining = st.st_size;
+                    ok = true;
+                    while (remaining > 0) {
+                        const ssize_t copied = copy_file_range(srcFd, nullptr, destFd, nullptr, remaining, 0);
+                        if (copied <= 0) {
+                            ok = false;
+                            break;
+                        }
+                        remaining -= copied;
+                    }
+                }
+                close(destFd);
+                if (ok) {
+                    close(srcFd);
+                    return true;
+                }
+                unlink(QFile::encodeName(destination).constData());
+            }
+        }
+        close(srcFd);
+    }
+#elif defined(Q_OS_MAC)
+    // Clones on APFS, fails with ENOTSUP elsewhere.
+    if (clonefile(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData(), 0) == 0) {
+        return true;
+    }
+#elif defined(Q_OS_WIN)
+    // CopyFile2 clones blocks on ReFS and copies in the kernel otherwise.
+    if (SUCCEEDED(CopyFile2(reinterpret_cast<const wchar_t *>(source.utf16()),
+            reinterpret_cast<const wchar_t *>(destination.utf16()), nullptr))) {
+        return true;
+    }
+#endif
+    QFile file(source);
+    if (!file.copy(destination)) {
+        if (errorString) {
+            *errorString = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
 #ifdef Q_OS_WIN
 static qint64 getSizeWithCsync(const QString &filename)
 {
@@ -76,6 +76,50 @@ namespace FileSystem {
      */
     bool OWNCLOUDSYNC_EXPORT fileChanged(const QFileInfo &info, qint64 previousSize, time_t previousMtime, std::optional<quint64> previousInode = {});
 
+    /**
+     * @brief Best-effort disk space preallocation for an open file
+     *
+     * Reserves an allocation of @p expectedSize bytes without changing the
+     * logical file size, so a file opened in Append mode keeps writing at
+     * its current end. Spares the incremental allocations (and on network
+     * filesystems their round trips) while a download grows the file.
+     */
+    void OWNCLOUDSYNC_EXPORT reserveSpace(QFile *file, qint64 expectedSize);
+
+    /**
+     * @brief Copy a file, sharing its blocks where the filesystem allows it
+     *
+     * On btrfs, XFS and APFS the copy becomes a reflink: O(metadata) instead
+     * of a read-write pass over the whole content, and no extra space is used
+     * until one of the two files is modified. Where cloning is unavailable
+     * the data is copied inside the kernel if possible, and only as a last
+     * resort streamed through user space like QFile::copy().
+     *
+     * The destination must not exist. Returns false and sets @p errorString
+     * on failure.
+     */
+    bool OWNCLOUDSYNC_EXPORT copyFileCloned(const QString &source, const QString &destination, QString *errorString = nullptr);
+
+    /**
+     * @brief Best-effort eviction of a written byte range from the OS cache
+     *
+     * Starts writeback for the range and tells the kernel its pages will
+     * not be reused, so a bulk transfer does not push the rest of the
+     * machine's working set out of the page cache. Only clean pages are
+     * evicted: callers should advise a window that lags behind the write
+     * position, or call this repeatedly.
+     */
+    void OWNCLOUDSYNC_EXPORT dropWriteCache(QFile *file, qint64 offset, qint64 length);
+
+    /**
+     * Best-effort fsync of a directory.
+     *
+     * Persists recently renamed directory entries, so files a sync run
+     * already recorded as done survive a crash or power loss. No-op on
+     * Windows.
+     */
+    void OWNCLOUDSYNC_EXPORT syncDirectory(const QString &directory);
+
 
     struct RemoveEntry
     {
@@ -26,24 +26,43 @@ using namespace GraphApi;
 namespace {
 
 const auto mountpointC = QLatin1String("mountpoint");
+
+QNetworkRequest conditionalRequest(const QByteArray &ifNoneMatch)
+{
+    QNetworkRequest req;
+    if (!ifNoneMatch.isEmpty()) {
+        req.setRawHeader(QByteArrayLiteral("If-None-Match"), ifNoneMatch);
+    }
+    return req;
+}
 }
 
-Drives::Drives(Account *account, QObject *parent)
-    : JsonJob(account, account->url(), QStringLiteral("/graph/v1.0/me/drives"), "GET", {}, {}, parent)
+Drives::Drives(Account *account, const QByteArray &ifNoneMatch, QObject *parent)
+    : JsonJob(account, account->url(), QStringLiteral("/graph/v1.0/me/drives"), "GET", {}, conditionalRequest(ifNoneMatch), parent)
 {
 }
 
 Drives::~Drives() { }
 
+QList<OpenAPI::OAIDrive> Drives::parseDrives(const QJsonObject &data)
+{
+    OpenAPI::OAICollection_of_drives drives;
+    drives.fromJsonObject(data);
+    auto list = drives.getValue();
+    // At the moment we don't support mountpoints but use the Share Jail
+    list.erase(std::remove_if(list.begin(), list.end(), [](const OpenAPI::OAIDrive &it) { return it.getDriveType() == mountpointC; }), list.end());
+    return list;
+}
+
 const QList<OpenAPI::OAIDrive> &Drives::drives() const
 {
     if (_drives.isEmpty() && parseError().error == QJsonParseError::NoError) {
-        OpenAPI::OAICollection_of_drives drives;
-        drives.fromJsonObject(data());
-        _drives = drives.getValue();
-        // At the moment we don't support mountpoints but use the Share Jail
-        _drives.erase(
-            std::remove_if(_drives.begin(), _drives.end(), [](const OpenAPI::OAIDrive &it) { return it.getDriveType() == mountpointC; }), _drives.end());
+        _drives = parseDrives(data());
     }
     return _drives;
 }
+
+QByteArray Drives::responseEtag() const
+{
+    return reply()->rawHeader(QByteArrayLiteral("ETag"));
+}
@@ -26,10 +26,18 @@ namespace GraphApi {
     {
         Q_OBJECT
     public:
-        Drives(Account *account, QObject *parent = nullptr);
+        /** A non-empty ifNoneMatch etag is sent as If-None-Match, so a server
+         * with an unchanged drives list answers 304 with an empty body. */
+        Drives(Account *account, const QByteArray &ifNoneMatch = {}, QObject *parent = nullptr);
         ~Drives();
         const QList<OpenAPI::OAIDrive> &drives() const;
 
+        /// Etag of the returned drives list, empty if the server did not provide one
+        QByteArray responseEtag() const;
+
+        /// Parses a raw drives response, applying the same filtering as drives()
+        static QList<OpenAPI::OAIDrive> parseDrives(const QJsonObject &data);
+
     private:
         mutable QList<OpenAPI::OAIDrive> _drives;
     };
@@ -19,6 +19,11 @@
 #include "libsync/graphapi/jobs/drives.h"
 
 
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QStandardPaths>
 #include <QTimer>
 
 #include <chrono>
@@ -43,6 +48,8 @@ SpacesManager::SpacesManager(Account *parent)
     // the timer will be restarted once we received drives data
     _refreshTimer->setSingleShot(true);
     connect(_refreshTimer, &QTimer::timeout, this, &SpacesManager::refresh);
+
+    loadDrivesCache();
 }
 
 void SpacesManager::refresh()
@@ -56,55 +63,24 @@ void SpacesManager::refresh()
 
     // TODO: leak the job until we fixed the ownership https://github.com/owncloud/client/issues/11203
     // todo todo: I can't identify a leak here but who knows what lurks in the job handling...validate it's ok, as it seems to be
-    auto drivesJob = new Drives(_account, nullptr);
+    auto drivesJob = new Drives(_account, _drivesEtag, nullptr);
     drivesJob->setTimeout(refreshTimeoutC);
     connect(drivesJob, &Drives::finishedSignal, this, [drivesJob, this] {
         drivesJob->deleteLater();
 
-        // a system which provides multiple personal spaces the name of the drive is always used as display name
-        auto hasManyPersonalSpaces = _account->capabilities().spacesSupport().hasMultiplePersonalSpaces;
-        QList<Space *> newSpaces;
-        QList<QString> deletedSpaces;
-
         if (drivesJob->httpStatusCode() == 200) {
-            QList<QString> oldKeys = _spaces.keys();
-            for (const auto &dr : drivesJob->drives()) {
-                bool driveDisabled = dr.getRoot().getDeleted().getState() == QLatin1String("trashed");
-                // we need to treat any newly disabled spaces as if they were deleted so leave it alone.
-                // if an existing space is now disabled it will remain in the old key list for removal, below
-                if (driveDisabled)
-                    continue;
-
-                auto *space = _spaces.value(dr.getId(), nullptr);
-                if (space) {
-                    oldKeys.removeOne(dr.getId());
-                    bool changed = space->setDrive(dr);
-                    if (changed)
-                        emit spaceChanged(space);
-                } else {
-                    space = new Space(this, dr, hasManyPersonalSpaces);
-                    _spaces.insert(dr.getId(), space);
-                    emit spaceAdded(_account->uuid(), space);
-                    newSpaces.append(space);
-                }
-            }
-            for (const QString &id : std::as_const(oldKeys)) {
-                auto *oldSpace = _spaces.take(id);
-                if (oldSpace) {
-                    emit spaceAboutToBeRemoved(_account->uuid(), oldSpace);
-                    deletedSpaces.append(id);
-                    oldSpace->deleteLater();
-                }
-            }
-            if (!_ready) {
-                _ready = true;
-                Q_EMIT ready();
+            _drivesEtag = drivesJob->responseEtag();
+            // servers without etag support on the drives endpoint always answer 200,
+            // comparing the raw payload still lets us skip rebuilding the model
+            if (!_ready || drivesJob->data() != _cachedDrivesData) {
+                _cachedDrivesData = drivesJob->data();
+                storeDrivesCache();
+                applyDrives(drivesJob->drives());
             }
+        } else if (drivesJob->httpStatusCode() == 304 && !_ready) {
+            // unchanged since the persisted cache from the previous run, rebuild the spaces from it
+            applyDrives(Drives::parseDrives(_cachedDrivesData));
         }
-        if (!newSpaces.isEmpty())
-            emit spacesAdded(_account->uuid(), newSpaces, _spaces.count());
-        if (!deletedSpaces.isEmpty())
-            emit spacesRemoved(_account->uuid(), deletedSpaces, _spaces.count());
         // todo: remove this once the old accountSettings are gone
         Q_EMIT updated(_account);
         _refreshTimer->start();
@@ -113,6 +89,84 @@ void SpacesManager::refresh()
     drivesJob->start();
 }
 
+void SpacesManager::applyDrives(const QList<OpenAPI::OAIDrive> &drives)
+{
+    // a system which provides multiple personal spaces the name of the drive is always used as display name
+    auto hasManyPersonalSpaces = _account->capabilities().spacesSupport().hasMultiplePersonalSpaces;
+    QList<Space *> newSpaces;
+    QList<QString> deletedSpaces;
+
+    QList<QString> oldKeys = _spaces.keys();
+    for (const auto &dr : drives) {
+        bool driveDisabled = dr.getRoot().getDeleted().getState() == QLatin1String("trashed");
+        // we need to treat any newly disabled spaces as if they were deleted so leave it alone.
+        // if an existing space is now disabled it will remain in the old key list for removal, below
+        if (driveDisabled)
+            continue;
+
+        auto *space = _spaces.value(dr.getId(), nullptr);
+        if (space) {
+            oldKeys.removeOne(dr.getId());
+            bool changed = space->setDrive(dr);
+            if (changed)
+                emit spaceChanged(space);
+        } else {
+            space = new Space(this, dr, hasManyPersonalSpaces);
+            _spaces.insert(dr.getId(), space);
+            emit spaceAdded(_account->uuid(), space);
+            newSpaces.append(space);
+        }
+    }
+    for (const QString &id : std::as_const(oldKeys)) {
+        auto *oldSpace = _spaces.take(id);
+        if (oldSpace) {
+            emit spaceAboutToBeRemoved(_account->uuid(), oldSpace);
+            deletedSpaces.append(id);
+            oldSpace->deleteLater();
+        }
+    }
+    if (!_ready) {
+        _ready = true;
+        Q_EMIT ready();
+    }
+    if (!newSpaces.isEmpty())
+        emit spacesAdded(_account->uuid(), newSpaces, _spaces.count());
+    if (!deletedSpaces.isEmpty())
+        emit spacesRemoved(_account->uuid(), deletedSpaces, _spaces.count());
+}
+
+QString SpacesManager::drivesCacheFile() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/spaces/")
+        + _account->uuid().toString(QUuid::WithoutBraces) + QStringLiteral(".json");
+}
+
+void SpacesManager::loadDrivesCache()
+{
+    QFile file(drivesCacheFile());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const auto cache = QJsonDocument::fromJson(file.readAll()).object();
+    _cachedDrivesData = cache.value(QStringLiteral("drives")).toObject();
+    if (!_cachedDrivesData.isEmpty()) {
+        _drivesEtag = cache.value(QStringLiteral("etag")).toString().toUtf8();
+    }
+}
+
+void SpacesManager::storeDrivesCache() const
+{
+    const QString fileName = drivesCacheFile();
+    QDir().mkpath(QFileInfo(fileName).path());
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject { { QStringLiteral("etag"), QString::fromUtf8(_drivesEtag) },
+                   { QStringLiteral("drives"), _cachedDrivesData } })
+                   .toJson(QJsonDocument::Compact));
+}
+
 Space *SpacesManager::space(const QString &id) const
 {
     if (id.isEmpty())
@@ -20,6 +20,8 @@
 
 #include <OAIDrive.h>
 
+#include <QJsonObject>
+
 class QTimer;
 
 namespace OCC {
@@ -61,11 +63,19 @@ namespace GraphApi {
 
     private:
         void refresh();
+        void applyDrives(const QList<OpenAPI::OAIDrive> &drives);
+        void loadDrivesCache();
+        void storeDrivesCache() const;
+        QString drivesCacheFile() const;
 
         QPointer<Account> _account;
         QTimer *_refreshTimer;
         QHash<QString, Space *> _spaces;
         bool _ready = false;
+        // the last seen drives payload and its etag, persisted across runs so an
+        // unchanged drives list costs the server a 304 instead of a full body
+        QJsonObject _cachedDrivesData;
+        QByteArray _drivesEtag;
     };
 
 }
@@ -15,6 +15,7 @@
 #include "httplogger.h"
 
 #include "common/chronoelapsedtimer.h"
+#include "configfile.h"
 
 #include <QBuffer>
 #include <QJsonArray>
@@ -24,6 +25,7 @@
 #include <QPointer>
 #include <QRegularExpression>
 
+#include <atomic>
 #include <memory>
 
 using namespace std::chrono;
@@ -39,6 +41,12 @@ bool isTextBody(const QString &s)
     return regexp.match(s).hasMatch();
 }
 
+int bodySampleRate()
+{
+    static const int rate = std::max(1, OCC::ConfigFile().httpLogBodySampleRate());
+    return rate;
+}
+
 struct HttpContext
 {
     HttpContext(const QNetworkRequest &request)
@@ -109,17 +117,30 @@ void logHttp(const QByteArray &verb, HttpContext *ctx, QJsonObject &&header, QIO
             contentType = header.value(QStringLiteral("content-type")).toString();
         }
         if (isTextBody(contentType)) {
-            if (!device->isOpen()) {
-                // should we close it again?
-                device->open(QIODevice::ReadOnly);
-            }
-            Q_ASSERT(device->pos() == 0);
-            QString data = QString::fromUtf8(device->peek(PeekSize));
-            if (PeekSize < contentLength)
-            {
-                data += QStringLiteral("...(%1 bytes elided)").arg(QString::number(contentLength - PeekSize));
+            // Peeking and converting bodies (up to 1 MiB each) is the
+            // expensive part of HTTP logging, so they can be sampled 1-in-N
+            // via httpLogBodySampleRate; error replies always carry their
+            // body. The peek has to happen right here while the device is
+            // still valid, rendering and writing the line happens on the
+            // logger's writer thread.
+            static std::atomic<quint64> textBodyCounter = 0;
+            const bool isError = reply && reply->error() != QNetworkReply::NoError;
+            const bool sampled = textBodyCounter.fetch_add(1, std::memory_order_relaxed) % bodySampleRate() == 0;
+            if (isError || sampled) {
+                if (!device->isOpen()) {
+                    // should we close it again?
+                    device->open(QIODevice::ReadOnly);
+                }
+                Q_ASSERT(device->pos() == 0);
+                QString data = QString::fromUtf8(device->peek(PeekSize));
+                if (PeekSize < contentLength)
+                {
+                    data += QStringLiteral("...(%1 bytes elided)").arg(QString::number(contentLength - PeekSize));
+                }
+                body[QStringLiteral("data")] = data;
+            } else {
+                body[QStringLiteral("data")] = QStringLiteral("%1 bytes of %2 data (body sampled out)").arg(QString::number(contentLength), contentType);
             }
-            body[QStringLiteral("data")] = data;
         } else {
             body[QStringLiteral("data")] = QStringLiteral("%1 bytes of %2 data").arg(QString::number(contentLength), contentType);
         }
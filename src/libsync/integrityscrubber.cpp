@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "integrityscrubber.h"
+#include "filesystem.h"
+
+#include "common/checksums.h"
+#include "common/syncjournaldb.h"
+
+#include <QFileInfo>
+#include <QLoggingCategory>
+
+using namespace std::chrono_literals;
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcScrubber, "sync.scrubber", QtInfoMsg)
+
+namespace {
+    /// Journal rows fetched per page of the walk; also the batch size
+    /// handed to ValidateChecksumBatch
+    constexpr int scrubBatchSizeC = 100;
+    /// Breather between two batches even when the rate cap would allow more
+    constexpr auto scrubMinPauseC = 1s;
+    /// A finished pass does not restart before this much time has passed
+    constexpr auto scrubPassCooldownC = 24h;
+}
+
+IntegrityScrubber::IntegrityScrubber(const QString &localPath, SyncJournalDb *journal, qint64 bytesPerSecond, QObject *parent)
+    : QObject(parent)
+    , _localPath(localPath)
+    , _journal(journal)
+    , _bytesPerSecond(qMax<qint64>(1, bytesPerSecond))
+{
+    _timer.setSingleShot(true);
+    connect(&_timer, &QTimer::timeout, this, &IntegrityScrubber::scrubNext);
+}
+
+void IntegrityScrubber::start()
+{
+    if (_active) {
+        return;
+    }
+    if (_lastPassFinished.isValid()
+        && !_lastPassFinished.hasExpired(std::chrono::milliseconds(scrubPassCooldownC).count())) {
+        return;
+    }
+    _active = true;
+    _timer.start(scrubMinPauseC);
+}
+
+void IntegrityScrubber::stop()
+{
+    _active = false;
+    _timer.stop();
+}
+
+void IntegrityScrubber::scrubNext()
+{
+    if (!_active) {
+        return;
+    }
+
+    if (_batch.isEmpty()) {
+        if (!_journal->getFileRecordsAfterPath(_cursor, scrubBatchSizeC,
+                [this](const SyncJournalFileRecord &record) { _batch.enqueue(record); })) {
+            qCWarning(lcScrubber) << "Could not read the journal, stopping the scrub";
+            stop();
+            return;
+        }
+        if (_batch.isEmpty()) {
+            qCInfo(lcScrubber) << "Scrub pass over" << _localPath << "finished:" << _filesScrubbed
+                               << "files checked," << _corruptFiles << "corrupt";
+            Q_EMIT passCompleted(_filesScrubbed, _corruptFiles);
+            _cursor.clear();
+            _filesScrubbed = 0;
+            _corruptFiles = 0;
+            _lastPassFinished.start();
+            _active = false;
+            return;
+        }
+    }
+
+    // Drain the whole page into one batch so the verification does not
+    // allocate a checksum QObject per file.
+    QVector<ValidateChecksumBatch::Entry> entries;
+    QHash<QString, SyncJournalFileRecord> candidates;
+    qint64 batchBytes = 0;
+    while (!_batch.isEmpty()) {
+        const SyncJournalFileRecord record = _batch.dequeue();
+        _cursor = record._path;
+
+        if (record._type != ItemTypeFile
+            || !ChecksumHeader::parseChecksumHeader(record._checksumHeader).isValid()) {
+            continue;
+        }
+        const QString filePath = _localPath + QString::fromUtf8(record._path);
+        const QFileInfo info(filePath);
+        if (!FileSystem::fileExists(filePath, info)
+            || FileSystem::getSize(info) != record._fileSize
+            || FileSystem::getModTime(filePath) != record._modtime) {
+            // Deleted or locally modified, the next sync deals with it.
+            continue;
+        }
+        entries.append({ filePath, record._checksumHeader });
+        candidates.insert(filePath, record);
+        batchBytes += record._fileSize;
+    }
+
+    if (entries.isEmpty()) {
+        _timer.start(0);
+        return;
+    }
+
+    auto *batch = new ValidateChecksumBatch(this);
+    connect(batch, &ValidateChecksumBatch::done, this,
+        [this, candidates, batchBytes](const QStringList &mismatchedPaths, const QStringList &unreadablePaths) {
+            batchVerified(candidates, mismatchedPaths, unreadablePaths, batchBytes);
+        });
+    connect(batch, &ValidateChecksumBatch::done, batch, &QObject::deleteLater);
+    batch->start(entries);
+}
+
+void IntegrityScrubber::batchVerified(const QHash<QString, SyncJournalFileRecord> &candidates,
+    const QStringList &mismatchedPaths, const QStringList &unreadablePaths, qint64 batchBytes)
+{
+    if (!_active) {
+        // stop() raced with the verification; the walk resumes here later.
+        return;
+    }
+
+    _filesScrubbed += candidates.size();
+    for (const QString &filePath : unreadablePaths) {
+        // The file became unreadable mid-walk, nothing to conclude from that.
+        qCInfo(lcScrubber) << "Could not hash" << filePath << "- skipped";
+    }
+    for (const QString &filePath : mismatchedPaths) {
+        const auto record = candidates.value(filePath);
+        if (FileSystem::getModTime(filePath) != record._modtime) {
+            // The file was modified while it was being hashed.
+            continue;
+        }
+        ++_corruptFiles;
+        qCWarning(lcScrubber) << filePath << "no longer matches its synced checksum" << record._checksumHeader;
+        Q_EMIT corruptionDetected(QString::fromUtf8(record._path));
+    }
+    scheduleNext(batchBytes);
+}
+
+void IntegrityScrubber::scheduleNext(qint64 bytesRead)
+{
+    // The cap holds on average: the batch was read at full speed, now pause
+    // for the time those reads were entitled to under the configured rate.
+    const auto pause = std::chrono::milliseconds(bytesRead * 1000 / _bytesPerSecond);
+    _timer.start(std::max<std::chrono::milliseconds>(scrubMinPauseC, pause));
+}
+
+} // namespace OCC
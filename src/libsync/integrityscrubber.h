@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "owncloudlib.h"
+
+#include "common/checksumalgorithms.h"
+#include "common/syncjournalfilerecord.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QQueue>
+#include <QTimer>
+
+namespace OCC {
+
+class SyncJournalDb;
+
+/**
+ * @brief Re-verifies local files against the checksums recorded at sync time
+ * @ingroup libsync
+ *
+ * Silent corruption of a synced file - an aging disk flipping bits, a bad
+ * cable - is only noticed when the user opens the file, because neither
+ * side of the sync sees a metadata change. This scrubber walks the journal
+ * in path order while the folder is idle, re-computes the content checksum
+ * of every plain file that still matches its journal record, and reports
+ * the ones that no longer hash to the stored value so the owner can
+ * schedule a re-download.
+ *
+ * Files whose size or mtime differ from the journal are skipped: they were
+ * modified locally and are the next sync's business, not corruption.
+ *
+ * Each journal page is verified as one ValidateChecksumBatch, so walking
+ * thousands of small files does not allocate a checksum QObject per file.
+ *
+ * The read load is capped on average: each batch is hashed at full speed
+ * and the walk then pauses for the time the reads were entitled to under
+ * the configured rate.
+ */
+class OWNCLOUDSYNC_EXPORT IntegrityScrubber : public QObject
+{
+    Q_OBJECT
+public:
+    IntegrityScrubber(const QString &localPath, SyncJournalDb *journal, qint64 bytesPerSecond, QObject *parent);
+
+    /** Resume the walk; call when the folder went idle.
+     *
+     * Does nothing while a pass that finished recently is cooling down.
+     */
+    void start();
+    /** Pause the walk; call before a sync runs. */
+    void stop();
+
+Q_SIGNALS:
+    /// path's content no longer matches the checksum recorded at sync time
+    void corruptionDetected(const QString &path);
+    /// A whole pass over the journal finished
+    void passCompleted(int filesScrubbed, int corruptFiles);
+
+private:
+    void scrubNext();
+    void batchVerified(const QHash<QString, SyncJournalFileRecord> &candidates,
+        const QStringList &mismatchedPaths, const QStringList &unreadablePaths, qint64 batchBytes);
+    void scheduleNext(qint64 bytesRead);
+
+    QString _localPath; // absolute, with trailing slash
+    SyncJournalDb *_journal;
+    /// Average read-rate cap, enforced by pausing between files
+    qint64 _bytesPerSecond;
+
+    QTimer _timer;
+    bool _active = false;
+    /// The walk continues with the first journal path after this one
+    QByteArray _cursor;
+    QQueue<SyncJournalFileRecord> _batch;
+    /// Valid once a pass finished; gates the cool-down in start()
+    QElapsedTimer _lastPassFinished;
+    int _filesScrubbed = 0;
+    int _corruptFiles = 0;
+};
+}
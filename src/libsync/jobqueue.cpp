@@ -19,10 +19,19 @@
 
 #include <QLoggingCategory>
 
+using namespace std::chrono_literals;
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcJobQUeue, "sync.networkjob.jobqueue", QtDebugMsg)
 
+namespace {
+    /// A job queued longer than this is promoted one lane on the next drain,
+    /// so a stream of fresh higher-priority jobs cannot keep pushing it to
+    /// the back of every retry round.
+    constexpr auto agingThresholdC = 30s;
+}
+
 JobQueue::JobQueue(Account *account)
     : _account(account)
 {
@@ -42,11 +51,27 @@ void JobQueue::unblock()
     _blocked--;
     qCDebug(lcJobQUeue) << "unblock:" << _blocked << _account->displayNameWithHost();
     if (_blocked == 0) {
-        auto tmp = std::move(_jobs);
-        for (auto job : tmp) {
-            if (job) {
-                qCDebug(lcJobQUeue) << "Retry" << job;
-                job->retry();
+        auto lanes = std::move(_lanes);
+        _lanes = {};
+        // Aging: a job that waited through a long block moves up one lane
+        // before the drain.
+        for (size_t lane = 1; lane < lanes.size(); ++lane) {
+            auto &jobs = lanes[lane];
+            for (auto it = jobs.begin(); it != jobs.end();) {
+                if (it->queuedSince.hasExpired(std::chrono::milliseconds(agingThresholdC).count())) {
+                    lanes[lane - 1].push_back(*it);
+                    it = jobs.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (const auto &lane : lanes) {
+            for (const auto &queued : lane) {
+                if (queued.job) {
+                    qCDebug(lcJobQUeue) << "Retry" << queued.job;
+                    queued.job->retry();
+                }
             }
         }
     }
@@ -64,7 +89,7 @@ bool JobQueue::retry(AbstractNetworkJob *job)
     }
     if (_blocked) {
         qCDebug(lcJobQUeue) << "Retry queued" << job;
-        _jobs.push_back(job);
+        push(job);
     } else {
         qCDebug(lcJobQUeue) << "Direct retry" << job;
         job->retry();
@@ -78,25 +103,46 @@ bool JobQueue::enqueue(AbstractNetworkJob *job)
         return false;
     }
     qCDebug(lcJobQUeue) << "Queue" << job;
-    _jobs.push_back(job);
+    push(job);
     return true;
 }
 
+void JobQueue::push(AbstractNetworkJob *job)
+{
+    // QNetworkRequest::Priority is ordered HighPriority < NormalPriority < LowPriority
+    auto lane = Priority::Metadata;
+    if (job->priority() > QNetworkRequest::NormalPriority) {
+        lane = Priority::Bulk;
+    } else if (job->priority() < QNetworkRequest::NormalPriority) {
+        lane = Priority::Interactive;
+    }
+    QueuedJob queued { job, {} };
+    queued.queuedSince.start();
+    _lanes[static_cast<size_t>(lane)].push_back(queued);
+}
+
 void JobQueue::clear()
 {
     _blocked = 0;
-    auto tmp = std::move(_jobs);
-    for (auto job : tmp) {
-        if (job) {
-            qCDebug(lcJobQUeue) << "Abort" << job;
-            job->abort();
+    auto lanes = std::move(_lanes);
+    _lanes = {};
+    for (const auto &lane : lanes) {
+        for (const auto &queued : lane) {
+            if (queued.job) {
+                qCDebug(lcJobQUeue) << "Abort" << queued.job;
+                queued.job->abort();
+            }
         }
     }
 }
 
 size_t JobQueue::size() const
 {
-    return _jobs.size();
+    size_t total = 0;
+    for (const auto &lane : _lanes) {
+        total += lane.size();
+    }
+    return total;
 }
 
 JobQueueGuard::JobQueueGuard(JobQueue *queue)
@@ -15,7 +15,10 @@
 
 #include "owncloudlib.h"
 
+#include <QElapsedTimer>
 #include <QPointer>
+
+#include <array>
 #include <vector>
 
 namespace OCC {
@@ -26,6 +29,24 @@ class Account;
 class OWNCLOUDSYNC_EXPORT JobQueue
 {
 public:
+    /** Drain order of queued jobs
+     *
+     * Derived from AbstractNetworkJob::priority(): hydrations and other
+     * user-initiated requests run with QNetworkRequest::HighPriority, bulk
+     * transfers with LowPriority. When the queue unblocks, the lanes are
+     * retried in this order, so user-initiated actions reclaim the limited
+     * parallel job slots before bulk transfers do.
+     */
+    enum class Priority : uint8_t {
+        /// A user is waiting on the result right now, e.g. a hydration
+        Interactive = 0,
+        /// Discovery and other small metadata requests
+        Metadata = 1,
+        /// Large uploads and downloads
+        Bulk = 2,
+    };
+    static constexpr size_t PriorityCount = 3;
+
     JobQueue(Account *account);
 
     /**
@@ -53,12 +74,20 @@ public:
     void clear();
 
 private:
+    struct QueuedJob
+    {
+        QPointer<AbstractNetworkJob> job;
+        /// Runs while the job sits in the queue, used for aging
+        QElapsedTimer queuedSince;
+    };
+
     void block();
     void unblock();
+    void push(AbstractNetworkJob *job);
 
     Account *_account;
     uint _blocked = 0;
-    std::vector<QPointer<AbstractNetworkJob>> _jobs;
+    std::array<std::vector<QueuedJob>, PriorityCount> _lanes;
 
     friend class JobQueueGuard;
 };
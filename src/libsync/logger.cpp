@@ -13,6 +13,7 @@
  */
 
 #include "logger.h"
+#include "common/binarylog.h"
 #include "configfile.h"
 #include "theme.h"
 
@@ -34,6 +35,8 @@ namespace {
 constexpr int crashLogSizeC = 20;
 constexpr int maxLogSizeC = 1024 * 1024 * 100; // 100 MiB
 constexpr int minLogsToKeepC = 5;
+// Log lines queued for the writer thread before the oldest get dropped.
+constexpr size_t logQueueSizeC = 8192;
 
 #ifdef Q_OS_WIN
 bool isDebuggerPresent()
@@ -65,9 +68,11 @@ Logger *Logger::instance()
 Logger::Logger(QObject *parent)
     : QObject(parent)
     , _maxLogFiles(std::max(ConfigFile().automaticDeleteOldLogs(), minLogsToKeepC))
+    , _queue(logQueueSizeC)
 {
     qSetMessagePattern(loggerPattern());
     _crashLog.resize(crashLogSizeC);
+    _writerThread = std::thread([this] { writerLoop(); });
 #ifndef NO_MSG_HANDLER
     qInstallMessageHandler([](QtMsgType type, const QMessageLogContext &ctx, const QString &message) {
             Logger::instance()->doLog(type, ctx, message);
@@ -80,6 +85,12 @@ Logger::~Logger()
 #ifndef NO_MSG_HANDLER
     qInstallMessageHandler(nullptr);
 #endif
+    _quitWriter.store(true, std::memory_order_release);
+    _pendingEntries.release();
+    _writerThread.join();
+    // Whatever arrived between the last drain and the handler removal
+    QMutexLocker lock(&_mutex);
+    drainQueue();
 }
 
 QString Logger::loggerPattern()
@@ -90,40 +101,120 @@ QString Logger::loggerPattern()
 bool Logger::isLoggingToFile() const
 {
     QMutexLocker lock(&_mutex);
-    return !_logstream.isNull();
+    return !_logstream.isNull() || !_binaryLogStream.isNull();
 }
 
 void Logger::doLog(QtMsgType type, const QMessageLogContext &ctx, const QString &message)
 {
-    const QString msg = qFormatLogMessage(type, ctx, message) + QLatin1Char('\n');
-    {
+    // The category and function pointers in ctx reference static strings, but
+    // the context does not outlive this call: copy what the writer needs.
+    LogEntry entry { QDateTime::currentMSecsSinceEpoch(), type, QByteArray(ctx.category), QByteArray(ctx.function), message };
+
+    if (Q_UNLIKELY(type == QtFatalMsg)) {
+        // A fatal message must hit the disk before the process dies: write
+        // everything queued ahead of it and the message itself inline.
         QMutexLocker lock(&_mutex);
-        _crashLogIndex = (_crashLogIndex + 1) % crashLogSizeC;
-        _crashLog[_crashLogIndex] = msg;
-        if (_logstream) {
-            (*_logstream) << msg;
-            if (_doFileFlush)
-                _logstream->flush();
-        }
+        drainQueue();
+        writeEntry(entry);
+        dumpCrashLog();
+        close();
 #if defined(Q_OS_WIN)
-        if (isDebuggerPresent()) {
-            OutputDebugStringW(reinterpret_cast<const wchar_t *>(msg.utf16()));
-        }
+        // Make application terminate in a way that can be caught by the crash reporter
+        Utility::crash();
 #endif
-        if (type == QtFatalMsg) {
-            dumpCrashLog();
-            close();
+        return;
+    }
+
+    // Formatting and file I/O happen on the writer thread; the calling
+    // threads no longer serialize on the logger mutex.
+    const auto dropped = _queue.pushDropOldest(std::move(entry));
+    if (dropped > 0) {
+        _droppedEntries.fetch_add(dropped, std::memory_order_relaxed);
+    }
+    _pendingEntries.release();
+}
+
+void Logger::writerLoop()
+{
+    for (;;) {
+        _pendingEntries.acquire();
+        if (_quitWriter.load(std::memory_order_acquire)) {
+            return;
+        }
+        // Collapse the wakeups of everything the drain below will pick up. A
+        // release slipping in after this only causes one empty drain.
+        if (const int pending = _pendingEntries.available(); pending > 0) {
+            _pendingEntries.tryAcquire(pending);
+        }
+        QMutexLocker lock(&_mutex);
+        drainQueue();
+    }
+}
+
+void Logger::drainQueue()
+{
+    LogEntry entry;
+    while (_queue.tryPop(&entry)) {
+        writeEntry(entry);
+    }
+    const auto dropped = _droppedEntries.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        writeEntry({ QDateTime::currentMSecsSinceEpoch(), QtWarningMsg, QByteArrayLiteral("sync.logger"), QByteArray(),
+            QStringLiteral("Log queue overflowed, dropped the %1 oldest messages").arg(dropped) });
+    }
+}
+
+void Logger::writeEntry(const LogEntry &entry)
+{
+    const QString msg = formatEntry(entry) + QLatin1Char('\n');
+    _crashLogIndex = (_crashLogIndex + 1) % crashLogSizeC;
+    _crashLog[_crashLogIndex] = msg;
+    if (_binaryLogStream) {
+        writeBinaryEntry(entry);
+    } else if (_logstream) {
+        (*_logstream) << msg;
+        if (_doFileFlush)
+            _logstream->flush();
+    }
 #if defined(Q_OS_WIN)
-            // Make application terminate in a way that can be caught by the crash reporter
-            Utility::crash();
+    if (isDebuggerPresent()) {
+        OutputDebugStringW(reinterpret_cast<const wchar_t *>(msg.utf16()));
+    }
 #endif
+    if (!_logDirectory.isEmpty()) {
+        if (_logFile.size() > maxLogSizeC) {
+            rotateLog();
         }
-        if (!_logDirectory.isEmpty()) {
-            if (_logFile.size() > maxLogSizeC) {
-                rotateLog();
-            }
+    }
+}
+
+QString Logger::formatEntry(const LogEntry &entry)
+{
+    // Renders the same line qFormatLogMessage() produces for loggerPattern(),
+    // from the fields captured at the call site. The timestamp is the time
+    // the message was logged, not the time it is written out.
+    const auto typeName = [&entry]() {
+        switch (entry.type) {
+        case QtDebugMsg:
+            return QLatin1String("debug");
+        case QtInfoMsg:
+            return QLatin1String("info");
+        case QtWarningMsg:
+            return QLatin1String("warning");
+        case QtCriticalMsg:
+            return QLatin1String("critical");
+        case QtFatalMsg:
+            return QLatin1String("fatal");
         }
+        return QLatin1String("unknown");
+    }();
+    QString line = QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString(QStringLiteral("yy-MM-dd hh:mm:ss:zzz"));
+    line += QStringLiteral(" [ %1 %2 ]").arg(typeName, QString::fromUtf8(entry.category));
+    if (entry.type == QtDebugMsg) {
+        line += QStringLiteral("\t[ %1 ]").arg(QString::fromUtf8(entry.function));
     }
+    line += QStringLiteral(":\t") + entry.message;
+    return line;
 }
 
 void Logger::open(const QString &name)
@@ -142,26 +233,45 @@ void Logger::open(const QString &name)
         std::cerr << "Failed to open the log file" << std::endl;
         return;
     }
+    const QString versionBanner = Theme::instance()->aboutVersions(Theme::VersionFormat::OneLiner) + QLatin1Char(' ') + qApp->applicationName();
+    if (_binaryLogFormat && name != QLatin1Char('-')) {
+        // Every file carries its own string table, see common/binarylog.h
+        _binaryLogStringIds.clear();
+        _binaryLogStream.reset(new QDataStream(&_logFile));
+        _binaryLogStream->setVersion(BinaryLog::dataStreamVersionC);
+        BinaryLog::writeFileHeader(*_binaryLogStream);
+        BinaryLog::writeMessage(*_binaryLogStream, QDateTime::currentMSecsSinceEpoch(), QtInfoMsg, 0, 0, versionBanner.toUtf8());
+        return;
+    }
     _logstream.reset(new QTextStream(&_logFile));
     _logstream->setEncoding(QStringConverter::Utf8);
-    (*_logstream) << Theme::instance()->aboutVersions(Theme::VersionFormat::OneLiner) << " " << qApp->applicationName() << Qt::endl;
+    (*_logstream) << versionBanner << Qt::endl;
 }
 
 void Logger::close()
 {
-    if (_logstream)
+    QMutexLocker lock(&_mutex);
+    if (_logstream || _binaryLogStream)
     {
-        _logstream->flush();
+        // Get the queued lines into the stream before it goes away
+        drainQueue();
+        if (_logstream) {
+            _logstream->flush();
+        }
         _logFile.close();
         _logstream.reset();
+        _binaryLogStream.reset();
+        _binaryLogStringIds.clear();
     }
 }
 
 void Logger::setLogFile(const QString &name)
 {
     QMutexLocker locker(&_mutex);
-    if (_logstream) {
+    if (_logstream || _binaryLogStream) {
         _logstream.reset(nullptr);
+        _binaryLogStream.reset(nullptr);
+        _binaryLogStringIds.clear();
         _logFile.close();
     }
 
@@ -188,6 +298,36 @@ void Logger::setLogFlush(bool flush)
     _doFileFlush = flush;
 }
 
+void Logger::setBinaryLogFormat(bool binary)
+{
+    QMutexLocker locker(&_mutex);
+    _binaryLogFormat = binary;
+}
+
+quint32 Logger::binaryLogStringId(const QByteArray &string)
+{
+    if (string.isEmpty()) {
+        return 0;
+    }
+    const auto it = _binaryLogStringIds.constFind(string);
+    if (it != _binaryLogStringIds.cend()) {
+        return *it;
+    }
+    const quint32 id = _binaryLogStringIds.size() + 1;
+    _binaryLogStringIds.insert(string, id);
+    BinaryLog::writeString(*_binaryLogStream, id, string);
+    return id;
+}
+
+void Logger::writeBinaryEntry(const LogEntry &entry)
+{
+    BinaryLog::writeMessage(*_binaryLogStream, entry.timestamp, static_cast<quint8>(entry.type),
+        binaryLogStringId(entry.category), binaryLogStringId(entry.function), entry.message.toUtf8());
+    if (_doFileFlush) {
+        _logFile.flush();
+    }
+}
+
 void Logger::setLogDebug(bool debug)
 {
     const QSet<QString> rules = {QStringLiteral("sync.*.debug=true"), QStringLiteral("gui.*.debug=true")};
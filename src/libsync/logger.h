@@ -15,14 +15,21 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <QDataStream>
 #include <QDateTime>
 #include <QFile>
+#include <QHash>
 #include <QList>
 #include <QMutex>
 #include <QObject>
+#include <QSemaphore>
 #include <QSet>
 #include <QTextStream>
 
+#include <atomic>
+#include <thread>
+
+#include "common/concurrentringbuffer.h"
 #include "owncloudlib.h"
 
 namespace OCC {
@@ -49,6 +56,14 @@ public:
     void setLogDir(const QString &dir);
     void setLogFlush(bool flush);
 
+    /** Write log files in the compact binary format instead of text.
+     *
+     * See common/binarylog.h for the format, the logcat tool renders such
+     * files back to the usual text lines. Takes effect when the next log
+     * file is opened.
+     */
+    void setBinaryLogFormat(bool binary);
+
     /**
      * Set the maximum number of logs files to keep.
      * Setting values below 5 will have no effect.
@@ -83,9 +98,34 @@ public:
     void setLogRules(const QSet<QString> &rules);
 
 private:
+    /** A log line captured on the calling thread, formatted and written later
+     * by the writer thread. Keeping the raw fields instead of the rendered
+     * line defers the pattern expansion off the hot path.
+     */
+    struct LogEntry
+    {
+        qint64 timestamp = 0; // msecs since epoch
+        QtMsgType type = QtDebugMsg;
+        QByteArray category;
+        QByteArray function;
+        QString message;
+    };
+
     Logger(QObject *parent = nullptr);
     ~Logger() override;
 
+    static QString formatEntry(const LogEntry &entry);
+
+    void writerLoop();
+    /// Write out everything queued, the caller must hold _mutex
+    void drainQueue();
+    /// Format and write a single entry, the caller must hold _mutex
+    void writeEntry(const LogEntry &entry);
+    /// Write a single entry as a binary record, the caller must hold _mutex
+    void writeBinaryEntry(const LogEntry &entry);
+    /// Intern a string in the binary log string table, 0 is the empty string
+    quint32 binaryLogStringId(const QByteArray &string);
+
     void rotateLog();
 
     void open(const QString &name);
@@ -96,6 +136,11 @@ private:
     bool _doFileFlush = false;
     bool _logDebug = false;
     QScopedPointer<QTextStream> _logstream;
+    bool _binaryLogFormat = false;
+    // Set up instead of _logstream while the binary format is active
+    QScopedPointer<QDataStream> _binaryLogStream;
+    // String table of the current binary log file, see common/binarylog.h
+    QHash<QByteArray, quint32> _binaryLogStringIds;
     mutable QRecursiveMutex _mutex;
     QString _logDirectory;
     bool _temporaryFolderLogDir = false;
@@ -105,6 +150,14 @@ private:
     bool _consoleIsAttached = false;
 
     int _maxLogFiles;
+
+    // Log lines travel from the calling threads to the writer thread through
+    // a lock-free ring, full buffers shed their oldest entries.
+    ConcurrentRingBuffer<LogEntry> _queue;
+    QSemaphore _pendingEntries;
+    std::atomic<quint64> _droppedEntries = 0;
+    std::atomic<bool> _quitWriter = false;
+    std::thread _writerThread;
 };
 
 } // namespace OCC
@@ -15,9 +15,14 @@
 
 #include <QBuffer>
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QNetworkRequest>
 #include <QPainter>
 #include <QPainterPath>
+#include <QThread>
 
 #include "account.h"
 #include "networkjobs.h"
@@ -49,6 +54,47 @@ const QString &RequestEtagJob::etag() const
 {
     return _etag;
 }
+
+void RequestEtagJob::fetch(Account *account, const QUrl &rootUrl, const QString &path,
+    const QObject *context, const std::function<void(int statusCode, const QString &etag)> &callback)
+{
+    // In-flight requests by account and URL. Only touched from the main
+    // thread, where all network jobs live.
+    static QHash<QByteArray, QPointer<RequestEtagJob>> inFlight;
+
+    const QByteArray key = account->uuid().toByteArray() + Utility::concatUrlPath(rootUrl, path).toEncoded();
+    RequestEtagJob *job = inFlight.value(key);
+    const bool coalesced = job != nullptr;
+    if (!job) {
+        job = new RequestEtagJob(account, rootUrl, path);
+        inFlight.insert(key, job);
+        // finishedSignal fires before the job's deleteLater() runs; remove
+        // the entry right away so a later fetch() does not subscribe to a
+        // job that already reported. The destroyed() fallback covers jobs
+        // that go away without finishing, guarded against a successor
+        // registered under the same key in the meantime.
+        connect(job, &RequestEtagJob::finishedSignal, job, [key, job] {
+            if (inFlight.value(key) == job) {
+                inFlight.remove(key);
+            }
+        });
+        connect(job, &QObject::destroyed, [key, job] {
+            const auto it = inFlight.constFind(key);
+            // The QPointer may already be cleared at this point
+            if (it != inFlight.cend() && (it->isNull() || it->data() == job)) {
+                inFlight.remove(key);
+            }
+        });
+    } else {
+        qCDebug(lcEtagJob) << "Sharing the in-flight etag request for" << rootUrl << path;
+    }
+    connect(job, &RequestEtagJob::finishedSignal, context, [job, callback] {
+        callback(job->httpStatusCode(), job->etag());
+    });
+    if (!coalesced) {
+        job->start();
+    }
+}
 /*********************************************************************************************/
 
 MkColJob::MkColJob(Account *account, const QUrl &url, const QString &path, const QMap<QByteArray, QByteArray> &extraHeaders, QObject *parent)
@@ -84,145 +130,256 @@ void MkColJob::finished()
 }
 
 /*********************************************************************************************/
-// supposed to read <D:collection> when pointing to <D:resourcetype><D:collection></D:resourcetype>..
-static QString readContentsAsString(QXmlStreamReader &reader)
-{
-    QString result;
-    int level = 0;
-    do {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        if (type == QXmlStreamReader::StartElement) {
-            level++;
-            result += QLatin1Char('<') + reader.name().toString() + QLatin1Char('>');
-        } else if (type == QXmlStreamReader::Characters) {
-            result += reader.text();
-        } else if (type == QXmlStreamReader::EndElement) {
-            level--;
-            if (level < 0) {
-                break;
-            }
-            result += QStringLiteral("</") + reader.name().toString() + QLatin1Char('>');
-        }
 
-    } while (!reader.atEnd());
-    return result;
+LsColXMLParser::LsColXMLParser()
+{
 }
 
+bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, qint64> *sizes, const QString &expectedPath)
+{
+    startParsing(sizes, expectedPath);
+    if (!feed(xml)) {
+        return false;
+    }
+    return endParsing();
+}
 
-LsColXMLParser::LsColXMLParser()
+void LsColXMLParser::startParsing(QHash<QString, qint64> *sizes, const QString &expectedPath)
 {
+    _reader.clear();
+    _reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration(QStringLiteral("d"), QStringLiteral("DAV:")));
+    _sizes = sizes;
+    _expectedPath = expectedPath;
+    _folders.clear();
+    _currentHref.clear();
+    _currentText.clear();
+    _currentPropertyName.clear();
+    _currentTmpProperties.clear();
+    _currentHttp200Properties.clear();
+    _capture = TextCapture::None;
+    _propertyDepth = 0;
+    _currentPropsAreValid = false;
+    _insidePropstat = false;
+    _insideProp = false;
+    _insideMultiStatus = false;
+    _broken = false;
 }
 
-bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, qint64> *sizes, const QString &expectedPath)
+bool LsColXMLParser::feed(const QByteArray &data)
+{
+    if (_broken) {
+        return false;
+    }
+    _reader.addData(data);
+    return processBuffered();
+}
+
+bool LsColXMLParser::endParsing()
 {
-    // Parse DAV response
-    QXmlStreamReader reader(xml);
-    reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration(QStringLiteral("d"), QStringLiteral("DAV:")));
-
-    QStringList folders;
-    QString currentHref;
-    QMap<QString, QString> currentTmpProperties;
-    QMap<QString, QString> currentHttp200Properties;
-    bool currentPropsAreValid = false;
-    bool insidePropstat = false;
-    bool insideProp = false;
-    bool insideMultiStatus = false;
-
-    while (!reader.atEnd()) {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        QString name = reader.name().toString();
+    if (_broken) {
+        return false;
+    }
+    if (_reader.hasError()) {
+        // Covers truncated documents too: PrematureEndOfDocumentError persists
+        // when endParsing() is called without the missing data ever arriving.
+        qCWarning(lcPropfindJob) << "ERROR" << _reader.errorString();
+        _broken = true;
+        return false;
+    }
+    if (!_insideMultiStatus) {
+        qCWarning(lcPropfindJob) << "ERROR no WebDAV response?";
+        _broken = true;
+        return false;
+    }
+    Q_EMIT directoryListingSubfolders(_folders);
+    Q_EMIT finishedWithoutError();
+    return true;
+}
+
+bool LsColXMLParser::processBuffered()
+{
+    while (!_reader.atEnd()) {
+        const QXmlStreamReader::TokenType type = _reader.readNext();
+        const QString name = _reader.name().toString();
+
+        if (_capture == TextCapture::Property) {
+            // Inside a property element: serialize nested elements into the
+            // property string (e.g. "<collection>" inside resourcetype).
+            if (type == QXmlStreamReader::StartElement) {
+                _propertyDepth++;
+                _currentText += QLatin1Char('<') + name + QLatin1Char('>');
+            } else if (type == QXmlStreamReader::Characters) {
+                _currentText += _reader.text();
+            } else if (type == QXmlStreamReader::EndElement) {
+                if (_propertyDepth > 0) {
+                    _propertyDepth--;
+                    _currentText += QStringLiteral("</") + name + QLatin1Char('>');
+                } else {
+                    // The property element itself ended
+                    if (_currentPropertyName == QLatin1String("resourcetype") && _currentText.contains(QLatin1String("collection"))) {
+                        _folders.append(_currentHref);
+                    } else if (_currentPropertyName == QLatin1String("size")) {
+                        bool ok = false;
+                        auto s = _currentText.toLongLong(&ok);
+                        if (ok && _sizes) {
+                            _sizes->insert(_currentHref, s);
+                        }
+                    }
+                    _currentTmpProperties.insert(_currentPropertyName, _currentText);
+                    _capture = TextCapture::None;
+                }
+            }
+            continue;
+        }
+
         // Start elements with DAV:
-        if (type == QXmlStreamReader::StartElement && reader.namespaceUri() == QLatin1String("DAV:")) {
+        if (type == QXmlStreamReader::StartElement && _reader.namespaceUri() == QLatin1String("DAV:")) {
             if (name == QLatin1String("href")) {
-                // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
-                // but the result will have URL encoding..
-                QString hrefString = QString::fromUtf8(QByteArray::fromPercentEncoding(reader.readElementText().toUtf8()));
-                if (!hrefString.startsWith(expectedPath)) {
-                    qCWarning(lcPropfindJob) << "Invalid href" << hrefString << "expected starting with" << expectedPath;
-                    return false;
-                }
-                currentHref = hrefString;
+                _capture = TextCapture::Href;
+                _currentText.clear();
+                continue;
             } else if (name == QLatin1String("response")) {
             } else if (name == QLatin1String("propstat")) {
-                insidePropstat = true;
-            } else if (name == QLatin1String("status") && insidePropstat) {
-                QString httpStatus = reader.readElementText();
-                if (httpStatus.startsWith(QLatin1String("HTTP/1.1 200")) || httpStatus.startsWith(QLatin1String("HTTP/1.1 425"))) {
-                    currentPropsAreValid = true;
-                } else {
-                    currentPropsAreValid = false;
-                }
+                _insidePropstat = true;
+            } else if (name == QLatin1String("status") && _insidePropstat) {
+                _capture = TextCapture::Status;
+                _currentText.clear();
+                continue;
             } else if (name == QLatin1String("prop")) {
-                insideProp = true;
+                _insideProp = true;
                 continue;
             } else if (name == QLatin1String("multistatus")) {
-                insideMultiStatus = true;
+                _insideMultiStatus = true;
                 continue;
             }
         }
 
-        if (type == QXmlStreamReader::StartElement && insidePropstat && insideProp) {
+        if (type == QXmlStreamReader::StartElement && _insidePropstat && _insideProp) {
             // All those elements are properties
-            QString propertyContent = readContentsAsString(reader);
-            if (name == QLatin1String("resourcetype") && propertyContent.contains(QLatin1String("collection"))) {
-                folders.append(currentHref);
-            } else if (name == QLatin1String("size")) {
-                bool ok = false;
-                auto s = propertyContent.toLongLong(&ok);
-                if (ok && sizes) {
-                    sizes->insert(currentHref, s);
-                }
+            _capture = TextCapture::Property;
+            _currentPropertyName = name;
+            _currentText.clear();
+            _propertyDepth = 0;
+            continue;
+        }
+
+        if (type == QXmlStreamReader::Characters) {
+            if (_capture != TextCapture::None) {
+                _currentText += _reader.text();
             }
-            currentTmpProperties.insert(reader.name().toString(), propertyContent);
+            continue;
         }
 
         // End elements with DAV:
-        if (type == QXmlStreamReader::EndElement) {
-            if (reader.namespaceUri() == QLatin1String("DAV:")) {
-                if (reader.name() == QLatin1String("response")) {
-                    if (currentHref.endsWith(QLatin1Char('/'))) {
-                        currentHref.chop(1);
-                    }
-                    Q_EMIT directoryListingIterated(currentHref, currentHttp200Properties);
-                    currentHref.clear();
-                    currentHttp200Properties.clear();
-                } else if (reader.name() == QLatin1String("propstat")) {
-                    insidePropstat = false;
-                    if (currentPropsAreValid) {
-                        currentHttp200Properties = std::move(currentTmpProperties);
-                    }
-                    currentPropsAreValid = false;
-                } else if (reader.name() == QLatin1String("prop")) {
-                    insideProp = false;
+        if (type == QXmlStreamReader::EndElement && _reader.namespaceUri() == QLatin1String("DAV:")) {
+            if (name == QLatin1String("href") && _capture == TextCapture::Href) {
+                // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
+                // but the result will have URL encoding..
+                const QString hrefString = QString::fromUtf8(QByteArray::fromPercentEncoding(_currentText.toUtf8()));
+                if (!hrefString.startsWith(_expectedPath)) {
+                    qCWarning(lcPropfindJob) << "Invalid href" << hrefString << "expected starting with" << _expectedPath;
+                    _broken = true;
+                    return false;
+                }
+                _currentHref = hrefString;
+                _capture = TextCapture::None;
+            } else if (name == QLatin1String("status") && _capture == TextCapture::Status) {
+                _currentPropsAreValid = _currentText.startsWith(QLatin1String("HTTP/1.1 200")) || _currentText.startsWith(QLatin1String("HTTP/1.1 425"));
+                _capture = TextCapture::None;
+            } else if (name == QLatin1String("response")) {
+                if (_currentHref.endsWith(QLatin1Char('/'))) {
+                    _currentHref.chop(1);
                 }
+                Q_EMIT directoryListingIterated(_currentHref, _currentHttp200Properties);
+                _currentHref.clear();
+                _currentHttp200Properties.clear();
+            } else if (name == QLatin1String("propstat")) {
+                _insidePropstat = false;
+                if (_currentPropsAreValid) {
+                    _currentHttp200Properties = std::move(_currentTmpProperties);
+                }
+                _currentTmpProperties.clear();
+                _currentPropsAreValid = false;
+            } else if (name == QLatin1String("prop")) {
+                _insideProp = false;
             }
         }
     }
 
-    if (reader.hasError()) {
+    if (_reader.error() == QXmlStreamReader::PrematureEndOfDocumentError) {
+        // Not an error, just wait for the next chunk.
+        return true;
+    }
+    if (_reader.hasError()) {
         // XML Parser error? Whatever had been emitted before will come as directoryListingIterated
-        qCWarning(lcPropfindJob) << "ERROR" << reader.errorString() << xml;
-        return false;
-    } else if (!insideMultiStatus) {
-        qCWarning(lcPropfindJob) << "ERROR no WebDAV response?" << xml;
+        qCWarning(lcPropfindJob) << "ERROR" << _reader.errorString();
+        _broken = true;
         return false;
-    } else {
-        Q_EMIT directoryListingSubfolders(folders);
-        Q_EMIT finishedWithoutError();
     }
     return true;
 }
 
 /*********************************************************************************************/
 
+namespace {
+
+    /** Shared worker thread for multistatus parsing.
+     *
+     * Parsing (and, for content-encoded responses, the inflation Qt does
+     * while the body is being read) is far cheaper than the transfers
+     * producing it; the point is only to keep it off the thread that
+     * dispatches network events, which saturates first under many
+     * parallel requests. One thread is enough for that. Started on first
+     * use, runs for the lifetime of the process.
+     */
+    QThread *davParserThread()
+    {
+        static QThread *thread = [] {
+            auto *t = new QThread;
+            t->setObjectName(QStringLiteral("OCC::DavParser"));
+            t->start(QThread::LowPriority);
+            return t;
+        }();
+        return thread;
+    }
+}
+
 PropfindJob::PropfindJob(Account *account, const QUrl &url, const QString &path, Depth depth, QObject *parent)
     : AbstractNetworkJob(account, url, path, parent)
+    , _parser(new LsColXMLParser)
     , _depth(depth)
 {
     // Always have a higher priority than the propagator because we use this from the UI
     // and really want this to be done first (no matter what internal scheduling QNAM uses).
     // Also possibly useful for avoiding false timeouts.
     setPriority(QNetworkRequest::HighPriority);
+
+    // The connections are queued automatically: the parser works on the
+    // shared worker thread, its results arrive back on ours.
+    _parser->moveToThread(davParserThread());
+
+    connect(_parser, &LsColXMLParser::directoryListingSubfolders, this, &PropfindJob::directoryListingSubfolders);
+    connect(_parser, &LsColXMLParser::directoryListingIterated, this, &PropfindJob::directoryListingIterated);
+    connect(_parser, &LsColXMLParser::finishedWithoutError, this, &PropfindJob::finishedWithoutError);
+    if (_depth == Depth::Zero) {
+        connect(_parser, &LsColXMLParser::directoryListingIterated, this,
+            [counter = 0, this](const QString &name, const QMap<QString, QString> &) mutable {
+                counter++;
+                // With a depths of 0 we must receive only one listing
+                if (OC_ENSURE(counter == 1)) {
+                    disconnect(_parser, &LsColXMLParser::directoryListingIterated, this, &PropfindJob::directoryListingIterated);
+                } else {
+                    qCCritical(lcPropfindJob) << "Received superfluous directory listing for depth 0 propfind" << counter << "Path:" << name;
+                }
+            });
+    }
+}
+
+PropfindJob::~PropfindJob()
+{
+    // Deletion must happen on the parser's thread, after any still-queued
+    // feed() calls ran.
+    _parser->deleteLater();
 }
 
 void PropfindJob::setProperties(const QList<QByteArray> &properties)
@@ -235,80 +392,129 @@ QList<QByteArray> PropfindJob::properties() const
     return _properties;
 }
 
-void PropfindJob::start()
-{
-    QNetworkRequest req;
-    req.setRawHeader(QByteArrayLiteral("Depth"), QByteArray::number(static_cast<int>(_depth)));
-    req.setRawHeader(QByteArrayLiteral("Prefer"), QByteArrayLiteral("return=minimal"));
+namespace {
 
-    if (_properties.isEmpty()) {
-        qCWarning(lcPropfindJob) << "Propfind with no properties!";
-    }
-    QByteArray data;
+    /** The rendered PROPFIND body for a property list.
+     *
+     * The body is a pure function of the list, and discovery sends the same
+     * list for every directory it queries - on a big sync that is the same
+     * document rendered many thousands of times. Bodies are therefore built
+     * once per distinct list, with plain appends into a reserved buffer,
+     * and served from a cache afterwards. Main thread only, like the jobs.
+     */
+    QByteArray propfindBody(const QList<QByteArray> &properties)
     {
-        QTextStream stream(&data, QIODevice::WriteOnly);
-        stream.setEncoding(QStringConverter::Utf8);
-        stream << QByteArrayLiteral("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
-                                    "<d:propfind xmlns:d=\"DAV:\">"
-                                    "<d:prop>");
+        static QHash<QByteArray, QByteArray> cache;
 
-        for (const QByteArray &prop : std::as_const(_properties)) {
+        QByteArray key;
+        for (const QByteArray &prop : properties) {
+            key += prop;
+            key += '\n';
+        }
+        const auto cached = cache.constFind(key);
+        if (cached != cache.cend()) {
+            return *cached;
+        }
+
+        QByteArray data;
+        data.reserve(128 + key.size() * 2);
+        data += QByteArrayLiteral("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+                                  "<d:propfind xmlns:d=\"DAV:\">"
+                                  "<d:prop>");
+        for (const QByteArray &prop : properties) {
             const int colIdx = prop.lastIndexOf(':');
             if (colIdx >= 0) {
-                stream << QByteArrayLiteral("<") << prop.mid(colIdx + 1) << QByteArrayLiteral(" xmlns=\"") << prop.left(colIdx) << QByteArrayLiteral("\"/>");
+                data += '<' + prop.mid(colIdx + 1) + QByteArrayLiteral(" xmlns=\"") + prop.left(colIdx) + QByteArrayLiteral("\"/>");
             } else {
-                stream << QByteArrayLiteral("<d:") << prop << QByteArrayLiteral("/>");
+                data += QByteArrayLiteral("<d:") + prop + QByteArrayLiteral("/>");
             }
         }
-        stream << QByteArrayLiteral("</d:prop>"
-                                    "</d:propfind>\n");
+        data += QByteArrayLiteral("</d:prop>"
+                                  "</d:propfind>\n");
+        cache.insert(key, data);
+        return data;
+    }
+}
+
+void PropfindJob::start()
+{
+    QNetworkRequest req;
+    req.setRawHeader(QByteArrayLiteral("Depth"),
+        _depth == Depth::Infinity ? QByteArrayLiteral("infinity") : QByteArray::number(static_cast<int>(_depth)));
+    req.setRawHeader(QByteArrayLiteral("Prefer"), QByteArrayLiteral("return=minimal"));
+
+    if (_properties.isEmpty()) {
+        qCWarning(lcPropfindJob) << "Propfind with no properties!";
     }
 
     QBuffer *buf = new QBuffer(this);
-    buf->setData(data);
+    buf->setData(propfindBody(_properties));
     buf->open(QIODevice::ReadOnly);
     sendRequest(QByteArrayLiteral("PROPFIND"), req, buf);
+    // Stream the multistatus body into the parser as it arrives, so that huge
+    // listings are never buffered as a whole.
+    connect(reply(), &QNetworkReply::readyRead, this, &PropfindJob::slotReadyRead);
     AbstractNetworkJob::start();
 }
 
-// TODO: Instead of doing all in this slot, we should iteratively parse in readyRead(). This
-// would allow us to be more asynchronous in processing while data is coming from the network,
-// not all in one big blob at the end.
+bool PropfindJob::startStreamingIfPossible()
+{
+    if (_parsingStarted) {
+        return true;
+    }
+    if (httpStatusCode() != 207) {
+        return false;
+    }
+    if (!reply()->header(QNetworkRequest::ContentTypeHeader).toString().contains(QLatin1String("application/xml; charset=utf-8"))) {
+        return false;
+    }
+    const QString expectedPath = reply()->request().url().path(); // something like "/owncloud/remote.php/webdav/folder"
+    QMetaObject::invokeMethod(
+        _parser, [parser = _parser, sizes = &_sizes, expectedPath] { parser->startParsing(sizes, expectedPath); }, Qt::QueuedConnection);
+    _parsingStarted = true;
+    return true;
+}
+
+void PropfindJob::slotReadyRead()
+{
+    if (!startStreamingIfPossible()) {
+        // Wrong status or content type, finished() reports the error.
+        return;
+    }
+    const QByteArray data = reply()->readAll();
+    if (data.isEmpty()) {
+        return;
+    }
+    // A parse error latches inside the parser and makes it ignore further
+    // chunks; endParsing() reports it when the job finishes.
+    QMetaObject::invokeMethod(
+        _parser, [parser = _parser, data] { parser->feed(data); }, Qt::QueuedConnection);
+}
+
 void PropfindJob::finished()
 {
     qCInfo(lcPropfindJob) << "LSCOL of" << reply()->request().url() << "FINISHED WITH STATUS"
                           << replyStatusString();
 
-    const QString contentType = reply()->header(QNetworkRequest::ContentTypeHeader).toString();
     if (httpStatusCode() == 207) {
-        if (contentType.contains(QLatin1String("application/xml; charset=utf-8"))) {
-            LsColXMLParser parser;
-            connect(&parser, &LsColXMLParser::directoryListingSubfolders, this, &PropfindJob::directoryListingSubfolders);
-            connect(&parser, &LsColXMLParser::directoryListingIterated, this, &PropfindJob::directoryListingIterated);
-            connect(&parser, &LsColXMLParser::finishedWithoutError, this, &PropfindJob::finishedWithoutError);
-            if (_depth == Depth::Zero) {
-                connect(&parser, &LsColXMLParser::directoryListingIterated,
-                    [&parser, counter = 0, this](const QString &name, const QMap<QString, QString> &) mutable {
-                        counter++;
-                        // With a depths of 0 we must receive only one listing
-                        if (OC_ENSURE(counter == 1)) {
-                            disconnect(&parser, &LsColXMLParser::directoryListingIterated, this, &PropfindJob::directoryListingIterated);
-                        } else {
-                            qCCritical(lcPropfindJob) << "Received superfluous directory listing for depth 0 propfind" << counter << "Path:" << name;
-                        }
-                    });
-            }
-
-            const QString expectedPath = reply()->request().url().path(); // something like "/owncloud/remote.php/webdav/folder"
-            if (!parser.parse(reply()->readAll(), &_sizes, expectedPath)) {
-                // XML parse error
-                Q_EMIT finishedWithError();
-            }
-        } else {
+        if (!startStreamingIfPossible()) {
             // wrong content type
-            qCWarning(lcPropfindJob) << "Unexpected ContentTypeHeader:" << contentType;
+            qCWarning(lcPropfindJob) << "Unexpected ContentTypeHeader:" << reply()->header(QNetworkRequest::ContentTypeHeader).toString();
             Q_EMIT finishedWithError();
+            return;
         }
+        // Feed whatever arrived between the last readyRead and finished.
+        slotReadyRead();
+        // Drain the worker and run the final document checks. Only the tail
+        // of the work is left here: the bulk was parsed while the body was
+        // still arriving.
+        bool ok = false;
+        QMetaObject::invokeMethod(_parser, &LsColXMLParser::endParsing, Qt::BlockingQueuedConnection, qReturnArg(ok));
+        if (!ok) {
+            // XML parse error
+            Q_EMIT finishedWithError();
+        }
+        // On success endParsing() has emitted finishedWithoutError().
     } else {
         // wrong HTTP code or any other network error
         Q_EMIT finishedWithError();
@@ -322,15 +528,37 @@ const QHash<QString, qint64> &PropfindJob::sizes() const
 
 /*********************************************************************************************/
 
+namespace {
+QString avatarCacheBasePath(Account *account, const QString &userId, int size)
+{
+    // the user id is not necessarily a valid file name, hash it
+    const QString userHash = QString::fromLatin1(
+        QCryptographicHash::hash(userId.toUtf8(), QCryptographicHash::Md5).toHex());
+    return QStringLiteral("%1/avatars/%2-%3").arg(account->cacheDirectory(), userHash, QString::number(size));
+}
+}
+
 AvatarJob::AvatarJob(Account *account, const QString &userId, int size, QObject *parent)
     : AbstractNetworkJob(account, account->url(), QStringLiteral("remote.php/dav/avatars/%1/%2.png").arg(userId, QString::number(size)), parent)
+    , _cacheBasePath(avatarCacheBasePath(account, userId, size))
 {
     setStoreInCache(true);
 }
 
 void AvatarJob::start()
 {
-    sendRequest("GET");
+    QNetworkRequest req;
+    // ask for changes only when the image of a previous session is still around
+    if (QFileInfo::exists(_cacheBasePath + QLatin1String(".png"))) {
+        QFile etagFile(_cacheBasePath + QLatin1String(".etag"));
+        if (etagFile.open(QIODevice::ReadOnly)) {
+            const QByteArray etag = etagFile.readAll();
+            if (!etag.isEmpty()) {
+                req.setRawHeader(QByteArrayLiteral("If-None-Match"), etag);
+            }
+        }
+    }
+    sendRequest("GET", req);
     AbstractNetworkJob::start();
 }
 
@@ -354,6 +582,31 @@ QPixmap AvatarJob::makeCircularAvatar(const QPixmap &baseAvatar)
     return avatar;
 }
 
+QIcon AvatarJob::makeAvatarIcon(const QPixmap &baseAvatar)
+{
+    if (baseAvatar.isNull()) {
+        return {};
+    }
+    const QPixmap circular = makeCircularAvatar(baseAvatar);
+    QIcon icon;
+    // pre-scaled variants: the account UI paints the avatar at small sizes and
+    // should not downscale the full-size image on every paint
+    for (int size : {16, 24, 32, 64}) {
+        icon.addPixmap(circular.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    }
+    icon.addPixmap(circular);
+    return icon;
+}
+
+QIcon AvatarJob::cachedAvatar(Account *account, const QString &userId, int size)
+{
+    QPixmap image;
+    if (!image.load(avatarCacheBasePath(account, userId, size) + QLatin1String(".png"))) {
+        return {};
+    }
+    return makeAvatarIcon(image);
+}
+
 void AvatarJob::finished()
 {
     int http_result_code = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
@@ -365,8 +618,21 @@ void AvatarJob::finished()
         if (pngData.size()) {
             if (avImage.loadFromData(pngData)) {
                 qCDebug(lcAvatarJob) << "Retrieved Avatar pixmap!";
+                // keep the image and its etag for the next session
+                QDir().mkpath(QFileInfo(_cacheBasePath).path());
+                QFile imageFile(_cacheBasePath + QLatin1String(".png"));
+                if (imageFile.open(QIODevice::WriteOnly)) {
+                    imageFile.write(pngData);
+                }
+                QFile etagFile(_cacheBasePath + QLatin1String(".etag"));
+                if (etagFile.open(QIODevice::WriteOnly)) {
+                    etagFile.write(reply()->rawHeader(QByteArrayLiteral("ETag")));
+                }
             }
         }
+    } else if (http_result_code == 304) {
+        qCDebug(lcAvatarJob) << "Avatar is unchanged, using the disk cache";
+        avImage.load(_cacheBasePath + QLatin1String(".png"));
     }
     Q_EMIT avatarPixmap(avImage);
 }
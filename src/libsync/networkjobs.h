@@ -18,8 +18,10 @@
 
 #include "abstractnetworkjob.h"
 #include "common/result.h"
+#include <QIcon>
 #include <QJsonObject>
 #include <QUrlQuery>
+#include <QXmlStreamReader>
 #include <functional>
 
 class QUrl;
@@ -63,12 +65,51 @@ class OWNCLOUDSYNC_EXPORT LsColXMLParser : public QObject
 public:
     explicit LsColXMLParser();
 
+    /** Parse a complete multistatus document in one go. */
     bool parse(const QByteArray &xml, QHash<QString, qint64> *sizes, const QString &expectedPath);
 
+    /** Streaming interface, used to parse the response as it arrives off the socket.
+     *
+     * Keeps the memory usage flat for huge listings because the response body
+     * is never buffered as a whole. startParsing() resets the parser, feed()
+     * consumes a chunk of data and emits directoryListingIterated() for every
+     * complete response element, endParsing() runs the final document checks
+     * and emits directoryListingSubfolders() and finishedWithoutError().
+     *
+     * feed() and endParsing() return false when the document is invalid; once
+     * that happened, further data is ignored.
+     */
+    void startParsing(QHash<QString, qint64> *sizes, const QString &expectedPath);
+    bool feed(const QByteArray &data);
+    bool endParsing();
+
 Q_SIGNALS:
     void directoryListingSubfolders(const QStringList &items);
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
     void finishedWithoutError();
+
+private:
+    bool processBuffered();
+
+    // What the accumulated _currentText belongs to
+    enum class TextCapture { None, Href, Status, Property };
+
+    QXmlStreamReader _reader;
+    QHash<QString, qint64> *_sizes = nullptr;
+    QString _expectedPath;
+    QStringList _folders;
+    QString _currentHref;
+    QString _currentText;
+    QString _currentPropertyName;
+    QMap<QString, QString> _currentTmpProperties;
+    QMap<QString, QString> _currentHttp200Properties;
+    TextCapture _capture = TextCapture::None;
+    int _propertyDepth = 0;
+    bool _currentPropsAreValid = false;
+    bool _insidePropstat = false;
+    bool _insideProp = false;
+    bool _insideMultiStatus = false;
+    bool _broken = false;
 };
 
 class OWNCLOUDSYNC_EXPORT PropfindJob : public AbstractNetworkJob
@@ -77,9 +118,11 @@ class OWNCLOUDSYNC_EXPORT PropfindJob : public AbstractNetworkJob
 public:
     enum class Depth {
         Zero,
-        One
+        One,
+        Infinity
     } Q_ENUMS(Depth);
     explicit PropfindJob(Account *account, const QUrl &url, const QString &path, Depth depth, QObject *parent = nullptr);
+    ~PropfindJob() override;
     void start() override;
 
     /**
@@ -104,11 +147,23 @@ Q_SIGNALS:
 
 private Q_SLOTS:
     void finished() override;
+    void slotReadyRead();
 
 private:
+    // Whether the reply headers allow streaming the body into the parser.
+    bool startStreamingIfPossible();
+
     QList<QByteArray> _properties;
     QHash<QString, qint64> _sizes;
+    /** The parser lives on a shared worker thread, see davParserThread().
+     *
+     * Chunks of the response body are handed over with queued calls, the
+     * parser's signals come back queued as well. Owned by this job, but
+     * deleted through deleteLater() so destruction happens on its thread.
+     */
+    LsColXMLParser *_parser;
     Depth _depth;
+    bool _parsingStarted = false;
 };
 
 
@@ -117,6 +172,9 @@ private:
  *
  * If the server does not have the avatar, the result Pixmap is empty.
  *
+ * The downloaded image is kept in the account's cache directory together with
+ * its etag; the next fetch is conditional and a 304 re-emits the cached image.
+ *
  * @ingroup libsync
  */
 class OWNCLOUDSYNC_EXPORT AvatarJob : public AbstractNetworkJob
@@ -134,6 +192,13 @@ public:
     /** The retrieved avatar images don't have the circle shape by default */
     static QPixmap makeCircularAvatar(const QPixmap &baseAvatar);
 
+    /** Builds the icon handed to Account::setAvatar: circular shape with
+     * pre-scaled variants so the UI doesn't rescale the full image on paint. */
+    static QIcon makeAvatarIcon(const QPixmap &baseAvatar);
+
+    /** The avatar a previous session cached on disk, a null icon when none exists. */
+    static QIcon cachedAvatar(Account *account, const QString &userId, int size);
+
 Q_SIGNALS:
     /**
      * @brief avatarPixmap - returns either a valid pixmap or not.
@@ -143,6 +208,10 @@ Q_SIGNALS:
 
 private Q_SLOTS:
     void finished() override;
+
+private:
+    /// Base path of the cached image and its etag sidecar file
+    QString _cacheBasePath;
 };
 
 /**
@@ -177,6 +246,18 @@ public:
 
     const QString &etag() const;
 
+    /**
+     * Fetches the etag of a single resource, coalescing identical requests.
+     *
+     * Discovery's rename checks and the folder polls can ask for the same
+     * URL within seconds of each other; concurrent calls for one URL share
+     * a single PROPFIND on the wire and the result fans out to every
+     * callback. The callback receives the HTTP status code and the etag
+     * (empty on error), and only runs while context is alive.
+     */
+    static void fetch(Account *account, const QUrl &rootUrl, const QString &path,
+        const QObject *context, const std::function<void(int statusCode, const QString &etag)> &callback);
+
 private:
     QString _etag;
 };
@@ -17,7 +17,9 @@
 #include "account.h"
 #include "common/asserts.h"
 #include "common/syncjournaldb.h"
+#include "common/metrics.h"
 #include "common/syncjournalfilerecord.h"
+#include "common/tracer.h"
 #include "common/utility.h"
 #include "discoveryphase.h"
 #include "filesystem.h"
@@ -28,6 +30,8 @@
 #include "propagateuploadfile.h"
 #include "propagateuploadtus.h"
 #include "propagatorjobs.h"
+#include "placeholderbatcher.h"
+#include "uploadbundler.h"
 #include "vio/csync_vio_local.h"
 
 #ifdef Q_OS_WIN
@@ -45,6 +49,36 @@
 
 using namespace std::chrono_literals;
 
+namespace {
+
+// process-wide metrics, see common/metrics.h; folders propagate one at a
+// time so the gauges describe the currently running sync
+OCC::Metrics::Gauge &activeJobsGauge()
+{
+    static OCC::Metrics::Gauge gauge("propagator.activeJobs");
+    return gauge;
+}
+
+OCC::Metrics::Gauge &queuedItemsGauge()
+{
+    static OCC::Metrics::Gauge gauge("propagator.queuedItems");
+    return gauge;
+}
+
+OCC::Metrics::Counter &bytesDownCounter()
+{
+    static OCC::Metrics::Counter counter("propagator.bytesDown");
+    return counter;
+}
+
+OCC::Metrics::Counter &bytesUpCounter()
+{
+    static OCC::Metrics::Counter counter("propagator.bytesUp");
+    return counter;
+}
+
+} // anonymous namespace
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcPropagator, "sync.propagator", QtInfoMsg)
@@ -79,7 +113,9 @@ qint64 freeSpaceLimit()
 int OwncloudPropagator::maximumActiveTransferJob()
 {
     if (!_syncOptions._parallelNetworkJobs) {
-        // disable parallelism when there is a network limit.
+        // Parallelism explicitly disabled. Rate caps no longer need this:
+        // the account's BandwidthLimiter paces parallel transfers under a
+        // shared budget.
         return 1;
     }
     return qMin(3, qCeil(_syncOptions._parallelNetworkJobs / 2.));
@@ -96,6 +132,7 @@ int OwncloudPropagator::hardMaximumActiveJob()
 PropagateItemJob::~PropagateItemJob()
 {
     if (auto p = propagator()) {
+        p->releaseExclusivePaths(_claimedPaths);
         // Normally, every job should clean itself from the _activeJobList. So this should not be
         // needed. But if a job has a bug or is deleted before the network jobs signal get received,
         // we might risk end up with dangling pointer in the list which may cause crashes.
@@ -103,14 +140,34 @@ PropagateItemJob::~PropagateItemJob()
     }
 }
 
+QStringList PropagateItemJob::affectedPaths() const
+{
+    QStringList paths{_item->destination()};
+    if (!_item->_file.isEmpty() && !paths.contains(_item->_file)) {
+        paths.append(_item->_file);
+    }
+    if (!_item->_originalFile.isEmpty() && !paths.contains(_item->_originalFile)) {
+        paths.append(_item->_originalFile);
+    }
+    return paths;
+}
+
 bool PropagateItemJob::scheduleSelfOrChild()
 {
     if (state() != NotYetStarted) {
         return false;
     }
+    // A running directory rename may have claimed one of the subtrees this
+    // job touches; stay queued until the rename releases it.
+    if (propagator()->isBlockedByExclusivePaths(affectedPaths())) {
+        return false;
+    }
     qCInfo(lcPropagator) << "Starting propagation of" << _item << "by" << this;
 
     setState(Running);
+    _runTimer.reset();
+    _claimedPaths = exclusivePaths();
+    propagator()->claimExclusivePaths(_claimedPaths);
     if (thread() != QApplication::instance()->thread()) {
         QMetaObject::invokeMethod(this, &PropagateItemJob::start); // We could be in a different thread (neon jobs)
     } else {
@@ -225,6 +282,40 @@ void PropagateItemJob::done(SyncFileItem::Status statusArg, const QString &error
     OC_ENFORCE(state() != Finished);
     setState(Finished);
 
+    if (isLikelyFinishedQuickly()) {
+        propagator()->reportSmallJobDuration(_runTimer.duration());
+    }
+    _item->_jobDuration = _runTimer.duration();
+    {
+        // The job ran asynchronously, so trace it as one completed span
+        // backdated by its runtime instead of a scoped OC_TRACE_SPAN.
+        const qint64 durationUs = std::chrono::duration_cast<std::chrono::microseconds>(_runTimer.duration()).count();
+        Tracer::record("propagation", metaObject()->className(), Tracer::nowUs() - durationUs, durationUs);
+    }
+    queuedItemsGauge().add(-1);
+    // Count transferred payload; deletes, renames and metadata updates carry
+    // a size but move no file content.
+    const auto instruction = _item->instruction();
+    if (statusArg == SyncFileItem::Success && !_item->isDirectory()
+        && (instruction == CSYNC_INSTRUCTION_NEW || instruction == CSYNC_INSTRUCTION_SYNC || instruction == CSYNC_INSTRUCTION_CONFLICT
+            || instruction == CSYNC_INSTRUCTION_TYPE_CHANGE)) {
+        if (_item->_direction == SyncFileItem::Down) {
+            bytesDownCounter().add(_item->_size);
+        } else if (_item->_direction == SyncFileItem::Up) {
+            bytesUpCounter().add(_item->_size);
+        }
+    }
+    propagator()->reportJobCompletion(_item->_httpErrorCode);
+    // Keep the cached free-space figure roughly current between refreshes.
+    if (_item->_direction == SyncFileItem::Down && !_item->isDirectory()
+        && (statusArg == SyncFileItem::Success || statusArg == SyncFileItem::Conflict)) {
+        propagator()->recordDiskSpaceConsumed(_item->_size);
+    }
+    if (!_claimedPaths.isEmpty()) {
+        propagator()->releaseExclusivePaths(_claimedPaths);
+        _claimedPaths.clear();
+    }
+
     _item->_status = statusArg;
 
     if (_item->_isRestoration) {
@@ -305,7 +396,7 @@ void PropagateItemJob::done(SyncFileItem::Status statusArg, const QString &error
         // we don't notify itemCompleted yet as the directory is only complete once its child items are complete.
         _item->_relevantDirectoyInstruction = true;
     }
-    Q_EMIT finished(_item->_status);
+    notifyFinished(_item->_status);
     if (_item->_status == SyncFileItem::FatalError) {
         // Abort all remaining jobs.
         propagator()->abort();
@@ -389,6 +480,8 @@ qint64 OwncloudPropagator::smallFileSize()
  */
 void OwncloudPropagator::start(SyncFileItemSet &&items)
 {
+    queuedItemsGauge().set(qint64(items.size()));
+
     // The items list is sorted in such a way that an item for a directory come before any items
     // inside that directory. For example:
     //  - A       <--- directory
@@ -401,6 +494,19 @@ void OwncloudPropagator::start(SyncFileItemSet &&items)
 
     _rootJob.reset(new PropagateRootDirectory(this));
 
+    if (Utility::fsCasePreservingButCaseInsensitive()) {
+        // Index every name known to exist locally for the case-clash
+        // pre-filter, see localFileNameClash(). If the journal scan fails the
+        // index stays invalid and every check falls back to probing.
+        for (const auto &item : std::as_const(items)) {
+            addToCaseClashIndex(item->_file);
+            addToCaseClashIndex(item->_renameTarget);
+        }
+        _caseClashIndexValid = _journal->getFilesBelowPath(QByteArrayLiteral(""), [this](const SyncJournalFileRecord &rec) {
+            addToCaseClashIndex(QString::fromUtf8(rec._path));
+        });
+    }
+
     // The algorithm could be done recursively, but the implementation is done iteratively in order
     // to prevent us running out of stack space. So the next 3 variables are used to maintain the
     // state.
@@ -424,33 +530,45 @@ void OwncloudPropagator::start(SyncFileItemSet &&items)
     //  - etc.
     // So when we find a have a sync instruction to remove a directory, we remember it in the
     // `currentRemoveDirectoryJob` variable, so we know/see it when processing the next item
-    // in the list.
+    // in the list. This is what coalesces the removal of a whole subtree into a single
+    // recursive DELETE: the children never get their own network jobs.
     PropagatorJob *currentRemoveDirectoryJob = nullptr;
+    // The same job as a PropagateDirectory, when it is one; cast once here instead of
+    // once per skipped child (a deleted tree can have tens of thousands of them).
+    PropagateDirectory *currentRemoveDirectoryDirJob = nullptr;
 
     // We skip items inside conflict directories. So, when we see an item that's marked as such,
     // remember its name to see if in the next iteration, we will hit an item for that directory.
     // See the `else` statement in the second step.
     QString maybeConflictDirectory;
 
-    for (const auto &item : std::as_const(items)) {
+    // Items are handed over node by node: extracting from the input set and
+    // inserting the node into the per-directory task set reuses the node
+    // allocation instead of copying the pointer and freeing the source set
+    // afterwards. Extraction does not move the element, so `item` stays
+    // valid for the rest of the iteration either way.
+    while (!items.empty()) {
+        auto node = items.extract(items.begin());
+        const SyncFileItemPtr &item = node.value();
+
         // First check if this is an item in a directory which is going to be removed.
         if (currentRemoveDirectoryJob && FileSystem::isChildPathOf(item->_file, currentRemoveDirectoryJob->path())) {
             // Check the sync instruction for the item:
             if (item->instruction() == CSYNC_INSTRUCTION_REMOVE) {
                 // already taken care of. (by the removal of the parent directory)
 
-                if (auto delDirJob = qobject_cast<PropagateDirectory *>(currentRemoveDirectoryJob)) {
+                if (currentRemoveDirectoryDirJob) {
                     // increase the number of sub jobs that would be there.
-                    delDirJob->increaseAffectedCount();
+                    currentRemoveDirectoryDirJob->increaseAffectedCount();
                 }
                 continue;
             } else if (item->isDirectory() && (item->instruction() & (CSYNC_INSTRUCTION_NEW | CSYNC_INSTRUCTION_TYPE_CHANGE))) {
                 // Create a new directory within a deleted directory? That can happen if the directory
                 // etag was not fetched properly on the previous sync because the sync was aborted
                 // while uploading this directory (which is now removed).  We can ignore it.
-                if (auto delDirJob = qobject_cast<PropagateDirectory *>(currentRemoveDirectoryJob)) {
+                if (currentRemoveDirectoryDirJob) {
                     // increase the number of sub jobs that would be there.
-                    delDirJob->increaseAffectedCount();
+                    currentRemoveDirectoryDirJob->increaseAffectedCount();
                 }
                 continue;
             } else if (item->instruction() & (CSYNC_INSTRUCTION_IGNORE | CSYNC_INSTRUCTION_NONE)) {
@@ -498,8 +616,10 @@ void OwncloudPropagator::start(SyncFileItemSet &&items)
                 // checkForPermissions() has already run and used the permissions
                 // of the file we're about to delete to decide whether uploading
                 // to the new dir is ok...
+                // The children sort after their directory, so they are all
+                // still in the input set (the current item is not).
                 for (const auto &item2 : std::as_const(items)) {
-                    if (item2 != item && FileSystem::isChildPathOf(item2->destination(), item->destination())) {
+                    if (FileSystem::isChildPathOf(item2->destination(), item->destination())) {
                         item2->setInstruction(CSYNC_INSTRUCTION_NONE);
                         _anotherSyncNeeded = true;
                     }
@@ -510,6 +630,7 @@ void OwncloudPropagator::start(SyncFileItemSet &&items)
                 // We do the removal of directories at the end, because there might be moves from
                 // these directories that will happen later.
                 currentRemoveDirectoryJob = dir;
+                currentRemoveDirectoryDirJob = dir;
                 _rootJob->addDeleteJob(currentRemoveDirectoryJob);
 
                 // We should not update the etag of parent directories of the removed directory
@@ -532,9 +653,10 @@ void OwncloudPropagator::start(SyncFileItemSet &&items)
             if (item->instruction() == CSYNC_INSTRUCTION_TYPE_CHANGE) {
                 // will delete directories, so defer execution
                 currentRemoveDirectoryJob = createJob(item);
+                currentRemoveDirectoryDirJob = nullptr;
                 _rootJob->addDeleteJob(currentRemoveDirectoryJob);
             } else {
-                directories.top().second->appendTask(item);
+                directories.top().second->appendTask(std::move(node));
             }
 
             if (item->instruction() == CSYNC_INSTRUCTION_CONFLICT) {
@@ -547,6 +669,11 @@ void OwncloudPropagator::start(SyncFileItemSet &&items)
 
     connect(_rootJob.data(), &PropagatorJob::finished, this, &OwncloudPropagator::emitFinished);
 
+    // Collapse the many sequential setFileRecord() calls from job completion
+    // paths into multi-row statements. emitFinished() turns this off again,
+    // which flushes any queued records.
+    _journal->setWriteBatchingEnabled(true);
+
     _jobScheduled = false;
     scheduleNextJob();
 }
@@ -556,10 +683,41 @@ const SyncOptions &OwncloudPropagator::syncOptions() const
     return _syncOptions;
 }
 
+QString OwncloudPropagator::caseClashKey(const QString &relPath)
+{
+    // APFS and NTFS ignore case; APFS additionally ignores normalization.
+    return relPath.normalized(QString::NormalizationForm_C).toCaseFolded();
+}
+
+void OwncloudPropagator::addToCaseClashIndex(const QString &relPath)
+{
+    if (relPath.isEmpty())
+        return;
+    const QString key = caseClashKey(relPath);
+    const auto it = _caseFoldedNames.constFind(key);
+    if (it == _caseFoldedNames.cend()) {
+        _caseFoldedNames.insert(key, relPath);
+    } else if (*it != relPath) {
+        _caseClashCandidates.insert(key);
+    }
+}
+
+void OwncloudPropagator::recordNameForCaseClashCheck(const QString &relPath)
+{
+    if (Utility::fsCasePreservingButCaseInsensitive()) {
+        addToCaseClashIndex(relPath);
+    }
+}
+
 Result<QString, bool> OwncloudPropagator::localFileNameClash(const QString &relFile)
 {
     OC_ASSERT(!relFile.isEmpty());
     if (!relFile.isEmpty() && Utility::fsCasePreservingButCaseInsensitive()) {
+        if (_caseClashIndexValid && !_caseClashCandidates.contains(caseClashKey(relFile))) {
+            // No known local name folds onto this one: there is nothing that
+            // could clash, skip the filesystem probe.
+            return false;
+        }
         const QFileInfo fileInfo(_localDir + relFile);
 #ifdef Q_OS_MAC
         // APFS is case preserving but case ignoring. It is also normalization preserving and normalization ignoring.
@@ -599,7 +757,7 @@ Result<QString, bool> OwncloudPropagator::localFileNameClash(const QString &relF
             const QString realFileName = QString::fromWCharArray(FindFileData.cFileName);
 
             if (!fileInfo.filePath().endsWith(realFileName, Qt::CaseSensitive)) {
-                const QString clashName = fileInfo.path() + QLatin1Char('/') + realFileName;
+                const QString clashName = Utility::joinPath(fileInfo.path(), realFileName);
                 qCWarning(lcPropagator) << "Detected case clash between" << fileInfo.filePath() << "and" << clashName;
                 return clashName;
             }
@@ -620,6 +778,9 @@ Result<QString, bool> OwncloudPropagator::localFileNameClash(const QString &relF
 bool OwncloudPropagator::hasCaseClashAccessibilityProblem(const QString &relfile)
 {
 #ifdef Q_OS_WIN
+    if (_caseClashIndexValid && !_caseClashCandidates.contains(caseClashKey(relfile))) {
+        return false;
+    }
     bool result = false;
     const QString file(_localDir + relfile);
     WIN32_FIND_DATA FindFileData;
@@ -664,30 +825,163 @@ void OwncloudPropagator::scheduleNextJob()
     QTimer::singleShot(0, this, &OwncloudPropagator::scheduleNextJobImpl);
 }
 
+/** Whether two folder-relative paths are equal or one is an ancestor of the other. */
+static bool pathsRelated(const QString &a, const QString &b)
+{
+    if (a.size() == b.size()) {
+        return a == b;
+    }
+    const QString &shorter = a.size() < b.size() ? a : b;
+    const QString &longer = a.size() < b.size() ? b : a;
+    return longer.startsWith(shorter) && longer.at(shorter.size()) == QLatin1Char('/');
+}
+
+bool OwncloudPropagator::isBlockedByExclusivePaths(const QStringList &paths) const
+{
+    for (const QString &claimed : _exclusivePaths) {
+        for (const QString &path : paths) {
+            if (pathsRelated(claimed, path)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void OwncloudPropagator::claimExclusivePaths(const QStringList &paths)
+{
+    _exclusivePaths += paths;
+}
+
+void OwncloudPropagator::releaseExclusivePaths(const QStringList &paths)
+{
+    if (paths.isEmpty()) {
+        return;
+    }
+    for (const QString &path : paths) {
+        _exclusivePaths.removeOne(path);
+    }
+    // A queued job may have been waiting for exactly these paths.
+    scheduleNextJob();
+}
+
+void OwncloudPropagator::prioritizePath(const QString &relPath)
+{
+    if (_priorityPaths.contains(relPath)) {
+        return;
+    }
+    qCInfo(lcPropagator) << "Prioritizing" << relPath;
+    _priorityPaths.append(relPath);
+}
+
+bool OwncloudPropagator::isPrioritizedPath(const QString &relPath) const
+{
+    for (const QString &priority : _priorityPaths) {
+        if (pathsRelated(priority, relPath)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OwncloudPropagator::scheduleDirectorySync(const QString &absolutePath)
+{
+    static const bool enabled = qEnvironmentVariableIntValue("OWNCLOUD_DOWNLOAD_DIR_SYNC") > 0;
+    if (!enabled) {
+        return;
+    }
+    _pendingDirectorySyncs.insert(absolutePath);
+    // Keep batches bounded so a crash loses at most one batch worth of
+    // rename metadata.
+    constexpr int directorySyncBatchSize = 64;
+    if (_pendingDirectorySyncs.size() >= directorySyncBatchSize) {
+        flushScheduledDirectorySyncs();
+    }
+}
+
+void OwncloudPropagator::flushScheduledDirectorySyncs()
+{
+    for (const QString &dir : std::as_const(_pendingDirectorySyncs)) {
+        FileSystem::syncDirectory(dir);
+    }
+    _pendingDirectorySyncs.clear();
+}
+
+void OwncloudPropagator::reportSmallJobDuration(std::chrono::nanoseconds duration)
+{
+    // Exponential moving average: cheap, and stale samples age out after a
+    // handful of finished jobs.
+    _smallJobDurationAvg = (3 * _smallJobDurationAvg + duration) / 4;
+}
+
+int OwncloudPropagator::effectiveHardJobLimit()
+{
+    if (_adaptiveJobLimit < 0) {
+        return hardMaximumActiveJob();
+    }
+    return qBound(maximumActiveTransferJob(), _adaptiveJobLimit, hardMaximumActiveJob());
+}
+
+void OwncloudPropagator::reportJobCompletion(quint16 httpErrorCode)
+{
+    // AIMD: halve the allowed concurrency when the server signals overload,
+    // inch it back up once a steady run of jobs went through cleanly. A
+    // static limit is always wrong against a server pool whose capacity
+    // varies through the day.
+    if (httpErrorCode == 503 || httpErrorCode == 429) {
+        const int reduced = qMax(maximumActiveTransferJob(), effectiveHardJobLimit() / 2);
+        if (reduced != effectiveHardJobLimit()) {
+            qCInfo(lcPropagator) << "Server asks to back off (HTTP" << httpErrorCode
+                                 << "), reducing the parallel job limit to" << reduced;
+        }
+        _adaptiveJobLimit = reduced;
+        _completionsSinceLimitChange = 0;
+    } else if (_adaptiveJobLimit >= 0 && _adaptiveJobLimit < hardMaximumActiveJob()
+        && ++_completionsSinceLimitChange >= 10) {
+        _adaptiveJobLimit++;
+        _completionsSinceLimitChange = 0;
+        qCDebug(lcPropagator) << "No throttling seen for a while, raising the parallel job limit to" << _adaptiveJobLimit;
+    }
+}
+
 void OwncloudPropagator::scheduleNextJobImpl()
 {
-    // TODO: If we see that the automatic up-scaling has a bad impact we
-    // need to check how to avoid this.
-    // Down-scaling on slow networks? https://github.com/owncloud/client/issues/3382
-    // Making sure we do up/down at same time? https://github.com/owncloud/client/issues/1633
+    // TODO: Making sure we do up/down at same time? https://github.com/owncloud/client/issues/1633
 
     _jobScheduled = false;
+    activeJobsGauge().set(_activeJobList.count());
+
+    // Once an abort was requested nothing new may start: the queued work is
+    // being dropped and only the in-flight jobs still wind down.
+    if (_abortRequested) {
+        return;
+    }
 
     if (_activeJobList.count() < maximumActiveTransferJob()) {
         if (_rootJob->scheduleSelfOrChild()) {
             scheduleNextJob();
         }
-    } else if (_activeJobList.count() < hardMaximumActiveJob()) {
+    } else if (_activeJobList.count() < effectiveHardJobLimit()) {
         int likelyFinishedQuicklyCount = 0;
-        // NOTE: Only counts the first 3 jobs! Then for each
-        // one that is likely finished quickly, we can launch another one.
-        // When a job finishes another one will "move up" to be one of the first 3 and then
-        // be counted too.
-        for (int i = 0; i < maximumActiveTransferJob() && i < _activeJobList.count(); i++) {
-            if (_activeJobList.at(i)->isLikelyFinishedQuickly()) {
+        // Every running job that is likely finished quickly (small
+        // transfers, deletes, mkdirs) gives its slot back soon, so each of
+        // them may admit one extra job: a propagation list full of small
+        // files fans out to effectiveHardJobLimit() while a few large
+        // streams keep the parallelism at the base level.
+        for (auto *job : std::as_const(_activeJobList)) {
+            if (job->isLikelyFinishedQuickly()) {
                 likelyFinishedQuicklyCount++;
             }
         }
+        // On a slow connection even small jobs hold on to their slot for a
+        // while. Scale the bonus back when the durations observed for
+        // recently finished small jobs say that "quickly" does not hold
+        // right now (issue #3382).
+        if (_smallJobDurationAvg > 5s) {
+            likelyFinishedQuicklyCount = 0;
+        } else if (_smallJobDurationAvg > 1s) {
+            likelyFinishedQuicklyCount /= 2;
+        }
         if (_activeJobList.count() < maximumActiveTransferJob() + likelyFinishedQuicklyCount) {
             qCDebug(lcPropagator) << "Can pump in another request! activeJobs =" << _activeJobList.count();
             if (_rootJob->scheduleSelfOrChild()) {
@@ -738,7 +1032,17 @@ Account *OwncloudPropagator::account() const
 
 OwncloudPropagator::DiskSpaceResult OwncloudPropagator::diskSpaceCheck() const
 {
-    const qint64 freeBytes = Utility::freeDiskSpace(_localDir);
+    // One statvfs per interval instead of one per job start. Space consumed
+    // by our own finishing downloads is subtracted via
+    // recordDiskSpaceConsumed(); space claimed by other applications is
+    // only seen on the next refresh.
+    static const auto freeSpaceRefreshInterval = 5s;
+    const auto now = std::chrono::steady_clock::now();
+    if (_cachedFreeBytes < 0 || now - _cachedFreeBytesRefreshed > freeSpaceRefreshInterval) {
+        _cachedFreeBytes = Utility::freeDiskSpace(_localDir);
+        _cachedFreeBytesRefreshed = now;
+    }
+    const qint64 freeBytes = _cachedFreeBytes;
     if (freeBytes < 0) {
         return DiskSpaceOk;
     }
@@ -754,6 +1058,29 @@ OwncloudPropagator::DiskSpaceResult OwncloudPropagator::diskSpaceCheck() const
     return DiskSpaceOk;
 }
 
+void OwncloudPropagator::recordDiskSpaceConsumed(qint64 bytes)
+{
+    if (_cachedFreeBytes > 0 && bytes > 0) {
+        _cachedFreeBytes = qMax(qint64(0), _cachedFreeBytes - bytes);
+    }
+}
+
+UploadBundler *OwncloudPropagator::uploadBundler()
+{
+    if (!_uploadBundler) {
+        _uploadBundler = new UploadBundler(this);
+    }
+    return _uploadBundler;
+}
+
+PlaceholderBatcher *OwncloudPropagator::placeholderBatcher()
+{
+    if (!_placeholderBatcher) {
+        _placeholderBatcher = new PlaceholderBatcher(this);
+    }
+    return _placeholderBatcher;
+}
+
 bool OwncloudPropagator::createConflict(const SyncFileItemPtr &item, QString *error)
 {
     QString fn = fullLocalPath(item->_file);
@@ -828,6 +1155,14 @@ Result<Vfs::ConvertToPlaceholderResult, QString> OwncloudPropagator::updatePlace
 Result<Vfs::ConvertToPlaceholderResult, QString> OwncloudPropagator::updateMetadata(const SyncFileItem &item)
 {
     const QString fsPath = fullLocalPath(item.destination());
+    // Log dehydrations in the vfs intent log: between updating the on-disk
+    // placeholder and the journal write below the two disagree, and a crash
+    // in that window is repaired by replaying the entry on the next start
+    // instead of re-verifying the whole tree.
+    const bool logVfsIntent = item._type == ItemTypeVirtualFileDehydration;
+    if (logVfsIntent) {
+        _journal->setVfsIntent(item.destination().toUtf8(), SyncJournalDb::VfsIntentOp::Dehydrate);
+    }
     const auto result = updatePlaceholder(item, fsPath, {});
     if (!result) {
         return result;
@@ -841,6 +1176,9 @@ Result<Vfs::ConvertToPlaceholderResult, QString> OwncloudPropagator::updateMetad
     if (!dBresult) {
         return dBresult.error();
     }
+    if (logVfsIntent) {
+        _journal->removeVfsIntent(item.destination().toUtf8());
+    }
     return Vfs::ConvertToPlaceholderResult::Ok;
 }
 
@@ -865,6 +1203,15 @@ OwncloudPropagator *PropagatorJob::propagator() const
     return _propagator;
 }
 
+void PropagatorJob::notifyFinished(SyncFileItem::Status status)
+{
+    if (_associatedComposite) {
+        _associatedComposite->childJobFinished(this, status);
+    } else {
+        Q_EMIT finished(status);
+    }
+}
+
 // ================================================================================
 
 PropagatorJob::JobParallelism PropagatorCompositeJob::parallelism()
@@ -924,8 +1271,19 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
     // Now it's our turn, check if we have something left to do.
     // First, convert a task to a job if necessary
     while (_jobsToDo.empty() && !_tasksToDo.empty()) {
-        const SyncFileItemPtr nextTask = *_tasksToDo.begin();
-        _tasksToDo.erase(_tasksToDo.begin());
+        auto nextTaskIt = _tasksToDo.begin();
+        // A prioritized task (e.g. a file the user just clicked) jumps
+        // ahead of its siblings.
+        if (propagator()->hasPrioritizedPaths()) {
+            for (auto it = _tasksToDo.begin(); it != _tasksToDo.end(); ++it) {
+                if (propagator()->isPrioritizedPath((*it)->destination())) {
+                    nextTaskIt = it;
+                    break;
+                }
+            }
+        }
+        const SyncFileItemPtr nextTask = *nextTaskIt;
+        _tasksToDo.erase(nextTaskIt);
         PropagatorJob *job = propagator()->createJob(nextTask);
         if (!job) {
             qCWarning(lcDirectory) << "Useless task found for file" << nextTask->destination() << "instruction" << nextTask->instruction();
@@ -936,8 +1294,26 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
     }
     // Then run the next job
     if (!_jobsToDo.isEmpty()) {
-        PropagatorJob *nextJob = _jobsToDo.first();
-        _jobsToDo.remove(0);
+        int nextIndex = 0;
+        // Same as for the tasks above: prioritized jobs (and the composite
+        // jobs leading down to them) come first.
+        if (propagator()->hasPrioritizedPaths()) {
+            for (int i = 0; i < _jobsToDo.size(); ++i) {
+                if (propagator()->isPrioritizedPath(_jobsToDo.at(i)->path())) {
+                    nextIndex = i;
+                    break;
+                }
+            }
+        }
+        PropagatorJob *nextJob = _jobsToDo.at(nextIndex);
+        // Leave a blocked job queued: entries of _runningJobs must be
+        // running, and the order within this composite has to hold.
+        if (auto *itemJob = qobject_cast<PropagateItemJob *>(nextJob)) {
+            if (propagator()->isBlockedByExclusivePaths(itemJob->affectedPaths())) {
+                return false;
+            }
+        }
+        _jobsToDo.remove(nextIndex);
         _runningJobs.append(nextJob);
         return possiblyRunNextJob(nextJob);
     }
@@ -952,9 +1328,8 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
     return false;
 }
 
-void PropagatorCompositeJob::slotSubJobFinished(SyncFileItem::Status status)
+void PropagatorCompositeJob::childJobFinished(PropagatorJob *subJob, SyncFileItem::Status status)
 {
-    PropagatorJob *subJob = static_cast<PropagatorJob *>(sender());
     OC_ASSERT(subJob);
 
     // Delete the job and remove it from our list of jobs.
@@ -994,7 +1369,7 @@ void PropagatorCompositeJob::finalize()
         return;
 
     setState(Finished);
-    Q_EMIT finished(_errorPaths.empty() ? SyncFileItem::Success : _errorPaths.last());
+    notifyFinished(_errorPaths.empty() ? SyncFileItem::Success : _errorPaths.last());
 }
 
 qint64 PropagatorCompositeJob::committedDiskSpace() const
@@ -1137,18 +1512,18 @@ void PropagateDirectory::slotSubJobsFinished(const SyncFileItem::Status status)
     // and we don't want error handling for this folder for an error that happened on a child
     Q_ASSERT(state() != Finished);
     setState(Finished);
-    Q_EMIT finished(status);
+    notifyFinished(status);
     if (_item->_relevantDirectoyInstruction) {
         Q_EMIT propagator()->itemCompleted(_item);
     }
 }
 
 PropagateRootDirectory::PropagateRootDirectory(OwncloudPropagator *propagator)
-    : PropagateDirectory(propagator, SyncFileItemPtr([] {
-        auto f = new SyncFileItem;
+    : PropagateDirectory(propagator, [] {
+        auto f = SyncFileItemPtr::create();
         f->_file = QLatin1Char('/');
         return f;
-    }()))
+    }())
     , _dirDeletionJobs(propagator, path())
 {
     connect(&_dirDeletionJobs, &PropagatorJob::finished, this, &PropagateRootDirectory::slotDirDeletionJobsFinished);
@@ -1242,7 +1617,7 @@ void PropagateRootDirectory::slotSubJobsFinished(SyncFileItem::Status status)
                                          return false;
                                      }),
                     deleteJobs.end());
-                _dirDeletionJobs.setJobsToDo(deleteJobs);
+                _dirDeletionJobs.setJobsToDo(std::move(deleteJobs));
             }
         }
     }
@@ -1252,7 +1627,7 @@ void PropagateRootDirectory::slotSubJobsFinished(SyncFileItem::Status status)
 void PropagateRootDirectory::slotDirDeletionJobsFinished(SyncFileItem::Status status)
 {
     setState(Finished);
-    Q_EMIT finished(_status != SyncFileItem::NoStatus ? _status : status);
+    notifyFinished(_status != SyncFileItem::NoStatus ? _status : status);
 }
 
 void PropagateRootDirectory::addDeleteJob(PropagatorJob *job)
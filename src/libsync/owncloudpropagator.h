@@ -20,13 +20,18 @@
 
 #include <QHash>
 #include <QMap>
+#include <QSet>
 #include <QTimer>
 
+#include <utility>
+
 #include "account.h"
+#include "common/chronoelapsedtimer.h"
 #include "common/syncjournaldb.h"
 #include "csync.h"
 #include "syncfileitem.h"
 #include "syncoptions.h"
+#include "transfermetrics.h"
 
 namespace OCC {
 
@@ -45,7 +50,9 @@ qint64 freeSpaceLimit();
 
 class SyncJournalDb;
 class OwncloudPropagator;
+class PlaceholderBatcher;
 class PropagatorCompositeJob;
+class UploadBundler;
 
 /**
  * @brief the base class of propagator jobs
@@ -106,6 +113,14 @@ public:
 
     const QString path() { return _path; }
 
+    /** Registers the composite that owns this job as a child.
+     *
+     * Registered jobs report their completion through a direct call to
+     * PropagatorCompositeJob::childJobFinished() instead of the finished()
+     * signal, see notifyFinished().
+     */
+    void setAssociatedComposite(PropagatorCompositeJob *composite) { _associatedComposite = composite; }
+
 public Q_SLOTS:
     /*
      * Asynchronous abort requires Q_EMIT of abortFinished() signal,
@@ -134,10 +149,21 @@ Q_SIGNALS:
 protected:
     OwncloudPropagator *propagator() const;
 
+    /** Reports completion to whoever owns this job.
+     *
+     * Jobs owned by a composite call into it directly; per item that skips a
+     * signal emission, which adds up with hundreds of thousands of small
+     * items. Everything else - the root job and the composite members of the
+     * directory jobs - still emits finished(), the boundary the engine and
+     * the GUI connect to.
+     */
+    void notifyFinished(SyncFileItem::Status status);
+
 private:
     OwncloudPropagator *_propagator;
     QString _path;
     JobState _jobState;
+    PropagatorCompositeJob *_associatedComposite = nullptr;
 };
 
 /*
@@ -150,6 +176,14 @@ protected:
     virtual void done(SyncFileItem::Status status, const QString &errorString = QString());
 
     SyncFileItemPtr _item;
+
+    /// Reset when the job starts running; reports the observed duration of
+    /// "likely finished quickly" jobs back to the scheduler.
+    Utility::ChronoElapsedTimer _runTimer;
+
+    /// The exclusivePaths() claimed on start, released again in done().
+    QStringList _claimedPaths;
+
     friend class PropagateDirectory;
 
 public:
@@ -161,6 +195,20 @@ public:
     ~PropagateItemJob() override;
     bool scheduleSelfOrChild() override;
 
+    /** The paths this job touches: the destination, plus the source paths
+     * for renames. Compared against the claims of running directory
+     * renames before the job may start.
+     */
+    QStringList affectedPaths() const;
+
+    /** Paths this job needs exclusive use of while it runs.
+     *
+     * A directory rename shifts every path below its source and target;
+     * jobs touching either subtree have to wait for it, while unrelated
+     * subtrees may keep going. Default: none.
+     */
+    virtual QStringList exclusivePaths() const { return {}; }
+
     const SyncFileItem &item() const { return *_item.data(); }
 public Q_SLOTS:
     virtual void start() = 0;
@@ -184,9 +232,16 @@ public:
     }
 
     void appendJob(PropagatorJob *job);
-    void appendTask(const SyncFileItemPtr &item)
+
+    /** Takes over a node extracted from the propagator's input set.
+     *
+     * Moving the node instead of copying the item pointer reuses the set
+     * node allocation and skips the reference count round-trip; with large
+     * syncs that is one saved allocation per file.
+     */
+    void appendTask(SyncFileItemSet::node_type &&node)
     {
-        _tasksToDo.insert(item);
+        _tasksToDo.insert(std::move(node));
     }
 
     bool scheduleSelfOrChild() override;
@@ -199,6 +254,11 @@ public:
      */
     void abort(PropagatorJob::AbortType abortType) override
     {
+        // Jobs that never started need no abort handshake. Dropping them
+        // wholesale cancels the bulk of a large sync in one step; their
+        // QObject parent remains responsible for the cleanup.
+        _jobsToDo.clear();
+        _tasksToDo.clear();
         if (!_runningJobs.empty()) {
             _abortsCount = _runningJobs.size();
             for (auto *j : std::as_const(_runningJobs)) {
@@ -218,19 +278,26 @@ public:
     QMap<QString, SyncFileItem::Status> errorPaths() const { return _errorPaths; }
 
     const QVector<PropagatorJob *> &jobsToDo() { return _jobsToDo; }
-    void setJobsToDo(const QVector<PropagatorJob *> &todo) { _jobsToDo = todo; }
+    void setJobsToDo(QVector<PropagatorJob *> todo) { _jobsToDo = std::move(todo); }
+
+    /** Called directly by a child job's notifyFinished().
+     *
+     * The direct call replaces the former finished() signal connection; the
+     * per-item emission overhead was measurable on syncs with very many
+     * small items.
+     */
+    void childJobFinished(PropagatorJob *subJob, SyncFileItem::Status status);
 
 private Q_SLOTS:
     void slotSubJobAbortFinished();
     bool possiblyRunNextJob(PropagatorJob *next)
     {
         if (next->state() == NotYetStarted) {
-            connect(next, &PropagatorJob::finished, this, &PropagatorCompositeJob::slotSubJobFinished);
+            next->setAssociatedComposite(this);
         }
         return next->scheduleSelfOrChild();
     }
 
-    void slotSubJobFinished(SyncFileItem::Status status);
     void finalize();
 
 private:
@@ -261,9 +328,9 @@ public:
         _subJobs.appendJob(job);
     }
 
-    void appendTask(const SyncFileItemPtr &item)
+    void appendTask(SyncFileItemSet::node_type &&node)
     {
-        _subJobs.appendTask(item);
+        _subJobs.appendTask(std::move(node));
     }
 
     bool scheduleSelfOrChild() override;
@@ -420,12 +487,27 @@ public:
     /* The maximum number of active jobs in parallel  */
     int hardMaximumActiveJob();
 
+    /** The job limit currently allowed by the feedback controller.
+     *
+     * Sits between maximumActiveTransferJob() and hardMaximumActiveJob(),
+     * steered by reportJobCompletion().
+     */
+    int effectiveHardJobLimit();
+
     /** Check whether a download would clash with an existing file
      * in filesystems that are only case-preserving.
      * Returns the path of the clashed file
      */
     Result<QString, bool> localFileNameClash(const QString &relfile);
 
+    /** Add a path to the case-clash pre-filter index.
+     *
+     * Used by the engine for paths that discovery excluded: those exist on
+     * disk but appear in neither the journal nor the sync items, so the
+     * index built in start() would not know about them.
+     */
+    void recordNameForCaseClashCheck(const QString &relPath);
+
     /** Check whether a file is properly accessible for upload.
      *
      * It is possible to create files with filenames that differ
@@ -455,6 +537,69 @@ public:
     void reportProgress(const SyncFileItem &, qint64 bytes);
     void reportFileTotal(const SyncFileItem &item, qint64 newSize);
 
+    /** Called by finished jobs that claimed to be likely finished quickly,
+     * with the duration they actually took. Feeds the parallelism scaling
+     * in scheduleNextJobImpl().
+     */
+    void reportSmallJobDuration(std::chrono::nanoseconds duration);
+
+    /** Called for every finished item job with the HTTP status it saw.
+     *
+     * Feeds the AIMD controller behind effectiveHardJobLimit(): throttling
+     * responses (503, 429) halve the allowed concurrency, a steady run of
+     * clean completions raises it again.
+     */
+    void reportJobCompletion(quint16 httpErrorCode);
+
+    /** Subtract bytes our own jobs wrote to disk from the cached free
+     * space, so diskSpaceCheck() stays accurate between refreshes.
+     */
+    void recordDiskSpaceConsumed(qint64 bytes);
+
+    /** The shared batcher that combines small uploads into bundle
+     * requests. Created lazily, owned by the propagator.
+     */
+    UploadBundler *uploadBundler();
+
+    /** The shared batcher that combines placeholder creations into bulk
+     * vfs calls. Created lazily, owned by the propagator.
+     */
+    PlaceholderBatcher *placeholderBatcher();
+
+    /** Whether one of @p paths is equal to or nested with a path claimed
+     * by a running exclusive job (i.e. a directory rename).
+     */
+    bool isBlockedByExclusivePaths(const QStringList &paths) const;
+    void claimExclusivePaths(const QStringList &paths);
+    void releaseExclusivePaths(const QStringList &paths);
+
+    /** Schedules queued transfers at or below this relative path ahead
+     * of the remaining bulk of the sync.
+     *
+     * Used for user-triggered actions, e.g. a file clicked in the file
+     * manager while hundreds of background transfers are still queued.
+     * Only affects jobs that have not started yet; running transfers are
+     * not interrupted.
+     */
+    void prioritizePath(const QString &relPath);
+
+    /** Whether @p relPath is a prioritized path, lies below one, or leads
+     * to one (the composite jobs on the way down must be picked first for
+     * the target to be reached). */
+    bool isPrioritizedPath(const QString &relPath) const;
+    bool hasPrioritizedPaths() const { return !_priorityPaths.isEmpty(); }
+
+    /** Queue the parent directory of a renamed-in download for a batched fsync.
+     *
+     * No-op unless OWNCLOUD_DOWNLOAD_DIR_SYNC is set. Small-file storms
+     * would pay one metadata sync per file; batching deduplicates the
+     * directories and issues a single fsync per directory per batch.
+     */
+    void scheduleDirectorySync(const QString &absolutePath);
+
+    /// Syncs and clears everything queued by scheduleDirectorySync()
+    void flushScheduledDirectorySyncs();
+
     void abort();
 
     Account *account() const;
@@ -519,8 +664,12 @@ private Q_SLOTS:
     /** Emit the finished signal and make sure it is only emitted once */
     void emitFinished(SyncFileItem::Status status)
     {
-        if (!_finishedEmitted)
+        if (!_finishedEmitted) {
+            flushScheduledDirectorySyncs();
+            // Flush any file records still queued by write batching, see start().
+            _journal->setWriteBatchingEnabled(false);
             Q_EMIT finished(status == SyncFileItem::Success);
+        }
         _finishedEmitted = true;
     }
 
@@ -536,14 +685,76 @@ Q_SIGNALS:
     /** Emitted when propagation has problems with a locked file. */
     void seenLockedFile(const QString &fileName, FileSystem::LockMode mode);
 
+    /// Structured record of a finished transfer, forwarded by SyncEngine.
+    void transferMetrics(const TransferMetrics &metrics);
+
     void insufficientLocalStorage();
     void insufficientRemoteStorage();
 
 private:
+    /** Case-clash pre-filter, see localFileNameClash().
+     *
+     * On case-preserving-but-insensitive filesystems every clash check used
+     * to probe the filesystem (on macOS even listing the whole parent
+     * directory). The index folds case and normalization of every name known
+     * to exist locally - journal records, this run's sync items and paths
+     * excluded during discovery - and only keys with more than one distinct
+     * original name remain as candidates. Anything else cannot clash and
+     * skips the probe.
+     */
+    static QString caseClashKey(const QString &relPath);
+    void addToCaseClashIndex(const QString &relPath);
+    QHash<QString, QString> _caseFoldedNames; // folded path -> first seen original
+    QSet<QString> _caseClashCandidates; // folded paths with several distinct originals
+    bool _caseClashIndexValid = false;
+
     QPointer<Account> _account;
     QScopedPointer<PropagateRootDirectory> _rootJob;
     SyncOptions _syncOptions;
     bool _jobScheduled = false;
+
+    /// See uploadBundler()
+    UploadBundler *_uploadBundler = nullptr;
+
+    /// See placeholderBatcher()
+    PlaceholderBatcher *_placeholderBatcher = nullptr;
+
+    /** Moving average of the durations recently observed for small jobs.
+     *
+     * Used by scheduleNextJobImpl() to decide how far the small-file
+     * parallelism may scale beyond maximumActiveTransferJob().
+     */
+    std::chrono::nanoseconds _smallJobDurationAvg = {};
+
+    /** Upper job limit steered by server feedback, -1 until the server
+     * asked to back off for the first time. See reportJobCompletion().
+     */
+    int _adaptiveJobLimit = -1;
+
+    /** Clean completions since the last limit change, drives the additive
+     * raise in reportJobCompletion().
+     */
+    int _completionsSinceLimitChange = 0;
+
+    /** Cached statvfs result behind diskSpaceCheck(), refreshed every few
+     * seconds. -1 means unknown (query failed or not yet taken).
+     */
+    mutable qint64 _cachedFreeBytes = -1;
+    mutable std::chrono::steady_clock::time_point _cachedFreeBytesRefreshed;
+
+    /** Path prefixes claimed by running directory renames.
+     *
+     * Jobs whose affectedPaths() are related to a claimed path are kept
+     * queued until the claim is released; everything else schedules as
+     * usual instead of stalling on a tree-wide WaitForFinished.
+     */
+    QStringList _exclusivePaths;
+
+    /// Paths whose queued jobs jump the line, see prioritizePath().
+    QStringList _priorityPaths;
+
+    /// Directories awaiting a batched fsync, see scheduleDirectorySync().
+    QSet<QString> _pendingDirectorySyncs;
     bool _moveToTrash = false;
 
     const QString _localDir; // absolute path to the local directory. ends with '/'
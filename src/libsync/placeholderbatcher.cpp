@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "placeholderbatcher.h"
+
+#include "common/asserts.h"
+#include "common/vfs.h"
+#include "owncloudpropagator.h"
+#include "propagatedownload.h"
+
+#include <QTimer>
+
+#include <utility>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcPlaceholderBatcher, "sync.propagator.placeholderbatcher", QtInfoMsg)
+
+PlaceholderBatcher::PlaceholderBatcher(OwncloudPropagator *propagator)
+    : QObject(propagator)
+    , _propagator(propagator)
+{
+}
+
+bool PlaceholderBatcher::canBatch(const Vfs &vfs) const
+{
+    return vfs.mode() == Vfs::WindowsCfApi;
+}
+
+void PlaceholderBatcher::enqueue(PropagateDownloadFile *job)
+{
+    _pending.append(job);
+    if (_pending.size() >= maxItemsPerBatch) {
+        flush();
+        return;
+    }
+    scheduleFlush();
+}
+
+void PlaceholderBatcher::scheduleFlush()
+{
+    // Debounced like OwncloudPropagator::scheduleNextJob(): everything the
+    // scheduler starts in this event loop round trip joins one batch.
+    if (_flushScheduled) {
+        return;
+    }
+    _flushScheduled = true;
+    QTimer::singleShot(0, this, [this] {
+        _flushScheduled = false;
+        flush();
+    });
+}
+
+void PlaceholderBatcher::flush()
+{
+    if (_pending.isEmpty()) {
+        return;
+    }
+    if (_propagator->_abortRequested) {
+        // The abort machinery winds the waiting jobs down.
+        _pending.clear();
+        return;
+    }
+    const auto candidates = std::exchange(_pending, {});
+
+    QVector<QPointer<PropagateDownloadFile>> batched;
+    QVector<const SyncFileItem *> items;
+    batched.reserve(candidates.size());
+    items.reserve(candidates.size());
+    for (const auto &jobPointer : candidates) {
+        PropagateDownloadFile *job = jobPointer.data();
+        if (!job || job->state() == PropagatorJob::Finished) {
+            continue;
+        }
+        batched.append(job);
+        items.append(job->_item.data());
+    }
+    if (items.isEmpty()) {
+        return;
+    }
+
+    qCInfo(lcPlaceholderBatcher) << "Creating" << items.size() << "placeholders in bulk";
+    const auto results = _propagator->syncOptions().vfs()->createPlaceholders(items);
+    OC_ASSERT(results.size() == items.size());
+
+    for (int i = 0; i < batched.size(); ++i) {
+        PropagateDownloadFile *job = batched.at(i).data();
+        if (!job || job->state() == PropagatorJob::Finished) {
+            continue;
+        }
+        job->finishPlaceholderCreation(i < results.size() ? results.at(i) : Result<void, QString> {});
+    }
+}
+}
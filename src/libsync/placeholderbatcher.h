@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QLoggingCategory>
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+namespace OCC {
+
+class OwncloudPropagator;
+class PropagateDownloadFile;
+class Vfs;
+
+Q_DECLARE_LOGGING_CATEGORY(lcPlaceholderBatcher)
+
+/**
+ * @brief Combines many placeholder creations into bulk vfs calls
+ * @ingroup libsync
+ *
+ * The initial sync of a virtual folder consists almost entirely of
+ * placeholder creations, and each one used to pay the fixed cost of its own
+ * call into the vfs provider. Download jobs that only need to create a new
+ * dehydrated placeholder register here instead; everything that queues up
+ * within one event loop round trip leaves in a single
+ * Vfs::createPlaceholders() call, which the cfapi plugin turns into one
+ * provider invocation per parent directory.
+ *
+ * Each job then finalizes with its individual result exactly as if it had
+ * created its placeholder on its own, so batching cannot change what a sync
+ * reports.
+ */
+class OWNCLOUDSYNC_EXPORT PlaceholderBatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlaceholderBatcher(OwncloudPropagator *propagator);
+
+    /// Upper bound of placeholders leaving in one batch.
+    static constexpr int maxItemsPerBatch = 500;
+
+    /** Whether batching is worthwhile for this vfs plugin.
+     *
+     * The base Vfs implementation creates the placeholders one by one
+     * anyway, so only plugins with a native batch interface gain anything
+     * from the extra event loop round trip.
+     */
+    bool canBatch(const Vfs &vfs) const;
+
+    /** Queues the job for the next batch.
+     *
+     * The batch is flushed on the next event loop iteration, or right away
+     * once the batch bound is reached. The job's
+     * finishPlaceholderCreation() is called with its result.
+     */
+    void enqueue(PropagateDownloadFile *job);
+
+private:
+    void scheduleFlush();
+    void flush();
+
+    OwncloudPropagator *_propagator;
+
+    QVector<QPointer<PropagateDownloadFile>> _pending;
+    bool _flushScheduled = false;
+};
+}
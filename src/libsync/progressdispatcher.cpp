@@ -130,6 +130,7 @@ void ProgressInfo::reset()
     _currentItems.clear();
     _currentDiscoveredRemoteFolder.clear();
     _currentDiscoveredLocalFolder.clear();
+    _discoveryStatistics = DiscoveryStatistics();
     _sizeProgress = Progress();
     _fileProgress = Progress();
     _totalSizeOfCompletedJobs = 0;
@@ -244,15 +245,19 @@ void ProgressInfo::setProgressItem(const SyncFileItem &item, qint64 completed)
         return;
     }
 
-    if (!_currentItems.contains(item._file)) {
-        _currentItems[item._file]._item = item;
-        _currentItems[item._file]._progress._total = item._size;
+    auto it = _currentItems.find(item._file);
+    if (it == _currentItems.end()) {
+        it = _currentItems.insert(item._file, ProgressItem());
+        it->_item = item;
+        it->_progress._total = item._size;
     }
-    _currentItems[item._file]._progress.setCompleted(completed);
+    it->_progress.setCompleted(completed);
     recomputeCompletedSize();
 
     // This seems dubious!
-    _lastCompletedItem = SyncFileItem();
+    if (!_lastCompletedItem.isEmpty()) {
+        _lastCompletedItem = SyncFileItem();
+    }
 }
 
 ProgressInfo::Estimates ProgressInfo::totalProgress() const
@@ -23,6 +23,8 @@
 #include <QElapsedTimer>
 #include <QTimer>
 
+#include <chrono>
+
 #include "syncfileitem.h"
 
 namespace OCC {
@@ -184,6 +186,30 @@ public:
 
     Status _status;
 
+    /** Counters and per-phase timings collected during discovery.
+     *
+     * Makes it possible to tell from the outside whether a slow sync spends
+     * its time stat'ing local directories, waiting for remote PROPFINDs or
+     * reconciling against the journal. Filled in by the SyncEngine from the
+     * running DiscoveryPhase whenever progress is reported.
+     */
+    struct OWNCLOUDSYNC_EXPORT DiscoveryStatistics
+    {
+        int remoteDirectoriesListed = 0;
+        int localDirectoriesListed = 0;
+        /// Number of directory entries merged from local, remote and journal state.
+        int entriesReconciled = 0;
+        /// Unchanged files skipped without building a sync item.
+        int filesUnchanged = 0;
+        std::chrono::nanoseconds remoteListingTime = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds localListingTime = std::chrono::nanoseconds::zero();
+        /// Time spent reading directory listings from the journal.
+        std::chrono::nanoseconds journalListingTime = std::chrono::nanoseconds::zero();
+        /// Time spent merging the three sources, includes journalListingTime.
+        std::chrono::nanoseconds reconcileTime = std::chrono::nanoseconds::zero();
+    };
+    DiscoveryStatistics _discoveryStatistics;
+
     struct OWNCLOUDSYNC_EXPORT ProgressItem
     {
         SyncFileItem _item;
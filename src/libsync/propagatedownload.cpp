@@ -14,9 +14,11 @@
 
 #include "propagatedownload.h"
 #include "account.h"
+#include "bandwidthlimiter.h"
 #include "filesystem.h"
 #include "networkjobs.h"
 #include "owncloudpropagator_p.h"
+#include "placeholderbatcher.h"
 #include "propagatorjobs.h"
 
 #include "common/asserts.h"
@@ -30,10 +32,14 @@
 
 #include <QDir>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QLoggingCategory>
 #include <QRandomGenerator>
+#include <QtConcurrentRun>
 
+#include <algorithm>
 #include <cmath>
+#include <utility>
 
 #ifdef Q_OS_UNIX
 #include <unistd.h>
@@ -103,9 +109,12 @@ namespace CernRecallFeature {
             QString targetPath = makeRecallFileName(recalledFile);
 
             qCDebug(lcPropagateDownload) << "Copy recall file: " << recalledFile << " -> " << targetPath;
-            // Remove the target first, QFile::copy will not overwrite it.
+            // Remove the target first, the copy will not overwrite it.
             FileSystem::remove(targetPath);
-            QFile::copy(recalledFile, targetPath);
+            QString copyError;
+            if (!FileSystem::copyFileCloned(recalledFile, targetPath, &copyError)) {
+                qCWarning(lcPropagateDownload) << "Could not copy recall file" << recalledFile << "->" << targetPath << copyError;
+            }
         }
     }
 
@@ -124,6 +133,52 @@ namespace {
         Q_UNUSED(fi);
 #endif
     }
+
+    /** Opt-in knob: drop the OS cache behind downloads of at least this
+     * many MiB.
+     *
+     * Unset or 0 disables it. Keeps a bulk initial sync from evicting the
+     * rest of the machine's working set from the page cache, at the cost
+     * of re-reading a file from disk when it is used right after the sync.
+     */
+    qint64 dropWriteCacheThreshold()
+    {
+        static const qint64 thresholdMiB = qEnvironmentVariableIntValue("OWNCLOUD_DOWNLOAD_DROP_CACHE");
+        return thresholdMiB * 1024 * 1024;
+    }
+
+    // Evict in windows of this size, lagging one window behind the writes
+    // so the previously advised pages had time to become clean.
+    constexpr qint64 writeCacheDropWindow = 16 * 1024 * 1024;
+
+    // A gap of this length in mid-transfer data arrival counts as a stall
+    // in the transfer telemetry.
+    constexpr auto downloadStallWindow = 1s;
+
+    /* Set OWNCLOUD_DOWNLOAD_STALL_TIMEOUT to a number of seconds to abort a
+     * download whose connection stopped delivering data for that long,
+     * instead of waiting for the full request timeout. The partial file is
+     * kept and the next attempt resumes.
+     */
+    std::chrono::seconds downloadStallTimeout()
+    {
+        static const int seconds = qMax(0, qEnvironmentVariableIntValue("OWNCLOUD_DOWNLOAD_STALL_TIMEOUT"));
+        return std::chrono::seconds(seconds);
+    }
+
+    /* Reply buffer and read chunk while pacing is active: kept small so an
+     * undrained reply applies backpressure on the server quickly.
+     */
+    constexpr qint64 pacedReplyBufferSize = 16 * 1024;
+    constexpr qint64 pacedReadChunkSize = 8 * 1024;
+
+    /* Without a rate cap the buffers are sized for throughput instead: the
+     * reply accumulates whole TLS records and the body moves to the file
+     * writer in large blocks, one write() per half megabyte instead of
+     * sixty-four.
+     */
+    constexpr qint64 unpacedReplyBufferSize = 2 * 1024 * 1024;
+    constexpr qint64 unpacedReadChunkSize = 512 * 1024;
 }
 // Always coming in with forward slashes.
 // In csync_excluded_no_ctx we ignore all files with longer than 254 chars
@@ -161,6 +216,7 @@ GETFileJob::GETFileJob(Account *account, const QUrl &url, const QString &path, Q
     , _expectedContentLength(-1)
     , _contentLength(-1)
     , _resumeStart(resumeStart)
+    , _limiter(account->downloadLimiter())
 {
     connect(this, &GETFileJob::networkError, this, [this] {
         if (timedOut()) {
@@ -170,6 +226,9 @@ GETFileJob::GETFileJob(Account *account, const QUrl &url, const QString &path, Q
         }
     });
 
+    // When pacing starves slotReadyRead, resume once tokens are back.
+    connect(_limiter, &BandwidthLimiter::replenished, this, &GETFileJob::slotReadyRead);
+
     // Long downloads must not block non-propagation jobs.
     setPriority(QNetworkRequest::LowPriority);
 }
@@ -179,6 +238,12 @@ void GETFileJob::start()
     if (_resumeStart > 0) {
         _headers["Range"] = "bytes=" + QByteArray::number(_resumeStart) + '-';
         _headers["Accept-Ranges"] = "bytes";
+        if (!_expectedEtagForResume.isEmpty()) {
+            // If the file changed on the server, If-Range makes it answer
+            // with the full body instead of failing the range request; the
+            // etag mismatch is then handled without an extra round trip.
+            _headers["If-Range"] = QStringLiteral("\"%1\"").arg(_expectedEtagForResume).toUtf8();
+        }
         qCDebug(lcGetJob) << "Retry with range " << _headers["Range"];
     }
 
@@ -187,6 +252,7 @@ void GETFileJob::start()
         req.setRawHeader(it.key(), it.value());
     }
 
+    _ttfbTimer.start();
     sendRequest("GET", req);
 
     AbstractNetworkJob::start();
@@ -194,6 +260,9 @@ void GETFileJob::start()
 
 void GETFileJob::finished()
 {
+    if (_stallTimer) {
+        _stallTimer->stop();
+    }
     if (reply()->bytesAvailable() && _httpOk) {
         // we were throttled, write out the remaining data
         slotReadyRead();
@@ -203,7 +272,7 @@ void GETFileJob::finished()
 
 void GETFileJob::newReplyHook(QNetworkReply *reply)
 {
-    reply->setReadBufferSize(16 * 1024); // keep low so we can easier limit the bandwidth
+    reply->setReadBufferSize(_limiter->isActive() ? pacedReplyBufferSize : unpacedReplyBufferSize);
 
     connect(reply, &QNetworkReply::metaDataChanged, this, &GETFileJob::slotMetaDataChanged);
     connect(reply, &QNetworkReply::finished, this, &GETFileJob::slotReadyRead);
@@ -212,9 +281,13 @@ void GETFileJob::newReplyHook(QNetworkReply *reply)
 
 void GETFileJob::slotMetaDataChanged()
 {
+    if (_timeToFirstByte.count() == 0 && _ttfbTimer.isValid()) {
+        _timeToFirstByte = std::chrono::milliseconds(_ttfbTimer.elapsed());
+    }
+
     // For some reason setting the read buffer in GETFileJob::start doesn't seem to go
     // through the HTTP layer thread(?)
-    reply()->setReadBufferSize(16 * 1024);
+    reply()->setReadBufferSize(_limiter->isActive() ? pacedReplyBufferSize : unpacedReplyBufferSize);
 
     int httpStatus = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
@@ -248,12 +321,32 @@ void GETFileJob::slotMetaDataChanged()
         abort();
         return;
     } else if (!_expectedEtagForResume.isEmpty() && _expectedEtagForResume != _etag) {
-        qCWarning(lcGetJob) << "We received a different E-Tag for resuming!"
-                            << _expectedEtagForResume << "vs" << _etag;
-        _errorString = tr("We received a different E-Tag for resuming. Retrying next time.");
-        _errorStatus = SyncFileItem::NormalError;
-        abort();
-        return;
+        if (reply()->rawHeader("Content-Range").isEmpty()) {
+            // The file changed on the server and If-Range made it send the
+            // full body instead of the requested range: restart cleanly
+            // from scratch within this request.
+            qCInfo(lcGetJob) << "Remote file changed since the partial download, receiving it in full"
+                             << _expectedEtagForResume << "vs" << _etag;
+            _device->close();
+            if (!_device->open(QIODevice::WriteOnly)) {
+                _errorString = _device->errorString();
+                _errorStatus = SyncFileItem::NormalError;
+                abort();
+                return;
+            }
+            if (_expectedContentLength != -1) {
+                // The caller expected the remainder; now the whole body comes.
+                _expectedContentLength += _resumeStart;
+            }
+            _resumeStart = 0;
+        } else {
+            qCWarning(lcGetJob) << "We received a different E-Tag for resuming!"
+                                << _expectedEtagForResume << "vs" << _etag;
+            _errorString = tr("We received a different E-Tag for resuming. Retrying next time.");
+            _errorStatus = SyncFileItem::NormalError;
+            abort();
+            return;
+        }
     }
 
     bool ok;
@@ -300,8 +393,40 @@ void GETFileJob::slotMetaDataChanged()
     if (!lastModified.isNull()) {
         _lastModified = Utility::qDateTimeToTime_t(lastModified.toDateTime());
     }
+
+    // Hash the body as it is written so validating it later does not have
+    // to re-read the temp file. Only possible when this request carries
+    // the whole file from its first byte.
+    _streamingChecksum.reset();
+    if (_resumeStart == 0 && _device->pos() == 0) {
+        QByteArray checksumHeader = findBestChecksum(reply()->rawHeader(checkSumHeaderC));
+        const auto contentMd5Header = reply()->rawHeader(contentMd5HeaderC);
+        if (checksumHeader.isEmpty() && !contentMd5Header.isEmpty())
+            checksumHeader = "MD5:" + contentMd5Header;
+        const auto header = ChecksumHeader::parseChecksumHeader(checksumHeader);
+        if (header.isValid()) {
+            _streamingChecksum = std::make_unique<StreamingChecksum>(header.type());
+        }
+    }
+
     _httpOk = true;
     connect(reply(), &QIODevice::readyRead, this, &GETFileJob::slotReadyRead);
+
+    _lastDataReceived.start();
+    const auto stallTimeout = downloadStallTimeout();
+    if (stallTimeout > 0s && !_stallTimer) {
+        _stallTimer = new QTimer(this);
+        _stallTimer->setInterval(1s);
+        connect(_stallTimer, &QTimer::timeout, this, [this, stallTimeout] {
+            if (_lastDataReceived.hasExpired(std::chrono::milliseconds(stallTimeout).count())) {
+                qCWarning(lcGetJob) << this << "stalled for" << stallTimeout.count() << "seconds, giving up on this connection";
+                _errorString = tr("The connection stalled: no data was received for %1 seconds").arg(stallTimeout.count());
+                _errorStatus = SyncFileItem::SoftError;
+                reply()->abort();
+            }
+        });
+        _stallTimer->start();
+    }
 }
 
 qint64 GETFileJob::currentDownloadPosition()
@@ -314,17 +439,31 @@ qint64 GETFileJob::currentDownloadPosition()
 
 void GETFileJob::slotReadyRead()
 {
-    Q_ASSERT(reply());
-    if (!_httpOk) {
+    // The limiter's replenished() signal may arrive before this job's
+    // request went out, or after its data was handled.
+    if (!reply() || !_httpOk) {
         return;
     }
 
-    const qint64 bufferSize = std::min<qint64>(1024 * 8, reply()->bytesAvailable());
-    QByteArray buffer(bufferSize, Qt::Uninitialized);
+    const qint64 chunkSize = _limiter->isActive() ? pacedReadChunkSize : unpacedReadChunkSize;
+    if (_readBuffer.size() < chunkSize) {
+        _readBuffer.resize(chunkSize);
+    }
+    char *const buffer = _readBuffer.data();
 
     while (reply()->bytesAvailable() > 0) {
-        qint64 toRead = bufferSize;
-        const qint64 read = reply()->read(buffer.data(), toRead);
+        qint64 toRead = chunkSize;
+        // The small read buffer makes an undrained reply apply backpressure
+        // on the server. A finished reply is drained regardless: its bytes
+        // are already downloaded.
+        if (_limiter->isActive() && !reply()->isFinished()) {
+            toRead = _limiter->acquire(toRead);
+            if (toRead == 0) {
+                // replenished() calls us again
+                return;
+            }
+        }
+        const qint64 read = reply()->read(buffer, toRead);
         if (read < 0) {
             _errorString = networkReplyErrorString(*reply());
             _errorStatus = SyncFileItem::NormalError;
@@ -333,7 +472,7 @@ void GETFileJob::slotReadyRead()
             return;
         }
 
-        const qint64 written = _device->write(buffer.constData(), read);
+        const qint64 written = _device->write(buffer, read);
         if (written != read) {
             _errorString = _device->errorString();
             _errorStatus = SyncFileItem::NormalError;
@@ -341,6 +480,25 @@ void GETFileJob::slotReadyRead()
             abort();
             return;
         }
+        if (_streamingChecksum) {
+            _streamingChecksum->update(buffer, read);
+        }
+        if (_lastDataReceived.isValid()) {
+            const auto gap = std::chrono::milliseconds(_lastDataReceived.restart());
+            if (gap >= downloadStallWindow) {
+                ++_stalls;
+                _stalledFor += gap;
+            }
+        }
+        if (_dropWriteCache) {
+            const qint64 pos = _device->pos();
+            if (pos - _cacheDropEnd >= writeCacheDropWindow) {
+                if (auto *file = qobject_cast<QFile *>(_device)) {
+                    FileSystem::dropWriteCache(file, _cacheDropEnd, pos - _cacheDropEnd);
+                }
+                _cacheDropEnd = pos;
+            }
+        }
     }
 }
 
@@ -352,6 +510,283 @@ QString GETFileJob::errorString() const
     return AbstractNetworkJob::errorString();
 }
 
+namespace {
+
+    /** Opt-in knob: number of parallel Range requests per big download.
+     *
+     * Unset or below 2 keeps the single-stream path. Capped because more
+     * connections than that only shift the bottleneck to the server.
+     */
+    int downloadSegmentCount()
+    {
+        static const int count = qEnvironmentVariableIntValue("OWNCLOUD_DOWNLOAD_SEGMENTS");
+        return qBound(0, count, 16);
+    }
+
+    // Segments below this size do not recoup the extra request overhead.
+    constexpr qint64 minSegmentSize = 8 * 1024 * 1024;
+
+    /** Opt-in knob: write brand-new files at their final name directly.
+     *
+     * Skips the hidden temp file and the rename, which is expensive on
+     * SMB shares. The journal's DownloadInfo marks the file as incomplete
+     * until the download finishes; interrupted files are cleaned up by the
+     * stale-download sweep like temp files are.
+     */
+    bool downloadInPlaceEnabled()
+    {
+        static const bool enabled = qEnvironmentVariableIntValue("OWNCLOUD_DOWNLOAD_IN_PLACE") != 0;
+        return enabled;
+    }
+
+    /** Digest algorithm for the per-segment checksums.
+     *
+     * The server does not offer checksums per byte range, so every segment
+     * is hashed locally while it is written. The digests only have to
+     * catch corruption of the partial file between then and the final
+     * validation; SHA1 is cheap and always available.
+     */
+    constexpr auto segmentDigestAlgorithm = CheckSums::Algorithm::SHA1;
+
+    QByteArray serializeSegments(qint64 segmentSize, const QVector<qint64> &received, const QVector<QByteArray> &digests)
+    {
+        QByteArray out = "2:" + QByteArray::number(segmentSize) + ':';
+        for (int i = 0; i < received.size(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            out += QByteArray::number(received.at(i));
+        }
+        // One hex digest per fully received segment, empty while unknown.
+        out += ':';
+        for (int i = 0; i < received.size(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            out += digests.value(i);
+        }
+        return out;
+    }
+
+    bool parseSegments(const QByteArray &blob, qint64 *segmentSize, QVector<qint64> *received, QVector<QByteArray> *digests)
+    {
+        const auto parts = blob.split(':');
+        // Version 1 blobs, from before per-segment digests, carry no digest list.
+        const bool withDigests = parts.at(0) == "2";
+        if (!(withDigests && parts.size() == 4) && !(parts.at(0) == "1" && parts.size() == 3)) {
+            return false;
+        }
+        bool ok = false;
+        *segmentSize = parts.at(1).toLongLong(&ok);
+        if (!ok || *segmentSize <= 0) {
+            return false;
+        }
+        received->clear();
+        const auto values = parts.at(2).split(',');
+        for (const auto &value : values) {
+            const qint64 r = value.toLongLong(&ok);
+            if (!ok || r < 0) {
+                return false;
+            }
+            received->append(r);
+        }
+        digests->clear();
+        if (withDigests) {
+            const auto digestValues = parts.at(3).split(',');
+            if (digestValues.size() != received->size()) {
+                return false;
+            }
+            for (const auto &digest : digestValues) {
+                digests->append(digest);
+            }
+        } else {
+            digests->resize(received->size());
+        }
+        return !received->isEmpty();
+    }
+}
+
+GETFileSegmentJob::GETFileSegmentJob(Account *account, const QUrl &rootUrl, const QString &path, const QString &localFile,
+    qint64 offset, qint64 size, qint64 alreadyReceived, QObject *parent)
+    : AbstractNetworkJob(account, rootUrl, path, parent)
+    , _file(localFile)
+    , _offset(offset)
+    , _size(size)
+    , _received(alreadyReceived)
+    , _limiter(account->downloadLimiter())
+{
+    // When pacing starves slotReadyRead, resume once tokens are back.
+    connect(_limiter, &BandwidthLimiter::replenished, this, &GETFileSegmentJob::slotReadyRead);
+
+    // Long downloads must not block non-propagation jobs.
+    setPriority(QNetworkRequest::LowPriority);
+
+    if (_received == 0) {
+        // Hash the segment while it arrives. A resumed prefix never passes
+        // through this job, so its digest cannot be completed here.
+        _streamingChecksum = std::make_unique<StreamingChecksum>(segmentDigestAlgorithm);
+    }
+}
+
+bool GETFileSegmentJob::openFile(QString *error)
+{
+    // Each segment writes through its own handle, seeked once; parallel
+    // writers never touch each other's byte range.
+    if (!_file.open(QIODevice::ReadWrite | QIODevice::Unbuffered) || !_file.seek(_offset + _received)) {
+        if (error) {
+            *error = _file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+void GETFileSegmentJob::start()
+{
+    QNetworkRequest req;
+    req.setRawHeader("Range",
+        "bytes=" + QByteArray::number(_offset + _received) + '-' + QByteArray::number(_offset + _size - 1));
+    req.setRawHeader("Accept-Ranges", "bytes");
+
+    sendRequest("GET", req);
+
+    AbstractNetworkJob::start();
+}
+
+void GETFileSegmentJob::finished()
+{
+    if (reply()->bytesAvailable() && _httpOk) {
+        // we were throttled, write out the remaining data
+        slotReadyRead();
+    }
+    _file.close();
+}
+
+void GETFileSegmentJob::newReplyHook(QNetworkReply *reply)
+{
+    reply->setReadBufferSize(_limiter->isActive() ? pacedReplyBufferSize : unpacedReplyBufferSize);
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, &GETFileSegmentJob::slotMetaDataChanged);
+    connect(reply, &QNetworkReply::finished, this, &GETFileSegmentJob::slotReadyRead);
+}
+
+void GETFileSegmentJob::slotMetaDataChanged()
+{
+    reply()->setReadBufferSize(_limiter->isActive() ? pacedReplyBufferSize : unpacedReplyBufferSize);
+
+    const int httpStatus = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (httpStatus == 301 || httpStatus == 302 || httpStatus == 303 || httpStatus == 307
+        || httpStatus == 308 || httpStatus == 401) {
+        // Redirects and auth failures are handled by AbstractNetworkJob,
+        // see GETFileJob::slotMetaDataChanged().
+        disconnect(reply(), &QNetworkReply::finished, this, &GETFileSegmentJob::slotReadyRead);
+        disconnect(reply(), &QNetworkReply::readyRead, this, &GETFileSegmentJob::slotReadyRead);
+        return;
+    }
+
+    if (httpStatus == 200) {
+        // The server ignored our Range header and is sending the whole
+        // file. Do not write a byte of it: the coordinator falls back to
+        // the single-stream download.
+        qCWarning(lcGetJob) << "Server ignored the Range request for" << path();
+        _serverIgnoredRange = true;
+        abort();
+        return;
+    }
+    if (httpStatus != 206) {
+        // Errors are handled when the job finishes.
+        reply()->setReadBufferSize(0);
+        return;
+    }
+    if (reply()->error() != QNetworkReply::NoError) {
+        return;
+    }
+
+    _etag = getEtagFromReply(reply());
+
+    const auto lastModified = reply()->header(QNetworkRequest::LastModifiedHeader);
+    if (!lastModified.isNull()) {
+        _lastModified = Utility::qDateTimeToTime_t(lastModified.toDateTime());
+    }
+    _httpOk = true;
+    connect(reply(), &QIODevice::readyRead, this, &GETFileSegmentJob::slotReadyRead);
+}
+
+void GETFileSegmentJob::slotReadyRead()
+{
+    // The limiter's replenished() signal may arrive before this job's
+    // request went out, or after its data was handled.
+    if (!reply() || !_httpOk) {
+        return;
+    }
+
+    const qint64 chunkSize = _limiter->isActive() ? pacedReadChunkSize : unpacedReadChunkSize;
+    if (_readBuffer.size() < chunkSize) {
+        _readBuffer.resize(chunkSize);
+    }
+    char *const buffer = _readBuffer.data();
+
+    bool wrote = false;
+    while (reply()->bytesAvailable() > 0) {
+        qint64 toRead = chunkSize;
+        // See GETFileJob::slotReadyRead() for the backpressure rationale.
+        if (_limiter->isActive() && !reply()->isFinished()) {
+            toRead = _limiter->acquire(toRead);
+            if (toRead == 0) {
+                // replenished() calls us again
+                break;
+            }
+        }
+        const qint64 read = reply()->read(buffer, toRead);
+        if (read < 0) {
+            _errorString = networkReplyErrorString(*reply());
+            _errorStatus = SyncFileItem::NormalError;
+            qCWarning(lcGetJob) << "Error while reading from device: " << _errorString;
+            abort();
+            return;
+        }
+
+        const qint64 written = _file.write(buffer, read);
+        if (written != read) {
+            _errorString = _file.errorString();
+            _errorStatus = SyncFileItem::NormalError;
+            qCWarning(lcGetJob) << "Error while writing to file" << written << read << _errorString;
+            abort();
+            return;
+        }
+        _received += written;
+        wrote = true;
+        if (_streamingChecksum) {
+            _streamingChecksum->update(buffer, read);
+        }
+        if (_dropWriteCache && _received - _cacheDropEnd >= writeCacheDropWindow) {
+            // See GETFileJob::slotReadyRead().
+            FileSystem::dropWriteCache(&_file, _offset + _cacheDropEnd, _received - _cacheDropEnd);
+            _cacheDropEnd = _received;
+        }
+    }
+    if (wrote) {
+        Q_EMIT progressed();
+    }
+}
+
+QString GETFileSegmentJob::errorString() const
+{
+    if (!_errorString.isEmpty()) {
+        return _errorString;
+    }
+    return AbstractNetworkJob::errorString();
+}
+
+QByteArray GETFileSegmentJob::segmentDigest() const
+{
+    if (!_streamingChecksum || _received != _size) {
+        return QByteArray();
+    }
+    return _streamingChecksum->result();
+}
+
 void PropagateDownloadFile::start()
 {
     if (propagator()->_abortRequested || !propagator()->syncOptions().isValid())
@@ -408,6 +843,12 @@ void PropagateDownloadFile::start()
                 return;
             }
         }
+        if (!isConflict && propagator()->placeholderBatcher()->canBatch(*vfs)) {
+            // Plain new placeholders are created in bulk; the batcher calls
+            // finishPlaceholderCreation() with this item's result.
+            propagator()->placeholderBatcher()->enqueue(this);
+            return;
+        }
         auto r = vfs->createPlaceholder(*_item);
         if (!r) {
             done(SyncFileItem::NormalError, r.error());
@@ -501,15 +942,43 @@ void PropagateDownloadFile::startDownload()
         } else {
             tmpFileName = progressInfo._tmpfile;
             _expectedEtagForResume = QString::fromUtf8(progressInfo._etag);
+            _segmentResume = progressInfo._segments;
         }
     }
 
     if (tmpFileName.isEmpty()) {
-        tmpFileName = createDownloadTmpFileName(_item->_file);
+        // Brand-new files in plain (non-virtual) folders may skip the
+        // temp-file-plus-rename dance and download straight to the final
+        // name. A resumed in-place download re-enters this mode through
+        // the stored tmpfile name above.
+        if (downloadInPlaceEnabled() && _item->instruction() == CSYNC_INSTRUCTION_NEW
+            && _item->_type == ItemTypeFile
+            && propagator()->syncOptions().vfs()->mode() == Vfs::Off
+            && !FileSystem::fileExists(targetFile)) {
+            tmpFileName = _item->_file;
+        } else {
+            tmpFileName = createDownloadTmpFileName(_item->_file);
+        }
     }
+    _downloadInPlace = (tmpFileName == _item->_file);
     _tmpFile.setFileName(propagator()->fullLocalPath(tmpFileName));
 
     _resumeStart = _tmpFile.size();
+    if (!_segmentResume.isEmpty()) {
+        // A segmented download extends the temp file up front and fills it
+        // at several offsets: its on-disk size says nothing about progress
+        // and the usual tail-resume must not run.
+        _resumeStart = 0;
+    }
+    if (_resumeStart > _item->_size) {
+        // The partial file cannot be a prefix of the remote content (e.g.
+        // leftovers of an earlier, larger version): asking the server for a
+        // range beyond its end would only earn a 416. Start over.
+        qCWarning(lcPropagateDownload) << "Discarding oversized partial file" << _tmpFile.fileName()
+                                       << _resumeStart << ">" << _item->_size;
+        FileSystem::remove(_tmpFile.fileName());
+        _resumeStart = 0;
+    }
     if (_resumeStart > 0 && _resumeStart == _item->_size) {
         qCInfo(lcPropagateDownload) << "File is already complete, no need to download";
         downloadFinished();
@@ -520,13 +989,21 @@ void PropagateDownloadFile::startDownload()
     // file writable if it exists.
     if (_tmpFile.exists())
         FileSystem::setFileReadOnly(_tmpFile.fileName(), false);
-    if (!_tmpFile.open(QIODevice::Append | QIODevice::Unbuffered)) {
+    QIODevice::OpenMode openMode = QIODevice::Append | QIODevice::Unbuffered;
+    if (_downloadInPlace && !_tmpFile.exists()) {
+        // Exclusive create: if something appeared at the final name since
+        // the check above, fail rather than overwrite it.
+        openMode = QIODevice::NewOnly | QIODevice::Unbuffered;
+    }
+    if (!_tmpFile.open(openMode)) {
         qCWarning(lcPropagateDownload) << "could not open temporary file" << _tmpFile.fileName();
         done(SyncFileItem::NormalError, _tmpFile.errorString());
         return;
     }
-    // Hide temporary after creation
-    FileSystem::setFileHidden(_tmpFile.fileName(), true);
+    if (!_downloadInPlace) {
+        // Hide temporary after creation
+        FileSystem::setFileHidden(_tmpFile.fileName(), true);
+    }
 
     // If there's not enough space to fully download this file, stop.
     const auto diskSpaceResult = propagator()->diskSpaceCheck();
@@ -551,13 +1028,20 @@ void PropagateDownloadFile::startDownload()
         return;
     }
 
+    if (_item->_size > 0) {
+        // Reserve the full size up front: the sequential writes then never
+        // block on allocation, which matters on SMB-backed sync folders
+        // where every file extension is a round trip.
+        FileSystem::reserveSpace(&_tmpFile, _item->_size);
+    }
+
     {
         SyncJournalDb::DownloadInfo pi;
         pi._etag = _item->_etag.toUtf8();
         pi._tmpfile = tmpFileName;
         pi._valid = true;
         propagator()->_journal->setDownloadInfo(_item->_file, pi);
-        propagator()->_journal->commit(QStringLiteral("download file start"));
+        propagator()->_journal->commitAsync(QStringLiteral("download file start"));
     }
 
     startFullDownload();
@@ -565,6 +1049,17 @@ void PropagateDownloadFile::startDownload()
 
 void PropagateDownloadFile::startFullDownload()
 {
+    if (_item->_directDownloadUrl.isEmpty() && !_segmentedDisabled && startSegmentedDownload()) {
+        return;
+    }
+    if (!_segmentResume.isEmpty()) {
+        // Segmented state exists but segmentation does not apply anymore:
+        // the temp file has holes, so start over from scratch.
+        _segmentResume.clear();
+        _tmpFile.resize(0);
+        _resumeStart = 0;
+    }
+
     QMap<QByteArray, QByteArray> headers;
 
     if (_item->_directDownloadUrl.isEmpty()) {
@@ -584,13 +1079,236 @@ void PropagateDownloadFile::startFullDownload()
     }
     _job->setExpectedContentLength(_item->_size - _resumeStart);
 
+    const qint64 dropCacheLimit = dropWriteCacheThreshold();
+    if (dropCacheLimit > 0 && _item->_size >= dropCacheLimit) {
+        _job->setDropWriteCache(true);
+    }
+
     connect(_job.data(), &GETFileJob::finishedSignal, this, &PropagateDownloadFile::slotGetFinished);
     connect(qobject_cast<GETFileJob *>(_job.data()), &GETFileJob::downloadProgress,
         this, &PropagateDownloadFile::slotDownloadProgress);
     propagator()->_activeJobList.append(this);
+    _downloadRequests++;
     _job->start();
 }
 
+bool PropagateDownloadFile::startSegmentedDownload()
+{
+    const int count = downloadSegmentCount();
+    if (count < 2 || _item->_size < qint64(count) * minSegmentSize) {
+        return false;
+    }
+
+    _segmentSize = (_item->_size + count - 1) / count;
+    _segmentReceived = QVector<qint64>(count, 0);
+    _segmentDigests = QVector<QByteArray>(count);
+
+    // Resume a previous run only when its segmentation matches ours.
+    qint64 resumeSegmentSize = 0;
+    QVector<qint64> resumeReceived;
+    QVector<QByteArray> resumeDigests;
+    if (!_segmentResume.isEmpty() && parseSegments(_segmentResume, &resumeSegmentSize, &resumeReceived, &resumeDigests)
+        && resumeSegmentSize == _segmentSize && resumeReceived.size() == count) {
+        _segmentReceived = resumeReceived;
+        _segmentDigests = resumeDigests;
+    }
+    _segmentResume.clear();
+
+    qCInfo(lcPropagateDownload) << "Downloading" << _item->_file << "in" << count
+                                << "segments of up to" << _segmentSize << "bytes";
+
+    _segmentJobs.clear();
+    for (int i = 0; i < count; ++i) {
+        const qint64 offset = qint64(i) * _segmentSize;
+        const qint64 size = qMin(_segmentSize, _item->_size - offset);
+        if (_segmentReceived.at(i) >= size) {
+            // This segment completed in a previous run.
+            continue;
+        }
+        auto *job = new GETFileSegmentJob(propagator()->account(), propagator()->webDavUrl(),
+            propagator()->fullRemotePath(_item->_file), _tmpFile.fileName(), offset, size, _segmentReceived.at(i), this);
+        QString openError;
+        if (!job->openFile(&openError)) {
+            qCWarning(lcPropagateDownload) << "could not open temporary file" << _tmpFile.fileName() << "for segment" << i;
+            done(SyncFileItem::NormalError, openError);
+            return true;
+        }
+        const qint64 dropCacheLimit = dropWriteCacheThreshold();
+        if (dropCacheLimit > 0 && _item->_size >= dropCacheLimit) {
+            job->setDropWriteCache(true);
+        }
+        connect(job, &GETFileSegmentJob::finishedSignal, this, &PropagateDownloadFile::slotSegmentFinished);
+        connect(job, &GETFileSegmentJob::progressed, this, &PropagateDownloadFile::slotSegmentProgressed);
+        _segmentJobs.append(job);
+    }
+
+    if (_segmentJobs.isEmpty()) {
+        // Everything was already on disk from a previous run.
+        _tmpFile.close();
+        validateDownload();
+        return true;
+    }
+
+    persistSegmentState();
+    _segmentPersistTimer.start();
+    propagator()->_activeJobList.append(this);
+    _downloadRequests += _segmentJobs.size();
+    _segmentsRunning = _segmentJobs.size();
+    for (const auto &job : std::as_const(_segmentJobs)) {
+        job->start();
+    }
+    return true;
+}
+
+void PropagateDownloadFile::persistSegmentState()
+{
+    auto pi = propagator()->_journal->getDownloadInfo(_item->_file);
+    if (!pi._valid) {
+        return;
+    }
+    pi._segments = _segmentReceived.isEmpty() ? QByteArray() : serializeSegments(_segmentSize, _segmentReceived, _segmentDigests);
+    propagator()->_journal->setDownloadInfo(_item->_file, pi);
+}
+
+void PropagateDownloadFile::slotSegmentProgressed()
+{
+    qint64 received = 0;
+    for (const auto &job : std::as_const(_segmentJobs)) {
+        if (job) {
+            _segmentReceived[int(job->offset() / _segmentSize)] = job->received();
+        }
+    }
+    for (const qint64 r : std::as_const(_segmentReceived)) {
+        received += r;
+    }
+    _downloadProgress = received;
+    propagator()->reportProgress(*_item, received);
+
+    // Persist progress once in a while so an interrupted transfer resumes
+    // mid-segment instead of re-downloading everything.
+    if (_segmentPersistTimer.elapsed() > 5000) {
+        _segmentPersistTimer.start();
+        persistSegmentState();
+    }
+}
+
+void PropagateDownloadFile::slotSegmentFinished()
+{
+    auto *job = qobject_cast<GETFileSegmentJob *>(sender());
+    OC_ASSERT(job);
+    _segmentsRunning--;
+
+    const int segmentIndex = int(job->offset() / _segmentSize);
+    _segmentReceived[segmentIndex] = job->received();
+    _segmentDigests[segmentIndex] = job->segmentDigest();
+
+    const QNetworkReply::NetworkError err = job->reply()->error();
+    if (err != QNetworkReply::NoError) {
+        if (job->serverIgnoredRange() && !_segmentFallback && _segmentErrorString.isEmpty()) {
+            // Range is unsupported: give up on segments for this item and
+            // cancel the siblings; the last one to finish restarts.
+            _segmentFallback = true;
+            for (const auto &other : std::as_const(_segmentJobs)) {
+                if (other && other != job) {
+                    other->abort();
+                }
+            }
+        } else if (!_segmentFallback && _segmentErrorString.isEmpty()) {
+            // Keep the first real error; the cancellations it causes below
+            // must not overwrite it.
+            _item->_httpErrorCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            _item->_responseTimeStamp = job->responseTimestamp();
+            _item->_requestId = job->requestId();
+            _segmentErrorString = job->errorString();
+            _segmentErrorStatus = job->errorStatus();
+            if (_segmentErrorStatus == SyncFileItem::NoStatus) {
+                QByteArray errorBody; // segments carry no usable body
+                _segmentErrorStatus = classifyError(err, _item->_httpErrorCode, &propagator()->_anotherSyncNeeded, errorBody);
+            }
+            for (const auto &other : std::as_const(_segmentJobs)) {
+                if (other && other != job) {
+                    other->abort();
+                }
+            }
+        }
+    } else if (!_segmentFallback && _segmentErrorString.isEmpty()) {
+        // Mixing bytes of two server-side revisions would corrupt the file:
+        // every segment must report the same etag.
+        if (_segmentEtag.isEmpty()) {
+            _segmentEtag = job->etag();
+            _segmentLastModified = job->lastModified();
+            captureReplyHeaders(job->reply());
+        } else if (_segmentEtag != job->etag()) {
+            qCWarning(lcPropagateDownload) << "Segments returned different etags for" << _item->_file
+                                           << _segmentEtag << "vs" << job->etag();
+            propagator()->_anotherSyncNeeded = true;
+            _segmentErrorString = tr("The file changed on the server during the download. It will be retried.");
+            _segmentErrorStatus = SyncFileItem::SoftError;
+            for (const auto &other : std::as_const(_segmentJobs)) {
+                if (other && other != job) {
+                    other->abort();
+                }
+            }
+        }
+    }
+
+    if (_segmentsRunning > 0) {
+        return;
+    }
+    propagator()->_activeJobList.removeOne(this);
+
+    if (_segmentFallback) {
+        fallBackToSingleStream();
+        return;
+    }
+    if (!_segmentErrorString.isEmpty()) {
+        // The finished parts stay on disk and in the journal for resuming.
+        persistSegmentState();
+        done(_segmentErrorStatus, _segmentErrorString);
+        return;
+    }
+    segmentedDownloadComplete();
+}
+
+void PropagateDownloadFile::fallBackToSingleStream()
+{
+    qCWarning(lcPropagateDownload) << "Falling back to a single-stream download for" << _item->_file;
+    _segmentedDisabled = true;
+    _segmentJobs.clear();
+    _segmentReceived.clear();
+    _segmentDigests.clear();
+    _segmentEtag.clear();
+    // Discard the partial segment writes, they are not contiguous.
+    _tmpFile.resize(0);
+    _resumeStart = 0;
+    persistSegmentState();
+    startFullDownload();
+}
+
+void PropagateDownloadFile::segmentedDownloadComplete()
+{
+    if (!_segmentEtag.isEmpty()) {
+        _item->_etag = _segmentEtag;
+    }
+    if (_segmentLastModified) {
+        _item->_modtime = _segmentLastModified;
+    }
+
+    _tmpFile.close();
+    _tmpFile.flush();
+
+    if (_tmpFile.size() != _item->_size) {
+        qCWarning(lcPropagateDownload) << "Segmented download size mismatch:" << _tmpFile.size() << "!=" << _item->_size;
+        propagator()->_anotherSyncNeeded = true;
+        done(SyncFileItem::SoftError, tr("The file could not be downloaded completely."));
+        return;
+    }
+
+    qCInfo(lcPropagateDownload) << "All segments of" << _item->_file << "are on disk";
+    _checksumStopwatch.start();
+    validateDownload();
+}
+
 qint64 PropagateDownloadFile::committedDiskSpace() const
 {
     if (state() == Running) {
@@ -645,6 +1363,7 @@ void PropagateDownloadFile::slotGetFinished()
             // If this was with a direct download, retry without direct download
             qCWarning(lcPropagateDownload) << "Direct download of" << _item->_directDownloadUrl << "failed. Retrying through owncloud.";
             _item->_directDownloadUrl.clear();
+            _retryCount++;
             start();
             return;
         }
@@ -739,19 +1458,30 @@ void PropagateDownloadFile::slotGetFinished()
         return;
     }
 
+    captureReplyHeaders(job->reply());
+
+    _timeToFirstByte = job->timeToFirstByte();
+    _downloadStalls += job->stalls();
+    _downloadStalledFor += job->stalledFor();
+    _checksumStopwatch.start();
+    validateDownload(job->streamedChecksum());
+}
+
+void PropagateDownloadFile::captureReplyHeaders(QNetworkReply *reply)
+{
     // Did the file come with conflict headers? If so, store them now!
     // If we download conflict files but the server doesn't send conflict
     // headers, the record will be established by SyncEngine::conflictRecordMaintenance.
     // (we can't reliably determine the file id of the base file here,
     // it might still be downloaded in a parallel job and not exist in
     // the database yet!)
-    if (job->reply()->rawHeader("OC-Conflict") == "1") {
+    if (reply->rawHeader("OC-Conflict") == "1") {
         _conflictRecord.path = _item->_file.toUtf8();
-        _conflictRecord.initialBasePath = job->reply()->rawHeader("OC-ConflictInitialBasePath");
-        _conflictRecord.baseFileId = job->reply()->rawHeader("OC-ConflictBaseFileId");
-        _conflictRecord.baseEtag = job->reply()->rawHeader("OC-ConflictBaseEtag");
+        _conflictRecord.initialBasePath = reply->rawHeader("OC-ConflictInitialBasePath");
+        _conflictRecord.baseFileId = reply->rawHeader("OC-ConflictBaseFileId");
+        _conflictRecord.baseEtag = reply->rawHeader("OC-ConflictBaseEtag");
 
-        auto mtimeHeader = job->reply()->rawHeader("OC-ConflictBaseMtime");
+        auto mtimeHeader = reply->rawHeader("OC-ConflictBaseMtime");
         if (!mtimeHeader.isEmpty())
             _conflictRecord.baseModtime = mtimeHeader.toLongLong();
 
@@ -760,6 +1490,14 @@ void PropagateDownloadFile::slotGetFinished()
         // job will be deleted later.
     }
 
+    _downloadChecksumHeader = findBestChecksum(reply->rawHeader(checkSumHeaderC));
+    const auto contentMd5Header = reply->rawHeader(contentMd5HeaderC);
+    if (_downloadChecksumHeader.isEmpty() && !contentMd5Header.isEmpty())
+        _downloadChecksumHeader = "MD5:" + contentMd5Header;
+}
+
+void PropagateDownloadFile::validateDownload(const StreamingChecksum *streamed)
+{
     // Do checksum validation for the download. If there is no checksum header, the validator
     // will also Q_EMIT the validated() signal to continue the flow in slot transmissionChecksumValidated()
     // as this is (still) also correct.
@@ -768,14 +1506,99 @@ void PropagateDownloadFile::slotGetFinished()
         this, &PropagateDownloadFile::transmissionChecksumValidated);
     connect(validator, &ValidateChecksumHeader::validationFailed,
         this, &PropagateDownloadFile::slotChecksumFail);
-    auto checksumHeader = findBestChecksum(job->reply()->rawHeader(checkSumHeaderC));
-    auto contentMd5Header = job->reply()->rawHeader(contentMd5HeaderC);
-    if (checksumHeader.isEmpty() && !contentMd5Header.isEmpty())
-        checksumHeader = "MD5:" + contentMd5Header;
-    validator->start(_tmpFile.fileName(), checksumHeader);
+    // A checksum hashed while the body streamed in spares the validator
+    // from reading the whole temp file back.
+    if (streamed && validator->validatePrecomputed(streamed->checksumType(), streamed->result(), _downloadChecksumHeader)) {
+        return;
+    }
+    validator->start(_tmpFile.fileName(), _downloadChecksumHeader);
+}
+
+namespace {
+    /** Re-hashes one byte range of the temp file, see slotChecksumFail().
+     *
+     * Returns true when the bytes still match the digest that was recorded
+     * while they were downloaded.
+     */
+    bool segmentMatchesDigest(QFile *file, qint64 offset, qint64 size, const QByteArray &digest)
+    {
+        if (digest.isEmpty() || !file->seek(offset)) {
+            return false;
+        }
+        StreamingChecksum hash(segmentDigestAlgorithm);
+        QByteArray buffer(500 * 1024, Qt::Uninitialized);
+        qint64 remaining = size;
+        while (remaining > 0) {
+            const qint64 read = file->read(buffer.data(), std::min<qint64>(buffer.size(), remaining));
+            if (read <= 0) {
+                return false;
+            }
+            hash.update(buffer.constData(), read);
+            remaining -= read;
+        }
+        return hash.result() == digest;
+    }
 }
 
 void PropagateDownloadFile::slotChecksumFail(const QString &errMsg)
+{
+    // A segmented download recorded a digest per segment while it arrived.
+    // Before throwing the whole temp file away, find out whether the
+    // mismatch comes from local corruption of individual segments (a bad
+    // write, bit rot on the partial file): those can be re-fetched on
+    // their own, which for a large file is much cheaper than starting
+    // over.
+    const bool haveSegmentDigests = std::any_of(_segmentDigests.cbegin(), _segmentDigests.cend(),
+        [](const QByteArray &digest) { return !digest.isEmpty(); });
+    if (!haveSegmentDigests) {
+        restartAfterChecksumFail(errMsg);
+        return;
+    }
+
+    const QString fileName = _tmpFile.fileName();
+    const qint64 fileSize = _item->_size;
+    const qint64 segmentSize = _segmentSize;
+    const QVector<QByteArray> digests = _segmentDigests;
+    auto *watcher = new QFutureWatcher<QVector<int>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, errMsg] {
+        watcher->deleteLater();
+        const QVector<int> corrupt = watcher->result();
+        if (corrupt.isEmpty() || corrupt.size() == _segmentDigests.size()) {
+            // Either every segment still holds exactly what was received -
+            // then the server sent something else than its checksum header
+            // promised - or nothing does: only a full restart can help.
+            restartAfterChecksumFail(errMsg);
+            return;
+        }
+        qCWarning(lcPropagateDownload) << "Local corruption in" << corrupt.size() << "of"
+                                       << _segmentDigests.size() << "segments of" << _item->_file
+                                       << "- keeping the others for the retry";
+        for (const int i : corrupt) {
+            _segmentReceived[i] = 0;
+            _segmentDigests[i].clear();
+        }
+        persistSegmentState();
+        propagator()->_anotherSyncNeeded = true;
+        done(SyncFileItem::SoftError, errMsg);
+    });
+    watcher->setFuture(QtConcurrent::run([fileName, fileSize, segmentSize, digests]() {
+        QVector<int> corrupt;
+        QFile file(fileName);
+        const bool opened = file.open(QIODevice::ReadOnly);
+        for (int i = 0; i < digests.size(); ++i) {
+            const qint64 offset = qint64(i) * segmentSize;
+            const qint64 size = std::min(segmentSize, fileSize - offset);
+            // Segments without a digest (a resumed prefix went into them)
+            // cannot be cleared of suspicion and are re-fetched as well.
+            if (!opened || !segmentMatchesDigest(&file, offset, size, digests.at(i))) {
+                corrupt.append(i);
+            }
+        }
+        return corrupt;
+    }));
+}
+
+void PropagateDownloadFile::restartAfterChecksumFail(const QString &errMsg)
 {
     FileSystem::remove(_tmpFile.fileName());
     propagator()->_anotherSyncNeeded = true;
@@ -830,6 +1653,10 @@ void PropagateDownloadFile::contentChecksumComputed(CheckSums::Algorithm checksu
 {
     _item->_checksumHeader = ChecksumHeader(checksumType, checksum).makeChecksumHeader();
 
+    if (_checksumStopwatch.isValid()) {
+        _checksumDuration = std::chrono::milliseconds(_checksumStopwatch.elapsed());
+    }
+
     downloadFinished();
 }
 
@@ -850,7 +1677,11 @@ void PropagateDownloadFile::downloadFinished()
     // Accuracy, and we really need the time from the file system. (#3103)
     _item->_modtime = FileSystem::getModTime(_tmpFile.fileName());
 
-    bool previousFileExists = FileSystem::fileExists(fn);
+    // In-place downloads already sit at the final name: what exists there
+    // is this download itself, and there is nothing to rename.
+    const bool downloadedInPlace = _tmpFile.fileName() == fn;
+
+    bool previousFileExists = !downloadedInPlace && FileSystem::fileExists(fn);
     if (previousFileExists) {
         // Preserve the existing file permissions.
         QFileInfo existingFile(fn);
@@ -903,7 +1734,7 @@ void PropagateDownloadFile::downloadFinished()
 
     QString error;
     // The fileChanged() check is done above to generate better error messages.
-    if (!FileSystem::uncheckedRenameReplace(_tmpFile.fileName(), fn, &error)) {
+    if (!downloadedInPlace && !FileSystem::uncheckedRenameReplace(_tmpFile.fileName(), fn, &error)) {
         qCWarning(lcPropagateDownload) << "Rename failed:" << _tmpFile.fileName() << "=>" << fn << "with error:" << error;
         propagator()->_anotherSyncNeeded = true;
         done(SyncFileItem::SoftError, error);
@@ -912,6 +1743,10 @@ void PropagateDownloadFile::downloadFinished()
 
     FileSystem::setFileHidden(fn, false);
 
+    // Opt-in durability for the rename: batched, so a storm of small files
+    // costs one fsync per directory instead of one per file.
+    propagator()->scheduleDirectorySync(QFileInfo(fn).absolutePath());
+
     // Maybe we downloaded a newer version of the file than we thought we would...
     // Get up-to-date information for the journal.
     _item->_size = FileSystem::getSize(QFileInfo{fn});
@@ -925,6 +1760,16 @@ void PropagateDownloadFile::downloadFinished()
     updateMetadata(isConflict);
 }
 
+void PropagateDownloadFile::finishPlaceholderCreation(const Result<void, QString> &result)
+{
+    if (!result) {
+        done(SyncFileItem::NormalError, result.error());
+        return;
+    }
+    // Conflicts never enter the batcher, see start().
+    updateMetadata(false);
+}
+
 void PropagateDownloadFile::updateMetadata(bool isConflict)
 {
     const auto result = propagator()->updateMetadata(*_item);
@@ -936,7 +1781,7 @@ void PropagateDownloadFile::updateMetadata(bool isConflict)
         return;
     }
     propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
-    propagator()->_journal->commit(QStringLiteral("download file start2"));
+    propagator()->_journal->commitAsync(QStringLiteral("download file start2"));
 
     done(isConflict ? SyncFileItem::Conflict : SyncFileItem::Success);
 
@@ -953,6 +1798,24 @@ void PropagateDownloadFile::updateMetadata(bool isConflict)
     if (isLikelyFinishedQuickly() && duration > 5s) {
         qCWarning(lcPropagateDownload) << "WARNING: Unexpectedly slow connection, took" << duration.count() << "ms for" << _item->_size - _resumeStart << "bytes for" << _item->_file;
     }
+
+    // Dehydrations and checksum-equal shortcuts never issued a GET and
+    // produce no record.
+    if (_downloadRequests > 0) {
+        TransferMetrics metrics;
+        metrics.file = _item->_file;
+        metrics.direction = TransferMetrics::Direction::Download;
+        metrics.bytes = _item->_size;
+        metrics.duration = duration;
+        metrics.checksumDuration = _checksumDuration;
+        metrics.timeToFirstByte = _timeToFirstByte;
+        metrics.stalls = _downloadStalls;
+        metrics.stalledFor = _downloadStalledFor;
+        metrics.chunks = _downloadRequests;
+        metrics.retries = _retryCount;
+        qCDebug(lcPropagateDownload) << metrics;
+        Q_EMIT propagator()->transferMetrics(metrics);
+    }
 }
 
 void PropagateDownloadFile::slotDownloadProgress(qint64 received, qint64)
@@ -970,6 +1833,11 @@ void PropagateDownloadFile::abort(PropagatorJob::AbortType abortType)
     if (_job) {
         _job->abort();
     }
+    for (const auto &job : std::as_const(_segmentJobs)) {
+        if (job) {
+            job->abort();
+        }
+    }
     if (abortType == AbortType::Asynchronous) {
         Q_EMIT abortFinished();
     }
@@ -14,13 +14,22 @@
 #pragma once
 
 #include "common/checksumalgorithms.h"
+#include "common/checksums.h"
 #include "networkjobs.h"
 #include "owncloudpropagator.h"
 
 #include <QFile>
 
+#include <chrono>
+#include <memory>
+
 namespace OCC {
 
+class BandwidthLimiter;
+
+/// Builds the hidden ".name.~hex" temporary file name used for downloads.
+QString OWNCLOUDSYNC_EXPORT createDownloadTmpFileName(const QString &previous);
+
 /**
  * @brief Downloads the remote file via GET
  * @ingroup libsync
@@ -34,6 +43,24 @@ class OWNCLOUDSYNC_EXPORT GETFileJob : public AbstractNetworkJob
     qint64 _expectedContentLength;
     qint64 _contentLength;
     qint64 _resumeStart;
+    /// The account's shared download pacer, inactive without a rate cap.
+    BandwidthLimiter *_limiter;
+    /// See timeToFirstByte()
+    QElapsedTimer _ttfbTimer;
+    std::chrono::milliseconds _timeToFirstByte { 0 };
+    /// See streamedChecksum()
+    std::unique_ptr<StreamingChecksum> _streamingChecksum;
+    /// See setDropWriteCache()
+    bool _dropWriteCache = false;
+    qint64 _cacheDropEnd = 0;
+    /// Reused across readyRead bursts, so draining the reply does not
+    /// allocate per burst. Sized in slotReadyRead().
+    QByteArray _readBuffer;
+    /// See stalls()
+    QElapsedTimer _lastDataReceived;
+    QTimer *_stallTimer = nullptr;
+    int _stalls = 0;
+    std::chrono::milliseconds _stalledFor { 0 };
 
 public:
     // DOES NOT take ownership of the device.
@@ -57,6 +84,24 @@ public:
     qint64 expectedContentLength() const { return _expectedContentLength; }
     void setExpectedContentLength(qint64 size) { _expectedContentLength = size; }
 
+    /// Time from sending the request until the response headers arrived
+    std::chrono::milliseconds timeToFirstByte() const { return _timeToFirstByte; }
+
+    /** Mid-transfer windows in which no data arrived, and the time lost
+     * to them. Together with timeToFirstByte() this distinguishes a slow
+     * start from a connection that stalls while streaming.
+     */
+    int stalls() const { return _stalls; }
+    std::chrono::milliseconds stalledFor() const { return _stalledFor; }
+
+    /** Checksum of the body, hashed while it was written to the device.
+     *
+     * Only available when this request carried the whole file (no resume,
+     * no restart with partial data) and the server announced a checksum.
+     * Callers can then validate without re-reading the finished file.
+     */
+    const StreamingChecksum *streamedChecksum() const { return _streamingChecksum.get(); }
+
     QString &etag() { return _etag; }
     time_t lastModified() { return _lastModified; }
 
@@ -65,6 +110,9 @@ public:
     SyncFileItem::Status errorStatus() { return _errorStatus; }
     void setErrorStatus(const SyncFileItem::Status &s) { _errorStatus = s; }
 
+    /// Periodically evict the written data from the OS page cache
+    void setDropWriteCache(bool enable) { _dropWriteCache = enable; }
+
 private Q_SLOTS:
     void slotReadyRead();
     void slotMetaDataChanged();
@@ -82,6 +130,86 @@ protected:
     bool _httpOk = false;
 };
 
+/**
+ * @brief Downloads one byte range of a remote file into the temp file at its offset
+ *
+ * Building block of the segmented download: several of these run
+ * concurrently, each writing through its own file handle, coordinated by
+ * PropagateDownloadFile. A server that ignores the Range header answers
+ * 200 instead of 206; the job then refuses to write and reports it via
+ * serverIgnoredRange() so the coordinator can fall back to a single
+ * stream.
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT GETFileSegmentJob : public AbstractNetworkJob
+{
+    Q_OBJECT
+public:
+    GETFileSegmentJob(Account *account, const QUrl &rootUrl, const QString &path, const QString &localFile,
+        qint64 offset, qint64 size, qint64 alreadyReceived, QObject *parent = nullptr);
+
+    /// Opens the local file handle; must be called before start().
+    bool openFile(QString *error);
+
+    void start() override;
+    void finished() override;
+    void newReplyHook(QNetworkReply *reply) override;
+
+    qint64 offset() const { return _offset; }
+    qint64 size() const { return _size; }
+    /// Bytes of this segment on disk, including a resumed prefix
+    qint64 received() const { return _received; }
+    bool serverIgnoredRange() const { return _serverIgnoredRange; }
+    QString etag() const { return _etag; }
+    time_t lastModified() const { return _lastModified; }
+    QString errorString() const;
+    SyncFileItem::Status errorStatus() const { return _errorStatus; }
+
+    /** Hex digest of this segment's bytes, hashed while they were written.
+     *
+     * Empty when the segment is not complete yet, or when it resumed a
+     * prefix from an earlier run: those bytes never passed through this
+     * job, so their digest cannot be produced here.
+     */
+    QByteArray segmentDigest() const;
+
+    /// Periodically evict the written data from the OS page cache
+    void setDropWriteCache(bool enable)
+    {
+        _dropWriteCache = enable;
+        _cacheDropEnd = _received;
+    }
+
+Q_SIGNALS:
+    /// More bytes of this segment arrived on disk
+    void progressed();
+
+private Q_SLOTS:
+    void slotReadyRead();
+    void slotMetaDataChanged();
+
+private:
+    QFile _file;
+    qint64 _offset;
+    qint64 _size;
+    qint64 _received;
+    /// The account's shared download pacer, inactive without a rate cap.
+    BandwidthLimiter *_limiter;
+    QString _etag;
+    time_t _lastModified = 0;
+    QString _errorString;
+    SyncFileItem::Status _errorStatus = SyncFileItem::NoStatus;
+    bool _httpOk = false;
+    bool _serverIgnoredRange = false;
+    /// See setDropWriteCache()
+    bool _dropWriteCache = false;
+    qint64 _cacheDropEnd = 0;
+    /// See segmentDigest()
+    std::unique_ptr<StreamingChecksum> _streamingChecksum;
+    /// Reused across readyRead bursts, see GETFileJob::_readBuffer
+    QByteArray _readBuffer;
+};
+
 /**
  * @brief The PropagateDownloadFile class
  * @ingroup libsync
@@ -128,6 +256,7 @@ protected:
 class PropagateDownloadFile : public PropagateItemJob
 {
     Q_OBJECT
+    friend class PlaceholderBatcher;
     QString _expectedEtagForResume;
 
 public:
@@ -155,6 +284,11 @@ public:
      */
     void setDeleteExistingFolder(bool enabled);
 
+    /** Continuation after the PlaceholderBatcher created (or failed to
+     * create) this job's placeholder, see start().
+     */
+    void finishPlaceholderCreation(const Result<void, QString> &result);
+
 private Q_SLOTS:
     /// Called when ComputeChecksum on the local file finishes,
     /// maybe the local and remote checksums are identical?
@@ -176,16 +310,89 @@ private Q_SLOTS:
     void slotDownloadProgress(qint64, qint64);
     void slotChecksumFail(const QString &errMsg);
 
+    /// Called when one segment of a segmented download wrote more bytes
+    void slotSegmentProgressed();
+    /// Called when one segment of a segmented download finishes
+    void slotSegmentFinished();
+
 private:
     void deleteExistingFolder();
 
+    /** Starts the segmented download when it applies to this item.
+     *
+     * Returns false when the item should take the single-stream path:
+     * segmentation is not enabled, the file is too small, or a previous
+     * attempt showed that the server ignores Range requests.
+     */
+    bool startSegmentedDownload();
+    /// Writes the per-segment progress into the journal's DownloadInfo
+    void persistSegmentState();
+    /// All segments are on disk: verify and continue with checksum validation
+    void segmentedDownloadComplete();
+    /// Restarts the whole transfer as a single stream
+    void fallBackToSingleStream();
+
+    /// Grabs the conflict and checksum headers carried by a GET response
+    void captureReplyHeaders(QNetworkReply *reply);
+
+    /** Starts the checksum-header validation on the finished temp file.
+     *
+     * Common tail of the single-stream and segmented paths. Works with an
+     * empty checksum header, e.g. when a resumed segmented download had
+     * nothing left to fetch: the validator then just passes the file on.
+     *
+     * When a checksum hashed during the transfer is passed in and its
+     * algorithm matches the header, validation completes without reading
+     * the temp file again.
+     */
+    void validateDownload(const StreamingChecksum *streamed = nullptr);
+
+    /** Discards the temp file after a failed validation.
+     *
+     * The pre-digest behavior of slotChecksumFail(): the next sync attempt
+     * downloads the file from scratch.
+     */
+    void restartAfterChecksumFail(const QString &errMsg);
+
     qint64 _resumeStart;
     qint64 _downloadProgress;
     QPointer<GETFileJob> _job;
     QFile _tmpFile;
+    /// _tmpFile is the final path: brand-new file, no rename at the end
+    bool _downloadInPlace = false;
     bool _deleteExisting;
     ConflictRecord _conflictRecord;
 
     QElapsedTimer _stopwatch;
+
+    /// State of the segmented download, see startSegmentedDownload()
+    QVector<QPointer<GETFileSegmentJob>> _segmentJobs;
+    QVector<qint64> _segmentReceived;
+    /// Hex digest per fully downloaded segment, empty entries where unknown
+    QVector<QByteArray> _segmentDigests;
+    qint64 _segmentSize = 0;
+    int _segmentsRunning = 0;
+    /// Per-segment progress blob from the journal, if a previous run left one
+    QByteArray _segmentResume;
+    /// First error seen among the segments; later cancellations keep it
+    QString _segmentErrorString;
+    SyncFileItem::Status _segmentErrorStatus = SyncFileItem::NoStatus;
+    /// Etag the first segment came back with; all others must match
+    QString _segmentEtag;
+    time_t _segmentLastModified = 0;
+    /// Checksum header from the server response, see captureReplyHeaders()
+    QByteArray _downloadChecksumHeader;
+    bool _segmentedDisabled = false;
+    bool _segmentFallback = false;
+    QElapsedTimer _segmentPersistTimer;
+
+    /// Raw material for the TransferMetrics record emitted by updateMetadata()
+    QElapsedTimer _checksumStopwatch;
+    std::chrono::milliseconds _checksumDuration { 0 };
+    std::chrono::milliseconds _timeToFirstByte { 0 };
+    int _downloadStalls = 0;
+    std::chrono::milliseconds _downloadStalledFor { 0 };
+    int _downloadRequests = 0;
+    int _retryCount = 0;
 };
 }
@@ -172,7 +172,7 @@ void PropagateRemoteMove::finalize()
         }
     }
 
-    propagator()->_journal->commit(QStringLiteral("Remote Rename"));
+    propagator()->_journal->commitAsync(QStringLiteral("Remote Rename"));
     done(SyncFileItem::Success);
 }
 
@@ -52,7 +52,7 @@ public:
     }
     void start() override;
     void abort(PropagatorJob::AbortType abortType) override;
-    JobParallelism parallelism() override { return _item->isDirectory() ? WaitForFinished : FullParallelism; }
+    QStringList exclusivePaths() const override { return _item->isDirectory() ? affectedPaths() : QStringList(); }
 
     /**
      * Rename the directory in the selective sync list
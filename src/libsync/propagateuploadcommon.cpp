@@ -25,6 +25,7 @@
 #include "owncloudpropagator_p.h"
 #include "propagateremotedelete.h"
 #include "syncengine.h"
+#include "uploadbundler.h"
 
 #include "libsync/theme.h"
 
@@ -75,6 +76,8 @@ void PropagateUploadCommon::start()
         return;
     }
 
+    _transferTimer.reset();
+
     // Check if the specific file can be accessed
     if (propagator()->hasCaseClashAccessibilityProblem(_item->_file)) {
         done(SyncFileItem::NormalError, tr("File %1 cannot be uploaded because another file with the same name, differing only in case, exists").arg(QDir::toNativeSeparators(_item->_file)));
@@ -110,6 +113,8 @@ void PropagateUploadCommon::slotComputeContentChecksum()
         return;
     }
 
+    _checksumTimer.reset();
+
     const QString filePath = propagator()->fullLocalPath(_item->_file);
 
     // remember the modtime before computing the checksum to be able to detect a file
@@ -125,6 +130,19 @@ void PropagateUploadCommon::slotComputeContentChecksum()
         return;
     }
 
+    // Or an earlier run hashed this very file under another path? Re-shares
+    // and moved folders arrive without a journal record but with an
+    // unchanged inode, size and mtime.
+    if (_item->_inode > 0) {
+        const auto cached = ChecksumHeader::parseChecksumHeader(
+            propagator()->_journal->checksumCacheEntry(_item->_inode, _item->_size, _item->_modtime));
+        if (cached.type() == checksumType) {
+            qCInfo(lcPropagateUpload) << "Reusing cached content checksum for" << filePath;
+            slotComputeTransmissionChecksum(checksumType, cached.checksum());
+            return;
+        }
+    }
+
     // we must be able to read the file
     if (FileSystem::isFileLocked(filePath, FileSystem::LockMode::SharedRead)) {
         Q_EMIT propagator()->seenLockedFile(filePath, FileSystem::LockMode::SharedRead);
@@ -132,12 +150,45 @@ void PropagateUploadCommon::slotComputeContentChecksum()
         return;
     }
 
-    // Compute the content checksum.
+    // When the transmission checksum needs a different algorithm than the
+    // content checksum, fold both digests into a single read of the file
+    // instead of hashing it twice back to back.
+    const auto transmissionChecksumType = [this, checksumType] {
+        if (propagator()->account()->capabilities().supportedChecksumTypes().contains(checksumType)) {
+            return checksumType;
+        }
+        return uploadChecksumEnabled() ? propagator()->account()->capabilities().transmissionChecksumType()
+                                       : CheckSums::Algorithm::PARSE_ERROR;
+    }();
+    if (transmissionChecksumType != checksumType) {
+        auto computeChecksums = new ComputeMultipleChecksums(this);
+        computeChecksums->setChecksumTypes({ checksumType, transmissionChecksumType });
+        connect(computeChecksums, &ComputeMultipleChecksums::done,
+            this, [this, checksumType, transmissionChecksumType](const QVector<QByteArray> &checksums) {
+                _item->_checksumHeader = ChecksumHeader(checksumType, checksums.value(0)).makeChecksumHeader();
+                if (!checksums.value(0).isEmpty()) {
+                    propagator()->_journal->setChecksumCacheEntry(_item->_inode, _item->_size, _item->_modtime, _item->_checksumHeader);
+                }
+                slotStartUpload(transmissionChecksumType, checksums.value(1));
+            });
+        connect(computeChecksums, &ComputeMultipleChecksums::done,
+            computeChecksums, &QObject::deleteLater);
+        computeChecksums->start(filePath);
+        return;
+    }
+
+    // Compute the content checksum; it doubles as the transmission checksum.
     auto computeChecksum = new ComputeChecksum(this);
     computeChecksum->setChecksumType(checksumType);
 
     connect(computeChecksum, &ComputeChecksum::done,
-        this, &PropagateUploadCommon::slotComputeTransmissionChecksum);
+        this, [this](CheckSums::Algorithm type, const QByteArray &checksum) {
+            if (!checksum.isEmpty()) {
+                propagator()->_journal->setChecksumCacheEntry(
+                    _item->_inode, _item->_size, _item->_modtime, ChecksumHeader(type, checksum).makeChecksumHeader());
+            }
+            slotComputeTransmissionChecksum(type, checksum);
+        });
     connect(computeChecksum, &ComputeChecksum::done,
         computeChecksum, &QObject::deleteLater);
     computeChecksum->start(filePath);
@@ -166,7 +217,7 @@ void PropagateUploadCommon::slotComputeTransmissionChecksum(CheckSums::Algorithm
     // Compute the transmission checksum.
     auto computeChecksum = new ComputeChecksum(this);
     if (uploadChecksumEnabled()) {
-        computeChecksum->setChecksumType(propagator()->account()->capabilities().uploadChecksumType());
+        computeChecksum->setChecksumType(propagator()->account()->capabilities().transmissionChecksumType());
     } else {
         computeChecksum->setChecksumType(CheckSums::Algorithm::PARSE_ERROR);
     }
@@ -184,6 +235,8 @@ void PropagateUploadCommon::slotStartUpload(CheckSums::Algorithm transmissionChe
     // When we start chunks, we will add it again, once for every chunk.
     propagator()->_activeJobList.removeOne(this);
 
+    _checksumTimer.stop();
+
     _transmissionChecksumHeader = ChecksumHeader(transmissionChecksumType, transmissionChecksum).makeChecksumHeader();
 
     // If no checksum header was not set, reuse the transmission checksum as the content checksum.
@@ -213,9 +266,29 @@ void PropagateUploadCommon::slotStartUpload(CheckSums::Algorithm transmissionChe
         return;
     }
 
+    // Tiny files pay more in per-request overhead than in payload: hand
+    // them to the bundler when the server takes many files per request.
+    if (propagator()->uploadBundler()->canBundle(this)) {
+        propagator()->uploadBundler()->enqueue(this);
+        return;
+    }
+
     doStartUpload();
 }
 
+void PropagateUploadCommon::bundledUploadDone(const QString &etag, const QByteArray &fileId, const QString &remotePerm)
+{
+    _item->_etag = etag;
+    if (!fileId.isEmpty()) {
+        _item->_fileId = fileId;
+    }
+    if (!remotePerm.isEmpty()) {
+        _item->_remotePerm = RemotePermissions::fromServerString(remotePerm);
+    }
+    _finished = true;
+    finalize();
+}
+
 void PropagateUploadCommon::done(SyncFileItem::Status status, const QString &errorString)
 {
     _finished = true;
@@ -238,7 +311,7 @@ void PropagateUploadCommon::checkResettingErrors()
                                       << "is" << uploadInfo._errorCount;
         }
         propagator()->_journal->setUploadInfo(_item->_file, uploadInfo);
-        propagator()->_journal->commit(QStringLiteral("Upload info"));
+        propagator()->_journal->commitAsync(QStringLiteral("Upload info"));
     }
 }
 
@@ -404,7 +477,19 @@ void PropagateUploadCommon::finalize()
 
     // Remove from the progress database:
     propagator()->_journal->setUploadInfo(_item->_file, SyncJournalDb::UploadInfo());
-    propagator()->_journal->commit(QStringLiteral("upload file start"));
+    propagator()->_journal->commitAsync(QStringLiteral("upload file start"));
+
+    _transferTimer.stop();
+    TransferMetrics metrics;
+    metrics.file = _item->_file;
+    metrics.direction = TransferMetrics::Direction::Upload;
+    metrics.bytes = _item->_size;
+    metrics.duration = std::chrono::duration_cast<std::chrono::milliseconds>(_transferTimer.duration());
+    metrics.checksumDuration = std::chrono::duration_cast<std::chrono::milliseconds>(_checksumTimer.duration());
+    metrics.chunks = _chunkCount;
+    metrics.retries = _retryCount;
+    qCDebug(lcPropagateUpload) << metrics;
+    Q_EMIT propagator()->transferMetrics(metrics);
 
     done(SyncFileItem::Success);
 }
@@ -46,6 +46,9 @@ class PropagateUploadCommon : public PropagateItemJob
 {
     Q_OBJECT
 
+    // Builds bundle parts from our item, headers and checksum.
+    friend class UploadBundler;
+
 protected:
     static const QString fileChangedMessage();
 
@@ -62,6 +65,13 @@ protected:
 
     QByteArray _transmissionChecksumHeader;
 
+    /// Raw material for the TransferMetrics record emitted by finalize().
+    /// The counters are maintained by the concrete upload implementations.
+    Utility::ChronoElapsedTimer _transferTimer;
+    Utility::ChronoElapsedTimer _checksumTimer;
+    int _chunkCount = 0;
+    int _retryCount = 0;
+
 public:
     PropagateUploadCommon(OwncloudPropagator *propagator, const SyncFileItemPtr &item)
         : PropagateItemJob(propagator, item)
@@ -93,6 +103,13 @@ private Q_SLOTS:
 public:
     virtual void doStartUpload() = 0;
 
+    /** Called by the UploadBundler when a bundle placed our item.
+     *
+     * Applies the server's result as if we had uploaded individually and
+     * finalizes; a missing permission string is fetched by finalize().
+     */
+    void bundledUploadDone(const QString &etag, const QByteArray &fileId, const QString &remotePerm);
+
     void finalize();
     void abortWithError(SyncFileItem::Status status, const QString &error);
 
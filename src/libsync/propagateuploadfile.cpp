@@ -52,7 +52,7 @@ void PropagateUploadFile::doStartUpload()
     pi._transferid = 0; // We set a null transfer id because it is not chunked.
     pi._errorCount = 0;
     propagator()->_journal->setUploadInfo(_item->_file, pi);
-    propagator()->_journal->commit(QStringLiteral("Upload info"));
+    propagator()->_journal->commitAsync(QStringLiteral("Upload info"));
 
     propagator()->reportProgress(*_item, 0);
     startUpload();
@@ -76,6 +76,7 @@ void PropagateUploadFile::startUpload()
 
     const QString fileName = propagator()->fullLocalPath(_item->_file);
     auto device = std::make_unique<UploadDevice>(fileName, 0, fileSize);
+    device->setBandwidthLimiter(propagator()->account()->uploadLimiter());
     if (!device->open(QIODevice::ReadOnly)) {
         qCWarning(lcPropagateUpload) << "Could not prepare upload device: " << device->errorString();
         // Soft error because this is likely caused by the user modifying his files while syncing
@@ -90,6 +91,7 @@ void PropagateUploadFile::startUpload()
     connect(job, &PUTFileJob::finishedSignal, this, &PropagateUploadFile::slotPutFinished);
     connect(job, &PUTFileJob::uploadProgress, this, &PropagateUploadFile::slotUploadProgress);
     adjustLastJobTimeout(job, fileSize);
+    _chunkCount++;
     job->start();
     propagator()->_activeJobList.append(this);
 
@@ -173,6 +175,16 @@ void PropagateUploadFile::slotPutFinished()
 
     _item->_etag = etag;
 
+    // The If-Match precondition guarantees a success reply refers to exactly
+    // the revision we replaced, and the server sends the resulting
+    // permissions along with it. Taking them from the reply saves the
+    // PROPFIND that PropagateUploadCommon::finalize() has to issue for
+    // items without permissions - which is every newly uploaded file.
+    const QByteArray remotePerm = job->reply()->rawHeader("OC-Perm");
+    if (!remotePerm.isEmpty()) {
+        _item->_remotePerm = RemotePermissions::fromServerString(QString::fromUtf8(remotePerm));
+    }
+
     if (job->reply()->rawHeader("X-OC-MTime") != "accepted") {
         // X-OC-MTime is supported since owncloud 5.0.   But not when chunking.
         // Normally Owncloud 6 always puts X-OC-MTime
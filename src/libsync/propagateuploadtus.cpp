@@ -17,6 +17,7 @@
 #include "capabilities.h"
 #include "common/asserts.h"
 #include "common/checksums.h"
+#include "common/contentchunker.h"
 #include "common/syncjournaldb.h"
 #include "common/syncjournalfilerecord.h"
 #include "common/utility.h"
@@ -27,6 +28,8 @@
 #include "syncengine.h"
 
 #include <QFileInfo>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 
 #include <memory>
 
@@ -40,6 +43,25 @@ QByteArray uploadOffset()
 void setTusVersionHeader(QNetworkRequest &req){
     req.setRawHeader(QByteArrayLiteral("Tus-Resumable"), QByteArrayLiteral("1.0.0"));
 }
+
+// Bounds and feedback target for the adaptive sequential chunk size. A
+// fixed size is wrong at both ends: too big for flaky Wi-Fi, where a lost
+// chunk costs its whole upload time, and too small for datacenter links.
+constexpr quint64 initialChunkSize = 5 * 1024 * 1024;
+constexpr quint64 minChunkSize = 1 * 1024 * 1024;
+constexpr quint64 maxDynamicChunkSize = 512 * 1024 * 1024;
+constexpr auto targetChunkDuration = std::chrono::seconds(60);
+
+int maxConcurrentPartUploads()
+{
+    // Parallel chunks let large-file throughput scale with the connection
+    // count on high-bandwidth high-latency links.
+    static const int count = [] {
+        const int env = qEnvironmentVariableIntValue("OWNCLOUD_TUS_PARALLEL_CHUNKS");
+        return env > 0 ? env : 3;
+    }();
+    return count;
+}
 }
 
 namespace OCC {
@@ -47,7 +69,7 @@ namespace OCC {
 Q_LOGGING_CATEGORY(lcPropagateUploadTUS, "sync.propagator.upload.tus", QtDebugMsg)
 
 
-UploadDevice *PropagateUploadFileTUS::prepareDevice(const quint64 &chunkSize)
+UploadDevice *PropagateUploadFileTUS::prepareDevice(const quint64 &offset, const quint64 &chunkSize)
 {
     const QString localFileName = propagator()->fullLocalPath(_item->_file);
     // If the file is currently locked, we want to retry the sync
@@ -57,7 +79,8 @@ UploadDevice *PropagateUploadFileTUS::prepareDevice(const quint64 &chunkSize)
         abortWithError(SyncFileItem::SoftError, tr("%1 the file is currently in use").arg(localFileName));
         return nullptr;
     }
-    auto device = std::make_unique<UploadDevice>(localFileName, _currentOffset, chunkSize);
+    auto device = std::make_unique<UploadDevice>(localFileName, offset, chunkSize);
+    device->setBandwidthLimiter(propagator()->account()->uploadLimiter());
     if (!device->open(QIODevice::ReadOnly)) {
         qCWarning(lcPropagateUploadTUS) << "Could not prepare upload device: " << device->errorString();
 
@@ -69,10 +92,8 @@ UploadDevice *PropagateUploadFileTUS::prepareDevice(const quint64 &chunkSize)
 }
 
 
-SimpleNetworkJob *PropagateUploadFileTUS::makeCreationWithUploadJob(QNetworkRequest *request, UploadDevice *device)
+QByteArray PropagateUploadFileTUS::uploadMetadataHeader() const
 {
-    Q_ASSERT(propagator()->account()->capabilities().tusSupport().extensions.contains(QStringLiteral("creation-with-upload")));
-
     const auto checksumHeader = ChecksumHeader::parseChecksumHeader(_transmissionChecksumHeader);
 
     QByteArrayList encodedMetaData;
@@ -81,8 +102,14 @@ SimpleNetworkJob *PropagateUploadFileTUS::makeCreationWithUploadJob(QNetworkRequ
     // in difference to the old protocol the algorithm and the value are space seperated
     addMetaData(QByteArrayLiteral("checksum"), Utility::enumToString(checksumHeader.type()).toUtf8() + ' ' + checksumHeader.checksum());
     addMetaData(QByteArrayLiteral("mtime"), QByteArray::number(static_cast<int64_t>(_item->_modtime)));
+    return encodedMetaData.join(',');
+}
 
-    request->setRawHeader(QByteArrayLiteral("Upload-Metadata"), encodedMetaData.join(','));
+SimpleNetworkJob *PropagateUploadFileTUS::makeCreationWithUploadJob(QNetworkRequest *request, UploadDevice *device)
+{
+    Q_ASSERT(propagator()->account()->capabilities().tusSupport().extensions.contains(QStringLiteral("creation-with-upload")));
+
+    request->setRawHeader(QByteArrayLiteral("Upload-Metadata"), uploadMetadataHeader());
     request->setRawHeader(QByteArrayLiteral("Upload-Length"), QByteArray::number(_item->_size));
     return new SimpleNetworkJob(propagator()->account(), propagator()->webDavUrl(), {}, "POST", device, *request, this);
 }
@@ -116,33 +143,256 @@ void PropagateUploadFileTUS::doStartUpload()
     propagator()->reportProgress(*_item, 0);
     propagator()->_activeJobList.append(this);
 
+    if (propagator()->account()->capabilities().supportsDeltaUpload()) {
+        updateContentChunks();
+    }
+
     const auto info = propagator()->_journal->getUploadInfo(_item->_file);
     if (info.validate(_item->_size, _item->_modtime, _item->_checksumHeader)) {
         _location = info._url;
         Q_ASSERT(_location.isValid());
-        auto job = new SimpleNetworkJob(propagator()->account(), _location, {}, "HEAD", nullptr, {}, this);
+        qCInfo(lcPropagateUploadTUS) << "Validating resumable upload of" << propagator()->fullRemotePath(_item->_file) << "at" << _location;
+        // The spec requires the version header on every request, servers
+        // answer 412 without it.
+        QNetworkRequest req;
+        setTusVersionHeader(req);
+        auto job = new SimpleNetworkJob(propagator()->account(), _location, {}, "HEAD", nullptr, req, this);
+        addChildJob(job);
         connect(job, &SimpleNetworkJob::finishedSignal, this, &PropagateUploadFileTUS::slotChunkFinished);
         job->start();
+    } else if (canUseConcatenatedUpload()) {
+        startConcatenatedUpload();
     } else {
         startNextChunk();
     }
 }
 
+void PropagateUploadFileTUS::updateContentChunks()
+{
+    // Groundwork for delta uploads: keep the journal's content-defined
+    // chunk hashes in step with the revision we are about to upload, and
+    // measure against the previous revision how much of the file the
+    // server already has. Until a server endpoint exists that accepts
+    // individual chunks, the whole file is still transferred.
+    if (_item->_size < ContentChunker::averageChunkSize) {
+        return;
+    }
+    const QString file = _item->_file;
+    const QString filePath = propagator()->fullLocalPath(file);
+    auto *watcher = new QFutureWatcher<QVector<ContentChunk>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, file] {
+        watcher->deleteLater();
+        const QVector<ContentChunk> chunks = watcher->result();
+        if (chunks.isEmpty()) {
+            // Read error while chunking, e.g. the user modified the file.
+            // The upload itself notices and handles that.
+            return;
+        }
+        const QVector<ContentChunk> previous = propagator()->_journal->getContentChunks(file);
+        if (!previous.isEmpty()) {
+            QSet<QByteArray> known;
+            for (const auto &chunk : previous) {
+                known.insert(chunk.hash);
+            }
+            qint64 reusable = 0;
+            for (const auto &chunk : chunks) {
+                if (known.contains(chunk.hash)) {
+                    reusable += chunk.size;
+                }
+            }
+            qCInfo(lcPropagateUploadTUS) << "A delta upload of" << file << "could reuse"
+                                         << reusable << "of" << _item->_size << "bytes"
+                                         << "(" << (reusable * 100 / qMax<qint64>(_item->_size, 1)) << "%)";
+        }
+        propagator()->_journal->setContentChunks(file, chunks);
+    });
+    // Like ComputeChecksum: the thread keeps running if this job is deleted
+    // early, but the dying watcher keeps the result from being delivered.
+    watcher->setFuture(QtConcurrent::run([filePath] { return ContentChunker::chunkFile(filePath); }));
+}
+
+bool PropagateUploadFileTUS::canUseConcatenatedUpload() const
+{
+    const auto &tusSupport = propagator()->account()->capabilities().tusSupport();
+    if (!tusSupport.extensions.contains(QStringLiteral("concatenation"))
+        || !tusSupport.extensions.contains(QStringLiteral("creation-with-upload"))) {
+        return false;
+    }
+    // Without a chunk limit a single request streams the whole file anyway.
+    if (tusSupport.max_chunk_size == 0 || quint64(_item->_size) <= tusSupport.max_chunk_size) {
+        return false;
+    }
+    return maxConcurrentPartUploads() > 1;
+}
+
+void PropagateUploadFileTUS::startConcatenatedUpload()
+{
+    const quint64 chunkSize = propagator()->account()->capabilities().tusSupport().max_chunk_size;
+    const int parts = int((quint64(_item->_size) + chunkSize - 1) / chunkSize);
+    qCInfo(lcPropagateUploadTUS) << "Uploading" << propagator()->fullRemotePath(_item->_file)
+                                 << "as" << parts << "concatenated partial uploads,"
+                                 << maxConcurrentPartUploads() << "in parallel";
+    // Note: partial uploads are not recorded in the journal (the upload info
+    // holds a single url), so an interrupted concatenated upload restarts
+    // from the beginning. The bandwidth win on large files outweighs the
+    // lost resumability; the sequential path keeps it.
+    _partUrls.resize(parts);
+    _partBytesSent.resize(parts);
+    startNextPartialUploads();
+}
+
+void PropagateUploadFileTUS::startNextPartialUploads()
+{
+    if (propagator()->_abortRequested || state() == Finished) {
+        return;
+    }
+
+    const quint64 chunkSize = propagator()->account()->capabilities().tusSupport().max_chunk_size;
+    while (_runningPartUploads < maxConcurrentPartUploads() && _nextPart < _partUrls.size()) {
+        const int part = _nextPart++;
+        const quint64 offset = quint64(part) * chunkSize;
+        const quint64 partSize = qMin<quint64>(chunkSize, quint64(_item->_size) - offset);
+
+        UploadDevice *device = prepareDevice(offset, partSize);
+        if (!device) {
+            return;
+        }
+
+        QNetworkRequest req;
+        const auto headers = PropagateUploadCommon::headers();
+        for (auto it = headers.cbegin(); it != headers.cend(); ++it) {
+            req.setRawHeader(it.key(), it.value());
+        }
+        req.setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("application/offset+octet-stream"));
+        req.setHeader(QNetworkRequest::ContentLengthHeader, QByteArray::number(partSize));
+        req.setRawHeader(QByteArrayLiteral("Upload-Length"), QByteArray::number(partSize));
+        req.setRawHeader(QByteArrayLiteral("Upload-Concat"), QByteArrayLiteral("partial"));
+        setTusVersionHeader(req);
+
+        auto *job = new SimpleNetworkJob(propagator()->account(), propagator()->webDavUrl(), {}, "POST", device, req, this);
+        job->setPriority(QNetworkRequest::LowPriority);
+        qCDebug(lcPropagateUploadTUS) << "Starting partial upload" << part + 1 << "of" << _partUrls.size()
+                                      << "for" << propagator()->fullRemotePath(_item->_file)
+                                      << "Offset:" << offset << "Size:" << partSize;
+        addChildJob(job);
+        connect(job, &SimpleNetworkJob::finishedSignal, this, [this, part, job] { slotPartialUploadFinished(part, job); });
+        job->addNewReplyHook([this, part](QNetworkReply *reply) {
+            connect(reply, &QNetworkReply::uploadProgress, this, [this, part](qint64 bytesSent, qint64) {
+                _partBytesSent[part] = bytesSent;
+                reportCombinedProgress();
+            });
+        });
+        _runningPartUploads++;
+        job->start();
+    }
+}
+
+void PropagateUploadFileTUS::reportCombinedProgress()
+{
+    qint64 sent = 0;
+    for (qint64 bytes : std::as_const(_partBytesSent)) {
+        sent += bytes;
+    }
+    propagator()->reportProgress(*_item, sent);
+}
+
+void PropagateUploadFileTUS::slotPartialUploadFinished(int part, SimpleNetworkJob *job)
+{
+    if (state() == Finished) {
+        // a sibling part already failed this item
+        return;
+    }
+    _runningPartUploads--;
+
+    _item->_httpErrorCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    _item->_responseTimeStamp = job->responseTimestamp();
+    _item->_requestId = job->requestId();
+
+    if (job->reply()->error() != QNetworkReply::NoError) {
+        commonErrorHandling(job);
+        return;
+    }
+
+    const quint64 chunkSize = propagator()->account()->capabilities().tusSupport().max_chunk_size;
+    const qint64 expected = qMin<quint64>(chunkSize, quint64(_item->_size) - quint64(part) * chunkSize);
+    const qint64 offset = job->reply()->rawHeader(uploadOffset()).toLongLong();
+    const QUrl url = job->reply()->header(QNetworkRequest::LocationHeader).toUrl();
+    if (offset != expected || !url.isValid()) {
+        qCWarning(lcPropagateUploadTUS) << "Partial upload" << part + 1 << "was not accepted completely:"
+                                        << offset << "of" << expected << "bytes, url:" << url;
+        abortWithError(SyncFileItem::SoftError, tr("The server did not acknowledge the complete chunk"));
+        return;
+    }
+    _partBytesSent[part] = expected;
+    _partUrls[part] = url;
+    reportCombinedProgress();
+
+    if (++_completedParts == _partUrls.size()) {
+        finishConcatenatedUpload();
+    } else {
+        startNextPartialUploads();
+    }
+}
+
+void PropagateUploadFileTUS::finishConcatenatedUpload()
+{
+    // All bytes are uploaded, treat local changes like the sequential path
+    // does after its final chunk: accept the upload and request a new sync.
+    const QString fullFilePath(propagator()->fullLocalPath(_item->_file));
+    if (!FileSystem::fileExists(fullFilePath)
+        || FileSystem::fileChanged(QFileInfo{fullFilePath}, _item->_size, _item->_modtime)) {
+        propagator()->_anotherSyncNeeded = true;
+    }
+
+    QNetworkRequest req;
+    const auto headers = PropagateUploadCommon::headers();
+    for (auto it = headers.cbegin(); it != headers.cend(); ++it) {
+        req.setRawHeader(it.key(), it.value());
+    }
+    QByteArrayList partList;
+    for (const QUrl &url : std::as_const(_partUrls)) {
+        partList << url.toEncoded();
+    }
+    req.setRawHeader(QByteArrayLiteral("Upload-Concat"), QByteArrayLiteral("final;") + partList.join(' '));
+    req.setRawHeader(QByteArrayLiteral("Upload-Metadata"), uploadMetadataHeader());
+    setTusVersionHeader(req);
+
+    qCDebug(lcPropagateUploadTUS) << "Finishing concatenated upload:" << propagator()->fullRemotePath(_item->_file);
+    auto *job = new SimpleNetworkJob(propagator()->account(), propagator()->webDavUrl(), {}, "POST", nullptr, req, this);
+    adjustLastJobTimeout(job, _item->_size);
+    addChildJob(job);
+    connect(job, &SimpleNetworkJob::finishedSignal, this, &PropagateUploadFileTUS::slotFinalJobFinished);
+    job->start();
+}
+
+void PropagateUploadFileTUS::slotFinalJobFinished()
+{
+    SimpleNetworkJob *job = qobject_cast<SimpleNetworkJob *>(sender());
+    Q_ASSERT(job);
+
+    _item->_httpErrorCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    _item->_responseTimeStamp = job->responseTimestamp();
+    _item->_requestId = job->requestId();
+
+    if (job->reply()->error() != QNetworkReply::NoError) {
+        commonErrorHandling(job);
+        return;
+    }
+
+    propagator()->reportProgress(*_item, _item->_size);
+    _finished = true;
+    handleUploadFinished(job);
+}
+
 void PropagateUploadFileTUS::startNextChunk()
 {
     if (propagator()->_abortRequested)
         return;
 
-    const quint64 chunkSize = [&] {
-        auto chunkSize = _item->_size - _currentOffset;
-        if (propagator()->account()->capabilities().tusSupport().max_chunk_size) {
-            chunkSize = std::min<qint64>(chunkSize, propagator()->account()->capabilities().tusSupport().max_chunk_size);
-        }
-        return chunkSize;
-    }();
+    const quint64 chunkSize = qMin(quint64(_item->_size) - _currentOffset, currentChunkSize());
 
     QNetworkRequest req = prepareRequest(chunkSize);
-    UploadDevice *device = prepareDevice(chunkSize);
+    UploadDevice *device = prepareDevice(_currentOffset, chunkSize);
     if (!device) {
         return;
     }
@@ -168,9 +418,45 @@ void PropagateUploadFileTUS::startNextChunk()
             propagator()->reportProgress(*_item, _currentOffset + bytesSent);
         });
     });
+    _sentChunkSize = chunkSize;
+    _chunkCount++;
+    _chunkTimer.reset();
     job->start();
 }
 
+quint64 PropagateUploadFileTUS::currentChunkSize()
+{
+    if (_chunkSize == 0) {
+        // The env var pins the size and disables the adaptation.
+        static const quint64 pinnedChunkSize = qEnvironmentVariableIntValue("OWNCLOUD_TUS_CHUNK_SIZE");
+        _chunkSize = pinnedChunkSize > 0 ? pinnedChunkSize : initialChunkSize;
+    }
+    quint64 size = qBound(minChunkSize, _chunkSize, maxDynamicChunkSize);
+    const auto &tusSupport = propagator()->account()->capabilities().tusSupport();
+    if (tusSupport.max_chunk_size) {
+        size = qMin(size, tusSupport.max_chunk_size);
+    }
+    return size;
+}
+
+void PropagateUploadFileTUS::adjustChunkSize(std::chrono::nanoseconds duration)
+{
+    if (qEnvironmentVariableIsSet("OWNCLOUD_TUS_CHUNK_SIZE")) {
+        return;
+    }
+    const quint64 previous = _chunkSize;
+    if (duration < targetChunkDuration / 2) {
+        _chunkSize = qMin(_chunkSize * 2, maxDynamicChunkSize);
+    } else if (duration > targetChunkDuration) {
+        _chunkSize = qMax(_chunkSize / 2, minChunkSize);
+    }
+    if (_chunkSize != previous) {
+        qCDebug(lcPropagateUploadTUS) << "Chunk of" << previous << "bytes took"
+                                      << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()
+                                      << "ms, adjusting chunk size to" << _chunkSize;
+    }
+}
+
 void PropagateUploadFileTUS::slotChunkFinished()
 {
     SimpleNetworkJob *job = qobject_cast<SimpleNetworkJob *>(sender());
@@ -183,13 +469,31 @@ void PropagateUploadFileTUS::slotChunkFinished()
 
     QNetworkReply::NetworkError err = job->reply()->error();
     if (err != QNetworkReply::NoError) {
+        // The upload url from a previous run may be gone or expired on the
+        // server. That only invalidates the resume state, not the upload:
+        // drop the stale state and start over from scratch.
+        if (HttpLogger::requestVerb(*job->reply()) == QByteArrayLiteral("HEAD")
+            && (_item->_httpErrorCode == 404 || _item->_httpErrorCode == 410 || _item->_httpErrorCode == 412)) {
+            qCWarning(lcPropagateUploadTUS) << "Server rejected resuming" << propagator()->fullRemotePath(_item->_file)
+                                            << "(HTTP" << _item->_httpErrorCode << "), restarting the upload from scratch";
+            propagator()->_journal->setUploadInfo(_item->_file, SyncJournalDb::UploadInfo());
+            _location.clear();
+            _currentOffset = 0;
+            _retryCount++;
+            startNextChunk();
+            return;
+        }
         // try to get the offset if possible, only try once
         if (err == QNetworkReply::TimeoutError && !_location.isEmpty() && HttpLogger::requestVerb(*job->reply())  != "HEAD")
         {
             qCWarning(lcPropagateUploadTUS) << propagator()->fullRemotePath(_item->_file) << "Encountered a timeout -> get progress for" << _location;
+            // A timeout is the strongest signal that the chunk is too big
+            // for the link, shrink before retrying.
+            _chunkSize = qMax(currentChunkSize() / 2, minChunkSize);
             QNetworkRequest req;
             setTusVersionHeader(req);
             auto updateJob = new SimpleNetworkJob(propagator()->account(), propagator()->webDavUrl(), _location.path(), "HEAD", {}, req, this);
+            _retryCount++;
             addChildJob(updateJob);
             connect(updateJob, &SimpleNetworkJob::finishedSignal, this, &PropagateUploadFileTUS::slotChunkFinished);
             updateJob->start();
@@ -202,6 +506,12 @@ void PropagateUploadFileTUS::slotChunkFinished()
 
     const qint64 offset = job->reply()->rawHeader(uploadOffset()).toLongLong();
     propagator()->reportProgress(*_item, offset);
+
+    // Only full-size chunks say something about the link; truncated last
+    // chunks and HEAD probes do not.
+    if (HttpLogger::requestVerb(*job->reply()) != QByteArrayLiteral("HEAD") && _sentChunkSize == currentChunkSize()) {
+        adjustChunkSize(_chunkTimer.duration());
+    }
     _currentOffset = offset;
     // first response after a POST request
     if (_location.isEmpty()) {
@@ -244,6 +554,11 @@ void PropagateUploadFileTUS::slotChunkFinished()
         return;
     }
 
+    handleUploadFinished(job);
+}
+
+void PropagateUploadFileTUS::handleUploadFinished(SimpleNetworkJob *job)
+{
     // ==== handling when the upload is finished:
     const QString etag = getEtagFromReply(job->reply());
     const QByteArray remPerms = job->reply()->rawHeader("OC-Perm");
@@ -267,7 +582,6 @@ void PropagateUploadFileTUS::slotChunkFinished()
         check->start();
         return;
     }
-    _item->_remotePerm = RemotePermissions::fromServerString(QString::fromUtf8(job->reply()->rawHeader("Oc-Perm")));
     // the file id should only be empty for new files up- or downloaded
     finalize(etag, job->reply()->rawHeader("OC-FileID"));
 }
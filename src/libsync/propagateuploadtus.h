@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include "common/chronoelapsedtimer.h"
 #include "propagateuploadfile.h"
 #include "uploaddevice.h"
 
@@ -27,15 +28,67 @@ class PropagateUploadFileTUS : public PropagateUploadCommon
 private:
     SimpleNetworkJob *makeCreationWithUploadJob(QNetworkRequest *request, UploadDevice *device);
     QNetworkRequest prepareRequest(const quint64 &chunkSize);
-    UploadDevice *prepareDevice(const quint64 &chunkSize);
+    UploadDevice *prepareDevice(const quint64 &offset, const quint64 &chunkSize);
+    QByteArray uploadMetadataHeader() const;
 
     void startNextChunk();
     void slotChunkFinished();
+
+    /** The chunk size to use for the next sequential chunk.
+     *
+     * Initialized lazily, clamped to the server's limit when it has one.
+     */
+    quint64 currentChunkSize();
+
+    /** Feeds the measured duration of a full-size chunk back into the
+     * chunk size: grow geometrically while well under the target duration,
+     * shrink when overshooting.
+     */
+    void adjustChunkSize(std::chrono::nanoseconds duration);
+
+    /** Whether the server lets us upload the chunks of this file in parallel
+     * (tus concatenation extension).
+     */
+    bool canUseConcatenatedUpload() const;
+    void startConcatenatedUpload();
+    void startNextPartialUploads();
+    void slotPartialUploadFinished(int part, SimpleNetworkJob *job);
+    void finishConcatenatedUpload();
+    void slotFinalJobFinished();
+    void reportCombinedProgress();
+
+    /** The tail shared by both upload flavors: pick up etag and permissions
+     * from the reply, falling back to a PROPFIND, then finalize.
+     */
+    void handleUploadFinished(SimpleNetworkJob *job);
+
+    /** Refreshes the journal's content-defined chunk hashes for this file.
+     *
+     * Runs off-thread next to the upload; only called when the server
+     * capabilities advertise delta upload support.
+     */
+    void updateContentChunks();
+
     void finalize(const QString &etag, const QByteArray &fileId);
 
     quint64 _currentOffset = 0;
     QUrl _location;
 
+    /// Adaptive sequential chunk size, 0 until the first chunk is prepared.
+    quint64 _chunkSize = 0;
+    /// Size of the chunk in flight, to tell truncated last chunks apart.
+    quint64 _sentChunkSize = 0;
+    /// Measures the wall-clock time of the chunk in flight.
+    Utility::ChronoElapsedTimer _chunkTimer;
+
+    // State of a concatenated upload. The urls of finished partial uploads
+    // are collected in file order for the final creation request.
+    QVector<QUrl> _partUrls;
+    QVector<qint64> _partBytesSent;
+    int _nextPart = 0;
+    int _runningPartUploads = 0;
+    int _completedParts = 0;
+
 public:
     PropagateUploadFileTUS(OwncloudPropagator *propagator, const SyncFileItemPtr &item);
 
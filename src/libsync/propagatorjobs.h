@@ -86,6 +86,6 @@ public:
     {
     }
     void start() override;
-    JobParallelism parallelism() override { return _item->isDirectory() ? WaitForFinished : FullParallelism; }
+    QStringList exclusivePaths() const override { return _item->isDirectory() ? affectedPaths() : QStringList(); }
 };
 }
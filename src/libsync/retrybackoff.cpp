@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "retrybackoff.h"
+
+#include <QLoggingCategory>
+#include <QRandomGenerator>
+#include <QStringView>
+
+#include <algorithm>
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcRetryBackoff, "sync.networkjob.backoff", QtInfoMsg)
+
+namespace {
+    /// Backoff after the first failure; doubles per further failure
+    constexpr auto initialBackoffC = 5s;
+    /// The backoff never grows beyond this
+    constexpr auto maxBackoffC = 5min;
+    /// At most one recovery probe per endpoint within this interval
+    constexpr auto probeIntervalC = 10s;
+}
+
+QByteArray RetryBackoff::endpointKey(const QUrl &url)
+{
+    // The service root, e.g. host:443/remote.php/dav
+    QString key = url.host() + QLatin1Char(':') + QString::number(url.port(443));
+    const auto segments = QStringView(url.path()).split(QLatin1Char('/'), Qt::SkipEmptyParts);
+    for (qsizetype i = 0; i < std::min<qsizetype>(2, segments.size()); ++i) {
+        key += QLatin1Char('/') + segments.at(i);
+    }
+    return key.toUtf8();
+}
+
+void RetryBackoff::recordFailure(const QUrl &url)
+{
+    auto &state = _endpoints[endpointKey(url)];
+    state.failures++;
+    qCInfo(lcRetryBackoff) << "Endpoint" << endpointKey(url) << "failed" << state.failures << "times, backing off";
+}
+
+void RetryBackoff::recordSuccess(const QUrl &url)
+{
+    const auto it = _endpoints.constFind(endpointKey(url));
+    if (it != _endpoints.cend()) {
+        qCInfo(lcRetryBackoff) << "Endpoint" << endpointKey(url) << "recovered";
+        _endpoints.erase(it);
+    }
+}
+
+std::chrono::milliseconds RetryBackoff::retryDelay(const QUrl &url) const
+{
+    const auto it = _endpoints.constFind(endpointKey(url));
+    if (it == _endpoints.cend() || it->failures == 0) {
+        return 0ms;
+    }
+    const auto backoff = std::min<milliseconds>(maxBackoffC, initialBackoffC * (1 << std::min(it->failures - 1, 10)));
+    // 50%-150% jitter, so the herd does not come back in one wave
+    return milliseconds(qint64(backoff.count() * (0.5 + QRandomGenerator::global()->generateDouble())));
+}
+
+bool RetryBackoff::tryProbe(const QUrl &url)
+{
+    const auto it = _endpoints.find(endpointKey(url));
+    if (it == _endpoints.end() || it->failures == 0) {
+        return true;
+    }
+    if (it->lastProbe.isValid() && !it->lastProbe.hasExpired(milliseconds(probeIntervalC).count())) {
+        return false;
+    }
+    it->lastProbe.start();
+    return true;
+}
+
+} // namespace OCC
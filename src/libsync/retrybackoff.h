@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QUrl>
+
+#include <chrono>
+
+namespace OCC {
+
+/**
+ * @brief Shared backoff state for request retries, keyed by endpoint
+ * @ingroup libsync
+ *
+ * When a server endpoint browns out, every job that talked to it fails at
+ * the same moment; retrying each of them on its own schedule hammers the
+ * recovering server with the whole herd at once. This class, owned by the
+ * account, lets the jobs coordinate: server-side failures raise one
+ * jittered exponential delay for the whole endpoint, and while the delay
+ * is in force only a single probe request per interval is let through, so
+ * recovery is tested with cheap single requests.
+ *
+ * An endpoint is the service root of the URL (e.g. host/remote.php/dav),
+ * not the individual file: one overloaded endpoint affects all requests
+ * below it.
+ */
+class OWNCLOUDSYNC_EXPORT RetryBackoff
+{
+public:
+    /// Raise the endpoint's backoff; call on overload replies (429, 503)
+    void recordFailure(const QUrl &url);
+    /// Clear the endpoint's backoff; call on any successful reply
+    void recordSuccess(const QUrl &url);
+
+    /**
+     * How long a retry to this endpoint should wait before re-sending.
+     *
+     * 0 when the endpoint is not backing off. Each call draws fresh
+     * jitter, so waiting jobs spread out instead of retrying in sync.
+     */
+    std::chrono::milliseconds retryDelay(const QUrl &url) const;
+
+    /**
+     * Whether a retry may be sent to a backing-off endpoint right now.
+     *
+     * Grants at most one request per probe interval; a denied caller
+     * should wait another retryDelay() and ask again.
+     */
+    bool tryProbe(const QUrl &url);
+
+private:
+    struct State
+    {
+        int failures = 0;
+        QElapsedTimer lastProbe;
+    };
+
+    static QByteArray endpointKey(const QUrl &url);
+
+    QHash<QByteArray, State> _endpoints;
+};
+}
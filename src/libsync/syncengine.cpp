@@ -14,8 +14,11 @@
  */
 
 #include "syncengine.h"
+#include "accessmanager.h"
 #include "account.h"
 #include "common/asserts.h"
+#include "common/metrics.h"
+#include "common/ownsql.h"
 #include "common/syncfilestatus.h"
 #include "common/syncjournaldb.h"
 #include "common/syncjournalfilerecord.h"
@@ -23,11 +26,17 @@
 #include "csync_exclude.h"
 #include "discovery.h"
 #include "discoveryphase.h"
+#include "downloadprefetcher.h"
 #include "owncloudpropagator.h"
+#include "uploaddevice.h"
 
+#include <algorithm>
 #include <chrono>
+#include <functional>
 
 #include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include <QLoggingCategory>
 #include <QSslSocket>
 #include <QStringList>
@@ -43,6 +52,33 @@ Q_LOGGING_CATEGORY(lcEngine, "sync.engine", QtInfoMsg)
 // doc in header
 std::chrono::seconds SyncEngine::minimumFileAgeForUpload(2s);
 
+namespace {
+    // key-value store entry holding the root etag of the last fully successful run
+    const QString lastSuccessfulRootEtagKeyC = QStringLiteral("lastSuccessfulRootEtag");
+
+    // how many of the slowest propagation jobs the performance report keeps
+    constexpr size_t slowestJobsReportSizeC = 10;
+
+    // orders items by job duration, used for the min-heap of slowest jobs
+    bool fasterJob(const OCC::SyncFileItemPtr &a, const OCC::SyncFileItemPtr &b)
+    {
+        return a->_jobDuration > b->_jobDuration;
+    }
+
+    qint64 toMs(std::chrono::nanoseconds d)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    }
+
+    // Estimated bytes held by the run's sync items, see common/metrics.h.
+    // Process-wide, but folders sync one at a time.
+    OCC::Metrics::PeakGauge &discoveryItemsMemoryGauge()
+    {
+        static OCC::Metrics::PeakGauge gauge("memory.discoveryItemsBytes");
+        return gauge;
+    }
+}
+
 SyncEngine::SyncEngine(Account *account, const QUrl &baseUrl, const QString &localPath, const QString &remotePath, OCC::SyncJournalDb *journal, QObject *parent)
     : QObject(parent)
     , _account(account)
@@ -64,6 +100,13 @@ SyncEngine::SyncEngine(Account *account, const QUrl &baseUrl, const QString &loc
     // for now leave it alone
     _syncFileStatusTracker = new SyncFileStatusTracker(_localPath, journal, this);
     connect(_syncFileStatusTracker, &SyncFileStatusTracker::fileStatusChanged, this, &SyncEngine::fileStatusChanged);
+
+    _progressFlushTimer.setSingleShot(true);
+    _progressFlushTimer.setInterval(100ms);
+    connect(&_progressFlushTimer, &QTimer::timeout, this, [this] {
+        _progressEmitThrottle.reset();
+        Q_EMIT transmissionProgress(*_progressInfo);
+    });
 }
 
 SyncEngine::~SyncEngine()
@@ -85,12 +128,17 @@ bool SyncEngine::checkErrorBlacklisting(SyncFileItem &item)
         return false;
     }
 
-    SyncJournalErrorBlacklistRecord entry = _journal->errorBlacklistEntry(item._file);
+    QString lookupKey = item._file;
+    if (Utility::fsCasePreservingButCaseInsensitive()) {
+        lookupKey = lookupKey.toLower();
+    }
     item._hasBlacklistEntry = false;
 
-    if (!entry.isValid()) {
+    const auto entryIt = _errorBlacklistCache.constFind(lookupKey);
+    if (entryIt == _errorBlacklistCache.cend() || !entryIt->isValid()) {
         return false;
     }
+    const SyncJournalErrorBlacklistRecord &entry = *entryIt;
 
     item._hasBlacklistEntry = true;
 
@@ -260,9 +308,15 @@ void OCC::SyncEngine::slotItemDiscovered(const OCC::SyncFileItemPtr &item)
     checkErrorBlacklisting(*item);
     _needsUpdate = true;
 
+    // Bucket by the destination's parent directory; takeDiscoveredItems()
+    // flattens the buckets into the sorted set once discovery is done.
+    const QString destination = item->destination();
+    const auto lastSlash = destination.lastIndexOf(QLatin1Char('/'));
+    auto &bucket = _discoveredItems[lastSlash < 0 ? QString() : destination.left(lastSlash)];
     Q_ASSERT([&] {
-        const auto it = _syncItems.find(item);
-        if (it != _syncItems.cend()) {
+        const auto it = std::find_if(
+            bucket.cbegin(), bucket.cend(), [&](const SyncFileItemPtr &other) { return other->destination() == destination; });
+        if (it != bucket.cend()) {
             const auto &item2 = it->get();
             qCWarning(lcEngine) << "We already have an item for " << item2->_file << ":" << item2->instruction() << item2->_direction << "|"
                                 << item->instruction() << item->_direction;
@@ -270,7 +324,12 @@ void OCC::SyncEngine::slotItemDiscovered(const OCC::SyncFileItemPtr &item)
         }
         return true;
     }());
-    _syncItems.insert(item);
+    bucket.push_back(item);
+    discoveryItemsMemoryGauge().add(item->estimatedMemoryUsage());
+
+    if (_downloadPrefetcher) {
+        _downloadPrefetcher->enqueue(item);
+    }
 
     slotNewItem(item);
 
@@ -279,6 +338,89 @@ void OCC::SyncEngine::slotItemDiscovered(const OCC::SyncFileItemPtr &item)
     }
 }
 
+SyncFileItemSet SyncEngine::takeDiscoveredItems()
+{
+    // Sibling names carry no slashes, so sorting every directory bucket by
+    // bname and walking the buckets depth-first reproduces exactly the
+    // slash-first destination order of SyncFileItem::operator<: a directory's
+    // contents directly follow the directory itself. Compared to inserting
+    // each discovered item into the ordered set this sorts many short runs of
+    // sibling names instead of running O(n log n) full-path comparisons.
+    const auto parentOf = [](const QString &path) {
+        const auto slash = path.lastIndexOf(QLatin1Char('/'));
+        return slash < 0 ? QString() : path.left(slash);
+    };
+    const auto bnameOf = [](const QString &path) {
+        return QStringView(path).mid(path.lastIndexOf(QLatin1Char('/')) + 1);
+    };
+
+    struct Listing
+    {
+        std::vector<SyncFileItemPtr> items;
+        std::vector<QString> childDirs;
+    };
+    std::unordered_map<QString, Listing> listings;
+    listings.reserve(_discoveredItems.size());
+    size_t total = 0;
+
+    // Buckets exist only for directories that directly contain changed items.
+    // Link every bucket to its parent chain so the walk below also reaches
+    // subtrees whose intermediate directories have no item of their own.
+    for (auto &[dir, items] : _discoveredItems) {
+        total += items.size();
+        listings[dir].items = std::move(items);
+        for (QString child = dir; !child.isEmpty();) {
+            QString parent = parentOf(child);
+            // Chains from sibling buckets push the same ancestors repeatedly;
+            // the duplicates are dropped after sorting below.
+            listings[parent].childDirs.push_back(std::move(child));
+            child = std::move(parent);
+        }
+    }
+    _discoveredItems.clear();
+
+    std::vector<SyncFileItemPtr> sorted;
+    sorted.reserve(total);
+
+    const std::function<void(const QString &)> walk = [&](const QString &dir) {
+        const auto it = listings.find(dir);
+        if (it == listings.end()) {
+            return;
+        }
+        Listing &listing = it->second;
+        std::sort(listing.items.begin(), listing.items.end(),
+            [&](const SyncFileItemPtr &a, const SyncFileItemPtr &b) { return bnameOf(a->destination()) < bnameOf(b->destination()); });
+        std::sort(listing.childDirs.begin(), listing.childDirs.end());
+        listing.childDirs.erase(std::unique(listing.childDirs.begin(), listing.childDirs.end()), listing.childDirs.end());
+
+        auto childIt = listing.childDirs.cbegin();
+        for (auto &item : listing.items) {
+            const auto name = bnameOf(item->destination());
+            // Subtrees without an item of their own that sort before this item
+            while (childIt != listing.childDirs.cend() && bnameOf(*childIt) < name) {
+                walk(*childIt);
+                ++childIt;
+            }
+            const bool hasSubtree = childIt != listing.childDirs.cend() && bnameOf(*childIt) == name;
+            const QString itemDir = hasSubtree ? *childIt : QString();
+            if (hasSubtree) {
+                ++childIt;
+            }
+            sorted.push_back(std::move(item));
+            if (hasSubtree) {
+                walk(itemDir);
+            }
+        }
+        for (; childIt != listing.childDirs.cend(); ++childIt) {
+            walk(*childIt);
+        }
+    };
+    walk(QString());
+
+    // Linear: std::set's range constructor detects the pre-sorted input.
+    return SyncFileItemSet(sorted.begin(), sorted.end());
+}
+
 void SyncEngine::startSync()
 {
     if (_syncRunning) {
@@ -306,7 +448,43 @@ void SyncEngine::startSync()
     _seenConflictFiles.clear();
     _progressInfo->reset();
     _syncItems.clear();
+    _discoveredItems.clear();
     _needsUpdate = false;
+    _currentRunRootEtag.clear();
+    _remoteDiscoverySkipped = false;
+    _discoveryExcludedPaths.clear();
+
+    // Baseline for the performance report: the journal query counter and the
+    // verb counts are process-wide and monotonic, so snapshot them here and
+    // report the deltas in assemblePerformanceReport().
+    _performanceReport = QJsonObject();
+    _slowestJobs.clear();
+    _discoveryDuration = std::chrono::nanoseconds::zero();
+    _propagationStartOffset = std::chrono::nanoseconds::zero();
+    _sqlExecCountAtStart = sqlQueryExecCount();
+    _verbCountsAtStart = _account->accessManager()->requestVerbCounts();
+    discoveryItemsMemoryGauge().set(0);
+    discoveryItemsMemoryGauge().resetPeak();
+    uploadBuffersMemoryGauge().resetPeak();
+
+    // Restore the quick-check baseline once per engine so the very first run
+    // of a fresh process can already serve the remote tree from the journal.
+    if (!_lastSuccessfulRootEtagLoaded) {
+        _lastSuccessfulRootEtagLoaded = true;
+        _lastSuccessfulRootEtag = _journal->keyValueStoreGetString(lastSuccessfulRootEtagKeyC);
+    }
+
+    // Load the error blacklist once instead of querying sqlite for every
+    // discovered item, see checkErrorBlacklisting().
+    _errorBlacklistCache.clear();
+    const auto blacklistMap = _journal->errorBlacklistMap();
+    for (auto it = blacklistMap.cbegin(); it != blacklistMap.cend(); ++it) {
+        if (Utility::fsCasePreservingButCaseInsensitive()) {
+            _errorBlacklistCache.insert(it.key().toLower(), it.value());
+        } else {
+            _errorBlacklistCache.insert(it.key(), it.value());
+        }
+    }
 
     // Functionality like selective sync might have set up etag storage
     // filtering via schedulePathForRemoteDiscovery(). This *is* the next sync, so
@@ -398,10 +576,28 @@ void SyncEngine::startDiscovery()
     if (!_discoveryPhase->_remoteFolder.endsWith(QLatin1Char('/')))
         _discoveryPhase->_remoteFolder += QLatin1Char('/');
     _discoveryPhase->_shouldDiscoverLocaly = [this](const QString &s) { return shouldDiscoverLocally(s); };
+    _discoveryPhase->_localTouchedChildren = [this](const QString &s) { return localTouchedChildrenOf(s); };
     _discoveryPhase->setSelectiveSyncBlackList(selectiveSyncBlackList);
     _discoveryPhase->setSelectiveSyncWhiteList(selectiveSyncWhiteList);
     _discoveryPhase->_serverBlacklistedFiles = _account->capabilities().blacklistedFiles();
     _discoveryPhase->_ignoreHiddenFiles = ignoreHiddenFiles();
+    // Opt-in: fetch the whole tree with one Depth: infinity PROPFIND. Saves
+    // one round trip per directory on servers that support it; discovery falls
+    // back to per-directory requests if the server replies with a 4xx error.
+    _discoveryPhase->_useRecursiveDiscovery = qEnvironmentVariableIntValue("OWNCLOUD_RECURSIVE_DISCOVERY") > 0;
+    // Opt-in: walk the local tree in parallel on the thread pool. Only pays
+    // off for a full local discovery; with DatabaseAndFilesystem most
+    // directories are served from the journal anyway.
+    if (qEnvironmentVariableIntValue("OWNCLOUD_PARALLEL_LOCAL_DISCOVERY") > 0 && _localDiscoveryStyle == LocalDiscoveryStyle::FilesystemOnly) {
+        _discoveryPhase->_localTreeWalker = new DiscoveryLocalTreeWalker(_localPath, _syncOptions.vfs(), _discoveryPhase);
+        _discoveryPhase->_localTreeWalker->start();
+    }
+    // Opt-in: read the whole journal file table once and serve the
+    // per-directory listings from memory instead of one SQLite query per
+    // directory. Trades memory proportional to the file count for it.
+    if (qEnvironmentVariableIntValue("OWNCLOUD_JOURNAL_SNAPSHOT") > 0 && !_discoveryPhase->loadJournalSnapshot()) {
+        qCWarning(lcEngine) << "Could not load the journal snapshot, using per-directory journal queries";
+    }
 
     const QString invalidFilenamePattern = _account->capabilities().invalidFilenameRegex();
     if (!invalidFilenamePattern.isEmpty()) {
@@ -410,6 +606,13 @@ void SyncEngine::startDiscovery()
 
     connect(_discoveryPhase, &DiscoveryPhase::silentlyExcluded, _syncFileStatusTracker, &SyncFileStatusTracker::slotAddExcluded);
     connect(_discoveryPhase, &DiscoveryPhase::excluded, _syncFileStatusTracker, &SyncFileStatusTracker::slotAddExcluded);
+    if (Utility::fsCasePreservingButCaseInsensitive()) {
+        // Excluded paths exist on disk but won't be in the journal or the
+        // sync items; the propagator's case-clash pre-filter needs them.
+        const auto collectExcluded = [this](const QString &path) { _discoveryExcludedPaths.append(path); };
+        connect(_discoveryPhase, &DiscoveryPhase::silentlyExcluded, this, collectExcluded);
+        connect(_discoveryPhase, &DiscoveryPhase::excluded, this, collectExcluded);
+    }
 
     connect(_discoveryPhase, &DiscoveryPhase::itemDiscovered, this, &SyncEngine::slotItemDiscovered);
     connect(_discoveryPhase, &DiscoveryPhase::fatalError, this, [this](const QString &errorString) {
@@ -420,9 +623,28 @@ void SyncEngine::startDiscovery()
     connect(_discoveryPhase, &DiscoveryPhase::finished, this, &SyncEngine::slotDiscoveryFinished);
 
 
-    auto discoveryJob = new ProcessDirectoryJob(_discoveryPhase, PinState::AlwaysLocal, _discoveryPhase);
+    // If the root etag reported by the gui's etag poll still matches the one
+    // of the last fully successful run, nothing changed on the server and the
+    // whole remote tree can be read from the journal. Any scheduled remote
+    // rediscovery (selective sync, vfs, schema changes, ...) disables this.
+    const bool remoteDiscoveryForced = _journal->takeRemoteDiscoveryForced();
+    _remoteDiscoverySkipped = !remoteDiscoveryForced && !_lastSuccessfulRootEtag.isEmpty() && _lastSuccessfulRootEtag == _knownRemoteRootEtag;
+    if (_remoteDiscoverySkipped) {
+        qCInfo(lcEngine) << "Remote root etag" << _knownRemoteRootEtag << "unchanged since the last successful sync, reading the remote tree from the journal";
+    }
+
+    auto discoveryJob = new ProcessDirectoryJob(
+        _discoveryPhase, PinState::AlwaysLocal, _remoteDiscoverySkipped ? ProcessDirectoryJob::ParentNotChanged : ProcessDirectoryJob::NormalQuery, _discoveryPhase);
     connect(discoveryJob, &ProcessDirectoryJob::etag, this, &SyncEngine::slotRootEtagReceived);
 
+    // Opt-in: start fetching download payloads while discovery is still
+    // walking the tree. Pointless when the remote tree is served from the
+    // journal, as there is no PROPFIND wait to overlap with.
+    Q_ASSERT(_downloadPrefetcher == nullptr);
+    if (qEnvironmentVariableIntValue("OWNCLOUD_PIPELINED_DOWNLOADS") > 0 && !_remoteDiscoverySkipped) {
+        _downloadPrefetcher = new DownloadPrefetcher(_account, _baseUrl, _localPath, _remotePath, _journal, this);
+    }
+
     _discoveryPhase->startJob(discoveryJob);
 }
 
@@ -434,6 +656,15 @@ void SyncEngine::slotDiscoveryFinished()
     }
 
     qCInfo(lcEngine) << "#### Discovery end ####################################################" << _duration.duration();
+    {
+        const auto &stats = _discoveryPhase->_statistics;
+        _progressInfo->_discoveryStatistics = stats;
+        qCInfo(lcEngine) << "Discovery breakdown:" << stats.entriesReconciled << "entries reconciled (" << stats.filesUnchanged
+                         << "unchanged files skipped) in" << stats.reconcileTime << "(of which journal"
+                         << stats.journalListingTime << ")," << stats.remoteDirectoriesListed << "remote listings in" << stats.remoteListingTime << ","
+                         << stats.localDirectoriesListed << "local listings in" << stats.localListingTime;
+    }
+    _discoveryDuration = _duration.duration();
 
     // Sanity check
     if (!_journal || !_journal->isOpen()) {
@@ -451,6 +682,8 @@ void SyncEngine::slotDiscoveryFinished()
     _progressInfo->_status = ProgressInfo::Reconcile;
     Q_EMIT transmissionProgress(*_progressInfo);
 
+    _syncItems = takeDiscoveredItems();
+
     auto databaseFingerprint = _journal->dataFingerprint();
     // If databaseFingerprint is empty, this means that there was no information in the database
     // (for example, upgrading from a previous version, or first sync, or server not supporting fingerprint)
@@ -462,6 +695,15 @@ void SyncEngine::slotDiscoveryFinished()
     if (_discoveryPhase->_anotherSyncNeeded) {
         _anotherSyncNeeded = true;
     }
+
+    // Propagation resumes any partially prefetched temporaries via the
+    // downloadinfo entries; running two transfers for one file is pointless.
+    if (_downloadPrefetcher) {
+        _downloadPrefetcher->abort();
+        _downloadPrefetcher->deleteLater();
+        _downloadPrefetcher = nullptr;
+    }
+
     startPropagation();
 }
 
@@ -506,10 +748,18 @@ void SyncEngine::startPropagation()
     connect(_propagator, &OwncloudPropagator::updateFileTotal, this, &SyncEngine::updateFileTotal);
     connect(_propagator, &OwncloudPropagator::finished, this, &SyncEngine::slotPropagationFinished, Qt::QueuedConnection);
     connect(_propagator, &OwncloudPropagator::seenLockedFile, this, &SyncEngine::seenLockedFile);
+    connect(_propagator, &OwncloudPropagator::transferMetrics, this, &SyncEngine::transferMetrics);
     connect(_propagator, &OwncloudPropagator::insufficientLocalStorage, this, &SyncEngine::slotInsufficientLocalStorage);
     connect(_propagator, &OwncloudPropagator::insufficientRemoteStorage, this, &SyncEngine::slotInsufficientRemoteStorage);
     connect(_propagator, &OwncloudPropagator::newItem, this, &SyncEngine::slotNewItem);
 
+    for (const QString &path : std::as_const(_discoveryExcludedPaths)) {
+        _propagator->recordNameForCaseClashCheck(path);
+    }
+    for (const QString &path : std::as_const(_priorityPaths)) {
+        _propagator->prioritizePath(path);
+    }
+
     deleteStaleDownloadInfos(_syncItems);
     deleteStaleUploadInfos(_syncItems);
     deleteStaleErrorBlacklistEntries(_syncItems);
@@ -521,6 +771,7 @@ void SyncEngine::startPropagation()
         Q_EMIT started();
     }
 
+    _propagationStartOffset = _duration.duration();
     _propagator->start(std::move(_syncItems));
 
 
@@ -563,6 +814,7 @@ void SyncEngine::slotPropagationFinished(bool success)
     // so we don't count this twice (like Recent Files)
     _progressInfo->_lastCompletedItem = SyncFileItem();
     _progressInfo->_status = ProgressInfo::Done;
+    _progressFlushTimer.stop();
     Q_EMIT transmissionProgress(*_progressInfo);
 
     finalize(success);
@@ -572,12 +824,34 @@ void SyncEngine::finalize(bool success)
 {
     qDebug() << "Sync run took" << _duration.duration() << " for folder: " << _localPath;
 
+    assemblePerformanceReport(success);
+
+    if (success) {
+        if (!_currentRunRootEtag.isEmpty() && _currentRunRootEtag != _lastSuccessfulRootEtag) {
+            _lastSuccessfulRootEtag = _currentRunRootEtag;
+            if (_journal) {
+                _journal->keyValueStoreSet(lastSuccessfulRootEtagKeyC, _lastSuccessfulRootEtag);
+            }
+        }
+        // When the remote discovery was skipped, the previous etag stays valid.
+    } else if (!_lastSuccessfulRootEtag.isEmpty()) {
+        _lastSuccessfulRootEtag.clear();
+        if (_journal) {
+            _journal->deleteKeyValueStoreEntry(lastSuccessfulRootEtagKeyC);
+        }
+    }
+
     if (!_goingDown) {
         _duration.stop();
         if (_discoveryPhase) {
             _discoveryPhase->disconnect();
             _discoveryPhase->deleteLater();
         }
+        if (_downloadPrefetcher) {
+            _downloadPrefetcher->abort();
+            _downloadPrefetcher->deleteLater();
+            _downloadPrefetcher = nullptr;
+        }
 
         _syncRunning = false;
         // need to reality check this: is there some universe where the dying sync engine needs to notify "finished"?
@@ -598,6 +872,81 @@ void SyncEngine::finalize(bool success)
     }
 }
 
+void SyncEngine::assemblePerformanceReport(bool success)
+{
+    const auto total = _duration.duration();
+
+    QJsonObject phases;
+    phases[QStringLiteral("totalMs")] = toMs(total);
+    phases[QStringLiteral("discoveryMs")] = toMs(_discoveryDuration);
+    if (_propagationStartOffset > std::chrono::nanoseconds::zero()) {
+        phases[QStringLiteral("reconcileMs")] = toMs(_propagationStartOffset - _discoveryDuration);
+        phases[QStringLiteral("propagationMs")] = toMs(total - _propagationStartOffset);
+    }
+
+    const auto &stats = _progressInfo->_discoveryStatistics;
+    QJsonObject discovery;
+    discovery[QStringLiteral("remoteDirectoriesListed")] = qint64(stats.remoteDirectoriesListed);
+    discovery[QStringLiteral("localDirectoriesListed")] = qint64(stats.localDirectoriesListed);
+    discovery[QStringLiteral("entriesReconciled")] = qint64(stats.entriesReconciled);
+    discovery[QStringLiteral("filesUnchanged")] = qint64(stats.filesUnchanged);
+    discovery[QStringLiteral("remoteListingMs")] = toMs(stats.remoteListingTime);
+    discovery[QStringLiteral("localListingMs")] = toMs(stats.localListingTime);
+    discovery[QStringLiteral("journalListingMs")] = toMs(stats.journalListingTime);
+    discovery[QStringLiteral("reconcileMs")] = toMs(stats.reconcileTime);
+
+    QJsonObject journal;
+    journal[QStringLiteral("queryCount")] = qint64(sqlQueryExecCount() - _sqlExecCountAtStart);
+
+    // Per-verb deltas against the snapshot from startSync(). The manager is
+    // shared per account, but folders sync one at a time so the delta is
+    // dominated by this run.
+    QJsonObject requests;
+    if (_account) {
+        const auto verbCounts = _account->accessManager()->requestVerbCounts();
+        for (auto it = verbCounts.cbegin(); it != verbCounts.cend(); ++it) {
+            const quint64 delta = it.value() - _verbCountsAtStart.value(it.key());
+            if (delta > 0) {
+                requests[QString::fromUtf8(it.key())] = qint64(delta);
+            }
+        }
+    }
+
+    // Per-subsystem memory accounting: the peaks attribute a transient RSS
+    // spike during the run, the current values what is still held.
+    QJsonObject memory;
+    memory[QStringLiteral("discoveryItemsBytes")] = discoveryItemsMemoryGauge().value();
+    memory[QStringLiteral("discoveryItemsPeakBytes")] = discoveryItemsMemoryGauge().peak();
+    memory[QStringLiteral("uploadBuffersBytes")] = uploadBuffersMemoryGauge().value();
+    memory[QStringLiteral("uploadBuffersPeakBytes")] = uploadBuffersMemoryGauge().peak();
+    if (_journal) {
+        memory[QStringLiteral("journalFileRecordCacheBytes")] = _journal->fileRecordCacheEstimatedBytes();
+    }
+
+    std::sort_heap(_slowestJobs.begin(), _slowestJobs.end(), fasterJob);
+    QJsonArray slowestJobs;
+    for (const auto &item : _slowestJobs) {
+        QJsonObject job;
+        job[QStringLiteral("file")] = item->destination();
+        job[QStringLiteral("durationMs")] = toMs(item->_jobDuration);
+        job[QStringLiteral("size")] = item->_size;
+        slowestJobs.append(job);
+    }
+    _slowestJobs.clear();
+
+    _performanceReport = QJsonObject();
+    _performanceReport[QStringLiteral("success")] = success;
+    _performanceReport[QStringLiteral("phases")] = phases;
+    _performanceReport[QStringLiteral("discovery")] = discovery;
+    _performanceReport[QStringLiteral("journal")] = journal;
+    _performanceReport[QStringLiteral("requests")] = requests;
+    _performanceReport[QStringLiteral("memory")] = memory;
+    _performanceReport[QStringLiteral("slowestJobs")] = slowestJobs;
+
+    qCInfo(lcEngine) << "Sync performance report:"
+                     << QJsonDocument(_performanceReport).toJson(QJsonDocument::Compact).constData();
+}
+
 void SyncEngine::abort(const QString &reason)
 {
     bool aborting = false;
@@ -630,6 +979,7 @@ void SyncEngine::abort(const QString &reason)
 
 void SyncEngine::slotRootEtagReceived(const QString &e, const QDateTime &time)
 {
+    _currentRunRootEtag = e;
     if (_remoteRootEtag.isEmpty()) {
         qCDebug(lcEngine) << "Root etag:" << e;
         _remoteRootEtag = e;
@@ -660,19 +1010,41 @@ void SyncEngine::slotFolderDiscovered(bool local, const QString &folder)
         _progressInfo->_currentDiscoveredRemoteFolder = folder;
         _progressInfo->_currentDiscoveredLocalFolder.clear();
     }
+    if (_discoveryPhase) {
+        _progressInfo->_discoveryStatistics = _discoveryPhase->_statistics;
+    }
     Q_EMIT transmissionProgress(*_progressInfo);
 }
 
+void SyncEngine::scheduleProgressEmission()
+{
+    if (_progressEmitThrottle.duration() >= 100ms) {
+        _progressEmitThrottle.reset();
+        _progressFlushTimer.stop();
+        Q_EMIT transmissionProgress(*_progressInfo);
+        return;
+    }
+    // Suppressed; deliver the latest snapshot once the storm pauses.
+    if (!_progressFlushTimer.isActive()) {
+        _progressFlushTimer.start();
+    }
+}
+
 void SyncEngine::slotProgress(const SyncFileItem &item, qint64 current)
 {
     _progressInfo->setProgressItem(item, current);
-    Q_EMIT transmissionProgress(*_progressInfo);
+    // Transfer jobs report a tick for every network buffer they move and
+    // small-file storms complete items by the thousand per second. The
+    // accounting above is cheap, but fanning every event out to the GUI -
+    // a ProgressInfo copy per consumer plus a repaint - is not: sample at
+    // roughly 10 Hz instead.
+    scheduleProgressEmission();
 }
 
 void SyncEngine::updateFileTotal(const SyncFileItem &item, qint64 newSize)
 {
     _progressInfo->updateTotalsForFile(item, newSize);
-    Q_EMIT transmissionProgress(*_progressInfo);
+    scheduleProgressEmission();
 }
 
 void SyncEngine::slotItemCompleted(const SyncFileItemPtr &item)
@@ -686,7 +1058,25 @@ void SyncEngine::slotItemCompleted(const SyncFileItemPtr &item)
 
     _progressInfo->setProgressComplete(*item);
 
-    Q_EMIT transmissionProgress(*_progressInfo);
+    // The engine's share of the item memory is released with the job; the
+    // protocol views keep their own references.
+    discoveryItemsMemoryGauge().add(-item->estimatedMemoryUsage());
+
+    // Collect the slowest jobs for the performance report here: the items
+    // were moved into the propagator, so they are no longer reachable from
+    // finalize(). A small min-heap keeps this O(log n) per item.
+    if (item->_jobDuration > std::chrono::nanoseconds::zero()) {
+        if (_slowestJobs.size() < slowestJobsReportSizeC) {
+            _slowestJobs.push_back(item);
+            std::push_heap(_slowestJobs.begin(), _slowestJobs.end(), fasterJob);
+        } else if (item->_jobDuration > _slowestJobs.front()->_jobDuration) {
+            std::pop_heap(_slowestJobs.begin(), _slowestJobs.end(), fasterJob);
+            _slowestJobs.back() = item;
+            std::push_heap(_slowestJobs.begin(), _slowestJobs.end(), fasterJob);
+        }
+    }
+
+    scheduleProgressEmission();
 
     _syncFileStatusTracker->updateItemCompleted(item);
     Q_EMIT itemCompleted(item);
@@ -793,6 +1183,35 @@ bool SyncEngine::shouldDiscoverLocally(const QString &path) const
     return false;
 }
 
+QSet<QString> SyncEngine::localTouchedChildrenOf(const QString &path) const
+{
+    if (_localDiscoveryStyle != LocalDiscoveryStyle::DatabaseAndFilesystem) {
+        return {};
+    }
+
+    // Thanks to the normalization in setLocalDiscoveryOptions() the set holds
+    // no nested paths. If the path itself (with or without trailing slash) is
+    // in the set, no entry below it can be, so the loop finds nothing and a
+    // full listing is requested.
+    QSet<QString> children;
+    const QString prefix = path.isEmpty() ? QString() : path + QLatin1Char('/');
+    for (auto it = _localDiscoveryPaths.lower_bound(prefix); it != _localDiscoveryPaths.end() && it->startsWith(prefix); ++it) {
+        const int nextSlash = it->indexOf(QLatin1Char('/'), prefix.size());
+        if (nextSlash < 0) {
+            if (it->size() == prefix.size()) {
+                // The directory itself, listed with a trailing slash.
+                return {};
+            }
+            children.insert(it->mid(prefix.size()));
+        } else {
+            // A deeper path was touched. Stat the child directory so the
+            // discovery descends into it; its own job narrows down again.
+            children.insert(it->mid(prefix.size(), nextSlash - prefix.size()));
+        }
+    }
+    return children;
+}
+
 void SyncEngine::slotSummaryError(const QString &message)
 {
     if (_uniqueErrors.contains(message))
@@ -849,6 +1268,16 @@ void SyncEngine::pathTouched(const QString &fileName)
         _syncFileStatusTracker->pathTouched(fileName);
 }
 
+void SyncEngine::prioritizePath(const QString &relativePath)
+{
+    if (!_priorityPaths.contains(relativePath)) {
+        _priorityPaths.append(relativePath);
+    }
+    if (_propagator) {
+        _propagator->prioritizePath(relativePath);
+    }
+}
+
 bool SyncEngine::reloadExcludes()
 {
     return _excludedFiles->reloadExcludeFiles();
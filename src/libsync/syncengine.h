@@ -18,14 +18,18 @@
 #include "account.h"
 #include "common/checksums.h"
 #include "common/chronoelapsedtimer.h"
+#include "common/syncjournalfilerecord.h"
 #include "discoveryphase.h"
 #include "progressdispatcher.h"
 #include "syncfileitem.h"
 #include "syncfilestatustracker.h"
+#include "transfermetrics.h"
 
+#include <QJsonObject>
 #include <QMutex>
 #include <QThread>
 #include <QString>
+#include <QTimer>
 #include <QSet>
 #include <QMap>
 #include <QStringList>
@@ -33,6 +37,8 @@
 
 #include <optional>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 class QProcess;
 
@@ -42,6 +48,7 @@ class SyncJournalFileRecord;
 class SyncJournalDb;
 class OwncloudPropagator;
 class ProcessDirectoryJob;
+class DownloadPrefetcher;
 
 /**
  * @brief The SyncEngine class
@@ -84,10 +91,27 @@ public:
     SyncFileStatus fileStatus(const QString &relativePath);
     void pathTouched(const QString &fileName);
 
+    /** Schedules queued transfers at or below this folder-relative path
+     * ahead of the remaining bulk of a running sync.
+     *
+     * Takes effect immediately on a running propagation and carries over
+     * to the next one, see OwncloudPropagator::prioritizePath().
+     */
+    void prioritizePath(const QString &relativePath);
+
 
     /* Returns whether another sync is needed to complete the sync */
     bool isAnotherSyncNeeded() { return _anotherSyncNeeded; }
 
+    /** Performance profile of the last completed sync run.
+     *
+     * One JSON blob with the per-phase wall times, discovery statistics,
+     * journal query count, per-verb request counts and the slowest
+     * propagation jobs. Assembled in finalize(); empty while a sync is
+     * running or before the first run.
+     */
+    QJsonObject performanceReport() const { return _performanceReport; }
+
     QString localPath() const { return _localPath; }
 
     /** Duration in ms that uploads should be delayed after a file change
@@ -127,6 +151,27 @@ public:
     /** Access the last sync run's local discovery style */
     LocalDiscoveryStyle lastLocalDiscoveryStyle() const { return _lastLocalDiscoveryStyle; }
 
+    /**
+     * Returns the touched entry names directly below the given folder-relative path.
+     *
+     * Only meaningful with LocalDiscoveryStyle::DatabaseAndFilesystem. A
+     * non-empty result means the directory itself did not change, only the
+     * named entries did, so local discovery can stat those individually
+     * instead of listing the whole directory. An empty result means a full
+     * listing is required (or nothing below the path was touched at all).
+     */
+    QSet<QString> localTouchedChildrenOf(const QString &path) const;
+
+    /** Latest remote root etag known from outside the engine (e.g. the gui's etag poll).
+     *
+     * When it matches the root etag of the last fully successful sync run and
+     * no path was scheduled for remote rediscovery in the meantime, the next
+     * run serves the remote tree from the journal instead of issuing PROPFINDs.
+     * This makes back-to-back syncs triggered by local changes network-free on
+     * the remote side; an etag change reported here re-enables full discovery.
+     */
+    void setKnownRemoteRootEtag(const QString &etag) { _knownRemoteRootEtag = etag; }
+
 
 Q_SIGNALS:
 
@@ -143,6 +188,14 @@ Q_SIGNALS:
 
     void transmissionProgress(const ProgressInfo &progress);
 
+    /** One structured record per finished transfer.
+     *
+     * Forwarded from OwncloudPropagator::transferMetrics. Sink for
+     * tooling that wants to answer throughput questions without packet
+     * captures; nothing is recorded unless someone connects.
+     */
+    void transferMetrics(const TransferMetrics &metrics);
+
     /// We've produced a new sync error of a type.
     void syncError(const QString &message, ErrorCategory category = ErrorCategory::Normal);
     void excluded(const QString &path);
@@ -184,6 +237,14 @@ private Q_SLOTS:
     void slotInsufficientRemoteStorage();
 
 private:
+    /** Emits transmissionProgress() at most every progress sample interval.
+     *
+     * Suppressed updates arm a trailing single-shot flush, so the GUI always
+     * ends up with the latest snapshot once the event storm pauses. Status
+     * transitions bypass this and emit directly.
+     */
+    void scheduleProgressEmission();
+
     bool checkErrorBlacklisting(SyncFileItem &item);
 
     // Cleans up unnecessary downloadinfo entries in the journal as well
@@ -209,9 +270,24 @@ private:
     // cleanup and Q_EMIT the finished signal
     void finalize(bool success);
 
+    // builds _performanceReport from the run's counters, see performanceReport()
+    void assemblePerformanceReport(bool success);
+
     // Must only be acessed during update and reconcile
     SyncFileItemSet _syncItems;
 
+    /** Discovered items, bucketed by the parent directory of their destination.
+     *
+     * Items accumulate here while discovery runs and are flattened into the
+     * sorted _syncItems in one linear pass once discovery is done, see
+     * takeDiscoveredItems(). This replaces per-item insertion into the
+     * ordered set, which cost an O(log n) full-path comparison per item.
+     */
+    std::unordered_map<QString, std::vector<SyncFileItemPtr>> _discoveredItems;
+
+    /** Flattens _discoveredItems into a SyncFileItemSet in destination order. */
+    SyncFileItemSet takeDiscoveredItems();
+
     // the ever present account pointer primarily used for running jobs
     QPointer<Account> _account;
 
@@ -223,6 +299,20 @@ private:
     QString _remotePath;
     QString _remoteRootEtag;
 
+    /** Root etag seen by the current run's discovery; unlike _remoteRootEtag
+     * this is not latched over the engine's lifetime. */
+    QString _currentRunRootEtag;
+    /** Root etag of the last fully successful sync run. Persisted in the
+     * journal's key-value store so a freshly started process can skip remote
+     * discovery as well when the server reports an unchanged root etag. */
+    QString _lastSuccessfulRootEtag;
+    /** Whether _lastSuccessfulRootEtag was restored from the journal yet. */
+    bool _lastSuccessfulRootEtagLoaded = false;
+    /** See setKnownRemoteRootEtag(). */
+    QString _knownRemoteRootEtag;
+    /** Whether the current run serves the remote tree from the journal. */
+    bool _remoteDiscoverySkipped = false;
+
     // this is owned by the folder
     QPointer<SyncJournalDb> _journal;
 
@@ -232,6 +322,12 @@ private:
     QPointer<DiscoveryPhase> _discoveryPhase;
     QPointer<OwncloudPropagator> _propagator;
 
+    /** Downloads file payloads while discovery is still running, see DownloadPrefetcher.
+     *
+     * Only exists during the discovery phase of a run and only when enabled.
+     */
+    DownloadPrefetcher *_downloadPrefetcher = nullptr;
+
     // these pointers are all parented/owned by the engine
     ProgressInfo *_progressInfo = nullptr;
     ExcludedFiles *_excludedFiles = nullptr;
@@ -239,8 +335,42 @@ private:
 
     // List of all files with conflicts
     QSet<QString> _seenConflictFiles;
+
+    /** Paths discovery excluded in this run.
+     *
+     * These exist on disk but end up in neither the journal nor the sync
+     * items; the propagator's case-clash pre-filter needs to know about
+     * them. Only collected on case-insensitive filesystems.
+     */
+    QStringList _discoveryExcludedPaths;
+
+    /// User-prioritized paths, handed to each new propagator. See prioritizePath().
+    QStringList _priorityPaths;
+
+    /** Error blacklist snapshot taken at sync start, see checkErrorBlacklisting().
+     *
+     * Keys are lowercased on case-insensitive filesystems.
+     */
+    QHash<QString, SyncJournalErrorBlacklistRecord> _errorBlacklistCache;
     Utility::ChronoElapsedTimer _duration;
 
+    // Raw material for the performance report, see assemblePerformanceReport().
+    // The durations are offsets into _duration at the respective phase ends,
+    // the counters are process-wide snapshots taken at sync start.
+    QJsonObject _performanceReport;
+    std::chrono::nanoseconds _discoveryDuration { 0 };
+    std::chrono::nanoseconds _propagationStartOffset { 0 };
+    quint64 _sqlExecCountAtStart = 0;
+    QHash<QByteArray, quint64> _verbCountsAtStart;
+    /// Min-heap on _jobDuration holding the slowest completed jobs of the run
+    std::vector<SyncFileItemPtr> _slowestJobs;
+
+    /** Throttles transmissionProgress() emissions to roughly 10 Hz,
+     * see scheduleProgressEmission().
+     */
+    Utility::ChronoElapsedTimer _progressEmitThrottle;
+    QTimer _progressFlushTimer;
+
     /**
      * Instead of downloading files from the server, upload the files to the server
      */
@@ -21,6 +21,7 @@
 #include <QMetaType>
 #include <QSharedPointer>
 
+#include <chrono>
 #include <set>
 
 #include "common/syncjournaldb.h"
@@ -33,6 +34,18 @@ namespace OCC {
 
 class SyncFileItem;
 class SyncJournalFileRecord;
+
+/** Shared handle to a SyncFileItem.
+ *
+ * Discovery allocates one item per directory entry, so on large trees this
+ * is the hottest allocation in a sync run. Always create items through
+ * SyncFileItemPtr::create(): it co-allocates the control block with the item,
+ * halving the number of heap allocations compared to wrapping a plain new.
+ *
+ * Items deliberately do not come from a run-scoped arena: consumers of
+ * itemCompleted() (the protocol and issue views) keep references long after
+ * the run that produced them has finished.
+ */
 typedef QSharedPointer<SyncFileItem> SyncFileItemPtr;
 
 /**
@@ -141,24 +154,7 @@ public:
     static SyncFileItemPtr fromSyncJournalFileRecord(const SyncJournalFileRecord &rec);
 
 
-    SyncFileItem()
-        : _type(ItemTypeSkip)
-        , _direction(None)
-        , _serverHasIgnoredFiles(false)
-        , _hasBlacklistEntry(false)
-        , _status(NoStatus)
-        , _isRestoration(false)
-        , _isSelectiveSync(false)
-        , _httpErrorCode(0)
-        , _affectedItems(1)
-        , _modtime(0)
-        , _size(0)
-        , _inode(0)
-        , _previousSize(0)
-        , _previousModtime(0)
-        , _relevantDirectoyInstruction(false)
-    {
-    }
+    SyncFileItem() = default;
 
     friend bool operator==(const SyncFileItem &item1, const SyncFileItem &item2)
     {
@@ -247,6 +243,11 @@ public:
     }
 
     // Variables useful for everybody
+    //
+    // Members are declared grouped by alignment -- pointer-sized fields
+    // first, then the 4-, 2- and 1-byte ones -- so the struct carries no
+    // interior padding. Discovery allocates one item per directory entry,
+    // so every padding byte here is multiplied by the size of the tree.
 
     /** The syncfolder-relative filesystem path that the operation is about
      *
@@ -266,33 +267,14 @@ public:
      */
     QString _originalFile;
 
-    ItemType _type;
-    Direction _direction;
-    bool _serverHasIgnoredFiles;
-
-    /// Whether there's an entry in the blacklist table.
-    /// Note: that entry may have retries left, so this can be true
-    /// without the status being FileIgnored.
-    bool _hasBlacklistEntry;
-
     // Variables useful to report to the user
-    Status _status;
-    bool _isRestoration; // The original operation was forbidden, and this is a restoration
-    bool _isSelectiveSync; // The file is removed or ignored because it is in the selective sync list
-    quint16 _httpErrorCode;
-    RemotePermissions _remotePerm;
     QString _errorString; // Contains a string only in case of error
     QString _messageString; // Contains a string only in case of hand crafted events
+    QString _etag;
+    QString _directDownloadUrl;
+    QString _directDownloadCookies;
     QByteArray _responseTimeStamp;
     QByteArray _requestId; // X-Request-Id of the failed request
-    quint32 _affectedItems; // the number of affected items by the operation on this item.
-    // usually this value is 1, but for removes on dirs, it might be much higher.
-
-    // Variables used by the propagator
-    time_t _modtime;
-    QString _etag;
-    qint64 _size;
-    quint64 _inode;
     QByteArray _fileId;
 
     // This is the value for the 'new' side, matching with _size and _modtime.
@@ -303,16 +285,54 @@ public:
     // - for conflicts (remote checksum)
     QByteArray _checksumHeader;
 
+    // Variables used by the propagator
+    time_t _modtime = 0;
+    qint64 _size = 0;
+    quint64 _inode = 0;
+
     // The size and modtime of the file getting overwritten (on the disk for downloads, on the server for uploads).
-    qint64 _previousSize;
-    time_t _previousModtime;
+    qint64 _previousSize = 0;
+    time_t _previousModtime = 0;
 
-    QString _directDownloadUrl;
-    QString _directDownloadCookies;
+    /// Wall time the propagation job for this item ran, for the performance report
+    std::chrono::nanoseconds _jobDuration = std::chrono::nanoseconds::zero();
+
+    quint32 _affectedItems = 1; // the number of affected items by the operation on this item.
+    // usually this value is 1, but for removes on dirs, it might be much higher.
+
+    quint16 _httpErrorCode = 0;
+    RemotePermissions _remotePerm;
 
+    ItemType _type = ItemTypeSkip;
+    Direction _direction = None;
+    Status _status = NoStatus;
+    bool _serverHasIgnoredFiles = false;
+
+    /// Whether there's an entry in the blacklist table.
+    /// Note: that entry may have retries left, so this can be true
+    /// without the status being FileIgnored.
+    bool _hasBlacklistEntry = false;
+
+    bool _isRestoration = false; // The original operation was forbidden, and this is a restoration
+    bool _isSelectiveSync = false; // The file is removed or ignored because it is in the selective sync list
     bool _relevantDirectoyInstruction = false;
     bool _finished = false;
 
+    /** Rough heap footprint of this item in bytes.
+     *
+     * Feeds the per-subsystem memory accounting of the sync performance
+     * report. Counts the item, its shared-pointer control block and the
+     * payload of its string members; an estimate, not an exact figure.
+     */
+    qint64 estimatedMemoryUsage() const
+    {
+        return qint64(sizeof(*this)) + 2 * qint64(sizeof(void *))
+            + qint64(_file.size() + _renameTarget.size() + _originalFile.size() + _errorString.size() + _messageString.size() + _etag.size()
+                  + _directDownloadUrl.size() + _directDownloadCookies.size())
+            * qint64(sizeof(QChar))
+            + _fileId.size() + _checksumHeader.size() + _responseTimeStamp.size() + _requestId.size();
+    }
+
     auto toUploadInfo() const
     {
         SyncJournalDb::UploadInfo out;
@@ -330,6 +350,12 @@ private:
     SyncInstruction _instruction = CSYNC_INSTRUCTION_NONE;
 };
 
+// Catch accidental regrowth: a single careless member can cost dozens of
+// megabytes on a large tree. The exact size is ABI-dependent, so the budget
+// is only pinned down for the common 64-bit platforms.
+static_assert(sizeof(void *) != 8 || sizeof(SyncFileItem) <= 368,
+    "SyncFileItem grew; check the member packing before raising the budget");
+
 
 template <>
 OWNCLOUDSYNC_EXPORT QString Utility::enumToDisplayName(SyncFileItem::Status s);
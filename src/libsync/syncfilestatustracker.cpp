@@ -36,30 +36,60 @@ bool SyncFileStatusTracker::PathComparator::operator()( const QString& lhs, cons
 
 SyncFileStatus::SyncFileStatusTag SyncFileStatusTracker::lookupProblem(const QString &pathToMatch, const SyncFileStatusTracker::ProblemsMap &problemMap)
 {
-    auto lower = problemMap.lower_bound(pathToMatch);
-    for (auto it = lower; it != problemMap.cend(); ++it) {
-        const QString &problemPath = it->first;
-        SyncFileStatus::SyncFileStatusTag severity = it->second;
-
-        if (problemPath.compare(pathToMatch, _caseSensitivity) == 0) {
-            return severity;
-        } else if (severity == SyncFileStatus::StatusError
-            && problemPath.startsWith(pathToMatch, _caseSensitivity)
-            && (pathToMatch.isEmpty() || problemPath.at(pathToMatch.size()) == QLatin1Char('/'))) {
-            return SyncFileStatus::StatusWarning;
-        } else if (!problemPath.startsWith(pathToMatch, _caseSensitivity)) {
-            // Starting at lower_bound we get the first path that is not smaller,
-            // since: "a/" < "a/aa" < "a/aa/aaa" < "a/ab/aba"
-            // If problemMap keys are ["a/aa/aaa", "a/ab/aba"] and pathToMatch == "a/aa",
-            // lower_bound(pathToMatch) will point to "a/aa/aaa", and the moment that
-            // problemPath.startsWith(pathToMatch) == false, we know that we've looked
-            // at everything that interest us.
-            break;
-        }
-    }
+    // The errorsBelow aggregate is maintained by setProblem()/clearProblem(),
+    // so neither an exact problem nor the warning that an error somewhere in
+    // a directory casts on its parents needs a subtree scan here.
+    auto it = problemMap.find(pathToMatch);
+    if (it == problemMap.cend())
+        return SyncFileStatus::StatusNone;
+    if (it->second.severity != SyncFileStatus::StatusNone)
+        return it->second.severity;
+    if (it->second.errorsBelow > 0)
+        return SyncFileStatus::StatusWarning;
     return SyncFileStatus::StatusNone;
 }
 
+void SyncFileStatusTracker::setProblem(const QString &path, SyncFileStatus::SyncFileStatusTag severity)
+{
+    ProblemNode &node = _syncProblems[path];
+    if (node.severity == severity)
+        return;
+    const bool wasError = node.severity == SyncFileStatus::StatusError;
+    const bool isError = severity == SyncFileStatus::StatusError;
+    node.severity = severity;
+    if (wasError != isError)
+        adjustErrorsBelow(path, isError ? +1 : -1);
+}
+
+void SyncFileStatusTracker::clearProblem(const QString &path)
+{
+    auto it = _syncProblems.find(path);
+    if (it == _syncProblems.end())
+        return;
+    const bool wasError = it->second.severity == SyncFileStatus::StatusError;
+    it->second.severity = SyncFileStatus::StatusNone;
+    if (it->second.errorsBelow == 0)
+        _syncProblems.erase(it);
+    if (wasError)
+        adjustErrorsBelow(path, -1);
+}
+
+void SyncFileStatusTracker::adjustErrorsBelow(const QString &path, int delta)
+{
+    // Walk the ancestor chain up to (and including) the root "", so an item
+    // completion costs O(depth) instead of invalidating prefix ranges.
+    QString ancestor = path;
+    while (!ancestor.isEmpty()) {
+        const int lastSlashIndex = ancestor.lastIndexOf(QLatin1Char('/'));
+        ancestor = lastSlashIndex != -1 ? ancestor.left(lastSlashIndex) : QString();
+        auto it = _syncProblems.try_emplace(ancestor).first;
+        it->second.errorsBelow += delta;
+        OC_ASSERT(it->second.errorsBelow >= 0);
+        if (it->second.errorsBelow <= 0 && it->second.severity == SyncFileStatus::StatusNone)
+            _syncProblems.erase(it);
+    }
+}
+
 /**
  * Whether this item should get an ERROR icon through the Socket API.
  *
@@ -87,8 +117,7 @@ SyncFileStatusTracker::SyncFileStatusTracker(const QString &folderPath, SyncJour
     , _syncEngine(syncEngine)
     , _folderPath(folderPath)
     , _journal(journal)
-    , _caseSensitivity(Utility::fsCaseSensitivity())
-{        
+{
 }
 
 SyncFileStatus SyncFileStatusTracker::fileStatus(const QString &relativePath)
@@ -148,7 +177,7 @@ void SyncFileStatusTracker::pathTouched(const QString &fileName)
 
 void SyncFileStatusTracker::slotAddExcluded(const QString &folderPath)
 {
-    _syncProblems[folderPath] = SyncFileStatus::StatusExcluded;
+    setProblem(folderPath, SyncFileStatus::StatusExcluded);
     Q_EMIT fileStatusChanged(getSystemDestination(folderPath), resolveSyncAndErrorStatus(folderPath, NotShared));
 }
 
@@ -208,10 +237,10 @@ void SyncFileStatusTracker::updateAboutToPropagate(const SyncFileItemSet &items)
         _dirtyPaths.remove(item->_originalFile);
 
         if (hasErrorStatus(*item)) {
-            _syncProblems[item->destination()] = SyncFileStatus::StatusError;
+            setProblem(item->destination(), SyncFileStatus::StatusError);
             invalidateParentPaths(item->destination());
         } else if (hasExcludedStatus(*item)) {
-            _syncProblems[item->destination()] = SyncFileStatus::StatusExcluded;
+            setProblem(item->destination(), SyncFileStatus::StatusExcluded);
         }
 
         SharedFlag sharedFlag = item->_remotePerm.hasPermission(RemotePermissions::IsShared) ? Shared : NotShared;
@@ -233,11 +262,17 @@ void SyncFileStatusTracker::updateAboutToPropagate(const SyncFileItemSet &items)
 
     // Make sure to push any status that might have been resolved indirectly since the last sync
     // (like an error file being deleted from disk)
-    for (auto it = _syncProblems.begin(); it != _syncProblems.end(); ++it)
-        oldProblems.erase(it->first);
     for (auto it = oldProblems.begin(); it != oldProblems.end(); ++it) {
         const QString &path = it->first;
-        SyncFileStatus::SyncFileStatusTag severity = it->second;
+        SyncFileStatus::SyncFileStatusTag severity = it->second.severity;
+        if (severity == SyncFileStatus::StatusNone) {
+            // A pure aggregate node; its path was never shown as a problem
+            // itself, the parents of vanished errors are invalidated below.
+            continue;
+        }
+        auto newIt = _syncProblems.find(path);
+        if (newIt != _syncProblems.end() && newIt->second.severity != SyncFileStatus::StatusNone)
+            continue;
         if (severity == SyncFileStatus::StatusError)
             invalidateParentPaths(path);
         Q_EMIT fileStatusChanged(getSystemDestination(path), fileStatus(path));
@@ -249,12 +284,12 @@ void SyncFileStatusTracker::updateItemCompleted(const SyncFileItemPtr &item)
     qCDebug(lcStatusTracker) << "Item completed" << item->destination() << item->_status << item->instruction();
 
     if (hasErrorStatus(*item)) {
-        _syncProblems[item->destination()] = SyncFileStatus::StatusError;
+        setProblem(item->destination(), SyncFileStatus::StatusError);
         invalidateParentPaths(item->destination());
     } else if (hasExcludedStatus(*item)) {
-        _syncProblems[item->destination()] = SyncFileStatus::StatusExcluded;
+        setProblem(item->destination(), SyncFileStatus::StatusExcluded);
     } else {
-        _syncProblems.erase(item->destination());
+        clearProblem(item->destination());
     }
 
     SharedFlag sharedFlag = item->_remotePerm.hasPermission(RemotePermissions::IsShared) ? Shared : NotShared;
@@ -58,8 +58,24 @@ private:
     struct PathComparator {
         bool operator()( const QString& lhs, const QString& rhs ) const;
     };
-    typedef std::map<QString, SyncFileStatus::SyncFileStatusTag, PathComparator> ProblemsMap;
-    SyncFileStatus::SyncFileStatusTag lookupProblem(const QString &pathToMatch, const ProblemsMap &problemMap);
+    /** Node of the incrementally maintained problem tree.
+     *
+     * severity is the problem of the path itself, errorsBelow counts the
+     * StatusError descendants of the path. The counts are adjusted along the
+     * ancestor chain whenever a problem is set or cleared, so resolving a
+     * status (including the warning shown on parents of an error) is a
+     * single map lookup instead of a subtree scan.
+     */
+    struct ProblemNode
+    {
+        SyncFileStatus::SyncFileStatusTag severity = SyncFileStatus::StatusNone;
+        int errorsBelow = 0;
+    };
+    typedef std::map<QString, ProblemNode, PathComparator> ProblemsMap;
+    static SyncFileStatus::SyncFileStatusTag lookupProblem(const QString &pathToMatch, const ProblemsMap &problemMap);
+    void setProblem(const QString &path, SyncFileStatus::SyncFileStatusTag severity);
+    void clearProblem(const QString &path);
+    void adjustErrorsBelow(const QString &path, int delta);
 
     enum SharedFlag { UnknownShared,
         NotShared,
@@ -85,9 +101,6 @@ private:
     // We'll show a file/directory as SYNC as long as its sync count is > 0.
     // A directory that starts/ends propagation will in turn increase/decrease its own parent by 1.
     QHash<QString, int> _syncCount;
-
-    // case sensitivity used for path comparisons
-    Qt::CaseSensitivity _caseSensitivity;
 };
 }
 
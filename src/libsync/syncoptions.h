@@ -42,9 +42,21 @@ public:
 
     Vfs *vfs() const { return _vfs; }
 
-    /** The maximum number of active jobs in parallel  */
+    /** The maximum number of active jobs in parallel
+     *
+     * On an HTTP/2 connection this is effectively the concurrent-stream
+     * target, see Folder::loadSyncOptions().
+     */
     int _parallelNetworkJobs = 6;
 
+    /** The maximum number of directory discovery jobs in parallel.
+     *
+     * Discovery is latency bound: each directory costs one PROPFIND round trip,
+     * so wide trees benefit from a larger fan-out than propagation needs.
+     * 0 means "derive from _parallelNetworkJobs".
+     */
+    int _parallelDiscoveryJobs = 0;
+
     /**
      * @brief isValid indicates if the options are complete
      * @return true if vfs is non-null, else false
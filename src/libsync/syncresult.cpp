@@ -99,6 +99,14 @@ void SyncResult::clearErrors()
     _errors.clear();
 }
 
+void SyncResult::registerTransferMetrics(const TransferMetrics &metrics)
+{
+    if (metrics.stalls > 0) {
+        _numStalledTransfers++;
+        _transferStallTime += metrics.stalledFor;
+    }
+}
+
 void SyncResult::processCompletedItem(const SyncFileItemPtr &item)
 {
     if (Progress::isWarningKind(item->_status)) {
@@ -18,10 +18,14 @@
 #include <QStringList>
 #include <QHash>
 #include <QDateTime>
+#include <QJsonObject>
 
 #include "common/utility.h"
 #include "owncloudlib.h"
 #include "syncfileitem.h"
+#include "transfermetrics.h"
+
+#include <chrono>
 
 namespace OCC {
 
@@ -74,6 +78,19 @@ public:
 
     void processCompletedItem(const SyncFileItemPtr &item);
 
+    /** Rolls the per-transfer telemetry up over the run.
+     *
+     * Answers "was this sync slow because connections stalled" without
+     * digging through per-file records.
+     */
+    void registerTransferMetrics(const TransferMetrics &metrics);
+    int numStalledTransfers() const { return _numStalledTransfers; }
+    std::chrono::milliseconds transferStallTime() const { return _transferStallTime; }
+
+    /** The engine's performance profile of the run, see SyncEngine::performanceReport() */
+    QJsonObject performanceReport() const { return _performanceReport; }
+    void setPerformanceReport(const QJsonObject &report) { _performanceReport = report; }
+
     int numBlacklistErrors() const;
 
 private:
@@ -97,6 +114,12 @@ private:
     int _numOldConflictItems = 0;
     int _numErrorItems = 0;
 
+    // aggregated transfer telemetry, see registerTransferMetrics()
+    int _numStalledTransfers = 0;
+    std::chrono::milliseconds _transferStallTime { 0 };
+
+    QJsonObject _performanceReport;
+
     SyncFileItemPtr _firstItemNew;
     SyncFileItemPtr _firstItemDeleted;
     SyncFileItemPtr _firstItemUpdated;
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "transfermetrics.h"
+
+namespace OCC {
+
+QDebug operator<<(QDebug debug, const TransferMetrics &metrics)
+{
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "TransferMetrics("
+                    << (metrics.direction == TransferMetrics::Direction::Upload ? "upload" : "download")
+                    << " " << metrics.file
+                    << ", bytes=" << metrics.bytes
+                    << ", duration=" << metrics.duration.count() << "ms"
+                    << ", checksum=" << metrics.checksumDuration.count() << "ms"
+                    << ", ttfb=" << metrics.timeToFirstByte.count() << "ms"
+                    << ", stalls=" << metrics.stalls
+                    << ", stalledFor=" << metrics.stalledFor.count() << "ms"
+                    << ", chunks=" << metrics.chunks
+                    << ", retries=" << metrics.retries
+                    << ")";
+    return debug;
+}
+}
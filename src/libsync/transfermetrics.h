@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QDebug>
+#include <QString>
+
+#include <chrono>
+
+namespace OCC {
+
+/**
+ * One structured record per finished transfer.
+ *
+ * Assembled by the upload and download jobs and emitted through
+ * SyncEngine::transferMetrics(), so that "why was this sync slow" can be
+ * answered from client data instead of packet captures.
+ *
+ * \ingroup libsync
+ */
+struct TransferMetrics
+{
+    enum class Direction {
+        Upload,
+        Download,
+    };
+
+    /// Path of the item relative to the sync root
+    QString file;
+    Direction direction = Direction::Upload;
+    /// Size of the transferred item
+    qint64 bytes = 0;
+    /// Wall clock time from job start to completion, checksumming included
+    std::chrono::milliseconds duration { 0 };
+    /// Time spent computing or validating checksums
+    std::chrono::milliseconds checksumDuration { 0 };
+    /// Downloads only: time until the response headers arrived. Zero for
+    /// uploads, where the request body goes out before any response.
+    std::chrono::milliseconds timeToFirstByte { 0 };
+    /// Downloads only: mid-transfer windows in which no data arrived,
+    /// and the time lost to them
+    int stalls = 0;
+    std::chrono::milliseconds stalledFor { 0 };
+    /// Number of requests that carried payload
+    int chunks = 0;
+    /// Transfer-level retries (e.g. falling back from a direct download URL)
+    int retries = 0;
+};
+
+OWNCLOUDSYNC_EXPORT QDebug operator<<(QDebug debug, const TransferMetrics &metrics);
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "uploadbundler.h"
+
+#include "account.h"
+#include "capabilities.h"
+#include "common/utility.h"
+#include "networkjobs.h"
+#include "propagateuploadcommon.h"
+
+#include <QFile>
+#include <QTimer>
+#include <QUuid>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+struct BundlePartResult
+{
+    QString href;
+    QString etag;
+    QByteArray fileId;
+    QString permissions;
+    int httpCode = 0;
+};
+
+QVector<BundlePartResult> parseMultistatus(QIODevice *device)
+{
+    QVector<BundlePartResult> results;
+    BundlePartResult current;
+    QXmlStreamReader reader(device);
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartElement: {
+            const auto name = reader.name();
+            if (name == QLatin1String("response")) {
+                current = {};
+            } else if (name == QLatin1String("href")) {
+                current.href = QUrl::fromPercentEncoding(reader.readElementText().toUtf8());
+            } else if (name == QLatin1String("getetag")) {
+                current.etag = OCC::Utility::normalizeEtag(reader.readElementText());
+            } else if (name == QLatin1String("fileid") || name == QLatin1String("id")) {
+                current.fileId = reader.readElementText().toUtf8();
+            } else if (name == QLatin1String("permissions")) {
+                current.permissions = reader.readElementText();
+            } else if (name == QLatin1String("status")) {
+                // "HTTP/1.1 201 Created"
+                const auto parts = reader.readElementText().split(QLatin1Char(' '));
+                if (parts.size() >= 2) {
+                    current.httpCode = parts.at(1).toInt();
+                }
+            }
+            break;
+        }
+        case QXmlStreamReader::EndElement:
+            if (reader.name() == QLatin1String("response")) {
+                results.append(current);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return results;
+}
+}
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcUploadBundler, "sync.propagator.upload.bundler", QtInfoMsg)
+
+UploadBundler::UploadBundler(OwncloudPropagator *propagator)
+    : QObject(propagator)
+    , _propagator(propagator)
+{
+}
+
+bool UploadBundler::canBundle(const PropagateUploadCommon *job) const
+{
+    if (_endpointUnusable || !_propagator->account()->capabilities().uploadBundling()) {
+        return false;
+    }
+    return job->_item->_size <= _propagator->smallFileSize();
+}
+
+void UploadBundler::enqueue(PropagateUploadCommon *job)
+{
+    _pending.append(job);
+    _pendingPayload += job->_item->_size;
+    if (_pending.size() >= maxFilesPerBundle || _pendingPayload >= maxBundlePayload) {
+        flush();
+        return;
+    }
+    scheduleFlush();
+}
+
+void UploadBundler::scheduleFlush()
+{
+    // Debounced like OwncloudPropagator::scheduleNextJob(): everything the
+    // scheduler starts in this event loop round trip joins one bundle.
+    if (_flushScheduled) {
+        return;
+    }
+    _flushScheduled = true;
+    QTimer::singleShot(0, this, [this] {
+        _flushScheduled = false;
+        flush();
+    });
+}
+
+void UploadBundler::flush()
+{
+    if (_pending.isEmpty()) {
+        return;
+    }
+    if (_propagator->_abortRequested) {
+        // The abort machinery winds the waiting jobs down.
+        _pending.clear();
+        _pendingPayload = 0;
+        return;
+    }
+    const auto candidates = std::exchange(_pending, {});
+    _pendingPayload = 0;
+
+    const QByteArray boundary = "oc_upload_bundle_" + QUuid::createUuid().toByteArray(QUuid::Id128);
+    QByteArray body;
+    QVector<QPointer<PropagateUploadCommon>> bundled;
+    for (const auto &jobPointer : candidates) {
+        PropagateUploadCommon *job = jobPointer.data();
+        if (!job || job->state() == PropagatorJob::Finished) {
+            continue;
+        }
+        QFile file(_propagator->fullLocalPath(job->_item->_file));
+        if (!file.open(QIODevice::ReadOnly)) {
+            // Soft error like the individual upload device path: likely the
+            // user is modifying their files while syncing.
+            job->abortWithError(SyncFileItem::SoftError, file.errorString());
+            continue;
+        }
+        const QByteArray content = file.readAll();
+        if (content.size() != job->_item->_size) {
+            _propagator->_anotherSyncNeeded = true;
+            job->abortWithError(SyncFileItem::Message, PropagateUploadCommon::fileChangedMessage());
+            continue;
+        }
+
+        auto headers = job->headers();
+        headers[QByteArrayLiteral("Content-Length")] = QByteArray::number(content.size());
+        headers[QByteArrayLiteral("X-OC-Method")] = QByteArrayLiteral("PUT");
+        headers[QByteArrayLiteral("X-OC-Path")] = _propagator->fullRemotePath(job->_item->_file).toUtf8();
+        if (!job->_transmissionChecksumHeader.isEmpty()) {
+            headers[QByteArrayLiteral("OC-Checksum")] = job->_transmissionChecksumHeader;
+        }
+
+        body += "--" + boundary + "\r\n";
+        for (auto it = headers.cbegin(); it != headers.cend(); ++it) {
+            body += it.key() + ": " + it.value() + "\r\n";
+        }
+        body += "\r\n";
+        body += content;
+        body += "\r\n";
+        bundled.append(job);
+    }
+    if (bundled.isEmpty()) {
+        return;
+    }
+    body += "--" + boundary + "--\r\n";
+
+    qCInfo(lcUploadBundler) << "Sending" << bundled.size() << "small uploads as one bundle of" << body.size() << "bytes";
+
+    QNetworkRequest req;
+    req.setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("multipart/related; boundary=") + boundary);
+    auto *job = new SimpleNetworkJob(_propagator->account(), _propagator->account()->url(), QStringLiteral("remote.php/dav/bundle"), "POST", std::move(body), req, this);
+    connect(job, &SimpleNetworkJob::finishedSignal, this, [this, job, bundled] {
+        if (job->reply()->error() != QNetworkReply::NoError) {
+            const int httpCode = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (httpCode == 404 || httpCode == 405 || httpCode == 501) {
+                qCWarning(lcUploadBundler) << "Server does not provide the bundling endpoint despite the capability (HTTP"
+                                           << httpCode << "), disabling bundling for this sync run";
+                _endpointUnusable = true;
+            } else {
+                qCWarning(lcUploadBundler) << "Bundle request failed:" << job->reply()->errorString()
+                                           << "- falling back to individual uploads";
+            }
+            fallBackToIndividualUploads(bundled);
+            return;
+        }
+        dispatchResults(job->reply(), bundled);
+    });
+    job->start();
+}
+
+void UploadBundler::dispatchResults(QNetworkReply *reply, const QVector<QPointer<PropagateUploadCommon>> &jobs)
+{
+    const QVector<BundlePartResult> results = parseMultistatus(reply);
+    for (const auto &jobPointer : jobs) {
+        PropagateUploadCommon *job = jobPointer.data();
+        if (!job || job->state() == PropagatorJob::Finished) {
+            continue;
+        }
+        const QString target = _propagator->fullRemotePath(job->_item->_file);
+        auto it = std::find_if(results.cbegin(), results.cend(), [&target](const BundlePartResult &result) {
+            return result.href.endsWith(target);
+        });
+        if (it != results.cend() && it->httpCode >= 200 && it->httpCode < 300 && !it->etag.isEmpty()) {
+            job->bundledUploadDone(it->etag, it->fileId, it->permissions);
+        } else {
+            // Files the server could not place in the bundle (or did not
+            // mention at all) take the individual path; that surfaces a
+            // proper per-file error if the upload genuinely cannot work.
+            if (it != results.cend()) {
+                qCWarning(lcUploadBundler) << "Bundle rejected" << job->_item->_file << "with HTTP" << it->httpCode
+                                           << "- retrying individually";
+            } else {
+                qCWarning(lcUploadBundler) << "Bundle response did not mention" << job->_item->_file << "- retrying individually";
+            }
+            job->doStartUpload();
+        }
+    }
+}
+
+void UploadBundler::fallBackToIndividualUploads(const QVector<QPointer<PropagateUploadCommon>> &jobs)
+{
+    for (const auto &jobPointer : jobs) {
+        PropagateUploadCommon *job = jobPointer.data();
+        if (!job || job->state() == PropagatorJob::Finished) {
+            continue;
+        }
+        job->doStartUpload();
+    }
+}
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) by Klaas Freitag <freitag@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QLoggingCategory>
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+class QNetworkReply;
+
+namespace OCC {
+
+class OwncloudPropagator;
+class PropagateUploadCommon;
+
+Q_DECLARE_LOGGING_CATEGORY(lcUploadBundler)
+
+/**
+ * @brief Bundles many small uploads into one multipart request
+ * @ingroup libsync
+ *
+ * For tiny files the per-request overhead (TLS, headers, server-side
+ * journaling) dwarfs the payload, so syncing large trees of small files is
+ * bound by request count, not bandwidth. When the server advertises the
+ * bundling endpoint (capability dav/bundling), upload jobs below the
+ * small-file threshold register here instead of issuing their own request;
+ * everything that queues up within one event loop round trip leaves in a
+ * single multipart/related POST.
+ *
+ * The server answers with a multistatus naming each file's etag and file
+ * id; the per-item jobs then finalize exactly as if they had uploaded on
+ * their own. Any file the bundle could not place, and every file of a
+ * failed bundle request, transparently falls back to its individual upload
+ * path, so bundling can never make a sync fail that would otherwise work.
+ */
+class OWNCLOUDSYNC_EXPORT UploadBundler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UploadBundler(OwncloudPropagator *propagator);
+
+    /// Upper bound of files leaving in one bundle.
+    static constexpr int maxFilesPerBundle = 100;
+    /// Upper bound of payload leaving in one bundle.
+    static constexpr qint64 maxBundlePayload = 10 * 1024 * 1024;
+
+    /** Whether this job's item is small enough and the server side is
+     * usable. Re-checked per job: the endpoint is disabled for the rest of
+     * the sync when the server turns out not to provide it after all.
+     */
+    bool canBundle(const PropagateUploadCommon *job) const;
+
+    /** Queues the job for the next bundle.
+     *
+     * The bundle is flushed on the next event loop iteration, or right
+     * away once one of the bundle bounds is reached.
+     */
+    void enqueue(PropagateUploadCommon *job);
+
+private:
+    void scheduleFlush();
+    void flush();
+    void dispatchResults(QNetworkReply *reply, const QVector<QPointer<PropagateUploadCommon>> &jobs);
+
+    /// Sends every live job of a failed bundle down its individual path.
+    static void fallBackToIndividualUploads(const QVector<QPointer<PropagateUploadCommon>> &jobs);
+
+    OwncloudPropagator *_propagator;
+
+    QVector<QPointer<PropagateUploadCommon>> _pending;
+    qint64 _pendingPayload = 0;
+    bool _flushScheduled = false;
+
+    /// Set when the server rejects the endpoint despite the capability.
+    bool _endpointUnusable = false;
+};
+}
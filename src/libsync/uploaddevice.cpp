@@ -13,6 +13,7 @@
  */
 
 #include "account.h"
+#include "bandwidthlimiter.h"
 #include "filesystem.h"
 #include "propagateuploadfile.h"
 #include "syncengine.h"
@@ -26,11 +27,101 @@
 #include <QFileInfo>
 
 #include <cmath>
+#include <cstring>
+
+#if defined(Q_OS_MAC) || defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <winsock2.h>
+#include <windows.h>
+#include <winioctl.h>
+#endif
 
 using namespace std::chrono_literals;
 
+namespace {
+
+/** Enumerates the holes of an open file overlapping [start, start + size).
+ *
+ * Offsets in the result are relative to start. An empty list means the
+ * slice is dense or the platform or filesystem cannot tell holes apart
+ * from data - either way every byte is read from the file as before.
+ * The file position ends up at start.
+ */
+QVector<QPair<qint64, qint64>> enumerateHoles(QFile *file, qint64 start, qint64 size)
+{
+    QVector<QPair<qint64, qint64>> holes;
+#if defined(Q_OS_MAC) || defined(Q_OS_LINUX)
+    const int fd = file->handle();
+    if (fd < 0) {
+        return holes;
+    }
+    const qint64 end = start + size;
+    qint64 pos = start;
+    while (pos < end) {
+        const off_t hole = lseek(fd, pos, SEEK_HOLE);
+        if (hole < 0 || hole >= end) {
+            break;
+        }
+        off_t data = lseek(fd, hole, SEEK_DATA);
+        if (data < 0) {
+            // Trailing hole up to the end of the file.
+            data = end;
+        }
+        holes.append({ hole - start, qMin<qint64>(data, end) - hole });
+        pos = data;
+    }
+    lseek(fd, start, SEEK_SET);
+#elif defined(Q_OS_WIN)
+    const HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(file->handle()));
+    if (handle == INVALID_HANDLE_VALUE) {
+        return holes;
+    }
+    FILE_ALLOCATED_RANGE_BUFFER query;
+    query.FileOffset.QuadPart = start;
+    query.Length.QuadPart = size;
+    // The gaps between the allocated ranges are the holes. Files with more
+    // ranges than fit the buffer (ERROR_MORE_DATA) just go unoptimized.
+    FILE_ALLOCATED_RANGE_BUFFER ranges[128];
+    DWORD bytesReturned = 0;
+    if (!DeviceIoControl(handle, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(query),
+            ranges, sizeof(ranges), &bytesReturned, nullptr)) {
+        return holes;
+    }
+    qint64 pos = start;
+    const qint64 end = start + size;
+    const DWORD count = bytesReturned / sizeof(FILE_ALLOCATED_RANGE_BUFFER);
+    for (DWORD i = 0; i < count; ++i) {
+        const qint64 rangeStart = ranges[i].FileOffset.QuadPart;
+        if (rangeStart > pos) {
+            holes.append({ pos - start, rangeStart - pos });
+        }
+        pos = rangeStart + ranges[i].Length.QuadPart;
+    }
+    if (pos < end) {
+        holes.append({ pos - start, end - pos });
+    }
+#else
+    Q_UNUSED(file)
+    Q_UNUSED(start)
+    Q_UNUSED(size)
+#endif
+    return holes;
+}
+
+} // anonymous namespace
+
 namespace OCC {
 
+Metrics::PeakGauge &uploadBuffersMemoryGauge()
+{
+    static Metrics::PeakGauge gauge("memory.uploadBuffersBytes");
+    return gauge;
+}
+
 UploadDevice::UploadDevice(const QString &fileName, qint64 start, qint64 size)
     : _file(fileName)
     , _start(start)
@@ -39,6 +130,21 @@ UploadDevice::UploadDevice(const QString &fileName, qint64 start, qint64 size)
 {
 }
 
+UploadDevice::~UploadDevice()
+{
+    // A device destroyed while open must still release its accounting
+    UploadDevice::close();
+}
+
+void UploadDevice::setBandwidthLimiter(BandwidthLimiter *limiter)
+{
+    if (!limiter || !limiter->isActive()) {
+        return;
+    }
+    _limiter = limiter;
+    connect(limiter, &BandwidthLimiter::replenished, this, &UploadDevice::readyRead);
+}
+
 bool UploadDevice::open(QIODevice::OpenMode mode)
 {
     if (mode & QIODevice::WriteOnly)
@@ -57,11 +163,44 @@ bool UploadDevice::open(QIODevice::OpenMode mode)
     _size = qBound(0ll, _size, fileDiskSize - _start);
     _read = 0;
 
+    // Sparse files (HDF5, VM images) can be mostly holes. Knowing where
+    // they are lets readData() synthesize the zeros instead of asking the
+    // kernel for them one network buffer at a time.
+    _holes = enumerateHoles(&_file, _start, _size);
+    if (!_holes.isEmpty()) {
+        qCDebug(lcPropagateUpload) << _file.fileName() << "has" << _holes.size() << "holes in the uploaded range";
+    }
+
+    // Opt-in: serve reads straight from a file mapping, sparing the read()
+    // path for every network buffer. Off by default because a file the
+    // user truncates mid-upload turns into a crash (SIGBUS) through a
+    // mapping, but into a plain read error through QFile.
+    static const bool useMapping = qEnvironmentVariableIntValue("OWNCLOUD_UPLOAD_MMAP") > 0;
+    if (useMapping && _size > 0) {
+        _map = _file.map(_start, _size);
+        if (!_map) {
+            qCDebug(lcPropagateUpload) << "Could not map" << _file.fileName() << "falling back to buffered reads";
+        }
+    }
+
+    if (!_accounted) {
+        _accounted = true;
+        uploadBuffersMemoryGauge().add(_size);
+    }
+
     return QIODevice::open(mode);
 }
 
 void UploadDevice::close()
 {
+    if (_map) {
+        _file.unmap(_map);
+        _map = nullptr;
+    }
+    if (_accounted) {
+        _accounted = false;
+        uploadBuffersMemoryGauge().add(-_size);
+    }
     _file.close();
     QIODevice::close();
 }
@@ -81,6 +220,38 @@ qint64 UploadDevice::readData(char *data, qint64 maxLen)
     if (maxLen <= 0) {
         return 0;
     }
+    if (_limiter) {
+        // Returning 0 makes the network layer wait for readyRead(), which
+        // the limiter emits again once the bucket holds tokens.
+        maxLen = _limiter->acquire(maxLen);
+        if (maxLen == 0) {
+            return 0;
+        }
+    }
+
+    if (_map) {
+        memcpy(data, _map + _read, maxLen);
+        _read += maxLen;
+        return maxLen;
+    }
+
+    // The wire format has no way to skip holes, so their zeros still go
+    // out - but they don't have to come from the file.
+    for (const auto &hole : _holes) {
+        if (_read >= hole.first + hole.second) {
+            continue;
+        }
+        if (_read >= hole.first) {
+            maxLen = qMin(maxLen, hole.first + hole.second - _read);
+            memset(data, 0, maxLen);
+            _read += maxLen;
+            _file.seek(_start + _read);
+            return maxLen;
+        }
+        // In data ahead of a hole: don't read past its start.
+        maxLen = qMin(maxLen, hole.first - _read);
+        break;
+    }
 
     auto c = _file.read(data, maxLen);
     if (c < 0) {
@@ -106,10 +277,12 @@ qint64 UploadDevice::bytesAvailable() const
     return _size - _read + QIODevice::bytesAvailable();
 }
 
-// random access, we can seek
 bool UploadDevice::isSequential() const
 {
-    return false;
+    // Random access, we can seek - but when paced the network layer must
+    // treat us as a stream, so it reads progressively and honors
+    // readyRead() instead of slurping the whole device.
+    return _limiter != nullptr;
 }
 
 bool UploadDevice::seek(qint64 pos)
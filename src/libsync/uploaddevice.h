@@ -13,10 +13,24 @@
  */
 #pragma once
 
+#include "common/metrics.h"
+#include "owncloudlib.h"
+
 #include <QFile>
+#include <QVector>
 
 namespace OCC {
 
+class BandwidthLimiter;
+
+/** Bytes of local file data opened for upload, with high-water mark.
+ *
+ * Mapped or buffered upload slices are the network-side memory consumer
+ * during big syncs; the sync engine resets the peak per run and reports it
+ * in the performance report's memory accounting.
+ */
+OWNCLOUDSYNC_EXPORT Metrics::PeakGauge &uploadBuffersMemoryGauge();
+
 /**
  * @brief The UploadDevice class
  * @ingroup libsync
@@ -26,6 +40,15 @@ class UploadDevice : public QIODevice
     Q_OBJECT
 public:
     UploadDevice(const QString &fileName, qint64 start, qint64 size);
+    ~UploadDevice() override;
+
+    /** Pace reads through the account's shared upload token bucket.
+     *
+     * An inactive limiter is ignored. Pacing makes the device report
+     * itself as sequential, so the network layer reads progressively and
+     * waits for readyRead() between slices.
+     */
+    void setBandwidthLimiter(BandwidthLimiter *limiter);
 
     bool open(QIODevice::OpenMode mode) override;
     void close() override;
@@ -50,5 +73,19 @@ public:
     qint64 _size = 0;
     /// Position between _start and _start+_size
     qint64 _read = 0;
+
+    /// Mapping of the file slice, or nullptr when reads go through QFile
+    uchar *_map = nullptr;
+
+    /// Holes of the file slice as (offset, length) relative to _start,
+    /// sorted by offset. Empty when the file is dense or the filesystem
+    /// cannot enumerate extents.
+    QVector<QPair<qint64, qint64>> _holes;
+
+    /// Active upload pacer, or nullptr for unthrottled reads
+    BandwidthLimiter *_limiter = nullptr;
+
+    /// Whether _size is currently counted in uploadBuffersMemoryGauge()
+    bool _accounted = false;
 };
 }
\ No newline at end of file
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) by Hannah von Reth <hannah.vonreth@owncloud.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "common/binarylog.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+
+#include <iostream>
+
+#include <zlib.h>
+
+using namespace OCC;
+
+namespace {
+
+QByteArray readAllMaybeCompressed(const QString &fileName, bool *ok)
+{
+    *ok = false;
+    if (fileName.endsWith(QLatin1String(".gz"))) {
+        // Rotated logs are gzip compressed, see Logger::rotateLog()
+        auto compressed = gzopen(fileName.toUtf8().constData(), "rb");
+        if (!compressed) {
+            return {};
+        }
+        QByteArray data;
+        char buffer[1024 * 1024];
+        for (;;) {
+            const int read = gzread(compressed, buffer, sizeof(buffer));
+            if (read < 0) {
+                gzclose(compressed);
+                return {};
+            }
+            if (read == 0) {
+                break;
+            }
+            data.append(buffer, read);
+        }
+        gzclose(compressed);
+        *ok = true;
+        return data;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    *ok = true;
+    return file.readAll();
+}
+
+QLatin1String msgTypeName(quint8 type)
+{
+    switch (type) {
+    case QtDebugMsg:
+        return QLatin1String("debug");
+    case QtInfoMsg:
+        return QLatin1String("info");
+    case QtWarningMsg:
+        return QLatin1String("warning");
+    case QtCriticalMsg:
+        return QLatin1String("critical");
+    case QtFatalMsg:
+        return QLatin1String("fatal");
+    }
+    return QLatin1String("unknown");
+}
+
+int render(const QString &fileName, QTextStream &out)
+{
+    bool ok = false;
+    const QByteArray data = readAllMaybeCompressed(fileName, &ok);
+    if (!ok) {
+        std::cerr << "Failed to read " << qPrintable(fileName) << std::endl;
+        return 1;
+    }
+
+    QDataStream stream(data);
+    stream.setVersion(BinaryLog::dataStreamVersionC);
+    if (!BinaryLog::readFileHeader(stream)) {
+        std::cerr << qPrintable(fileName) << " is not a binary log file" << std::endl;
+        return 1;
+    }
+
+    QHash<quint32, QString> strings;
+    strings.insert(0, QString());
+
+    while (!stream.atEnd()) {
+        quint8 tag = 0;
+        stream >> tag;
+        switch (tag) {
+        case BinaryLog::StringTag: {
+            quint32 id = 0;
+            QByteArray utf8;
+            stream >> id >> utf8;
+            strings.insert(id, QString::fromUtf8(utf8));
+            break;
+        }
+        case BinaryLog::MessageTag: {
+            qint64 timestamp = 0;
+            quint8 type = 0;
+            quint32 categoryId = 0;
+            quint32 functionId = 0;
+            QByteArray utf8;
+            stream >> timestamp >> type >> categoryId >> functionId >> utf8;
+            // The line layout of Logger::loggerPattern()
+            out << QDateTime::fromMSecsSinceEpoch(timestamp).toString(QStringLiteral("yy-MM-dd hh:mm:ss:zzz"))
+                << QStringLiteral(" [ %1 %2 ]").arg(msgTypeName(type), strings.value(categoryId));
+            if (type == QtDebugMsg) {
+                out << QStringLiteral("\t[ %1 ]").arg(strings.value(functionId));
+            }
+            out << QStringLiteral(":\t") << QString::fromUtf8(utf8) << QLatin1Char('\n');
+            break;
+        }
+        default:
+            std::cerr << qPrintable(fileName) << ": unknown record, file truncated or corrupt" << std::endl;
+            return 1;
+        }
+        if (stream.status() != QDataStream::Ok) {
+            std::cerr << qPrintable(fileName) << ": file truncated or corrupt" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Renders binary log files written by the client back to text"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("files"), QStringLiteral("Binary log files (plain or .gz) to render, in order"), QStringLiteral("files..."));
+    parser.process(app);
+
+    const QStringList files = parser.positionalArguments();
+    if (files.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    QTextStream out(stdout);
+    out.setEncoding(QStringConverter::Utf8);
+    for (const auto &file : files) {
+        if (const int result = render(file, out)) {
+            return result;
+        }
+    }
+    return 0;
+}
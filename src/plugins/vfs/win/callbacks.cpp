@@ -10,6 +10,8 @@
 
 #include "vfs_win_p.h"
 
+#include <QFileInfo>
+
 #define ENUM_CASE_NAME(X)             \
     case X:                           \
         return QString::fromUtf8(#X); \
@@ -41,6 +43,11 @@ void CALLBACK callbackFetchData(const CF_CALLBACK_INFO *info, const CF_CALLBACK_
 
     // Note: Resuming works as expected: the file is already partially hydrated
     // we will see resumeStart > 0 here.
+    //
+    // With progressive hydration the required range is what the reader is
+    // blocked on right now; the optional range is the platform's readahead
+    // hint. startFetchData() extends the transfer to the end of the file
+    // anyway, so the distinction only matters for logging.
     auto resumeStart = params->FetchData.RequiredFileOffset.QuadPart;
     auto resumeEnd = resumeStart + params->FetchData.RequiredLength.QuadPart;
 
@@ -51,6 +58,9 @@ void CALLBACK callbackFetchData(const CF_CALLBACK_INFO *info, const CF_CALLBACK_
         // noop
     }
 
+    // The size Windows believes the placeholder has; used to detect stale metadata.
+    const auto placeholderSize = info->FileSize.QuadPart;
+
     const QString path = CfCallbackInfoHelper::getFullNormalizedPath(info);
     auto fileId = QByteArray(reinterpret_cast<const char *>(info->FileIdentity), info->FileIdentityLength);
     qCInfo(lcVfs) << "fetch data request" << callbackContext->q->params().filesystemPath << path << fileId
@@ -58,9 +68,37 @@ void CALLBACK callbackFetchData(const CF_CALLBACK_INFO *info, const CF_CALLBACK_
                   << params->FetchData.OptionalFileOffset.QuadPart << params->FetchData.OptionalLength.QuadPart
                   << "Resume:" << resumeStart << "to" << resumeEnd << "size:" << (resumeEnd - resumeStart);
 
+    // Deny hydration for denylisted processes: indexers and thumbnail
+    // extractors would otherwise mass-hydrate whole folders just by scanning
+    // them. The process info is available because the sync root is connected
+    // with CF_CONNECT_FLAG_REQUIRE_PROCESS_INFO.
+    if (!callbackContext->_hydrationDenylist.isEmpty() && info->ProcessInfo && info->ProcessInfo->ImagePath) {
+        const QString imageName = QFileInfo(QString::fromWCharArray(info->ProcessInfo->ImagePath)).fileName().toLower();
+        if (callbackContext->_hydrationDenylist.contains(imageName)) {
+            qCInfo(lcVfs) << "denying hydration of" << path << "requested by denylisted process" << imageName;
+
+            auto opInfo = opdata.toOpinfo();
+            opInfo.Type = CF_OPERATION_TYPE_TRANSFER_DATA;
+
+            CF_OPERATION_PARAMETERS opParams = {};
+            opParams.ParamSize = CF_SIZE_OF_OP_PARAM(TransferData);
+            opParams.TransferData.CompletionStatus = STATUS_CLOUD_FILE_ACCESS_DENIED;
+
+            // the denial covers the whole file, not a transfer chunk
+            opParams.TransferData.Offset.QuadPart = 0;
+            opParams.TransferData.Length.QuadPart = info->FileSize.QuadPart;
+
+            HRESULT ok = CfExecute(&opInfo, &opParams);
+            if (FAILED(ok)) {
+                qCWarning(lcVfs) << "CfExecute error on denying hydration" << Utility::formatWinError(ok);
+            }
+            return;
+        }
+    }
+
     // Jump to gui thread
-    QMetaObject::invokeMethod(callbackContext, [callbackContext, resumeStart, resumeEnd, path, fileId, opdata]() {
-        callbackContext->startFetchData(opdata, path, resumeStart, resumeEnd, fileId);
+    QMetaObject::invokeMethod(callbackContext, [callbackContext, resumeStart, resumeEnd, placeholderSize, path, fileId, opdata]() {
+        callbackContext->startFetchData(opdata, path, resumeStart, resumeEnd, placeholderSize, fileId);
     }, Qt::QueuedConnection);
 }
 
@@ -14,15 +14,21 @@
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QFileInfo>
 #include <QScopeGuard>
 #include <QThread>
+#include <QTimer>
 
+#include <algorithm>
 #include <filesystem>
+#include <utility>
+#include <vector>
 
 #include <SearchAPI.h>    // needed for AddFolderToSearchIndexer
 
 #include "account.h"
 #include "common/checksums.h"
+#include "configfile.h"
 #include "common/result.h"
 #include "common/utility.h"
 #include "libsync/filesystem.h"
@@ -46,9 +52,14 @@
 
 
 using namespace OCC::FileSystem::SizeLiterals;
+using namespace std::chrono_literals;
 
 namespace {
 const wchar_t* MSSearchIndex = L"SystemIndex";
+
+// window in which file status changes are coalesced before they are applied
+// to the placeholders
+constexpr auto statusChangeCoalesceIntervalC = 100ms;
 }
 
 Q_LOGGING_CATEGORY(lcVfs, "sync.vfs.win", QtDebugMsg)
@@ -212,8 +223,27 @@ void HydrationContext::transferDataError(NTSTATUS status)
     }
 }
 
-void VfsWinPrivate::startFetchData(CfOpdata opdata, const QString &targetPath, quint64 fetchStart, quint64 fetchEnd, const QByteArray &fileId)
+void VfsWinPrivate::startFetchData(CfOpdata opdata, const QString &targetPath, quint64 fetchStart, quint64 fetchEnd, quint64 placeholderSize, const QByteArray &fileId)
 {
+    // Explorer and the reading application often race and both trigger a
+    // fetch callback for the same placeholder. The transfer key identifies
+    // the placeholder's hydration, so a running context is the same file:
+    // merge the request instead of starting a second download.
+    if (auto *running = hydrationContext(opdata.transferKey.QuadPart)) {
+        if (fetchStart >= running->fetchStart) {
+            // the running download streams to the end of the file and covers
+            // the requested range
+            qCInfo(lcVfs) << "merging fetch data request for" << targetPath << "into the running hydration";
+            return;
+        }
+        // The reader needs data below the running download's start; supersede
+        // it with a stream from the lower offset. Ranges the old download
+        // already delivered are simply transferred again.
+        qCInfo(lcVfs) << "superseding running hydration of" << targetPath << "to start at" << fetchStart;
+        running->abort();
+        delete running;
+    }
+
     // Get account-relative path to file
     auto &params = q->params();
     auto journal = params.journal;
@@ -235,13 +265,27 @@ void VfsWinPrivate::startFetchData(CfOpdata opdata, const QString &targetPath, q
     // trouble if the remote and local file size don't match up: either Windows
     // will wait for more data that isn't coming, or Windows will reject us
     // feeding more data than it expects.
-    if (static_cast<quint64>(record._fileSize) != fetchEnd) {
+    if (static_cast<quint64>(record._fileSize) != placeholderSize) {
         qCInfo(lcVfs) << "DB size and placeholder size don't match up, restarting…"
-                      << accountRelativePath << record._fileSize << fetchEnd;
+                      << accountRelativePath << record._fileSize << placeholderSize;
         restartHydration(opdata, targetPath, record._fileSize);
         return;
     }
 
+    // Readahead: stream from the first requested offset through to the end of
+    // the file instead of fetching just the requested range. Windows caches
+    // every range we transfer in the placeholder, so a reader seeking back
+    // into already-streamed data is served locally without another callback.
+    if (fetchEnd < placeholderSize) {
+        qCInfo(lcVfs) << "Extending fetch range to end of file" << accountRelativePath << fetchEnd << "->" << placeholderSize;
+        fetchEnd = placeholderSize;
+    }
+
+    // Log the transition: if the process dies mid-hydration the placeholder
+    // holds ranges the journal knows nothing about. Replaying the entry on
+    // the next start re-inspects just this path.
+    journal->setVfsIntent(record._path, SyncJournalDb::VfsIntentOp::Hydrate);
+
     auto hydrationContext = new HydrationContext(q);
 
     auto hydrationDevice = new PlaceholderHydrationDevice(opdata, fetchStart, fetchEnd);
@@ -259,6 +303,7 @@ void VfsWinPrivate::startFetchData(CfOpdata opdata, const QString &targetPath, q
     hydrationContext->journal = journal;
     hydrationContext->opdata = opdata;
     hydrationContext->record = record;
+    hydrationContext->fetchStart = fetchStart;
     hydrationContext->filesystemPath = targetPath; // ignore the filename from the db record, it might have been renamed (and we fetched the record based on the fileId).
     hydrationContext->hydrationDevice = hydrationDevice;
     hydrationContext->downloadJob = getJob;
@@ -302,7 +347,7 @@ void HydrationContext::downloadJobDone()
             transferDataError(STATUS_CLOUD_FILE_NOT_IN_SYNC);
             // TODO: schedule a sync
         } else if (job->contentLength() != -1 && job->contentLength() != job->expectedContentLength()) {
-            Q_ASSERT(job->resumeStart() == 0);
+            // resumeStart > 0 is normal here: resumed and mid-file fetches are ranged requests
             const auto newFileSize = job->resumeStart() + job->contentLength();
             if (newFileSize == 0 && record._fileSize != 0) {
                 // the file might now be a folder
@@ -343,11 +388,28 @@ void HydrationContext::downloadJobDone()
         transmissionChecksumHeader = "MD5:" + contentMd5Header;
     }
 
-    // signal that validation may start now
+    // The job hashed the body while it streamed into the placeholder, so the
+    // content check can run without reading the hydrated file back through
+    // CfAPI. Only usable if the whole body streamed; a mid-file fetch after a
+    // seek only covers the tail of the file.
+    if (job->resumeStart() == 0) {
+        if (const auto *streamed = job->streamedChecksum()) {
+            streamedChecksumType = streamed->checksumType();
+            streamedChecksum = streamed->result();
+        }
+    }
+
     isDownloadDone = true;
-    Q_EMIT downloadDone();
-    // TODO: maybe also start a timer, so we can release the hydration in case the
-    // windows validation callback never fires?
+    if (isAckRequired) {
+        // A validate-data callback arrived first (sync root still registered
+        // with the old full hydration policy), continue it. May delete this.
+        Q_EMIT downloadDone();
+    } else {
+        // With progressive hydration Windows releases the data to the reader
+        // as it streams in and never fires the validate-data callback, so the
+        // content check and the journal bookkeeping start right here.
+        ensureContentChecksum(hydrationDevice->fileSize());
+    }
 }
 
 void VfsWinPrivate::cancelFetchData(TransferKey transferKey, const QString &path)
@@ -377,6 +439,7 @@ void VfsWinPrivate::startValidateData(CfOpdata opdata, const QString &path, quin
         return;
     }
     context->opdata = opdata;
+    context->isAckRequired = true;
 
     if (offset != 0 || length != fileSize) {
         qCWarning(lcVfs) << "we don't support partial validation, validate the whole file";
@@ -415,6 +478,13 @@ void HydrationContext::ensureContentChecksum(quint64 fileSize)
         return;
     }
 
+    // Or the wire checksum of the whole body came in the right algorithm
+    if (streamedChecksumType == checksumType && !streamedChecksum.isEmpty()) {
+        record._checksumHeader = ChecksumHeader(checksumType, streamedChecksum).makeChecksumHeader();
+        validateTransmissionChecksum(fileSize);
+        return;
+    }
+
     // Otherwise, compute the content checksum, then proceed
 
     auto device = std::make_unique<PlaceholderValidationDevice>(opdata, 0, fileSize);
@@ -445,20 +515,19 @@ void HydrationContext::validateTransmissionChecksum(quint64 fileSize)
     opParams.AckData.Length.QuadPart = fileSize;
     assert_4_KiB_chunk(fileSize, opParams.AckData.Offset.QuadPart, opParams.AckData.Length.QuadPart);
 
-    auto device = std::make_unique<PlaceholderValidationDevice>(opdata, 0, fileSize);
-    device->open(QIODevice::ReadOnly);
-
     auto validator = new ValidateChecksumHeader(this);
     QObject::connect(validator, &ValidateChecksumHeader::validated, this, [this, opInfo, opParams](CheckSums::Algorithm checksumType, const QByteArray &checksum) mutable {
         Q_UNUSED(checksumType);
         Q_UNUSED(checksum);
         qCInfo(lcVfs) << "validation success:" << record._path;
 
-        HRESULT ok = CfExecute(&opInfo, &opParams);
-        if (FAILED(ok)) {
-            qCWarning(lcVfs) << "CfExecute error" << Utility::formatWinError(ok);
-            delete this;
-            return;
+        if (isAckRequired) {
+            HRESULT ok = CfExecute(&opInfo, &opParams);
+            if (FAILED(ok)) {
+                qCWarning(lcVfs) << "CfExecute error" << Utility::formatWinError(ok);
+                delete this;
+                return;
+            }
         }
 
         // Set placeholder file mtime to db mtime
@@ -470,9 +539,11 @@ void HydrationContext::validateTransmissionChecksum(quint64 fileSize)
         // The file is no longer virtual
         record._type = ItemTypeFile;
 
-        // Update db entry
-        if (journal)
+        // Update db entry, the placeholder and the journal agree again
+        if (journal) {
             journal->setFileRecord(record);
+            journal->removeVfsIntent(record._path);
+        }
 
         pluginInstance()->onFileStatusChanged(filesystemPath, SyncFileStatus::StatusUpToDate);
         delete this;
@@ -480,16 +551,33 @@ void HydrationContext::validateTransmissionChecksum(quint64 fileSize)
     QObject::connect(validator, &ValidateChecksumHeader::validationFailed, this, [this, opInfo, opParams](const QString &msg) mutable {
         qCInfo(lcVfs) << "validation failed:" << record._path << msg;
 
-        opParams.AckData.CompletionStatus = STATUS_CLOUD_FILE_VALIDATION_FAILED;
-        HRESULT ok = CfExecute(&opInfo, &opParams);
-        if (FAILED(ok)) {
-            qCWarning(lcVfs) << "CfExecute error" << Utility::formatWinError(ok);
-            delete this;
-            return;
+        if (isAckRequired) {
+            opParams.AckData.CompletionStatus = STATUS_CLOUD_FILE_VALIDATION_FAILED;
+            HRESULT ok = CfExecute(&opInfo, &opParams);
+            if (FAILED(ok)) {
+                qCWarning(lcVfs) << "CfExecute error" << Utility::formatWinError(ok);
+                delete this;
+                return;
+            }
+        } else {
+            // The reader already got the streamed data, Windows won't discard
+            // it for us. Leave the journal record virtual and schedule a sync
+            // so the corrupt content gets replaced.
+            Q_EMIT pluginInstance()->needSync();
         }
 
         delete this;
     });
+
+    // A checksum hashed while the body streamed in spares the validator
+    // from reading the whole hydrated file back through CfAPI; a corrupt
+    // transfer then fails right when the validation callback fires.
+    if (validator->validatePrecomputed(streamedChecksumType, streamedChecksum, transmissionChecksumHeader)) {
+        return;
+    }
+
+    auto device = std::make_unique<PlaceholderValidationDevice>(opdata, 0, fileSize);
+    device->open(QIODevice::ReadOnly);
     validator->start(std::move(device), transmissionChecksumHeader);
 }
 
@@ -522,6 +610,15 @@ QMutex VfsWinPrivate::registrationMutex;
 // Register as a sync provider with cfapi as well as with the explorer integration
 void VfsWinPrivate::registerFolder(const VfsSetupParams &params)
 {
+    // Cache the hydration denylist now: the fetch callbacks run on threadpool
+    // threads and must not touch the config file themselves.
+    _hydrationDenylist.clear();
+    const auto denylist = ConfigFile().vfsHydrationDenylist();
+    _hydrationDenylist.reserve(denylist.size());
+    for (const auto &entry : denylist) {
+        _hydrationDenylist.append(QFileInfo(entry).fileName().toLower());
+    }
+
     const QString syncRoot = syncRootPath();
     const auto syncRootW = syncRoot.toStdWString();
     _registrationId = [&params, &syncRoot] {
@@ -554,11 +651,17 @@ void VfsWinPrivate::registerFolder(const VfsSetupParams &params)
     // The calls below are "putters". They set the values on the `providerInfo`, but they do no
     // additional processing. The "getters" have the same method name, but take no parameters.
 
-    // hydrate fully when hydration is requested, before handing data to the user - also means validation will always see the whole file
-    providerInfo.HydrationPolicy(StorageProviderHydrationPolicy::Full);
-    providerInfo.HydrationPolicyModifier(
-        StorageProviderHydrationPolicyModifier::ValidationRequired
-        | StorageProviderHydrationPolicyModifier::AutoDehydrationAllowed);
+    // Progressive hydration: each transferred chunk is released to the reading
+    // application as soon as it arrives, with platform readahead beyond the
+    // reader's position, instead of blocking the reader until the whole file
+    // is hydrated. Sequential readers and media players seeking in dehydrated
+    // files get data without waiting for the full download.
+    providerInfo.HydrationPolicy(StorageProviderHydrationPolicy::Progressive);
+    // No ValidationRequired modifier: it would withhold the streamed data from
+    // the reader until the whole-file checksum passes, which defeats the
+    // streaming. The content checksum is verified when the download finishes
+    // instead, see HydrationContext::downloadJobDone().
+    providerInfo.HydrationPolicyModifier(StorageProviderHydrationPolicyModifier::AutoDehydrationAllowed);
     // the whole tree is always available, no dynamic ls queries
     providerInfo.PopulationPolicy(StorageProviderPopulationPolicy::AlwaysFull);
 
@@ -728,7 +831,8 @@ void VfsWinPrivate::registerFolder(const VfsSetupParams &params)
             ok = CfConnectSyncRoot(syncRootW.c_str(), callbacks,
                 this, // use VfsWinPrivate as callback context
                 CF_CONNECT_FLAG_BLOCK_SELF_IMPLICIT_HYDRATION // don't let antivirus implicitly hydrate (or something, a bit unclear)
-                    | CF_CONNECT_FLAG_REQUIRE_FULL_FILE_PATH, // request that callbacks get the full path
+                    | CF_CONNECT_FLAG_REQUIRE_FULL_FILE_PATH // request that callbacks get the full path
+                    | CF_CONNECT_FLAG_REQUIRE_PROCESS_INFO, // identify the process behind fetch requests, for the hydration denylist
                 &_connectionKey);
         }
         if (FAILED(ok)) {
@@ -896,6 +1000,19 @@ OCC::Result<OCC::Vfs::ConvertToPlaceholderResult, QString> VfsWin::updateMetadat
     return ConvertToPlaceholderResult::Ok;
 }
 
+namespace {
+FILE_BASIC_INFO placeholderBasicInfo(const SyncFileItem &item)
+{
+    auto basicInfo = FILE_BASIC_INFO();
+    basicInfo.FileAttributes = FILE_ATTRIBUTE_NORMAL;
+    Utility::UnixTimeToLargeIntegerFiletime(item._modtime, &basicInfo.ChangeTime);
+    basicInfo.LastAccessTime = basicInfo.ChangeTime;
+    basicInfo.LastWriteTime = basicInfo.ChangeTime;
+    basicInfo.CreationTime = basicInfo.ChangeTime;
+    return basicInfo;
+}
+}
+
 Result<void, QString> VfsWinPrivate::createPlaceholderInternal(const SyncFileItem &item, const FILE_BASIC_INFO &basicInfo)
 {
     const auto path = std::filesystem::path(syncRootPath().toStdWString()) / item._file.toStdWString();
@@ -944,15 +1061,91 @@ Result<void, QString> VfsWinPrivate::createPlaceholderInternal(const SyncFileIte
 Result<void, QString> VfsWin::createPlaceholder(const SyncFileItem &item)
 {
     Q_D(VfsWin);
+    return d->createPlaceholderInternal(item, placeholderBasicInfo(item));
+}
 
-    auto basicInfo = FILE_BASIC_INFO();
-    basicInfo.FileAttributes = FILE_ATTRIBUTE_NORMAL;
-    Utility::UnixTimeToLargeIntegerFiletime(item._modtime, &basicInfo.ChangeTime);
-    basicInfo.LastAccessTime = basicInfo.ChangeTime;
-    basicInfo.LastWriteTime = basicInfo.ChangeTime;
-    basicInfo.CreationTime = basicInfo.ChangeTime;
+QVector<Result<void, QString>> VfsWin::createPlaceholders(const QVector<const SyncFileItem *> &items)
+{
+    Q_D(VfsWin);
+
+    QVector<Result<void, QString>> results(items.size());
+
+    // Group the items by parent directory while keeping their order. During
+    // the initial sync of a big tree the propagator hands us long runs of
+    // siblings, so each group becomes one CfCreatePlaceholders invocation
+    // instead of one call per file.
+    struct BatchEntry
+    {
+        int index;
+        std::wstring name;
+    };
+    const auto rootPath = std::filesystem::path(d->syncRootPath().toStdWString());
+    std::vector<std::pair<std::wstring, std::vector<BatchEntry>>> groups;
+    for (int i = 0; i < items.size(); ++i) {
+        auto path = rootPath / items.at(i)->_file.toStdWString();
+        auto dir = path.parent_path().wstring();
+        auto it = std::find_if(groups.begin(), groups.end(), [&dir](const auto &group) { return group.first == dir; });
+        if (it == groups.end()) {
+            groups.push_back({ std::move(dir), {} });
+            it = std::prev(groups.end());
+        }
+        it->second.push_back({ i, path.filename().wstring() });
+    }
 
-    return d->createPlaceholderInternal(item, basicInfo);
+    for (const auto &group : groups) {
+        std::vector<CF_PLACEHOLDER_CREATE_INFO> placeholders;
+        placeholders.reserve(group.second.size());
+        for (const auto &entry : group.second) {
+            const SyncFileItem &item = *items.at(entry.index);
+            CF_PLACEHOLDER_CREATE_INFO placeholder = {};
+            placeholder.RelativeFileName = entry.name.data();
+            placeholder.FsMetadata.FileSize.QuadPart = static_cast<LONGLONG>(item._size);
+            placeholder.FsMetadata.BasicInfo = placeholderBasicInfo(item);
+            placeholder.FileIdentity = item._fileId.constData();
+            placeholder.FileIdentityLength = static_cast<DWORD>(item._fileId.size());
+            placeholder.Flags = CF_PLACEHOLDER_CREATE_FLAG_MARK_IN_SYNC;
+            // Result and CreateUsn are filled by the call
+            placeholders.push_back(placeholder);
+        }
+
+        DWORD nProcessed = 0;
+        const HRESULT ok = CfCreatePlaceholders(
+            group.first.data(),
+            placeholders.data(),
+            static_cast<DWORD>(placeholders.size()),
+            CF_CREATE_FLAG_NONE,
+            &nProcessed);
+        if (FAILED(ok)) {
+            qCWarning(lcVfs) << "CfCreatePlaceholders failed after" << nProcessed << "of" << placeholders.size() << "entries:" << Utility::formatWinError(ok);
+        }
+
+        for (size_t j = 0; j < placeholders.size(); ++j) {
+            const int index = group.second.at(j).index;
+            const SyncFileItem &item = *items.at(index);
+            // Entries past nProcessed were never looked at by a failed call,
+            // their Result field is not meaningful.
+            const bool created = SUCCEEDED(placeholders.at(j).Result) && (SUCCEEDED(ok) || j < nProcessed);
+            if (!created) {
+                const auto error = QStringLiteral("CfCreatePlaceholders error %1 : %2 for %3")
+                                       .arg(Utility::formatWinError(ok), Utility::formatWinError(placeholders.at(j).Result), item._file);
+                qCWarning(lcVfs) << error;
+                results[index] = error;
+                continue;
+            }
+            // Same PINNED-attribute fixup as createPlaceholderInternal().
+            FILE_BASIC_INFO fileInfo;
+            if (getFileMetadata(params().filesystemPath + item._file, &fileInfo)) {
+                if (fileInfo.FileAttributes & FILE_ATTRIBUTE_PINNED) {
+                    if (!setPinState(item._file, PinState::Unspecified)) {
+                        results[index] = QStringLiteral("Failed to set pin state");
+                        continue;
+                    }
+                }
+            }
+            results[index] = Result<void, QString> {};
+        }
+    }
+    return results;
 }
 
 bool VfsWin::needsMetadataUpdate(const SyncFileItem &item)
@@ -1151,6 +1344,29 @@ static Result<CF_PLACEHOLDER_BASIC_INFO, HRESULT> getBasicPlaceholderInfo(const
 }
 
 void VfsWin::onFileStatusChanged(const QString &systemFileName, SyncFileStatus status)
+{
+    Q_D(VfsWin);
+
+    // The status tracker re-emits every parent directory for each completed
+    // child, so a big sync produces far more status changes than there are
+    // distinct paths. Coalesce them: only the latest status per path is
+    // applied, once the window has passed.
+    d->_pendingStatusChanges.insert(systemFileName, status);
+    if (d->_statusFlushScheduled) {
+        return;
+    }
+    d->_statusFlushScheduled = true;
+    QTimer::singleShot(statusChangeCoalesceIntervalC, this, [this] {
+        Q_D(VfsWin);
+        d->_statusFlushScheduled = false;
+        const auto pending = std::exchange(d->_pendingStatusChanges, {});
+        for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+            applyFileStatusChange(it.key(), it.value());
+        }
+    });
+}
+
+void VfsWin::applyFileStatusChange(const QString &systemFileName, SyncFileStatus status)
 {
     auto placeholderInfo = getBasicPlaceholderInfo(systemFileName);
     if (!placeholderInfo) {
@@ -36,6 +36,9 @@ public:
 
     [[nodiscard]] Result<void, QString> createPlaceholder(const SyncFileItem &item) override;
 
+    /// Groups the items per parent directory into single CfCreatePlaceholders calls
+    [[nodiscard]] QVector<Result<void, QString>> createPlaceholders(const QVector<const SyncFileItem *> &items) override;
+
     /// Returns true for files that aren't placeholders yet
     [[nodiscard]] bool needsMetadataUpdate(const SyncFileItem &item) override;
 
@@ -54,6 +57,10 @@ public Q_SLOTS:
 protected:
     [[nodiscard]] Result<ConvertToPlaceholderResult, QString> updateMetadata(const SyncFileItem &item, const QString &filePath, const QString &replacesFile = {}) override;
     void startImpl(const VfsSetupParams &params) override;
+
+private:
+    /// Applies one coalesced status change, see onFileStatusChanged()
+    void applyFileStatusChange(const QString &systemFileName, SyncFileStatus status);
 };
 
 
@@ -35,11 +35,22 @@ public:
     QPointer<SyncJournalDb> journal;
     SyncJournalFileRecord record;
     QString filesystemPath;
+    /// First byte the download streams; everything from here to the end of
+    /// the file will be delivered. Used to merge duplicate fetch callbacks.
+    quint64 fetchStart = 0;
     QByteArray transmissionChecksumHeader;
+    /// Checksum hashed while the body streamed into the placeholder, if any.
+    /// Lets the validation callback skip reading the file back through CfAPI.
+    CheckSums::Algorithm streamedChecksumType = CheckSums::Algorithm::NONE;
+    QByteArray streamedChecksum;
     PlaceholderHydrationDevice *hydrationDevice = nullptr;
     QPointer<GETFileJob> downloadJob;
     bool isDownloadDone = false;
     bool isAborted = false;
+    /// True while Windows waits for an ACK_DATA answer to a validate-data
+    /// callback. With progressive hydration no such callback fires and the
+    /// content check runs straight from downloadJobDone().
+    bool isAckRequired = false;
 
     void abort() {
         isAborted = true;
@@ -122,11 +133,21 @@ public:
 
     // The following are triggered from callbacks
     void startFetchData(CfAPIUtil::CfOpdata opdata, const QString &targetPath, quint64 fetchStart, quint64 fetchEnd,
-        const QByteArray &fileId);
+        quint64 placeholderSize, const QByteArray &fileId);
     void cancelFetchData(TransferKey transferKey, const QString &path);
     void startValidateData(CfAPIUtil::CfOpdata opdata, const QString &path, quint64 offset, quint64 length,
         quint64 fileSize);
 
+    // File status changes waiting to be applied to their placeholders,
+    // latest status per path wins. See VfsWin::onFileStatusChanged().
+    QHash<QString, SyncFileStatus> _pendingStatusChanges;
+    bool _statusFlushScheduled = false;
+
+    // Lowercased executable base names whose reads must not hydrate
+    // placeholders, from ConfigFile::vfsHydrationDenylist(). Filled before
+    // the sync root connects, read from the callback threads.
+    QStringList _hydrationDenylist;
+
 private:
     // Multiple hydrations can run at the same time and need to exchange data
     // between the fetch-data phase and the validate-data phase. They store their
@@ -19,12 +19,16 @@
 
 #include "common/asserts.h"
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QDir>
 #include <QFileInfo>
 #include <QImageReader>
 #include <QJsonDocument>
 #include <QLoggingCategory>
 #include <QPalette>
+#include <QStandardPaths>
 
 using namespace OCC;
 using namespace Resources;
@@ -37,9 +41,14 @@ struct IconCache
     IconCache()
     {
         auto *watcher = new ThemeWatcher(qApp);
-        QObject::connect(watcher, &ThemeWatcher::themeChanged, [this]() { _cache.clear(); });
+        QObject::connect(watcher, &ThemeWatcher::themeChanged, [this]() {
+            _cache.clear();
+            _pixmaps.clear();
+        });
     }
     QMap<QString, QIcon> _cache;
+    // rasterizations by cache key, see pixmapCacheKey()
+    QMap<QString, QPixmap> _pixmaps;
 };
 Q_GLOBAL_STATIC(IconCache, iconCache)
 
@@ -68,6 +77,57 @@ QString whiteTheme()
     return QStringLiteral("white");
 }
 
+/* Rasterizations are also cached on disk, so icons rendered from SVG in a
+ * previous run - every size/state combination the UI actually uses - load
+ * as plain PNGs at the next start instead of going through the SVG
+ * renderer again. Branded builds with large asset sets profit most. The
+ * key includes the client version (assets change with updates) and the
+ * dark-theme flag, so stale entries are simply never hit again and the
+ * cache needs no explicit invalidation.
+ */
+QString pixmapCacheDir()
+{
+    static const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/icons");
+    return dir;
+}
+
+QString pixmapCacheFile(const QString &key)
+{
+    const QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return pixmapCacheDir() + QLatin1Char('/') + QString::fromUtf8(hash) + QStringLiteral(".png");
+}
+
+QString pixmapCacheKey(const QString &theme, const QString &name, const QSize &size, QIcon::Mode mode)
+{
+    return QStringLiteral("%1/%2/%3/%4x%5/%6/%7")
+        .arg(QCoreApplication::applicationVersion(), theme, name)
+        .arg(size.width())
+        .arg(size.height())
+        .arg(int(mode))
+        .arg(Resources::isUsingDarkTheme());
+}
+
+QPixmap loadCachedPixmap(const QString &key)
+{
+    const auto it = iconCache->_pixmaps.constFind(key);
+    if (it != iconCache->_pixmaps.cend()) {
+        return *it;
+    }
+    QPixmap out;
+    if (out.load(pixmapCacheFile(key), "png")) {
+        iconCache->_pixmaps.insert(key, out);
+    }
+    return out;
+}
+
+void storeCachedPixmap(const QString &key, const QPixmap &pixmap)
+{
+    iconCache->_pixmaps.insert(key, pixmap);
+    if (QDir().mkpath(pixmapCacheDir())) {
+        pixmap.save(pixmapCacheFile(key), "png");
+    }
+}
+
 bool hasTheme(IconType type, const QString &theme)
 {
     // <<is vanilla, theme name>, bool
@@ -116,13 +176,20 @@ QIcon OCC::Resources::getCoreIcon(const QString &iconName)
     }
     QIcon &cached = iconCache->_cache[iconName]; // Take reference, this will also "set" the cache entry
     if (cached.isNull()) {
-        const QString iconPath = QStringLiteral(":/client/resources/core/%1.svg").arg(iconName);
-        Q_ASSERT(QFileInfo::exists(iconPath));
-        const QString color = isUsingDarkTheme() ? QStringLiteral("#ADACAB") : QStringLiteral("#435671");
-        QByteArray data = Template::renderTemplateFromFile(iconPath, {{QStringLiteral("color"), color}}).toUtf8();
-        QBuffer buffer(&data);
-        QImageReader iconReader(&buffer, "svg");
-        return cached = QPixmap::fromImageReader(&iconReader);
+        // the dark-theme flag in the key covers the color choice below
+        const QString key = pixmapCacheKey(QStringLiteral("core"), iconName, QSize(), QIcon::Normal);
+        QPixmap pixmap = loadCachedPixmap(key);
+        if (pixmap.isNull()) {
+            const QString iconPath = QStringLiteral(":/client/resources/core/%1.svg").arg(iconName);
+            Q_ASSERT(QFileInfo::exists(iconPath));
+            const QString color = isUsingDarkTheme() ? QStringLiteral("#ADACAB") : QStringLiteral("#435671");
+            QByteArray data = Template::renderTemplateFromFile(iconPath, {{QStringLiteral("color"), color}}).toUtf8();
+            QBuffer buffer(&data);
+            QImageReader iconReader(&buffer, "svg");
+            pixmap = QPixmap::fromImageReader(&iconReader);
+            storeCachedPixmap(key, pixmap);
+        }
+        return cached = pixmap;
     }
     return cached;
     // "<svg width="60" height="60" viewBox="0 0 60 60" fill="#ADACAB" xmlns="http://www.w3.org/2000/svg">
@@ -197,6 +264,20 @@ CoreImageProvider::CoreImageProvider()
 QPixmap CoreImageProvider::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
 {
     const auto qmlIcon = QMLResources::parseIcon(id);
+    const QIcon::Mode mode = qmlIcon.enabled ? QIcon::Normal : QIcon::Disabled;
+
+    // Serve repeated size/state combinations from the rasterization cache
+    // without touching the icon engines at all
+    const QString key = requestedSize.isValid() ? pixmapCacheKey(qmlIcon.theme, qmlIcon.iconName, requestedSize, mode) : QString();
+    if (!key.isEmpty()) {
+        const QPixmap cached = loadCachedPixmap(key);
+        if (!cached.isNull()) {
+            if (size) {
+                *size = requestedSize;
+            }
+            return cached;
+        }
+    }
 
     QIcon icon;
     if (qmlIcon.theme == QLatin1String("core")) {
@@ -206,5 +287,9 @@ QPixmap CoreImageProvider::requestPixmap(const QString &id, QSize *size, const Q
     } else {
         icon = themeIcon(qmlIcon.iconName);
     }
-    return Resources::pixmap(requestedSize, icon, qmlIcon.enabled ? QIcon::Normal : QIcon::Disabled, size);
+    QPixmap out = Resources::pixmap(requestedSize, icon, mode, size);
+    if (!key.isEmpty() && !out.isNull()) {
+        storeCachedPixmap(key, out);
+    }
+    return out;
 }
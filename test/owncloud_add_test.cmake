@@ -3,7 +3,16 @@ find_package(Qt6 COMPONENTS Test REQUIRED)
 
 include(ECMAddTests)
 
+# owncloud_add_test(<TestClass> [RUN_SERIAL] [LABELS <label>...] [<extra sources>...])
+#
+# Every test runs against its own temporary config/cache/journal directories
+# (see testutils/testutilsloader.cpp), so the suite is safe for `ctest -j`.
+# RUN_SERIAL is meant for the benchmarks, whose timings would be distorted by
+# concurrent tests. Labels select subsets, e.g. `ctest -L quick` for the
+# engine hot-path tests.
 function(owncloud_add_test test_class)
+    cmake_parse_arguments(PARSE_ARGV 1 OC_TEST "RUN_SERIAL" "" "LABELS")
+
     set(OWNCLOUD_TEST_CLASS ${test_class})
     string(TOLOWER "${OWNCLOUD_TEST_CLASS}" OWNCLOUD_TEST_CLASS_LOWERCASE)
     set(SRC_PATH test${OWNCLOUD_TEST_CLASS_LOWERCASE}.cpp)
@@ -12,7 +21,7 @@ function(owncloud_add_test test_class)
     endif()
 
     ecm_add_test(${SRC_PATH}
-        ${ARGN}
+        ${OC_TEST_UNPARSED_ARGUMENTS}
         TEST_NAME "${OWNCLOUD_TEST_CLASS}Test"
         LINK_LIBRARIES
         owncloudGui syncenginetestutils testutilsloader Qt::Test
@@ -25,7 +34,14 @@ function(owncloud_add_test test_class)
         set_property(TEST ${OWNCLOUD_TEST_CLASS}Test PROPERTY ENVIRONMENT "QT_QPA_PLATFORM=offscreen")
     endif()
 
-    foreach(arg IN LISTS ARGN)
+    if (OC_TEST_LABELS)
+        set_property(TEST ${OWNCLOUD_TEST_CLASS}Test PROPERTY LABELS ${OC_TEST_LABELS})
+    endif()
+    if (OC_TEST_RUN_SERIAL)
+        set_property(TEST ${OWNCLOUD_TEST_CLASS}Test PROPERTY RUN_SERIAL TRUE)
+    endif()
+
+    foreach(arg IN LISTS OC_TEST_UNPARSED_ARGUMENTS)
         target_sources(${OWNCLOUD_TEST_CLASS}Test PRIVATE ${arg})
     endforeach()
 endfunction()
@@ -0,0 +1,64 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "bandwidthlimiter.h"
+
+using namespace OCC;
+
+class TestBandwidthLimiter : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testInactiveGrantsEverything()
+    {
+        BandwidthLimiter limiter(0);
+        QVERIFY(!limiter.isActive());
+        QCOMPARE(limiter.acquire(1000 * 1000), 1000 * 1000);
+        QCOMPARE(limiter.acquire(1000 * 1000), 1000 * 1000);
+    }
+
+    void testBucketDrains()
+    {
+        // The bucket starts full with half a second worth of tokens.
+        BandwidthLimiter limiter(100 * 1000);
+        QVERIFY(limiter.isActive());
+        qint64 granted = 0;
+        // Drain the initial burst; a request never gets more than available.
+        for (int i = 0; i < 100 && granted < 50 * 1000; ++i) {
+            granted += limiter.acquire(10 * 1000);
+        }
+        QVERIFY(granted >= 50 * 1000);
+        // Bar the trickle earned while draining, the bucket is now empty.
+        QVERIFY(limiter.acquire(50 * 1000) < 50 * 1000);
+    }
+
+    void testReplenishedAfterStarvation()
+    {
+        BandwidthLimiter limiter(100 * 1000);
+        QSignalSpy replenished(&limiter, &BandwidthLimiter::replenished);
+        // Starve the bucket completely.
+        for (int i = 0; i < 1000 && limiter.acquire(100 * 1000) > 0; ++i) { }
+        // The refill timer earns tokens back and signals the consumers.
+        QVERIFY(replenished.wait(1000));
+        QVERIFY(limiter.acquire(1) > 0);
+    }
+
+    void testDisablingWakesConsumers()
+    {
+        BandwidthLimiter limiter(100 * 1000);
+        QSignalSpy replenished(&limiter, &BandwidthLimiter::replenished);
+        for (int i = 0; i < 1000 && limiter.acquire(100 * 1000) > 0; ++i) { }
+        limiter.setRate(0);
+        QCOMPARE(replenished.count(), 1);
+        QCOMPARE(limiter.acquire(1000 * 1000), 1000 * 1000);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestBandwidthLimiter)
+#include "testbandwidthlimiter.moc"
@@ -0,0 +1,133 @@
+/*
+ * This software is in the public domain, furnished "as is", without technical
+ * support, and with no warranty, express or implied, as to its usefulness for
+ * any purpose.
+ *
+ */
+
+#include <QtTest>
+#include <QBuffer>
+#include <QString>
+
+#include "common/checksums.h"
+#include "testutils/testutils.h"
+
+using namespace OCC;
+
+/**
+ * Benchmarks for the checksum hot path.
+ *
+ * These are QBENCHMARK-based, so they run as part of the regular test suite
+ * and a regression shows up as a walltime jump in CI logs. Run a single
+ * benchmark with more accumulation for stable local numbers, e.g.
+ *   ./ChecksumBenchmarkTest benchmarkFile:"SHA1 8MiB" -iterations 20
+ */
+class ChecksumBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    const QTemporaryDir _root = TestUtils::createTempDir();
+
+    static void addAlgorithmRows(qint64 size, const char *sizeTag)
+    {
+        const QVector<CheckSums::Algorithm> algorithms {
+            CheckSums::Algorithm::SHA3_256,
+            CheckSums::Algorithm::SHA256,
+            CheckSums::Algorithm::SHA1,
+            CheckSums::Algorithm::MD5,
+            CheckSums::Algorithm::ADLER32,
+        };
+        for (auto algorithm : algorithms) {
+            const QByteArray tag = QByteArray(CheckSums::toString(algorithm).data()) + ' ' + sizeTag;
+            QTest::newRow(tag.constData()) << algorithm << size;
+        }
+    }
+
+private Q_SLOTS:
+
+    void benchmarkFile_data()
+    {
+        QTest::addColumn<CheckSums::Algorithm>("algorithm");
+        QTest::addColumn<qint64>("size");
+
+        // Small files dominate typical sync folders, large ones the runtime.
+        addAlgorithmRows(64 * 1024, "64KiB");
+        addAlgorithmRows(1024 * 1024, "1MiB");
+        addAlgorithmRows(8 * 1024 * 1024, "8MiB");
+    }
+
+    void benchmarkFile()
+    {
+        QFETCH(CheckSums::Algorithm, algorithm);
+        QFETCH(qint64, size);
+
+        const QString file = _root.path() + QStringLiteral("/bench_%1.bin").arg(size);
+        if (!QFileInfo::exists(file)) {
+            QVERIFY(TestUtils::writeRandomFile(file, static_cast<int>(size)));
+        }
+
+        QByteArray sum;
+        QBENCHMARK {
+            sum = ComputeChecksum::computeNowOnFile(file, algorithm);
+        }
+        QVERIFY(!sum.isEmpty());
+    }
+
+    void benchmarkBuffer_data()
+    {
+        benchmarkFile_data();
+    }
+
+    // The same digests over an in-memory device, isolating hashing cost
+    // from file I/O.
+    void benchmarkBuffer()
+    {
+        QFETCH(CheckSums::Algorithm, algorithm);
+        QFETCH(qint64, size);
+
+        QByteArray data(static_cast<int>(size), Qt::Uninitialized);
+        for (int i = 0; i < data.size(); ++i) {
+            data[i] = char(i);
+        }
+
+        QByteArray sum;
+        QBENCHMARK {
+            QBuffer buffer(&data);
+            QVERIFY(buffer.open(QIODevice::ReadOnly));
+            sum = ComputeChecksum::computeNow(&buffer, algorithm);
+        }
+        QVERIFY(!sum.isEmpty());
+    }
+
+    void benchmarkStreamingBlockSize_data()
+    {
+        QTest::addColumn<int>("blockSize");
+
+        // The block sizes a download typically hands to StreamingChecksum.
+        QTest::newRow("4KiB blocks") << 4 * 1024;
+        QTest::newRow("64KiB blocks") << 64 * 1024;
+        QTest::newRow("500KiB blocks") << 500 * 1024;
+    }
+
+    // SHA-1 over 8 MiB fed in pieces, as the streamed download paths do.
+    void benchmarkStreamingBlockSize()
+    {
+        QFETCH(int, blockSize);
+
+        const QByteArray data(8 * 1024 * 1024, 'x');
+
+        QByteArray sum;
+        QBENCHMARK {
+            StreamingChecksum streamed(CheckSums::Algorithm::SHA1);
+            for (int offset = 0; offset < data.size(); offset += blockSize) {
+                streamed.update(data.constData() + offset, qMin(blockSize, data.size() - offset));
+            }
+            sum = streamed.result();
+        }
+        QVERIFY(!sum.isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(ChecksumBenchmark)
+
+#include "testchecksumbenchmark.moc"
@@ -113,6 +113,135 @@ private Q_SLOTS:
         QCOMPARE(sSum, sum);
     }
 
+    void testMultipleChecksumsSinglePass()
+    {
+        QString file(_root.path() + QStringLiteral("/file_c.bin"));
+        QVERIFY(TestUtils::writeRandomFile(file));
+
+        const QVector<CheckSums::Algorithm> types { CheckSums::Algorithm::SHA1, CheckSums::Algorithm::MD5, CheckSums::Algorithm::ADLER32 };
+        QFile fileDevice(file);
+        QVERIFY(fileDevice.open(QIODevice::ReadOnly));
+        const QVector<QByteArray> sums = ComputeMultipleChecksums::computeNow(&fileDevice, types);
+        QCOMPARE(sums.size(), types.size());
+
+        // The single pass must agree with the one-algorithm computation.
+        for (int i = 0; i < types.size(); ++i) {
+            fileDevice.seek(0);
+            QCOMPARE(sums.at(i), ComputeChecksum::computeNow(&fileDevice, types.at(i)));
+            QVERIFY(!sums.at(i).isEmpty());
+        }
+    }
+
+    void testMultiChunkChecksum()
+    {
+        QString file(_root.path() + QStringLiteral("/file_e.bin"));
+        // Larger than one read chunk, so the pipelined path of
+        // CheckSums::readInChunks() is exercised.
+        QVERIFY(TestUtils::writeRandomFile(file, 1200 * 1024));
+
+        QFile fileDevice(file);
+        QVERIFY(fileDevice.open(QIODevice::ReadOnly));
+        const QByteArray content = fileDevice.readAll();
+        QCOMPARE(content.size(), 1200 * 1024);
+
+        fileDevice.seek(0);
+        const QByteArray sum = ComputeChecksum::computeNow(&fileDevice, CheckSums::Algorithm::SHA1);
+        QCOMPARE(sum, QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex());
+    }
+
+    void testStreamingChecksum()
+    {
+        QString file(_root.path() + QStringLiteral("/file_d.bin"));
+        QVERIFY(TestUtils::writeRandomFile(file));
+
+        const QVector<CheckSums::Algorithm> types { CheckSums::Algorithm::SHA1, CheckSums::Algorithm::MD5, CheckSums::Algorithm::ADLER32 };
+        QFile fileDevice(file);
+        QVERIFY(fileDevice.open(QIODevice::ReadOnly));
+
+        // Hashing the data in arbitrary small pieces must agree with the
+        // whole-file computation.
+        for (auto type : types) {
+            fileDevice.seek(0);
+            StreamingChecksum streamed(type);
+            while (!fileDevice.atEnd()) {
+                const QByteArray block = fileDevice.read(4095);
+                streamed.update(block.constData(), block.size());
+            }
+            fileDevice.seek(0);
+            QCOMPARE(streamed.result(), ComputeChecksum::computeNow(&fileDevice, type));
+            QVERIFY(!streamed.result().isEmpty());
+        }
+    }
+
+    void testValidatePrecomputed()
+    {
+        auto file = QFile(_testfile);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        _expected = ComputeChecksum::computeNow(&file, CheckSums::Algorithm::SHA1);
+        _expectedType = CheckSums::Algorithm::SHA1;
+
+        ValidateChecksumHeader *vali = new ValidateChecksumHeader(this);
+        connect(vali, &ValidateChecksumHeader::validated, this, &TestChecksumValidator::slotDownValidated);
+        connect(vali, &ValidateChecksumHeader::validationFailed, this, &TestChecksumValidator::slotDownError);
+
+        _successDown = false;
+        QVERIFY(vali->validatePrecomputed(CheckSums::Algorithm::SHA1, _expected, "SHA1:" + _expected));
+        QVERIFY(_successDown);
+
+        // An algorithm mismatch must not emit anything: the caller falls
+        // back to reading the file.
+        _successDown = false;
+        _errorSeen = false;
+        QVERIFY(!vali->validatePrecomputed(CheckSums::Algorithm::MD5, _expected, "SHA1:" + _expected));
+        QVERIFY(!_successDown);
+        QVERIFY(!_errorSeen);
+
+        _expectedError = QStringLiteral("The downloaded file does not match the checksum, it will be resumed. '543345' != '%1'").arg(QString::fromUtf8(_expected));
+        _errorSeen = false;
+        QVERIFY(vali->validatePrecomputed(CheckSums::Algorithm::SHA1, _expected, "SHA1:543345"));
+        QVERIFY(_errorSeen);
+
+        delete vali;
+    }
+
+    void testValidateChecksumBatch()
+    {
+        const QString good(_root.path() + QStringLiteral("/batch_good.bin"));
+        const QString bad(_root.path() + QStringLiteral("/batch_bad.bin"));
+        const QString missing(_root.path() + QStringLiteral("/batch_missing.bin"));
+        QVERIFY(TestUtils::writeRandomFile(good));
+        QVERIFY(TestUtils::writeRandomFile(bad));
+
+        auto file = QFile(good);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        const QByteArray goodSum = ComputeChecksum::computeNow(&file, CheckSums::Algorithm::SHA1);
+
+        const QVector<ValidateChecksumBatch::Entry> entries {
+            { good, "SHA1:" + goodSum },
+            { bad, "SHA1:" + goodSum },
+            { missing, "SHA1:" + goodSum },
+            { good, QByteArray() }, // no header passes, like ValidateChecksumHeader
+        };
+
+        auto *batch = new ValidateChecksumBatch(this);
+        QStringList mismatched;
+        QStringList unreadable;
+        bool seen = false;
+        connect(batch, &ValidateChecksumBatch::done, this,
+            [&](const QStringList &mismatchedPaths, const QStringList &unreadablePaths) {
+                mismatched = mismatchedPaths;
+                unreadable = unreadablePaths;
+                seen = true;
+            });
+        batch->start(entries);
+
+        QTRY_VERIFY(seen);
+        QCOMPARE(mismatched, QStringList { bad });
+        QCOMPARE(unreadable, QStringList { missing });
+
+        delete batch;
+    }
+
     void testUploadChecksummingAdler() {
         ComputeChecksum *vali = new ComputeChecksum(this);
         _expectedType = CheckSums::Algorithm::ADLER32;
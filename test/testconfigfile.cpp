@@ -0,0 +1,67 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "libsync/configfile.h"
+
+#include <QSettings>
+#include <QTemporaryDir>
+
+using namespace OCC;
+
+class TestConfigFile : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir _confDir;
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(_confDir.isValid());
+        QVERIFY(ConfigFile::setConfDir(_confDir.path()));
+    }
+
+    void testReadAfterWrite()
+    {
+        ConfigFile cfg;
+        cfg.setUiLanguage(QStringLiteral("de"));
+        QCOMPARE(cfg.uiLanguage(), QStringLiteral("de"));
+        cfg.setUiLanguage(QStringLiteral("fr"));
+        QCOMPARE(cfg.uiLanguage(), QStringLiteral("fr"));
+    }
+
+    void testDefaults()
+    {
+        ConfigFile cfg;
+        QCOMPARE(cfg.promptDeleteFiles(), true);
+        QCOMPARE(cfg.logHttp(), false);
+        QCOMPARE(cfg.timeout(), std::chrono::seconds(300));
+    }
+
+    void testExternalChangeIsPickedUp()
+    {
+        ConfigFile cfg;
+        // Make sure the file exists and the cache - and with it the file
+        // watcher - is set up before the external write.
+        cfg.setUiLanguage(QStringLiteral("de"));
+        QCOMPARE(cfg.uiLanguage(), QStringLiteral("de"));
+
+        {
+            QSettings external(ConfigFile::configFile(), QSettings::IniFormat);
+            external.setValue(QStringLiteral("uiLanguage"), QStringLiteral("nl"));
+            external.sync();
+        }
+
+        // The watcher invalidates the cache from the event loop
+        QTRY_COMPARE_WITH_TIMEOUT(cfg.uiLanguage(), QStringLiteral("nl"), 5000);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestConfigFile)
+#include "testconfigfile.moc"
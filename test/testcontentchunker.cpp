@@ -0,0 +1,99 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "common/contentchunker.h"
+
+using namespace OCC;
+
+namespace {
+QByteArray makeData(qint64 size, quint32 seed)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    QRandomGenerator generator(seed);
+    for (qint64 i = 0; i < size; i += 4) {
+        const quint32 value = generator.generate();
+        memcpy(data.data() + i, &value, qMin<qint64>(4, size - i));
+    }
+    return data;
+}
+
+QVector<ContentChunk> chunk(const QByteArray &data)
+{
+    QBuffer buffer(const_cast<QByteArray *>(&data));
+    buffer.open(QIODevice::ReadOnly);
+    return ContentChunker::chunk(&buffer);
+}
+}
+
+class TestContentChunker : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testChunksCoverTheData()
+    {
+        const QByteArray data = makeData(40 * 1024 * 1024, 1);
+        const auto chunks = chunk(data);
+        QVERIFY(chunks.size() > 1);
+        qint64 expectedOffset = 0;
+        for (const auto &c : chunks) {
+            QCOMPARE(c.offset, expectedOffset);
+            QVERIFY(c.size <= ContentChunker::maxChunkSize);
+            QCOMPARE(c.hash.size(), 20); // SHA-1
+            expectedOffset += c.size;
+        }
+        // All chunks but the last respect the minimum size.
+        for (int i = 0; i < chunks.size() - 1; ++i) {
+            QVERIFY(chunks.at(i).size >= ContentChunker::minChunkSize);
+        }
+        QCOMPARE(expectedOffset, qint64(data.size()));
+    }
+
+    void testDeterministic()
+    {
+        const QByteArray data = makeData(20 * 1024 * 1024, 2);
+        QCOMPARE(chunk(data), chunk(data));
+    }
+
+    void testEditStaysLocal()
+    {
+        // The point of content-defined boundaries: an insertion in the middle
+        // must not change the chunks of the untouched parts of the file.
+        const QByteArray original = makeData(40 * 1024 * 1024, 3);
+        QByteArray edited = original;
+        edited.insert(edited.size() / 2, makeData(4 * 1024, 4));
+
+        const auto originalChunks = chunk(original);
+        const auto editedChunks = chunk(edited);
+
+        QSet<QByteArray> originalHashes;
+        for (const auto &c : originalChunks) {
+            originalHashes.insert(c.hash);
+        }
+        qint64 reused = 0;
+        for (const auto &c : editedChunks) {
+            if (originalHashes.contains(c.hash)) {
+                reused += c.size;
+            }
+        }
+        // Everything except the chunks around the edit is reusable.
+        QVERIFY(reused >= qint64(original.size()) / 2);
+    }
+
+    void testSmallFileIsOneChunk()
+    {
+        const QByteArray data = makeData(64 * 1024, 5);
+        const auto chunks = chunk(data);
+        QCOMPARE(chunks.size(), 1);
+        QCOMPARE(chunks.first().offset, 0);
+        QCOMPARE(chunks.first().size, qint64(data.size()));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestContentChunker)
+#include "testcontentchunker.moc"
@@ -112,6 +112,7 @@ private Q_SLOTS:
 
             // Now, we need to restart, this time, it should resume.
             QByteArray rangeRequest;
+            QByteArray ifRangeRequest;
             QByteArray rangeReply;
             OperationCounter counter;
 
@@ -119,6 +120,7 @@ private Q_SLOTS:
                 counter.serverOverride(op, request, device);
                 if (op == QNetworkAccessManager::GetOperation && request.url().path().endsWith(QLatin1String("A/a0"))) {
                     rangeRequest = request.rawHeader("Range");
+                    ifRangeRequest = request.rawHeader("If-Range");
                     auto reply = new FakeGetReply(fakeFolder.remoteModifier(), op, request, this);
                     connect(reply, &FakeGetReply::metaDataChanged, reply, [&, reply] {
                         rangeReply = reply->rawHeader("Content-Range");
@@ -130,6 +132,8 @@ private Q_SLOTS:
             fakeFolder.syncJournal()->wipeErrorBlacklist();
             QVERIFY(fakeFolder.applyLocalModificationsAndSync()); // now this should succeed
             QCOMPARE(rangeRequest, QByteArrayLiteral("bytes=") + QByteArray::number(stopAfter) + '-');
+            // The resume must be guarded by the partial file's etag.
+            QCOMPARE(ifRangeRequest, '"' + fakeFolder.remoteModifier().find(QStringLiteral("A/a0"))->etag + '"');
             QCOMPARE(rangeReply, QByteArrayLiteral("bytes ") + QByteArray::number(stopAfter) + '-');
             QCOMPARE(counter.nGET, 1);
 
@@ -117,9 +117,11 @@ private Q_SLOTS:
         QVERIFY(excludedFiles->_fullTraversalRegexFile.pattern().contains(QStringLiteral("csync1")));
         QVERIFY(!excludedFiles->_bnameTraversalRegexFile.pattern().contains(QStringLiteral("csync1")));
 
+        // Wildcard-free patterns bypass the regexes entirely
         excludedFiles->addManualExclude(QStringLiteral("foo"));
-        QVERIFY(excludedFiles->_bnameTraversalRegexFile.pattern().contains(QStringLiteral("foo")));
-        QVERIFY(excludedFiles->_fullRegexFile.pattern().contains(QStringLiteral("foo")));
+        QVERIFY(excludedFiles->_literalKeep.bnameFileDir.contains(QStringLiteral("foo")));
+        QVERIFY(!excludedFiles->_bnameTraversalRegexFile.pattern().contains(QStringLiteral("foo")));
+        QVERIFY(!excludedFiles->_fullRegexFile.pattern().contains(QStringLiteral("foo")));
         QVERIFY(!excludedFiles->_fullTraversalRegexFile.pattern().contains(QStringLiteral("foo")));
     }
 
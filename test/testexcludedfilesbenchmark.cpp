@@ -0,0 +1,191 @@
+/*
+ * This software is in the public domain, furnished "as is", without technical
+ * support, and with no warranty, express or implied, as to its usefulness for
+ * any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "csync_exclude.h"
+#include "testutils/testutils.h"
+
+using namespace OCC;
+
+namespace {
+const QString excludeListFileC = QStringLiteral(":/libsync/sync-exclude.lst");
+
+// A synthetic stand-in for the anonymized 400-pattern production list: the
+// same mix of pattern classes users accumulate, deterministic so numbers are
+// comparable across releases. Roughly a third are wildcard-free (these take
+// the literal fast paths), the rest exercise the regex alternations.
+QStringList syntheticPatternCorpus()
+{
+    QStringList patterns;
+    patterns.reserve(400);
+    for (int i = 0; i < 80; ++i) { // extension wildcards
+        patterns.append(QStringLiteral("*.gen%1").arg(i));
+    }
+    for (int i = 0; i < 60; ++i) { // bname wildcards
+        patterns.append(QStringLiteral("cache_*_%1").arg(i));
+    }
+    for (int i = 0; i < 70; ++i) { // literal bnames
+        patterns.append(QStringLiteral("Thumbs%1.db").arg(i));
+    }
+    for (int i = 0; i < 50; ++i) { // literal directory-only
+        patterns.append(QStringLiteral("build%1/").arg(i));
+    }
+    for (int i = 0; i < 60; ++i) { // anchored full-path
+        patterns.append(QStringLiteral("/projects/proj%1/out").arg(i));
+    }
+    for (int i = 0; i < 40; ++i) { // full-path with wildcard
+        patterns.append(QStringLiteral("work%1/*/tmp").arg(i));
+    }
+    for (int i = 0; i < 40; ++i) { // remove-excludes
+        patterns.append(QStringLiteral("]*.discard%1").arg(i));
+    }
+    return patterns;
+}
+
+// Folder-relative paths as the discovery would feed them to the matcher:
+// mostly not excluded (the common case in a clean tree), with a matching
+// tail so both outcomes stay represented.
+QStringList syntheticPathCorpus()
+{
+    QStringList paths;
+    paths.reserve(2200);
+    for (int i = 0; i < 2000; ++i) {
+        switch (i % 4) {
+        case 0:
+            paths.append(QStringLiteral("documents/report_%1.odt").arg(i));
+            break;
+        case 1:
+            paths.append(QStringLiteral("photos/2024/album %1/img_%1.jpg").arg(i));
+            break;
+        case 2:
+            paths.append(QStringLiteral("projects/proj%1/src/deep/nested/main_%1.cpp").arg(i));
+            break;
+        case 3:
+            paths.append(QStringLiteral("music/artist%1/track.flac").arg(i));
+            break;
+        }
+    }
+    for (int i = 0; i < 100; ++i) {
+        paths.append(QStringLiteral("documents/scratch_%1.gen%2").arg(i).arg(i % 80));
+        paths.append(QStringLiteral("projects/proj%1/out").arg(i % 60));
+    }
+    return paths;
+}
+}
+
+/**
+ * Benchmarks for the exclude matcher in csync_exclude.cpp.
+ *
+ * The regex rebuild in prepare() has regressed silently more than once, and
+ * the traversal matcher sits on the per-entry discovery hot path. These
+ * QBENCHMARK rows pin both: run them over releases and compare, e.g.
+ *   ./ExcludedFilesBenchmarkTest -o excludes.csv,csv
+ */
+class ExcludedFilesBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    const QStringList _corpusPatterns = syntheticPatternCorpus();
+    const QStringList _corpusPaths = syntheticPathCorpus();
+
+    std::unique_ptr<ExcludedFiles> makeExcludes(bool withCorpus) const
+    {
+        auto excludes = std::make_unique<ExcludedFiles>();
+        excludes->addExcludeFilePath(excludeListFileC);
+        if (withCorpus) {
+            for (const auto &pattern : _corpusPatterns) {
+                excludes->addManualExclude(pattern);
+            }
+        }
+        return excludes;
+    }
+
+    static void addCorpusRows()
+    {
+        QTest::addColumn<bool>("withCorpus");
+        QTest::newRow("default list") << false;
+        QTest::newRow("default + 400 patterns") << true;
+    }
+
+private Q_SLOTS:
+
+    void benchmarkReload_data()
+    {
+        addCorpusRows();
+    }
+
+    // The cost of rebuilding the regexes and literal sets, paid on every
+    // exclude file change and at sync engine setup.
+    void benchmarkReload()
+    {
+        QFETCH(bool, withCorpus);
+
+        auto excludes = makeExcludes(withCorpus);
+        QBENCHMARK {
+            QVERIFY(excludes->reloadExcludeFiles());
+        }
+    }
+
+    void benchmarkTraversalMatch_data()
+    {
+        addCorpusRows();
+    }
+
+    // The per-entry check discovery runs on every file of every sync.
+    void benchmarkTraversalMatch()
+    {
+        QFETCH(bool, withCorpus);
+
+        auto excludes = makeExcludes(withCorpus);
+        QVERIFY(excludes->reloadExcludeFiles());
+
+        int excluded = 0;
+        QBENCHMARK {
+            excluded = 0;
+            for (const auto &path : _corpusPaths) {
+                if (excludes->traversalPatternMatch(path, ItemTypeFile) != CSYNC_NOT_EXCLUDED) {
+                    ++excluded;
+                }
+            }
+        }
+        QVERIFY(excluded > 0);
+        QVERIFY(excluded < _corpusPaths.size());
+    }
+
+    void benchmarkFullMatch_data()
+    {
+        addCorpusRows();
+    }
+
+    // The full matcher, as used outside of traversal (remote checks, the
+    // file watcher). isExcludedRemote is its public entry point.
+    void benchmarkFullMatch()
+    {
+        QFETCH(bool, withCorpus);
+
+        auto excludes = makeExcludes(withCorpus);
+        QVERIFY(excludes->reloadExcludeFiles());
+
+        const QString basePath = QStringLiteral("/sync/");
+        int excluded = 0;
+        QBENCHMARK {
+            excluded = 0;
+            for (const auto &path : _corpusPaths) {
+                if (excludes->isExcludedRemote(basePath + path, basePath, false, ItemTypeFile)) {
+                    ++excluded;
+                }
+            }
+        }
+        QVERIFY(excluded > 0);
+        QVERIFY(excluded < _corpusPaths.size());
+    }
+};
+
+QTEST_GUILESS_MAIN(ExcludedFilesBenchmark)
+
+#include "testexcludedfilesbenchmark.moc"
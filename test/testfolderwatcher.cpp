@@ -24,6 +24,8 @@ public:
     FolderWatcherForTests()
         : FolderWatcher(nullptr) { };
 
+    using OCC::FolderWatcher::changeDetected;
+
     bool pathIsIgnored(const QString &) const override { return false; }
 };
 
@@ -268,6 +270,26 @@ private Q_SLOTS:
         mkdir(dir);
         QVERIFY(waitForPathChanged(dir));
     }
+
+    void testEventStormCoalescing() {
+        // Drain anything left over from the previous tests
+        _watcher->popChangeSet();
+
+        // More paths than coalesceThresholdC in folderwatcher.cpp allows
+        QSet<QString> storm;
+        for (int i = 0; i < 1500; ++i) {
+            storm.insert(_rootPath + QStringLiteral("/a2/b3/c3/file%1.o").arg(i));
+        }
+        storm.insert(_rootPath + QStringLiteral("/toplevel.txt"));
+        _watcher->changeDetected(storm);
+
+        const auto paths = _watcher->popChangeSet();
+        // The storm collapsed to a hint for the containing directory ...
+        QVERIFY(paths.contains(_rootPath + QStringLiteral("/a2/b3/c3")));
+        // ... while entries directly below the root are kept as they are.
+        QVERIFY(paths.contains(_rootPath + QStringLiteral("/toplevel.txt")));
+        QCOMPARE(paths.size(), 2);
+    }
 };
 
 #ifdef Q_OS_MAC
@@ -32,32 +32,25 @@ private Q_SLOTS:
         rootDir.mkpath(_root + QStringLiteral("/a2/b3/c3"));
     }
 
-    // Test the recursive path listing function findFoldersBelow
+    // Test the recursive watch registration function addFoldersBelow
     void testDirsBelowPath() {
-        QStringList dirs;
+        int addedCount = 0;
 
-        bool ok = findFoldersBelow(QDir(_root), dirs);
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a1")) > -1);
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a1/b1")) > -1);
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a1/b1/c1")) > -1);
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a1/b1/c2")) > -1);
+        bool ok = addFoldersBelow(QDir(_root), addedCount);
 
+        QVERIFY2(addedCount == 11, "Directory count wrong.");
+        QVERIFY2(ok, "addFoldersBelow failed.");
+
+        // Plain files must not be picked up by the traversal. Without an
+        // inotify fd no watch registration sticks, so a re-run visits all
+        // directories again - and only the directories.
         QVERIFY(TestUtils::writeRandomFile(_root + QStringLiteral("/a1/rand1.dat")));
         QVERIFY(TestUtils::writeRandomFile(_root + QStringLiteral("/a1/b1/rand2.dat")));
         QVERIFY(TestUtils::writeRandomFile(_root + QStringLiteral("/a1/b1/c1/rand3.dat")));
 
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a1/b2")) > -1);
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a1/b2/c1")) > -1);
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a1/b3")) > -1);
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a1/b3/c3")) > -1);
-
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a2")));
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a2/b3")));
-        QVERIFY(dirs.indexOf(_root + QStringLiteral("/a2/b3/c3")));
-
-        QVERIFY2(dirs.count() == 11, "Directory count wrong.");
-
-        QVERIFY2(ok, "findFoldersBelow failed.");
+        int recount = 0;
+        QVERIFY(addFoldersBelow(QDir(_root), recount));
+        QVERIFY2(recount == 11, "Plain files must not be counted.");
     }
 
     void cleanupTestCase() {
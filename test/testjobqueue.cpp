@@ -20,13 +20,18 @@ class TestJob : public AbstractNetworkJob
     // AbstractNetworkJob interface
 public:
     // TODO: davurl
-    TestJob(Account *account)
+    TestJob(Account *account, QStringList *retryOrder = nullptr, const QString &name = {})
         : AbstractNetworkJob(account, account->davUrl(), QStringLiteral("/A/a1"))
+        , _retryOrder(retryOrder)
+        , _name(name)
     {
     }
 
     void start() override
     {
+        if (_retryOrder && retryCount() > 0) {
+            _retryOrder->append(_name);
+        }
         QNetworkRequest req;
         req.setRawHeader("Depth", "0");
 
@@ -48,6 +53,10 @@ protected:
     void finished() override
     {
     }
+
+private:
+    QStringList *_retryOrder;
+    QString _name;
 };
 
 class TestJobQueue : public QObject
@@ -78,6 +87,33 @@ private Q_SLOTS:
         QVERIFY(!queue->isBlocked());
     }
 
+    void testPriorityLanes()
+    {
+        FakeFolder fakeFolder { FileInfo::A12_B12_C12_S12() };
+
+        auto queue = fakeFolder.account()->jobQueue();
+        JobQueueGuard queueGuard(queue);
+        QVERIFY(queueGuard.block());
+
+        QStringList retryOrder;
+        TestJob *bulk = new TestJob(fakeFolder.account(), &retryOrder, QStringLiteral("bulk"));
+        bulk->setPriority(QNetworkRequest::LowPriority);
+        TestJob *metadata = new TestJob(fakeFolder.account(), &retryOrder, QStringLiteral("metadata"));
+        TestJob *interactive = new TestJob(fakeFolder.account(), &retryOrder, QStringLiteral("interactive"));
+        interactive->setPriority(QNetworkRequest::HighPriority);
+
+        // Queued in the reverse of the order they must come out in.
+        bulk->start();
+        metadata->start();
+        interactive->start();
+        QCOMPARE(queue->size(), 3);
+
+        QVERIFY(queueGuard.unblock());
+        QCOMPARE(queue->size(), 0);
+        const QStringList expected { QStringLiteral("interactive"), QStringLiteral("metadata"), QStringLiteral("bulk") };
+        QCOMPARE(retryOrder, expected);
+    }
+
     void testMultiBlock()
     {
         FakeFolder fakeFolder { FileInfo::A12_B12_C12_S12() };
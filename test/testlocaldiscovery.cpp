@@ -134,6 +134,32 @@ private Q_SLOTS:
         QVERIFY(!engine->shouldDiscoverLocally(QString()));
     }
 
+    void testLocalTouchedChildren()
+    {
+        QFETCH_GLOBAL(Vfs::Mode, vfsMode);
+        QFETCH_GLOBAL(bool, filesAreDehydrated);
+
+        FakeFolder fakeFolder(FileInfo::A12_B12_C12_S12(), vfsMode, filesAreDehydrated);
+        auto engine = fakeFolder.syncEngine();
+
+        // FilesystemOnly always requires full listings.
+        QVERIFY(engine->localTouchedChildrenOf(QString()).isEmpty());
+
+        engine->setLocalDiscoveryOptions(LocalDiscoveryStyle::DatabaseAndFilesystem,
+            {QStringLiteral("A/X"), QStringLiteral("foo bar space/touch"), QStringLiteral("foo/"), QStringLiteral("zzz"), QStringLiteral("zzzz")});
+
+        QCOMPARE(engine->localTouchedChildrenOf(QString()),
+            (QSet<QString>{QStringLiteral("A"), QStringLiteral("foo bar space"), QStringLiteral("foo"), QStringLiteral("zzz"), QStringLiteral("zzzz")}));
+        QCOMPARE(engine->localTouchedChildrenOf(QStringLiteral("A")), QSet<QString>{QStringLiteral("X")});
+        QCOMPARE(engine->localTouchedChildrenOf(QStringLiteral("foo bar space")), QSet<QString>{QStringLiteral("touch")});
+        // Touched entries themselves need a full listing...
+        QVERIFY(engine->localTouchedChildrenOf(QStringLiteral("A/X")).isEmpty());
+        // ... as do directories listed with a trailing slash ...
+        QVERIFY(engine->localTouchedChildrenOf(QStringLiteral("foo")).isEmpty());
+        // ... and directories with nothing touched below them.
+        QVERIFY(engine->localTouchedChildrenOf(QStringLiteral("B")).isEmpty());
+    }
+
     // Check whether item success and item failure adjusts the
     // tracker correctly.
     void testTrackerItemCompletion()
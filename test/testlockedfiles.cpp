@@ -81,11 +81,8 @@ private Q_SLOTS:
         watcher.addFile(tmpFile, FileSystem::LockMode::Shared);
         QVERIFY(watcher.contains(tmpFile, FileSystem::LockMode::Shared));
 
-        QEventLoop loop;
-        QTimer::singleShot(120ms, &loop, [&] { loop.exit(); });
-        loop.exec();
-
-        QCOMPARE(count, 1);
+        // the probes run asynchronously on a worker thread
+        QTRY_COMPARE(count, 1);
         QCOMPARE(file, tmpFile);
         QVERIFY(!watcher.contains(tmpFile, FileSystem::LockMode::Shared));
 
@@ -106,10 +103,8 @@ private Q_SLOTS:
         CloseHandle(h);
         QVERIFY(!FileSystem::isFileLocked(tmpFile, FileSystem::LockMode::Shared));
 
-        QThread::msleep(120);
-        qApp->processEvents();
-
-        QCOMPARE(count, 1);
+        // the poll interval backed off while the file was locked
+        QTRY_COMPARE_WITH_TIMEOUT(count, 1, 5000);
         QCOMPARE(file, tmpFile);
         QVERIFY(!watcher.contains(tmpFile, FileSystem::LockMode::Shared));
 #endif
@@ -0,0 +1,91 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "common/metrics.h"
+
+#include <QJsonObject>
+
+using namespace OCC;
+
+class TestMetrics : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testCounter()
+    {
+        static Metrics::Counter counter("test.counter");
+        QCOMPARE(counter.value(), 0);
+        counter.add();
+        counter.add(41);
+        QCOMPARE(counter.value(), 42);
+        QCOMPARE(Metrics::toJson().value(QStringLiteral("test.counter")).toInteger(), 42);
+    }
+
+    void testGauge()
+    {
+        static Metrics::Gauge gauge("test.gauge");
+        gauge.set(10);
+        gauge.add(-3);
+        QCOMPARE(gauge.value(), 7);
+        QCOMPARE(Metrics::toJson().value(QStringLiteral("test.gauge")).toInteger(), 7);
+    }
+
+    void testPeakGauge()
+    {
+        static Metrics::PeakGauge gauge("test.peakGauge");
+        gauge.add(100);
+        gauge.add(-60);
+        gauge.add(20);
+        QCOMPARE(gauge.value(), 60);
+        QCOMPARE(gauge.peak(), 100);
+
+        const QJsonObject snapshot = Metrics::toJson();
+        QCOMPARE(snapshot.value(QStringLiteral("test.peakGauge")).toInteger(), 60);
+        QCOMPARE(snapshot.value(QStringLiteral("test.peakGauge.peak")).toInteger(), 100);
+
+        gauge.resetPeak();
+        QCOMPARE(gauge.peak(), 60);
+        gauge.add(5);
+        QCOMPARE(gauge.peak(), 65);
+    }
+
+    void testSnapshotContainsAllRegistered()
+    {
+        const QJsonObject snapshot = Metrics::toJson();
+        QVERIFY(snapshot.contains(QStringLiteral("test.counter")));
+        QVERIFY(snapshot.contains(QStringLiteral("test.gauge")));
+    }
+
+    void testConcurrentUpdates()
+    {
+        static Metrics::Counter counter("test.concurrentCounter");
+        const int threadCount = 4;
+        const int increments = 10000;
+        QVector<QThread *> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            threads.append(QThread::create([] {
+                for (int j = 0; j < increments; ++j) {
+                    counter.add();
+                }
+            }));
+        }
+        for (auto *thread : threads) {
+            thread->start();
+        }
+        for (auto *thread : threads) {
+            QVERIFY(thread->wait());
+            delete thread;
+        }
+        QCOMPARE(counter.value(), qint64(threadCount) * increments);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestMetrics)
+#include "testmetrics.moc"
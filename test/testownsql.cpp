@@ -9,6 +9,8 @@
 
 #include <QtTest>
 
+#include <QJsonObject>
+
 #include <sqlite3.h>
 
 using namespace OCC;
@@ -19,6 +21,14 @@ class TestOwnSql : public QObject
     const QTemporaryDir _tempDir = TestUtils::createTempDir();
 
 private Q_SLOTS:
+    void initTestCase()
+    {
+        // Must be set before the first query runs, the audit switch is
+        // latched on first use. Threshold 0 captures every query plan.
+        qputenv("OWNCLOUD_SQL_AUDIT", "1");
+        qputenv("OWNCLOUD_SQL_AUDIT_THRESHOLD_MS", "0");
+    }
+
     void testOpenDb() {
         QFileInfo fi(_tempDir.path() + QStringLiteral("/testdb.sqlite"));
         QVERIFY( !fi.exists() ); // must not exist
@@ -127,6 +137,27 @@ private Q_SLOTS:
         }
     }
 
+    void testAuditReport()
+    {
+        QVERIFY(sqlAuditEnabled());
+
+        const QByteArray sql = QByteArrayLiteral("SELECT name FROM addresses WHERE id=1;");
+        SqlQuery q(sql, _db);
+        QVERIFY(q.next().hasData);
+        QVERIFY(q.next().ok);
+
+        const QJsonObject report = sqlAuditReport();
+        QVERIFY(report.contains(QString::fromUtf8(sql)));
+        const QJsonObject entry = report.value(QString::fromUtf8(sql)).toObject();
+        QCOMPARE(entry.value(QStringLiteral("executions")).toInteger(), 1);
+        QVERIFY(entry.value(QStringLiteral("totalUs")).toInteger() >= entry.value(QStringLiteral("maxUs")).toInteger());
+        // Threshold is 0, so the plan was captured on the first step
+        QVERIFY(entry.value(QStringLiteral("queryPlan")).toString().contains(QStringLiteral("addresses")));
+
+        // The earlier slots' statements were collected as well
+        QVERIFY(report.size() > 1);
+    }
+
     void testDestructor()
     {
         // This test make sure that the destructor of SqlQuery works even if the SqlDatabase
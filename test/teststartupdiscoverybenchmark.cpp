@@ -0,0 +1,114 @@
+/*
+ * This software is in the public domain, furnished "as is", without technical
+ * support, and with no warranty, express or implied, as to its usefulness for
+ * any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "common/syncjournaldb.h"
+#include "common/syncjournalfilerecord.h"
+#include "common/utility.h"
+
+using namespace OCC;
+
+/**
+ * Benchmarks the journal-served startup discovery path.
+ *
+ * With trustJournalAtStartup enabled the first sync after process start reads
+ * the local tree state from the journal instead of walking the filesystem.
+ * On folders with hundreds of thousands of placeholders the walk dominates
+ * login time; the journal read below is what replaces it. The read scales
+ * linearly with the record count, so the 10k/50k rows here extrapolate
+ * directly to 500k-placeholder folders that are impractical to set up in CI.
+ */
+class StartupDiscoveryBenchmark : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir _tempDir;
+
+public:
+    StartupDiscoveryBenchmark()
+        : _db((_tempDir.path() + QStringLiteral("/sync.db")), nullptr)
+    {
+        QVERIFY(_tempDir.isValid());
+    }
+
+private:
+    void populate(int fileCount)
+    {
+        const qint64 modtime = Utility::qDateTimeToTime_t(QDateTime::currentDateTimeUtc());
+        const int batchSize = 1000;
+        QVector<SyncJournalFileRecord> batch;
+        batch.reserve(batchSize);
+        for (int i = 0; i < fileCount; ++i) {
+            SyncJournalFileRecord record;
+            // Spread the files over subdirectories like a real folder.
+            record._path = "dir" + QByteArray::number(i / 1000) + "/file" + QByteArray::number(i);
+            record._inode = i + 1;
+            record._modtime = modtime;
+            record._type = ItemTypeVirtualFile;
+            record._etag = "etag" + QByteArray::number(i);
+            record._fileId = "fileid" + QByteArray::number(i);
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            record._fileSize = 1024 + i;
+            batch.append(record);
+            if (batch.size() == batchSize) {
+                QVERIFY(_db.setFileRecords(batch));
+                batch.clear();
+            }
+        }
+        if (!batch.isEmpty()) {
+            QVERIFY(_db.setFileRecords(batch));
+        }
+    }
+
+private Q_SLOTS:
+
+    void benchmarkJournalDiscovery_data()
+    {
+        QTest::addColumn<int>("fileCount");
+
+        QTest::newRow("10k placeholders") << 10000;
+        QTest::newRow("50k placeholders") << 50000;
+    }
+
+    // Reads every file record below the sync root in path order, the access
+    // pattern of a discovery run served entirely from the journal.
+    void benchmarkJournalDiscovery()
+    {
+        QFETCH(int, fileCount);
+
+        populate(fileCount);
+
+        qint64 seen = 0;
+        QBENCHMARK {
+            seen = 0;
+            auto cursor = _db.filesBelowPathCursor(QByteArray());
+            while (cursor.next()) {
+                seen += cursor.record()._fileSize > 0 ? 1 : 0;
+            }
+            QVERIFY(cursor.ok());
+        }
+        QCOMPARE(seen, static_cast<qint64>(fileCount));
+
+        // Fresh journal for the next row, record counts must not accumulate.
+        auto cursor = _db.filesBelowPathCursor(QByteArray());
+        QByteArrayList paths;
+        while (cursor.next()) {
+            paths.append(cursor.record()._path);
+        }
+        for (const auto &path : std::as_const(paths)) {
+            QVERIFY(_db.deleteFileRecord(QString::fromUtf8(path)));
+        }
+    }
+
+private:
+    SyncJournalDb _db;
+};
+
+QTEST_GUILESS_MAIN(StartupDiscoveryBenchmark)
+
+#include "teststartupdiscoverybenchmark.moc"
@@ -880,6 +880,37 @@ private Q_SLOTS:
         QVERIFY(!fakeFolder.currentLocalState().find(QStringLiteral("A")));
         QVERIFY(!fakeFolder.currentLocalState().find(QStringLiteral("S")));
     }
+
+    void testSyncUnderNetworkShaping()
+    {
+        QFETCH_GLOBAL(Vfs::Mode, vfsMode);
+        QFETCH_GLOBAL(bool, filesAreDehydrated);
+
+        FakeFolder fakeFolder(FileInfo::A12_B12_C12_S12(), vfsMode, filesAreDehydrated);
+
+        // A slow, narrow connection: replies are no longer instantaneous, so
+        // jobs genuinely overlap like they do against a real server.
+        FakeAM::NetworkShaping shaping;
+        shaping.latency = std::chrono::milliseconds(20);
+        shaping.bytesPerSecond = 100 * 1000;
+        fakeFolder.setNetworkShaping(shaping);
+
+        fakeFolder.localModifier().insert(QStringLiteral("A/newLocalFile"));
+        fakeFolder.remoteModifier().insert(QStringLiteral("B/newRemoteFile"));
+        QVERIFY(fakeFolder.applyLocalModificationsAndSync());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // With every request failing the sync must fail, not hang.
+        shaping.errorRatePercent = 100;
+        fakeFolder.setNetworkShaping(shaping);
+        fakeFolder.remoteModifier().insert(QStringLiteral("B/unreachable"));
+        QVERIFY(!fakeFolder.applyLocalModificationsAndSync());
+
+        // Back to a clean line the sync recovers.
+        fakeFolder.setNetworkShaping({});
+        QVERIFY(fakeFolder.applyLocalModificationsAndSync());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
 };
 
 QTEST_GUILESS_MAIN(TestSyncEngine)
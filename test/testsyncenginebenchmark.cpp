@@ -0,0 +1,146 @@
+/*
+ * This software is in the public domain, furnished "as is", without technical
+ * support, and with no warranty, express or implied, as to its usefulness for
+ * any purpose.
+ *
+ */
+
+#include <syncengine.h>
+
+#include "testutils/syncenginetestutils.h"
+#include "testutils/testutils.h"
+
+#include <QtTest>
+
+using namespace OCC;
+
+/**
+ * Scenario benchmarks for SyncEngine and OwncloudPropagator against the fake
+ * server, so performance work on discovery and propagation has a regression
+ * baseline.
+ *
+ * The default rows are sized to finish in CI; the full-size scenarios from
+ * the performance plan (up to 1M-file discovery and 100k-small-file
+ * propagation) take minutes and gigabytes of disk, so they only run with
+ * OWNCLOUD_BENCHMARK_LARGE=1 set.
+ *
+ * The `owncloud_benchmark` build target runs all benchmark executables and
+ * writes the timings as CSV below <builddir>/benchmarks/. To get the same
+ * machine-readable output manually:
+ *   ./SyncEngineBenchmarkTest -o syncengine.csv,csv
+ */
+class SyncEngineBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    static bool largeScenarios()
+    {
+        return qEnvironmentVariableIntValue("OWNCLOUD_BENCHMARK_LARGE") == 1;
+    }
+
+    /// A tree of directoryCount directories holding filesPerDirectory small files each
+    static FileInfo makeTree(int directoryCount, int filesPerDirectory)
+    {
+        FileInfo tree;
+        for (int d = 0; d < directoryCount; ++d) {
+            const QString dir = QStringLiteral("d%1").arg(d);
+            tree.mkdir(dir);
+            for (int f = 0; f < filesPerDirectory; ++f) {
+                tree.insert(dir + QStringLiteral("/f%1").arg(f), 23);
+            }
+        }
+        return tree;
+    }
+
+private Q_SLOTS:
+    void benchmarkDiscoveryUnchanged_data()
+    {
+        QTest::addColumn<int>("directoryCount");
+        QTest::addColumn<int>("filesPerDirectory");
+
+        QTest::newRow("10k files") << 100 << 100;
+        if (largeScenarios()) {
+            QTest::newRow("100k files") << 250 << 400;
+            QTest::newRow("1M files") << 1000 << 1000;
+        }
+    }
+
+    // A sync with no changes on either side: pure local and remote discovery
+    // plus reconcile, the cost every periodic sync of a quiet folder pays.
+    void benchmarkDiscoveryUnchanged()
+    {
+        QFETCH(int, directoryCount);
+        QFETCH(int, filesPerDirectory);
+
+        FakeFolder fakeFolder(makeTree(directoryCount, filesPerDirectory));
+        QBENCHMARK {
+            QVERIFY(fakeFolder.syncOnce());
+        }
+    }
+
+    void benchmarkSmallFilePropagation_data()
+    {
+        QTest::addColumn<int>("fileCount");
+
+        QTest::newRow("1k files") << 1000;
+        if (largeScenarios()) {
+            QTest::newRow("10k files") << 10000;
+            QTest::newRow("100k files") << 100000;
+        }
+    }
+
+    // Downloads many new small files, the per-item overhead scenario where
+    // job scheduling and journal writes dominate over payload transfer.
+    void benchmarkSmallFilePropagation()
+    {
+        QFETCH(int, fileCount);
+
+        FakeFolder fakeFolder { FileInfo {} };
+        const int filesPerDirectory = 100;
+        for (int f = 0; f < fileCount; ++f) {
+            if (f % filesPerDirectory == 0) {
+                fakeFolder.remoteModifier().mkdir(QStringLiteral("d%1").arg(f / filesPerDirectory));
+            }
+            fakeFolder.remoteModifier().insert(QStringLiteral("d%1/f%2").arg(f / filesPerDirectory).arg(f), 23);
+        }
+
+        // One measured run: repeating it would have to undo the downloads,
+        // which would measure the cleanup as well.
+        QBENCHMARK_ONCE {
+            QVERIFY(fakeFolder.syncOnce());
+        }
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    void benchmarkRenameStorm_data()
+    {
+        QTest::addColumn<int>("directoryCount");
+
+        QTest::newRow("100 dirs") << 100;
+        if (largeScenarios()) {
+            QTest::newRow("1000 dirs") << 1000;
+        }
+    }
+
+    // Every directory is renamed remotely at once, as a big refactoring or a
+    // restored backup produces: discovery must detect the moves and the
+    // propagator turns them into local renames instead of re-downloads.
+    void benchmarkRenameStorm()
+    {
+        QFETCH(int, directoryCount);
+
+        const int filesPerDirectory = 20;
+        FakeFolder fakeFolder(makeTree(directoryCount, filesPerDirectory));
+        for (int d = 0; d < directoryCount; ++d) {
+            fakeFolder.remoteModifier().rename(QStringLiteral("d%1").arg(d), QStringLiteral("r%1").arg(d));
+        }
+
+        QBENCHMARK_ONCE {
+            QVERIFY(fakeFolder.syncOnce());
+        }
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+};
+
+QTEST_GUILESS_MAIN(SyncEngineBenchmark)
+#include "testsyncenginebenchmark.moc"
@@ -90,6 +90,117 @@ private Q_SLOTS:
         QVERIFY(!record.isValid());
     }
 
+    void testFileRecordBatch()
+    {
+        // More records than fit into one multi-row statement
+        const int recordCount = 123;
+        QVector<SyncJournalFileRecord> records;
+        for (int i = 0; i < recordCount; ++i) {
+            SyncJournalFileRecord record;
+            record._path = "batch/file" + QByteArray::number(i);
+            record._inode = i + 1;
+            record._modtime = dropMsecs(QDateTime::currentDateTime());
+            record._type = ItemTypeFile;
+            record._etag = "etag" + QByteArray::number(i);
+            record._fileId = "fileid" + QByteArray::number(i);
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            record._fileSize = i * 100;
+            record._checksumHeader = "MD5:batchchecksum";
+            records.append(record);
+        }
+        QVERIFY(_db.setFileRecords(records));
+
+        for (const auto &record : std::as_const(records)) {
+            SyncJournalFileRecord storedRecord;
+            QVERIFY(_db.getFileRecord(record._path, &storedRecord));
+            QVERIFY(storedRecord == record);
+        }
+
+        // With batching enabled, records queued via setFileRecord() must still
+        // be visible to subsequent reads.
+        QVERIFY(_db.setWriteBatchingEnabled(true));
+        SyncJournalFileRecord queued = records.first();
+        queued._etag = "etag-updated";
+        QVERIFY(_db.setFileRecord(queued));
+        SyncJournalFileRecord storedRecord;
+        QVERIFY(_db.getFileRecord(queued._path, &storedRecord));
+        QVERIFY(storedRecord == queued);
+        QVERIFY(_db.setWriteBatchingEnabled(false));
+
+        for (const auto &record : std::as_const(records)) {
+            QVERIFY(_db.deleteFileRecord(QString::fromUtf8(record._path)));
+        }
+    }
+
+    void testFileRecordCursor()
+    {
+        QStringList paths;
+        for (int i = 0; i < 5; ++i) {
+            SyncJournalFileRecord record;
+            record._path = "cursor/file" + QByteArray::number(i);
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            record._modtime = dropMsecs(QDateTime::currentDateTime());
+            QVERIFY(_db.setFileRecord(record));
+            paths.append(QString::fromUtf8(record._path));
+        }
+
+        QStringList seen;
+        auto cursor = _db.filesBelowPathCursor(QByteArrayLiteral("cursor"));
+        while (cursor.next()) {
+            seen.append(QString::fromUtf8(cursor.record()._path));
+        }
+        QVERIFY(cursor.ok());
+        QCOMPARE(seen, paths);
+
+        const auto count = _db.countFilesBelowPath(QByteArrayLiteral("cursor"));
+        QVERIFY(count);
+        QCOMPARE(*count, static_cast<qint64>(paths.size()));
+
+        for (const auto &path : std::as_const(paths)) {
+            QVERIFY(_db.deleteFileRecord(path));
+        }
+    }
+
+    void testHasHydratedOrDehydratedFiles()
+    {
+        auto makeRecord = [&](const QByteArray &path, ItemType type) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._type = type;
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            record._modtime = dropMsecs(QDateTime::currentDateTime());
+            QVERIFY(_db.setFileRecord(record));
+        };
+        makeRecord("avail/hydrated", ItemTypeFile);
+        makeRecord("avail/sub/dehydrated", ItemTypeVirtualFile);
+        makeRecord("availother/hydrated", ItemTypeFile);
+
+        auto status = _db.hasHydratedOrDehydratedFiles(QByteArrayLiteral("avail"));
+        QVERIFY(status);
+        QVERIFY(status->hasHydrated);
+        QVERIFY(status->hasDehydrated);
+
+        // "availother" must not be treated as part of the "avail" subtree
+        status = _db.hasHydratedOrDehydratedFiles(QByteArrayLiteral("avail/sub"));
+        QVERIFY(status);
+        QVERIFY(!status->hasHydrated);
+        QVERIFY(status->hasDehydrated);
+
+        status = _db.hasHydratedOrDehydratedFiles(QByteArrayLiteral("availother"));
+        QVERIFY(status);
+        QVERIFY(status->hasHydrated);
+        QVERIFY(!status->hasDehydrated);
+
+        status = _db.hasHydratedOrDehydratedFiles(QByteArrayLiteral("avail/nosuchpath"));
+        QVERIFY(status);
+        QVERIFY(!status->hasHydrated);
+        QVERIFY(!status->hasDehydrated);
+
+        for (const auto &path : {QStringLiteral("avail/hydrated"), QStringLiteral("avail/sub/dehydrated"), QStringLiteral("availother/hydrated")}) {
+            QVERIFY(_db.deleteFileRecord(path));
+        }
+    }
+
     void testFileRecordChecksum()
     {
         // Try with and without a checksum
@@ -170,6 +281,94 @@ private Q_SLOTS:
         QVERIFY(!wipedRecord._valid);
     }
 
+    void testChecksumCache()
+    {
+        QCOMPARE(_db.checksumCacheEntry(1234, 100, 2000), QByteArray());
+
+        _db.setChecksumCacheEntry(1234, 100, 2000, QByteArrayLiteral("SHA1:deadbeef"));
+        QCOMPARE(_db.checksumCacheEntry(1234, 100, 2000), QByteArrayLiteral("SHA1:deadbeef"));
+
+        // A different size or mtime is a different file content: miss.
+        QCOMPARE(_db.checksumCacheEntry(1234, 101, 2000), QByteArray());
+        QCOMPARE(_db.checksumCacheEntry(1234, 100, 2001), QByteArray());
+
+        // A new checksum for the same inode replaces the stale entry.
+        _db.setChecksumCacheEntry(1234, 100, 2001, QByteArrayLiteral("SHA1:cafe"));
+        QCOMPARE(_db.checksumCacheEntry(1234, 100, 2000), QByteArray());
+        QCOMPARE(_db.checksumCacheEntry(1234, 100, 2001), QByteArrayLiteral("SHA1:cafe"));
+    }
+
+    void testGetFileRecordsAfterPath()
+    {
+        const QByteArrayList paths = { "walk/a", "walk/b", "walk/b/x", "walk/c" };
+        for (const auto &path : paths) {
+            SyncJournalFileRecord record;
+            record._path = path;
+            record._type = ItemTypeFile;
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            QVERIFY(_db.setFileRecord(record));
+        }
+
+        // Page through the whole journal two rows at a time; every record
+        // must come by exactly once and in path order.
+        QByteArrayList seen;
+        QByteArray cursor;
+        while (true) {
+            int rowsInPage = 0;
+            QVERIFY(_db.getFileRecordsAfterPath(cursor, 2, [&](const SyncJournalFileRecord &record) {
+                ++rowsInPage;
+                cursor = record._path;
+                if (record._path.startsWith("walk/"))
+                    seen.append(record._path);
+            }));
+            QVERIFY(rowsInPage <= 2);
+            if (rowsInPage == 0)
+                break;
+        }
+        QCOMPARE(seen, paths);
+
+        // Resuming after a path skips everything up to and including it.
+        seen.clear();
+        QVERIFY(_db.getFileRecordsAfterPath("walk/b", 100, [&](const SyncJournalFileRecord &record) {
+            if (record._path.startsWith("walk/"))
+                seen.append(record._path);
+        }));
+        QCOMPARE(seen, (QByteArrayList { "walk/b/x", "walk/c" }));
+    }
+
+    void testHistoryEntries()
+    {
+        QCOMPARE(_db.historyEntriesBefore(0, 10).size(), 0);
+
+        QVector<SyncJournalDb::HistoryEntry> batch;
+        for (int i = 0; i < 10; ++i) {
+            SyncJournalDb::HistoryEntry entry;
+            entry.timestamp = 1000 + i;
+            entry.path = QStringLiteral("history/file%1").arg(i);
+            entry.size = i;
+            entry.status = 1;
+            entry.direction = 0;
+            batch.append(entry);
+        }
+        QVERIFY(_db.addHistoryEntries(batch, 100));
+
+        // Newest first, rowid as the paging cursor.
+        auto page = _db.historyEntriesBefore(0, 4);
+        QCOMPARE(page.size(), 4);
+        QCOMPARE(page.first().path, QStringLiteral("history/file9"));
+        auto nextPage = _db.historyEntriesBefore(page.last().id, 100);
+        QCOMPARE(nextPage.size(), 6);
+        QCOMPARE(nextPage.first().path, QStringLiteral("history/file5"));
+        QCOMPARE(nextPage.last().path, QStringLiteral("history/file0"));
+
+        // The cap prunes the oldest rows.
+        QVERIFY(_db.addHistoryEntries(batch, 5));
+        const auto all = _db.historyEntriesBefore(0, 100);
+        QCOMPARE(all.size(), 5);
+        QCOMPARE(all.first().path, QStringLiteral("history/file9"));
+        QCOMPARE(all.last().path, QStringLiteral("history/file5"));
+    }
+
     void testConflictRecord()
     {
         ConflictRecord record;
@@ -179,6 +378,10 @@ private Q_SLOTS:
         record.baseEtag = "ghi";
 
         QVERIFY(!_db.conflictRecord(record.path).isValid());
+        QCOMPARE(_db.conflictRecordCount(), 0);
+
+        QSignalSpy addedSpy(&_db, &SyncJournalDb::conflictRecordAdded);
+        QSignalSpy removedSpy(&_db, &SyncJournalDb::conflictRecordRemoved);
 
         _db.setConflictRecord(record);
         auto newRecord = _db.conflictRecord(record.path);
@@ -187,9 +390,36 @@ private Q_SLOTS:
         QCOMPARE(newRecord.baseFileId, record.baseFileId);
         QCOMPARE(newRecord.baseModtime, record.baseModtime);
         QCOMPARE(newRecord.baseEtag, record.baseEtag);
+        QCOMPARE(_db.conflictRecordCount(), 1);
+        QCOMPARE(addedSpy.size(), 1);
 
         _db.deleteConflictRecord(record.path);
         QVERIFY(!_db.conflictRecord(record.path).isValid());
+        QCOMPARE(_db.conflictRecordCount(), 0);
+        QCOMPARE(removedSpy.size(), 1);
+
+        // deleting an absent record must not pretend a conflict was resolved
+        _db.deleteConflictRecord(record.path);
+        QCOMPARE(removedSpy.size(), 1);
+    }
+
+    void testVfsIntentLog()
+    {
+        QCOMPARE(_db.getAndClearVfsIntents(), QByteArrayList());
+
+        _db.setVfsIntent(QByteArrayLiteral("hydrating/file"), SyncJournalDb::VfsIntentOp::Hydrate);
+        _db.setVfsIntent(QByteArrayLiteral("pinned/file"), SyncJournalDb::VfsIntentOp::Pin);
+        // A new intent for the same path replaces the old one
+        _db.setVfsIntent(QByteArrayLiteral("hydrating/file"), SyncJournalDb::VfsIntentOp::Dehydrate);
+
+        // A completed transition removes its entry
+        _db.removeVfsIntent(QByteArrayLiteral("pinned/file"));
+
+        const auto pending = _db.getAndClearVfsIntents();
+        QCOMPARE(pending, QByteArrayList({ QByteArrayLiteral("hydrating/file") }));
+
+        // Replay consumed the log
+        QCOMPARE(_db.getAndClearVfsIntents(), QByteArrayList());
     }
 
     void testAvoidReadFromDbOnNextSync()
@@ -445,6 +675,45 @@ private Q_SLOTS:
         QCOMPARE(list->size(), 0);
     }
 
+    void testPhashRehashMigration()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString dbFile = dir.path() + QStringLiteral("/sync.db");
+
+        {
+            SyncJournalDb db(dbFile, nullptr);
+            SyncJournalFileRecord record;
+            record._path = "migrate/me";
+            record._modtime = dropMsecs(QDateTime::currentDateTime());
+            record._type = ItemTypeFile;
+            record._etag = "etag";
+            record._fileId = "fileid";
+            record._remotePerm = RemotePermissions::fromDbValue("RW");
+            record._fileSize = 42;
+            QVERIFY(db.setFileRecord(record));
+            db.close();
+        }
+
+        // Fake an old journal: break the phash column and mark hash version 1
+        {
+            sqlite3 *raw = nullptr;
+            QCOMPARE(sqlite3_open(dbFile.toUtf8().constData(), &raw), SQLITE_OK);
+            QCOMPARE(sqlite3_exec(raw, "UPDATE metadata SET phash = 12345; UPDATE hashversion SET version = 1;", nullptr, nullptr, nullptr), SQLITE_OK);
+            sqlite3_close(raw);
+        }
+
+        SyncJournalDb db(dbFile, nullptr);
+        QSignalSpy progressSpy(&db, &SyncJournalDb::migrationProgress);
+
+        // Looking up by path only works again once the rehash restored phash
+        SyncJournalFileRecord record;
+        QVERIFY(db.getFileRecord(QByteArrayLiteral("migrate/me"), &record));
+        QVERIFY(record.isValid());
+        QVERIFY(!progressSpy.isEmpty());
+        db.close();
+    }
+
 private:
     SyncJournalDb _db;
 };
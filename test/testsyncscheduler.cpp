@@ -0,0 +1,92 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "common/chronoelapsedtimer.h"
+#include "folderman.h"
+#include "libsync/configfile.h"
+#include "scheduling/syncscheduler.h"
+
+#include "testutils/testutils.h"
+
+#include <syncenginetestutils.h>
+
+using namespace std::chrono;
+using namespace std::chrono_literals;
+using namespace OCC;
+
+namespace {
+// The virtual time source: tests advance this instead of waiting.
+steady_clock::time_point virtualNow = steady_clock::now();
+
+steady_clock::time_point virtualClock()
+{
+    return virtualNow;
+}
+}
+
+class TestSyncScheduler : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        // All ChronoElapsedTimers now read virtualNow, so days of scheduler
+        // policy can be simulated without waiting.
+        Utility::ChronoElapsedTimer::setClockOverrideForTesting(&virtualClock);
+    }
+
+    void cleanupTestCase()
+    {
+        Utility::ChronoElapsedTimer::setClockOverrideForTesting(nullptr);
+    }
+
+    void testHeatDecaySimulation()
+    {
+        auto dir = TestUtils::createTempDir();
+        QVERIFY(dir.isValid());
+        QVERIFY(QDir(dir.path()).mkpath(QStringLiteral("folder")));
+
+        auto accountState = createDummyAccount();
+        FolderMan *folderman = TestUtils::folderMan();
+        Folder *folder = folderman->addFolder(
+            accountState.get(), TestUtils::createDummyFolderDefinition(accountState->account(), dir.path() + QStringLiteral("/folder")));
+        QVERIFY(folder);
+
+        auto *scheduler = folderman->scheduler();
+
+        // Mirrors the policy constants in syncscheduler.cpp.
+        const auto hotInterval = 5min;
+        const auto dormantInterval = std::max<milliseconds>(ConfigFile().fullLocalDiscoveryInterval() + 2min, hotInterval);
+
+        // A folder without any recorded activity syncs at the dormant cadence.
+        QCOMPARE(scheduler->currentSyncInterval(folder), dormantInterval);
+
+        // Activity makes it hot.
+        scheduler->recordActivity(folder);
+        QCOMPARE(scheduler->currentSyncInterval(folder), milliseconds(hotInterval));
+
+        // Without further activity the interval doubles per elapsed interval.
+        virtualNow += 10min;
+        QCOMPARE(scheduler->currentSyncInterval(folder), milliseconds(10min));
+
+        virtualNow += 50min;
+        QCOMPARE(scheduler->currentSyncInterval(folder), milliseconds(40min));
+
+        // After days of inactivity the folder is dormant again.
+        virtualNow += hours(72);
+        QCOMPARE(scheduler->currentSyncInterval(folder), dormantInterval);
+
+        // New activity resets the decay.
+        scheduler->recordActivity(folder);
+        QCOMPARE(scheduler->currentSyncInterval(folder), milliseconds(hotInterval));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSyncScheduler)
+#include "testsyncscheduler.moc"
@@ -0,0 +1,80 @@
+/*
+ * This software is in the public domain, furnished "as is", without technical
+ * support, and with no warranty, express or implied, as to its usefulness for
+ * any purpose.
+ *
+ */
+
+#include "testutils/synthetictree.h"
+
+#include <QtTest>
+
+using namespace OCC;
+using namespace OCC::TestUtils;
+
+class TestSyntheticTree : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testDeterminism()
+    {
+        SyntheticTreeSpec spec;
+        spec.fileCount = 500;
+        spec.filesPerDirectory = 25;
+        spec.maxDepth = 4;
+        spec.minFileSize = 10;
+        spec.maxFileSize = 1000;
+        spec.seed = 42;
+
+        const FileInfo a = buildSyntheticTree(spec);
+        const FileInfo b = buildSyntheticTree(spec);
+        QCOMPARE(a, b);
+        QCOMPARE(filePaths(a), filePaths(b));
+
+        // A different seed must give a different layout.
+        spec.seed = 43;
+        QVERIFY(filePaths(buildSyntheticTree(spec)) != filePaths(a));
+    }
+
+    void testShape()
+    {
+        SyntheticTreeSpec spec;
+        spec.fileCount = 300;
+        spec.filesPerDirectory = 10;
+        spec.maxDepth = 2;
+        spec.seed = 7;
+
+        const QStringList paths = filePaths(buildSyntheticTree(spec));
+        QCOMPARE(paths.size(), spec.fileCount);
+        for (const QString &path : paths) {
+            // Every file sits in a directory of at most maxDepth levels.
+            QVERIFY(path.count(QLatin1Char('/')) <= spec.maxDepth);
+            QVERIFY(path.count(QLatin1Char('/')) >= 1);
+        }
+    }
+
+    void testChurnSyncsClean()
+    {
+        SyntheticTreeSpec spec;
+        spec.fileCount = 200;
+        spec.filesPerDirectory = 20;
+        spec.seed = 7;
+
+        FakeFolder fakeFolder(buildSyntheticTree(spec));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        ChurnSpec churn;
+        churn.modifyCount = 10;
+        churn.renameCount = 5;
+        churn.removeCount = 5;
+        churn.insertCount = 5;
+        churn.seed = 3;
+        applyChurn(fakeFolder.localModifier(), fakeFolder.currentLocalState(), churn);
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSyntheticTree)
+#include "testsynthetictree.moc"
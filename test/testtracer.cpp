@@ -0,0 +1,99 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "common/tracer.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+
+using namespace OCC;
+
+namespace {
+QJsonArray eventsNamed(const QString &name)
+{
+    QJsonArray out;
+    const QJsonArray all = Tracer::toTraceEventJson();
+    for (const auto &value : all) {
+        if (value.toObject().value(QStringLiteral("name")).toString() == name) {
+            out.append(value);
+        }
+    }
+    return out;
+}
+}
+
+class TestTracer : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRecordAndExport()
+    {
+        Tracer::record("test", "testRecordAndExport", 100, 42);
+
+        const QJsonArray events = eventsNamed(QStringLiteral("testRecordAndExport"));
+        QCOMPARE(events.size(), 1);
+        const QJsonObject event = events.first().toObject();
+        QCOMPARE(event.value(QStringLiteral("ph")).toString(), QStringLiteral("X"));
+        QCOMPARE(event.value(QStringLiteral("cat")).toString(), QStringLiteral("test"));
+        QCOMPARE(event.value(QStringLiteral("ts")).toInteger(), 100);
+        QCOMPARE(event.value(QStringLiteral("dur")).toInteger(), 42);
+        QCOMPARE(event.value(QStringLiteral("pid")).toInteger(), QCoreApplication::applicationPid());
+        QVERIFY(event.contains(QStringLiteral("tid")));
+    }
+
+    void testSpan()
+    {
+        const qint64 before = Tracer::nowUs();
+        {
+            OC_TRACE_SPAN("test", "testSpan");
+            QTest::qSleep(5);
+        }
+        const qint64 after = Tracer::nowUs();
+
+        const QJsonArray events = eventsNamed(QStringLiteral("testSpan"));
+        QCOMPARE(events.size(), 1);
+        const QJsonObject event = events.first().toObject();
+        QVERIFY(event.value(QStringLiteral("ts")).toInteger() >= before);
+        QVERIFY(event.value(QStringLiteral("dur")).toInteger() > 0);
+        QVERIFY(event.value(QStringLiteral("ts")).toInteger() + event.value(QStringLiteral("dur")).toInteger() <= after);
+    }
+
+    void testRingOverwritesOldest()
+    {
+        // More events than one ring holds: the newest ones must survive
+        const int count = 5000;
+        for (int i = 0; i < count; ++i) {
+            Tracer::record("test", "testRingOverwritesOldest", i, 1);
+        }
+
+        const QJsonArray events = eventsNamed(QStringLiteral("testRingOverwritesOldest"));
+        QVERIFY(!events.isEmpty());
+        QVERIFY(events.size() < count);
+        QCOMPARE(events.last().toObject().value(QStringLiteral("ts")).toInteger(), count - 1);
+    }
+
+    void testOtherThreadsAreExported()
+    {
+        auto *thread = QThread::create([] {
+            Tracer::record("test", "testOtherThreadsAreExported", 7, 3);
+        });
+        thread->start();
+        QVERIFY(thread->wait());
+        delete thread;
+
+        // The ring of the finished thread stays registered
+        const QJsonArray events = eventsNamed(QStringLiteral("testOtherThreadsAreExported"));
+        QCOMPARE(events.size(), 1);
+        QVERIFY(events.first().toObject().value(QStringLiteral("tid")).toInteger() != 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestTracer)
+#include "testtracer.moc"
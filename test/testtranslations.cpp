@@ -0,0 +1,52 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "gui/translations.h"
+
+using namespace OCC;
+
+class TestTranslations : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testNoCandidatesIsEmpty()
+    {
+        Translations::LazyTranslator translator;
+        QVERIFY(translator.isEmpty());
+        QVERIFY(translator.translate("Foo", "bar").isNull());
+    }
+
+    void testFailedLoadBecomesEmptyAfterFirstLookup()
+    {
+        Translations::LazyTranslator translator;
+        translator.addCandidate(QStringLiteral("client_no_such_locale"), Translations::translationsDirectoryPath());
+        // pending candidates must count as non-empty, otherwise installing the
+        // translator up front would be skipped
+        QVERIFY(!translator.isEmpty());
+        QVERIFY(translator.translate("Foo", "bar").isNull());
+        QVERIFY(translator.isEmpty());
+    }
+
+    void testFirstWorkingCandidateWins()
+    {
+        Translations::LazyTranslator translator;
+        translator.addCandidate(QStringLiteral("client_no_such_locale"), Translations::translationsDirectoryPath());
+        translator.addCandidate(QStringLiteral("client_de"), Translations::translationsDirectoryPath());
+
+        // the catalog is only probed once a string is actually looked up
+        QVERIFY(translator.filePath().isEmpty());
+        translator.translate("Foo", "bar");
+        QVERIFY(translator.filePath().endsWith(QStringLiteral("client_de.qm")));
+        QVERIFY(!translator.isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestTranslations)
+#include "testtranslations.moc"
@@ -266,6 +266,20 @@ private Q_SLOTS:
         QCOMPARE(sanitizeForFileName(input), output);
     }
 
+    void testJoinPath()
+    {
+        QCOMPARE(joinPath(QStringLiteral("a/b"), QStringLiteral("c")), QStringLiteral("a/b/c"));
+        QCOMPARE(joinPath(QString(), QStringLiteral("c")), QStringLiteral("c"));
+        QCOMPARE(joinPath(QStringLiteral("a"), QString()), QStringLiteral("a/"));
+
+        // The buffer variant keeps its capacity across calls.
+        QString buffer;
+        QCOMPARE(joinPathInto(buffer, QStringLiteral("some/long/base/path"), QStringLiteral("name")), QStringLiteral("some/long/base/path/name"));
+        const auto capacity = buffer.capacity();
+        QCOMPARE(joinPathInto(buffer, QStringLiteral("a"), QStringLiteral("b")), QStringLiteral("a/b"));
+        QCOMPARE(buffer.capacity(), capacity);
+    }
+
     void testNormalizeEtag()
     {
         ;
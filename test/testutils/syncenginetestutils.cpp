@@ -835,6 +835,9 @@ QNetworkReply *FakeAM::createRequest(QNetworkAccessManager::Operation op, const
             reply = new FakeHangingReply(op, newRequest, this);
         } else if (_errorPaths.contains(fileName)) {
             reply = new FakeErrorReply { op, newRequest, this, _errorPaths[fileName] };
+        } else if (_shaping.errorRatePercent > 0 && int(_shapingRng.bounded(100)) < _shaping.errorRatePercent) {
+            // Injected transient server error, see NetworkShaping.
+            reply = new FakeErrorReply { op, newRequest, this, 500 };
         }
     }
     if (!reply) {
@@ -843,17 +846,19 @@ QNetworkReply *FakeAM::createRequest(QNetworkAccessManager::Operation op, const
         const auto verb = newRequest.attribute(QNetworkRequest::CustomVerbAttribute).toByteArray();
         if (verb == QByteArrayLiteral("PROPFIND"))
             // Ignore outgoingData always returning something good enough, works for now.
-            reply = new FakePropfindReply { info, op, newRequest, this };
-        else if (verb == QByteArrayLiteral("GET") || op == QNetworkAccessManager::GetOperation)
-            reply = new FakeGetReply { info, op, newRequest, this };
-        else if (verb == QByteArrayLiteral("PUT") || op == QNetworkAccessManager::PutOperation)
-            reply = new FakePutReply { info, op, newRequest, outgoingData->readAll(), this };
-        else if (verb == QByteArrayLiteral("MKCOL"))
-            reply = new FakeMkcolReply { info, op, newRequest, this };
+            reply = makeShapedReply<FakePropfindReply>(0, info, op, newRequest, this);
+        else if (verb == QByteArrayLiteral("GET") || op == QNetworkAccessManager::GetOperation) {
+            const FileInfo *file = info.find(getFilePathFromUrl(newRequest.url()));
+            reply = makeShapedReply<FakeGetReply>(file ? qint64(file->fileSize) : 0, info, op, newRequest, this);
+        } else if (verb == QByteArrayLiteral("PUT") || op == QNetworkAccessManager::PutOperation) {
+            const QByteArray putPayload = outgoingData->readAll();
+            reply = makeShapedReply<FakePutReply>(putPayload.size(), info, op, newRequest, putPayload, this);
+        } else if (verb == QByteArrayLiteral("MKCOL"))
+            reply = makeShapedReply<FakeMkcolReply>(0, info, op, newRequest, this);
         else if (verb == QByteArrayLiteral("DELETE") || op == QNetworkAccessManager::DeleteOperation)
-            reply = new FakeDeleteReply { info, op, newRequest, this };
+            reply = makeShapedReply<FakeDeleteReply>(0, info, op, newRequest, this);
         else if (verb == QByteArrayLiteral("MOVE"))
-            reply = new FakeMoveReply { info, op, newRequest, this };
+            reply = makeShapedReply<FakeMoveReply>(0, info, op, newRequest, this);
         else {
             qDebug() << verb << outgoingData;
             Q_UNREACHABLE();
@@ -23,6 +23,7 @@
 #include <QDir>
 #include <QMap>
 #include <QNetworkReply>
+#include <QRandomGenerator>
 #include <QTimer>
 #include <QtTest>
 #include <cookiejar.h>
@@ -329,7 +330,7 @@ public:
 
     FakePropfindReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     Q_INVOKABLE void respond404();
 
@@ -361,7 +362,7 @@ class FakeMkcolReply : public FakeReply
 public:
     FakeMkcolReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     qint64 readData(char *, qint64) override { return 0; }
 
@@ -376,7 +377,7 @@ class FakeDeleteReply : public FakeReply
 public:
     FakeDeleteReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     qint64 readData(char *, qint64) override { return 0; }
 };
@@ -388,7 +389,7 @@ class FakeMoveReply : public FakeReply
 public:
     FakeMoveReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent);
 
-    Q_INVOKABLE void respond();
+    Q_INVOKABLE virtual void respond();
 
     qint64 readData(char *, qint64) override { return 0; }
 };
@@ -498,6 +499,22 @@ class FakeAM : public OCC::AccessManager
 public:
     using Override = std::function<QNetworkReply *(Operation, const QNetworkRequest &, QIODevice *)>;
 
+    /** Makes the instantly-answering fake server behave like a network.
+     *
+     * latency is added before every response; bytesPerSecond additionally
+     * stretches GET/PUT responses proportionally to their payload size;
+     * errorRatePercent turns the given share of requests into HTTP 500
+     * replies, drawn deterministically from seed so a failing combination
+     * can be replayed.
+     */
+    struct NetworkShaping
+    {
+        std::chrono::milliseconds latency { 0 };
+        qint64 bytesPerSecond = 0; // 0 = unthrottled
+        int errorRatePercent = 0;
+        quint32 seed = 0;
+    };
+
 private:
     FileInfo _remoteRootFileInfo;
     FileInfo _uploadFileInfo;
@@ -505,6 +522,22 @@ private:
     QHash<QString, int> _errorPaths;
     // monitor requests and optionally provide custom replies
     Override _override;
+    NetworkShaping _shaping;
+    QRandomGenerator _shapingRng { 0 };
+
+    template <class ReplyT, typename... Args>
+    QNetworkReply *makeShapedReply(qint64 payloadBytes, Args &&...args)
+    {
+        using namespace std::chrono;
+        milliseconds delay = _shaping.latency;
+        if (_shaping.bytesPerSecond > 0 && payloadBytes > 0) {
+            delay += milliseconds(payloadBytes * 1000 / _shaping.bytesPerSecond);
+        }
+        if (delay > 0ms) {
+            return new DelayedReply<ReplyT>(delay, std::forward<Args>(args)...);
+        }
+        return new ReplyT(std::forward<Args>(args)...);
+    }
 
 public:
     FakeAM(QObject *parent);
@@ -518,6 +551,12 @@ public:
 
     void setOverride(const Override &override) { _override = override; }
 
+    void setNetworkShaping(const NetworkShaping &shaping)
+    {
+        _shaping = shaping;
+        _shapingRng.seed(shaping.seed);
+    }
+
 protected:
     QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
         QIODevice *outgoingData = nullptr) override;
@@ -600,6 +639,7 @@ public:
     };
     ErrorList serverErrorPaths() { return { _fakeAm }; }
     void setServerOverride(const FakeAM::Override &override) { _fakeAm->setOverride(override); }
+    void setNetworkShaping(const FakeAM::NetworkShaping &shaping) { _fakeAm->setNetworkShaping(shaping); }
 
     QString localPath() const;
 
@@ -0,0 +1,99 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+#include "synthetictree.h"
+
+#include <QRandomGenerator>
+
+namespace {
+
+void collectFiles(const OCC::FileInfo &info, const QString &prefix, QStringList *out)
+{
+    for (const auto &child : info.children) {
+        const QString path = prefix.isEmpty() ? child.name : prefix + QLatin1Char('/') + child.name;
+        if (child.isDir) {
+            collectFiles(child, path, out);
+        } else {
+            out->append(path);
+        }
+    }
+}
+
+} // anonymous namespace
+
+namespace OCC {
+
+namespace TestUtils {
+
+    FileInfo buildSyntheticTree(const SyntheticTreeSpec &spec)
+    {
+        FileInfo tree;
+        QRandomGenerator rng(spec.seed);
+
+        const int directoryCount = qMax(1, (spec.fileCount + spec.filesPerDirectory - 1) / spec.filesPerDirectory);
+
+        // Directories first: each nests under a random existing directory,
+        // falling back to the root when the candidate is already at maxDepth.
+        QStringList dirs;
+        dirs.reserve(directoryCount);
+        for (int d = 0; d < directoryCount; ++d) {
+            QString parent;
+            if (!dirs.isEmpty()) {
+                parent = dirs.at(rng.bounded(dirs.size()));
+            }
+            if (parent.count(QLatin1Char('/')) + 1 >= spec.maxDepth) {
+                parent.clear();
+            }
+            const QString dir = parent.isEmpty() ? QStringLiteral("d%1").arg(d) : QStringLiteral("%1/d%2").arg(parent).arg(d);
+            tree.mkdir(dir);
+            dirs.append(dir);
+        }
+
+        // Files round-robin over the directories so each ends up with close
+        // to filesPerDirectory of them.
+        for (int f = 0; f < spec.fileCount; ++f) {
+            const quint64 size = spec.maxFileSize > spec.minFileSize
+                ? spec.minFileSize + rng.bounded(quint32(spec.maxFileSize - spec.minFileSize + 1))
+                : spec.minFileSize;
+            tree.insert(QStringLiteral("%1/f%2").arg(dirs.at(f % directoryCount)).arg(f), size);
+        }
+        return tree;
+    }
+
+    void applyChurn(FileModifier &target, const FileInfo &tree, const ChurnSpec &churn)
+    {
+        QRandomGenerator rng(churn.seed);
+        QStringList candidates = filePaths(tree);
+
+        // Drawing without replacement keeps the operations disjoint.
+        const auto takeCandidate = [&]() {
+            return candidates.takeAt(rng.bounded(candidates.size()));
+        };
+
+        for (int i = 0; i < churn.modifyCount && !candidates.isEmpty(); ++i) {
+            target.appendByte(takeCandidate());
+        }
+        for (int i = 0; i < churn.renameCount && !candidates.isEmpty(); ++i) {
+            const QString path = takeCandidate();
+            target.rename(path, path + QStringLiteral(".renamed"));
+        }
+        for (int i = 0; i < churn.removeCount && !candidates.isEmpty(); ++i) {
+            target.remove(takeCandidate());
+        }
+        for (int i = 0; i < churn.insertCount; ++i) {
+            target.insert(QStringLiteral("churn-new-%1").arg(i));
+        }
+    }
+
+    QStringList filePaths(const FileInfo &tree)
+    {
+        QStringList out;
+        collectFiles(tree, QString(), &out);
+        return out;
+    }
+
+} // namespace TestUtils
+} // namespace OCC
@@ -0,0 +1,64 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+#pragma once
+
+#include "syncenginetestutils.h"
+
+#include <QString>
+#include <QStringList>
+
+namespace OCC {
+namespace TestUtils {
+
+    /** Parameters for a deterministic synthetic tree.
+     *
+     * The same spec always produces the same tree, so a scale problem
+     * reported as "2M files, 200k dirs, depth 6, seed 7" is reproducible
+     * without shipping the reporter's data. The resulting FileInfo can seed
+     * both sides of a FakeFolder, or be applied to a real directory through
+     * the local FileModifier.
+     */
+    struct SyntheticTreeSpec
+    {
+        int fileCount = 1000;
+        int filesPerDirectory = 100; // determines the directory count
+        int maxDepth = 3; // directories nest at most this deep
+        quint64 minFileSize = 23;
+        quint64 maxFileSize = 23; // sizes are uniform in [min, max]
+        quint32 seed = 0;
+    };
+
+    /// Build the tree described by \a spec as a remote/local template.
+    FileInfo buildSyntheticTree(const SyntheticTreeSpec &spec);
+
+    /** A deterministic churn script: how many files to touch in which way.
+     *
+     * Targets are drawn from the current tree state without replacement, so
+     * the operations never overlap. Renames stay within the file's directory.
+     */
+    struct ChurnSpec
+    {
+        int modifyCount = 0;
+        int renameCount = 0;
+        int removeCount = 0;
+        int insertCount = 0;
+        quint32 seed = 0;
+    };
+
+    /** Apply \a churn to \a target, which mirrors the state described by \a tree.
+     *
+     * \a target can be a FakeFolder's localModifier() or remoteModifier(), or
+     * a FileInfo itself; applying the same script to several modifiers keeps
+     * them in step.
+     */
+    void applyChurn(FileModifier &target, const FileInfo &tree, const ChurnSpec &churn);
+
+    /// All file (non-directory) paths of \a tree, sorted, relative to its root.
+    QStringList filePaths(const FileInfo &tree);
+
+} // namespace TestUtils
+} // namespace OCC
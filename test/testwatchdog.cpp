@@ -0,0 +1,91 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "common/tracer.h"
+#include "common/watchdog.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+
+using namespace OCC;
+
+namespace {
+
+int watchdogEventCount(const QString &name)
+{
+    int count = 0;
+    const QJsonArray events = Tracer::toTraceEventJson();
+    for (const auto &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("cat")).toString() == QLatin1String("watchdog")
+            && event.value(QStringLiteral("name")).toString() == name) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+} // anonymous namespace
+
+class TestWatchdog : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        // The budget latches on first use, set it before the first scope
+        qputenv("OWNCLOUD_WATCHDOG_BUDGET_MS", "100");
+    }
+
+    void testSlowOperationIsReportedWhileRunning()
+    {
+        {
+            const Watchdog::OperationScope scope("test.slowOp");
+            // Stay over budget long enough for at least one sampling round
+            QThread::msleep(700);
+            QVERIFY(watchdogEventCount(QStringLiteral("test.slowOp")) >= 1);
+        }
+        // One report per occurrence, not one per sampling round
+        QCOMPARE(watchdogEventCount(QStringLiteral("test.slowOp")), 1);
+    }
+
+    void testFastOperationIsNotReported()
+    {
+        {
+            const Watchdog::OperationScope scope("test.fastOp");
+        }
+        QThread::msleep(400);
+        QCOMPARE(watchdogEventCount(QStringLiteral("test.fastOp")), 0);
+    }
+
+    void testNestedScopesReportOutermost()
+    {
+        const Watchdog::OperationScope outer("test.outerOp");
+        {
+            const Watchdog::OperationScope inner("test.innerOp");
+            QThread::msleep(700);
+        }
+        QVERIFY(watchdogEventCount(QStringLiteral("test.outerOp")) >= 1);
+        QCOMPARE(watchdogEventCount(QStringLiteral("test.innerOp")), 0);
+    }
+
+    void testEventLoopStallIsReported()
+    {
+        Watchdog::watchEventLoop(this, "test.eventLoop");
+        // Let the heartbeat timer beat a few times, then block the loop
+        QTest::qWait(300);
+        QCOMPARE(watchdogEventCount(QStringLiteral("test.eventLoop")), 0);
+        QThread::msleep(700);
+        QVERIFY(watchdogEventCount(QStringLiteral("test.eventLoop")) >= 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestWatchdog)
+#include "testwatchdog.moc"